@@ -57,6 +57,11 @@ public:
     {
         return this->pSite->CreateBitmap(pixeltype, width, height, stride, extraRows, extraColumns);
     }
+
+    std::shared_ptr<libCZI::ITaskExecutor> GetTaskExecutor() override
+    {
+        return this->pSite->GetTaskExecutor();
+    }
 };
 
 int main(int argc, char** _argv)
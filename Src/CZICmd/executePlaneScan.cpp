@@ -72,6 +72,11 @@ protected:
         scstaOptions.subBlockCache = cache_context.cache;
         scstaOptions.useVisibilityCheckOptimization = options.GetUseVisibilityCheckOptimization();
 
+        // the sub-blocks are decoded concurrently on the library's task executor - with background priority, so
+        //  that interactive requests (in an application sharing the executor) are served first
+        scstaOptions.maxNumberOfDecodeThreads = GetDefaultTaskExecutor()->GetMaxConcurrency();
+        scstaOptions.decodeTaskPriority = TaskPriority::Background;
+
         const auto bitmap = accessor->Get(roi, &plane_coordinate, options.GetZoom(), &scstaOptions);
 
         if (cache_context.cache)
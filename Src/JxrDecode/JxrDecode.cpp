@@ -3,9 +3,14 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include "JxrDecode.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <memory>
 #include <stdexcept> 
 #include <sstream>
+#include <cstring>
+#include <vector>
 #include "jxrlib/jxrgluelib/JXRGlue.h"
 
 #include "jxrlib/image/sys/windowsmediaphoto.h"
@@ -72,6 +77,249 @@ static JxrDecode::PixelFormat JxrPixelFormatGuidToEnum(const GUID& guid)
     return JxrDecode::PixelFormat::kInvalid;
 }
 
+namespace
+{
+    /// A read-only jxrlib-stream operating on a block of memory. In contrast to the stream created by "CreateWS_Memory",
+    /// a read going beyond the end of the memory block is not silently truncated, but it fails and this condition is
+    /// recorded. This allows to reliably tell whether a prefix of the compressed data was sufficient for an operation.
+    struct BoundedMemoryStream
+    {
+        WMPStream stream;       ///< The jxrlib-stream object - this must be the first member (we cast from WMPStream* to BoundedMemoryStream*).
+        bool read_beyond_end;   ///< True if an attempt was made to read beyond the end of the memory block.
+
+        BoundedMemoryStream(const void* ptr, size_t size)
+        {
+            memset(&this->stream, 0, sizeof(this->stream));
+            this->stream.state.buf.pbBuf = static_cast<U8*>(const_cast<void*>(ptr));
+            this->stream.state.buf.cbBuf = size;
+            this->stream.state.buf.cbCur = 0;
+            this->stream.fMem = !0;
+            this->stream.Close = BoundedMemoryStream::Close;
+            this->stream.EOS = BoundedMemoryStream::EOS;
+            this->stream.Read = BoundedMemoryStream::Read;
+            this->stream.Write = BoundedMemoryStream::Write;
+            this->stream.SetPos = BoundedMemoryStream::SetPos;
+            this->stream.GetPos = BoundedMemoryStream::GetPos;
+            this->read_beyond_end = false;
+        }
+
+    private:
+        static ERR Close(struct tagWMPStream** ppWS)
+        {
+            // the object is not owned by jxrlib, so there is nothing to do here
+            return WMP_errSuccess;
+        }
+
+        static Bool EOS(struct tagWMPStream* pWS)
+        {
+            return pWS->state.buf.cbBuf <= pWS->state.buf.cbCur;
+        }
+
+        static ERR Read(struct tagWMPStream* pWS, void* pv, size_t cb)
+        {
+            if (pWS->state.buf.cbCur > pWS->state.buf.cbBuf || pWS->state.buf.cbBuf - pWS->state.buf.cbCur < cb)
+            {
+                // Note that the caller may not check the return code (which is e.g. the case for the "SimpleBitIO"-functions),
+                //  so we zero the destination in order to at least have deterministic behavior.
+                reinterpret_cast<BoundedMemoryStream*>(pWS)->read_beyond_end = true;
+                memset(pv, 0, cb);
+                return WMP_errBufferOverflow;
+            }
+
+            memcpy(pv, pWS->state.buf.pbBuf + pWS->state.buf.cbCur, cb);
+            pWS->state.buf.cbCur += cb;
+            return WMP_errSuccess;
+        }
+
+        static ERR Write(struct tagWMPStream* pWS, const void* pv, size_t cb)
+        {
+            return WMP_errNotYetImplemented;
+        }
+
+        static ERR SetPos(struct tagWMPStream* pWS, size_t offPos)
+        {
+            pWS->state.buf.cbCur = offPos;
+            return WMP_errSuccess;
+        }
+
+        static ERR GetPos(struct tagWMPStream* pWS, size_t* poffPos)
+        {
+            *poffPos = pWS->state.buf.cbCur;
+            return WMP_errSuccess;
+        }
+    };
+
+    /// The jxrlib-objects which are required for decoding a bitmap - the stream object, the decoder object and the memory for the
+    /// state of the codec (which includes its macroblock row buffers). Constructing and destroying those objects is a noticeable
+    /// part of the cost of decoding a small bitmap, so an instance of this class is intended to be reused - the stream object is
+    /// pointed to the data of the next bitmap, the decoder object is reset, and the memory for the state of the codec is kept (and
+    /// only reallocated if a larger amount is required). So, when decoding bitmaps of the same size and pixel format, no allocation
+    /// for those objects is necessary.
+    class DecoderContext
+    {
+    private:
+        WMPStream* stream_;
+        PKImageDecode* decoder_;
+        void* working_memory_;
+        size_t working_memory_size_;
+    public:
+        DecoderContext() : stream_(nullptr), decoder_(nullptr), working_memory_(nullptr), working_memory_size_(0)
+        {}
+
+        DecoderContext(const DecoderContext&) = delete;
+        DecoderContext& operator=(const DecoderContext&) = delete;
+
+        ~DecoderContext()
+        {
+            if (this->decoder_ != nullptr)
+            {
+                this->decoder_->Release(&this->decoder_);
+            }
+
+            if (this->stream_ != nullptr)
+            {
+                this->stream_->Close(&this->stream_);
+            }
+
+            free(this->working_memory_);
+        }
+
+        /// Prepares the decoder object for decoding the specified data - i.e. the container and the image header are parsed.
+        ///
+        /// \param          ptrData     Pointer to the compressed data.
+        /// \param          size        The size of the compressed data in bytes.
+        /// \param [out]    failed_call If unsuccessful, the name of the jxrlib-function which failed is put here.
+        ///
+        /// \returns    The jxrlib-error code.
+        ERR Initialize(const void* ptrData, size_t size, const char*& failed_call)
+        {
+            ERR err;
+            if (this->stream_ == nullptr)
+            {
+                err = CreateWS_Memory(&this->stream_, const_cast<void*>(ptrData), size);
+                if (Failed(err))
+                {
+                    failed_call = "CreateWS_Memory";
+                    return err;
+                }
+            }
+            else
+            {
+                this->stream_->state.buf.pbBuf = static_cast<U8*>(const_cast<void*>(ptrData));
+                this->stream_->state.buf.cbBuf = size;
+                this->stream_->state.buf.cbCur = 0;
+            }
+
+            if (this->decoder_ == nullptr)
+            {
+                err = PKCodecFactory_CreateCodec(&IID_PKImageWmpDecode, reinterpret_cast<void**>(&this->decoder_));
+                if (Failed(err))
+                {
+                    failed_call = "PKCodecFactory_CreateCodec";
+                    return err;
+                }
+            }
+            else
+            {
+                PKImageDecode_Reset_WMP(this->decoder_);
+            }
+
+            err = this->decoder_->Initialize(this->decoder_, this->stream_);
+            if (Failed(err))
+            {
+                failed_call = "decoder::Initialize";
+                return err;
+            }
+
+            this->decoder_->WMP.wmiSCP.pfnAllocWorkingMemory = DecoderContext::AllocWorkingMemory;
+            this->decoder_->WMP.wmiSCP.pfnFreeWorkingMemory = DecoderContext::FreeWorkingMemory;
+            this->decoder_->WMP.wmiSCP.pvWorkingMemoryContext = this;
+            return WMP_errSuccess;
+        }
+
+        PKImageDecode* GetDecoder() const
+        {
+            return this->decoder_;
+        }
+
+    private:
+        static void* AllocWorkingMemory(void* context, size_t size)
+        {
+            DecoderContext* decoder_context = static_cast<DecoderContext*>(context);
+            if (size > decoder_context->working_memory_size_)
+            {
+                free(decoder_context->working_memory_);
+                decoder_context->working_memory_ = malloc(size);
+                decoder_context->working_memory_size_ = decoder_context->working_memory_ != nullptr ? size : 0;
+            }
+
+            return decoder_context->working_memory_;
+        }
+
+        static void FreeWorkingMemory(void* context, void* ptr)
+        {
+            // the memory is kept for the next bitmap, and it is freed when the context is destroyed
+        }
+    };
+
+    /// Whether decoder contexts are reused (c.f. JxrDecode::SetDecoderContextPoolEnabled).
+    std::atomic<bool> decoder_context_pool_enabled{ true };
+
+    /// This class leases a decoder context from the thread-local pool (or constructs a new one if the pool is empty or disabled),
+    /// and puts it back into the pool when the lease ends - unless the operation failed (in which case the context is discarded,
+    /// in order not to reuse a context whose state is unknown).
+    class DecoderContextLease
+    {
+    private:
+        static constexpr size_t kMaxNumberOfPooledContextsPerThread = 2;
+
+        static thread_local std::vector<std::unique_ptr<DecoderContext>> pool_;
+
+        std::unique_ptr<DecoderContext> context_;
+        bool return_to_pool_;
+    public:
+        DecoderContextLease() : return_to_pool_(false)
+        {
+            if (decoder_context_pool_enabled.load(std::memory_order_relaxed) && !DecoderContextLease::pool_.empty())
+            {
+                this->context_ = std::move(DecoderContextLease::pool_.back());
+                DecoderContextLease::pool_.pop_back();
+            }
+            else
+            {
+                this->context_.reset(new DecoderContext());
+            }
+        }
+
+        DecoderContextLease(const DecoderContextLease&) = delete;
+        DecoderContextLease& operator=(const DecoderContextLease&) = delete;
+
+        ~DecoderContextLease()
+        {
+            if (this->return_to_pool_ &&
+                decoder_context_pool_enabled.load(std::memory_order_relaxed) &&
+                DecoderContextLease::pool_.size() < kMaxNumberOfPooledContextsPerThread)
+            {
+                DecoderContextLease::pool_.push_back(std::move(this->context_));
+            }
+        }
+
+        DecoderContext* operator->() const
+        {
+            return this->context_.get();
+        }
+
+        /// Marks the operation as successful - so that the context is put back into the pool.
+        void SetSucceeded()
+        {
+            this->return_to_pool_ = true;
+        }
+    };
+
+    /*static*/constexpr size_t DecoderContextLease::kMaxNumberOfPooledContextsPerThread;
+    /*static*/thread_local std::vector<std::unique_ptr<DecoderContext>> DecoderContextLease::pool_;
+}
+
 static void WriteGuidToStream(ostringstream& string_stream, const GUID& guid)
 {
     string_stream << std::uppercase;
@@ -98,7 +346,9 @@ static void WriteGuidToStream(ostringstream& string_stream, const GUID& guid)
 void JxrDecode::Decode(
             const void* ptrData,
             size_t size,
-            const std::function<std::tuple<void*, std::uint32_t>(PixelFormat pixel_format, std::uint32_t  width, std::uint32_t  height)>& get_destination_func)
+            const std::function<std::tuple<void*, std::uint32_t>(PixelFormat pixel_format, std::uint32_t  width, std::uint32_t  height)>& get_destination_func,
+            std::uint32_t downscale_factor,
+            const Region* region)
 {
     if (ptrData == nullptr)
     {
@@ -115,36 +365,31 @@ void JxrDecode::Decode(
         throw invalid_argument("get_destination_func");
     }
 
-    WMPStream* pStream = nullptr;
-    ERR err = CreateWS_Memory(&pStream, const_cast<void*>(ptrData), size);
-    if (Failed(err))
+    if (downscale_factor != 1 && downscale_factor != 2 && downscale_factor != 4 && downscale_factor != 8 && downscale_factor != 16)
     {
-        // note: the call "CreateWS_Memory" cannot fail (or the only way it can fail is that the memory allocation fails),
-        //        so we do not have to release/free the stream object here.
-        ThrowJxrlibError("'CreateWS_Memory' failed", err);
+        throw invalid_argument("downscale_factor");
     }
 
-    unique_ptr<WMPStream, void(*)(WMPStream*)> upStream(pStream, [](WMPStream* p)->void {p->Close(&p); });
+    if (region != nullptr && (region->width == 0 || region->height == 0))
+    {
+        throw invalid_argument("region");
+    }
 
-    PKImageDecode* pDecoder = nullptr;
-    err = PKCodecFactory_CreateDecoderFromStream(pStream, &pDecoder);
+    // the stream object, the decoder object and the memory for the state of the codec are taken from a (thread-local) pool
+    DecoderContextLease decoder_context;
+    const char* failed_call = nullptr;
+    ERR err = decoder_context->Initialize(ptrData, size, failed_call);
     if (Failed(err))
     {
-        // unfortunately, "PKCodecFactory_CreateDecoderFromStream" may fail leaving us with a partially constructed
-        //  decoder object, so we need to release/free the decoder object here.
-        if (pDecoder != nullptr)
-        {
-            pDecoder->Release(&pDecoder);
-        }
-
-        ThrowJxrlibError("'PKCodecFactory_CreateDecoderFromStream' failed", err);
+        ostringstream string_stream;
+        string_stream << "'" << failed_call << "' failed";
+        ThrowJxrlibError(string_stream, err);
     }
 
-    // construct a smart pointer which will destroy the decoder object when it goes out of scope
-    std::unique_ptr<PKImageDecode, void(*)(PKImageDecode*)> upDecoder(pDecoder, [](PKImageDecode* p)->void {p->Release(&p); });
+    PKImageDecode* const pDecoder = decoder_context->GetDecoder();
 
     U32 frame_count;
-    err = upDecoder->GetFrameCount(upDecoder.get(), &frame_count);
+    err = pDecoder->GetFrameCount(pDecoder, &frame_count);
     if (Failed(err))
     {
         ThrowJxrlibError("'decoder::GetFrameCount' failed", err);
@@ -158,14 +403,14 @@ void JxrDecode::Decode(
     }
 
     I32 width, height;
-    upDecoder->GetSize(upDecoder.get(), &width, &height);
+    pDecoder->GetSize(pDecoder, &width, &height);
     if (Failed(err))
     {
         ThrowJxrlibError("'decoder::GetSize' failed", err);
     }
 
     PKPixelFormatGUID pixel_format_of_decoder;
-    upDecoder->GetPixelFormat(upDecoder.get(), &pixel_format_of_decoder);
+    pDecoder->GetPixelFormat(pDecoder, &pixel_format_of_decoder);
     if (Failed(err))
     {
         ThrowJxrlibError("'decoder::GetPixelFormat' failed", err);
@@ -181,14 +426,43 @@ void JxrDecode::Decode(
         throw runtime_error(string_stream.str());
     }
 
+    downscale_factor = JxrDecode::AdjustDownscaleFactor(width, height, downscale_factor);
+    if (downscale_factor > 1)
+    {
+        // Requesting a "thumbnail" makes the decoder skip the subbands which are not needed for the reduced resolution (and
+        //  the inverse transform is done only for the required part). With a frequency-ordered bitstream, also the flexbits
+        //  (i.e. the least significant bits of the highpass-coefficients) are skipped.
+        width = static_cast<I32>((static_cast<uint32_t>(width) + downscale_factor - 1) / downscale_factor);
+        height = static_cast<I32>((static_cast<uint32_t>(height) + downscale_factor - 1) / downscale_factor);
+        pDecoder->WMP.wmiI.cThumbnailWidth = width;
+        pDecoder->WMP.wmiI.cThumbnailHeight = height;
+        pDecoder->WMP.wmiI.bSkipFlexbits = TRUE;
+    }
+
+    if (region != nullptr)
+    {
+        // note that the region is given in the coordinate system of the "thumbnail" (i.e. of the bitmap with reduced resolution)
+        if (region->x >= static_cast<uint32_t>(width) || region->y >= static_cast<uint32_t>(height))
+        {
+            throw invalid_argument("region");
+        }
+
+        pDecoder->WMP.wmiI.cROILeftX = region->x;
+        pDecoder->WMP.wmiI.cROITopY = region->y;
+        width = static_cast<I32>((min)(region->width, static_cast<uint32_t>(width) - region->x));
+        height = static_cast<I32>((min)(region->height, static_cast<uint32_t>(height) - region->y));
+        pDecoder->WMP.wmiI.cROIWidth = width;
+        pDecoder->WMP.wmiI.cROIHeight = height;
+    }
+
     const auto decode_info = get_destination_func(
         jxrpixel_format,
         width,
         height);
 
     const PKRect rc{ 0, 0, width, height };
-    err = upDecoder->Copy(
-        upDecoder.get(),
+    err = pDecoder->Copy(
+        pDecoder,
         &rc,
         static_cast<U8*>(get<0>(decode_info)),
         get<1>(decode_info));
@@ -196,6 +470,25 @@ void JxrDecode::Decode(
     {
         ThrowJxrlibError("decoder::Copy failed", err);
     }
+
+    decoder_context.SetSucceeded();
+}
+
+/*static*/std::uint32_t JxrDecode::AdjustDownscaleFactor(std::uint32_t width, std::uint32_t height, std::uint32_t downscale_factor)
+{
+    // With a smaller bitmap, the codec would choose a different scale than the one we request (it determines the scale from
+    //  the size of the "thumbnail"), and the size of the result would not be what we report.
+    while (downscale_factor > 1 && (width <= downscale_factor / 2 || height <= downscale_factor / 2))
+    {
+        downscale_factor /= 2;
+    }
+
+    return downscale_factor;
+}
+
+/*static*/void JxrDecode::SetDecoderContextPoolEnabled(bool enabled)
+{
+    decoder_context_pool_enabled.store(enabled);
 }
 
 /*static*/std::tuple<JxrDecode::PixelFormat, std::uint32_t, std::uint32_t> JxrDecode::GetPixelFormatAndSize(const void* ptrData, size_t size)
@@ -279,6 +572,77 @@ void JxrDecode::Decode(
     return make_tuple(jxrpixel_format, width, height);
 }
 
+/*static*/bool JxrDecode::TryGetPixelFormatAndSize(const void* ptrData, size_t size, PixelFormat& pixel_format, std::uint32_t& width, std::uint32_t& height)
+{
+    if (ptrData == nullptr)
+    {
+        throw invalid_argument("ptrData");
+    }
+
+    if (size == 0)
+    {
+        throw invalid_argument("size");
+    }
+
+    BoundedMemoryStream bounded_stream(ptrData, size);
+
+    PKImageDecode* pDecoder = nullptr;
+    ERR err = PKCodecFactory_CreateDecoderFromStream(&bounded_stream.stream, &pDecoder);
+    if (Failed(err))
+    {
+        if (pDecoder != nullptr)
+        {
+            pDecoder->Release(&pDecoder);
+        }
+
+        if (bounded_stream.read_beyond_end)
+        {
+            // the prefix we were given was not sufficient
+            return false;
+        }
+
+        ThrowJxrlibError("'PKCodecFactory_CreateDecoderFromStream' failed", err);
+    }
+
+    std::unique_ptr<PKImageDecode, void(*)(PKImageDecode*)> upDecoder(pDecoder, [](PKImageDecode* p)->void {p->Release(&p); });
+
+    // parts of the header-parsing in jxrlib do not check for errors when reading from the stream, so we
+    //  have to check here whether all reads could be satisfied - otherwise, the result is not reliable
+    if (bounded_stream.read_beyond_end)
+    {
+        return false;
+    }
+
+    I32 jxr_width, jxr_height;
+    err = upDecoder->GetSize(upDecoder.get(), &jxr_width, &jxr_height);
+    if (Failed(err))
+    {
+        ThrowJxrlibError("'decoder::GetSize' failed", err);
+    }
+
+    PKPixelFormatGUID pixel_format_of_decoder;
+    err = upDecoder->GetPixelFormat(upDecoder.get(), &pixel_format_of_decoder);
+    if (Failed(err))
+    {
+        ThrowJxrlibError("'decoder::GetPixelFormat' failed", err);
+    }
+
+    const auto jxrpixel_format = JxrPixelFormatGuidToEnum(pixel_format_of_decoder);
+    if (jxrpixel_format == JxrDecode::PixelFormat::kInvalid)
+    {
+        ostringstream string_stream;
+        string_stream << "Unsupported pixel format: {";
+        WriteGuidToStream(string_stream, pixel_format_of_decoder);
+        string_stream << "}";
+        throw runtime_error(string_stream.str());
+    }
+
+    pixel_format = jxrpixel_format;
+    width = jxr_width;
+    height = jxr_height;
+    return true;
+}
+
 /*static*/JxrDecode::CompressedData JxrDecode::Encode(
                     JxrDecode::PixelFormat pixel_format,
                     std::uint32_t width,
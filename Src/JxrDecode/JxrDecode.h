@@ -78,6 +78,15 @@ public:
         CompressedData(void* obj_handle) :obj_handle_(obj_handle) {}
     };
 
+    /// This structure gives a rectangular region of a bitmap (in pixels).
+    struct Region
+    {
+        std::uint32_t x;        ///< The x-coordinate of the top-left corner.
+        std::uint32_t y;        ///< The y-coordinate of the top-left corner.
+        std::uint32_t width;    ///< The width of the region.
+        std::uint32_t height;   ///< The height of the region.
+    };
+
     /// Decodes the specified data, giving an uncompressed bitmap.
     /// The course of action is as follows:
     /// * The decoder will be initialized with the specified compressed data.  
@@ -93,16 +102,69 @@ public:
     /// * The 'get_destination_func' function may choose to throw an exception (if the memory cannot be allocated,  
     ///   or the reported characteristics are determined to be invalid, etc). 
     ///
+    /// If a downscale factor greater than one is given, then the bitmap is decoded with reduced resolution - the width and height
+    /// reported to 'get_destination_func' are then the size of the full-resolution bitmap divided by the downscale factor (rounded up).
+    /// In this case, only the subbands of the codec which are required for the reduced resolution are decoded (i.e. the highpass-subband
+    /// is skipped for a factor of 4 and more, and only the DC-subband is decoded for a factor of 16), and the flexbits are skipped, which
+    /// makes the operation considerably faster than decoding at full resolution. Note that the result is a low-pass filtered version of
+    /// the bitmap (and not a subsampled one).
+    ///
+    /// If a region is given, then only this part of the bitmap is decoded - the width and height reported to 'get_destination_func' are
+    /// then the size of the region (clipped to the bitmap). The codec then runs the inverse transform only for the macroblocks which
+    /// intersect with the region, and it stops decoding after the last macroblock row of the region.
+    ///
     /// \param  ptrData                 Information describing the pointer.
     /// \param  size                    The size.
     /// \param  get_destination_func    The get destination function.
+    /// \param  downscale_factor        The downscale factor, which must be one of 1, 2, 4, 8 or 16. If the bitmap is too small for the
+    ///                                 factor, then a smaller one is used (c.f. AdjustDownscaleFactor).
+    /// \param  region                  If non-null, the region of the bitmap to be decoded. It is given in pixels of the bitmap with reduced
+    ///                                 resolution (i.e. after applying the downscale factor), it must not be empty and it must intersect
+    ///                                 with the bitmap.
     static void Decode(
             const void* ptrData,
             size_t size,
-            const std::function<std::tuple<void*/*destination_bitmap*/, std::uint32_t/*stride*/>(PixelFormat pixel_format, std::uint32_t  width, std::uint32_t  height)>& get_destination_func);
+            const std::function<std::tuple<void*/*destination_bitmap*/, std::uint32_t/*stride*/>(PixelFormat pixel_format, std::uint32_t  width, std::uint32_t  height)>& get_destination_func,
+            std::uint32_t downscale_factor = 1,
+            const Region* region = nullptr);
+
+    /// Gets the downscale factor which is actually used when decoding a bitmap of the specified size with the specified downscale
+    /// factor. The codec can only reduce the resolution by a factor which is less than twice the width and the height of the bitmap,
+    /// so the factor is halved until this condition is met.
+    ///
+    /// \param  width               The width of the bitmap (at full resolution).
+    /// \param  height              The height of the bitmap (at full resolution).
+    /// \param  downscale_factor    The requested downscale factor (one of 1, 2, 4, 8 or 16).
+    ///
+    /// \returns    The downscale factor which is used.
+    static std::uint32_t AdjustDownscaleFactor(std::uint32_t width, std::uint32_t height, std::uint32_t downscale_factor);
+
+    /// Enables or disables the reuse of decoder contexts. A decoder context comprises the objects which the codec needs for
+    /// decoding a bitmap (including the memory for its macroblock row buffers), and every thread keeps a small pool of them,
+    /// so that 'Decode' does not have to construct and destroy them for every bitmap. The pool is enabled by default - disabling
+    /// it is intended for diagnostic purposes (like benchmarking). Contexts which are in the pools of the threads when the pool is
+    /// disabled are kept, but they are not used.
+    ///
+    /// \param  enabled True to enable the reuse of decoder contexts; false to disable it.
+    static void SetDecoderContextPoolEnabled(bool enabled);
 
     static std::tuple< PixelFormat , std::uint32_t  , std::uint32_t  > GetPixelFormatAndSize(const void* ptrData, size_t size);
 
+    /// Attempts to determine the pixel format and the size of a JXR-compressed bitmap, where only a prefix of the
+    /// compressed data is given. Only the container and the image header are parsed, so typically a few hundred bytes
+    /// are sufficient. If the data given turns out to be too small (i.e. the parser attempted to read beyond the end
+    /// of the data), then false is returned - and the caller may try again with a larger prefix. Other errors (like
+    /// invalid data or an unsupported pixel format) are reported by throwing an exception.
+    ///
+    /// \param          ptrData         Pointer to the (beginning of the) compressed data.
+    /// \param          size            The size of the data given in bytes.
+    /// \param [out]    pixel_format    If successful, the pixel format is put here.
+    /// \param [out]    width           If successful, the width (in pixels) is put here.
+    /// \param [out]    height          If successful, the height (in pixels) is put here.
+    ///
+    /// \returns    True if it succeeds; false if the data given was not sufficient to parse the header.
+    static bool TryGetPixelFormatAndSize(const void* ptrData, size_t size, PixelFormat& pixel_format, std::uint32_t& width, std::uint32_t& height);
+
     /// Compresses the specified bitmap into the JXR (aka JPEG XR) format.
     /// 
     /// \param pixel_format     The pixel type.
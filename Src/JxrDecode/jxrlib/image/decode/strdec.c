@@ -3288,7 +3288,7 @@ Int ImageStrDecInit(
     }
     cb += i * cMacBlock;
 
-    pb = malloc(cb);
+    pb = pSCP->pfnAllocWorkingMemory != NULL ? pSCP->pfnAllocWorkingMemory(pSCP->pvWorkingMemoryContext, cb) : malloc(cb);
     if (pb == NULL)
         return WMP_errOutOfMemory;
     memset(pb, 0, cb);
@@ -3622,7 +3622,10 @@ Int ImageStrDecTerm(
     PERFTIMER_DELETE(pSC->m_fMeasurePerf, pSC->m_ptEncDecPerf);
     PERFTIMER_DELETE(pSC->m_fMeasurePerf, pSC->m_ptEndToEndPerf); */
 
-    free(pSC);
+    if (pSC->WMISCP.pfnFreeWorkingMemory != NULL)
+        pSC->WMISCP.pfnFreeWorkingMemory(pSC->WMISCP.pvWorkingMemoryContext, pSC);
+    else
+        free(pSC);
 
     return ICERR_OK;
 }
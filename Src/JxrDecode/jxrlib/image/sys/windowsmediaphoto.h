@@ -432,6 +432,13 @@ typedef struct tagCWMIStrCodecParam {
 
     // Perf measurement
     Bool fMeasurePerf;
+
+    // Optional allocator for the decoder's state (which includes the macroblock row buffers) - if set, ImageStrDecInit
+    // obtains the memory from it (instead of malloc), and ImageStrDecTerm hands the memory back to it (instead of free).
+    // This allows a caller to reuse the memory across images.
+    void* (*pfnAllocWorkingMemory)(void* pvContext, size_t cb);
+    void (*pfnFreeWorkingMemory)(void* pvContext, void* pv);
+    void* pvWorkingMemoryContext;
 } CWMIStrCodecParam;
 
 typedef struct tagCWMImageBufferInfo {
@@ -531,6 +531,7 @@ extern "C" {
 
     //----------------------------------------------------------------
     ERR PKImageDecode_Create_WMP(PKImageDecode** ppID);
+    ERR PKImageDecode_Reset_WMP(PKImageDecode* pID);
 
     ERR PKImageDecode_Initialize(PKImageDecode* pID, struct tagWMPStream* pStream);
     ERR PKImageDecode_GetPixelFormat(PKImageDecode* pID, PKPixelFormatGUID* pPF);
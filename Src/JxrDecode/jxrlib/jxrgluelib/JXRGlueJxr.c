@@ -27,6 +27,7 @@
 //
 //*@@@---@@@@******************************************************************
 #include <limits.h>
+#include <stddef.h>
 #include <wchar.h>
 #include "JXRGlue.h"
 
@@ -2228,17 +2229,8 @@ ERR PKImageDecode_GetDescriptiveMetadata_WMP(PKImageDecode* pID, DESCRIPTIVEMETA
 }
 
 
-ERR PKImageDecode_Release_WMP(PKImageDecode** ppID)
+static Void FreeDescMetadataOfDecoder(PKImageDecode* pID)
 {
-    ERR             err = WMP_errSuccess;
-    PKImageDecode* pID;
-
-    if (NULL == ppID)
-        goto Cleanup;
-
-    pID = *ppID;
-
-    // Free descriptive metadata
     FreeDescMetadata(&pID->WMP.sDescMetadata.pvarImageDescription);
     FreeDescMetadata(&pID->WMP.sDescMetadata.pvarCameraMake);
     FreeDescMetadata(&pID->WMP.sDescMetadata.pvarCameraModel);
@@ -2253,6 +2245,20 @@ ERR PKImageDecode_Release_WMP(PKImageDecode** ppID)
     FreeDescMetadata(&pID->WMP.sDescMetadata.pvarPageName);
     FreeDescMetadata(&pID->WMP.sDescMetadata.pvarPageNumber);
     FreeDescMetadata(&pID->WMP.sDescMetadata.pvarHostComputer);
+}
+
+ERR PKImageDecode_Release_WMP(PKImageDecode** ppID)
+{
+    ERR             err = WMP_errSuccess;
+    PKImageDecode* pID;
+
+    if (NULL == ppID)
+        goto Cleanup;
+
+    pID = *ppID;
+
+    // Free descriptive metadata
+    FreeDescMetadataOfDecoder(pID);
 
     // Release base class
     Call(PKImageDecode_Release(ppID));
@@ -2261,6 +2267,15 @@ Cleanup:
     return err;
 }
 
+ERR PKImageDecode_Reset_WMP(PKImageDecode* pID)
+{
+    // Free descriptive metadata, and then put the object into the state it had after construction (i.e. all
+    //  members following the methods are zero) - so it can be initialized with another stream.
+    FreeDescMetadataOfDecoder(pID);
+    memset(&pID->pStream, 0, sizeof(*pID) - offsetof(PKImageDecode, pStream));
+    return WMP_errSuccess;
+}
+
 
 
 ERR PKImageDecode_Create_WMP(PKImageDecode** ppID)
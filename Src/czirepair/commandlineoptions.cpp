@@ -41,8 +41,9 @@ CommandLineOptions::ParseResult CommandLineOptions::CommandLineOptions::Parse(in
     // specify the string-to-enum-mapping for "command"
     std::map<string, Command> map_string_to_command
     {
-        { "DryRun", Command::DryRun },
-        { "Patch",  Command::Patch },
+        { "DryRun",   Command::DryRun },
+        { "Patch",    Command::Patch },
+        { "Rollback", Command::Rollback },
     };
 
     const static VerbosityValidator verbosity_validator;
@@ -53,6 +54,10 @@ CommandLineOptions::ParseResult CommandLineOptions::CommandLineOptions::Parse(in
     "This tool will check if the width/height specified at CZI-format level for\n"
     "a sub-block matches the actual size of the JPGXR-compressed bitmap data.\n"
     "In case of a discrepancy, it will patch the width/height in the CZI.\n"
+    "All modifications are recorded in a journal file next to the CZI\n"
+    "(named <CZIFILE>.czirepair-journal). An interrupted 'Patch' operation\n"
+    "is resumed from this journal, and 'Rollback' restores the original\n"
+    "content of the CZI from it.\n"
     "IMPORTANT: This tool is provided \"as is\" and use of this tool carries\n"
     "inherent risk. Creating a backup is highly recommended. Success and\n"
     "accuracy of results cannot be guaranteed.\n");
@@ -60,11 +65,13 @@ CommandLineOptions::ParseResult CommandLineOptions::CommandLineOptions::Parse(in
     Command argument_command;
     string argument_source_filename;
     string argument_verbosity;
+    int argument_number_of_threads;
 
     cli_app.add_option("-c,--command", argument_command,
-        "Can be one of 'DryRun' or 'Patch' - only with\n'"
-        "Patch' the CZI-file is modified. Default is\n"
-        "'DryRun'.")
+        "Can be one of 'DryRun', 'Patch' or 'Rollback' -\n"
+        "only with 'Patch' or 'Rollback' the CZI-file is\n"
+        "modified. 'Rollback' undoes the patches recorded\n"
+        "in the repair journal. Default is 'DryRun'.")
         ->default_val(Command::DryRun)
         ->option_text("COMMAND")
         ->transform(CLI::CheckedTransformer(map_string_to_command, CLI::ignore_case));
@@ -80,6 +87,13 @@ CommandLineOptions::ParseResult CommandLineOptions::CommandLineOptions::Parse(in
         "Specifies the CZI-file to operate on.")
         ->option_text("CZIFILE");
 
+    cli_app.add_option("-t,--threads", argument_number_of_threads,
+        "Specifies the number of threads to use for\n"
+        "scanning the sub-blocks. Default is 1.")
+        ->default_val(1)
+        ->option_text("NUMBER")
+        ->check(CLI::Range(1, 256));
+
     try
     {
         cli_app.parse(argc, argv);
@@ -106,6 +120,7 @@ CommandLineOptions::ParseResult CommandLineOptions::CommandLineOptions::Parse(in
     }
 
     this->command_ = argument_command;
+    this->number_of_threads_ = argument_number_of_threads;
 
     return ParseResult::OK;
 }
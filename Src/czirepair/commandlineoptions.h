@@ -14,6 +14,8 @@ enum class Command
     DryRun, ///< An enum constant representing the "dry run" option - i.e. just determine what would be done.
 
     Patch,  ///< An enum constant representing the "patch option" - i.e. actually patch the file if necessary.
+
+    Rollback,   ///< An enum constant representing the "rollback" option - i.e. undo the patches recorded in the repair journal.
 };
 
 enum class Verbosity
@@ -41,6 +43,7 @@ private:
     std::wstring czi_filename_;
     Command command_{ Command::Invalid };
     Verbosity verbosity_{ Verbosity::Normal };
+    int number_of_threads_{ 1 };
 
 public:
     ParseResult Parse(int argc, char** argv);
@@ -48,6 +51,7 @@ public:
     const std::wstring& GetCZIFilename() const { return this->czi_filename_; }
     Command GetCommand() const { return this->command_; }
     Verbosity GetVerbosity() const { return this->verbosity_; }
+    int GetNumberOfThreads() const { return this->number_of_threads_; }
 
     bool IsVerbosityGreaterOrEqual(Verbosity verbosity) const;
 
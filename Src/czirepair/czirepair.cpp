@@ -9,6 +9,7 @@
 #include <functional>
 
 #include "repairutilities.h"
+#include "repairjournal.h"
 #include "utilities.h"
 
 #include "../libCZI/libCZI.h"
@@ -55,7 +56,9 @@ namespace
         }
 
         vector<RepairUtilities::SubBlockDimensionInfoRepairInfo> repair_info = RepairUtilities::GetRepairInfo(
+            stream.get(),
             reader.get(),
+            options.GetNumberOfThreads(),
             progress_reporter_functor);
         progress_reporter.ClearLine();
 
@@ -86,9 +89,36 @@ namespace
 
     void Patch(const CommandLineOptions& options)
     {
-        vector<RepairUtilities::SubBlockDimensionInfoRepairInfo> repair_info;
+        const wstring journal_filename = RepairJournal::GetJournalFilename(options.GetCZIFilename());
+        unique_ptr<RepairJournal> journal;
 
+        if (Utilities::FileExists(journal_filename))
         {
+            // there is a journal from a previous run - we resume from it (without scanning the file again)
+            journal = RepairJournal::Open(journal_filename);
+
+            const shared_ptr<IStream> stream = libCZI::CreateStreamFromFile(options.GetCZIFilename().c_str());
+            if (RepairUtilities::GetFileGuid(stream.get()) != journal->GetFileGuid())
+            {
+                throw runtime_error("The repair journal \"" + Utilities::convertToUtf8(journal_filename) + "\" does not belong to this CZI-file.");
+            }
+
+            if (journal->IsRollbackStarted())
+            {
+                throw runtime_error("According to the repair journal, a rollback was started but did not complete - run the 'Rollback' command again in order to complete it.");
+            }
+
+            if (journal->IsCompleted())
+            {
+                cout << "According to the repair journal, the file has already been patched." << std::endl;
+                return;
+            }
+
+            cout << "Resuming from the repair journal, " << journal->GetPlan().size() << " sub-block(s) are to be patched." << std::endl;
+        }
+        else
+        {
+            vector<RepairUtilities::SubBlockDimensionInfoRepairInfo> repair_info;
             const shared_ptr<IStream> stream = libCZI::CreateStreamFromFile(options.GetCZIFilename().c_str());
             const auto reader = libCZI::CreateCZIReader();
             reader->Open(stream);
@@ -100,44 +130,97 @@ namespace
                 progress_reporter_functor = std::ref(progress_reporter);
             }
 
-            repair_info = RepairUtilities::GetRepairInfo(reader.get(), progress_reporter_functor);
+            repair_info = RepairUtilities::GetRepairInfo(stream.get(), reader.get(), options.GetNumberOfThreads(), progress_reporter_functor);
             progress_reporter.ClearLine();
 
             if (repair_info.empty())
             {
                 cout << "No repair needed." << endl;
+                return;
             }
-            else
-            {
-                cout << "Found discrepancies with " << repair_info.size() << " sub-block(s)." << std::endl;
 
-                if (options.IsVerbosityGreaterOrEqual(Verbosity::Verbose))
+            cout << "Found discrepancies with " << repair_info.size() << " sub-block(s)." << std::endl;
+
+            if (options.IsVerbosityGreaterOrEqual(Verbosity::Verbose))
+            {
+                for (const auto& info : repair_info)
                 {
-                    for (const auto& info : repair_info)
-                    {
-                        SubBlockInfo sub_block_info;
-                        reader->TryGetSubBlockInfo(info.sub_block_index, &sub_block_info);
-                        cout << "SubBlockIndex: " << info.sub_block_index << " -> size in 'dimension_info': " <<
-                            sub_block_info.physicalSize.w << "x" << sub_block_info.physicalSize.h << ", JPGXR: " <<
-                            (info.IsFixedSizeXValid() ? info.fixed_size_x : sub_block_info.physicalSize.w) << "x" <<
-                            (info.IsFixedSizeYValid() ? info.fixed_size_y : sub_block_info.physicalSize.h) << std::endl;
-                    }
-
-                    cout << std::endl;
+                    SubBlockInfo sub_block_info;
+                    reader->TryGetSubBlockInfo(info.sub_block_index, &sub_block_info);
+                    cout << "SubBlockIndex: " << info.sub_block_index << " -> size in 'dimension_info': " <<
+                        sub_block_info.physicalSize.w << "x" << sub_block_info.physicalSize.h << ", JPGXR: " <<
+                        (info.IsFixedSizeXValid() ? info.fixed_size_x : sub_block_info.physicalSize.w) << "x" <<
+                        (info.IsFixedSizeYValid() ? info.fixed_size_y : sub_block_info.physicalSize.h) << std::endl;
                 }
+
+                cout << std::endl;
             }
+
+            journal = RepairJournal::Create(journal_filename, reader->GetFileHeaderInfo().fileGuid, repair_info);
         }
 
         cout << "Now opening the file in read-write-mode and will patch the file." << std::endl;
-        shared_ptr<IInputOutputStream> input_output_stream = libCZI::CreateInputOutputStreamForFile(options.GetCZIFilename().c_str());
+        const auto input_output_stream = make_shared<JournalingInputOutputStream>(
+            libCZI::CreateInputOutputStreamForFile(options.GetCZIFilename().c_str()),
+            journal.get());
+
+        RepairUtilities::ApplyRepairInfo(input_output_stream.get(), journal->GetPlan());
+
+        // the patches must be persisted before the journal records that the operation is complete
+        Utilities::FlushFileToStorage(options.GetCZIFilename());
+        journal->AppendCompleted();
+        cout << "Patched the subblock-directory and the subblocks." << std::endl;
+        cout << "The repair journal is \"" << Utilities::convertToUtf8(journal_filename) << "\" - it can be used to undo the patches with the 'Rollback' command." << std::endl;
+    }
+
+    void Rollback(const CommandLineOptions& options)
+    {
+        const wstring journal_filename = RepairJournal::GetJournalFilename(options.GetCZIFilename());
+        if (!Utilities::FileExists(journal_filename))
+        {
+            throw runtime_error("No repair journal found (expected to find \"" + Utilities::convertToUtf8(journal_filename) + "\").");
+        }
 
-        RepairUtilities::PatchSubBlockDimensionInfoInSubBlockDirectory(input_output_stream.get(), repair_info);
-        cout << "Patched the subblock-directory." << std::endl;
+        unique_ptr<RepairJournal> journal = RepairJournal::Open(journal_filename);
 
-        RepairUtilities::PatchSubBlocks(input_output_stream.get(), repair_info);
-        cout << "Patched the subblocks." << std::endl;
+        {
+            const shared_ptr<IInputOutputStream> input_output_stream = libCZI::CreateInputOutputStreamForFile(options.GetCZIFilename().c_str());
+            if (RepairUtilities::GetFileGuid(input_output_stream.get()) != journal->GetFileGuid())
+            {
+                throw runtime_error("The repair journal \"" + Utilities::convertToUtf8(journal_filename) + "\" does not belong to this CZI-file.");
+            }
+
+            // record that the rollback has started before any original content is restored - if the rollback is interrupted,
+            //  the file is then neither regarded as patched, nor can the patch operation be resumed (only the rollback)
+            if (!journal->IsRollbackStarted())
+            {
+                journal->AppendRollbackStarted();
+            }
 
-        input_output_stream.reset();
+            // restore the original content - in reverse order, so that for a location which was written multiple
+            //  times, the content before the first write is restored
+            const auto& write_records = journal->GetWriteRecords();
+            for (auto it = write_records.crbegin(); it != write_records.crend(); ++it)
+            {
+                uint64_t bytes_written;
+                input_output_stream->Write(it->offset, it->original_data.data(), it->original_data.size(), &bytes_written);
+                if (bytes_written != it->original_data.size())
+                {
+                    throw runtime_error("Error writing to the CZI-file.");
+                }
+            }
+
+            cout << "Restored the original content at " << write_records.size() << " location(s)." << std::endl;
+        }
+
+        // the original content must be persisted before the journal is deleted
+        Utilities::FlushFileToStorage(options.GetCZIFilename());
+
+        journal.reset();
+        if (!Utilities::RemoveFile(journal_filename))
+        {
+            throw runtime_error("Could not delete the repair journal \"" + Utilities::convertToUtf8(journal_filename) + "\".");
+        }
     }
 
     int DoOperationAndHandleException(const CommandLineOptions& options, const function<void(const CommandLineOptions&)> operation)
@@ -186,6 +269,9 @@ int main(int argc, char** argv)
         case Command::Patch:
             command_text = "Patch";
             break;
+        case Command::Rollback:
+            command_text = "Rollback";
+            break;
         default:
             command_text = "Invalid";
             break;
@@ -204,6 +290,10 @@ int main(int argc, char** argv)
     {
         return_code = DoOperationAndHandleException(options, Patch);
     }
+    else if (options.GetCommand() == Command::Rollback)
+    {
+        return_code = DoOperationAndHandleException(options, Rollback);
+    }
 
     return return_code;
 }
@@ -0,0 +1,388 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "repairjournal.h"
+
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+using namespace libCZI;
+
+namespace
+{
+    // all integers in the journal are stored in little-endian byte order
+
+    void AppendUint8(vector<uint8_t>& buffer, uint8_t value)
+    {
+        buffer.push_back(value);
+    }
+
+    void AppendUint16(vector<uint8_t>& buffer, uint16_t value)
+    {
+        buffer.push_back(static_cast<uint8_t>(value));
+        buffer.push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    void AppendUint32(vector<uint8_t>& buffer, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            buffer.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void AppendUint64(vector<uint8_t>& buffer, uint64_t value)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            buffer.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void AppendBytes(vector<uint8_t>& buffer, const void* data, size_t size)
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        buffer.insert(buffer.end(), p, p + size);
+    }
+
+    void AppendGuid(vector<uint8_t>& buffer, const GUID& guid)
+    {
+        AppendUint32(buffer, guid.Data1);
+        AppendUint16(buffer, guid.Data2);
+        AppendUint16(buffer, guid.Data3);
+        AppendBytes(buffer, guid.Data4, sizeof(guid.Data4));
+    }
+
+    uint16_t GetUint16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    uint32_t GetUint32(const uint8_t* p)
+    {
+        uint32_t value = 0;
+        for (int i = 3; i >= 0; --i)
+        {
+            value = (value << 8) | p[i];
+        }
+
+        return value;
+    }
+
+    uint64_t GetUint64(const uint8_t* p)
+    {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i)
+        {
+            value = (value << 8) | p[i];
+        }
+
+        return value;
+    }
+
+    GUID GetGuid(const uint8_t* p)
+    {
+        GUID guid;
+        guid.Data1 = GetUint32(p);
+        guid.Data2 = GetUint16(p + 4);
+        guid.Data3 = GetUint16(p + 6);
+        memcpy(guid.Data4, p + 8, sizeof(guid.Data4));
+        return guid;
+    }
+}
+
+/*static*/const char RepairJournal::kMagic[8] = { 'C', 'Z', 'I', 'R', 'J', 'N', 'L', '\0' };
+
+/*static*/std::wstring RepairJournal::GetJournalFilename(const std::wstring& czi_filename)
+{
+    return czi_filename + L".czirepair-journal";
+}
+
+/*static*/std::unique_ptr<RepairJournal> RepairJournal::Create(const std::wstring& filename, const libCZI::GUID& file_guid, const std::vector<RepairUtilities::SubBlockDimensionInfoRepairInfo>& plan)
+{
+    unique_ptr<RepairJournal> journal(new RepairJournal());
+    journal->file_ = DurableFile::CreateNew(filename);
+    journal->file_guid_ = file_guid;
+    journal->plan_ = plan;
+
+    vector<uint8_t> header;
+    AppendBytes(header, RepairJournal::kMagic, sizeof(RepairJournal::kMagic));
+    AppendUint32(header, RepairJournal::kVersion);
+    AppendGuid(header, file_guid);
+    journal->WriteToFileAndFlush(0, header.data(), header.size());
+    journal->end_of_journal_ = header.size();
+
+    vector<uint8_t> payload;
+    AppendUint32(payload, static_cast<uint32_t>(plan.size()));
+    for (const auto& repair_info : plan)
+    {
+        AppendUint32(payload, static_cast<uint32_t>(repair_info.sub_block_index));
+        AppendUint32(payload, repair_info.fixed_size_x);
+        AppendUint32(payload, repair_info.fixed_size_y);
+    }
+
+    journal->AppendRecord(RecordType::Plan, payload);
+    return journal;
+}
+
+/*static*/std::unique_ptr<RepairJournal> RepairJournal::Open(const std::wstring& filename)
+{
+    auto file = DurableFile::OpenExisting(filename);
+
+    // read the complete journal into memory
+    vector<uint8_t> data;
+    const size_t kChunkSize = 64 * 1024;
+    for (;;)
+    {
+        const size_t size_so_far = data.size();
+        data.resize(size_so_far + kChunkSize);
+        const uint64_t bytes_read = file->Read(size_so_far, data.data() + size_so_far, kChunkSize);
+        data.resize(size_so_far + static_cast<size_t>(bytes_read));
+        if (bytes_read < kChunkSize)
+        {
+            break;
+        }
+    }
+
+    unique_ptr<RepairJournal> journal(new RepairJournal());
+    journal->Parse(data);
+    journal->file_ = move(file);
+    return journal;
+}
+
+void RepairJournal::AppendWrite(std::uint64_t offset, const void* original_data, const void* new_data, std::uint32_t size)
+{
+    vector<uint8_t> payload;
+    payload.reserve(8 + 4 + 2 * static_cast<size_t>(size));
+    AppendUint64(payload, offset);
+    AppendUint32(payload, size);
+    AppendBytes(payload, original_data, size);
+    AppendBytes(payload, new_data, size);
+    this->AppendRecord(RecordType::Write, payload);
+
+    WriteRecord write_record;
+    write_record.offset = offset;
+    write_record.original_data.assign(static_cast<const uint8_t*>(original_data), static_cast<const uint8_t*>(original_data) + size);
+    write_record.new_data.assign(static_cast<const uint8_t*>(new_data), static_cast<const uint8_t*>(new_data) + size);
+    this->write_records_.push_back(move(write_record));
+}
+
+void RepairJournal::AppendCompleted()
+{
+    this->AppendRecord(RecordType::Completed, vector<uint8_t>());
+    this->completed_ = true;
+}
+
+void RepairJournal::AppendRollbackStarted()
+{
+    this->AppendRecord(RecordType::RollbackStarted, vector<uint8_t>());
+    this->rollback_started_ = true;
+}
+
+void RepairJournal::AppendRecord(RecordType type, const std::vector<std::uint8_t>& payload)
+{
+    vector<uint8_t> record;
+    record.reserve(RepairJournal::kRecordOverhead + payload.size());
+    AppendUint8(record, static_cast<uint8_t>(type));
+    AppendUint32(record, static_cast<uint32_t>(payload.size()));
+    AppendBytes(record, payload.data(), payload.size());
+    AppendUint32(record, RepairJournal::CalculateChecksum(record.data(), record.size()));
+
+    // Note: the record is flushed to the storage device before we return, so it is persisted before the operation it
+    //  describes is executed - even if the system crashes afterwards.
+    this->WriteToFileAndFlush(this->end_of_journal_, record.data(), record.size());
+    this->end_of_journal_ += record.size();
+}
+
+void RepairJournal::WriteToFileAndFlush(std::uint64_t offset, const void* data, std::uint64_t size)
+{
+    this->file_->Write(offset, data, size);
+    this->file_->Flush();
+}
+
+void RepairJournal::Parse(const std::vector<std::uint8_t>& data)
+{
+    if (data.size() < RepairJournal::kHeaderSize ||
+        memcmp(data.data(), RepairJournal::kMagic, sizeof(RepairJournal::kMagic)) != 0)
+    {
+        throw runtime_error("The file is not a valid repair journal.");
+    }
+
+    const uint32_t version = GetUint32(data.data() + sizeof(RepairJournal::kMagic));
+    if (version != RepairJournal::kVersion)
+    {
+        ostringstream string_stream;
+        string_stream << "The version of the repair journal (" << version << ") is not supported.";
+        throw runtime_error(string_stream.str());
+    }
+
+    this->file_guid_ = GetGuid(data.data() + sizeof(RepairJournal::kMagic) + 4);
+
+    // now go through the records - we stop at the first record which is incomplete or has an invalid checksum
+    size_t offset = RepairJournal::kHeaderSize;
+    bool plan_found = false;
+    for (;;)
+    {
+        if (data.size() - offset < RepairJournal::kRecordOverhead)
+        {
+            break;
+        }
+
+        const uint32_t payload_size = GetUint32(data.data() + offset + 1);
+        if (data.size() - offset - RepairJournal::kRecordOverhead < payload_size)
+        {
+            break;
+        }
+
+        const size_t size_without_checksum = 1 + 4 + static_cast<size_t>(payload_size);
+        if (GetUint32(data.data() + offset + size_without_checksum) != RepairJournal::CalculateChecksum(data.data() + offset, size_without_checksum))
+        {
+            break;
+        }
+
+        const RecordType record_type = static_cast<RecordType>(data[offset]);
+        if (!plan_found && record_type != RecordType::Plan)
+        {
+            throw runtime_error("The repair journal is corrupted (the first record must be the plan).");
+        }
+
+        if (!this->TryParseRecord(record_type, data.data() + offset + 1 + 4, payload_size))
+        {
+            throw runtime_error("The repair journal is corrupted (invalid record).");
+        }
+
+        plan_found = true;
+        offset += size_without_checksum + 4;
+    }
+
+    if (!plan_found)
+    {
+        throw runtime_error("The repair journal does not contain a plan - it may be deleted in order to start over.");
+    }
+
+    this->end_of_journal_ = offset;
+}
+
+bool RepairJournal::TryParseRecord(RecordType type, const std::uint8_t* payload, std::uint32_t payload_size)
+{
+    switch (type)
+    {
+    case RecordType::Plan:
+    {
+        if (payload_size < 4)
+        {
+            return false;
+        }
+
+        const uint32_t count = GetUint32(payload);
+        if ((payload_size - 4) / 12 != count || (payload_size - 4) % 12 != 0)
+        {
+            return false;
+        }
+
+        this->plan_.clear();
+        this->plan_.reserve(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            RepairUtilities::SubBlockDimensionInfoRepairInfo repair_info;
+            repair_info.sub_block_index = static_cast<int>(GetUint32(payload + 4 + i * 12));
+            repair_info.fixed_size_x = GetUint32(payload + 4 + i * 12 + 4);
+            repair_info.fixed_size_y = GetUint32(payload + 4 + i * 12 + 8);
+            this->plan_.push_back(repair_info);
+        }
+
+        return true;
+    }
+    case RecordType::Write:
+    {
+        if (payload_size < 8 + 4)
+        {
+            return false;
+        }
+
+        WriteRecord write_record;
+        write_record.offset = GetUint64(payload);
+        const uint32_t size = GetUint32(payload + 8);
+        if (payload_size != 8 + 4 + 2 * static_cast<uint64_t>(size))
+        {
+            return false;
+        }
+
+        write_record.original_data.assign(payload + 8 + 4, payload + 8 + 4 + size);
+        write_record.new_data.assign(payload + 8 + 4 + size, payload + 8 + 4 + 2 * static_cast<size_t>(size));
+        this->write_records_.push_back(move(write_record));
+        return true;
+    }
+    case RecordType::Completed:
+        this->completed_ = true;
+        return payload_size == 0;
+    case RecordType::RollbackStarted:
+        this->rollback_started_ = true;
+        return payload_size == 0;
+    }
+
+    return false;
+}
+
+/*static*/std::uint32_t RepairJournal::CalculateChecksum(const std::uint8_t* data, size_t size)
+{
+    // this is the FNV-1a hash (32-bit)
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+
+JournalingInputOutputStream::JournalingInputOutputStream(std::shared_ptr<libCZI::IInputOutputStream> stream, RepairJournal* journal)
+    : stream_(std::move(stream)), journal_(journal)
+{
+}
+
+/*virtual*/void JournalingInputOutputStream::Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead)
+{
+    this->stream_->Read(offset, pv, size, ptrBytesRead);
+}
+
+/*virtual*/void JournalingInputOutputStream::Write(std::uint64_t offset, const void* pv, std::uint64_t size, std::uint64_t* ptrBytesWritten)
+{
+    if (size > numeric_limits<uint32_t>::max())
+    {
+        throw invalid_argument("The size of a journaled write operation must not exceed 4GB.");
+    }
+
+    // read the original content (which is to be recorded in the journal)
+    vector<uint8_t> original_data(static_cast<size_t>(size));
+    uint64_t bytes_read;
+    this->stream_->Read(offset, original_data.data(), size, &bytes_read);
+    if (bytes_read != size)
+    {
+        ostringstream string_stream;
+        string_stream << "Could not read the original content at offset " << offset << " for the repair journal.";
+        throw runtime_error(string_stream.str());
+    }
+
+    if (memcmp(original_data.data(), pv, static_cast<size_t>(size)) == 0)
+    {
+        // the data is already present - this is the case when resuming an interrupted operation, nothing to do here
+        if (ptrBytesWritten != nullptr)
+        {
+            *ptrBytesWritten = size;
+        }
+
+        return;
+    }
+
+    this->journal_->AppendWrite(offset, original_data.data(), pv, static_cast<uint32_t>(size));
+    this->stream_->Write(offset, pv, size, ptrBytesWritten);
+}
@@ -0,0 +1,143 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "repairutilities.h"
+#include "utilities.h"
+#include "../libCZI/libCZI.h"
+
+/// This class implements the repair journal - an append-only binary file which is stored next to the CZI-file.
+/// It records the list of planned fixes (as determined by the scan), and for every write operation to the CZI-file
+/// it records the offset, the original bytes and the new bytes. The record for a write operation is added to the
+/// journal before the write to the CZI-file is executed. This allows to resume an interrupted patch-operation
+/// (without scanning the file again), and to undo the patches (by restoring the original bytes). Before the original bytes
+/// are restored, a record is added which marks that a rollback has started - so an interrupted rollback is detected (and
+/// the file is not regarded as patched anymore).
+///
+/// Every record is flushed to the storage device before the corresponding operation is executed, so that the journal
+/// is complete even if the system crashes (and not only if the process is terminated).
+///
+/// The journal is structured as follows: a header (containing a magic and the file-GUID of the CZI-file) is followed
+/// by a sequence of records. Each record consists of a type, the size of the payload, the payload and a checksum.
+/// A truncated or corrupted record at the end of the journal (e.g. due to the process being terminated while writing
+/// the record) is ignored, and subsequent records will overwrite it.
+class RepairJournal
+{
+public:
+    /// This structure gathers the information about a write operation to the CZI-file.
+    struct WriteRecord
+    {
+        std::uint64_t offset;                       ///< The offset in the CZI-file.
+        std::vector<std::uint8_t> original_data;    ///< The original content (before the write operation).
+        std::vector<std::uint8_t> new_data;         ///< The data written.
+    };
+
+private:
+    /// Values that represent the types of records in the journal.
+    enum class RecordType : std::uint8_t
+    {
+        Plan = 1,       ///< The list of planned fixes (as determined by the scan).
+        Write = 2,      ///< A write operation to the CZI-file (with the original and the new data).
+        Completed = 3,  ///< The patch operation completed successfully.
+        RollbackStarted = 4,    ///< A rollback (i.e. restoring the original content) has been started.
+    };
+
+    static const char kMagic[8];
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::uint64_t kHeaderSize = 8 + 4 + 16;
+    static constexpr std::uint64_t kRecordOverhead = 1 + 4 + 4;
+
+    std::unique_ptr<DurableFile> file_;
+    std::uint64_t end_of_journal_{ 0 };
+    libCZI::GUID file_guid_;
+    std::vector<RepairUtilities::SubBlockDimensionInfoRepairInfo> plan_;
+    std::vector<WriteRecord> write_records_;
+    bool completed_{ false };
+    bool rollback_started_{ false };
+
+public:
+    /// Gets the filename of the journal for the specified CZI-file.
+    ///
+    /// \param  czi_filename    Filename of the CZI-file.
+    ///
+    /// \returns    The filename of the journal.
+    static std::wstring GetJournalFilename(const std::wstring& czi_filename);
+
+    /// Creates a new journal file (which must not exist) and records the specified list of planned fixes.
+    ///
+    /// \param  filename    The filename of the journal.
+    /// \param  file_guid   The file-GUID of the CZI-file.
+    /// \param  plan        The list of planned fixes.
+    ///
+    /// \returns    The newly created journal.
+    static std::unique_ptr<RepairJournal> Create(const std::wstring& filename, const libCZI::GUID& file_guid, const std::vector<RepairUtilities::SubBlockDimensionInfoRepairInfo>& plan);
+
+    /// Opens an existing journal file. The content is read, and subsequent records are appended to it.
+    ///
+    /// \param  filename    The filename of the journal.
+    ///
+    /// \returns    The journal.
+    static std::unique_ptr<RepairJournal> Open(const std::wstring& filename);
+
+    const libCZI::GUID& GetFileGuid() const { return this->file_guid_; }
+    const std::vector<RepairUtilities::SubBlockDimensionInfoRepairInfo>& GetPlan() const { return this->plan_; }
+    const std::vector<WriteRecord>& GetWriteRecords() const { return this->write_records_; }
+
+    /// Query if the journal records that the patch operation completed.
+    ///
+    /// \returns    True if the patch operation completed; false otherwise.
+    bool IsCompleted() const { return this->completed_; }
+
+    /// Query if the journal records that a rollback has been started. In this case, the content of the CZI-file may be
+    /// partially restored, and the only valid operation is to (again) execute the rollback.
+    ///
+    /// \returns    True if a rollback has been started; false otherwise.
+    bool IsRollbackStarted() const { return this->rollback_started_; }
+
+    /// Appends a record for a write operation to the CZI-file.
+    ///
+    /// \param  offset          The offset in the CZI-file.
+    /// \param  original_data   The original content at this offset.
+    /// \param  new_data        The data which is to be written.
+    /// \param  size            The size of the data in bytes.
+    void AppendWrite(std::uint64_t offset, const void* original_data, const void* new_data, std::uint32_t size);
+
+    /// Appends a record that the patch operation completed successfully. Note that the writes to the CZI-file must
+    /// have been flushed to the storage device before (otherwise the journal might claim that the file is patched, while
+    /// the writes are lost).
+    void AppendCompleted();
+
+    /// Appends a record that a rollback has been started. This must be called before the original content is restored.
+    void AppendRollbackStarted();
+
+private:
+    RepairJournal() = default;
+
+    void AppendRecord(RecordType type, const std::vector<std::uint8_t>& payload);
+    void Parse(const std::vector<std::uint8_t>& data);
+    bool TryParseRecord(RecordType type, const std::uint8_t* payload, std::uint32_t payload_size);
+    void WriteToFileAndFlush(std::uint64_t offset, const void* data, std::uint64_t size);
+
+    static std::uint32_t CalculateChecksum(const std::uint8_t* data, size_t size);
+};
+
+/// An implementation of the IInputOutputStream-interface which records all write operations in the repair journal
+/// (before the write to the underlying stream is executed). A write operation where the data in the underlying stream
+/// is already identical to the data to be written is skipped, which is the case when resuming an interrupted operation.
+class JournalingInputOutputStream : public libCZI::IInputOutputStream
+{
+private:
+    std::shared_ptr<libCZI::IInputOutputStream> stream_;
+    RepairJournal* journal_;
+public:
+    JournalingInputOutputStream(std::shared_ptr<libCZI::IInputOutputStream> stream, RepairJournal* journal);
+
+    void Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead) override;
+    void Write(std::uint64_t offset, const void* pv, std::uint64_t size, std::uint64_t* ptrBytesWritten) override;
+};
@@ -4,141 +4,320 @@
 
 #include "repairutilities.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 #include "../libCZI/CziParse.h"
+#include "../JxrDecode/JxrDecode.h"
 
 using namespace std;
 using namespace libCZI;
 
-std::vector<RepairUtilities::SubBlockDimensionInfoRepairInfo> RepairUtilities::GetRepairInfo(libCZI::ICZIReader* reader, const std::function<void(const ProgressInfo&)>& progress_callback)
+std::vector<RepairUtilities::SubBlockDimensionInfoRepairInfo> RepairUtilities::GetRepairInfo(libCZI::IStream* stream, libCZI::ICZIReader* reader, int number_of_threads, const std::function<void(const ProgressInfo&)>& progress_callback)
 {
-    std::vector<SubBlockDimensionInfoRepairInfo> result;
+    if (number_of_threads < 1)
+    {
+        throw invalid_argument("number_of_threads must be greater than zero.");
+    }
 
-    const auto statistics = reader->GetStatistics();
-    ProgressInfo progress_info;
-    progress_info.total_sub_block_count = statistics.subBlockCount;
-    progress_info.current_sub_block_index = 0;
+    // First, gather all JPGXR-compressed sub-blocks - we are only interested in those. We then sort this list by file position,
+    //  so that the sub-blocks are processed in the order in which they are located in the file (which gives mostly sequential
+    //  reads, even if multiple threads are processing the list concurrently).
+    struct WorkItem
+    {
+        int sub_block_index;
+        std::uint64_t file_position;
+        libCZI::IntSize physical_size;
+    };
 
-    // go through all sub-blocks
-    reader->EnumerateSubBlocks(
-        [&](int index, const SubBlockInfo& subblock_info)->bool
+    std::vector<WorkItem> work_items;
+    reader->EnumerateSubBlocksEx(
+        [&](int index, const DirectorySubBlockInfo& subblock_info)->bool
         {
-            // we are only interested in JPGXR-compressed sub-blocks
             if (subblock_info.GetCompressionMode() == CompressionMode::JpgXr)
             {
-                // read the sub-block
-                const auto sub_block = reader->ReadSubBlock(index);
+                work_items.push_back(WorkItem{ index, subblock_info.filePosition, subblock_info.physicalSize });
+            }
 
-                // determine the width and height of the JPGXR-compressed bitmap
-                uint32_t width_from_jpgxr, height_from_jpgxr;
-                if (!sub_block->TryGetWidthAndHeightOfJpgxrCompressedBitmap(width_from_jpgxr, height_from_jpgxr))
-                {
-                    throw runtime_error("Failed to determine the width and height of the JPGXR-compressed bitmap.");
-                }
+            return true;
+        });
+
+    sort(
+        work_items.begin(),
+        work_items.end(),
+        [](const WorkItem& a, const WorkItem& b)->bool { return a.file_position < b.file_position; });
+
+    // this vector has an entry for each work item, it will be filled by the worker threads
+    std::vector<SubBlockDimensionInfoRepairInfo> repair_info_for_work_item(work_items.size());
+
+    ProgressInfo progress_info;
+    progress_info.total_sub_block_count = reader->GetStatistics().subBlockCount;
+    progress_info.current_sub_block_index = 0;
 
-                // Now, compare the width and height of the JPGXR-compressed bitmap with the width and height in the dimension-info.
-                // If they differ, we need to fix the dimension-info - add the sub-block to the list of sub-blocks that need to be fixed.
-                SubBlockDimensionInfoRepairInfo repair_info;
-                repair_info.sub_block_index = index;
-                if (subblock_info.physicalSize.w != width_from_jpgxr)
+    std::atomic<size_t> next_work_item_index{ 0 };
+    std::mutex progress_mutex;
+    std::exception_ptr first_exception;
+    std::atomic<bool> error_occurred{ false };
+
+    const auto worker = [&]()->void
+        {
+            for (;;)
+            {
+                const size_t work_item_index = next_work_item_index.fetch_add(1);
+                if (work_item_index >= work_items.size() || error_occurred.load())
                 {
-                    repair_info.fixed_size_x = width_from_jpgxr;
+                    break;
                 }
 
-                if (subblock_info.physicalSize.h != height_from_jpgxr)
+                const auto& work_item = work_items[work_item_index];
+
+                try
                 {
-                    repair_info.fixed_size_y = height_from_jpgxr;
-                }
+                    // determine the width and height of the JPGXR-compressed bitmap (only the header of the JPGXR-data is read here)
+                    uint32_t width_from_jpgxr, height_from_jpgxr;
+                    RepairUtilities::GetWidthAndHeightOfJpgxrCompressedBitmap(stream, work_item.file_position, width_from_jpgxr, height_from_jpgxr);
 
-                // If the width or height of the sub-block should be fixed, add the sub-block to the list of sub-blocks that need to be fixed.
-                if (repair_info.IsFixedSizeXValid() || repair_info.IsFixedSizeYValid())
+                    // Now, compare the width and height of the JPGXR-compressed bitmap with the width and height in the dimension-info.
+                    // If they differ, we need to fix the dimension-info.
+                    SubBlockDimensionInfoRepairInfo& repair_info = repair_info_for_work_item[work_item_index];
+                    repair_info.sub_block_index = work_item.sub_block_index;
+                    if (work_item.physical_size.w != width_from_jpgxr)
+                    {
+                        repair_info.fixed_size_x = width_from_jpgxr;
+                    }
+
+                    if (work_item.physical_size.h != height_from_jpgxr)
+                    {
+                        repair_info.fixed_size_y = height_from_jpgxr;
+                    }
+                }
+                catch (...)
                 {
-                    result.push_back(repair_info);
+                    lock_guard<mutex> lock(progress_mutex);
+                    if (!first_exception)
+                    {
+                        first_exception = current_exception();
+                    }
+
+                    error_occurred.store(true);
+                    break;
                 }
 
                 if (progress_callback)
                 {
+                    // the callback is called from different threads, but it is guaranteed to be called in a serialized manner
+                    //  and with an increasing "current_sub_block_index"
+                    lock_guard<mutex> lock(progress_mutex);
                     ++progress_info.current_sub_block_index;
                     progress_callback(progress_info);
                 }
             }
+        };
 
-            return true;
-        });
+    if (number_of_threads == 1 || work_items.size() < 2)
+    {
+        worker();
+    }
+    else
+    {
+        std::vector<std::thread> threads;
+        const size_t thread_count = min(static_cast<size_t>(number_of_threads), work_items.size());
+        threads.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    if (first_exception)
+    {
+        rethrow_exception(first_exception);
+    }
+
+    // Now gather the sub-blocks which need to be fixed - we report them in the order of the sub-block index, so that
+    //  the result is independent of the number of threads used.
+    std::vector<SubBlockDimensionInfoRepairInfo> result;
+    for (const auto& repair_info : repair_info_for_work_item)
+    {
+        if (repair_info.IsFixedSizeXValid() || repair_info.IsFixedSizeYValid())
+        {
+            result.push_back(repair_info);
+        }
+    }
+
+    sort(
+        result.begin(),
+        result.end(),
+        [](const SubBlockDimensionInfoRepairInfo& a, const SubBlockDimensionInfoRepairInfo& b)->bool { return a.sub_block_index < b.sub_block_index; });
 
     return result;
 }
 
-void RepairUtilities::PatchSubBlockDimensionInfoInSubBlockDirectory(libCZI::IInputOutputStream* io_stream, const std::vector<SubBlockDimensionInfoRepairInfo>& patch_list)
+/*static*/void RepairUtilities::GetWidthAndHeightOfJpgxrCompressedBitmap(libCZI::IStream* stream, std::uint64_t file_position, std::uint32_t& width, std::uint32_t& height)
+{
+    const auto location = CCZIParse::ReadSubBlockDataLocation(stream, file_position);
+    if (location.dataSize == 0)
+    {
+        throw runtime_error("Failed to determine the width and height of the JPGXR-compressed bitmap (sub-block contains no data).");
+    }
+
+    // We start with a small prefix of the data, which in all practical cases contains the complete JPGXR-header. Only
+    //  if this turns out to be insufficient, we try again with a larger prefix (up to the complete data).
+    std::uint64_t prefix_size = kInitialJpgxrHeaderProbeSize;
+    std::vector<uint8_t> buffer;
+    for (;;)
+    {
+        prefix_size = min(prefix_size, location.dataSize);
+        buffer.resize(static_cast<size_t>(prefix_size));
+        const auto bytes_read = CCZIParse::ReadSubBlockDataPrefix(stream, location, buffer.data(), prefix_size);
+
+        JxrDecode::PixelFormat pixel_format;
+        if (JxrDecode::TryGetPixelFormatAndSize(buffer.data(), static_cast<size_t>(bytes_read), pixel_format, width, height))
+        {
+            return;
+        }
+
+        if (prefix_size == location.dataSize)
+        {
+            throw runtime_error("Failed to determine the width and height of the JPGXR-compressed bitmap.");
+        }
+
+        prefix_size *= 4;
+    }
+}
+
+void RepairUtilities::ApplyRepairInfo(libCZI::IInputOutputStream* io_stream, const std::vector<SubBlockDimensionInfoRepairInfo>& patch_list)
 {
+    const RepairInfoLookup lookup(patch_list);
+
     CFileHeaderSegmentData file_header_segment_data = CCZIParse::ReadFileHeaderSegmentData(io_stream);
+    const std::uint64_t sub_block_directory_position = file_header_segment_data.GetSubBlockDirectoryPosition();
+
+    // Determine the file positions of the sub-blocks which are to be patched. The sub-block directory segment itself is
+    //  represented by an entry with "repair_info" being null.
+    struct PatchOperation
+    {
+        std::uint64_t file_position;
+        const SubBlockDimensionInfoRepairInfo* repair_info;
+    };
+
+    std::vector<PatchOperation> patch_operations;
+    patch_operations.reserve(patch_list.size() + 1);
+    patch_operations.push_back(PatchOperation{ sub_block_directory_position, nullptr });
 
-    CCZIParse::InplacePatchSubBlockDirectory(
+    CCZIParse::SubblockDirectoryParseOptions subblock_directory_parse_options;
+    subblock_directory_parse_options.SetLaxParsing();
+    int sub_block_index = 0;
+    CCZIParse::ReadSubBlockDirectory(
         io_stream,
-        file_header_segment_data.GetSubBlockDirectoryPosition(),
-        [&](int sub_block_index, char dimension_identifier, std::int32_t size, std::int32_t& new_coordinate)->bool
+        sub_block_directory_position,
+        [&](const CCziSubBlockDirectoryBase::SubBlkEntry& entry)->void
         {
-            if (dimension_identifier != 'X' && dimension_identifier != 'Y')
+            const SubBlockDimensionInfoRepairInfo* repair_info = lookup.Find(sub_block_index++);
+            if (repair_info != nullptr)
             {
-                return false;
+                patch_operations.push_back(PatchOperation{ static_cast<std::uint64_t>(entry.FilePosition), repair_info });
             }
+        },
+        subblock_directory_parse_options,
+        nullptr);
 
-            for (const auto& repair_info : patch_list)
-            {
-                if (repair_info.sub_block_index == sub_block_index)
-                {
-                    if (repair_info.IsFixedSizeXValid() && dimension_identifier == 'X')
-                    {
-                        new_coordinate = repair_info.fixed_size_x;
-                        return true;
-                    }
+    // now execute the patch operations in the order of their position in the file
+    sort(
+        patch_operations.begin(),
+        patch_operations.end(),
+        [](const PatchOperation& a, const PatchOperation& b)->bool { return a.file_position < b.file_position; });
 
-                    if (repair_info.IsFixedSizeYValid() && dimension_identifier == 'Y')
-                    {
-                        new_coordinate = repair_info.fixed_size_y;
-                        return true;
-                    }
-                }
-            }
+    for (const auto& patch_operation : patch_operations)
+    {
+        if (patch_operation.repair_info == nullptr)
+        {
+            CCZIParse::BulkInplacePatchSubBlockDirectory(
+                io_stream,
+                patch_operation.file_position,
+                [&](int sub_block_index, char dimension_identifier, std::int32_t size, std::int32_t& new_coordinate)->bool
+                {
+                    const SubBlockDimensionInfoRepairInfo* repair_info = lookup.Find(sub_block_index);
+                    return repair_info != nullptr && RepairUtilities::TryGetFixedSize(*repair_info, dimension_identifier, new_coordinate);
+                });
+        }
+        else
+        {
+            CCZIParse::InplacePatchSubblock(
+                io_stream,
+                patch_operation.file_position,
+                [&](char dimension_identifier, std::int32_t size, std::int32_t& new_coordinate)->bool
+                {
+                    return RepairUtilities::TryGetFixedSize(*patch_operation.repair_info, dimension_identifier, new_coordinate);
+                });
+        }
+    }
+}
 
-            return false;
-        });
+/*static*/libCZI::GUID RepairUtilities::GetFileGuid(libCZI::IStream* stream)
+{
+    return CCZIParse::ReadFileHeaderSegmentData(stream).GetFileGuid();
 }
 
-void RepairUtilities::PatchSubBlocks(libCZI::IInputOutputStream* io_stream, const std::vector<SubBlockDimensionInfoRepairInfo>& patch_list)
+/*static*/bool RepairUtilities::TryGetFixedSize(const SubBlockDimensionInfoRepairInfo& repair_info, char dimension_identifier, std::int32_t& new_size)
 {
-    CFileHeaderSegmentData file_header_segment_data = CCZIParse::ReadFileHeaderSegmentData(io_stream);
-    CCZIParse::SubblockDirectoryParseOptions subblock_directory_parse_options;
-    subblock_directory_parse_options.SetLaxParsing();
-    auto sub_block_directory = CCZIParse::ReadSubBlockDirectory(io_stream, file_header_segment_data.GetSubBlockDirectoryPosition(), subblock_directory_parse_options);
+    if (repair_info.IsFixedSizeXValid() && dimension_identifier == 'X')
+    {
+        new_size = repair_info.fixed_size_x;
+        return true;
+    }
+
+    if (repair_info.IsFixedSizeYValid() && dimension_identifier == 'Y')
+    {
+        new_size = repair_info.fixed_size_y;
+        return true;
+    }
 
+    return false;
+}
+
+RepairUtilities::RepairInfoLookup::RepairInfoLookup(const std::vector<SubBlockDimensionInfoRepairInfo>& patch_list)
+    : patch_list_(patch_list)
+{
+    int max_sub_block_index = -1;
     for (const auto& repair_info : patch_list)
     {
-        CCziSubBlockDirectoryBase::SubBlkEntry sub_block_entry;
-        sub_block_directory.TryGetSubBlock(repair_info.sub_block_index, sub_block_entry);
+        if (repair_info.sub_block_index < 0)
+        {
+            throw invalid_argument("Invalid sub-block index in patch list.");
+        }
 
-        CCZIParse::InplacePatchSubblock(
-                io_stream,
-                sub_block_entry.FilePosition,
-                [&](char dimension_identifier, std::int32_t size, std::int32_t& new_coordinate)->bool
-                {
-                    if (dimension_identifier != 'X' && dimension_identifier != 'Y')
-                    {
-                        return false;
-                    }
+        max_sub_block_index = max(max_sub_block_index, repair_info.sub_block_index);
+    }
 
-                    if (repair_info.IsFixedSizeXValid() && dimension_identifier == 'X')
-                    {
-                        new_coordinate = repair_info.fixed_size_x;
-                        return true;
-                    }
+    this->index_in_patch_list_.assign(static_cast<size_t>(max_sub_block_index + 1), -1);
+    for (size_t i = 0; i < patch_list.size(); ++i)
+    {
+        int& index_in_patch_list = this->index_in_patch_list_[patch_list[i].sub_block_index];
+        if (index_in_patch_list >= 0)
+        {
+            throw invalid_argument("Duplicate sub-block index in patch list.");
+        }
 
-                    if (repair_info.IsFixedSizeYValid() && dimension_identifier == 'Y')
-                    {
-                        new_coordinate = repair_info.fixed_size_y;
-                        return true;
-                    }
+        index_in_patch_list = static_cast<int>(i);
+    }
+}
 
-                    return false;
-                });
+const RepairUtilities::SubBlockDimensionInfoRepairInfo* RepairUtilities::RepairInfoLookup::Find(int sub_block_index) const
+{
+    if (sub_block_index < 0 || static_cast<size_t>(sub_block_index) >= this->index_in_patch_list_.size())
+    {
+        return nullptr;
     }
+
+    const int index_in_patch_list = this->index_in_patch_list_[sub_block_index];
+    return index_in_patch_list >= 0 ? &this->patch_list_[index_in_patch_list] : nullptr;
 }
@@ -37,8 +37,59 @@ public:
         int total_sub_block_count{ -1 };
     };
 
-    static std::vector<SubBlockDimensionInfoRepairInfo> GetRepairInfo(libCZI::ICZIReader* reader, const std::function<void(const ProgressInfo&)>& progress_callback);
+    /// Determine the sub-blocks for which the width/height given in the dimension-info does not match the actual size
+    /// of the JPGXR-compressed bitmap. Only the sub-block-header and the header of the JPGXR-data are read from the
+    /// stream, the bulk of the sub-block-data is not touched.
+    ///
+    /// The JPGXR-compressed sub-blocks are processed in the order of their position in the file. If more than one
+    /// thread is used, the sub-blocks are distributed over the threads - the stream must then allow for concurrent reads.
+    /// The result does not depend on the number of threads.
+    ///
+    /// \param [in] stream              The stream (containing the CZI-document) to read from.
+    /// \param [in] reader              The reader object (which must be operating on the same stream).
+    /// \param      number_of_threads   The number of threads to use (must be greater than zero).
+    /// \param      progress_callback   If non-null, this function is called after each JPGXR-compressed sub-block has been processed.
+    ///                                 Calls are serialized, but may occur on different threads.
+    ///
+    /// \returns    The list of sub-blocks (and the fixes to be applied to them), sorted by sub-block index.
+    static std::vector<SubBlockDimensionInfoRepairInfo> GetRepairInfo(libCZI::IStream* stream, libCZI::ICZIReader* reader, int number_of_threads, const std::function<void(const ProgressInfo&)>& progress_callback);
 
-    static void PatchSubBlockDimensionInfoInSubBlockDirectory(libCZI::IInputOutputStream* io_stream, const std::vector<SubBlockDimensionInfoRepairInfo>& patch_list);
-    static void PatchSubBlocks(libCZI::IInputOutputStream* io_stream, const std::vector<SubBlockDimensionInfoRepairInfo>& patch_list);
+    /// Apply the specified fixes to the CZI-document - i.e. the dimension-info in the sub-block directory and in
+    /// the sub-block segments are patched. All patch operations (i.e. the sub-block directory and the sub-blocks)
+    /// are executed in a single pass, in the order of their position in the file.
+    ///
+    /// \param [in] io_stream   The stream (containing the CZI-document) to operate on.
+    /// \param      patch_list  The list of fixes to apply (as determined by GetRepairInfo). Each sub-block index must occur at most once.
+    static void ApplyRepairInfo(libCZI::IInputOutputStream* io_stream, const std::vector<SubBlockDimensionInfoRepairInfo>& patch_list);
+    /// Reads the file-GUID from the file header of the specified CZI-document.
+    ///
+    /// \param [in] stream  The stream (containing the CZI-document) to read from.
+    ///
+    /// \returns    The file-GUID.
+    static libCZI::GUID GetFileGuid(libCZI::IStream* stream);
+private:
+    /// This class allows to find the repair-info for a given sub-block index in constant time. It uses a dense table
+    /// (indexed by the sub-block index) which gives the index into the patch list.
+    class RepairInfoLookup
+    {
+    private:
+        const std::vector<SubBlockDimensionInfoRepairInfo>& patch_list_;
+        std::vector<int> index_in_patch_list_;
+    public:
+        explicit RepairInfoLookup(const std::vector<SubBlockDimensionInfoRepairInfo>& patch_list);
+
+        /// Gets the repair-info for the specified sub-block index.
+        ///
+        /// \param  sub_block_index Index of the sub-block.
+        ///
+        /// \returns    Pointer to the repair-info if there is one for the specified sub-block; null otherwise.
+        const SubBlockDimensionInfoRepairInfo* Find(int sub_block_index) const;
+    };
+
+    static bool TryGetFixedSize(const SubBlockDimensionInfoRepairInfo& repair_info, char dimension_identifier, std::int32_t& new_size);
+
+    /// The size of the prefix of the JPGXR-data (in bytes) which is read in a first attempt to parse the JPGXR-header.
+    static constexpr std::uint64_t kInitialJpgxrHeaderProbeSize = 512;
+
+    static void GetWidthAndHeightOfJpgxrCompressedBitmap(libCZI::IStream* stream, std::uint64_t file_position, std::uint32_t& width, std::uint32_t& height);
 };
@@ -7,12 +7,19 @@
 #include <locale>
 #include <codecvt>
 #include <memory>
+#include <stdexcept>
+#include <algorithm>
 
 #if defined(WIN32ENV)
 #include <Windows.h>
 #include <io.h>    // For _isatty and _fileno
 #else
 #include <unistd.h>  // For isatty and fileno
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
 #endif
 
 
@@ -75,6 +82,249 @@ bool Utilities::IsStdOutATerminal()
 #endif
 }
 
+bool Utilities::FileExists(const std::wstring& filename)
+{
+#if defined(WIN32ENV)
+    return GetFileAttributesW(filename.c_str()) != INVALID_FILE_ATTRIBUTES;
+#else
+    struct stat file_status;
+    return stat(Utilities::convertToUtf8(filename).c_str(), &file_status) == 0;
+#endif
+}
+
+bool Utilities::RemoveFile(const std::wstring& filename)
+{
+#if defined(WIN32ENV)
+    return DeleteFileW(filename.c_str()) != FALSE;
+#else
+    return remove(Utilities::convertToUtf8(filename).c_str()) == 0;
+#endif
+}
+
+/*static*/void Utilities::FlushFileToStorage(const std::wstring& filename)
+{
+    DurableFile::OpenExisting(filename)->Flush();
+}
+
+namespace
+{
+    [[noreturn]] void ThrowFileError(const char* operation, const std::wstring& filename)
+    {
+#if defined(WIN32ENV)
+        const DWORD error_code = GetLastError();
+        throw runtime_error(string(operation) + " \"" + Utilities::convertToUtf8(filename) + "\" failed (error " + to_string(error_code) + ").");
+#else
+        const int error_code = errno;
+        throw runtime_error(string(operation) + " \"" + Utilities::convertToUtf8(filename) + "\" failed (" + strerror(error_code) + ").");
+#endif
+    }
+
+    [[noreturn]] void ThrowFileError(const char* operation)
+    {
+#if defined(WIN32ENV)
+        const DWORD error_code = GetLastError();
+        throw runtime_error(string(operation) + " failed (error " + to_string(error_code) + ").");
+#else
+        const int error_code = errno;
+        throw runtime_error(string(operation) + " failed (" + strerror(error_code) + ").");
+#endif
+    }
+}
+
+#if defined(WIN32ENV)
+/*static*/std::unique_ptr<DurableFile> DurableFile::CreateNew(const std::wstring& filename)
+{
+    const HANDLE handle = CreateFileW(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        ThrowFileError("Creating the file", filename);
+    }
+
+    // Note: on NTFS, the directory entry is persisted with the metadata of the file (when the file is flushed)
+    unique_ptr<DurableFile> file(new DurableFile());
+    file->handle_ = handle;
+    return file;
+}
+
+/*static*/std::unique_ptr<DurableFile> DurableFile::OpenExisting(const std::wstring& filename)
+{
+    const HANDLE handle = CreateFileW(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        ThrowFileError("Opening the file", filename);
+    }
+
+    unique_ptr<DurableFile> file(new DurableFile());
+    file->handle_ = handle;
+    return file;
+}
+
+DurableFile::~DurableFile()
+{
+    CloseHandle(this->handle_);
+}
+
+std::uint64_t DurableFile::Read(std::uint64_t offset, void* data, std::uint64_t size)
+{
+    uint64_t total_bytes_read = 0;
+    while (total_bytes_read < size)
+    {
+        const uint64_t position = offset + total_bytes_read;
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(position);
+        overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+        const DWORD bytes_to_read = static_cast<DWORD>((std::min)(size - total_bytes_read, static_cast<uint64_t>(0x80000000u)));
+        DWORD bytes_read;
+        if (!ReadFile(this->handle_, static_cast<uint8_t*>(data) + total_bytes_read, bytes_to_read, &bytes_read, &overlapped))
+        {
+            if (GetLastError() == ERROR_HANDLE_EOF)
+            {
+                break;
+            }
+
+            ThrowFileError("Reading from the file");
+        }
+
+        if (bytes_read == 0)
+        {
+            break;
+        }
+
+        total_bytes_read += bytes_read;
+    }
+
+    return total_bytes_read;
+}
+
+void DurableFile::Write(std::uint64_t offset, const void* data, std::uint64_t size)
+{
+    uint64_t total_bytes_written = 0;
+    while (total_bytes_written < size)
+    {
+        const uint64_t position = offset + total_bytes_written;
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(position);
+        overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+        const DWORD bytes_to_write = static_cast<DWORD>((std::min)(size - total_bytes_written, static_cast<uint64_t>(0x80000000u)));
+        DWORD bytes_written;
+        if (!WriteFile(this->handle_, static_cast<const uint8_t*>(data) + total_bytes_written, bytes_to_write, &bytes_written, &overlapped))
+        {
+            ThrowFileError("Writing to the file");
+        }
+
+        total_bytes_written += bytes_written;
+    }
+}
+
+void DurableFile::Flush()
+{
+    if (!FlushFileBuffers(this->handle_))
+    {
+        ThrowFileError("Flushing the file");
+    }
+}
+#else
+/*static*/std::unique_ptr<DurableFile> DurableFile::CreateNew(const std::wstring& filename)
+{
+    const string filename_utf8 = Utilities::convertToUtf8(filename);
+    const int file_descriptor = open(filename_utf8.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (file_descriptor < 0)
+    {
+        ThrowFileError("Creating the file", filename);
+    }
+
+    unique_ptr<DurableFile> file(new DurableFile());
+    file->file_descriptor_ = file_descriptor;
+
+    // the directory entry is only persisted when the directory is flushed - note that some file systems do not support
+    //  this (and report an error), so this is done on a best-effort basis
+    const size_t position_of_last_separator = filename_utf8.rfind('/');
+    const string directory = position_of_last_separator == string::npos ? string(".") :
+        position_of_last_separator == 0 ? string("/") : filename_utf8.substr(0, position_of_last_separator);
+    const int directory_file_descriptor = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (directory_file_descriptor >= 0)
+    {
+        fsync(directory_file_descriptor);
+        close(directory_file_descriptor);
+    }
+
+    return file;
+}
+
+/*static*/std::unique_ptr<DurableFile> DurableFile::OpenExisting(const std::wstring& filename)
+{
+    const int file_descriptor = open(Utilities::convertToUtf8(filename).c_str(), O_RDWR);
+    if (file_descriptor < 0)
+    {
+        ThrowFileError("Opening the file", filename);
+    }
+
+    unique_ptr<DurableFile> file(new DurableFile());
+    file->file_descriptor_ = file_descriptor;
+    return file;
+}
+
+DurableFile::~DurableFile()
+{
+    close(this->file_descriptor_);
+}
+
+std::uint64_t DurableFile::Read(std::uint64_t offset, void* data, std::uint64_t size)
+{
+    uint64_t total_bytes_read = 0;
+    while (total_bytes_read < size)
+    {
+        const ssize_t bytes_read = pread(this->file_descriptor_, static_cast<uint8_t*>(data) + total_bytes_read, static_cast<size_t>(size - total_bytes_read), static_cast<off_t>(offset + total_bytes_read));
+        if (bytes_read < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            ThrowFileError("Reading from the file");
+        }
+
+        if (bytes_read == 0)
+        {
+            break;
+        }
+
+        total_bytes_read += static_cast<uint64_t>(bytes_read);
+    }
+
+    return total_bytes_read;
+}
+
+void DurableFile::Write(std::uint64_t offset, const void* data, std::uint64_t size)
+{
+    uint64_t total_bytes_written = 0;
+    while (total_bytes_written < size)
+    {
+        const ssize_t bytes_written = pwrite(this->file_descriptor_, static_cast<const uint8_t*>(data) + total_bytes_written, static_cast<size_t>(size - total_bytes_written), static_cast<off_t>(offset + total_bytes_written));
+        if (bytes_written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            ThrowFileError("Writing to the file");
+        }
+
+        total_bytes_written += static_cast<uint64_t>(bytes_written);
+    }
+}
+
+void DurableFile::Flush()
+{
+    if (fsync(this->file_descriptor_) != 0)
+    {
+        ThrowFileError("Flushing the file");
+    }
+}
+#endif
+
 #if defined(WIN32ENV)
 CommandlineArgsWindowsHelper::CommandlineArgsWindowsHelper()
 {
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 #include "platform_defines.h"
@@ -15,6 +17,80 @@ public:
     static std::wstring convertUtf8ToUCS2(const std::string& utf8_str);
 
     static bool IsStdOutATerminal();
+
+    /// Query if the specified file exists.
+    ///
+    /// \param  filename    The filename.
+    ///
+    /// \returns    True if the file exists; false otherwise.
+    static bool FileExists(const std::wstring& filename);
+
+    /// Deletes the specified file.
+    ///
+    /// \param  filename    The filename.
+    ///
+    /// \returns    True if it succeeds; false otherwise.
+    static bool RemoveFile(const std::wstring& filename);
+
+    /// Flushes the content of the specified (existing) file to the storage device, i.e. all data which has been
+    /// written to the file (by any process) is persisted when this method returns.
+    ///
+    /// \param  filename    The filename.
+    static void FlushFileToStorage(const std::wstring& filename);
+};
+
+/// A file which is accessed with positional reads and writes (which go directly to the operating system, i.e. there is
+/// no buffering in the application), and whose content can be flushed to the storage device. Errors are reported
+/// by throwing a runtime_error.
+class DurableFile
+{
+private:
+#if defined(WIN32ENV)
+    void* handle_;
+#else
+    int file_descriptor_;
+#endif
+public:
+    /// Creates a new file (the file must not exist). The directory entry of the new file is persisted (so that the file
+    /// is not lost if the system crashes before the first flush).
+    ///
+    /// \param  filename    The filename.
+    ///
+    /// \returns    The newly created file.
+    static std::unique_ptr<DurableFile> CreateNew(const std::wstring& filename);
+
+    /// Opens an existing file for reading and writing.
+    ///
+    /// \param  filename    The filename.
+    ///
+    /// \returns    The opened file.
+    static std::unique_ptr<DurableFile> OpenExisting(const std::wstring& filename);
+
+    DurableFile(const DurableFile&) = delete;
+    DurableFile& operator=(const DurableFile&) = delete;
+    ~DurableFile();
+
+    /// Reads from the file at the specified offset. Reading stops at the end of the file.
+    ///
+    /// \param          offset  The offset in the file.
+    /// \param [out]    data    The buffer to receive the data.
+    /// \param          size    The number of bytes to read.
+    ///
+    /// \returns    The number of bytes read (which is less than the specified size only if the end of the file was reached).
+    std::uint64_t Read(std::uint64_t offset, void* data, std::uint64_t size);
+
+    /// Writes the specified data to the file at the specified offset.
+    ///
+    /// \param  offset  The offset in the file.
+    /// \param  data    The data to write.
+    /// \param  size    The number of bytes to write.
+    void Write(std::uint64_t offset, const void* data, std::uint64_t size);
+
+    /// Flushes all data written so far to the storage device.
+    void Flush();
+
+private:
+    DurableFile() = default;
 };
 
 #if defined(WIN32ENV)
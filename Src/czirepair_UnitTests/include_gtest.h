@@ -0,0 +1,8 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
@@ -0,0 +1,280 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "include_gtest.h"
+#include "utils.h"
+#include "../czirepair/repairjournal.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+using namespace libCZI;
+using namespace std;
+
+namespace
+{
+    const GUID kFileGuid{ 0x1234567, 0x89ab, 0xcdef, { 1, 2, 3, 4, 5, 6, 7, 8 } };
+
+    vector<uint8_t> ReadFile(const wchar_t* filename)
+    {
+        const auto stream = CreateStreamFromFile(filename);
+        vector<uint8_t> data;
+        const size_t kChunkSize = 4096;
+        for (;;)
+        {
+            const size_t size_so_far = data.size();
+            data.resize(size_so_far + kChunkSize);
+            uint64_t bytes_read;
+            stream->Read(size_so_far, data.data() + size_so_far, kChunkSize, &bytes_read);
+            data.resize(size_so_far + static_cast<size_t>(bytes_read));
+            if (bytes_read < kChunkSize)
+            {
+                return data;
+            }
+        }
+    }
+
+    vector<RepairUtilities::SubBlockDimensionInfoRepairInfo> CreatePlan()
+    {
+        vector<RepairUtilities::SubBlockDimensionInfoRepairInfo> plan(2);
+        plan[0].sub_block_index = 3;
+        plan[0].fixed_size_x = 100;
+        plan[1].sub_block_index = 7;
+        plan[1].fixed_size_y = 200;
+        return plan;
+    }
+
+    /// Creates a journal with the plan and two write records (of 4 bytes each), and returns the size of the journal
+    /// before the second write record was added.
+    uint64_t CreateJournalWithTwoWriteRecords(const wchar_t* filename)
+    {
+        auto journal = RepairJournal::Create(filename, kFileGuid, CreatePlan());
+        journal->AppendWrite(10, "abcd", "ABCD", 4);
+        journal.reset();
+        const uint64_t size_with_one_write_record = ReadFile(filename).size();
+        journal = RepairJournal::Open(filename);
+        journal->AppendWrite(20, "efgh", "EFGH", 4);
+        return size_with_one_write_record;
+    }
+
+    /// An input-output-stream which throws an exception when the specified write operation is attempted - this simulates
+    /// that the process is terminated while the patch operation is in progress.
+    class InputOutputStreamFailingOnWrite : public IInputOutputStream
+    {
+    private:
+        shared_ptr<IInputOutputStream> stream_;
+        int writes_until_failure_;
+    public:
+        InputOutputStreamFailingOnWrite(shared_ptr<IInputOutputStream> stream, int writes_until_failure)
+            : stream_(std::move(stream)), writes_until_failure_(writes_until_failure)
+        {}
+
+        void Read(uint64_t offset, void* pv, uint64_t size, uint64_t* ptrBytesRead) override
+        {
+            this->stream_->Read(offset, pv, size, ptrBytesRead);
+        }
+
+        void Write(uint64_t offset, const void* pv, uint64_t size, uint64_t* ptrBytesWritten) override
+        {
+            if (this->writes_until_failure_-- == 0)
+            {
+                throw runtime_error("simulated failure");
+            }
+
+            this->stream_->Write(offset, pv, size, ptrBytesWritten);
+        }
+    };
+}
+
+TEST(RepairJournal, CreateAndOpenAndCheckContent)
+{
+    const wchar_t* const filename = L"czirepair_unittest_journal_content.czirepair-journal";
+    {
+        auto journal = RepairJournal::Create(filename, kFileGuid, CreatePlan());
+        journal->AppendWrite(10, "abcd", "ABCD", 4);
+        journal->AppendCompleted();
+    }
+
+    const auto journal = RepairJournal::Open(filename);
+    EXPECT_TRUE(journal->GetFileGuid() == kFileGuid);
+    ASSERT_EQ(journal->GetPlan().size(), 2u);
+    EXPECT_EQ(journal->GetPlan()[0].sub_block_index, 3);
+    EXPECT_EQ(journal->GetPlan()[0].fixed_size_x, 100u);
+    EXPECT_FALSE(journal->GetPlan()[0].IsFixedSizeYValid());
+    EXPECT_EQ(journal->GetPlan()[1].sub_block_index, 7);
+    EXPECT_FALSE(journal->GetPlan()[1].IsFixedSizeXValid());
+    EXPECT_EQ(journal->GetPlan()[1].fixed_size_y, 200u);
+    ASSERT_EQ(journal->GetWriteRecords().size(), 1u);
+    EXPECT_EQ(journal->GetWriteRecords()[0].offset, 10u);
+    EXPECT_EQ(journal->GetWriteRecords()[0].original_data, (vector<uint8_t>{ 'a', 'b', 'c', 'd' }));
+    EXPECT_EQ(journal->GetWriteRecords()[0].new_data, (vector<uint8_t>{ 'A', 'B', 'C', 'D' }));
+    EXPECT_TRUE(journal->IsCompleted());
+    EXPECT_FALSE(journal->IsRollbackStarted());
+
+    remove("czirepair_unittest_journal_content.czirepair-journal");
+}
+
+TEST(RepairJournal, TruncateLastRecordAndCheckThatItIsIgnoredAndOverwritten)
+{
+    const wchar_t* const filename = L"czirepair_unittest_journal_truncated.czirepair-journal";
+    const uint64_t size_with_one_write_record = CreateJournalWithTwoWriteRecords(filename);
+
+    // now cut off the last 3 bytes - i.e. the last record is torn (as if the process was terminated while writing it)
+    auto data = ReadFile(filename);
+    data.resize(data.size() - 3);
+    WriteFile(filename, data.data(), data.size());
+
+    {
+        auto journal = RepairJournal::Open(filename);
+        ASSERT_EQ(journal->GetWriteRecords().size(), 1u);
+        EXPECT_EQ(journal->GetWriteRecords()[0].offset, 10u);
+        EXPECT_FALSE(journal->IsCompleted());
+
+        // the next record is expected to be written where the torn record started
+        journal->AppendWrite(30, "ijkl", "IJKL", 4);
+    }
+
+    EXPECT_EQ(ReadFile(filename).size(), data.size() + 3);
+    const auto journal = RepairJournal::Open(filename);
+    ASSERT_EQ(journal->GetWriteRecords().size(), 2u);
+    EXPECT_EQ(journal->GetWriteRecords()[0].offset, 10u);
+    EXPECT_EQ(journal->GetWriteRecords()[1].offset, 30u);
+    EXPECT_GT(ReadFile(filename).size(), size_with_one_write_record);
+
+    remove("czirepair_unittest_journal_truncated.czirepair-journal");
+}
+
+TEST(RepairJournal, CorruptChecksumOfLastRecordAndCheckThatItIsRejected)
+{
+    const wchar_t* const filename = L"czirepair_unittest_journal_checksum.czirepair-journal";
+    CreateJournalWithTwoWriteRecords(filename);
+
+    // modify a byte in the payload of the last record (the "new data")
+    auto data = ReadFile(filename);
+    data[data.size() - 5] ^= 0x55;
+    WriteFile(filename, data.data(), data.size());
+
+    {
+        auto journal = RepairJournal::Open(filename);
+        ASSERT_EQ(journal->GetWriteRecords().size(), 1u);
+        EXPECT_EQ(journal->GetWriteRecords()[0].offset, 10u);
+        journal->AppendCompleted();
+    }
+
+    // the record with the invalid checksum has been overwritten (where the remainder of it is ignored)
+    const auto journal = RepairJournal::Open(filename);
+    EXPECT_EQ(journal->GetWriteRecords().size(), 1u);
+    EXPECT_TRUE(journal->IsCompleted());
+    EXPECT_EQ(ReadFile(filename).size(), data.size());
+
+    remove("czirepair_unittest_journal_checksum.czirepair-journal");
+}
+
+TEST(RepairJournal, AppendRollbackStartedAndCheckThatItIsReported)
+{
+    const wchar_t* const filename = L"czirepair_unittest_journal_rollback.czirepair-journal";
+    {
+        auto journal = RepairJournal::Create(filename, kFileGuid, CreatePlan());
+        journal->AppendWrite(10, "abcd", "ABCD", 4);
+        journal->AppendCompleted();
+        journal->AppendRollbackStarted();
+        EXPECT_TRUE(journal->IsRollbackStarted());
+    }
+
+    const auto journal = RepairJournal::Open(filename);
+    EXPECT_TRUE(journal->IsCompleted());
+    EXPECT_TRUE(journal->IsRollbackStarted());
+
+    remove("czirepair_unittest_journal_rollback.czirepair-journal");
+}
+
+TEST(RepairJournal, CreateJournalForExistingFileAndExpectException)
+{
+    const wchar_t* const filename = L"czirepair_unittest_journal_existing.czirepair-journal";
+    {
+        auto journal = RepairJournal::Create(filename, kFileGuid, CreatePlan());
+        journal->AppendWrite(10, "abcd", "ABCD", 4);
+    }
+
+    // an existing journal must not be overwritten (the journal is the only way to undo the patches)
+    EXPECT_THROW(RepairJournal::Create(filename, kFileGuid, CreatePlan()), runtime_error);
+
+    const auto journal = RepairJournal::Open(filename);
+    EXPECT_EQ(journal->GetWriteRecords().size(), 1u);
+
+    remove("czirepair_unittest_journal_existing.czirepair-journal");
+}
+
+TEST(RepairJournal, InterruptPatchOperationThenResumeFromJournalAndRollback)
+{
+    const wchar_t* const czi_filename = L"czirepair_unittest_resume.czi";
+    const wchar_t* const journal_filename = L"czirepair_unittest_resume.czi.czirepair-journal";
+    const auto czi_document = CreateCziWithJpgXrCompressedSubBlocksWithWrongSize(20);
+    WriteFile(czi_filename, get<0>(czi_document).get(), get<1>(czi_document));
+    const auto original_content = ReadFile(czi_filename);
+
+    vector<RepairUtilities::SubBlockDimensionInfoRepairInfo> repair_info;
+    {
+        const auto stream = CreateStreamFromFile(czi_filename);
+        const auto reader = CreateCZIReader();
+        reader->Open(stream);
+        repair_info = RepairUtilities::GetRepairInfo(stream.get(), reader.get(), 1, nullptr);
+        ASSERT_FALSE(repair_info.empty());
+        RepairJournal::Create(journal_filename, reader->GetFileHeaderInfo().fileGuid, repair_info);
+    }
+
+    // apply the patches, where the third write operation fails - at this point, the journal contains a record for
+    //  this write operation, but it has not been executed
+    {
+        auto journal = RepairJournal::Open(journal_filename);
+        const auto failing_stream = make_shared<InputOutputStreamFailingOnWrite>(CreateInputOutputStreamForFile(czi_filename), 2);
+        JournalingInputOutputStream journaling_stream(failing_stream, journal.get());
+        EXPECT_THROW(RepairUtilities::ApplyRepairInfo(&journaling_stream, journal->GetPlan()), runtime_error);
+        EXPECT_EQ(journal->GetWriteRecords().size(), 3u);
+    }
+
+    EXPECT_NE(ReadFile(czi_filename), original_content);
+
+    // now resume - the plan is taken from the journal (i.e. without scanning the file again)
+    {
+        auto journal = RepairJournal::Open(journal_filename);
+        EXPECT_FALSE(journal->IsCompleted());
+        ASSERT_EQ(journal->GetPlan().size(), repair_info.size());
+        for (size_t i = 0; i < repair_info.size(); ++i)
+        {
+            EXPECT_EQ(journal->GetPlan()[i].sub_block_index, repair_info[i].sub_block_index);
+            EXPECT_EQ(journal->GetPlan()[i].fixed_size_x, repair_info[i].fixed_size_x);
+            EXPECT_EQ(journal->GetPlan()[i].fixed_size_y, repair_info[i].fixed_size_y);
+        }
+
+        JournalingInputOutputStream journaling_stream(CreateInputOutputStreamForFile(czi_filename), journal.get());
+        RepairUtilities::ApplyRepairInfo(&journaling_stream, journal->GetPlan());
+        journal->AppendCompleted();
+    }
+
+    // the file is now expected to be fully repaired
+    {
+        const auto stream = CreateStreamFromFile(czi_filename);
+        const auto reader = CreateCZIReader();
+        reader->Open(stream);
+        EXPECT_TRUE(RepairUtilities::GetRepairInfo(stream.get(), reader.get(), 1, nullptr).empty());
+    }
+
+    // and restoring the original content (in reverse order) is expected to give the original file
+    {
+        const auto journal = RepairJournal::Open(journal_filename);
+        EXPECT_TRUE(journal->IsCompleted());
+        const auto stream = CreateInputOutputStreamForFile(czi_filename);
+        const auto& write_records = journal->GetWriteRecords();
+        for (auto it = write_records.crbegin(); it != write_records.crend(); ++it)
+        {
+            stream->Write(it->offset, it->original_data.data(), it->original_data.size(), nullptr);
+        }
+    }
+
+    EXPECT_EQ(ReadFile(czi_filename), original_content);
+
+    remove("czirepair_unittest_resume.czi");
+    remove("czirepair_unittest_resume.czi.czirepair-journal");
+}
@@ -0,0 +1,90 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "include_gtest.h"
+#include "utils.h"
+#include "../czirepair/repairutilities.h"
+
+using namespace libCZI;
+using namespace std;
+
+TEST(RepairUtilities, GetRepairInfoAndCheckResult)
+{
+    constexpr int kSubBlockCount = 30;
+    const auto czi_document = CreateCziWithJpgXrCompressedSubBlocksWithWrongSize(kSubBlockCount);
+    const auto stream = CreateStreamFromMemory(get<0>(czi_document), get<1>(czi_document));
+    const auto reader = CreateCZIReader();
+    reader->Open(stream);
+
+    const auto repair_info = RepairUtilities::GetRepairInfo(stream.get(), reader.get(), 1, nullptr);
+
+    // every third sub-block has a wrong width, every fifth a wrong height
+    vector<int> expected_sub_block_indices;
+    for (int i = 0; i < kSubBlockCount; ++i)
+    {
+        if (i % 3 == 0 || i % 5 == 0)
+        {
+            expected_sub_block_indices.push_back(i);
+        }
+    }
+
+    ASSERT_EQ(repair_info.size(), expected_sub_block_indices.size());
+    for (size_t i = 0; i < repair_info.size(); ++i)
+    {
+        const int sub_block_index = expected_sub_block_indices[i];
+        EXPECT_EQ(repair_info[i].sub_block_index, sub_block_index);
+        EXPECT_EQ(repair_info[i].IsFixedSizeXValid(), sub_block_index % 3 == 0);
+        EXPECT_EQ(repair_info[i].IsFixedSizeYValid(), sub_block_index % 5 == 0);
+        if (repair_info[i].IsFixedSizeXValid())
+        {
+            EXPECT_EQ(repair_info[i].fixed_size_x, 16u + sub_block_index % 7);
+        }
+
+        if (repair_info[i].IsFixedSizeYValid())
+        {
+            EXPECT_EQ(repair_info[i].fixed_size_y, 12u + sub_block_index % 5);
+        }
+    }
+}
+
+TEST(RepairUtilities, GetRepairInfoWithMultipleThreadsAndCompareWithSingleThreadedResult)
+{
+    const auto czi_document = CreateCziWithJpgXrCompressedSubBlocksWithWrongSize(50);
+    const auto stream = CreateStreamFromMemory(get<0>(czi_document), get<1>(czi_document));
+    const auto reader = CreateCZIReader();
+    reader->Open(stream);
+
+    const auto repair_info_single_threaded = RepairUtilities::GetRepairInfo(stream.get(), reader.get(), 1, nullptr);
+    ASSERT_FALSE(repair_info_single_threaded.empty());
+
+    for (const int number_of_threads : { 2, 3, 8, 64 })
+    {
+        int progress_callback_count = 0;
+        int last_progress_index = -1;
+        bool progress_index_increasing = true;
+        const auto repair_info = RepairUtilities::GetRepairInfo(
+            stream.get(),
+            reader.get(),
+            number_of_threads,
+            [&](const RepairUtilities::ProgressInfo& progress_info)
+            {
+                // the callback is serialized, so no synchronization is needed here
+                ++progress_callback_count;
+                progress_index_increasing = progress_index_increasing && progress_info.current_sub_block_index > last_progress_index;
+                last_progress_index = progress_info.current_sub_block_index;
+            });
+
+        // the same entries in the same order are expected
+        ASSERT_EQ(repair_info.size(), repair_info_single_threaded.size()) << "number of threads: " << number_of_threads;
+        for (size_t i = 0; i < repair_info.size(); ++i)
+        {
+            EXPECT_EQ(repair_info[i].sub_block_index, repair_info_single_threaded[i].sub_block_index) << "number of threads: " << number_of_threads;
+            EXPECT_EQ(repair_info[i].fixed_size_x, repair_info_single_threaded[i].fixed_size_x) << "number of threads: " << number_of_threads;
+            EXPECT_EQ(repair_info[i].fixed_size_y, repair_info_single_threaded[i].fixed_size_y) << "number of threads: " << number_of_threads;
+        }
+
+        EXPECT_EQ(progress_callback_count, 50);
+        EXPECT_TRUE(progress_index_increasing);
+    }
+}
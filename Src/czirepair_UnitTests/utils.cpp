@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "utils.h"
+#include "../libCZI_UnitTests/MemOutputStream.h"
+
+#include <stdexcept>
+
+using namespace libCZI;
+using namespace std;
+
+std::tuple<std::shared_ptr<void>, size_t> CreateCziWithJpgXrCompressedSubBlocksWithWrongSize(int sub_block_count)
+{
+    auto writer = CreateCZIWriter();
+    auto out_stream = make_shared<CMemOutputStream>(0);
+
+    const auto writer_info = make_shared<CCziWriterInfo>(
+        GUID{ 0x1234567, 0x89ab, 0xcdef, { 1, 2, 3, 4, 5, 6, 7, 8 } },
+        CDimBounds{ { DimensionIndex::C, 0, 1 } },
+        0, sub_block_count - 1);
+    writer->Create(out_stream, writer_info);
+
+    for (int i = 0; i < sub_block_count; ++i)
+    {
+        // the sub-blocks have different sizes, so that each fix is unique
+        const uint32_t width = 16 + i % 7;
+        const uint32_t height = 12 + i % 5;
+        auto bitmap = CBitmapData<CHeapAllocator>::Create(PixelType::Gray8, width, height);
+        shared_ptr<IMemoryBlock> encoded_data;
+        {
+            const ScopedBitmapLockerSP lock_info_bitmap{ bitmap };
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    static_cast<uint8_t*>(lock_info_bitmap.ptrDataRoi)[y * lock_info_bitmap.stride + x] = static_cast<uint8_t>(x * 7 + y * 3 + i);
+                }
+            }
+
+            encoded_data = JxrLibCompress::Compress(bitmap->GetPixelType(), width, height, lock_info_bitmap.stride, lock_info_bitmap.ptrDataRoi, nullptr);
+        }
+
+        const uint32_t width_in_dimension_info = i % 3 == 0 ? width + 1 : width;
+        const uint32_t height_in_dimension_info = i % 5 == 0 ? height + 2 : height;
+        AddSubBlockInfoMemPtr add_sub_block_info;
+        add_sub_block_info.Clear();
+        add_sub_block_info.coordinate.Set(DimensionIndex::C, 0);
+        add_sub_block_info.mIndexValid = true;
+        add_sub_block_info.mIndex = i;
+        add_sub_block_info.x = i * 32;
+        add_sub_block_info.y = 0;
+        add_sub_block_info.logicalWidth = width_in_dimension_info;
+        add_sub_block_info.logicalHeight = height_in_dimension_info;
+        add_sub_block_info.physicalWidth = width_in_dimension_info;
+        add_sub_block_info.physicalHeight = height_in_dimension_info;
+        add_sub_block_info.PixelType = bitmap->GetPixelType();
+        add_sub_block_info.SetCompressionMode(CompressionMode::JpgXr);
+        add_sub_block_info.ptrData = encoded_data->GetPtr();
+        add_sub_block_info.dataSize = static_cast<uint32_t>(encoded_data->GetSizeOfData());
+        writer->SyncAddSubBlock(add_sub_block_info);
+    }
+
+    writer->Close();
+    writer.reset();
+
+    size_t czi_document_size = 0;
+    shared_ptr<void> czi_document_data = out_stream->GetCopy(&czi_document_size);
+    return make_tuple(czi_document_data, czi_document_size);
+}
+
+void WriteFile(const wchar_t* filename, const void* data, size_t size)
+{
+    const auto stream = CreateOutputStreamForFile(filename, true);
+    uint64_t bytes_written;
+    stream->Write(0, data, size, &bytes_written);
+    if (bytes_written != size)
+    {
+        throw runtime_error("Error writing the file.");
+    }
+}
@@ -0,0 +1,26 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include "../libCZI/libCZI.h"
+
+/// Creates a synthetic CZI document with the specified number of JPG-XR-compressed sub-blocks (of pixel type Gray8), where
+/// the size given in the dimension-info does not match the size of the JPG-XR-compressed bitmap for some of them - for every
+/// third sub-block the width is too large by one, and for every fifth sub-block the height is too large by two.
+///
+/// \param  sub_block_count The number of sub-blocks.
+///
+/// \returns    A blob containing the CZI document.
+std::tuple<std::shared_ptr<void>, size_t> CreateCziWithJpgXrCompressedSubBlocksWithWrongSize(int sub_block_count);
+
+/// Writes the specified data to a file (which is overwritten if it exists).
+///
+/// \param  filename    The filename.
+/// \param  data        The data to write.
+/// \param  size        The size of the data in bytes.
+void WriteFile(const wchar_t* filename, const void* data, size_t size);
@@ -11,6 +11,8 @@
 #include "utilities.h"
 #include "CziAttachment.h"
 #include "CziReaderCommon.h"
+#include "CziSubBlockDirectoryIndex.h"
+#include "Site.h"
 
 using namespace std;
 using namespace libCZI;
@@ -32,7 +34,60 @@ static CCZIParse::SubblockDirectoryParseOptions GetParseOptionsFromOpenOptions(c
     return parse_options;
 }
 
-CCZIReader::CCZIReader() : isOperational(false)
+namespace
+{
+    /// This class makes a buffer (containing data which was read from a stream) available as a stream - all requests
+    /// which are (completely) within the buffer are served from it, and all other requests are forwarded to the
+    /// underlying stream. Direct access is given to the buffer, so that sub-blocks can reference the data without
+    /// copying it.
+    class CBufferedStreamWindow : public libCZI::IStreamEx
+    {
+    private:
+        std::uint64_t offset_;
+        std::shared_ptr<const std::uint8_t> buffer_;
+        std::uint64_t size_;
+        libCZI::IStream* underlying_stream_;
+    public:
+        CBufferedStreamWindow(std::uint64_t offset, std::shared_ptr<const std::uint8_t> buffer, std::uint64_t size, libCZI::IStream* underlying_stream)
+            : offset_(offset), buffer_(std::move(buffer)), size_(size), underlying_stream_(underlying_stream)
+        {
+        }
+
+        void Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead) override
+        {
+            if (this->IsWithinBuffer(offset, size))
+            {
+                memcpy(pv, this->buffer_.get() + (offset - this->offset_), static_cast<size_t>(size));
+                if (ptrBytesRead != nullptr)
+                {
+                    *ptrBytesRead = size;
+                }
+
+                return;
+            }
+
+            this->underlying_stream_->Read(offset, pv, size, ptrBytesRead);
+        }
+
+        bool TryGetDirectAccess(std::uint64_t offset, std::uint64_t size, std::shared_ptr<const void>& data) override
+        {
+            if (!this->IsWithinBuffer(offset, size))
+            {
+                return false;
+            }
+
+            data = std::shared_ptr<const void>(this->buffer_, this->buffer_.get() + (offset - this->offset_));
+            return true;
+        }
+    private:
+        bool IsWithinBuffer(std::uint64_t offset, std::uint64_t size) const
+        {
+            return offset >= this->offset_ && offset - this->offset_ <= this->size_ && size <= this->size_ - (offset - this->offset_);
+        }
+    };
+}
+
+CCZIReader::CCZIReader() : roi_query_without_spatial_index_done_(false), isOperational(false)
 {
 }
 
@@ -45,12 +100,12 @@ CCZIReader::CCZIReader() : isOperational(false)
 
     if (options == nullptr)
     {
-        constexpr auto default_options = OpenOptions{};
+        const OpenOptions default_options;
         return CCZIReader::Open(stream, &default_options);
     }
 
     this->hdrSegmentData = CCZIParse::ReadFileHeaderSegmentData(stream.get());
-    this->subBlkDir = CCZIParse::ReadSubBlockDirectory(stream.get(), this->hdrSegmentData.GetSubBlockDirectoryPosition(), GetParseOptionsFromOpenOptions(*options));
+    this->ReadSubBlockDirectory(stream.get(), *options);
     const auto attachmentPos = this->hdrSegmentData.GetAttachmentDirectoryPosition();
     if (attachmentPos != 0)
     {
@@ -59,10 +114,57 @@ CCZIReader::CCZIReader() : isOperational(false)
         this->attachmentDir = CCZIParse::ReadAttachmentsDirectory(stream.get(), attachmentPos);
     }
 
+    this->sub_block_allocator_ = options->sub_block_allocator;
+    this->io_task_executor_ = options->io_task_executor;
     this->stream = stream;
     this->SetOperationalState(true);
 }
 
+void CCZIReader::ReadSubBlockDirectory(libCZI::IStream* stream, const ICZIReader::OpenOptions& options)
+{
+    const auto parse_options = GetParseOptionsFromOpenOptions(options);
+    const auto sub_block_directory_position = this->hdrSegmentData.GetSubBlockDirectoryPosition();
+    if (!options.sub_block_directory_index_input && !options.sub_block_directory_index_output)
+    {
+        this->subBlkDir = CCZIParse::ReadSubBlockDirectory(stream, sub_block_directory_position, parse_options);
+        return;
+    }
+
+    const auto segment_sizes = CCZIParse::ReadSegmentHeaderAny(stream, sub_block_directory_position);
+    CCziSubBlockDirectoryIndex::ValidationInfo validation_info;
+    validation_info.fileGuid = this->hdrSegmentData.GetFileGuid();
+    validation_info.subBlockDirectoryPosition = sub_block_directory_position;
+    validation_info.subBlockDirectoryAllocatedSize = segment_sizes.AllocatedSize;
+    validation_info.subBlockDirectoryUsedSize = segment_sizes.UsedSize;
+    validation_info.parseOptions = parse_options.GetBitmask();
+
+    if (options.sub_block_directory_index_input)
+    {
+        CCziSubBlockDirectory sub_block_directory;
+        if (CCziSubBlockDirectoryIndex::TryRead(
+            options.sub_block_directory_index_input.get(),
+            validation_info,
+            stream,
+            options.sub_block_directory_index_validate_content,
+            sub_block_directory))
+        {
+            this->subBlkDir = std::move(sub_block_directory);
+            return;
+        }
+    }
+
+    this->subBlkDir = CCZIParse::ReadSubBlockDirectory(stream, sub_block_directory_position, parse_options);
+    if (options.sub_block_directory_index_output)
+    {
+        CCziSubBlockDirectoryIndex::Write(
+            this->subBlkDir,
+            validation_info,
+            stream,
+            options.sub_block_directory_index_validate_content,
+            options.sub_block_directory_index_output.get());
+    }
+}
+
 /*virtual*/FileHeaderInfo CCZIReader::GetFileHeaderInfo()
 {
     this->ThrowIfNotOperational();
@@ -128,7 +230,28 @@ CCZIReader::CCZIReader() : isOperational(false)
 /*virtual*/void CCZIReader::EnumSubset(const IDimCoordinate* planeCoordinate, const IntRect* roi, bool onlyLayer0, const std::function<bool(int index, const SubBlockInfo& info)>& funcEnum)
 {
     this->ThrowIfNotOperational();
-    CziReaderCommon::EnumSubset(this, planeCoordinate, roi, onlyLayer0, funcEnum);
+    vector<int> indices;
+    const auto spatial_index = roi != nullptr ? this->GetSpatialIndexForRoiQuery() : nullptr;
+    if (spatial_index)
+    {
+        spatial_index->Query(planeCoordinate, roi, onlyLayer0, indices);
+    }
+    else
+    {
+        // without a ROI, a linear scan over the sub-block directory is as good as it gets - and with a ROI, this is the case
+        //  for as long as the spatial index has not been created
+        this->subBlkDir.FilterSubBlocks(planeCoordinate, roi, onlyLayer0, indices);
+    }
+
+    for (const int index : indices)
+    {
+        CCziSubBlockDirectory::SubBlkEntry entry;
+        this->subBlkDir.TryGetSubBlock(index, entry);
+        if (!funcEnum(index, CziReaderCommon::ConvertToSubBlockInfo(entry)))
+        {
+            break;
+        }
+    }
 }
 
 /*virtual*/std::shared_ptr<ISubBlock> CCZIReader::ReadSubBlock(int index)
@@ -140,7 +263,7 @@ CCZIReader::CCZIReader() : isOperational(false)
         return {};
     }
 
-    return this->ReadSubBlock(entry);
+    return this->ReadSubBlock(entry, this->sub_block_allocator_);
 }
 
 /*virtual*/bool CCZIReader::TryGetSubBlockInfoOfArbitrarySubBlockInChannel(int channelIndex, SubBlockInfo& info)
@@ -165,6 +288,163 @@ CCZIReader::CCZIReader() : isOperational(false)
     return true;
 }
 
+/*virtual*/std::shared_ptr<libCZI::ISubBlock> CCZIReader::ReadSubBlockUsingAllocator(int index, const std::shared_ptr<libCZI::ISubBlockAllocator>& allocator)
+{
+    this->ThrowIfNotOperational();
+    CCziSubBlockDirectory::SubBlkEntry entry;
+    if (this->subBlkDir.TryGetSubBlock(index, entry) == false)
+    {
+        return {};
+    }
+
+    return this->ReadSubBlock(entry, allocator ? allocator : this->sub_block_allocator_);
+}
+
+/*virtual*/bool CCZIReader::TryReadSubBlockData(int index, const std::function<void* (std::uint64_t size)>& get_buffer)
+{
+    this->ThrowIfNotOperational();
+    CCziSubBlockDirectory::SubBlkEntry entry;
+    if (this->subBlkDir.TryGetSubBlock(index, entry) == false)
+    {
+        return false;
+    }
+
+    const auto stream_reference = this->GetStreamReference("CZIReader::TryReadSubBlockData");
+    const auto location = CCZIParse::ReadSubBlockDataLocation(stream_reference.get(), entry.FilePosition);
+    if (location.dataSize > 0)
+    {
+        void* buffer = get_buffer(location.dataSize);
+        if (buffer != nullptr)
+        {
+            CCZIParse::ReadSubBlockDataPrefix(stream_reference.get(), location, buffer, location.dataSize);
+        }
+    }
+
+    return true;
+}
+
+/*virtual*/std::vector<std::shared_ptr<libCZI::ISubBlock>> CCZIReader::ReadSubBlocks(const std::vector<int>& indices)
+{
+    this->ThrowIfNotOperational();
+    std::vector<std::shared_ptr<ISubBlock>> result(indices.size());
+    std::vector<size_t> positions;
+    std::vector<CCziSubBlockDirectory::SubBlkEntry> entries;
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        CCziSubBlockDirectory::SubBlkEntry entry;
+        if (this->subBlkDir.TryGetSubBlock(indices[i], entry))
+        {
+            positions.push_back(i);
+            entries.push_back(entry);
+        }
+    }
+
+    if (entries.empty())
+    {
+        return result;
+    }
+
+    const auto stream_reference = this->GetStreamReference("CZIReader::ReadSubBlocks");
+
+    // If the stream does not support batched reads, there is nothing to gain here. And if the stream gives direct
+    //  access to its content (e.g. a memory-mapped file), then reading the sub-blocks individually does not involve
+    //  any I/O-requests (nor copying) at all - so in both cases we read the sub-blocks one by one.
+    const auto stream_ex = dynamic_cast<libCZI::IStreamEx*>(stream_reference.get());
+    shared_ptr<const void> direct_access_probe;
+    if (stream_ex == nullptr || entries.size() == 1 || stream_ex->TryGetDirectAccess(entries[0].FilePosition, 1, direct_access_probe))
+    {
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            result[positions[i]] = this->ReadSubBlock(entries[i], this->sub_block_allocator_);
+        }
+
+        return result;
+    }
+
+    // The size of a sub-block segment is not known from the directory, so we proceed in two steps: first, we read the
+    //  (minimal) segment headers of all sub-blocks in one batch, and determine the size of each segment from it. Then
+    //  we read the complete segments in a second batch.
+    const size_t size_of_segment_header = sizeof(SegmentHeader) + SIZE_SUBBLOCKDATA_MINIMUM;
+    const shared_ptr<uint8_t> header_buffer(new uint8_t[entries.size() * size_of_segment_header], default_delete<uint8_t[]>());
+    vector<StreamReadRange> ranges(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        ranges[i].offset = entries[i].FilePosition;
+        ranges[i].data = header_buffer.get() + i * size_of_segment_header;
+        ranges[i].size = size_of_segment_header;
+    }
+
+    try
+    {
+        stream_ex->ReadMany(ranges.data(), ranges.size());
+    }
+    catch (const std::exception&)
+    {
+        std::throw_with_nested(LibCZIIOException("Error reading SubBlock-Segments (batched read)", entries[0].FilePosition, size_of_segment_header));
+    }
+
+    // requests which cannot be served from the buffer (e.g. because the sub-block has more dimensions than fit into the
+    //  minimal segment header) are forwarded to the stream, so the result is always correct
+    vector<shared_ptr<uint8_t>> segment_buffers(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        CBufferedStreamWindow header_window(
+            entries[i].FilePosition,
+            shared_ptr<const uint8_t>(header_buffer, header_buffer.get() + i * size_of_segment_header),
+            ranges[i].bytes_read,
+            stream_reference.get());
+        const auto location = CCZIParse::ReadSubBlockDataLocation(&header_window, entries[i].FilePosition);
+
+        if (this->sub_block_allocator_)
+        {
+            const auto allocator = this->sub_block_allocator_;
+            segment_buffers[i] = shared_ptr<uint8_t>(
+                static_cast<uint8_t*>(allocator->Allocate(location.segmentSize)),
+                [allocator](uint8_t* ptr) -> void
+                {
+                    if (ptr != nullptr)
+                    {
+                        allocator->Free(ptr);
+                    }
+                });
+        }
+        else
+        {
+            segment_buffers[i] = shared_ptr<uint8_t>(new uint8_t[static_cast<size_t>(location.segmentSize)], default_delete<uint8_t[]>());
+        }
+
+        ranges[i].data = segment_buffers[i].get();
+        ranges[i].size = location.segmentSize;
+    }
+
+    try
+    {
+        stream_ex->ReadMany(ranges.data(), ranges.size());
+    }
+    catch (const std::exception&)
+    {
+        std::throw_with_nested(LibCZIIOException("Error reading SubBlock-Segments (batched read)", entries[0].FilePosition, ranges[0].size));
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        CBufferedStreamWindow segment_window(entries[i].FilePosition, segment_buffers[i], ranges[i].bytes_read, stream_reference.get());
+        CCZIParse::SubBlockData subBlkData;
+        shared_ptr<const void> spData, spAttachment, spMetadata;
+        if (CCZIParse::TryReadSubBlockDirect(&segment_window, entries[i].FilePosition, subBlkData, spData, spAttachment, spMetadata))
+        {
+            result[positions[i]] = std::make_shared<CCziSubBlock>(CCZIReader::GetSubBlockInfo(subBlkData), subBlkData, spData, spAttachment, spMetadata);
+        }
+        else
+        {
+            // this means that less data than expected was read, and reading the sub-block individually will give the appropriate error
+            result[positions[i]] = this->ReadSubBlock(entries[i], this->sub_block_allocator_);
+        }
+    }
+
+    return result;
+}
+
 /*virtual*/std::shared_ptr<libCZI::IAccessor> CCZIReader::CreateAccessor(libCZI::AccessorType accessorType)
 {
     this->ThrowIfNotOperational();
@@ -180,8 +460,96 @@ CCZIReader::CCZIReader() : isOperational(false)
     //  in which the stream-shared_ptr is accessed. While the stream-shared_ptr is thread-safe, it is not thread-safe to reset it while another thread
     //  is dealing with the same shared_ptr. C.f. https://stackoverflow.com/questions/14482830/stdshared-ptr-thread-safety. With C++20 we could use 
     //  atomic<shared_ptr> instead of the manual critical-section (c.f. https://en.cppreference.com/w/cpp/memory/shared_ptr/atomic2).
-    std::unique_lock<std::mutex> lock(this->stream_mutex_);
-    this->stream.reset();
+    {
+        std::unique_lock<std::mutex> lock(this->stream_mutex_);
+        this->stream.reset();
+    }
+
+    // the spatial index is derived from the sub-block directory of the document which is being closed - it must not be
+    //  used for a document which is opened subsequently (and the memory is to be released now)
+    std::unique_lock<std::mutex> lock(this->spatial_index_mutex_);
+    this->spatial_index_.reset();
+    this->roi_query_without_spatial_index_done_ = false;
+}
+
+/*virtual*/void CCZIReader::BeginReadSubBlock(int index, libCZI::TaskPriority priority, const ReadSubBlockCompletion& completion)
+{
+    this->ThrowIfNotOperational();
+
+    // the task holds a reference to the reader, so that it stays alive until the operation has completed
+    auto self = this->shared_from_this();
+    this->GetIoTaskExecutor()->Submit(
+        priority,
+        [self, index, completion]()->void
+        {
+            shared_ptr<ISubBlock> sub_block;
+            exception_ptr error;
+            try
+            {
+                sub_block = self->ReadSubBlock(index);
+            }
+            catch (...)
+            {
+                error = current_exception();
+            }
+
+            completion(sub_block, error);
+        });
+}
+
+/*virtual*/void CCZIReader::BeginReadSubBlockAndCreateBitmap(int index, libCZI::TaskPriority priority, const ReadSubBlockAndCreateBitmapCompletion& completion)
+{
+    this->ThrowIfNotOperational();
+    auto self = this->shared_from_this();
+    auto decode_task_executor = ::GetTaskExecutor();
+    this->GetIoTaskExecutor()->Submit(
+        priority,
+        [self, index, priority, decode_task_executor, completion]()->void
+        {
+            shared_ptr<ISubBlock> sub_block;
+            try
+            {
+                sub_block = self->ReadSubBlock(index);
+            }
+            catch (...)
+            {
+                completion(nullptr, nullptr, current_exception());
+                return;
+            }
+
+            if (!sub_block)
+            {
+                completion(nullptr, nullptr, nullptr);
+                return;
+            }
+
+            // the decoding is done as a separate task, so that the thread doing the I/O is available for the next read
+            const auto decode = [sub_block, completion]()->void
+                {
+                    shared_ptr<IBitmapData> bitmap;
+                    exception_ptr error;
+                    try
+                    {
+                        bitmap = sub_block->CreateBitmap();
+                    }
+                    catch (...)
+                    {
+                        error = current_exception();
+                    }
+
+                    completion(sub_block, bitmap, error);
+                };
+
+            try
+            {
+                decode_task_executor->Submit(priority, decode);
+            }
+            catch (...)
+            {
+                // if the executor refuses to take the task, we decode on this thread
+                decode();
+            }
+        });
 }
 
 /*virtual*/void CCZIReader::EnumerateAttachments(const std::function<bool(int index, const libCZI::AttachmentInfo& info)>& funcEnum)
@@ -222,10 +590,8 @@ CCZIReader::CCZIReader() : isOperational(false)
     return this->ReadAttachment(entry);
 }
 
-std::shared_ptr<ISubBlock> CCZIReader::ReadSubBlock(const CCziSubBlockDirectory::SubBlkEntry& entry)
+std::shared_ptr<libCZI::IStream> CCZIReader::GetStreamReference(const char* function_name)
 {
-    const CCZIParse::SubBlockStorageAllocate allocateInfo{ malloc,free };
-
     // For thread-safety, we need to ensure that we hold a reference to the stream for the whole duration of the call, 
     //  in order to prepare for concurrent calls to Close() (which will reset the stream-shared_ptr).
     shared_ptr<libCZI::IStream> stream_reference;
@@ -237,11 +603,85 @@ std::shared_ptr<ISubBlock> CCZIReader::ReadSubBlock(const CCziSubBlockDirectory:
 
     if (!stream_reference)
     {
-        throw logic_error("CZIReader::ReadSubBlock: stream is null (Close was already called for this instance)");
+        throw logic_error(string(function_name) + ": stream is null (Close was already called for this instance)");
+    }
+
+    return stream_reference;
+}
+
+std::shared_ptr<libCZI::ITaskExecutor> CCZIReader::GetIoTaskExecutor() const
+{
+    return this->io_task_executor_ ? this->io_task_executor_ : ::GetTaskExecutor();
+}
+
+std::shared_ptr<const CCziSubBlockSpatialIndex> CCZIReader::GetSpatialIndexForRoiQuery()
+{
+    // Building the index is O(N log N), whereas a linear scan (with the vectorized rectangle-filter) is O(N) - so, for a
+    //  single query the index does not pay off. Therefore, the first query is answered with a linear scan (for which we
+    //  return null here), and the index is created with the second query (and only once, subsequent callers - also
+    //  concurrent ones - get a reference to it).
+    unique_lock<mutex> lock(this->spatial_index_mutex_);
+    if (!this->spatial_index_)
+    {
+        if (!this->roi_query_without_spatial_index_done_)
+        {
+            this->roi_query_without_spatial_index_done_ = true;
+            return nullptr;
+        }
+
+        this->spatial_index_ = make_shared<CCziSubBlockSpatialIndex>(this->subBlkDir);
     }
 
+    return this->spatial_index_;
+}
+
+std::shared_ptr<ISubBlock> CCZIReader::ReadSubBlock(const CCziSubBlockDirectory::SubBlkEntry& entry, const std::shared_ptr<libCZI::ISubBlockAllocator>& allocator)
+{
+    const auto stream_reference = this->GetStreamReference("CZIReader::ReadSubBlock");
+
+    // if the stream is able to give direct access to its content (e.g. a memory-mapped file), then we reference the
+    //  data-parts of the sub-block directly (instead of copying them into newly allocated memory)
+    const auto stream_ex = dynamic_cast<libCZI::IStreamEx*>(stream_reference.get());
+    if (stream_ex != nullptr)
+    {
+        CCZIParse::SubBlockData subBlkData;
+        shared_ptr<const void> spData, spAttachment, spMetadata;
+        if (CCZIParse::TryReadSubBlockDirect(stream_ex, entry.FilePosition, subBlkData, spData, spAttachment, spMetadata))
+        {
+            return std::make_shared<CCziSubBlock>(CCZIReader::GetSubBlockInfo(subBlkData), subBlkData, spData, spAttachment, spMetadata);
+        }
+    }
+
+    if (!allocator)
+    {
+        const CCZIParse::SubBlockStorageAllocate allocateInfo{ malloc,free };
+        auto subBlkData = CCZIParse::ReadSubBlock(stream_reference.get(), entry.FilePosition, allocateInfo);
+        return std::make_shared<CCziSubBlock>(CCZIReader::GetSubBlockInfo(subBlkData), subBlkData, free);
+    }
+
+    const CCZIParse::SubBlockStorageAllocate allocateInfo
+    {
+        [&](size_t size) -> void* { return allocator->Allocate(size); },
+        [&](void* ptr) -> void { allocator->Free(ptr); }
+    };
+
     auto subBlkData = CCZIParse::ReadSubBlock(stream_reference.get(), entry.FilePosition, allocateInfo);
 
+    // the deleter holds a reference to the allocator, so that it stays alive as long as memory allocated by it is in use
+    return std::make_shared<CCziSubBlock>(
+        CCZIReader::GetSubBlockInfo(subBlkData),
+        subBlkData,
+        [allocator](void* ptr) -> void
+        {
+            if (ptr != nullptr)
+            {
+                allocator->Free(ptr);
+            }
+        });
+}
+
+/*static*/libCZI::SubBlockInfo CCZIReader::GetSubBlockInfo(const CCZIParse::SubBlockData& subBlkData)
+{
     libCZI::SubBlockInfo info;
     info.pixelType = CziUtils::PixelTypeFromInt(subBlkData.pixelType);
     info.compressionModeRaw = subBlkData.compression;
@@ -250,25 +690,14 @@ std::shared_ptr<ISubBlock> CCZIReader::ReadSubBlock(const CCziSubBlockDirectory:
     info.logicalRect = subBlkData.logicalRect;
     info.physicalSize = subBlkData.physicalSize;
     info.pyramidType = CziUtils::PyramidTypeFromByte(subBlkData.spare[0]);
-
-    return std::make_shared<CCziSubBlock>(info, subBlkData, free);
+    return info;
 }
 
 std::shared_ptr<libCZI::IAttachment> CCZIReader::ReadAttachment(const CCziAttachmentsDirectory::AttachmentEntry& entry)
 {
     const CCZIParse::SubBlockStorageAllocate allocateInfo{ malloc,free };
 
-    shared_ptr<libCZI::IStream> stream_reference;
-
-    {
-        unique_lock<mutex> lock(this->stream_mutex_);
-        stream_reference = this->stream;
-    }
-
-    if (!stream_reference)
-    {
-        throw logic_error("CCZIReader::ReadAttachment: stream is null (Close was already called for this instance)");
-    }
+    const auto stream_reference = this->GetStreamReference("CCZIReader::ReadAttachment");
 
     auto attchmnt = CCZIParse::ReadAttachment(stream_reference.get(), entry.FilePosition, allocateInfo);
     libCZI::AttachmentInfo attchmentInfo;
@@ -285,17 +714,7 @@ std::shared_ptr<libCZI::IMetadataSegment> CCZIReader::ReadMetadataSegment(std::u
 {
     const CCZIParse::SubBlockStorageAllocate allocateInfo{ malloc,free };
 
-    shared_ptr<libCZI::IStream> stream_reference;
-
-    {
-        unique_lock<mutex> lock(this->stream_mutex_);
-        stream_reference = this->stream;
-    }
-
-    if (!stream_reference)
-    {
-        throw logic_error("CCZIReader::ReadAttachment: stream is null (Close was already called for this instance)");
-    }
+    const auto stream_reference = this->GetStreamReference("CCZIReader::ReadMetadataSegment");
 
     auto metaDataSegmentData = CCZIParse::ReadMetadataSegment(stream_reference.get(), position, allocateInfo);
     return std::make_shared<CCziMetadataSegment>(metaDataSegmentData, free);
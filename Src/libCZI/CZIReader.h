@@ -11,8 +11,10 @@
 #include "CziSubBlockDirectory.h"
 #include "CziAttachmentsDirectory.h"
 #include "FileHeaderSegmentData.h"
+#include "CziParse.h"
+#include "CziSubBlockSpatialIndex.h"
 
-class CCZIReader : public libCZI::ICZIReader, public std::enable_shared_from_this<CCZIReader>
+class CCZIReader : public libCZI::ICZIReader, public libCZI::ISubBlockRepositoryMemoryControl, public std::enable_shared_from_this<CCZIReader>
 {
 private:
     std::shared_ptr<libCZI::IStream> stream;
@@ -20,6 +22,11 @@ private:
     CFileHeaderSegmentData hdrSegmentData;
     CCziSubBlockDirectory subBlkDir;
     CCziAttachmentsDirectory attachmentDir;
+    std::shared_ptr<libCZI::ISubBlockAllocator> sub_block_allocator_;  ///< The allocator for the data-parts of sub-blocks (as given with the open-options), may be empty.
+    std::mutex spatial_index_mutex_;        ///< Mutex to protect the creation of the spatial index.
+    std::shared_ptr<const CCziSubBlockSpatialIndex> spatial_index_;    ///< The spatial index (used for "EnumSubset" with a ROI), which is created on the second query with a ROI.
+    bool roi_query_without_spatial_index_done_;    ///< True if a query with a ROI has been answered without the spatial index (i.e. with a linear scan).
+    std::shared_ptr<libCZI::ITaskExecutor> io_task_executor_;          ///< The executor for the I/O of asynchronous operations (as given with the open-options), may be empty.
     bool    isOperational;  ///<    If true, then stream, hdrSegmentData and subBlkDir can be considered valid and operational
 public:
     CCZIReader();
@@ -36,6 +43,11 @@ public:
 
     // interface ISubBlockRepositoryEx
     void EnumerateSubBlocksEx(const std::function<bool(int index, const libCZI::DirectorySubBlockInfo& info)>& funcEnum) override;
+    std::vector<std::shared_ptr<libCZI::ISubBlock>> ReadSubBlocks(const std::vector<int>& indices) override;
+
+    // interface ISubBlockRepositoryMemoryControl
+    std::shared_ptr<libCZI::ISubBlock> ReadSubBlockUsingAllocator(int index, const std::shared_ptr<libCZI::ISubBlockAllocator>& allocator) override;
+    bool TryReadSubBlockData(int index, const std::function<void* (std::uint64_t size)>& get_buffer) override;
 
     // interface ICZIReader
     void Open(const std::shared_ptr<libCZI::IStream>& stream, const ICZIReader::OpenOptions* options) override;
@@ -43,6 +55,8 @@ public:
     std::shared_ptr<libCZI::IMetadataSegment> ReadMetadataSegment() override;
     std::shared_ptr<libCZI::IAccessor> CreateAccessor(libCZI::AccessorType accessorType) override;
     void Close() override;
+    void BeginReadSubBlock(int index, libCZI::TaskPriority priority, const ReadSubBlockCompletion& completion) override;
+    void BeginReadSubBlockAndCreateBitmap(int index, libCZI::TaskPriority priority, const ReadSubBlockAndCreateBitmapCompletion& completion) override;
 
     // interface IAttachmentRepository
     void EnumerateAttachments(const std::function<bool(int index, const libCZI::AttachmentInfo& info)>& funcEnum) override;
@@ -50,8 +64,13 @@ public:
     std::shared_ptr<libCZI::IAttachment> ReadAttachment(int index) override;
 
 private:
-    std::shared_ptr<libCZI::ISubBlock> ReadSubBlock(const CCziSubBlockDirectory::SubBlkEntry& entry);
+    void ReadSubBlockDirectory(libCZI::IStream* stream, const ICZIReader::OpenOptions& options);
+    std::shared_ptr<libCZI::ISubBlock> ReadSubBlock(const CCziSubBlockDirectory::SubBlkEntry& entry, const std::shared_ptr<libCZI::ISubBlockAllocator>& allocator);
+    std::shared_ptr<libCZI::IStream> GetStreamReference(const char* function_name);
+    std::shared_ptr<const CCziSubBlockSpatialIndex> GetSpatialIndexForRoiQuery();
+    std::shared_ptr<libCZI::ITaskExecutor> GetIoTaskExecutor() const;
     std::shared_ptr<libCZI::IAttachment> ReadAttachment(const CCziAttachmentsDirectory::AttachmentEntry& entry);
+    static libCZI::SubBlockInfo GetSubBlockInfo(const CCZIParse::SubBlockData& subBlkData);
     std::shared_ptr<libCZI::IMetadataSegment> ReadMetadataSegment(std::uint64_t position);
 
     void ThrowIfNotOperational();
@@ -11,12 +11,22 @@
 
 using namespace libCZI;
 
-static std::shared_ptr<libCZI::IBitmapData> CreateBitmapFromSubBlock_JpgXr(ISubBlock* subBlk)
+static std::shared_ptr<libCZI::IBitmapData> CreateBitmapFromSubBlock_JpgXr(ISubBlock* subBlk, std::uint32_t downscaleFactor, const IntRect* roi, IntRect* decodedRegion)
 {
     auto dec = GetSite()->GetDecoder(ImageDecoderType::JPXR_JxrLib, nullptr);
     const void* ptr; size_t size;
     subBlk->DangerousGetRawData(ISubBlock::MemBlkType::Data, ptr, size);
     SubBlockInfo subBlockInfo = subBlk->GetSubBlockInfo();
+    if (roi != nullptr)
+    {
+        return dec->DecodeRegion(ptr, size, subBlockInfo.pixelType, subBlockInfo.physicalSize.w, subBlockInfo.physicalSize.h, downscaleFactor, *roi, *decodedRegion);
+    }
+
+    if (downscaleFactor > 1)
+    {
+        return dec->DecodeWithReducedResolution(ptr, size, subBlockInfo.pixelType, subBlockInfo.physicalSize.w, subBlockInfo.physicalSize.h, downscaleFactor);
+    }
+
     return dec->Decode(ptr, size, subBlockInfo.pixelType, subBlockInfo.physicalSize.w, subBlockInfo.physicalSize.h);
 }
 
@@ -70,12 +80,31 @@ static std::shared_ptr<libCZI::IBitmapData> CreateBitmapFromSubBlock_Uncompresse
     return sb;
 }
 
-std::shared_ptr<libCZI::IBitmapData> libCZI::CreateBitmapFromSubBlock(ISubBlock* subBlk)
+static void CheckDownscaleFactor(std::uint32_t downscaleFactor)
 {
-    switch (subBlk->GetSubBlockInfo().GetCompressionMode())
+    if (downscaleFactor != 1 && downscaleFactor != 2 && downscaleFactor != 4 && downscaleFactor != 8 && downscaleFactor != 16)
+    {
+        throw std::invalid_argument("The downscale factor must be one of 1, 2, 4, 8 or 16.");
+    }
+}
+
+static std::shared_ptr<libCZI::IBitmapData> CreateBitmapFromSubBlockInternal(ISubBlock* subBlk, std::uint32_t downscaleFactor, const IntRect* roi, IntRect* decodedRegion)
+{
+    const auto compressionMode = subBlk->GetSubBlockInfo().GetCompressionMode();
+    if (compressionMode == CompressionMode::JpgXr)
+    {
+        return CreateBitmapFromSubBlock_JpgXr(subBlk, downscaleFactor, roi, decodedRegion);
+    }
+
+    // the other decoders can only decode the whole sub-block with full resolution
+    if (decodedRegion != nullptr)
+    {
+        const auto& physicalSize = subBlk->GetSubBlockInfo().physicalSize;
+        *decodedRegion = IntRect{ 0, 0, static_cast<int>(physicalSize.w), static_cast<int>(physicalSize.h) };
+    }
+
+    switch (compressionMode)
     {
-    case CompressionMode::JpgXr:
-        return CreateBitmapFromSubBlock_JpgXr(subBlk);
     case CompressionMode::Zstd0:
         return CreateBitmapFromSubBlock_ZStd0(subBlk);
     case CompressionMode::Zstd1:
@@ -86,3 +115,59 @@ std::shared_ptr<libCZI::IBitmapData> libCZI::CreateBitmapFromSubBlock(ISubBlock*
         throw std::logic_error("The method or operation is not implemented.");
     }
 }
+
+std::shared_ptr<libCZI::IBitmapData> libCZI::CreateBitmapFromSubBlock(ISubBlock* subBlk)
+{
+    return CreateBitmapFromSubBlockInternal(subBlk, 1, nullptr, nullptr);
+}
+
+std::shared_ptr<libCZI::IBitmapData> libCZI::CreateBitmapFromSubBlockWithReducedResolution(ISubBlock* subBlk, std::uint32_t downscaleFactor)
+{
+    CheckDownscaleFactor(downscaleFactor);
+    return CreateBitmapFromSubBlockInternal(subBlk, downscaleFactor, nullptr, nullptr);
+}
+
+std::shared_ptr<libCZI::IBitmapData> libCZI::CreateBitmapFromSubBlockRegion(ISubBlock* subBlk, std::uint32_t downscaleFactor, const IntRect& roi, IntRect& decodedRegion)
+{
+    CheckDownscaleFactor(downscaleFactor);
+    const auto& physicalSize = subBlk->GetSubBlockInfo().physicalSize;
+    if (!roi.IntersectsWith(IntRect{ 0, 0, static_cast<int>(physicalSize.w), static_cast<int>(physicalSize.h) }))
+    {
+        throw std::invalid_argument("The region does not intersect with the sub-block.");
+    }
+
+    return CreateBitmapFromSubBlockInternal(subBlk, downscaleFactor, &roi, &decodedRegion);
+}
+
+bool libCZI::TryDecodeSubBlockRegionInto(ISubBlock* subBlk, const IntRect& roi, void* ptrDestination, std::uint32_t stride)
+{
+    const auto& subBlockInfo = subBlk->GetSubBlockInfo();
+    if (!roi.IsNonEmpty() || roi.x < 0 || roi.y < 0 ||
+        static_cast<std::uint32_t>(roi.x) + static_cast<std::uint32_t>(roi.w) > subBlockInfo.physicalSize.w ||
+        static_cast<std::uint32_t>(roi.y) + static_cast<std::uint32_t>(roi.h) > subBlockInfo.physicalSize.h)
+    {
+        throw std::invalid_argument("The region must be contained in the sub-block.");
+    }
+
+    ImageDecoderType decoderType;
+    switch (subBlockInfo.GetCompressionMode())
+    {
+    case CompressionMode::JpgXr:
+        decoderType = ImageDecoderType::JPXR_JxrLib;
+        break;
+    case CompressionMode::Zstd0:
+        decoderType = ImageDecoderType::ZStd0;
+        break;
+    case CompressionMode::Zstd1:
+        decoderType = ImageDecoderType::ZStd1;
+        break;
+    default:
+        // for an uncompressed sub-block, there is no intermediate bitmap to be saved (the bitmap refers to the data of the sub-block)
+        return false;
+    }
+
+    auto dec = GetSite()->GetDecoder(decoderType, nullptr);
+    const void* ptr; size_t size;
+    subBlk->DangerousGetRawData(ISubBlock::MemBlkType::Data, ptr, size);
+    return dec->TryDecodeRegionInto(ptr, size, subBlockInfo.pixelType, subBlockInfo.physicalSize.w, subBlockInfo.physicalSize.h, roi, ptrDestination, stride);
+}
@@ -7,6 +7,13 @@
 #include "CziStructs.h"
 #include <cassert>
 #include <cstddef>
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
 #include "Site.h"
 
 using namespace std;
@@ -20,6 +27,9 @@ using namespace libCZI;
 /*static*/const std::uint8_t CCZIParse::ATTACHMENTBLKMAGIC[16] = { 'Z','I','S','R','A','W','A','T','T','A','C','H','\0','\0' ,'\0','\0' };
 /*static*/const std::uint8_t CCZIParse::DELETEDSEGMENTMAGIC[16] = { 'D','E','L','E','T','E','D','\0','\0','\0' ,'\0','\0','\0','\0' ,'\0','\0' };
 
+/*static*/constexpr int CCZIParse::kSubBlockDirectoryEntriesPerChunk;
+/*static*/constexpr int CCZIParse::kMaxThreadsForParsingSubBlockDirectory;
+
 /*static*/FileHeaderSegmentData CCZIParse::ReadFileHeaderSegment(libCZI::IStream* str)
 {
     FileHeaderSegment fileHeaderSegment;
@@ -64,7 +74,7 @@ using namespace libCZI;
     return subBlkDir;
 }
 
-/*static*/void CCZIParse::ReadSubBlockDirectory(libCZI::IStream* str, std::uint64_t offset, const std::function<void(const CCziSubBlockDirectoryBase::SubBlkEntry&)>& addFunc, const SubblockDirectoryParseOptions& options, SegmentSizes* segmentSizes /*= nullptr*/)
+/*static*/std::unique_ptr<void, decltype(free)*> CCZIParse::ReadSubBlockDirectoryEntries(libCZI::IStream* str, std::uint64_t offset, SegmentSizes* segmentSizes, std::int32_t& entryCount, std::uint64_t& size)
 {
     SubBlockDirectorySegment subBlckDirSegment;
     std::uint64_t bytesRead;
@@ -128,19 +138,30 @@ using namespace libCZI;
         CCZIParse::ThrowNotEnoughDataRead(offset + sizeof(subBlckDirSegment), subBlkDirSize, bytesRead);
     }
 
-    int currentOffset = 0;
+    entryCount = subBlckDirSegment.data.EntryCount;
+    size = subBlkDirSize;
+    return pBuffer;
+}
+
+/*static*/void CCZIParse::ReadSubBlockDirectory(libCZI::IStream* str, std::uint64_t offset, const std::function<void(const CCziSubBlockDirectoryBase::SubBlkEntry&)>& addFunc, const SubblockDirectoryParseOptions& options, SegmentSizes* segmentSizes /*= nullptr*/)
+{
+    std::int32_t entryCount;
+    std::uint64_t subBlkDirSize;
+    const auto pBuffer = CCZIParse::ReadSubBlockDirectoryEntries(str, offset, segmentSizes, entryCount, subBlkDirSize);
+
+    std::uint64_t currentOffset = 0;
     CCZIParse::ParseThroughDirectoryEntries(
-        subBlckDirSegment.data.EntryCount,
+        entryCount,
         [&](int numberOfBytes, void* ptr)->void
         {
-            if (currentOffset + numberOfBytes <= subBlkDirSize)
+            if (numberOfBytes >= 0 && currentOffset + numberOfBytes <= subBlkDirSize)
             {
                 memcpy(ptr, ((char*)pBuffer.get()) + currentOffset, numberOfBytes);
                 currentOffset += numberOfBytes;
             }
             else
             {
-                CCZIParse::ThrowIllegalData(offset + sizeof(subBlckDirSegment) + currentOffset, "SubBlockDirectory data too small");
+                CCZIParse::ThrowIllegalData(offset + sizeof(SubBlockDirectorySegment) + currentOffset, "SubBlockDirectory data too small");
             }
         },
         [&](const SubBlockDirectoryEntryDE* subBlkDirDE, const SubBlockDirectoryEntryDV* subBlkDirDV)->void
@@ -276,9 +297,434 @@ using namespace libCZI;
     }
 }
 
+/*static*/void CCZIParse::BulkInplacePatchSubBlockDirectory(libCZI::IInputOutputStream* stream, std::uint64_t offset, const std::function<bool(int sub_block_index, char dimension_identifier, int32_t size, int32_t& new_size)>& patchFunc)
+{
+    SubBlockDirectorySegment subBlckDirSegment;
+    std::uint64_t bytesRead;
+    try
+    {
+        stream->Read(offset, &subBlckDirSegment, sizeof(subBlckDirSegment), &bytesRead);
+    }
+    catch (const std::exception&)
+    {
+        std::throw_with_nested(LibCZIIOException("Error reading SubBlkDirectorySegment", offset, sizeof(subBlckDirSegment)));
+    }
+
+    if (bytesRead != sizeof(subBlckDirSegment))
+    {
+        CCZIParse::ThrowNotEnoughDataRead(offset, sizeof(subBlckDirSegment), bytesRead);
+    }
+
+    ConvertToHostByteOrder::Convert(&subBlckDirSegment);
+
+    if (memcmp(subBlckDirSegment.header.Id, CCZIParse::SUBBLKDIRMAGIC, 16) != 0)
+    {
+        CCZIParse::ThrowIllegalData(offset, "Invalid SubBlkDirectory-magic");
+    }
+
+    std::uint64_t subBlkDirSize = subBlckDirSegment.header.UsedSize;
+    if (subBlkDirSize == 0)
+    {
+        // allegedly, "UsedSize" may not be valid in early versions
+        subBlkDirSize = subBlckDirSegment.header.AllocatedSize;
+    }
+
+    if (subBlkDirSize < sizeof(SubBlockDirectorySegmentData))
+    {
+        CCZIParse::ThrowIllegalData(offset, "Invalid SubBlkDirectory-Allocated-Size");
+    }
+
+    subBlkDirSize -= sizeof(SubBlockDirectorySegmentData);
+
+    // now read the complete directory (i.e. all the entries) from the stream in one go
+    const std::uint64_t entriesOffset = offset + sizeof(subBlckDirSegment);
+    std::unique_ptr<void, decltype(free)*> pBuffer(malloc((size_t)subBlkDirSize), free);
+    if (!pBuffer && subBlkDirSize > 0)
+    {
+        throw std::bad_alloc();
+    }
+
+    try
+    {
+        stream->Read(entriesOffset, pBuffer.get(), subBlkDirSize, &bytesRead);
+    }
+    catch (const std::exception&)
+    {
+        std::throw_with_nested(LibCZIIOException("Error reading SubBlkDirectorySegment", entriesOffset, subBlkDirSize));
+    }
+
+    if (bytesRead != subBlkDirSize)
+    {
+        CCZIParse::ThrowNotEnoughDataRead(entriesOffset, subBlkDirSize, bytesRead);
+    }
+
+    uint8_t* const pEntries = static_cast<uint8_t*>(pBuffer.get());
+
+    // the ranges (relative to the start of the buffer) which have been modified, given as [start, end)
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> dirtyRanges;
+
+    std::uint64_t currentOffset = 0;
+    const auto checkAvailable = [&](std::uint64_t numberOfBytes)->void
+        {
+            if (currentOffset + numberOfBytes > subBlkDirSize)
+            {
+                CCZIParse::ThrowIllegalData(entriesOffset + currentOffset, "SubBlockDirectory data too small");
+            }
+        };
+
+    for (int i = 0; i < subBlckDirSegment.data.EntryCount; ++i)
+    {
+        checkAvailable(2);
+        const char schemaType[2] = { static_cast<char>(pEntries[currentOffset]), static_cast<char>(pEntries[currentOffset + 1]) };
+        currentOffset += 2;
+        if (schemaType[0] == 'D' && schemaType[1] == 'V')
+        {
+            SubBlockDirectoryEntryDV dv;
+            checkAvailable(4 + 8 + 4 + 4 + 6 + 4);
+            memcpy(reinterpret_cast<uint8_t*>(&dv) + 2, pEntries + currentOffset, 4 + 8 + 4 + 4 + 6 + 4);
+            currentOffset += 4 + 8 + 4 + 4 + 6 + 4;
+            ConvertToHostByteOrder::Convert(&dv);
+
+            for (int dimension = 0; dimension < dv.DimensionCount; ++dimension)
+            {
+                DimensionEntryDV dimension_entry;
+                checkAvailable(sizeof(DimensionEntryDV));
+                memcpy(&dimension_entry, pEntries + currentOffset, sizeof(DimensionEntryDV));
+                currentOffset += sizeof(DimensionEntryDV);
+                ConvertToHostByteOrder::Convert(&dimension_entry, 1);
+
+                char dimension_identifier;
+                if (IsXDimension(dimension_entry.Dimension, sizeof(dimension_entry.Dimension)))
+                {
+                    dimension_identifier = 'X';
+                }
+                else if (IsYDimension(dimension_entry.Dimension, sizeof(dimension_entry.Dimension)))
+                {
+                    dimension_identifier = 'Y';
+                }
+                else if (IsMDimension(dimension_entry.Dimension, sizeof(dimension_entry.Dimension)))
+                {
+                    dimension_identifier = 'M';
+                }
+                else
+                {
+                    dimension_identifier = Utils::DimensionToChar(CCZIParse::DimensionCharToDimensionIndex(dimension_entry.Dimension, sizeof(dimension_entry.Dimension)));
+                }
+
+                int32_t new_size;
+                bool was_patched = patchFunc(i, dimension_identifier, dimension_entry.StoredSize, new_size);
+                if (was_patched == true)
+                {
+                    // note: the value is written exactly as InplacePatchSubBlockDirectory does it
+                    const std::uint64_t patchOffset = currentOffset - sizeof(DimensionEntryDV) + offsetof(DimensionEntryDV, StoredSize);
+                    memcpy(pEntries + patchOffset, &new_size, sizeof(int32_t));
+                    if (!dirtyRanges.empty() && patchOffset <= dirtyRanges.back().second + CCZIParse::kMaxGapForCoalescingDirtyRanges)
+                    {
+                        dirtyRanges.back().second = (std::max)(dirtyRanges.back().second, patchOffset + sizeof(int32_t));
+                    }
+                    else
+                    {
+                        dirtyRanges.emplace_back(patchOffset, patchOffset + sizeof(int32_t));
+                    }
+                }
+            }
+        }
+        else if (schemaType[0] == 'D' && schemaType[1] == 'E')
+        {
+            // DE-entries are not patched, we just skip them (in the same way as ParseThroughDirectoryEntries does)
+            checkAvailable(sizeof(SubBlockDirectoryEntryDE));
+            currentOffset += sizeof(SubBlockDirectoryEntryDE);
+        }
+    }
+
+    // and finally, write back the modified parts
+    for (const auto& range : dirtyRanges)
+    {
+        const std::uint64_t sizeToWrite = range.second - range.first;
+        std::uint64_t bytesWritten;
+        try
+        {
+            stream->Write(entriesOffset + range.first, pEntries + range.first, sizeToWrite, &bytesWritten);
+        }
+        catch (const std::exception&)
+        {
+            std::throw_with_nested(LibCZIIOException("Error writing SubBlkDirectorySegment", entriesOffset + range.first, sizeToWrite));
+        }
+
+        if (bytesWritten != sizeToWrite)
+        {
+            CCZIParse::ThrowNotEnoughDataWritten(entriesOffset + range.first, sizeToWrite, bytesWritten);
+        }
+    }
+}
+
 /*static*/void CCZIParse::ReadSubBlockDirectory(libCZI::IStream* str, std::uint64_t offset, CCziSubBlockDirectory& subBlkDir, const SubblockDirectoryParseOptions& options)
 {
-    CCZIParse::ReadSubBlockDirectory(str, offset, [&](const CCziSubBlockDirectoryBase::SubBlkEntry& e)->void {subBlkDir.AddSubBlock(e); }, options, nullptr);
+    std::int32_t entryCount;
+    std::uint64_t subBlkDirSize;
+    const auto pBuffer = CCZIParse::ReadSubBlockDirectoryEntries(str, offset, nullptr, entryCount, subBlkDirSize);
+    const std::uint8_t* pEntries = static_cast<const std::uint8_t*>(pBuffer.get());
+    const std::uint64_t entriesOffset = offset + sizeof(SubBlockDirectorySegment);
+
+    // first, we determine the boundaries of the chunks (of "kSubBlockDirectoryEntriesPerChunk" entries each), which
+    //  can then be parsed independently
+    const auto chunkOffsets = CCZIParse::DetermineSubBlockDirectoryChunks(pEntries, subBlkDirSize, entryCount, entriesOffset);
+    const int chunkCount = static_cast<int>(chunkOffsets.size()) - 1;
+    subBlkDir.Reserve(entryCount > 0 ? entryCount : 0);
+
+    const auto parseChunk = [&](int chunk, std::vector<CCziSubBlockDirectoryBase::SubBlkEntry>& entries)->void
+        {
+            CCZIParse::ParseSubBlockDirectoryChunk(
+                pEntries + chunkOffsets[chunk],
+                chunkOffsets[chunk + 1] - chunkOffsets[chunk],
+                (std::min)(CCZIParse::kSubBlockDirectoryEntriesPerChunk, entryCount - chunk * CCZIParse::kSubBlockDirectoryEntriesPerChunk),
+                entriesOffset + chunkOffsets[chunk],
+                options,
+                entries);
+        };
+    const auto addEntries = [&](const std::vector<CCziSubBlockDirectoryBase::SubBlkEntry>& entries)->void
+        {
+            for (const auto& entry : entries)
+            {
+                subBlkDir.AddSubBlock(entry);
+            }
+        };
+    const auto parseSequentially = [&]()->void
+        {
+            std::vector<CCziSubBlockDirectoryBase::SubBlkEntry> entries;
+            for (int chunk = 0; chunk < chunkCount; ++chunk)
+            {
+                parseChunk(chunk, entries);
+                addEntries(entries);
+            }
+        };
+
+    const int numberOfThreads = (std::min)((std::min)(static_cast<int>(std::thread::hardware_concurrency()), CCZIParse::kMaxThreadsForParsingSubBlockDirectory), chunkCount);
+    if (numberOfThreads < 2)
+    {
+        parseSequentially();
+        return;
+    }
+
+    // The chunks are parsed by worker threads, and the results are added to the directory (in the order of the chunks) on
+    //  the calling thread. In order to limit the memory consumption, the workers may only run ahead of the chunks which have
+    //  been added by a fixed number of chunks - the results are stored in a ring buffer of this size.
+    struct ChunkResult
+    {
+        std::vector<CCziSubBlockDirectoryBase::SubBlkEntry> entries;
+        std::exception_ptr exception;
+        bool ready = false;
+    };
+
+    const int window = 2 * numberOfThreads;
+    std::vector<ChunkResult> results(window);
+    std::mutex mutex;
+    std::condition_variable condition;
+    int nextChunk = 0;
+    int chunksAdded = 0;
+    bool cancel = false;
+
+    const auto worker = [&]()->void
+        {
+            for (;;)
+            {
+                int chunk;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [&]()->bool {return cancel || nextChunk >= chunkCount || nextChunk < chunksAdded + window; });
+                    if (cancel || nextChunk >= chunkCount)
+                    {
+                        return;
+                    }
+
+                    chunk = nextChunk++;
+                }
+
+                ChunkResult& result = results[chunk % window];
+                try
+                {
+                    parseChunk(chunk, result.entries);
+                }
+                catch (...)
+                {
+                    result.exception = std::current_exception();
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    result.ready = true;
+                }
+
+                condition.notify_all();
+            }
+        };
+
+    std::vector<std::thread> workers;
+    workers.reserve(numberOfThreads);
+    for (int i = 0; i < numberOfThreads; ++i)
+    {
+        try
+        {
+            workers.emplace_back(worker);
+        }
+        catch (const std::system_error&)
+        {
+            // if no more threads can be created, we go on with the ones we have
+            break;
+        }
+    }
+
+    if (workers.empty())
+    {
+        parseSequentially();
+        return;
+    }
+
+    // if parsing a chunk failed, we report the error for the first chunk in file order - which is the same error as
+    //  we would get when parsing sequentially
+    std::exception_ptr exception;
+    try
+    {
+        for (int chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            ChunkResult& result = results[chunk % window];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&]()->bool {return result.ready; });
+            }
+
+            if (result.exception)
+            {
+                std::rethrow_exception(result.exception);
+            }
+
+            addEntries(result.entries);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                result.ready = false;
+                ++chunksAdded;
+            }
+
+            condition.notify_all();
+        }
+    }
+    catch (...)
+    {
+        exception = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancel = true;
+    }
+
+    condition.notify_all();
+    for (auto& thread : workers)
+    {
+        thread.join();
+    }
+
+    if (exception)
+    {
+        std::rethrow_exception(exception);
+    }
+}
+
+/*static*/std::uint64_t CCZIParse::GetSubBlockDirectoryEntrySize(const std::uint8_t* ptrData, std::uint64_t size, std::uint64_t fileOffset)
+{
+    // the size of the fixed part of a DV-entry (i.e. without the dimension-entries)
+    static constexpr std::uint64_t kSizeOfFixedPartDV = 2 + 4 + 8 + 4 + 4 + 6 + 4;
+
+    if (size < 2)
+    {
+        CCZIParse::ThrowIllegalData(fileOffset, "SubBlockDirectory data too small");
+    }
+
+    std::uint64_t entrySize;
+    if (ptrData[0] == 'D' && ptrData[1] == 'V')
+    {
+        if (size < kSizeOfFixedPartDV)
+        {
+            CCZIParse::ThrowIllegalData(fileOffset, "SubBlockDirectory data too small");
+        }
+
+        SubBlockDirectoryEntryDV dv;
+        memcpy(&dv, ptrData, kSizeOfFixedPartDV);
+        ConvertToHostByteOrder::Convert(&dv);
+        if (dv.DimensionCount < 0 || dv.DimensionCount > MAXDIMENSIONS)
+        {
+            CCZIParse::ThrowIllegalData(fileOffset, "Invalid DimensionCount in SubBlockDirectory-entry");
+        }
+
+        entrySize = kSizeOfFixedPartDV + dv.DimensionCount * sizeof(DimensionEntryDV);
+    }
+    else if (ptrData[0] == 'D' && ptrData[1] == 'E')
+    {
+        entrySize = 2 + sizeof(SubBlockDirectoryEntryDE);
+    }
+    else
+    {
+        // an unknown schema-type is skipped (in the same way as ParseThroughDirectoryEntries does)
+        entrySize = 2;
+    }
+
+    if (size < entrySize)
+    {
+        CCZIParse::ThrowIllegalData(fileOffset, "SubBlockDirectory data too small");
+    }
+
+    return entrySize;
+}
+
+/*static*/std::vector<std::uint64_t> CCZIParse::DetermineSubBlockDirectoryChunks(const std::uint8_t* ptrData, std::uint64_t size, std::int32_t entryCount, std::uint64_t fileOffset)
+{
+    std::vector<std::uint64_t> chunkOffsets;
+    chunkOffsets.reserve(entryCount > 0 ? 1 + (entryCount + CCZIParse::kSubBlockDirectoryEntriesPerChunk - 1) / CCZIParse::kSubBlockDirectoryEntriesPerChunk : 1);
+    std::uint64_t currentOffset = 0;
+    for (std::int32_t i = 0; i < entryCount; ++i)
+    {
+        if (i % CCZIParse::kSubBlockDirectoryEntriesPerChunk == 0)
+        {
+            chunkOffsets.push_back(currentOffset);
+        }
+
+        currentOffset += CCZIParse::GetSubBlockDirectoryEntrySize(ptrData + currentOffset, size - currentOffset, fileOffset + currentOffset);
+    }
+
+    chunkOffsets.push_back(currentOffset);
+    return chunkOffsets;
+}
+
+/*static*/void CCZIParse::ParseSubBlockDirectoryChunk(const std::uint8_t* ptrData, std::uint64_t size, int entryCount, std::uint64_t fileOffset, const SubblockDirectoryParseOptions& options, std::vector<CCziSubBlockDirectoryBase::SubBlkEntry>& entries)
+{
+    entries.resize(entryCount);
+    int numberOfEntries = 0;
+    std::uint64_t currentOffset = 0;
+    for (int i = 0; i < entryCount; ++i)
+    {
+        const std::uint8_t* ptrEntry = ptrData + currentOffset;
+        const std::uint64_t entrySize = CCZIParse::GetSubBlockDirectoryEntrySize(ptrEntry, size - currentOffset, fileOffset + currentOffset);
+        if (ptrEntry[0] == 'D' && ptrEntry[1] == 'V')
+        {
+            SubBlockDirectoryEntryDV dv;
+            memcpy(&dv, ptrEntry, entrySize);
+            ConvertToHostByteOrder::Convert(&dv);
+            ConvertToHostByteOrder::Convert(&dv.DimensionEntries[0], dv.DimensionCount);
+            CCZIParse::ConvertToSubBlockDirectoryEntry(&dv, options, entries[numberOfEntries++]);
+        }
+        else if (ptrEntry[0] == 'D' && ptrEntry[1] == 'E')
+        {
+            SubBlockDirectoryEntryDE de;
+            memcpy(&de, ptrEntry + 2, sizeof(de));
+            ConvertToHostByteOrder::Convert(&de);
+            CCZIParse::AddEntryToSubBlockDirectory(&de, [&](const CCziSubBlockDirectoryBase::SubBlkEntry& e)->void {entries[numberOfEntries++] = e; });
+        }
+
+        currentOffset += entrySize;
+    }
+
+    entries.resize(numberOfEntries);
 }
 
 /*static*/CCziAttachmentsDirectory CCZIParse::ReadAttachmentsDirectory(libCZI::IStream* str, std::uint64_t offset)
@@ -367,9 +813,8 @@ using namespace libCZI;
     }
 }
 
-/*static*/CCZIParse::SubBlockData CCZIParse::ReadSubBlock(libCZI::IStream* str, std::uint64_t offset, const SubBlockStorageAllocate& allocateInfo)
+/*static*/std::uint32_t CCZIParse::ReadSubBlockSegmentHeader(libCZI::IStream* str, std::uint64_t offset, SubBlockSegment& subBlckSegment, SubBlockData& sbd)
 {
-    SubBlockSegment subBlckSegment;
     std::uint64_t bytesRead;
 
     // the minimum guaranteed size we can read here is "sizeof(SegmentHeader) + SIZE_SUBBLOCKDATA_MINIMUM", it is NOT sizeof(SubBlockSegment)
@@ -397,7 +842,6 @@ using namespace libCZI;
     }
 
     uint32_t lengthSubblockSegmentData = 0;
-    SubBlockData sbd;
     if (subBlckSegment.data.entrySchema[0] == 'D' && subBlckSegment.data.entrySchema[1] == 'V')
     {
         ConvertToHostByteOrder::Convert(&subBlckSegment.data.entryDV);
@@ -484,7 +928,15 @@ using namespace libCZI;
     // the minimal size of the "subblock-segment-data" is given by "SIZE_SUBBLOCKDATA_MINIMUM", but the actual size of the
     //  data-structure (SubBlockDirectoryEntryDV) may be larger than that - so we need to take the max of the actual size and
     //  the reserved (minimal) size here
-    lengthSubblockSegmentData = max(lengthSubblockSegmentData, (uint32_t)SIZE_SUBBLOCKDATA_MINIMUM);
+    return max(lengthSubblockSegmentData, (uint32_t)SIZE_SUBBLOCKDATA_MINIMUM);
+}
+
+/*static*/CCZIParse::SubBlockData CCZIParse::ReadSubBlock(libCZI::IStream* str, std::uint64_t offset, const SubBlockStorageAllocate& allocateInfo)
+{
+    SubBlockSegment subBlckSegment;
+    SubBlockData sbd;
+    const uint32_t lengthSubblockSegmentData = CCZIParse::ReadSubBlockSegmentHeader(str, offset, subBlckSegment, sbd);
+    std::uint64_t bytesRead;
 
     // TODO: if subBlckSegment.data.DataSize > size_t (=4GB for 32Bit) then bail out gracefully
     auto deleter = [&](void* ptr) -> void {allocateInfo.free(ptr); };
@@ -554,6 +1006,77 @@ using namespace libCZI;
     return sbd;
 }
 
+/*static*/bool CCZIParse::TryReadSubBlockDirect(libCZI::IStreamEx* str, std::uint64_t offset, SubBlockData& subBlockData, std::shared_ptr<const void>& spData, std::shared_ptr<const void>& spAttachment, std::shared_ptr<const void>& spMetadata)
+{
+    SubBlockSegment subBlckSegment;
+    const uint32_t lengthSubblockSegmentData = CCZIParse::ReadSubBlockSegmentHeader(str, offset, subBlckSegment, subBlockData);
+
+    // metadata, data and attachment are stored contiguously (in this order) after the sub-block segment header, so
+    //  we request direct access for the complete range
+    const std::uint64_t startOfMetadata = offset + lengthSubblockSegmentData + sizeof(SegmentHeader);
+    const std::uint64_t totalSize = static_cast<std::uint64_t>(subBlckSegment.data.MetadataSize) + subBlckSegment.data.DataSize + subBlckSegment.data.AttachmentSize;
+    std::shared_ptr<const void> spMemory;
+    if (totalSize > 0)
+    {
+        if (!str->TryGetDirectAccess(startOfMetadata, totalSize, spMemory))
+        {
+            return false;
+        }
+    }
+
+    const uint8_t* ptrMemory = static_cast<const uint8_t*>(spMemory.get());
+    spMetadata = subBlckSegment.data.MetadataSize > 0 ? std::shared_ptr<const void>(spMemory, ptrMemory) : nullptr;
+    spData = subBlckSegment.data.DataSize > 0 ? std::shared_ptr<const void>(spMemory, ptrMemory + subBlckSegment.data.MetadataSize) : nullptr;
+    spAttachment = subBlckSegment.data.AttachmentSize > 0 ? std::shared_ptr<const void>(spMemory, ptrMemory + subBlckSegment.data.MetadataSize + subBlckSegment.data.DataSize) : nullptr;
+
+    subBlockData.ptrData = nullptr;
+    subBlockData.dataSize = subBlckSegment.data.DataSize;
+    subBlockData.ptrAttachment = nullptr;
+    subBlockData.attachmentSize = subBlckSegment.data.AttachmentSize;
+    subBlockData.ptrMetadata = nullptr;
+    subBlockData.metaDataSize = subBlckSegment.data.MetadataSize;
+    return true;
+}
+
+/*static*/CCZIParse::SubBlockDataLocation CCZIParse::ReadSubBlockDataLocation(libCZI::IStream* str, std::uint64_t offset)
+{
+    SubBlockSegment subBlckSegment;
+    SubBlockData sbd;
+    const uint32_t lengthSubblockSegmentData = CCZIParse::ReadSubBlockSegmentHeader(str, offset, subBlckSegment, sbd);
+
+    SubBlockDataLocation location;
+    location.dataOffset = offset + sizeof(SegmentHeader) + lengthSubblockSegmentData + subBlckSegment.data.MetadataSize;
+    location.dataSize = subBlckSegment.data.DataSize;
+    location.compression = sbd.compression;
+    location.segmentSize = sizeof(SegmentHeader) + lengthSubblockSegmentData + static_cast<std::uint64_t>(subBlckSegment.data.MetadataSize) + subBlckSegment.data.DataSize + subBlckSegment.data.AttachmentSize;
+    return location;
+}
+
+/*static*/std::uint64_t CCZIParse::ReadSubBlockDataPrefix(libCZI::IStream* str, const SubBlockDataLocation& location, void* ptrBuffer, std::uint64_t bufferSize)
+{
+    const uint64_t bytesToRead = min(bufferSize, location.dataSize);
+    if (bytesToRead == 0)
+    {
+        return 0;
+    }
+
+    std::uint64_t bytesRead;
+    try
+    {
+        str->Read(location.dataOffset, ptrBuffer, bytesToRead, &bytesRead);
+    }
+    catch (const std::exception&)
+    {
+        std::throw_with_nested(LibCZIIOException("Error reading SubBlock-data", location.dataOffset, bytesToRead));
+    }
+
+    if (bytesRead != bytesToRead)
+    {
+        CCZIParse::ThrowNotEnoughDataRead(location.dataOffset, bytesToRead, bytesRead);
+    }
+
+    return bytesRead;
+}
 
 /*static*/void CCZIParse::InplacePatchSubblock(
                     libCZI::IInputOutputStream* stream,
@@ -714,8 +1237,12 @@ using namespace libCZI;
             funcRead(4 + 8 + 4 + 4 + 6 + 4, reinterpret_cast<uint8_t*>(&dv) + 2);
             ConvertToHostByteOrder::Convert(&dv);
 
+            if (dv.DimensionCount < 0 || dv.DimensionCount > MAXDIMENSIONS)
+            {
+                CCZIParse::ThrowIllegalData("Invalid DimensionCount in SubBlockDirectory-entry");
+            }
+
             int sizeToRead = dv.DimensionCount * sizeof(DimensionEntryDV);
-            // TODO: check for max size etc.
             funcRead(sizeToRead, &dv.DimensionEntries[0]);
             ConvertToHostByteOrder::Convert(&dv.DimensionEntries[0], dv.DimensionCount);
 
@@ -740,7 +1267,14 @@ using namespace libCZI;
 /*static*/void CCZIParse::AddEntryToSubBlockDirectory(const SubBlockDirectoryEntryDV* subBlkDirDV, const std::function<void(const CCziSubBlockDirectoryBase::SubBlkEntry&)>& addFunc, const SubblockDirectoryParseOptions& options)
 {
     CCziSubBlockDirectory::SubBlkEntry entry;
+    CCZIParse::ConvertToSubBlockDirectoryEntry(subBlkDirDV, options, entry);
+    addFunc(entry);
+}
+
+/*static*/void CCZIParse::ConvertToSubBlockDirectoryEntry(const SubBlockDirectoryEntryDV* subBlkDirDV, const SubblockDirectoryParseOptions& options, CCziSubBlockDirectoryBase::SubBlkEntry& entry)
+{
     entry.Invalidate();
+    entry.coordinate.Clear();
 
     bool x_was_given = false;
     bool y_was_given = false;
@@ -851,8 +1385,6 @@ using namespace libCZI;
     entry.PixelType = subBlkDirDV->PixelType;
     entry.Compression = subBlkDirDV->Compression;
     entry.pyramid_type_from_spare = subBlkDirDV->_spare[0];
-
-    addFunc(entry);
 }
 
 /*static*/CCZIParse::MetadataSegmentData CCZIParse::ReadMetadataSegment(libCZI::IStream* str, std::uint64_t offset, const SubBlockStorageAllocate& allocateInfo)
@@ -1016,6 +1548,13 @@ using namespace libCZI;
     throw LibCZICZIParseException(ss.str().c_str(), LibCZICZIParseException::ErrorCode::NotEnoughData);
 }
 
+/*static*/void CCZIParse::ThrowNotEnoughDataWritten(std::uint64_t offset, std::uint64_t bytesToWrite, std::uint64_t bytesActuallyWritten)
+{
+    stringstream ss;
+    ss << "Not enough data written at offset " << offset << " -> bytes to write: " << bytesToWrite << " bytes, actually written " << bytesActuallyWritten << " bytes.";
+    throw LibCZIWriteException(ss.str().c_str(), LibCZIWriteException::ErrorType::NotEnoughDataWritten);
+}
+
 /*static*/void CCZIParse::ThrowIllegalData(std::uint64_t offset, const char* sz)
 {
     stringstream ss;
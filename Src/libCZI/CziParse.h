@@ -4,8 +4,11 @@
 
 #pragma once
 
+#include <cstdlib>
 #include <functional>
 #include <bitset>
+#include <memory>
+#include <vector>
 
 #include "CziSubBlockDirectory.h"
 #include "CziAttachmentsDirectory.h"
@@ -109,6 +112,10 @@ public:
             this->SetDimensionOtherThanMMustHaveSizeOne(true);
             this->SetDimensionMMustHaveSizeOne(true);
         }
+        /// Gets the options as a bitmask, which allows to check whether two sets of options are identical.
+        ///
+        /// \returns    The options as a bitmask.
+        std::uint32_t GetBitmask() const { return static_cast<std::uint32_t>(this->flags.to_ulong()); }
     private:
         void SetFlag(ParseFlags flag, bool enable);
         bool GetFlag(ParseFlags flag) const;
@@ -148,8 +155,25 @@ public:
     static CCziAttachmentsDirectory ReadAttachmentsDirectory(libCZI::IStream* str, std::uint64_t offset);
     static void ReadAttachmentsDirectory(libCZI::IStream* str, std::uint64_t offset, const std::function<void(const CCziAttachmentsDirectoryBase::AttachmentEntry&)>& addFunc, SegmentSizes* segmentSizes);
 
+    /// Parse the subblock-directory from the specified stream at the specified offset and add the entries to the specified
+    /// subblock-directory object. The directory is read with a single read operation, then the boundaries of the entries are
+    /// determined (DV-entries are self-describing by their dimension count), and for large directories chunks of entries are
+    /// parsed concurrently on multiple threads. The entries are added to the directory object in the order in which they are
+    /// given in the file, so the result is identical to parsing the directory sequentially.
+    ///
+    /// \param [in,out] str         The stream to read from.
+    /// \param          offset      The offset in the stream.
+    /// \param [in,out] subBlkDir   The subblock-directory object to which the entries are added.
+    /// \param          options     Options controlling the operation, allowing to choose various variants for parsing.
     static void ReadSubBlockDirectory(libCZI::IStream* str, std::uint64_t offset, CCziSubBlockDirectory& subBlkDir, const SubblockDirectoryParseOptions& options);
 
+    /// The number of subblock-directory entries which are parsed as one unit of work (when parsing the subblock-directory
+    /// concurrently). If a directory contains no more than this number of entries, it is parsed on the calling thread.
+    static constexpr int kSubBlockDirectoryEntriesPerChunk = 4096;
+
+    /// The maximal number of worker threads used for parsing the subblock-directory.
+    static constexpr int kMaxThreadsForParsingSubBlockDirectory = 8;
+
     static void ReadSubBlockDirectory(libCZI::IStream* str, std::uint64_t offset, const std::function<void(const CCziSubBlockDirectoryBase::SubBlkEntry&)>& addFunc, const SubblockDirectoryParseOptions& options, SegmentSizes* segmentSizes);
 
     static void InplacePatchSubBlockDirectory(
@@ -157,6 +181,19 @@ public:
                         std::uint64_t offset,
                         const std::function<bool(int sub_block_index, char dimension_identifier, std::int32_t size, std::int32_t& new_coordinate)>& patchFunc);
 
+    /// Patches the sub-block directory in place - this operation gives the same result as "InplacePatchSubBlockDirectory",
+    /// but the directory is read from the stream in one go, patched in memory, and then only the modified parts are
+    /// written back (where modified parts which are close to each other are coalesced into one write operation).
+    /// The functor is called in the same order and with the same arguments as with "InplacePatchSubBlockDirectory".
+    ///
+    /// \param [in] stream      The stream to operate on.
+    /// \param      offset      The offset of the sub-block directory segment.
+    /// \param      patchFunc   The patch function - if it returns true, the stored-size is to be replaced with the value given in "new_size".
+    static void BulkInplacePatchSubBlockDirectory(
+                        libCZI::IInputOutputStream* stream,
+                        std::uint64_t offset,
+                        const std::function<bool(int sub_block_index, char dimension_identifier, std::int32_t size, std::int32_t& new_size)>& patchFunc);
+
     static void InplacePatchSubblock(
                         libCZI::IInputOutputStream* stream,
                         std::uint64_t offset,
@@ -188,6 +225,52 @@ public:
 
     static SubBlockData ReadSubBlock(libCZI::IStream* str, std::uint64_t offset, const SubBlockStorageAllocate& allocateInfo);
 
+    /// Attempts to read the sub-block at the specified offset without copying its data-parts - i.e. the data, the
+    /// attachment and the metadata are referenced directly in the memory provided by the stream (c.f. IStreamEx).
+    /// The pointers in the returned SubBlockData are not used (they are set to null), instead the data-parts are given
+    /// by the shared_ptrs, which keep the underlying memory valid. If the stream is not able to provide direct access,
+    /// false is returned (and the caller should fall back to "ReadSubBlock").
+    ///
+    /// \param [in]     str             The stream to read from.
+    /// \param          offset          The offset of the sub-block segment in the stream.
+    /// \param [out]    subBlockData    Information about the sub-block is put here.
+    /// \param [out]    spData          The data-part of the sub-block (null if the size is zero).
+    /// \param [out]    spAttachment    The attachment-part of the sub-block (null if the size is zero).
+    /// \param [out]    spMetadata      The metadata-part of the sub-block (null if the size is zero).
+    ///
+    /// \returns    True if it succeeds; false if the stream could not give direct access to the data-parts.
+    static bool TryReadSubBlockDirect(libCZI::IStreamEx* str, std::uint64_t offset, SubBlockData& subBlockData, std::shared_ptr<const void>& spData, std::shared_ptr<const void>& spAttachment, std::shared_ptr<const void>& spMetadata);
+
+    /// Information about where the data-part of a sub-block is located in the stream.
+    struct SubBlockDataLocation
+    {
+        std::uint64_t   dataOffset;     ///< The offset in the stream where the data-part of the sub-block starts.
+        std::uint64_t   dataSize;       ///< The size of the data-part in bytes.
+        int             compression;    ///< The (raw) compression-mode identifier of the sub-block.
+        std::uint64_t   segmentSize;    ///< The size of the sub-block segment up to the end of the attachment (i.e. the number of bytes which need to be read in order to get the complete sub-block).
+    };
+
+    /// Reads the header of the sub-block segment at the specified offset and determines the location
+    /// of its data-part. In contrast to "ReadSubBlock", neither the data nor the metadata or the attachment
+    /// are read.
+    ///
+    /// \param [in] str     The stream to read from.
+    /// \param      offset  The offset of the sub-block segment in the stream.
+    ///
+    /// \returns    Information about the location of the data-part.
+    static SubBlockDataLocation ReadSubBlockDataLocation(libCZI::IStream* str, std::uint64_t offset);
+
+    /// Reads (at most) the specified number of bytes from the beginning of the data-part of a sub-block.
+    /// If the data-part is smaller than the buffer, then only the data-part is read.
+    ///
+    /// \param [in]     str         The stream to read from.
+    /// \param          location    The location of the data-part (as determined by "ReadSubBlockDataLocation").
+    /// \param [out]    ptrBuffer   The buffer where the data is to be put.
+    /// \param          bufferSize  The size of the buffer in bytes.
+    ///
+    /// \returns    The number of bytes which were read.
+    static std::uint64_t ReadSubBlockDataPrefix(libCZI::IStream* str, const SubBlockDataLocation& location, void* ptrBuffer, std::uint64_t bufferSize);
+
     struct MetadataSegmentData
     {
         void* ptrXmlData;
@@ -209,10 +292,22 @@ public:
     static CCZIParse::SegmentSizes ReadSegmentHeader(SegmentType type, libCZI::IStream* str, std::uint64_t pos);
     static CCZIParse::SegmentSizes ReadSegmentHeaderAny(libCZI::IStream* str, std::uint64_t pos);
 private:
+    /// When patching the sub-block directory in memory, modified ranges which are separated by no more than
+    /// this number of bytes are written back with a single write operation.
+    static constexpr std::uint64_t kMaxGapForCoalescingDirtyRanges = 4096;
+
+    static std::uint32_t ReadSubBlockSegmentHeader(libCZI::IStream* str, std::uint64_t offset, SubBlockSegment& subBlckSegment, SubBlockData& sbd);
+
     static void ParseThroughDirectoryEntries(int count, const std::function<void(int, void*)>& funcRead, const std::function<void(const SubBlockDirectoryEntryDE*, const SubBlockDirectoryEntryDV*)>& funcAddEntry);
 
     static void AddEntryToSubBlockDirectory(const SubBlockDirectoryEntryDE* subBlkDirDE, const std::function<void(const CCziSubBlockDirectoryBase::SubBlkEntry&)>& addFunc);
     static void AddEntryToSubBlockDirectory(const SubBlockDirectoryEntryDV* subBlkDirDV, const std::function<void(const CCziSubBlockDirectoryBase::SubBlkEntry&)>& addFunc, const SubblockDirectoryParseOptions& options);
+    static void ConvertToSubBlockDirectoryEntry(const SubBlockDirectoryEntryDV* subBlkDirDV, const SubblockDirectoryParseOptions& options, CCziSubBlockDirectoryBase::SubBlkEntry& entry);
+
+    static std::unique_ptr<void, decltype(free)*> ReadSubBlockDirectoryEntries(libCZI::IStream* str, std::uint64_t offset, SegmentSizes* segmentSizes, std::int32_t& entryCount, std::uint64_t& size);
+    static std::vector<std::uint64_t> DetermineSubBlockDirectoryChunks(const std::uint8_t* ptrData, std::uint64_t size, std::int32_t entryCount, std::uint64_t fileOffset);
+    static void ParseSubBlockDirectoryChunk(const std::uint8_t* ptrData, std::uint64_t size, int entryCount, std::uint64_t fileOffset, const SubblockDirectoryParseOptions& options, std::vector<CCziSubBlockDirectoryBase::SubBlkEntry>& entries);
+    static std::uint64_t GetSubBlockDirectoryEntrySize(const std::uint8_t* ptrData, std::uint64_t size, std::uint64_t fileOffset);
 
     static libCZI::DimensionIndex DimensionCharToDimensionIndex(const char* ptr, size_t size);
     static bool IsMDimension(const char* ptr, size_t size);
@@ -221,6 +316,7 @@ private:
     static char ToUpperCase(char c);
 
     static void ThrowNotEnoughDataRead(std::uint64_t offset, std::uint64_t bytesRequested, std::uint64_t bytesActuallyRead);
+    static void ThrowNotEnoughDataWritten(std::uint64_t offset, std::uint64_t bytesToWrite, std::uint64_t bytesActuallyWritten);
     static void ThrowIllegalData(std::uint64_t offset, const char* sz);
     static void ThrowIllegalData(const char* sz);
 
@@ -21,6 +21,18 @@ CCziSubBlock::CCziSubBlock(const libCZI::SubBlockInfo& info, const CCZIParse::Su
 {
 }
 
+CCziSubBlock::CCziSubBlock(const libCZI::SubBlockInfo& info, const CCZIParse::SubBlockData& data, std::shared_ptr<const void> spData, std::shared_ptr<const void> spAttachment, std::shared_ptr<const void> spMetadata)
+    :
+    spData(std::move(spData)),
+    spAttachment(std::move(spAttachment)),
+    spMetadata(std::move(spMetadata)),
+    dataSize(data.dataSize),
+    attachmentSize(data.attachmentSize),
+    metaDataSize(data.metaDataSize),
+    info(info)
+{
+}
+
 CCziSubBlock::~CCziSubBlock()
 {
 }
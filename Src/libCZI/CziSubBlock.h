@@ -18,6 +18,10 @@ private:
     libCZI::SubBlockInfo    info;
 public:
     CCziSubBlock(const libCZI::SubBlockInfo& info, const CCZIParse::SubBlockData& data, std::function<void(void*)> deleter);
+
+    /// Constructor for the case where the data-parts are already owned by shared_ptrs (e.g. when they refer directly to
+    /// memory provided by the stream). The pointers in "data" are not used, only the sizes.
+    CCziSubBlock(const libCZI::SubBlockInfo& info, const CCZIParse::SubBlockData& data, std::shared_ptr<const void> spData, std::shared_ptr<const void> spAttachment, std::shared_ptr<const void> spMetadata);
     ~CCziSubBlock() override;
 
     // interface ISubBlock
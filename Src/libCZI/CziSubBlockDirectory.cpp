@@ -4,6 +4,7 @@
 
 #include "CziSubBlockDirectory.h"
 #include "CziUtils.h"
+#include "utilities.h"
 
 using namespace libCZI;
 using namespace std;
@@ -41,6 +42,13 @@ void CSbBlkStatisticsUpdater::Clear()
     this->pyramidStatisticsDirty = false;
 }
 
+void CSbBlkStatisticsUpdater::SetStatistics(const libCZI::SubBlockStatistics& statistics, const libCZI::PyramidStatistics& pyramidStatistics)
+{
+    this->statistics = statistics;
+    this->pyramidStatistics = pyramidStatistics;
+    this->pyramidStatisticsDirty = false;
+}
+
 void CSbBlkStatisticsUpdater::UpdateStatistics(const CCziSubBlockDirectoryBase::SubBlkEntry& entry)
 {
     // TODO: check validity of x,y etc.
@@ -370,6 +378,22 @@ CCziSubBlockDirectory::CCziSubBlockDirectory() : state(State::AddingAllowed)
 {
 }
 
+void CCziSubBlockDirectory::Reserve(size_t count)
+{
+    this->subBlks.x.reserve(count);
+    this->subBlks.y.reserve(count);
+    this->subBlks.width.reserve(count);
+    this->subBlks.height.reserve(count);
+    this->subBlks.storedWidth.reserve(count);
+    this->subBlks.storedHeight.reserve(count);
+    this->subBlks.mIndex.reserve(count);
+    this->subBlks.pixelType.reserve(count);
+    this->subBlks.compression.reserve(count);
+    this->subBlks.filePosition.reserve(count);
+    this->subBlks.coordinateIndex.reserve(count);
+    this->subBlks.pyramidTypeFromSpare.reserve(count);
+}
+
 void CCziSubBlockDirectory::AddSubBlock(const SubBlkEntry& entry)
 {
     if (this->state != State::AddingAllowed)
@@ -377,7 +401,24 @@ void CCziSubBlockDirectory::AddSubBlock(const SubBlkEntry& entry)
         throw std::logic_error("The object is not allowing to add subblocks any more.");
     }
 
-    this->subBlks.push_back(entry);
+    const auto it = this->coordinateLookup.insert(std::make_pair(entry.coordinate, static_cast<std::uint32_t>(this->coordinates.size())));
+    if (it.second)
+    {
+        this->coordinates.push_back(entry.coordinate);
+    }
+
+    this->subBlks.x.push_back(entry.x);
+    this->subBlks.y.push_back(entry.y);
+    this->subBlks.width.push_back(entry.width);
+    this->subBlks.height.push_back(entry.height);
+    this->subBlks.storedWidth.push_back(entry.storedWidth);
+    this->subBlks.storedHeight.push_back(entry.storedHeight);
+    this->subBlks.mIndex.push_back(entry.mIndex);
+    this->subBlks.pixelType.push_back(entry.PixelType);
+    this->subBlks.compression.push_back(entry.Compression);
+    this->subBlks.filePosition.push_back(entry.FilePosition);
+    this->subBlks.coordinateIndex.push_back(it.first->second);
+    this->subBlks.pyramidTypeFromSpare.push_back(entry.pyramid_type_from_spare);
     this->sblkStatistics.UpdateStatistics(entry);
 }
 
@@ -385,6 +426,22 @@ void CCziSubBlockDirectory::AddingFinished()
 {
     this->state = State::AddingFinished;
     this->sblkStatistics.Consolidate();
+
+    // the lookup-map is only needed while adding, and we release the excess capacity of the arrays
+    this->coordinateLookup.clear();
+    this->coordinates.shrink_to_fit();
+    this->subBlks.x.shrink_to_fit();
+    this->subBlks.y.shrink_to_fit();
+    this->subBlks.width.shrink_to_fit();
+    this->subBlks.height.shrink_to_fit();
+    this->subBlks.storedWidth.shrink_to_fit();
+    this->subBlks.storedHeight.shrink_to_fit();
+    this->subBlks.mIndex.shrink_to_fit();
+    this->subBlks.pixelType.shrink_to_fit();
+    this->subBlks.compression.shrink_to_fit();
+    this->subBlks.filePosition.shrink_to_fit();
+    this->subBlks.coordinateIndex.shrink_to_fit();
+    this->subBlks.pyramidTypeFromSpare.shrink_to_fit();
 }
 
 const libCZI::SubBlockStatistics& CCziSubBlockDirectory::GetStatistics() const
@@ -400,10 +457,12 @@ const libCZI::PyramidStatistics& CCziSubBlockDirectory::GetPyramidStatistics() c
 
 void CCziSubBlockDirectory::EnumSubBlocks(const std::function<bool(int index, const SubBlkEntry&)>& func)
 {
-    int i = 0;
-    for (auto it = this->subBlks.cbegin(); it != this->subBlks.cend(); ++it)
+    SubBlkEntry entry;
+    const int count = this->GetSubBlockCount();
+    for (int i = 0; i < count; ++i)
     {
-        bool b = func(i++, *it);
+        this->GetSubBlock(i, entry);
+        bool b = func(i, entry);
         if (b == false)
         {
             break;
@@ -413,15 +472,93 @@ void CCziSubBlockDirectory::EnumSubBlocks(const std::function<bool(int index, co
 
 bool CCziSubBlockDirectory::TryGetSubBlock(int index, SubBlkEntry& entry) const
 {
-    if (index < (int)this->subBlks.size())
+    if (index >= 0 && index < this->GetSubBlockCount())
     {
-        entry = this->subBlks.at(index);
+        this->GetSubBlock(index, entry);
         return true;
     }
 
     return false;
 }
 
+void CCziSubBlockDirectory::GetSubBlock(int index, SubBlkEntry& entry) const
+{
+    entry.coordinate = this->coordinates[this->subBlks.coordinateIndex[index]];
+    entry.mIndex = this->subBlks.mIndex[index];
+    entry.x = this->subBlks.x[index];
+    entry.y = this->subBlks.y[index];
+    entry.width = this->subBlks.width[index];
+    entry.height = this->subBlks.height[index];
+    entry.storedWidth = this->subBlks.storedWidth[index];
+    entry.storedHeight = this->subBlks.storedHeight[index];
+    entry.PixelType = this->subBlks.pixelType[index];
+    entry.FilePosition = this->subBlks.filePosition[index];
+    entry.Compression = this->subBlks.compression[index];
+    entry.pyramid_type_from_spare = this->subBlks.pyramidTypeFromSpare[index];
+}
+
+void CCziSubBlockDirectory::FilterSubBlocks(const libCZI::IDimCoordinate* planeCoordinate, const libCZI::IntRect* roi, bool onlyLayer0, std::vector<int>& indices) const
+{
+    // we operate with a mask (one byte per sub-block, 0xff meaning "matches so far"), and each criterion is applied
+    //  with a loop over the respective arrays - those loops are branch-free and suitable for vectorization
+    const size_t count = this->subBlks.filePosition.size();
+    std::vector<std::uint8_t> mask(count, 0xff);
+
+    if (planeCoordinate != nullptr)
+    {
+        // the plane coordinate is only compared against the (typically few) distinct coordinates
+        std::vector<std::uint8_t> coordinateMatches(this->coordinates.size());
+        for (size_t i = 0; i < this->coordinates.size(); ++i)
+        {
+            coordinateMatches[i] = CziUtils::CompareCoordinate(planeCoordinate, &this->coordinates[i]) ? 0xff : 0;
+        }
+
+        const std::uint32_t* coordinateIndex = this->subBlks.coordinateIndex.data();
+        for (size_t i = 0; i < count; ++i)
+        {
+            mask[i] &= coordinateMatches[coordinateIndex[i]];
+        }
+    }
+
+    if (onlyLayer0)
+    {
+        const std::int32_t* width = this->subBlks.width.data();
+        const std::int32_t* height = this->subBlks.height.data();
+        const std::int32_t* storedWidth = this->subBlks.storedWidth.data();
+        const std::int32_t* storedHeight = this->subBlks.storedHeight.data();
+        for (size_t i = 0; i < count; ++i)
+        {
+            mask[i] &= ((width[i] == storedWidth[i]) & (height[i] == storedHeight[i])) ? 0xff : 0;
+        }
+    }
+
+    if (roi != nullptr)
+    {
+        RectangleSoaFilter::AndMaskWithIntersection(
+            *roi,
+            this->subBlks.x.data(),
+            this->subBlks.y.data(),
+            this->subBlks.width.data(),
+            this->subBlks.height.data(),
+            count,
+            mask.data());
+    }
+
+    indices.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (mask[i] != 0)
+        {
+            indices.push_back(static_cast<int>(i));
+        }
+    }
+}
+
+bool CCziSubBlockDirectory::CoordinateCompare::operator()(const libCZI::CDimCoordinate& a, const libCZI::CDimCoordinate& b) const
+{
+    return libCZI::Utils::Compare(&a, &b) < 0;
+}
+
 //----------------------------------------------------------------------------------------------
 
 bool PixelTypeForChannelIndexStatistic::TryGetPixelTypeForNoChannelIndex(int* pixelType) const
@@ -69,6 +69,13 @@ public:
     const libCZI::PyramidStatistics& GetPyramidStatistics();
 
     void Clear();
+
+    /// Sets the statistics (e.g. as retrieved from a persisted sub-block directory index) - the pyramid-statistics are
+    /// expected to be consolidated.
+    ///
+    /// \param  statistics          The sub-block statistics.
+    /// \param  pyramidStatistics   The pyramid statistics.
+    void SetStatistics(const libCZI::SubBlockStatistics& statistics, const libCZI::PyramidStatistics& pyramidStatistics);
 private:
     void SortPyramidStatistics();
     static void UpdateBoundingBox(libCZI::IntRect& rect, const CCziSubBlockDirectoryBase::SubBlkEntry& entry);
@@ -77,10 +84,39 @@ private:
 };
 
 
+/// The sub-block directory of a CZI-document opened for reading. The sub-blocks are stored as "structure-of-arrays", i.e. for
+/// each field of SubBlkEntry there is a separate array (indexed by the sub-block index). The coordinates are de-duplicated: there
+/// is a table of the distinct coordinates, and for each sub-block only the index into this table is stored. This gives a compact
+/// representation, and filtering (by plane, by ROI or by pyramid-layer) can operate on contiguous arrays.
 class CCziSubBlockDirectory : public CCziSubBlockDirectoryBase
 {
+    friend class CCziSubBlockDirectoryIndex;
 private:
-    std::vector<SubBlkEntry> subBlks;
+    struct SubBlockArrays
+    {
+        std::vector<std::int32_t> x;
+        std::vector<std::int32_t> y;
+        std::vector<std::int32_t> width;
+        std::vector<std::int32_t> height;
+        std::vector<std::int32_t> storedWidth;
+        std::vector<std::int32_t> storedHeight;
+        std::vector<std::int32_t> mIndex;
+        std::vector<std::int32_t> pixelType;
+        std::vector<std::int32_t> compression;
+        std::vector<std::uint64_t> filePosition;
+        std::vector<std::uint32_t> coordinateIndex;         ///< The index into the table "coordinates".
+        std::vector<std::uint8_t> pyramidTypeFromSpare;
+    };
+
+    /// Implementation of a "less-comparison" for coordinates (used for de-duplicating the coordinates).
+    struct CoordinateCompare
+    {
+        bool operator() (const libCZI::CDimCoordinate& a, const libCZI::CDimCoordinate& b) const;
+    };
+
+    SubBlockArrays subBlks;
+    std::vector<libCZI::CDimCoordinate> coordinates;    ///< The table of the distinct coordinates.
+    std::map<libCZI::CDimCoordinate, std::uint32_t, CoordinateCompare> coordinateLookup; ///< Map from coordinate to index in the table "coordinates" (only used while adding).
     mutable CSbBlkStatisticsUpdater sblkStatistics;
     enum class State
     {
@@ -94,11 +130,31 @@ public:
     const libCZI::SubBlockStatistics& GetStatistics() const;
     const libCZI::PyramidStatistics& GetPyramidStatistics() const;
 
+    /// Reserve memory for the specified number of subblocks (which are to be added subsequently).
+    ///
+    /// \param  count   The number of subblocks.
+    void Reserve(size_t count);
+
     void AddSubBlock(const SubBlkEntry& entry);
     void AddingFinished();
 
     void EnumSubBlocks(const std::function<bool(int index, const SubBlkEntry&)>& func);
     bool TryGetSubBlock(int index, SubBlkEntry& entry) const;
+
+    /// Gets the number of sub-blocks.
+    ///
+    /// \returns    The number of sub-blocks.
+    int GetSubBlockCount() const { return static_cast<int>(this->subBlks.filePosition.size()); }
+
+    /// Determine the sub-blocks which match the specified criteria (with the same semantic as for "ISubBlockRepository::EnumSubset").
+    ///
+    /// \param          planeCoordinate The plane coordinate (may be null, in which case all planes match).
+    /// \param          roi             The ROI (may be null, in which case all sub-blocks on the plane match).
+    /// \param          onlyLayer0      If true, then only sub-blocks on pyramid-layer 0 are considered.
+    /// \param [out]    indices         The indices of the matching sub-blocks are put here, in ascending order.
+    void FilterSubBlocks(const libCZI::IDimCoordinate* planeCoordinate, const libCZI::IntRect* roi, bool onlyLayer0, std::vector<int>& indices) const;
+private:
+    void GetSubBlock(int index, SubBlkEntry& entry) const;
 };
 
 class PixelTypeForChannelIndexStatistic
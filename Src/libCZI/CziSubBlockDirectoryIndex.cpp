@@ -0,0 +1,563 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "CziSubBlockDirectoryIndex.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <sstream>
+
+using namespace std;
+using namespace libCZI;
+
+static_assert(sizeof(libCZI::GUID) == 16, "The GUID-structure is expected to have a size of 16 bytes.");
+
+/*static*/const char CCziSubBlockDirectoryIndex::kMagic[8] = { 'C', 'Z', 'I', 'S', 'B', 'I', 'D', 'X' };
+/*static*/constexpr std::uint32_t CCziSubBlockDirectoryIndex::kByteOrderMark;
+/*static*/constexpr std::uint32_t CCziSubBlockDirectoryIndex::kVersion;
+/*static*/constexpr int CCziSubBlockDirectoryIndex::kIntegersPerCoordinate;
+
+namespace
+{
+    template <typename t>
+    void CopyArrayToVector(const std::uint8_t* source, size_t count, vector<t>& vec)
+    {
+        vec.resize(count);
+        if (count > 0)
+        {
+            memcpy(vec.data(), source, count * sizeof(t));
+        }
+    }
+}
+
+/*static*/void CCziSubBlockDirectoryIndex::Write(const CCziSubBlockDirectory& directory, const ValidationInfo& validationInfo, libCZI::IStream* documentStream, bool includeContentHash, libCZI::IOutputStream* stream)
+{
+    const auto& subBlks = directory.subBlks;
+    const std::uint32_t subBlockCount = static_cast<std::uint32_t>(subBlks.filePosition.size());
+    const std::uint32_t coordinateCount = static_cast<std::uint32_t>(directory.coordinates.size());
+
+    vector<std::int32_t> statistics;
+    CCziSubBlockDirectoryIndex::SerializeStatistics(directory.GetStatistics(), directory.GetPyramidStatistics(), statistics);
+    const std::uint32_t statisticsCount = static_cast<std::uint32_t>(statistics.size());
+
+    Header header;
+    memcpy(header.magic, CCziSubBlockDirectoryIndex::kMagic, sizeof(header.magic));
+    header.byteOrderMark = CCziSubBlockDirectoryIndex::kByteOrderMark;
+    header.version = CCziSubBlockDirectoryIndex::kVersion;
+    header.fileGuid = validationInfo.fileGuid;
+
+    // the document extends at least up to the end of the (used part of the) sub-block directory segment
+    const std::int64_t segmentDataSize = validationInfo.subBlockDirectoryUsedSize != 0 ? validationInfo.subBlockDirectoryUsedSize : validationInfo.subBlockDirectoryAllocatedSize;
+    header.documentSize = CCziSubBlockDirectoryIndex::DetermineSizeOfStream(documentStream, validationInfo.subBlockDirectoryPosition + 32 + static_cast<std::uint64_t>(max(segmentDataSize, static_cast<std::int64_t>(0))));
+    header.subBlockDirectoryPosition = validationInfo.subBlockDirectoryPosition;
+    header.subBlockDirectoryAllocatedSize = validationInfo.subBlockDirectoryAllocatedSize;
+    header.subBlockDirectoryUsedSize = validationInfo.subBlockDirectoryUsedSize;
+    header.subBlockDirectoryHash = includeContentHash ?
+        CCziSubBlockDirectoryIndex::CalculateSubBlockDirectoryHash(documentStream, validationInfo.subBlockDirectoryPosition, validationInfo.subBlockDirectoryAllocatedSize, validationInfo.subBlockDirectoryUsedSize) :
+        0;
+    header.parseOptions = validationInfo.parseOptions;
+    header.subBlockCount = subBlockCount;
+    header.coordinateCount = coordinateCount;
+    header.statisticsCount = statisticsCount;
+    header.totalSize = sizeof(Header) + CCziSubBlockDirectoryIndex::GetPayloadSize(subBlockCount, coordinateCount, statisticsCount);
+
+    // the buffer is zero-initialized, so the padding between the arrays is well-defined
+    vector<std::uint8_t> buffer(static_cast<size_t>(header.totalSize));
+    std::uint8_t* ptr = buffer.data() + sizeof(Header);
+    const auto append = [&](const void* source, std::uint64_t size)->void
+        {
+            if (size > 0)
+            {
+                memcpy(ptr, source, static_cast<size_t>(size));
+            }
+
+            ptr += CCziSubBlockDirectoryIndex::RoundUpToMultipleOf8(size);
+        };
+
+    for (const auto* vec : { &subBlks.x, &subBlks.y, &subBlks.width, &subBlks.height, &subBlks.storedWidth, &subBlks.storedHeight, &subBlks.mIndex, &subBlks.pixelType, &subBlks.compression })
+    {
+        append(vec->data(), subBlockCount * sizeof(std::int32_t));
+    }
+
+    append(subBlks.filePosition.data(), subBlockCount * sizeof(std::uint64_t));
+    append(subBlks.coordinateIndex.data(), subBlockCount * sizeof(std::uint32_t));
+    append(subBlks.pyramidTypeFromSpare.data(), subBlockCount * sizeof(std::uint8_t));
+
+    vector<std::int32_t> coordinates(static_cast<size_t>(coordinateCount) * kIntegersPerCoordinate, 0);
+    for (std::uint32_t i = 0; i < coordinateCount; ++i)
+    {
+        std::int32_t* coordinate = coordinates.data() + static_cast<size_t>(i) * kIntegersPerCoordinate;
+        directory.coordinates[i].EnumValidDimensions(
+            [&](libCZI::DimensionIndex dim, int value)->bool
+            {
+                const int dimensionNo = static_cast<int>(dim) - static_cast<int>(DimensionIndex::MinDim);
+                coordinate[0] |= (1 << dimensionNo);
+                coordinate[1 + dimensionNo] = value;
+                return true;
+            });
+    }
+
+    append(coordinates.data(), coordinates.size() * sizeof(std::int32_t));
+    append(statistics.data(), statistics.size() * sizeof(std::int32_t));
+
+    header.checksum = CCziSubBlockDirectoryIndex::CalculateChecksum(buffer.data() + sizeof(Header), header.totalSize - sizeof(Header));
+    memcpy(buffer.data(), &header, sizeof(Header));
+
+    std::uint64_t bytesWritten;
+    try
+    {
+        stream->Write(0, buffer.data(), buffer.size(), &bytesWritten);
+    }
+    catch (const std::exception&)
+    {
+        std::throw_with_nested(LibCZIIOException("Error writing the sub-block directory index", 0, buffer.size()));
+    }
+
+    if (bytesWritten != buffer.size())
+    {
+        stringstream ss;
+        ss << "Not enough data written at offset 0 -> bytes to write: " << buffer.size() << " bytes, actually written " << bytesWritten << " bytes.";
+        throw LibCZIWriteException(ss.str().c_str(), LibCZIWriteException::ErrorType::NotEnoughDataWritten);
+    }
+}
+
+/*static*/bool CCziSubBlockDirectoryIndex::TryRead(libCZI::IStream* stream, const ValidationInfo& validationInfo, libCZI::IStream* documentStream, bool validateContent, CCziSubBlockDirectory& directory)
+{
+    Header header;
+    std::uint64_t bytesRead;
+    try
+    {
+        stream->Read(0, &header, sizeof(header), &bytesRead);
+    }
+    catch (const std::exception&)
+    {
+        std::throw_with_nested(LibCZIIOException("Error reading the sub-block directory index", 0, sizeof(header)));
+    }
+
+    if (bytesRead != sizeof(header) ||
+        memcmp(header.magic, CCziSubBlockDirectoryIndex::kMagic, sizeof(header.magic)) != 0 ||
+        header.byteOrderMark != CCziSubBlockDirectoryIndex::kByteOrderMark ||
+        header.version != CCziSubBlockDirectoryIndex::kVersion)
+    {
+        return false;
+    }
+
+    if (memcmp(&header.fileGuid, &validationInfo.fileGuid, sizeof(libCZI::GUID)) != 0 ||
+        header.subBlockDirectoryPosition != validationInfo.subBlockDirectoryPosition ||
+        header.subBlockDirectoryAllocatedSize != validationInfo.subBlockDirectoryAllocatedSize ||
+        header.subBlockDirectoryUsedSize != validationInfo.subBlockDirectoryUsedSize ||
+        header.parseOptions != validationInfo.parseOptions)
+    {
+        return false;
+    }
+
+    // checking the size of the document requires two reads of a single byte - whereas checking the hash requires to read the
+    //  complete sub-block directory, which is only done if requested
+    if (header.documentSize == 0 ||
+        !CCziSubBlockDirectoryIndex::HasAtLeastSize(documentStream, header.documentSize) ||
+        CCziSubBlockDirectoryIndex::HasAtLeastSize(documentStream, header.documentSize + 1))
+    {
+        return false;
+    }
+
+    if (validateContent &&
+        (header.subBlockDirectoryHash == 0 ||
+         header.subBlockDirectoryHash != CCziSubBlockDirectoryIndex::CalculateSubBlockDirectoryHash(documentStream, validationInfo.subBlockDirectoryPosition, validationInfo.subBlockDirectoryAllocatedSize, validationInfo.subBlockDirectoryUsedSize)))
+    {
+        return false;
+    }
+
+    const std::uint64_t payloadSize = CCziSubBlockDirectoryIndex::GetPayloadSize(header.subBlockCount, header.coordinateCount, header.statisticsCount);
+    if (header.totalSize != sizeof(Header) + payloadSize || payloadSize > numeric_limits<size_t>::max())
+    {
+        return false;
+    }
+
+    // if the stream gives direct access to its content, then we use the data in place
+    const auto streamEx = dynamic_cast<libCZI::IStreamEx*>(stream);
+    std::shared_ptr<const void> directData;
+    if (streamEx != nullptr && streamEx->TryGetDirectAccess(sizeof(Header), payloadSize, directData))
+    {
+        return CCziSubBlockDirectoryIndex::TryParse(static_cast<const std::uint8_t*>(directData.get()), payloadSize, header, directory);
+    }
+
+    // the counts in the header are not trustworthy (the checksum only covers the payload), so before allocating memory for
+    // the payload, we check that the stream actually has the size given in the header
+    std::uint8_t lastByte;
+    try
+    {
+        stream->Read(header.totalSize - 1, &lastByte, 1, &bytesRead);
+    }
+    catch (const std::exception&)
+    {
+        std::throw_with_nested(LibCZIIOException("Error reading the sub-block directory index", header.totalSize - 1, 1));
+    }
+
+    if (bytesRead != 1)
+    {
+        return false;
+    }
+
+    std::unique_ptr<std::uint8_t[]> payload(new std::uint8_t[static_cast<size_t>(payloadSize)]);
+    try
+    {
+        stream->Read(sizeof(Header), payload.get(), payloadSize, &bytesRead);
+    }
+    catch (const std::exception&)
+    {
+        std::throw_with_nested(LibCZIIOException("Error reading the sub-block directory index", sizeof(Header), payloadSize));
+    }
+
+    if (bytesRead != payloadSize)
+    {
+        return false;
+    }
+
+    return CCziSubBlockDirectoryIndex::TryParse(payload.get(), payloadSize, header, directory);
+}
+
+/*static*/bool CCziSubBlockDirectoryIndex::TryParse(const std::uint8_t* data, std::uint64_t size, const Header& header, CCziSubBlockDirectory& directory)
+{
+    if (CCziSubBlockDirectoryIndex::CalculateChecksum(data, size) != header.checksum)
+    {
+        return false;
+    }
+
+    const size_t subBlockCount = header.subBlockCount;
+    const size_t coordinateCount = header.coordinateCount;
+
+    SubBlockStatistics statistics;
+    PyramidStatistics pyramidStatistics;
+    const std::uint8_t* ptrStatistics = data + size - CCziSubBlockDirectoryIndex::RoundUpToMultipleOf8(header.statisticsCount * sizeof(std::int32_t));
+    vector<std::int32_t> statisticsData;
+    CopyArrayToVector(ptrStatistics, header.statisticsCount, statisticsData);
+    if (!CCziSubBlockDirectoryIndex::TryDeserializeStatistics(statisticsData.data(), statisticsData.size(), statistics, pyramidStatistics))
+    {
+        return false;
+    }
+
+    CCziSubBlockDirectory::SubBlockArrays subBlks;
+    const std::uint8_t* ptr = data;
+    for (auto* vec : { &subBlks.x, &subBlks.y, &subBlks.width, &subBlks.height, &subBlks.storedWidth, &subBlks.storedHeight, &subBlks.mIndex, &subBlks.pixelType, &subBlks.compression })
+    {
+        CopyArrayToVector(ptr, subBlockCount, *vec);
+        ptr += CCziSubBlockDirectoryIndex::RoundUpToMultipleOf8(subBlockCount * sizeof(std::int32_t));
+    }
+
+    CopyArrayToVector(ptr, subBlockCount, subBlks.filePosition);
+    ptr += subBlockCount * sizeof(std::uint64_t);
+    CopyArrayToVector(ptr, subBlockCount, subBlks.coordinateIndex);
+    ptr += CCziSubBlockDirectoryIndex::RoundUpToMultipleOf8(subBlockCount * sizeof(std::uint32_t));
+    CopyArrayToVector(ptr, subBlockCount, subBlks.pyramidTypeFromSpare);
+    ptr += CCziSubBlockDirectoryIndex::RoundUpToMultipleOf8(subBlockCount * sizeof(std::uint8_t));
+
+    for (const auto coordinateIndex : subBlks.coordinateIndex)
+    {
+        if (coordinateIndex >= coordinateCount)
+        {
+            return false;
+        }
+    }
+
+    vector<CDimCoordinate> coordinates(coordinateCount);
+    for (size_t i = 0; i < coordinateCount; ++i)
+    {
+        std::int32_t coordinate[kIntegersPerCoordinate];
+        memcpy(coordinate, ptr + i * sizeof(coordinate), sizeof(coordinate));
+        for (int dimensionNo = 0; dimensionNo < kIntegersPerCoordinate - 1; ++dimensionNo)
+        {
+            if (coordinate[0] & (1 << dimensionNo))
+            {
+                coordinates[i].Set(static_cast<DimensionIndex>(static_cast<int>(DimensionIndex::MinDim) + dimensionNo), coordinate[1 + dimensionNo]);
+            }
+        }
+    }
+
+    directory.subBlks = std::move(subBlks);
+    directory.coordinates = std::move(coordinates);
+    directory.coordinateLookup.clear();
+    directory.sblkStatistics.SetStatistics(statistics, pyramidStatistics);
+    directory.state = CCziSubBlockDirectory::State::AddingFinished;
+    return true;
+}
+
+/*static*/void CCziSubBlockDirectoryIndex::SerializeStatistics(const libCZI::SubBlockStatistics& statistics, const libCZI::PyramidStatistics& pyramidStatistics, std::vector<std::int32_t>& data)
+{
+    const auto appendRect = [&](const IntRect& rect)->void
+        {
+            data.push_back(rect.x);
+            data.push_back(rect.y);
+            data.push_back(rect.w);
+            data.push_back(rect.h);
+        };
+
+    data.push_back(statistics.subBlockCount);
+    data.push_back(statistics.minMindex);
+    data.push_back(statistics.maxMindex);
+    appendRect(statistics.boundingBox);
+    appendRect(statistics.boundingBoxLayer0Only);
+
+    std::int32_t validDimensions = 0;
+    vector<std::int32_t> bounds;
+    for (int dimensionNo = 0; dimensionNo < kIntegersPerCoordinate - 1; ++dimensionNo)
+    {
+        int start = 0, size = 0;
+        if (statistics.dimBounds.TryGetInterval(static_cast<DimensionIndex>(static_cast<int>(DimensionIndex::MinDim) + dimensionNo), &start, &size))
+        {
+            validDimensions |= (1 << dimensionNo);
+        }
+
+        bounds.push_back(start);
+        bounds.push_back(size);
+    }
+
+    data.push_back(validDimensions);
+    data.insert(data.end(), bounds.cbegin(), bounds.cend());
+
+    data.push_back(static_cast<std::int32_t>(statistics.sceneBoundingBoxes.size()));
+    for (const auto& sceneBoundingBox : statistics.sceneBoundingBoxes)
+    {
+        data.push_back(sceneBoundingBox.first);
+        appendRect(sceneBoundingBox.second.boundingBox);
+        appendRect(sceneBoundingBox.second.boundingBoxLayer0);
+    }
+
+    data.push_back(static_cast<std::int32_t>(pyramidStatistics.scenePyramidStatistics.size()));
+    for (const auto& scenePyramidStatistics : pyramidStatistics.scenePyramidStatistics)
+    {
+        data.push_back(scenePyramidStatistics.first);
+        data.push_back(static_cast<std::int32_t>(scenePyramidStatistics.second.size()));
+        for (const auto& layerStatistics : scenePyramidStatistics.second)
+        {
+            data.push_back(layerStatistics.layerInfo.minificationFactor);
+            data.push_back(layerStatistics.layerInfo.pyramidLayerNo);
+            data.push_back(layerStatistics.count);
+        }
+    }
+}
+
+/*static*/bool CCziSubBlockDirectoryIndex::TryDeserializeStatistics(const std::int32_t* data, size_t count, libCZI::SubBlockStatistics& statistics, libCZI::PyramidStatistics& pyramidStatistics)
+{
+    size_t position = 0;
+    const auto next = [&](std::int32_t& value)->bool
+        {
+            if (position >= count)
+            {
+                return false;
+            }
+
+            value = data[position++];
+            return true;
+        };
+    const auto nextRect = [&](IntRect& rect)->bool
+        {
+            return next(rect.x) && next(rect.y) && next(rect.w) && next(rect.h);
+        };
+
+    if (!next(statistics.subBlockCount) || !next(statistics.minMindex) || !next(statistics.maxMindex) ||
+        !nextRect(statistics.boundingBox) || !nextRect(statistics.boundingBoxLayer0Only))
+    {
+        return false;
+    }
+
+    std::int32_t validDimensions;
+    if (!next(validDimensions))
+    {
+        return false;
+    }
+
+    statistics.dimBounds.Clear();
+    for (int dimensionNo = 0; dimensionNo < kIntegersPerCoordinate - 1; ++dimensionNo)
+    {
+        std::int32_t start, size;
+        if (!next(start) || !next(size))
+        {
+            return false;
+        }
+
+        if (validDimensions & (1 << dimensionNo))
+        {
+            statistics.dimBounds.Set(static_cast<DimensionIndex>(static_cast<int>(DimensionIndex::MinDim) + dimensionNo), start, size);
+        }
+    }
+
+    std::int32_t sceneCount;
+    if (!next(sceneCount) || sceneCount < 0)
+    {
+        return false;
+    }
+
+    statistics.sceneBoundingBoxes.clear();
+    for (std::int32_t i = 0; i < sceneCount; ++i)
+    {
+        std::int32_t sceneIndex;
+        BoundingBoxes boundingBoxes;
+        if (!next(sceneIndex) || !nextRect(boundingBoxes.boundingBox) || !nextRect(boundingBoxes.boundingBoxLayer0))
+        {
+            return false;
+        }
+
+        statistics.sceneBoundingBoxes[sceneIndex] = boundingBoxes;
+    }
+
+    std::int32_t pyramidSceneCount;
+    if (!next(pyramidSceneCount) || pyramidSceneCount < 0)
+    {
+        return false;
+    }
+
+    pyramidStatistics.scenePyramidStatistics.clear();
+    for (std::int32_t i = 0; i < pyramidSceneCount; ++i)
+    {
+        std::int32_t sceneIndex, layerCount;
+        if (!next(sceneIndex) || !next(layerCount) || layerCount < 0)
+        {
+            return false;
+        }
+
+        auto& layers = pyramidStatistics.scenePyramidStatistics[sceneIndex];
+        for (std::int32_t n = 0; n < layerCount; ++n)
+        {
+            std::int32_t minificationFactor, pyramidLayerNo;
+            PyramidStatistics::PyramidLayerStatistics layerStatistics;
+            if (!next(minificationFactor) || !next(pyramidLayerNo) || !next(layerStatistics.count))
+            {
+                return false;
+            }
+
+            layerStatistics.layerInfo.minificationFactor = static_cast<std::uint8_t>(minificationFactor);
+            layerStatistics.layerInfo.pyramidLayerNo = static_cast<std::uint8_t>(pyramidLayerNo);
+            layers.push_back(layerStatistics);
+        }
+    }
+
+    return position == count;
+}
+
+/*static*/std::uint64_t CCziSubBlockDirectoryIndex::CalculateSubBlockDirectoryHash(libCZI::IStream* stream, std::uint64_t position, std::int64_t allocatedSize, std::int64_t usedSize)
+{
+    // "UsedSize" may not be valid in early versions (c.f. CCZIParse::ReadSubBlockDirectory), and the hash covers the segment header as well
+    constexpr std::uint64_t kSegmentHeaderSize = 32;
+    const std::int64_t segmentDataSize = usedSize != 0 ? usedSize : allocatedSize;
+    const std::uint64_t size = kSegmentHeaderSize + static_cast<std::uint64_t>(max(segmentDataSize, static_cast<std::int64_t>(0)));
+
+    // the content is read in chunks (whose size is a multiple of 8), and the last chunk is padded with zeros - so the buffer
+    //  must be large enough for the padding as well
+    constexpr std::uint64_t kChunkSize = 1024 * 1024;
+    vector<std::uint8_t> buffer(static_cast<size_t>(CCziSubBlockDirectoryIndex::RoundUpToMultipleOf8(min(size, kChunkSize))));
+    std::uint64_t hash = CCziSubBlockDirectoryIndex::CalculateChecksum(nullptr, 0);
+    for (std::uint64_t offset = 0; offset < size; offset += kChunkSize)
+    {
+        const std::uint64_t bytesToRead = min(size - offset, kChunkSize);
+        std::uint64_t bytesRead;
+        try
+        {
+            stream->Read(position + offset, buffer.data(), bytesToRead, &bytesRead);
+        }
+        catch (const std::exception&)
+        {
+            std::throw_with_nested(LibCZIIOException("Error reading the sub-block directory", position + offset, bytesToRead));
+        }
+
+        if (bytesRead != bytesToRead)
+        {
+            stringstream ss;
+            ss << "Not enough data read at offset " << position + offset << " -> requested: " << bytesToRead << " bytes, actually got " << bytesRead << " bytes.";
+            throw LibCZICZIParseException(ss.str().c_str(), LibCZICZIParseException::ErrorCode::NotEnoughData);
+        }
+
+        const std::uint64_t bytesToHash = CCziSubBlockDirectoryIndex::RoundUpToMultipleOf8(bytesToRead);
+        memset(buffer.data() + bytesToRead, 0, static_cast<size_t>(bytesToHash - bytesToRead));
+        hash = CCziSubBlockDirectoryIndex::UpdateChecksum(hash, buffer.data(), bytesToHash);
+    }
+
+    // 0 is reserved for "no hash"
+    return hash != 0 ? hash : 1;
+}
+
+/*static*/std::uint64_t CCziSubBlockDirectoryIndex::DetermineSizeOfStream(libCZI::IStream* stream, std::uint64_t lowerBound)
+{
+    // IStream has no notion of a size, but reading past the end must not fail (and gives fewer bytes) - so we determine the
+    //  size by probing, first with exponentially growing steps (starting at the lower bound, which typically is close to the
+    //  end of the document) and then with a binary search. The invariant is: the size is >= 'low' and < 'high'.
+    std::uint64_t low = CCziSubBlockDirectoryIndex::HasAtLeastSize(stream, lowerBound) ? lowerBound : 0;
+    std::uint64_t high;
+    for (std::uint64_t step = 1;; step *= 2)
+    {
+        if (!CCziSubBlockDirectoryIndex::HasAtLeastSize(stream, low + step))
+        {
+            high = low + step;
+            break;
+        }
+
+        low += step;
+    }
+
+    while (high - low > 1)
+    {
+        const std::uint64_t middle = low + (high - low) / 2;
+        if (CCziSubBlockDirectoryIndex::HasAtLeastSize(stream, middle))
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/*static*/bool CCziSubBlockDirectoryIndex::HasAtLeastSize(libCZI::IStream* stream, std::uint64_t size)
+{
+    if (size == 0)
+    {
+        return true;
+    }
+
+    std::uint8_t byte;
+    std::uint64_t bytesRead;
+    try
+    {
+        stream->Read(size - 1, &byte, 1, &bytesRead);
+    }
+    catch (const std::exception&)
+    {
+        std::throw_with_nested(LibCZIIOException("Error reading the CZI-document", size - 1, 1));
+    }
+
+    return bytesRead == 1;
+}
+
+/*static*/std::uint64_t CCziSubBlockDirectoryIndex::CalculateChecksum(const std::uint8_t* data, std::uint64_t size)
+{
+    return CCziSubBlockDirectoryIndex::UpdateChecksum(0xcbf29ce484222325ULL, data, size);
+}
+
+/*static*/std::uint64_t CCziSubBlockDirectoryIndex::UpdateChecksum(std::uint64_t hash, const std::uint8_t* data, std::uint64_t size)
+{
+    // this is a variant of the FNV-1a hash, which operates on 64-bit words (the size of the payload is always a multiple of 8)
+    for (std::uint64_t i = 0; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t))
+    {
+        std::uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash ^= word;
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+/*static*/std::uint64_t CCziSubBlockDirectoryIndex::GetPayloadSize(std::uint32_t subBlockCount, std::uint32_t coordinateCount, std::uint32_t statisticsCount)
+{
+    const std::uint64_t n = subBlockCount;
+    return 9 * CCziSubBlockDirectoryIndex::RoundUpToMultipleOf8(n * sizeof(std::int32_t)) +
+        n * sizeof(std::uint64_t) +
+        CCziSubBlockDirectoryIndex::RoundUpToMultipleOf8(n * sizeof(std::uint32_t)) +
+        CCziSubBlockDirectoryIndex::RoundUpToMultipleOf8(n * sizeof(std::uint8_t)) +
+        CCziSubBlockDirectoryIndex::RoundUpToMultipleOf8(static_cast<std::uint64_t>(coordinateCount) * kIntegersPerCoordinate * sizeof(std::int32_t)) +
+        CCziSubBlockDirectoryIndex::RoundUpToMultipleOf8(static_cast<std::uint64_t>(statisticsCount) * sizeof(std::int32_t));
+}
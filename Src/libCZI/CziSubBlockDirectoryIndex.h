@@ -0,0 +1,119 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "libCZI.h"
+#include "CziSubBlockDirectory.h"
+
+/// This class implements the persisted sub-block directory index - a binary representation of a parsed sub-block directory
+/// (including the sub-block statistics and the pyramid statistics), which is intended to be stored next to a CZI-document
+/// (as a "sidecar"). Loading this index instead of parsing the sub-block directory of the document makes opening a document
+/// with a large number of sub-blocks a matter of copying a few contiguous arrays.
+///
+/// The index is structured as follows: a header (of fixed size) is followed by the arrays of the sub-block directory (one array
+/// for each field, in the same "structure-of-arrays" layout as used by CCziSubBlockDirectory, each array starting at an offset
+/// which is a multiple of 8), the table of the distinct coordinates and the statistics. All data is stored in host byte order,
+/// so that the arrays can be used directly from a memory-mapping of the file. The header contains information which identifies
+/// the CZI-document (the file-GUID, the size of the document, the position of the sub-block directory and the sizes from its
+/// segment header) and the parse-options which were used for parsing. The index is only used if this information matches, and
+/// if its checksum is correct - checking this information takes a constant amount of I/O (independent of the size of the sub-block
+/// directory). Optionally, a hash of the raw content of the sub-block directory is stored and checked as well, which is required
+/// in order to detect an in-place modification of the sub-block directory (as done e.g. by CZIrepair) - at the cost of reading
+/// the complete sub-block directory.
+class CCziSubBlockDirectoryIndex
+{
+public:
+    /// The information identifying the CZI-document (and the parse-options used) the index is valid for - this is the information
+    /// which is readily available when opening the document. The size of the document and the hash of the sub-block directory are
+    /// determined from the document stream (and only if required).
+    struct ValidationInfo
+    {
+        libCZI::GUID fileGuid;                          ///< The file-GUID of the CZI-document.
+        std::uint64_t subBlockDirectoryPosition;        ///< The position of the sub-block directory segment.
+        std::int64_t subBlockDirectoryAllocatedSize;    ///< The allocated size of the sub-block directory segment.
+        std::int64_t subBlockDirectoryUsedSize;         ///< The used size of the sub-block directory segment.
+        std::uint32_t parseOptions;                     ///< The parse-options (as a bitmask) which were used for parsing the sub-block directory.
+    };
+
+private:
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t byteOrderMark;
+        std::uint32_t version;
+        libCZI::GUID fileGuid;
+        std::uint64_t documentSize;                 ///< The size of the CZI-document in bytes.
+        std::uint64_t subBlockDirectoryPosition;
+        std::int64_t subBlockDirectoryAllocatedSize;
+        std::int64_t subBlockDirectoryUsedSize;
+        std::uint64_t subBlockDirectoryHash;        ///< The hash of the raw content of the sub-block directory segment, or 0 if it was not calculated.
+        std::uint32_t parseOptions;
+        std::uint32_t subBlockCount;
+        std::uint32_t coordinateCount;
+        std::uint32_t statisticsCount;      ///< The number of 32-bit integers in the statistics-section.
+        std::uint64_t totalSize;            ///< The total size of the index (including the header) in bytes.
+        std::uint64_t checksum;             ///< The checksum of the data following the header.
+    };
+
+    static_assert(sizeof(Header) == 104, "The header is expected to have a size of 104 bytes (without padding).");
+
+    static const char kMagic[8];
+    static constexpr std::uint32_t kByteOrderMark = 0x01020304;
+    static constexpr std::uint32_t kVersion = 3;
+
+    /// The number of 32-bit integers used to represent a coordinate - a bitmask of the valid dimensions, followed by the
+    /// values for all dimensions.
+    static constexpr int kIntegersPerCoordinate = 1 + static_cast<int>(libCZI::DimensionIndex::MaxDim) - static_cast<int>(libCZI::DimensionIndex::MinDim) + 1;
+
+public:
+    /// Writes the index for the specified sub-block directory to the specified stream.
+    ///
+    /// \param          directory           The sub-block directory (for which adding must be finished).
+    /// \param          validationInfo      Information identifying the CZI-document (and the parse-options used).
+    /// \param [in]     documentStream      The stream containing the CZI-document (from which its size and the hash are determined).
+    /// \param          includeContentHash  If true, then the hash of the raw content of the sub-block directory is calculated and stored.
+    /// \param [in,out] stream              The stream to write to.
+    static void Write(const CCziSubBlockDirectory& directory, const ValidationInfo& validationInfo, libCZI::IStream* documentStream, bool includeContentHash, libCZI::IOutputStream* stream);
+
+    /// Attempts to read the index from the specified stream. If the stream implements IStreamEx and gives direct access
+    /// to its content (e.g. in case of a memory-mapped file), then no intermediate copy of the index is made. If the stream
+    /// does not contain a valid index, or if the index does not match the specified validation information or the size of
+    /// the document, then false is returned and the directory is not modified.
+    ///
+    /// \param [in]     stream              The stream to read from.
+    /// \param          validationInfo      Information identifying the CZI-document (and the parse-options used).
+    /// \param [in]     documentStream      The stream containing the CZI-document.
+    /// \param          validateContent     If true, then the index must contain the hash of the raw content of the sub-block directory,
+    ///                                     and it must match the hash calculated from the document (which requires to read the
+    ///                                     complete sub-block directory).
+    /// \param [out]    directory           The sub-block directory, which is populated if successful.
+    ///
+    /// \returns    True if the index was read successfully; false otherwise.
+    static bool TryRead(libCZI::IStream* stream, const ValidationInfo& validationInfo, libCZI::IStream* documentStream, bool validateContent, CCziSubBlockDirectory& directory);
+
+    /// Calculates the hash of the raw content of the sub-block directory segment at the specified position (i.e. of the segment
+    /// header and of the used part of the segment data). The result is never 0 (which is used for "no hash").
+    ///
+    /// \param [in]     stream          The stream containing the CZI-document.
+    /// \param          position        The position of the sub-block directory segment.
+    /// \param          allocatedSize   The allocated size of the sub-block directory segment.
+    /// \param          usedSize        The used size of the sub-block directory segment.
+    ///
+    /// \returns    The hash of the raw content of the sub-block directory segment.
+    static std::uint64_t CalculateSubBlockDirectoryHash(libCZI::IStream* stream, std::uint64_t position, std::int64_t allocatedSize, std::int64_t usedSize);
+
+private:
+    static std::uint64_t DetermineSizeOfStream(libCZI::IStream* stream, std::uint64_t lowerBound);
+    static bool HasAtLeastSize(libCZI::IStream* stream, std::uint64_t size);
+    static bool TryParse(const std::uint8_t* data, std::uint64_t size, const Header& header, CCziSubBlockDirectory& directory);
+    static void SerializeStatistics(const libCZI::SubBlockStatistics& statistics, const libCZI::PyramidStatistics& pyramidStatistics, std::vector<std::int32_t>& data);
+    static bool TryDeserializeStatistics(const std::int32_t* data, size_t count, libCZI::SubBlockStatistics& statistics, libCZI::PyramidStatistics& pyramidStatistics);
+    static std::uint64_t CalculateChecksum(const std::uint8_t* data, std::uint64_t size);
+    static std::uint64_t UpdateChecksum(std::uint64_t hash, const std::uint8_t* data, std::uint64_t size);
+    static std::uint64_t GetPayloadSize(std::uint32_t subBlockCount, std::uint32_t coordinateCount, std::uint32_t statisticsCount);
+    static std::uint64_t RoundUpToMultipleOf8(std::uint64_t value) { return (value + 7) & ~static_cast<std::uint64_t>(7); }
+};
@@ -0,0 +1,208 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "CziSubBlockSpatialIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include "CziUtils.h"
+
+using namespace libCZI;
+using namespace std;
+
+CCziSubBlockSpatialIndex::CCziSubBlockSpatialIndex(CCziSubBlockDirectory& directory)
+{
+    // the key of a bucket is constructed from the plane coordinate (for each dimension whether it is valid and its value) and the "layer-0"-flag
+    map<vector<int>, size_t> bucket_index_for_key;
+    vector<int> key;
+    directory.EnumSubBlocks(
+        [&](int index, const CCziSubBlockDirectory::SubBlkEntry& entry)->bool
+        {
+            key.clear();
+            CziUtils::EnumAllCoordinateDimensions(
+                [&](DimensionIndex dim)->bool
+                {
+                    int value;
+                    if (entry.coordinate.TryGetPosition(dim, &value))
+                    {
+                        key.push_back(1);
+                        key.push_back(value);
+                    }
+                    else
+                    {
+                        key.push_back(0);
+                        key.push_back(0);
+                    }
+
+                    return true;
+                });
+
+            const bool is_layer0 = entry.IsStoredSizeEqualLogicalSize();
+            key.push_back(is_layer0 ? 1 : 0);
+            auto it = bucket_index_for_key.find(key);
+            if (it == bucket_index_for_key.end())
+            {
+                it = bucket_index_for_key.insert(make_pair(key, this->buckets_.size())).first;
+                Bucket bucket;
+                bucket.coordinate = entry.coordinate;
+                bucket.is_layer0 = is_layer0;
+                this->buckets_.push_back(move(bucket));
+            }
+
+            Item item;
+            item.x0 = entry.x;
+            item.y0 = entry.y;
+            item.x1 = static_cast<int64_t>(entry.x) + entry.width;
+            item.y1 = static_cast<int64_t>(entry.y) + entry.height;
+            item.index = index;
+            this->buckets_[it->second].items.push_back(item);
+            return true;
+        });
+
+    for (auto& bucket : this->buckets_)
+    {
+        CCziSubBlockSpatialIndex::BuildTree(bucket);
+    }
+}
+
+void CCziSubBlockSpatialIndex::Query(const libCZI::IDimCoordinate* plane_coordinate, const libCZI::IntRect* roi, bool only_layer0, std::vector<int>& indices) const
+{
+    indices.clear();
+    Box roi_box;
+    if (roi != nullptr)
+    {
+        roi_box.x0 = roi->x;
+        roi_box.y0 = roi->y;
+        roi_box.x1 = static_cast<int64_t>(roi->x) + roi->w;
+        roi_box.y1 = static_cast<int64_t>(roi->y) + roi->h;
+    }
+
+    for (const auto& bucket : this->buckets_)
+    {
+        if (only_layer0 && !bucket.is_layer0)
+        {
+            continue;
+        }
+
+        if (plane_coordinate != nullptr && !CziUtils::CompareCoordinate(plane_coordinate, &bucket.coordinate))
+        {
+            continue;
+        }
+
+        if (roi == nullptr)
+        {
+            for (const auto& item : bucket.items)
+            {
+                indices.push_back(item.index);
+            }
+        }
+        else
+        {
+            CCziSubBlockSpatialIndex::QueryBucket(bucket, roi_box, indices);
+        }
+    }
+
+    // report the sub-blocks in the same order as the sub-block directory has them
+    sort(indices.begin(), indices.end());
+}
+
+/*static*/void CCziSubBlockSpatialIndex::BuildTree(Bucket& bucket)
+{
+    bucket.levels.push_back(CCziSubBlockSpatialIndex::PackLevel(bucket.items));
+    while (bucket.levels.back().size() > kNodeCapacity)
+    {
+        // note that packing reorders the nodes of the current level, which is fine since only the level above refers to them
+        auto upper_level = CCziSubBlockSpatialIndex::PackLevel(bucket.levels.back());
+        bucket.levels.push_back(move(upper_level));
+    }
+}
+
+/// Sort the specified elements with the "sort-tile-recursive"-scheme (i.e. into vertical slices by the center's x-coordinate, and
+/// within a slice by the center's y-coordinate), and then create nodes for each run of "kNodeCapacity" elements.
+template <typename tElement>
+/*static*/std::vector<CCziSubBlockSpatialIndex::Node> CCziSubBlockSpatialIndex::PackLevel(std::vector<tElement>& elements)
+{
+    const size_t node_count = (elements.size() + kNodeCapacity - 1) / kNodeCapacity;
+    const size_t slice_count = static_cast<size_t>(ceil(sqrt(static_cast<double>(node_count))));
+    const size_t elements_per_slice = slice_count * kNodeCapacity;
+
+    sort(elements.begin(), elements.end(), [](const tElement& a, const tElement& b)->bool {return a.x0 + a.x1 < b.x0 + b.x1; });
+    for (size_t start = 0; start < elements.size(); start += elements_per_slice)
+    {
+        const auto end = elements.begin() + static_cast<ptrdiff_t>(min(start + elements_per_slice, elements.size()));
+        sort(elements.begin() + static_cast<ptrdiff_t>(start), end, [](const tElement& a, const tElement& b)->bool {return a.y0 + a.y1 < b.y0 + b.y1; });
+    }
+
+    vector<Node> nodes;
+    nodes.reserve(node_count);
+    for (size_t start = 0; start < elements.size(); start += kNodeCapacity)
+    {
+        const size_t end = min(start + kNodeCapacity, elements.size());
+        Node node;
+        node.x0 = elements[start].x0;
+        node.y0 = elements[start].y0;
+        node.x1 = elements[start].x1;
+        node.y1 = elements[start].y1;
+        for (size_t i = start + 1; i < end; ++i)
+        {
+            node.x0 = min(node.x0, elements[i].x0);
+            node.y0 = min(node.y0, elements[i].y0);
+            node.x1 = max(node.x1, elements[i].x1);
+            node.y1 = max(node.y1, elements[i].y1);
+        }
+
+        node.first = static_cast<uint32_t>(start);
+        node.count = static_cast<uint32_t>(end - start);
+        nodes.push_back(node);
+    }
+
+    return nodes;
+}
+
+/*static*/void CCziSubBlockSpatialIndex::QueryBucket(const Bucket& bucket, const Box& roi, std::vector<int>& indices)
+{
+    // a stack of (level, node-index) which are still to be visited - we start with all nodes of the top level
+    vector<pair<size_t, uint32_t>> stack;
+    const size_t top_level = bucket.levels.size() - 1;
+    for (uint32_t i = 0; i < bucket.levels[top_level].size(); ++i)
+    {
+        stack.emplace_back(top_level, i);
+    }
+
+    while (!stack.empty())
+    {
+        const auto level_and_node = stack.back();
+        stack.pop_back();
+        const Node& node = bucket.levels[level_and_node.first][level_and_node.second];
+        if (!CCziSubBlockSpatialIndex::DoIntersect(node, roi))
+        {
+            continue;
+        }
+
+        if (level_and_node.first == 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                if (CCziSubBlockSpatialIndex::DoIntersect(bucket.items[i], roi))
+                {
+                    indices.push_back(bucket.items[i].index);
+                }
+            }
+        }
+        else
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                stack.emplace_back(level_and_node.first - 1, i);
+            }
+        }
+    }
+}
+
+/*static*/bool CCziSubBlockSpatialIndex::DoIntersect(const Box& a, const Box& b)
+{
+    // this gives the same result as "Utilities::DoIntersect" - the intersection must have a positive width and height
+    return (min(a.x1, b.x1) > max(a.x0, b.x0)) && (min(a.y1, b.y1) > max(a.y0, b.y0));
+}
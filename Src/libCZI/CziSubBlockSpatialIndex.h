@@ -0,0 +1,69 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "libCZI.h"
+#include "CziSubBlockDirectory.h"
+
+/// A spatial index over the sub-blocks of a (read-only) sub-block directory, which is used to answer the queries of
+/// "EnumSubset" without walking all sub-blocks. The sub-blocks are grouped into buckets (one bucket for each distinct
+/// plane coordinate and for "layer-0" and "not layer-0"), and for each bucket a static R-tree is constructed (bulk-loaded
+/// with the "sort-tile-recursive" algorithm). A query then only has to check the plane coordinate of each bucket, and
+/// within a matching bucket the R-tree gives the sub-blocks intersecting with the ROI in O(log N + k).
+class CCziSubBlockSpatialIndex
+{
+private:
+    /// A bounding box with half-open intervals [x0, x1) and [y0, y1). 64-bit integers are used in order to avoid overflows.
+    struct Box
+    {
+        std::int64_t x0, y0, x1, y1;
+    };
+
+    struct Item : Box
+    {
+        int index;              ///< The index of the sub-block.
+    };
+
+    struct Node : Box
+    {
+        std::uint32_t first;    ///< The index of the first child (either in the level below or in the items).
+        std::uint32_t count;    ///< The number of children.
+    };
+
+    struct Bucket
+    {
+        libCZI::CDimCoordinate coordinate;  ///< The plane coordinate of all sub-blocks in this bucket.
+        bool is_layer0;                     ///< True if the sub-blocks in this bucket have a stored size equal to the logical size.
+        std::vector<Item> items;            ///< The sub-blocks in this bucket (in the order of the leaf nodes).
+        std::vector<std::vector<Node>> levels;  ///< The levels of the R-tree, where levels[0] are the leaf nodes and the last level contains the root nodes.
+    };
+
+    /// The maximum number of children of a node in the R-tree.
+    static constexpr std::uint32_t kNodeCapacity = 16;
+
+    std::vector<Bucket> buckets_;
+public:
+    /// Constructs the index for all sub-blocks in the specified directory.
+    ///
+    /// \param [in] directory   The sub-block directory.
+    explicit CCziSubBlockSpatialIndex(CCziSubBlockDirectory& directory);
+
+    /// Determine the sub-blocks which match the specified criteria (with the same semantic as for "ISubBlockRepository::EnumSubset").
+    ///
+    /// \param          plane_coordinate    The plane coordinate (may be null, in which case all planes match).
+    /// \param          roi                 The ROI (may be null, in which case all sub-blocks on the plane match).
+    /// \param          only_layer0         If true, then only sub-blocks on pyramid-layer 0 are considered.
+    /// \param [out]    indices             The indices of the matching sub-blocks are put here, in ascending order.
+    void Query(const libCZI::IDimCoordinate* plane_coordinate, const libCZI::IntRect* roi, bool only_layer0, std::vector<int>& indices) const;
+
+private:
+    static void BuildTree(Bucket& bucket);
+    template <typename tElement>
+    static std::vector<Node> PackLevel(std::vector<tElement>& elements);
+    static void QueryBucket(const Bucket& bucket, const Box& roi, std::vector<int>& indices);
+    static bool DoIntersect(const Box& a, const Box& b);
+};
@@ -6,6 +6,7 @@
 #include "libCZI_Utilities.h"
 #include <cmath>
 #include "Site.h"
+#include "utilities.h"
 
 using namespace libCZI;
 using namespace std;
@@ -1146,21 +1147,115 @@ private:
         return false;
     }
 
+    enum class ChannelOperation
+    {
+        Tinting,
+        TintingBlackWhitePt,
+        Lut
+    };
+
+    /// Composes a channel into a destination of pixel type Bgr24 with the row kernels (c.f. MultiChannelCompositorRowKernels), which
+    /// give the same result as the per-pixel functors above - but are vectorized (if possible). This is possible for all source
+    /// pixel types supported by the compositor except Bgra32.
+    ///
+    /// \param  operation   The operation to be applied to the pixels of the channel.
+    /// \param  add         True if the result is to be added to the destination, false if it is to be stored.
+    /// \param  ptrWeight   If non-null, the weight to be applied to the result.
+    /// \param  lckDst      The lock-info of the destination bitmap.
+    /// \param  src         The source bitmap.
+    /// \param  chInfo      The channel-info.
+    ///
+    /// \returns    True if it succeeds; false if the row kernels cannot be used for the pixel type of the source bitmap.
+    static bool TryDoRowKernelsBgr24(ChannelOperation operation, bool add, const float* ptrWeight, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo)
+    {
+        MultiChannelCompositorRowKernels::ChannelParameters parameters;
+        parameters.pixelType = src->GetPixelType();
+        parameters.enableTinting = chInfo->enableTinting;
+        parameters.tintingColor = chInfo->tinting.color;
+        parameters.ptrLookUpTable = operation == ChannelOperation::Lut ? chInfo->ptrLookUpTable : nullptr;
+        parameters.enableBlackWhitePoint = operation == ChannelOperation::TintingBlackWhitePt;
+        parameters.blackPoint = parameters.whitePoint = 0;
+        switch (parameters.pixelType)
+        {
+        case PixelType::Gray8:
+        case PixelType::Bgr24:
+            if (parameters.enableBlackWhitePoint)
+            {
+                // we determine the black- and white-point (in units of the pixel value) exactly as the per-pixel functors do
+                const CGetBlackWhitePtGray8 blackWhitePt(chInfo->blackPoint, chInfo->whitePoint);
+                parameters.blackPoint = blackWhitePt.blackPt;
+                parameters.whitePoint = blackWhitePt.whitePt;
+            }
+
+            break;
+        case PixelType::Gray16:
+        case PixelType::Bgr48:
+            if (parameters.enableBlackWhitePoint)
+            {
+                const CGetBlackWhitePtGray16 blackWhitePt(chInfo->blackPoint, chInfo->whitePoint);
+                parameters.blackPoint = blackWhitePt.blackPt;
+                parameters.whitePoint = blackWhitePt.whitePt;
+            }
+
+            break;
+        default:
+            return false;
+        }
+
+        ScopedBitmapLockerP lckSrc{ src };
+        const uint32_t width = src->GetWidth();
+        const uint32_t height = src->GetHeight();
+
+        // the pixels are converted into this buffer, unless they can be stored into the destination directly
+        std::unique_ptr<uint8_t[]> row;
+        if (add || ptrWeight != nullptr)
+        {
+            row.reset(new uint8_t[width * 3]);
+        }
+
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint8_t* pSrc = static_cast<const uint8_t*>(lckSrc.ptrDataRoi) + y * static_cast<ptrdiff_t>(lckSrc.stride);
+            uint8_t* pDst = static_cast<uint8_t*>(lckDst.ptrDataRoi) + y * static_cast<ptrdiff_t>(lckDst.stride);
+            if (!row)
+            {
+                MultiChannelCompositorRowKernels::ConvertToBgr24(parameters, pSrc, width, pDst);
+                continue;
+            }
+
+            MultiChannelCompositorRowKernels::ConvertToBgr24(parameters, pSrc, width, row.get());
+            if (ptrWeight == nullptr)
+            {
+                MultiChannelCompositorRowKernels::AddSaturated(row.get(), width * 3, pDst);
+            }
+            else if (add)
+            {
+                MultiChannelCompositorRowKernels::AddWithWeightSaturated(row.get(), width * 3, *ptrWeight, pDst);
+            }
+            else
+            {
+                MultiChannelCompositorRowKernels::StoreWithWeight(row.get(), width * 3, *ptrWeight, pDst);
+            }
+        }
+
+        return true;
+    }
+
     struct FunctionsBgr24
     {
         static const PixelType expectedDestPixelType = PixelType::Bgr24;
-        void fDoLutCopy(libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { DoLutCopy(dest, lckDst, src, chInfo); }
-        void fDoLutAdd(libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { DoLutAdd(dest, lckDst, src, chInfo); }
-        void fDoTintingBlackWhitePtCopy(libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { DoTintingBlackWhitePtCopy(dest, lckDst, src, chInfo); }
-        void fDoTintingBlackWhitePtAdd(libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { DoTintingBlackWhitePtAdd(dest, lckDst, src, chInfo); }
-        void fDoTintingCopy(libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { DoTintingCopy(dest, lckDst, src, chInfo); }
-        void fDoTintingAdd(libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { DoTintingAdd(dest, lckDst, src, chInfo); }
-        void fDoLutCopy(float weight, libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { DoLutCopy(weight, dest, lckDst, src, chInfo); }
-        void fDoLutAdd(float weight, libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { DoLutAdd(weight, dest, lckDst, src, chInfo); }
-        void fDoTintingBlackWhitePtCopy(float weight, libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { DoTintingBlackWhitePtCopy(weight, dest, lckDst, src, chInfo); }
-        void fDoTintingBlackWhitePtAdd(float weight, libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { DoTintingBlackWhitePtAdd(weight, dest, lckDst, src, chInfo); }
-        void fDoTintingCopy(float weight, libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { DoTintingCopy(weight, dest, lckDst, src, chInfo); }
-        void fDoTintingAdd(float weight, libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { DoTintingAdd(weight, dest, lckDst, src, chInfo); }
+        void fDoLutCopy(libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { if (!TryDoRowKernelsBgr24(ChannelOperation::Lut, false, nullptr, lckDst, src, chInfo)) DoLutCopy(dest, lckDst, src, chInfo); }
+        void fDoLutAdd(libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { if (!TryDoRowKernelsBgr24(ChannelOperation::Lut, true, nullptr, lckDst, src, chInfo)) DoLutAdd(dest, lckDst, src, chInfo); }
+        void fDoTintingBlackWhitePtCopy(libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { if (!TryDoRowKernelsBgr24(ChannelOperation::TintingBlackWhitePt, false, nullptr, lckDst, src, chInfo)) DoTintingBlackWhitePtCopy(dest, lckDst, src, chInfo); }
+        void fDoTintingBlackWhitePtAdd(libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { if (!TryDoRowKernelsBgr24(ChannelOperation::TintingBlackWhitePt, true, nullptr, lckDst, src, chInfo)) DoTintingBlackWhitePtAdd(dest, lckDst, src, chInfo); }
+        void fDoTintingCopy(libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { if (!TryDoRowKernelsBgr24(ChannelOperation::Tinting, false, nullptr, lckDst, src, chInfo)) DoTintingCopy(dest, lckDst, src, chInfo); }
+        void fDoTintingAdd(libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { if (!TryDoRowKernelsBgr24(ChannelOperation::Tinting, true, nullptr, lckDst, src, chInfo)) DoTintingAdd(dest, lckDst, src, chInfo); }
+        void fDoLutCopy(float weight, libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { if (!TryDoRowKernelsBgr24(ChannelOperation::Lut, false, &weight, lckDst, src, chInfo)) DoLutCopy(weight, dest, lckDst, src, chInfo); }
+        void fDoLutAdd(float weight, libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { if (!TryDoRowKernelsBgr24(ChannelOperation::Lut, true, &weight, lckDst, src, chInfo)) DoLutAdd(weight, dest, lckDst, src, chInfo); }
+        void fDoTintingBlackWhitePtCopy(float weight, libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { if (!TryDoRowKernelsBgr24(ChannelOperation::TintingBlackWhitePt, false, &weight, lckDst, src, chInfo)) DoTintingBlackWhitePtCopy(weight, dest, lckDst, src, chInfo); }
+        void fDoTintingBlackWhitePtAdd(float weight, libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { if (!TryDoRowKernelsBgr24(ChannelOperation::TintingBlackWhitePt, true, &weight, lckDst, src, chInfo)) DoTintingBlackWhitePtAdd(weight, dest, lckDst, src, chInfo); }
+        void fDoTintingCopy(float weight, libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { if (!TryDoRowKernelsBgr24(ChannelOperation::Tinting, false, &weight, lckDst, src, chInfo)) DoTintingCopy(weight, dest, lckDst, src, chInfo); }
+        void fDoTintingAdd(float weight, libCZI::IBitmapData* dest, const BitmapLockInfo& lckDst, libCZI::IBitmapData* src, const Compositors::ChannelInfo* chInfo) { if (!TryDoRowKernelsBgr24(ChannelOperation::Tinting, true, &weight, lckDst, src, chInfo)) DoTintingAdd(weight, dest, lckDst, src, chInfo); }
     };
 
     struct FunctionsBgra32
@@ -5,6 +5,9 @@
 #include "SingleChannelAccessorBase.h"
 #include "BitmapOperations.h"
 #include "utilities.h"
+#include "Site.h"
+#include <algorithm>
+#include <cmath>
 
 using namespace std;
 using namespace libCZI;
@@ -139,16 +142,15 @@ std::vector<int> CSingleChannelAccessorBase::CheckForVisibility(const libCZI::In
     const std::shared_ptr<libCZI::ISubBlockRepository>& sbBlkRepository,
     const std::shared_ptr<libCZI::ISubBlockCacheOperation>& cache,
     int subBlockIndex,
-    bool onlyAddCompressedSubBlockToCache)
+    bool onlyAddCompressedSubBlockToCache,
+    const DecodeParameters& decodeParameters)
 {
     SubBlockData result;
 
     // if no cache-object is given, then we simply read the subblock and create a bitmap from it
     if (!cache)
     {
-        const auto subblock = sbBlkRepository->ReadSubBlock(subBlockIndex);
-        result.bitmap = subblock->CreateBitmap();
-        result.subBlockInfo = subblock->GetSubBlockInfo();
+        result = CSingleChannelAccessorBase::DecodeSubBlock(sbBlkRepository->ReadSubBlock(subBlockIndex), cache, subBlockIndex, onlyAddCompressedSubBlockToCache, decodeParameters);
     }
     else
     {
@@ -167,15 +169,405 @@ std::vector<int> CSingleChannelAccessorBase::CheckForVisibility(const libCZI::In
         }
         else
         {
-            const auto subblock = sbBlkRepository->ReadSubBlock(subBlockIndex);
-            result.bitmap = subblock->CreateBitmap();
-            result.subBlockInfo = subblock->GetSubBlockInfo();
-            if (!onlyAddCompressedSubBlockToCache || result.subBlockInfo.GetCompressionMode() != CompressionMode::UnCompressed)
+            result = CSingleChannelAccessorBase::DecodeSubBlock(CSingleChannelAccessorBase::ReadSubBlock(sbBlkRepository, cache, subBlockIndex), cache, subBlockIndex, onlyAddCompressedSubBlockToCache, decodeParameters);
+        }
+    }
+
+    return result;
+}
+
+/*static*/std::shared_ptr<libCZI::ISubBlock> CSingleChannelAccessorBase::ReadSubBlock(
+    const std::shared_ptr<libCZI::ISubBlockRepository>& sbBlkRepository,
+    const std::shared_ptr<libCZI::ISubBlockCacheOperation>& cache,
+    int subBlockIndex)
+{
+    if (cache)
+    {
+        auto subBlock = cache->GetSubBlock(subBlockIndex);
+        if (subBlock)
+        {
+            return subBlock;
+        }
+    }
+
+    auto subBlock = sbBlkRepository->ReadSubBlock(subBlockIndex);
+    if (cache)
+    {
+        cache->AddSubBlock(subBlockIndex, subBlock);
+    }
+
+    return subBlock;
+}
+
+/*static*/CSingleChannelAccessorBase::SubBlockData CSingleChannelAccessorBase::DecodeSubBlock(
+    const std::shared_ptr<libCZI::ISubBlock>& subBlock,
+    const std::shared_ptr<libCZI::ISubBlockCacheOperation>& cache,
+    int subBlockIndex,
+    bool onlyAddCompressedSubBlockToCache,
+    const DecodeParameters& decodeParameters)
+{
+    SubBlockData result;
+    result.subBlockInfo = subBlock->GetSubBlockInfo();
+    const bool isEligibleForCache = cache && (!onlyAddCompressedSubBlockToCache || result.subBlockInfo.GetCompressionMode() != CompressionMode::UnCompressed);
+
+    // If the bitmap is not needed for the cache, the decoder may put the pixels right into the destination (saving the allocation of the bitmap
+    //  and copying it into the destination).
+    if (decodeParameters.ptrDestination != nullptr && !isEligibleForCache && decodeParameters.downscaleFactor == 1)
+    {
+        const IntRect region = decodeParameters.roi.IsValid() ?
+            decodeParameters.roi :
+            IntRect{ 0, 0, static_cast<int>(result.subBlockInfo.physicalSize.w), static_cast<int>(result.subBlockInfo.physicalSize.h) };
+        if (TryDecodeSubBlockRegionInto(subBlock.get(), region, decodeParameters.ptrDestination, decodeParameters.strideDestination))
+        {
+            result.decodedRegion = region;
+            result.decodedIntoDestination = true;
+            return result;
+        }
+    }
+
+    // If the bitmap with full resolution goes into the cache, we decode the whole sub-block - even if only a part of it is needed now,
+    //  a subsequent request (e.g. when panning the viewport) is then served from the cache.
+    if (decodeParameters.roi.IsValid() && !(isEligibleForCache && decodeParameters.downscaleFactor == 1))
+    {
+        result.bitmap = CreateBitmapFromSubBlockRegion(subBlock.get(), decodeParameters.downscaleFactor, decodeParameters.roi, result.decodedRegion);
+    }
+    else
+    {
+        result.bitmap = decodeParameters.downscaleFactor > 1 ? CreateBitmapFromSubBlockWithReducedResolution(subBlock.get(), decodeParameters.downscaleFactor) : subBlock->CreateBitmap();
+    }
+
+    // a bitmap with reduced resolution (or of a part of the sub-block) must not be put into the cache (where the bitmap of the whole sub-block
+    //  with full resolution is expected)
+    const IntRect decodedRegion = result.GetDecodedRegion();
+    const bool isWholeSubBlockWithFullResolution =
+        decodedRegion.x == 0 && decodedRegion.y == 0 &&
+        static_cast<uint32_t>(decodedRegion.w) == result.subBlockInfo.physicalSize.w && static_cast<uint32_t>(decodedRegion.h) == result.subBlockInfo.physicalSize.h &&
+        result.bitmap->GetWidth() == result.subBlockInfo.physicalSize.w && result.bitmap->GetHeight() == result.subBlockInfo.physicalSize.h;
+    if (isEligibleForCache && isWholeSubBlockWithFullResolution)
+    {
+        cache->AddWithDecodeCost(subBlockIndex, result.bitmap, CSingleChannelAccessorBase::GetDecodeCostWeight(result.subBlockInfo.GetCompressionMode()));
+    }
+
+    return result;
+}
+
+/*static*/libCZI::IntRect CSingleChannelAccessorBase::GetRegionOfSubBlockToDecode(const libCZI::IntRect& logicalRect, const libCZI::IntSize& physicalSize, const libCZI::IntRect& roi)
+{
+    const IntRect intersection = logicalRect.Intersect(roi);
+    if (!intersection.IsNonEmpty() || logicalRect.w <= 0 || logicalRect.h <= 0)
+    {
+        return IntRect{ 0, 0, -1, -1 };
+    }
+
+    // map the intersection to pixels of the sub-block (rounding outwards), and add a margin of one pixel in order to
+    //  account for rounding in the scaling operation
+    const double scaleX = static_cast<double>(physicalSize.w) / logicalRect.w;
+    const double scaleY = static_cast<double>(physicalSize.h) / logicalRect.h;
+    const int xStart = (max)(0, static_cast<int>(floor((intersection.x - logicalRect.x) * scaleX)) - 1);
+    const int yStart = (max)(0, static_cast<int>(floor((intersection.y - logicalRect.y) * scaleY)) - 1);
+    const int xEnd = (min)(static_cast<int>(physicalSize.w), static_cast<int>(ceil((intersection.x + intersection.w - logicalRect.x) * scaleX)) + 1);
+    const int yEnd = (min)(static_cast<int>(physicalSize.h), static_cast<int>(ceil((intersection.y + intersection.h - logicalRect.y) * scaleY)) + 1);
+
+    // decoding a region has some overhead (the bitstream still has to be parsed up to the region), so we only do it if at most
+    //  half of the sub-block is needed
+    const uint64_t areaOfRegion = static_cast<uint64_t>(xEnd - xStart) * static_cast<uint64_t>(yEnd - yStart);
+    if (2 * areaOfRegion > static_cast<uint64_t>(physicalSize.w) * physicalSize.h)
+    {
+        return IntRect{ 0, 0, -1, -1 };
+    }
+
+    return IntRect{ xStart, yStart, xEnd - xStart, yEnd - yStart };
+}
+
+/*static*/std::uint32_t CSingleChannelAccessorBase::GetDecodeCostWeight(libCZI::CompressionMode compressionMode)
+{
+    // a rough estimate of the cost of decoding (per byte of the decoded bitmap), relative to copying uncompressed data
+    switch (compressionMode)
+    {
+    case CompressionMode::UnCompressed:
+        return 1;
+    case CompressionMode::Zstd0:
+    case CompressionMode::Zstd1:
+        return 4;
+    case CompressionMode::Jpg:
+        return 16;
+    case CompressionMode::JpgXr:
+        return 32;
+    default:
+        return 8;
+    }
+}
+
+//----------------------------------------------------------------------------------------
+
+/*static*/constexpr size_t CSingleChannelAccessorBase::ConcurrentSubBlockReader::kMaxSubBlocksPerBatch;
+
+CSingleChannelAccessorBase::ConcurrentSubBlockReader::ConcurrentSubBlockReader(
+    const std::shared_ptr<libCZI::ISubBlockRepository>& sbBlkRepository,
+    const std::shared_ptr<libCZI::ISubBlockCacheOperation>& cache,
+    bool onlyAddCompressedSubBlockToCache,
+    std::vector<int> subBlockIndices,
+    int maxConcurrency,
+    libCZI::TaskPriority priority,
+    std::vector<DecodeParameters> decodeParameters)
+    : state_(std::make_shared<State>()),
+    priority_(priority),
+    maxNumberOfTasks_(0)
+{
+    this->state_->sbBlkRepository = sbBlkRepository;
+    this->state_->cache = cache;
+    this->state_->onlyAddCompressedSubBlockToCache = onlyAddCompressedSubBlockToCache;
+    this->state_->subBlockIndices = std::move(subBlockIndices);
+    this->state_->decodeParameters = std::move(decodeParameters);
+    this->state_->hasDestinations = std::any_of(
+        this->state_->decodeParameters.cbegin(),
+        this->state_->decodeParameters.cend(),
+        [](const DecodeParameters& parameters)->bool { return parameters.ptrDestination != nullptr; });
+    this->state_->slots.resize(this->state_->subBlockIndices.size());
+    if (this->state_->subBlockIndices.size() > 1)
+    {
+        this->state_->batchRepository = std::dynamic_pointer_cast<libCZI::ISubBlockRepositoryEx>(sbBlkRepository);
+        if (this->state_->batchRepository)
+        {
+            this->state_->prefetched.resize(this->state_->subBlockIndices.size());
+        }
+    }
+
+    if (maxConcurrency > 1 && this->state_->subBlockIndices.size() > 1)
+    {
+        this->executor_ = GetTaskExecutor();
+        this->maxNumberOfTasks_ = static_cast<int>((std::min)(static_cast<size_t>(maxConcurrency), this->state_->subBlockIndices.size()));
+        this->state_->maxLookAhead = 2 * static_cast<size_t>(this->maxNumberOfTasks_);
+        std::unique_lock<std::mutex> lock(this->state_->mutex);
+        this->SubmitTasks(lock);
+    }
+}
+
+CSingleChannelAccessorBase::ConcurrentSubBlockReader::~ConcurrentSubBlockReader()
+{
+    std::unique_lock<std::mutex> lock(this->state_->mutex);
+    this->state_->cancel = true;
+    if (this->state_->hasDestinations)
+    {
+        // the caller regains control over the destinations when we return, so no task must write to them afterwards
+        this->state_->condition.wait(lock, [&]()->bool {return this->state_->readsInProgress == 0; });
+    }
+}
+
+CSingleChannelAccessorBase::SubBlockData CSingleChannelAccessorBase::ConcurrentSubBlockReader::Get(size_t position)
+{
+    State& state = *this->state_;
+    std::unique_lock<std::mutex> lock(state.mutex);
+    Slot& slot = state.slots.at(position);
+    if (state.next <= position)
+    {
+        // the sub-block has not been started by a task (or there are no tasks), so we read it here
+        state.next = position + 1;
+        state.consumed = position + 1;
+        this->SubmitTasks(lock);
+        lock.unlock();
+        return ConcurrentSubBlockReader::ReadSubBlockData(state, position);
+    }
+
+    state.condition.wait(lock, [&]()->bool {return slot.ready; });
+    state.consumed = position + 1;
+    const auto exception = slot.exception;
+    SubBlockData data = std::move(slot.data);
+    this->SubmitTasks(lock);
+    lock.unlock();
+
+    if (exception)
+    {
+        std::rethrow_exception(exception);
+    }
+
+    return data;
+}
+
+void CSingleChannelAccessorBase::ConcurrentSubBlockReader::SubmitTasks(std::unique_lock<std::mutex>& lock)
+{
+    // determine how many additional tasks can make progress (the lock must be held when calling this method)
+    State& state = *this->state_;
+    const size_t numberOfSubBlocksToBeStarted = state.GetEndOfReadAheadRange() > state.next ? state.GetEndOfReadAheadRange() - state.next : 0;
+    int numberOfTasksToSubmit = 0;
+    while (state.activeTasks + numberOfTasksToSubmit < this->maxNumberOfTasks_ &&
+        static_cast<size_t>(state.activeTasks + numberOfTasksToSubmit) < numberOfSubBlocksToBeStarted)
+    {
+        ++numberOfTasksToSubmit;
+    }
+
+    if (numberOfTasksToSubmit == 0)
+    {
+        return;
+    }
+
+    state.activeTasks += numberOfTasksToSubmit;
+
+    // the executor may choose to run the task synchronously, so we must not hold the lock while submitting
+    lock.unlock();
+    int numberOfTasksSubmitted = 0;
+    try
+    {
+        for (; numberOfTasksSubmitted < numberOfTasksToSubmit; ++numberOfTasksSubmitted)
+        {
+            auto state_for_task = this->state_;
+            this->executor_->Submit(this->priority_, [state_for_task]()->void { TaskFunction(state_for_task); });
+        }
+    }
+    catch (...)
+    {
+        // if the executor refuses to take more tasks, the remaining sub-blocks will be read on the calling thread
+    }
+
+    lock.lock();
+    state.activeTasks -= numberOfTasksToSubmit - numberOfTasksSubmitted;
+}
+
+/*static*/void CSingleChannelAccessorBase::ConcurrentSubBlockReader::TaskFunction(const std::shared_ptr<State>& state)
+{
+    for (;;)
+    {
+        size_t position;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->cancel || state->next >= state->GetEndOfReadAheadRange())
             {
-                cache->Add(subBlockIndex, result.bitmap);
+                --state->activeTasks;
+                return;
             }
+
+            position = state->next++;
+            ++state->readsInProgress;
+        }
+
+        SubBlockData data{};
+        std::exception_ptr exception;
+        try
+        {
+            data = ConcurrentSubBlockReader::ReadSubBlockData(*state, position);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            Slot& slot = state->slots[position];
+            slot.data = std::move(data);
+            slot.exception = exception;
+            slot.ready = true;
+            --state->readsInProgress;
+        }
+
+        state->condition.notify_all();
+    }
+}
+
+/*static*/CSingleChannelAccessorBase::SubBlockData CSingleChannelAccessorBase::ConcurrentSubBlockReader::ReadSubBlockData(State& state, size_t position)
+{
+    const int subBlockIndex = state.subBlockIndices[position];
+    const DecodeParameters decodeParameters = state.decodeParameters.empty() ? DecodeParameters() : state.decodeParameters[position];
+    const PrefetchedSubBlock prefetched = ConcurrentSubBlockReader::TakePrefetchedSubBlock(state, position);
+    if (prefetched.bitmapFromCache)
+    {
+        SubBlockData result;
+        if (!state.sbBlkRepository->TryGetSubBlockInfo(subBlockIndex, &result.subBlockInfo))
+        {
+            stringstream ss;
+            ss << "SubBlockInfo not found in repository for subblock index " << subBlockIndex << ".";
+            throw logic_error(ss.str());
+        }
+
+        result.bitmap = prefetched.bitmapFromCache;
+        return result;
+    }
+
+    if (prefetched.subBlock)
+    {
+        return CSingleChannelAccessorBase::DecodeSubBlock(prefetched.subBlock, state.cache, subBlockIndex, state.onlyAddCompressedSubBlockToCache, decodeParameters);
+    }
+
+    return CSingleChannelAccessorBase::GetSubBlockDataForSubBlockIndex(state.sbBlkRepository, state.cache, subBlockIndex, state.onlyAddCompressedSubBlockToCache, decodeParameters);
+}
+
+/*static*/CSingleChannelAccessorBase::ConcurrentSubBlockReader::PrefetchedSubBlock CSingleChannelAccessorBase::ConcurrentSubBlockReader::TakePrefetchedSubBlock(State& state, size_t position)
+{
+    if (!state.batchRepository)
+    {
+        return {};
+    }
+
+    std::unique_lock<std::mutex> lock(state.mutex);
+    while (position >= state.prefetchedEnd)
+    {
+        if (!state.prefetchInProgress)
+        {
+            // this thread does the next batched read - it starts where the previous one ended and includes the requested position
+            const size_t start = state.prefetchedEnd;
+            const size_t end = (std::min)(state.subBlockIndices.size(), (std::max)(start + kMaxSubBlocksPerBatch, position + 1));
+            state.prefetchInProgress = true;
+            lock.unlock();
+
+            std::vector<PrefetchedSubBlock> batch(end - start);
+            try
+            {
+                // sub-blocks whose bitmap is in the cache need not be read
+                std::vector<int> indicesToRead;
+                std::vector<size_t> positionsInBatch;
+                for (size_t i = start; i < end; ++i)
+                {
+                    if (state.cache)
+                    {
+                        batch[i - start].bitmapFromCache = state.cache->Get(state.subBlockIndices[i]);
+                    }
+
+                    if (!batch[i - start].bitmapFromCache && state.cache)
+                    {
+                        // if the bitmap is not in the cache, the sub-block may still be in its compressed tier
+                        batch[i - start].subBlock = state.cache->GetSubBlock(state.subBlockIndices[i]);
+                    }
+
+                    if (!batch[i - start].bitmapFromCache && !batch[i - start].subBlock)
+                    {
+                        indicesToRead.push_back(state.subBlockIndices[i]);
+                        positionsInBatch.push_back(i - start);
+                    }
+                }
+
+                if (!indicesToRead.empty())
+                {
+                    auto subBlocks = state.batchRepository->ReadSubBlocks(indicesToRead);
+                    for (size_t i = 0; i < positionsInBatch.size(); ++i)
+                    {
+                        if (state.cache)
+                        {
+                            state.cache->AddSubBlock(indicesToRead[i], subBlocks[i]);
+                        }
+
+                        batch[positionsInBatch[i]].subBlock = std::move(subBlocks[i]);
+                    }
+                }
+            }
+            catch (...)
+            {
+                // if the batched read fails, the sub-blocks are read individually (and an error is then reported for the sub-block concerned)
+                batch = std::vector<PrefetchedSubBlock>(end - start);
+            }
+
+            lock.lock();
+            std::move(batch.begin(), batch.end(), state.prefetched.begin() + start);
+            state.prefetchedEnd = end;
+            state.prefetchInProgress = false;
+            state.condition.notify_all();
+        }
+        else
+        {
+            state.condition.wait(lock);
         }
     }
 
+    PrefetchedSubBlock result = std::move(state.prefetched[position]);
+    state.prefetched[position] = PrefetchedSubBlock();
     return result;
 }
@@ -4,7 +4,12 @@
 
 #pragma once
 
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include "libCZI.h"
 
 class CSingleChannelAccessorBase
@@ -71,11 +76,170 @@ protected:
     {
         std::shared_ptr<libCZI::IBitmapData> bitmap;
         libCZI::SubBlockInfo subBlockInfo;
+        libCZI::IntRect decodedRegion{ 0, 0, -1, -1 };  ///< If valid, the bitmap covers only this region of the sub-block (c.f. CreateBitmapFromSubBlockRegion), otherwise the whole sub-block.
+        bool decodedIntoDestination{ false };           ///< If true, the decoded region has been put into the destination given with the DecodeParameters (and there is no bitmap).
+
+        /// Gets the region of the sub-block (in pixels of the sub-block at full resolution) which the bitmap covers.
+        libCZI::IntRect GetDecodedRegion() const
+        {
+            return this->decodedRegion.IsValid() ? this->decodedRegion : libCZI::IntRect{ 0, 0, static_cast<int>(this->subBlockInfo.physicalSize.w), static_cast<int>(this->subBlockInfo.physicalSize.h) };
+        }
+    };
+
+    /// The parameters for decoding a sub-block.
+    struct DecodeParameters
+    {
+        std::uint32_t downscaleFactor;  ///< The downscale factor (c.f. CreateBitmapFromSubBlockWithReducedResolution).
+        libCZI::IntRect roi;            ///< If valid, only this region of the sub-block (in pixels of the sub-block at full resolution) is needed.
+        void* ptrDestination;           ///< If non-null, the region (or the whole sub-block) may be decoded directly into this memory (c.f. TryDecodeSubBlockRegionInto).
+        std::uint32_t strideDestination;///< The stride of the memory given with 'ptrDestination'.
+
+        DecodeParameters() : downscaleFactor(1), roi{ 0, 0, -1, -1 }, ptrDestination(nullptr), strideDestination(0) {}
     };
 
     static SubBlockData GetSubBlockDataForSubBlockIndex(
         const std::shared_ptr<libCZI::ISubBlockRepository>& sbBlkRepository, 
         const std::shared_ptr<libCZI::ISubBlockCacheOperation>& cache,
         int subBlockIndex,
-        bool onlyAddCompressedSubBlockToCache);
+        bool onlyAddCompressedSubBlockToCache,
+        const DecodeParameters& decodeParameters = DecodeParameters());
+
+    /// Reads the specified sub-block - if a cache is given and the sub-block is found in its compressed tier, then it is taken from there;
+    /// otherwise it is read from the repository and added to the compressed tier (c.f. ISubBlockCacheOperation::AddSubBlock).
+    static std::shared_ptr<libCZI::ISubBlock> ReadSubBlock(
+        const std::shared_ptr<libCZI::ISubBlockRepository>& sbBlkRepository,
+        const std::shared_ptr<libCZI::ISubBlockCacheOperation>& cache,
+        int subBlockIndex);
+
+    /// Creates the bitmap for the specified sub-block (which has been read already) and adds it to the cache (if a cache is given).
+    /// If a downscale factor greater than one is given, then the bitmap may be decoded with reduced resolution (c.f. CreateBitmapFromSubBlockWithReducedResolution),
+    /// and a bitmap with reduced resolution is not added to the cache. If a region is given, then only this region may be decoded
+    /// (c.f. CreateBitmapFromSubBlockRegion) - unless the bitmap with full resolution is to be added to the cache, in which case
+    /// the whole sub-block is decoded (so that the cached bitmap can be used for subsequent requests). If a destination is given, the
+    /// bitmap is not to be added to the cache and the downscale factor is one, then the region is decoded directly into the destination
+    /// if the decoder supports it - in this case, the result has no bitmap and 'decodedIntoDestination' is set.
+    static SubBlockData DecodeSubBlock(
+        const std::shared_ptr<libCZI::ISubBlock>& subBlock,
+        const std::shared_ptr<libCZI::ISubBlockCacheOperation>& cache,
+        int subBlockIndex,
+        bool onlyAddCompressedSubBlockToCache,
+        const DecodeParameters& decodeParameters = DecodeParameters());
+
+    /// Gets the region of a sub-block which is to be decoded in order to draw the part of the sub-block within the specified
+    /// ROI - or an invalid rectangle if the whole sub-block should be decoded. Decoding a region is only worthwhile if the
+    /// visible part is considerably smaller than the sub-block.
+    ///
+    /// \param  logicalRect     The logical rectangle of the sub-block.
+    /// \param  physicalSize    The physical size of the sub-block.
+    /// \param  roi             The ROI (in the same coordinate system as the logical rectangle).
+    ///
+    /// \returns    The region (in pixels of the sub-block at full resolution) to be decoded, or an invalid rectangle.
+    static libCZI::IntRect GetRegionOfSubBlockToDecode(const libCZI::IntRect& logicalRect, const libCZI::IntSize& physicalSize, const libCZI::IntRect& roi);
+
+    /// Gets the (estimated) relative cost of decoding a sub-block with the specified compression mode, which is passed
+    /// to the sub-block cache (c.f. ISubBlockCacheOperation::AddWithDecodeCost).
+    static std::uint32_t GetDecodeCostWeight(libCZI::CompressionMode compressionMode);
+
+    /// This class reads and decodes a list of sub-blocks, possibly concurrently. If concurrency is requested, then tasks which read and
+    /// decode the sub-blocks are submitted to the task executor of the site. The results are retrieved in the order of the list, so that the
+    /// composition can be done in the same order as with sequential reading (and gives an identical result). The tasks run ahead of the consumer
+    /// by at most two sub-blocks per task, which bounds the memory used for decoded bitmaps. A sub-block which was not yet started by a task
+    /// when it is requested is read on the calling thread, so the consumer never waits for a task which is not running (and there is no
+    /// deadlock if the calling thread is itself a thread of the executor). When the object is destroyed, sub-blocks which have not yet been
+    /// started are skipped; there is no need to wait for the tasks, since they share the ownership of the state.
+    /// If the repository supports batched reads (ISubBlockRepositoryEx::ReadSubBlocks), then the sub-blocks are read in batches (of up to
+    /// kMaxSubBlocksPerBatch sub-blocks, so for a typical viewport there is only one batch) ahead of decoding them.
+    class ConcurrentSubBlockReader
+    {
+    private:
+        /// The maximum number of sub-blocks which are read with one batched read.
+        static constexpr size_t kMaxSubBlocksPerBatch = 64;
+
+        struct Slot
+        {
+            SubBlockData data;
+            std::exception_ptr exception;
+            bool ready{ false };
+        };
+
+        /// The result of the batched read for a sub-block - either the bitmap was found in the cache, or the sub-block
+        /// was read (but not yet decoded). If both are empty, then the sub-block is to be read individually.
+        struct PrefetchedSubBlock
+        {
+            std::shared_ptr<libCZI::IBitmapData> bitmapFromCache;
+            std::shared_ptr<libCZI::ISubBlock> subBlock;
+        };
+
+        struct State
+        {
+            std::shared_ptr<libCZI::ISubBlockRepository> sbBlkRepository;
+            std::shared_ptr<libCZI::ISubBlockCacheOperation> cache;
+            bool onlyAddCompressedSubBlockToCache;
+            std::vector<int> subBlockIndices;
+            std::vector<DecodeParameters> decodeParameters; ///< The decode parameters for each sub-block (or empty, if all sub-blocks are decoded completely with full resolution).
+            std::vector<Slot> slots;
+            std::mutex mutex;
+            std::condition_variable condition;
+            size_t next{ 0 };               ///< The position of the next sub-block to be read (all sub-blocks before it are started or skipped).
+            size_t consumed{ 0 };           ///< The number of positions which have been retrieved by the consumer.
+            size_t maxLookAhead{ 0 };       ///< How far the tasks are allowed to run ahead of the consumer.
+            int activeTasks{ 0 };           ///< The number of tasks which are submitted and not yet finished.
+            int readsInProgress{ 0 };       ///< The number of sub-blocks which are currently being read by tasks.
+            bool cancel{ false };
+            bool hasDestinations{ false };  ///< Whether sub-blocks may be decoded directly into a destination (c.f. DecodeParameters::ptrDestination).
+            std::shared_ptr<libCZI::ISubBlockRepositoryEx> batchRepository;   ///< If the repository supports batched reads, this is it (otherwise empty).
+            std::vector<PrefetchedSubBlock> prefetched;
+            size_t prefetchedEnd{ 0 };      ///< The batched read has been done for all positions before this one.
+            bool prefetchInProgress{ false };
+
+            /// Gets the (exclusive) end of the range of positions which tasks are currently allowed to read.
+            size_t GetEndOfReadAheadRange() const { return (std::min)(this->subBlockIndices.size(), this->consumed + this->maxLookAhead); }
+        };
+
+        std::shared_ptr<State> state_;
+        std::shared_ptr<libCZI::ITaskExecutor> executor_;
+        libCZI::TaskPriority priority_;
+        int maxNumberOfTasks_;
+    public:
+        /// Constructor - if concurrency is requested, the first tasks are submitted immediately.
+        ///
+        /// \param  sbBlkRepository                     The sub-block repository.
+        /// \param  cache                               The sub-block cache (may be empty).
+        /// \param  onlyAddCompressedSubBlockToCache    True to only add bitmaps from compressed sub-blocks to the cache.
+        /// \param  subBlockIndices                     The list of sub-block indices to read.
+        /// \param  maxConcurrency                      The maximum number of sub-blocks which are read concurrently. If this is 1 (or less),
+        ///                                             then all sub-blocks are read on the calling thread.
+        /// \param  priority                            The priority with which the tasks are submitted to the executor.
+        /// \param  decodeParameters                    The decode parameters for each sub-block in the list (c.f. DecodeSubBlock). If empty,
+        ///                                             then all sub-blocks are decoded completely with full resolution. If destinations are
+        ///                                             given, then the destructor waits for the sub-blocks currently being read by tasks, so
+        ///                                             that the destinations are not written to after the object has been destroyed.
+        ConcurrentSubBlockReader(
+            const std::shared_ptr<libCZI::ISubBlockRepository>& sbBlkRepository,
+            const std::shared_ptr<libCZI::ISubBlockCacheOperation>& cache,
+            bool onlyAddCompressedSubBlockToCache,
+            std::vector<int> subBlockIndices,
+            int maxConcurrency,
+            libCZI::TaskPriority priority,
+            std::vector<DecodeParameters> decodeParameters = std::vector<DecodeParameters>());
+        ~ConcurrentSubBlockReader();
+
+        ConcurrentSubBlockReader(const ConcurrentSubBlockReader&) = delete;
+        ConcurrentSubBlockReader& operator=(const ConcurrentSubBlockReader&) = delete;
+
+        /// Gets the data for the sub-block at the specified position in the list - waiting for it to become available if necessary. An exception
+        /// which occurred when reading the sub-block is rethrown here. The data is passed to the caller (and not kept by this object), so this
+        /// method must be called only once for each position, and with increasing positions.
+        ///
+        /// \param  position    The position in the list of sub-block indices.
+        ///
+        /// \returns    The sub-block data.
+        SubBlockData Get(size_t position);
+
+    private:
+        void SubmitTasks(std::unique_lock<std::mutex>& lock);
+        static void TaskFunction(const std::shared_ptr<State>& state);
+        static SubBlockData ReadSubBlockData(State& state, size_t position);
+        static PrefetchedSubBlock TakePrefetchedSubBlock(State& state, size_t position);
+    };
 };
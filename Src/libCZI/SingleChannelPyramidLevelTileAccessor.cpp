@@ -98,17 +98,28 @@ void CSingleChannelPyramidLevelTileAccessor::ComposeTiles(libCZI::IBitmapData* b
     Compositors::ComposeSingleTileOptions composeOptions; composeOptions.Clear();
     composeOptions.drawTileBorder = options.drawTileBorder;
 
+    // if requested, the subblocks are read and decoded concurrently - and we retrieve them in the order of rendering
+    std::vector<int> subBlockIndices;
+    subBlockIndices.reserve(bitmapCnt);
+    for (int i = 0; i < bitmapCnt; ++i)
+    {
+        subBlockIndices.push_back(getSbInfo(i).index);
+    }
+
+    ConcurrentSubBlockReader subBlockReader(
+        this->sbBlkRepository,
+        options.subBlockCache,
+        options.onlyUseSubBlockCacheForCompressedData,
+        std::move(subBlockIndices),
+        options.maxNumberOfDecodeThreads,
+        options.decodeTaskPriority);
+
     Compositors::ComposeSingleChannelTiles(
         [&](int index, std::shared_ptr<libCZI::IBitmapData>& spBm, int& xPosTile, int& yPosTile)->bool
         {
             if (index < bitmapCnt)
             {
-                const SbInfo sbinfo = getSbInfo(index);
-                const auto subblock_bitmap_data = CSingleChannelAccessorBase::GetSubBlockDataForSubBlockIndex(
-                        this->sbBlkRepository,
-                        options.subBlockCache,
-                        sbinfo.index,
-                        options.onlyUseSubBlockCacheForCompressedData);
+                const auto subblock_bitmap_data = subBlockReader.Get(index);
                 spBm = subblock_bitmap_data.bitmap;
                 xPosTile = (subblock_bitmap_data.subBlockInfo.logicalRect.x - xPos) / sizeOfPixel;
                 yPosTile = (subblock_bitmap_data.subBlockInfo.logicalRect.y - yPos) / sizeOfPixel;
@@ -233,7 +244,7 @@ std::vector<CSingleChannelPyramidLevelTileAccessor::SbInfo> CSingleChannelPyrami
 /// \param appender								   A functor which will called passing in subblocks matching the conditions.
 void CSingleChannelPyramidLevelTileAccessor::GetAllSubBlocks(const libCZI::IntRect& roi, const libCZI::IDimCoordinate* planeCoordinate, const libCZI::IIndexSet* sceneFilter, const std::function<void(const SbInfo&)>& appender) const
 {
-    this->sbBlkRepository->EnumSubset(planeCoordinate, nullptr, false,
+    this->sbBlkRepository->EnumSubset(planeCoordinate, &roi, false,
         [&](int idx, const SubBlockInfo& info)->bool
         {
             if (sceneFilter != nullptr)
@@ -248,16 +259,12 @@ void CSingleChannelPyramidLevelTileAccessor::GetAllSubBlocks(const libCZI::IntRe
                 }
             }
 
-            if (Utilities::DoIntersect(roi, info.logicalRect))
-            {
-                SbInfo sbinfo;
-                sbinfo.logicalRect = info.logicalRect;
-                sbinfo.physicalSize = info.physicalSize;
-                sbinfo.mIndex = info.mIndex;
-                sbinfo.index = idx;
-                appender(sbinfo);
-            }
-
+            SbInfo sbinfo;
+            sbinfo.logicalRect = info.logicalRect;
+            sbinfo.physicalSize = info.physicalSize;
+            sbinfo.mIndex = info.mIndex;
+            sbinfo.index = idx;
+            appender(sbinfo);
             return true;
         });
 }
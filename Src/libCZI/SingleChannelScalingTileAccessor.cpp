@@ -10,6 +10,8 @@
 using namespace libCZI;
 using namespace std;
 
+/*static*/constexpr std::uint32_t CSingleChannelScalingTileAccessor::kMaxDownscaleFactorForDecode;
+
 CSingleChannelScalingTileAccessor::CSingleChannelScalingTileAccessor(const std::shared_ptr<ISubBlockRepository>& sbBlkRepository)
     : CSingleChannelAccessorBase(sbBlkRepository)
 {
@@ -78,13 +80,8 @@ CSingleChannelScalingTileAccessor::CSingleChannelScalingTileAccessor(const std::
     return IntSize{ static_cast<uint32_t>(roi.w * zoom),static_cast<uint32_t>(roi.h * zoom) };
 }
 
-void CSingleChannelScalingTileAccessor::ScaleBlt(libCZI::IBitmapData* bmDest, float zoom, const libCZI::IntRect& roi, const SbInfo& sbInfo, const libCZI::ISingleChannelScalingTileAccessor::Options& options)
+void CSingleChannelScalingTileAccessor::ScaleBlt(libCZI::IBitmapData* bmDest, float zoom, const libCZI::IntRect& roi, const SbInfo& sbInfo, const SubBlockData& subblock_bitmap_data)
 {
-    auto subblock_bitmap_data = CSingleChannelAccessorBase::GetSubBlockDataForSubBlockIndex(
-        this->sbBlkRepository,
-        options.subBlockCache,
-        sbInfo.index,
-        options.onlyUseSubBlockCacheForCompressedData);
     if (GetSite()->IsEnabled(LOGLEVEL_CHATTYINFORMATION))
     {
         stringstream ss;
@@ -94,6 +91,9 @@ void CSingleChannelScalingTileAccessor::ScaleBlt(libCZI::IBitmapData* bmDest, fl
 
     const auto& source = subblock_bitmap_data.bitmap;
 
+    // the bitmap may cover only a region of the sub-block (given in pixels of the sub-block at full resolution)
+    const IntRect decodedRegion = subblock_bitmap_data.GetDecodedRegion();
+
     // In order not to run into trouble with floating point precision, if the scale is exactly 1, we refrain from using the scaling operation
     //  and do instead a simple copy operation. This should ensure a pixel-accurate result if zoom is exactly 1.
     if (zoom == 1)
@@ -101,8 +101,8 @@ void CSingleChannelScalingTileAccessor::ScaleBlt(libCZI::IBitmapData* bmDest, fl
         ScopedBitmapLockerSP srcLck{ source };
         ScopedBitmapLockerP dstLck{ bmDest };
         CBitmapOperations::CopyWithOffsetInfo info;
-        info.xOffset = sbInfo.logicalRect.x - roi.x;
-        info.yOffset = sbInfo.logicalRect.y - roi.y;
+        info.xOffset = sbInfo.logicalRect.x + decodedRegion.x - roi.x;
+        info.yOffset = sbInfo.logicalRect.y + decodedRegion.y - roi.y;
         info.srcPixelType = source->GetPixelType();
         info.srcPtr = srcLck.ptrDataRoi;
         info.srcStride = srcLck.stride;
@@ -135,10 +135,14 @@ void CSingleChannelScalingTileAccessor::ScaleBlt(libCZI::IBitmapData* bmDest, fl
         DblRect srcRoi{ roiSrcTopLeftX ,roiSrcTopLeftY,roiSrcBttmRightX - roiSrcTopLeftX ,roiSrcBttmRightY - roiSrcTopLeftY };
         DblRect dstRoi{ destTopLeftX ,destTopLeftY,destBttmRightX - destTopLeftX ,destBttmRightY - destTopLeftY };
 
-        srcRoi.x *= sbInfo.physicalSize.w;
-        srcRoi.y *= sbInfo.physicalSize.h;
-        srcRoi.w *= sbInfo.physicalSize.w;
-        srcRoi.h *= sbInfo.physicalSize.h;
+        // map the source ROI to the pixels of the bitmap - note that the bitmap may cover only a region of the sub-block, and it may have
+        //  been decoded with reduced resolution, so we use its actual size (and not the physical size of the sub-block)
+        const double scaleX = static_cast<double>(source->GetWidth()) / decodedRegion.w;
+        const double scaleY = static_cast<double>(source->GetHeight()) / decodedRegion.h;
+        srcRoi.x = (srcRoi.x * sbInfo.physicalSize.w - decodedRegion.x) * scaleX;
+        srcRoi.y = (srcRoi.y * sbInfo.physicalSize.h - decodedRegion.y) * scaleY;
+        srcRoi.w *= sbInfo.physicalSize.w * scaleX;
+        srcRoi.h *= sbInfo.physicalSize.h * scaleY;
 
         dstRoi.x *= bmDest->GetWidth();
         dstRoi.y *= bmDest->GetHeight();
@@ -149,6 +153,23 @@ void CSingleChannelScalingTileAccessor::ScaleBlt(libCZI::IBitmapData* bmDest, fl
     }
 }
 
+/*static*/std::uint32_t CSingleChannelScalingTileAccessor::GetDownscaleFactorForDecode(const SbInfo& sbInfo, float zoom)
+{
+    // the ratio of the (physical) pixels of the sub-block to the pixels it covers in the destination bitmap
+    const double ratio = (std::min)(
+        sbInfo.physicalSize.w / (static_cast<double>(sbInfo.logicalRect.w) * zoom),
+        sbInfo.physicalSize.h / (static_cast<double>(sbInfo.logicalRect.h) * zoom));
+
+    // choose the largest power of two which still gives (at least) the resolution of the destination
+    std::uint32_t downscaleFactor = 1;
+    while (downscaleFactor < CSingleChannelScalingTileAccessor::kMaxDownscaleFactorForDecode && 2 * downscaleFactor <= ratio)
+    {
+        downscaleFactor *= 2;
+    }
+
+    return downscaleFactor;
+}
+
 int CSingleChannelScalingTileAccessor::GetIdxOf1stSubBlockWithZoomGreater(const std::vector<SbInfo>& sbBlks, const std::vector<int>& byZoom, float zoom)
 {
     // now, skip until the zoom of the subBlock is greater than the specified zoom
@@ -338,21 +359,11 @@ void CSingleChannelScalingTileAccessor::Paint(libCZI::IBitmapData* bmDest, const
         }
     }
 
+    // this is the list of subblocks to be drawn (given as indices into the subBlocks-vector), in the order of drawing
+    std::vector<int> subBlocksToDraw;
     if (!options.useVisibilityCheckOptimization)
     {
-        for (auto it = start_iterator; it != end_iterator; ++it)
-        {
-            const SbInfo& sbInfo = sbSetSortedByZoom.subBlocks.at(*it);
-
-            if (GetSite()->IsEnabled(LOGLEVEL_CHATTYINFORMATION))
-            {
-                stringstream ss;
-                ss << " Drawing subblock: idx=" << sbInfo.index << " Log.: " << sbInfo.logicalRect << " Phys.Size: " << sbInfo.physicalSize;
-                GetSite()->Log(LOGLEVEL_CHATTYINFORMATION, ss);
-            }
-
-            this->ScaleBlt(bmDest, zoom, roi, sbInfo, options);
-        }
+        subBlocksToDraw.assign(start_iterator, end_iterator);
     }
     else
     {
@@ -367,20 +378,55 @@ void CSingleChannelScalingTileAccessor::Paint(libCZI::IBitmapData* bmDest, const
             });
 
         // Now, draw only the subblocks which are visible - the vector "indices_of_visible_tiles" contains the indices "as they were passed to the lambda".
+        subBlocksToDraw.reserve(indices_of_visible_tiles.size());
         for (const auto i : indices_of_visible_tiles)
         {
             // dereference the iterator (advanced by the index from out loop variable), this gives us an index into the
             // subBlocks-vector
-            const SbInfo& sbInfo = sbSetSortedByZoom.subBlocks.at(*(start_iterator + i));
-            if (GetSite()->IsEnabled(LOGLEVEL_CHATTYINFORMATION))
-            {
-                stringstream ss;
-                ss << " Drawing subblock: idx=" << sbInfo.index << " Log.: " << sbInfo.logicalRect << " Phys.Size: " << sbInfo.physicalSize;
-                GetSite()->Log(LOGLEVEL_CHATTYINFORMATION, ss);
-            }
+            subBlocksToDraw.push_back(*(start_iterator + i));
+        }
+    }
+
+    // if requested, the subblocks are read and decoded concurrently - and we retrieve them in the order of drawing; for subblocks which
+    //  are only partially visible, only the visible region is decoded (if the decoder supports this)
+    std::vector<int> subBlockIndices;
+    std::vector<DecodeParameters> decodeParameters;
+    subBlockIndices.reserve(subBlocksToDraw.size());
+    decodeParameters.reserve(subBlocksToDraw.size());
+    for (const auto i : subBlocksToDraw)
+    {
+        const SbInfo& sbInfo = sbSetSortedByZoom.subBlocks.at(i);
+        subBlockIndices.push_back(sbInfo.index);
+        DecodeParameters parameters;
+        if (options.useReducedResolutionDecode)
+        {
+            parameters.downscaleFactor = CSingleChannelScalingTileAccessor::GetDownscaleFactorForDecode(sbInfo, zoom);
+        }
 
-            this->ScaleBlt(bmDest, zoom, roi, sbInfo, options);
+        parameters.roi = CSingleChannelAccessorBase::GetRegionOfSubBlockToDecode(sbInfo.logicalRect, sbInfo.physicalSize, roi);
+        decodeParameters.push_back(parameters);
+    }
+
+    ConcurrentSubBlockReader subBlockReader(
+        this->sbBlkRepository,
+        options.subBlockCache,
+        options.onlyUseSubBlockCacheForCompressedData,
+        std::move(subBlockIndices),
+        options.maxNumberOfDecodeThreads,
+        options.decodeTaskPriority,
+        std::move(decodeParameters));
+
+    for (size_t n = 0; n < subBlocksToDraw.size(); ++n)
+    {
+        const SbInfo& sbInfo = sbSetSortedByZoom.subBlocks.at(subBlocksToDraw[n]);
+        if (GetSite()->IsEnabled(LOGLEVEL_CHATTYINFORMATION))
+        {
+            stringstream ss;
+            ss << " Drawing subblock: idx=" << sbInfo.index << " Log.: " << sbInfo.logicalRect << " Phys.Size: " << sbInfo.physicalSize;
+            GetSite()->Log(LOGLEVEL_CHATTYINFORMATION, ss);
         }
+
+        this->ScaleBlt(bmDest, zoom, roi, sbInfo, subBlockReader.Get(n));
     }
 }
 
@@ -14,6 +14,9 @@
 class CSingleChannelScalingTileAccessor : public CSingleChannelAccessorBase, public libCZI::ISingleChannelScalingTileAccessor
 {
 private:
+    /// The largest downscale factor used when decoding with reduced resolution (c.f. IDecoder::DecodeWithReducedResolution).
+    static constexpr std::uint32_t kMaxDownscaleFactorForDecode = 16;
+
     struct SbInfo
     {
         libCZI::IntRect			logicalRect;
@@ -38,7 +41,11 @@ private:
     std::vector<int> CreateSortByZoom(const std::vector<SbInfo>& sbBlks, bool sortByM);
     std::vector<SbInfo> GetSubSet(const libCZI::IntRect& roi, const libCZI::IDimCoordinate* planeCoordinate, const std::vector<int>* allowedScenes);
     int GetIdxOf1stSubBlockWithZoomGreater(const std::vector<SbInfo>& sbBlks, const std::vector<int>& byZoom, float zoom);
-    void ScaleBlt(libCZI::IBitmapData* bmDest, float zoom, const libCZI::IntRect& roi, const SbInfo& sbInfo, const libCZI::ISingleChannelScalingTileAccessor::Options& options);
+
+    /// Gets the downscale factor with which the specified sub-block can be decoded for drawing it with the specified zoom, i.e. the largest
+    /// power of two (up to kMaxDownscaleFactorForDecode) so that the resolution of the downscaled bitmap is not less than the resolution required.
+    static std::uint32_t GetDownscaleFactorForDecode(const SbInfo& sbInfo, float zoom);
+    void ScaleBlt(libCZI::IBitmapData* bmDest, float zoom, const libCZI::IntRect& roi, const SbInfo& sbInfo, const SubBlockData& subblock_bitmap_data);
 
     void InternalGet(libCZI::IBitmapData* bmDest, const libCZI::IntRect& roi, const libCZI::IDimCoordinate* planeCoordinate, float zoom, const libCZI::ISingleChannelScalingTileAccessor::Options& options);
 
@@ -8,6 +8,7 @@
 #include "SingleChannelTileCompositor.h"
 #include "Site.h"
 #include "bitmapData.h"
+#include <algorithm>
 
 using namespace libCZI;
 using namespace std;
@@ -48,6 +49,8 @@ void CSingleChannelTileAccessor::ComposeTiles(libCZI::IBitmapData* pBm, int xPos
     composeOptions.Clear();
     composeOptions.drawTileBorder = options.drawTileBorder;
 
+    // this is the list of subblock-indices to be rendered, in the order of rendering (given as indices into the subBlocksSet-vector)
+    std::vector<int> subBlocksToRender;
     if (options.useVisibilityCheckOptimization)
     {
         // Try to reduce the number of subblocks to be rendered by doing a visibility check, and only rendering those which are visible.
@@ -56,62 +59,152 @@ void CSingleChannelTileAccessor::ComposeTiles(libCZI::IBitmapData* pBm, int xPos
         // to be rendered, and 'index=subBlocksSet.size()-1' is the last one to be rendered (on top of all the others).
         // We get a vector with the indices of the subblocks to be rendered, and then render them in the order as given in this vector 
         // (index here means - the number as passed to the lambda).
-        const auto indices_of_visible_tiles = this->CheckForVisibility(
+        subBlocksToRender = this->CheckForVisibility(
             { xPos, yPos, static_cast<int>(pBm->GetWidth()), static_cast<int>(pBm->GetHeight()) },
             static_cast<int>(subBlocksSet.size()),
             [&](int index)->int
             {
                 return subBlocksSet[index].index;
             });
+    }
+    else
+    {
+        subBlocksToRender.reserve(subBlocksSet.size());
+        for (size_t i = 0; i < subBlocksSet.size(); ++i)
+        {
+            subBlocksToRender.push_back(static_cast<int>(i));
+        }
+    }
 
-        Compositors::ComposeSingleChannelTiles(
-            [&](int index, std::shared_ptr<libCZI::IBitmapData>& spBm, int& xPosTile, int& yPosTile)->bool
+    // if requested, the subblocks are read and decoded concurrently - and we retrieve them in the order of rendering; for subblocks which
+    //  are only partially visible, only the visible region is decoded (if the decoder supports this) - except when the tile border is to be
+    //  drawn, which is drawn around the bitmap
+    const IntRect roi{ xPos, yPos, static_cast<int>(pBm->GetWidth()), static_cast<int>(pBm->GetHeight()) };
+    const std::vector<bool> decodeIntoDestination = CSingleChannelTileAccessor::DetermineSubBlocksToDecodeIntoDestination(pBm->GetPixelType(), roi, subBlocksSet, subBlocksToRender, options);
+    std::unique_ptr<ScopedBitmapLocker<IBitmapData*>> lockedDestination;
+    if (std::find(decodeIntoDestination.cbegin(), decodeIntoDestination.cend(), true) != decodeIntoDestination.cend())
+    {
+        lockedDestination.reset(new ScopedBitmapLocker<IBitmapData*>(pBm));
+    }
+
+    std::vector<int> subBlockIndices;
+    std::vector<DecodeParameters> decodeParameters;
+    subBlockIndices.reserve(subBlocksToRender.size());
+    for (size_t n = 0; n < subBlocksToRender.size(); ++n)
+    {
+        const IndexAndM& item = subBlocksSet[subBlocksToRender[n]];
+        subBlockIndices.push_back(item.index);
+        if (!options.drawTileBorder)
+        {
+            DecodeParameters parameters;
+            if (decodeIntoDestination[n])
             {
-                if (index < static_cast<int>(indices_of_visible_tiles.size()))
-                {
-                    const auto subblock_data = CSingleChannelAccessorBase::GetSubBlockDataForSubBlockIndex(
-                        this->sbBlkRepository,
-                        options.subBlockCache,
-                        subBlocksSet[indices_of_visible_tiles[index]].index,
-                        options.onlyUseSubBlockCacheForCompressedData);
-                    spBm = subblock_data.bitmap;
-                    xPosTile = subblock_data.subBlockInfo.logicalRect.x;
-                    yPosTile = subblock_data.subBlockInfo.logicalRect.y;
-                    return true;
-                }
+                // the visible part of the subblock is decoded right into its place in the destination bitmap (and it is then skipped
+                //  when composing) - the region is given in pixels of the subblock, which here are the same as those of the destination
+                const IntRect visibleRect = item.logicalRect.Intersect(roi);
+                parameters.roi = IntRect{ visibleRect.x - item.logicalRect.x, visibleRect.y - item.logicalRect.y, visibleRect.w, visibleRect.h };
+                parameters.ptrDestination = static_cast<uint8_t*>(lockedDestination->ptrDataRoi) +
+                    static_cast<size_t>(visibleRect.y - yPos) * lockedDestination->stride +
+                    static_cast<size_t>(visibleRect.x - xPos) * CziUtils::GetBytesPerPel(item.pixelType);
+                parameters.strideDestination = lockedDestination->stride;
+            }
+            else
+            {
+                parameters.roi = CSingleChannelAccessorBase::GetRegionOfSubBlockToDecode(item.logicalRect, item.physicalSize, roi);
+            }
 
-                return false;
-            },
-            pBm,
-            xPos,
-            yPos,
-            &composeOptions);
+            decodeParameters.push_back(parameters);
+        }
     }
-    else
-    {
-        Compositors::ComposeSingleChannelTiles(
-            [&](int index, std::shared_ptr<libCZI::IBitmapData>& spBm, int& xPosTile, int& yPosTile)->bool
+
+    const int subBlockCount = static_cast<int>(subBlockIndices.size());
+    ConcurrentSubBlockReader subBlockReader(
+        this->sbBlkRepository,
+        options.subBlockCache,
+        options.onlyUseSubBlockCacheForCompressedData,
+        std::move(subBlockIndices),
+        options.maxNumberOfDecodeThreads,
+        options.decodeTaskPriority,
+        std::move(decodeParameters));
+
+    // the position in the list of subblocks is counted separately, since the subblocks which have been decoded into the destination are skipped
+    int position = 0;
+    Compositors::ComposeSingleChannelTiles(
+        [&](int index, std::shared_ptr<libCZI::IBitmapData>& spBm, int& xPosTile, int& yPosTile)->bool
+        {
+            while (position < subBlockCount)
             {
-                if (index < static_cast<int>(subBlocksSet.size()))
+                const auto subblock_data = subBlockReader.Get(position++);
+                if (subblock_data.decodedIntoDestination)
                 {
-                    const auto subblock_data = CSingleChannelAccessorBase::GetSubBlockDataForSubBlockIndex(
-                        this->sbBlkRepository,
-                        options.subBlockCache,
-                        subBlocksSet[index].index,
-                        options.onlyUseSubBlockCacheForCompressedData);
-                    spBm = subblock_data.bitmap;
-                    xPosTile = subblock_data.subBlockInfo.logicalRect.x;
-                    yPosTile = subblock_data.subBlockInfo.logicalRect.y;
-                    return true;
+                    continue;
                 }
 
-                return false;
-            },
-            pBm,
-            xPos,
-            yPos,
-            &composeOptions);
+                spBm = subblock_data.bitmap;
+                const IntRect decodedRegion = subblock_data.GetDecodedRegion();
+                xPosTile = subblock_data.subBlockInfo.logicalRect.x + decodedRegion.x;
+                yPosTile = subblock_data.subBlockInfo.logicalRect.y + decodedRegion.y;
+                return true;
+            }
+
+            return false;
+        },
+        pBm,
+        xPos,
+        yPos,
+        &composeOptions);
+}
+
+/*static*/std::vector<bool> CSingleChannelTileAccessor::DetermineSubBlocksToDecodeIntoDestination(libCZI::PixelType pixelType, const libCZI::IntRect& roi, const std::vector<IndexAndM>& subBlocksSet, const std::vector<int>& subBlocksToRender, const libCZI::ISingleChannelTileAccessor::Options& options)
+{
+    std::vector<bool> decodeIntoDestination(subBlocksToRender.size(), false);
+
+    // with a cache, the bitmap of the whole subblock is needed (in order to add it to the cache), and with a tile border the bitmap
+    //  is to be drawn onto
+    if (options.drawTileBorder || options.subBlockCache)
+    {
+        return decodeIntoDestination;
+    }
+
+    // a subblock can only be decoded into the destination if it has the same pixel type and if it is drawn with zoom 1 (i.e. its pixels
+    //  are the pixels of the destination)
+    std::vector<IntRect> visibleRects(subBlocksToRender.size());
+    for (size_t n = 0; n < subBlocksToRender.size(); ++n)
+    {
+        const IndexAndM& item = subBlocksSet[subBlocksToRender[n]];
+        visibleRects[n] = item.logicalRect.Intersect(roi);
+        if (item.pixelType == pixelType &&
+            static_cast<uint32_t>(item.logicalRect.w) == item.physicalSize.w && static_cast<uint32_t>(item.logicalRect.h) == item.physicalSize.h &&
+            visibleRects[n].IsNonEmpty())
+        {
+            decodeIntoDestination[n] = true;
+        }
+    }
+
+    // Subblocks are decoded concurrently (and in arbitrary order), so a subblock whose visible part overlaps with the one of another subblock
+    //  is composed as usual (which ensures that the one rendered last is on top). We sort the visible rectangles by their left edge, so that
+    //  we only have to check the rectangles starting before the right edge of a rectangle.
+    std::vector<size_t> byLeftEdge(subBlocksToRender.size());
+    for (size_t n = 0; n < byLeftEdge.size(); ++n)
+    {
+        byLeftEdge[n] = n;
     }
+
+    std::sort(byLeftEdge.begin(), byLeftEdge.end(), [&](size_t a, size_t b)->bool { return visibleRects[a].x < visibleRects[b].x; });
+    for (size_t i = 0; i < byLeftEdge.size(); ++i)
+    {
+        const IntRect& rect = visibleRects[byLeftEdge[i]];
+        for (size_t j = i + 1; j < byLeftEdge.size() && visibleRects[byLeftEdge[j]].x < rect.x + rect.w; ++j)
+        {
+            if (rect.IntersectsWith(visibleRects[byLeftEdge[j]]))
+            {
+                decodeIntoDestination[byLeftEdge[i]] = false;
+                decodeIntoDestination[byLeftEdge[j]] = false;
+            }
+        }
+    }
+
+    return decodeIntoDestination;
 }
 
 void CSingleChannelTileAccessor::InternalGet(int xPos, int yPos, libCZI::IBitmapData* pBm, const IDimCoordinate* planeCoordinate, const ISingleChannelTileAccessor::Options* pOptions)
@@ -137,7 +230,7 @@ std::vector<CSingleChannelTileAccessor::IndexAndM> CSingleChannelTileAccessor::G
     // ok... for a first tentative, experimental and quick-n-dirty implementation, simply
     // get all subblocks by enumerating all
     std::vector<IndexAndM> subBlocksSet;
-    this->GetAllSubBlocks(roi, planeCoordinate, [&](int index, int mIndex)->void {subBlocksSet.emplace_back(IndexAndM{ index,mIndex }); });
+    this->GetAllSubBlocks(roi, planeCoordinate, [&](int index, const SubBlockInfo& info)->void {subBlocksSet.emplace_back(IndexAndM{ index, info.mIndex, info.logicalRect, info.physicalSize, info.pixelType }); });
     if (sortByM == true)
     {
         // sort ascending-by-M-index (-> lowest M-index first, highest last)
@@ -153,16 +246,12 @@ std::vector<CSingleChannelTileAccessor::IndexAndM> CSingleChannelTileAccessor::G
     return subBlocksSet;
 }
 
-void CSingleChannelTileAccessor::GetAllSubBlocks(const IntRect& roi, const IDimCoordinate* planeCoordinate, const std::function<void(int index, int mIndex)>& appender) const
+void CSingleChannelTileAccessor::GetAllSubBlocks(const IntRect& roi, const IDimCoordinate* planeCoordinate, const std::function<void(int index, const libCZI::SubBlockInfo& info)>& appender) const
 {
-    this->sbBlkRepository->EnumSubset(planeCoordinate, nullptr, true,
+    this->sbBlkRepository->EnumSubset(planeCoordinate, &roi, true,
         [&](int idx, const SubBlockInfo& info)->bool
         {
-            if (Utilities::DoIntersect(roi, info.logicalRect))
-            {
-                appender(idx, info.mIndex);
-            }
-
+            appender(idx, info);
             return true;
         });
 }
@@ -21,14 +21,31 @@ public:	// interface ISingleChannelTileAccessor
     void Get(libCZI::IBitmapData* pDest, int xPos, int yPos, const libCZI::IDimCoordinate* planeCoordinate, const Options* pOptions) override;
 private:
     void InternalGet(int xPos, int yPos, libCZI::IBitmapData* pBm, const libCZI::IDimCoordinate* planeCoordinate, const libCZI::ISingleChannelTileAccessor::Options* pOptions);
-    void GetAllSubBlocks(const libCZI::IntRect& roi, const libCZI::IDimCoordinate* planeCoordinate, const std::function<void(int index, int mIndex)>& appender) const;
+    void GetAllSubBlocks(const libCZI::IntRect& roi, const libCZI::IDimCoordinate* planeCoordinate, const std::function<void(int index, const libCZI::SubBlockInfo& info)>& appender) const;
 
     struct IndexAndM
     {
         int index;
         int mIndex;
+        libCZI::IntRect logicalRect;
+        libCZI::IntSize physicalSize;
+        libCZI::PixelType pixelType;
     };
 
     std::vector<CSingleChannelTileAccessor::IndexAndM> GetSubBlocksSubset(const libCZI::IntRect& roi, const libCZI::IDimCoordinate* planeCoordinate, bool sortByM);
     void ComposeTiles(libCZI::IBitmapData* pBm, int xPos, int yPos, const std::vector<IndexAndM>& subBlocksSet, const libCZI::ISingleChannelTileAccessor::Options& options);
+
+    /// Determines which of the subblocks to be rendered can be decoded directly into the destination bitmap (instead of decoding them into
+    /// a bitmap and composing it) - which is the case if no bitmap is needed (i.e. no cache is used and no tile border is drawn), if the
+    /// subblock is drawn with zoom 1 and with the pixel type of the destination, and if its visible part does not overlap with any other
+    /// subblock's visible part (so that the order of rendering does not matter).
+    ///
+    /// \param  pixelType           The pixel type of the destination bitmap.
+    /// \param  roi                 The ROI (i.e. the region which the destination bitmap covers).
+    /// \param  subBlocksSet        The set of subblocks.
+    /// \param  subBlocksToRender   The subblocks to be rendered (given as indices into 'subBlocksSet'), in the order of rendering.
+    /// \param  options             The options.
+    ///
+    /// \returns    A vector with an element for each element of 'subBlocksToRender', which is true if the subblock is to be decoded into the destination.
+    static std::vector<bool> DetermineSubBlocksToDecodeIntoDestination(libCZI::PixelType pixelType, const libCZI::IntRect& roi, const std::vector<IndexAndM>& subBlocksSet, const std::vector<int>& subBlocksToRender, const libCZI::ISingleChannelTileAccessor::Options& options);
 };
@@ -6,3 +6,9 @@
 #include "libCZI_Site.h"
 
 libCZI::ISite* GetSite();
+
+/// Gets the task executor to be used for concurrent operations - this is the executor provided by the Site-object,
+/// or the default executor if the Site-object does not provide one.
+///
+/// \returns The task executor.
+std::shared_ptr<libCZI::ITaskExecutor> GetTaskExecutor();
@@ -0,0 +1,338 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "cachinginputstream.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace libCZI;
+
+void CachingInputStream::Options::SetFromPropertyBag(const std::map<int, libCZI::StreamsFactory::Property>& property_bag)
+{
+    auto property = property_bag.find(StreamsFactory::StreamProperties::kCaching_BlockSize);
+    if (property != property_bag.end())
+    {
+        const int block_size = property->second.GetAsInt32OrThrow();
+        if (block_size < 1)
+        {
+            throw invalid_argument("The block size of the cache must be at least one.");
+        }
+
+        this->block_size = static_cast<uint32_t>(block_size);
+    }
+
+    property = property_bag.find(StreamsFactory::StreamProperties::kCaching_MaxBlocks);
+    if (property != property_bag.end())
+    {
+        const int max_blocks = property->second.GetAsInt32OrThrow();
+        if (max_blocks < 1)
+        {
+            throw invalid_argument("The maximum number of blocks in the cache must be at least one.");
+        }
+
+        this->max_number_of_blocks = static_cast<uint32_t>(max_blocks);
+    }
+
+    property = property_bag.find(StreamsFactory::StreamProperties::kCaching_MaxReadAheadBlocks);
+    if (property != property_bag.end())
+    {
+        const int max_read_ahead_blocks = property->second.GetAsInt32OrThrow();
+        if (max_read_ahead_blocks < 0)
+        {
+            throw invalid_argument("The maximum number of blocks to read ahead must not be negative.");
+        }
+
+        this->max_read_ahead_blocks = static_cast<uint32_t>(max_read_ahead_blocks);
+    }
+}
+
+CachingInputStream::CachingInputStream(std::shared_ptr<libCZI::IStream> stream, const Options& options)
+    : stream_(std::move(stream)), options_(options)
+{
+    if (!this->stream_)
+    {
+        throw invalid_argument("The stream must not be null.");
+    }
+
+    if (this->options_.block_size < 1 || this->options_.max_number_of_blocks < 1)
+    {
+        throw invalid_argument("The block size and the maximum number of blocks must be at least one.");
+    }
+
+    // blocks read ahead are put into the cache, so there is no point in reading ahead more than the cache can hold
+    this->options_.max_read_ahead_blocks = min(this->options_.max_read_ahead_blocks, this->options_.max_number_of_blocks - 1);
+    this->stream_ex_ = dynamic_pointer_cast<IStreamEx>(this->stream_);
+}
+
+/*virtual*/void CachingInputStream::Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead)
+{
+    const uint64_t block_size = this->options_.block_size;
+    if (size >= block_size)
+    {
+        // large reads are passed on to the underlying stream, they would only displace the small blocks from the cache
+        {
+            lock_guard<mutex> lock(this->mutex_);
+            ++this->statistics_.bypassed_reads;
+        }
+
+        this->ReadUncached(offset, pv, size, ptrBytesRead);
+        return;
+    }
+
+    if (size == 0)
+    {
+        if (ptrBytesRead != nullptr)
+        {
+            *ptrBytesRead = 0;
+        }
+
+        return;
+    }
+
+    // since the size is less than the block size, the requested range is covered by at most two blocks
+    const uint64_t first_block = offset / block_size;
+    const uint64_t number_of_blocks = (offset + size - 1) / block_size - first_block + 1;
+    uint32_t block_data_size[2] = { 0, 0 };
+    uint32_t bytes_copied[2] = { 0, 0 };
+    bool block_missing[2] = { false, false };
+    uint64_t fetch_first_block = 0, fetch_block_count = 0;
+
+    {
+        lock_guard<mutex> lock(this->mutex_);
+
+        // a read is considered sequential if it starts at (or shortly after) the end of the previous one
+        const bool is_sequential = offset >= this->end_of_last_read_ && offset - this->end_of_last_read_ <= block_size;
+        this->end_of_last_read_ = offset + size;
+
+        for (uint64_t i = 0; i < number_of_blocks; ++i)
+        {
+            const auto iterator = this->block_map_.find(first_block + i);
+            if (iterator != this->block_map_.end())
+            {
+                this->lru_list_.splice(this->lru_list_.begin(), this->lru_list_, iterator->second);
+                const CachedBlock& block = *iterator->second;
+                block_data_size[i] = block.size;
+                bytes_copied[i] = this->CopyFromBlock(block.data.get(), block.size, block.block_index, offset, pv, size);
+                ++this->statistics_.block_hits;
+            }
+            else
+            {
+                block_missing[i] = true;
+                ++this->statistics_.block_misses;
+                if (fetch_block_count == 0)
+                {
+                    fetch_first_block = first_block + i;
+                }
+
+                fetch_block_count = first_block + i - fetch_first_block + 1;
+            }
+        }
+
+        if (fetch_block_count > 0)
+        {
+            if (is_sequential)
+            {
+                this->read_ahead_blocks_ = min(this->read_ahead_blocks_ == 0 ? 1 : 2 * this->read_ahead_blocks_, this->options_.max_read_ahead_blocks);
+            }
+            else
+            {
+                this->read_ahead_blocks_ = 0;
+            }
+
+            // extend the range to be fetched with the blocks to be read ahead - up to the first one which is already in the cache
+            const uint64_t end_of_request = first_block + number_of_blocks;
+            for (uint32_t i = 0; i < this->read_ahead_blocks_; ++i)
+            {
+                if (this->block_map_.find(end_of_request + i) != this->block_map_.end())
+                {
+                    break;
+                }
+
+                fetch_block_count = end_of_request + i - fetch_first_block + 1;
+            }
+        }
+    }
+
+    if (fetch_block_count > 0)
+    {
+        const uint64_t fetch_size = fetch_block_count * block_size;
+        unique_ptr<uint8_t[]> buffer(new uint8_t[fetch_size]);
+        uint64_t bytes_fetched = 0;
+        this->ReadUncached(fetch_first_block * block_size, buffer.get(), fetch_size, &bytes_fetched);
+
+        const auto get_fetched_block_size =
+            [&](uint64_t block_index) -> uint32_t
+            {
+                const uint64_t start_in_buffer = (block_index - fetch_first_block) * block_size;
+                return bytes_fetched > start_in_buffer ? static_cast<uint32_t>(min(bytes_fetched - start_in_buffer, block_size)) : 0;
+            };
+
+        for (uint64_t i = 0; i < number_of_blocks; ++i)
+        {
+            if (block_missing[i])
+            {
+                const uint64_t block_index = first_block + i;
+                block_data_size[i] = get_fetched_block_size(block_index);
+                bytes_copied[i] = this->CopyFromBlock(
+                    buffer.get() + (block_index - fetch_first_block) * block_size,
+                    block_data_size[i],
+                    block_index,
+                    offset,
+                    pv,
+                    size);
+            }
+        }
+
+        lock_guard<mutex> lock(this->mutex_);
+        for (uint64_t block_index = fetch_first_block; block_index < fetch_first_block + fetch_block_count; ++block_index)
+        {
+            const uint32_t fetched_block_size = get_fetched_block_size(block_index);
+            if (fetched_block_size == 0)
+            {
+                // we reached the end of the stream
+                break;
+            }
+
+            this->InsertBlock(block_index, buffer.get() + (block_index - fetch_first_block) * block_size, fetched_block_size);
+            if (block_index >= first_block + number_of_blocks)
+            {
+                ++this->statistics_.read_ahead_blocks;
+            }
+        }
+    }
+
+    if (ptrBytesRead != nullptr)
+    {
+        // the data ends with the first block which is not complete
+        uint64_t bytes_read = bytes_copied[0];
+        if (number_of_blocks > 1 && block_data_size[0] == block_size)
+        {
+            bytes_read += bytes_copied[1];
+        }
+
+        *ptrBytesRead = bytes_read;
+    }
+}
+
+/*virtual*/bool CachingInputStream::TryGetDirectAccess(std::uint64_t offset, std::uint64_t size, std::shared_ptr<const void>& data)
+{
+    // if the underlying stream can give direct access, then there is no point in going through the cache
+    return this->stream_ex_ && this->stream_ex_->TryGetDirectAccess(offset, size, data);
+}
+
+/*virtual*/void CachingInputStream::ReadMany(libCZI::StreamReadRange* ranges, size_t count)
+{
+    // small ranges are served from the cache, the large ones are passed on to the underlying stream in one batch
+    vector<StreamReadRange> large_ranges;
+    vector<size_t> large_range_indices;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (ranges[i].size < this->options_.block_size)
+        {
+            this->Read(ranges[i].offset, ranges[i].data, ranges[i].size, &ranges[i].bytes_read);
+        }
+        else
+        {
+            large_ranges.push_back(ranges[i]);
+            large_range_indices.push_back(i);
+        }
+    }
+
+    if (large_ranges.empty())
+    {
+        return;
+    }
+
+    if (!this->stream_ex_)
+    {
+        for (size_t i = 0; i < large_ranges.size(); ++i)
+        {
+            StreamReadRange& range = ranges[large_range_indices[i]];
+            this->Read(range.offset, range.data, range.size, &range.bytes_read);
+        }
+
+        return;
+    }
+
+    this->stream_ex_->ReadMany(large_ranges.data(), large_ranges.size());
+
+    uint64_t total_bytes_read = 0;
+    for (size_t i = 0; i < large_ranges.size(); ++i)
+    {
+        ranges[large_range_indices[i]].bytes_read = large_ranges[i].bytes_read;
+        total_bytes_read += large_ranges[i].bytes_read;
+    }
+
+    lock_guard<mutex> lock(this->mutex_);
+    this->statistics_.bypassed_reads += large_ranges.size();
+    this->statistics_.underlying_reads += large_ranges.size();
+    this->statistics_.bytes_read_from_underlying += total_bytes_read;
+}
+
+/*virtual*/libCZI::IStreamCacheStatistics::CacheStatistics CachingInputStream::GetCacheStatistics()
+{
+    lock_guard<mutex> lock(this->mutex_);
+    return this->statistics_;
+}
+
+void CachingInputStream::ReadUncached(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead)
+{
+    uint64_t bytes_read = 0;
+    this->stream_->Read(offset, pv, size, &bytes_read);
+
+    {
+        lock_guard<mutex> lock(this->mutex_);
+        ++this->statistics_.underlying_reads;
+        this->statistics_.bytes_read_from_underlying += bytes_read;
+    }
+
+    if (ptrBytesRead != nullptr)
+    {
+        *ptrBytesRead = bytes_read;
+    }
+}
+
+std::uint32_t CachingInputStream::CopyFromBlock(const std::uint8_t* block_data, std::uint32_t block_data_size, std::uint64_t block_index, std::uint64_t offset, void* pv, std::uint64_t size) const
+{
+    // copy the intersection of the requested range and the (valid part of the) block to the destination
+    const uint64_t block_start = block_index * this->options_.block_size;
+    const uint64_t copy_start = max(offset, block_start);
+    const uint64_t copy_end = min(offset + size, block_start + block_data_size);
+    if (copy_end <= copy_start)
+    {
+        return 0;
+    }
+
+    memcpy(static_cast<uint8_t*>(pv) + (copy_start - offset), block_data + (copy_start - block_start), static_cast<size_t>(copy_end - copy_start));
+    return static_cast<uint32_t>(copy_end - copy_start);
+}
+
+void CachingInputStream::InsertBlock(std::uint64_t block_index, const std::uint8_t* data, std::uint32_t size)
+{
+    // if the block was inserted by a concurrent read in the meantime, we just mark it as recently used
+    const auto iterator = this->block_map_.find(block_index);
+    if (iterator != this->block_map_.end())
+    {
+        this->lru_list_.splice(this->lru_list_.begin(), this->lru_list_, iterator->second);
+        return;
+    }
+
+    CachedBlock block;
+    block.block_index = block_index;
+    block.size = size;
+    block.data.reset(new uint8_t[size]);
+    memcpy(block.data.get(), data, size);
+    this->lru_list_.push_front(std::move(block));
+    this->block_map_[block_index] = this->lru_list_.begin();
+
+    while (this->lru_list_.size() > this->options_.max_number_of_blocks)
+    {
+        this->block_map_.erase(this->lru_list_.back().block_index);
+        this->lru_list_.pop_back();
+        ++this->statistics_.evicted_blocks;
+    }
+}
@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "../libCZI.h"
+#include "../libCZI_StreamsLib.h"
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/// A decorator for an IStream-object, which keeps recently read blocks of the underlying stream in an LRU-cache.
+/// The stream is divided into blocks of a fixed size, and small reads are served by reading (and caching) the
+/// blocks covering the requested range. If sequential access is detected, additional blocks are read ahead (with
+/// the number of blocks read ahead doubling on each miss up to a configurable maximum). Reads which are at least
+/// as large as a block bypass the cache. The content of the underlying stream is assumed to not change.
+/// This class is thread-safe - the underlying stream is accessed without holding the lock, so concurrent reads
+/// are possible.
+class CachingInputStream : public libCZI::IStreamEx, public libCZI::IStreamCacheStatistics
+{
+public:
+    /// The options for the caching decorator.
+    struct Options
+    {
+        std::uint32_t block_size{ 64 * 1024 };      ///< The size of a cache block in bytes.
+        std::uint32_t max_number_of_blocks{ 256 };  ///< The maximum number of blocks held in the cache.
+        std::uint32_t max_read_ahead_blocks{ 8 };   ///< The maximum number of blocks which are read ahead on sequential access.
+
+        /// Initializes the options from the specified property bag. Properties not present in the property bag
+        /// are left unchanged, and an invalid_argument-exception is thrown if a value is out of range.
+        ///
+        /// \param  property_bag    The property bag.
+        void SetFromPropertyBag(const std::map<int, libCZI::StreamsFactory::Property>& property_bag);
+    };
+private:
+    struct CachedBlock
+    {
+        std::uint64_t block_index;
+        std::uint32_t size;     ///< The number of valid bytes in the block, which is less than the block size at the end of the stream.
+        std::unique_ptr<std::uint8_t[]> data;
+    };
+
+    std::shared_ptr<libCZI::IStream> stream_;
+    std::shared_ptr<libCZI::IStreamEx> stream_ex_;  ///< The underlying stream if it implements IStreamEx, null otherwise.
+    Options options_;
+
+    std::mutex mutex_;                              ///< Mutex protecting all the following members.
+    std::list<CachedBlock> lru_list_;               ///< The cached blocks, the most recently used one is at the front.
+    std::unordered_map<std::uint64_t, std::list<CachedBlock>::iterator> block_map_;
+    std::uint64_t end_of_last_read_{ 0 };           ///< The end of the last (cached) read, used to detect sequential access.
+    std::uint32_t read_ahead_blocks_{ 0 };          ///< The number of blocks to read ahead with the next miss.
+    CacheStatistics statistics_;
+public:
+    CachingInputStream() = delete;
+    CachingInputStream(std::shared_ptr<libCZI::IStream> stream, const Options& options);
+    ~CachingInputStream() override = default;
+public: // interface libCZI::IStream
+    void Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead) override;
+public: // interface libCZI::IStreamEx
+    bool TryGetDirectAccess(std::uint64_t offset, std::uint64_t size, std::shared_ptr<const void>& data) override;
+    void ReadMany(libCZI::StreamReadRange* ranges, size_t count) override;
+public: // interface libCZI::IStreamCacheStatistics
+    CacheStatistics GetCacheStatistics() override;
+private:
+    void ReadUncached(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead);
+    std::uint32_t CopyFromBlock(const std::uint8_t* block_data, std::uint32_t block_data_size, std::uint64_t block_index, std::uint64_t offset, void* pv, std::uint64_t size) const;
+    void InsertBlock(std::uint64_t block_index, const std::uint8_t* data, std::uint32_t size);
+};
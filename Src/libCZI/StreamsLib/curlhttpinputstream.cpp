@@ -7,12 +7,16 @@
 #include <cstdint>
 #include <string>
 #include <sstream>
+#include <vector>
 #include "../libCZI_StreamsLib.h"
+#include "../Site.h"
 #include <curl/curl.h>
 
 using namespace std;
 using namespace libCZI;
 
+/*static*/constexpr int CurlHttpInputStream::kDefaultMaxNumberOfConnections;
+
 /*static*/void CurlHttpInputStream::OneTimeGlobalCurlInitialization()
 {
     curl_global_init(CURL_GLOBAL_ALL);
@@ -229,8 +233,37 @@ CurlHttpInputStream::CurlHttpInputStream(const std::string& url, const std::map<
         }
     }
 
+    property = property_bag.find(StreamsFactory::StreamProperties::kCurlHttp_MaxConnections);
+    if (property != property_bag.end())
+    {
+        const int max_connections = property->second.GetAsInt32OrThrow();
+        if (max_connections < 1)
+        {
+            throw std::invalid_argument("The maximum number of connections must be at least one.");
+        }
+
+        this->max_number_of_handles_ = max_connections;
+    }
+
+    // the handles of the pool share the connection cache (so that a connection can be reused by any handle), the DNS cache
+    //  and the SSL sessions
+    CURLSH* curl_share_handle = curl_share_init();
+    if (curl_share_handle == nullptr)
+    {
+        throw std::runtime_error("curl_share_init() failed");
+    }
+
+    unique_ptr<CURLSH, void(*)(CURLSH*)> up_curl_share_handle(curl_share_handle, [](CURLSH* h)->void {curl_share_cleanup(h); });
+    ThrowIfCurlShareError(curl_share_setopt(curl_share_handle, CURLSHOPT_LOCKFUNC, CurlHttpInputStream::LockSharedData), "CURLSHOPT_LOCKFUNC");
+    ThrowIfCurlShareError(curl_share_setopt(curl_share_handle, CURLSHOPT_UNLOCKFUNC, CurlHttpInputStream::UnlockSharedData), "CURLSHOPT_UNLOCKFUNC");
+    ThrowIfCurlShareError(curl_share_setopt(curl_share_handle, CURLSHOPT_USERDATA, this), "CURLSHOPT_USERDATA");
+    ThrowIfCurlShareError(curl_share_setopt(curl_share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT), "CURLSHOPT_SHARE(CURL_LOCK_DATA_CONNECT)");
+    ThrowIfCurlShareError(curl_share_setopt(curl_share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS), "CURLSHOPT_SHARE(CURL_LOCK_DATA_DNS)");
+    ThrowIfCurlShareError(curl_share_setopt(curl_share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION), "CURLSHOPT_SHARE(CURL_LOCK_DATA_SSL_SESSION)");
+
     this->curl_handle_ = up_curl_handle.release();
     this->curl_url_handle_ = up_curl_url_handle.release();
+    this->curl_share_handle_ = up_curl_share_handle.release();
 }
 
 /*virtual*/void CurlHttpInputStream::Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead)
@@ -249,43 +282,352 @@ CurlHttpInputStream::CurlHttpInputStream(const std::string& url, const std::map<
     stringstream ss;
     ss << offset << "-" << offset + size - 1;
 
+    // the handle is returned to the pool when leaving this scope (also in case of an exception)
+    struct HandleGuard
+    {
+        CurlHttpInputStream* stream;
+        CURL* handle;
+        ~HandleGuard() { this->stream->ReleaseHandle(this->handle); }
+    } handle_guard{ this, this->AcquireHandle() };
+
+    // TODO(JBL): We may be able to use a "header-function" (https://curl.se/libcurl/c/CURLOPT_HEADERFUNCTION.html) in order to find out
+    //             whether the server accepted our "Range-Request". According to https://developer.mozilla.org/en-US/docs/Web/HTTP/Range_requests,
+    //             we can expect to have a line "something like 'Accept-Ranges: bytes'" in the response header with a server that supports range
+    //             requests (and a line 'Accept-Ranges: none') would tell us explicitly that range requests are *not* supported.
+
+    // https://curl.se/libcurl/c/CURLOPT_RANGE.html states that the range may be ignored by the server, and it would then
+    //  deliver the entire document. And, it says, that there is no way to detect that the range was ignored. We take precautions
+    //  that we only accept as many bytes as we have requested, and otherwise the "curl_easy_perform" should report an error.
+    CURLcode return_code = curl_easy_setopt(handle_guard.handle, CURLOPT_RANGE, ss.str().c_str());
+    ThrowIfCurlSetOptError(return_code, "CURLOPT_RANGE");
+
+    WriteDataContext write_data_context;
+    write_data_context.data = pv;
+    write_data_context.size = size;
+    return_code = curl_easy_setopt(handle_guard.handle, CURLOPT_WRITEDATA, &write_data_context);
+    ThrowIfCurlSetOptError(return_code, "CURLOPT_WRITEDATA");
+
+    this->OnRequestStarted();
+    return_code = curl_easy_perform(handle_guard.handle);
+    this->OnRequestFinished(handle_guard.handle, offset, size, write_data_context.count_data_received, return_code);
+    if (return_code != CURLE_OK)
     {
-        std::lock_guard<std::mutex> lck(this->request_mutex_);
+        ss = stringstream{};
+        ss << "curl_easy_perform() failed with error code " << return_code << " (" << curl_easy_strerror(return_code) << ")";
+        throw runtime_error(ss.str());
+    }
 
-        // TODO(JBL): We may be able to use a "header-function" (https://curl.se/libcurl/c/CURLOPT_HEADERFUNCTION.html) in order to find out
-        //             whether the server accepted our "Range-Request". According to https://developer.mozilla.org/en-US/docs/Web/HTTP/Range_requests,
-        //             we can expect to have a line "something like 'Accept-Ranges: bytes'" in the response header with a server that supports range
-        //             requests (and a line 'Accept-Ranges: none') would tell us explicitly that range requests are *not* supported.
+    if (ptrBytesRead != nullptr)
+    {
+        *ptrBytesRead = write_data_context.count_data_received;
+    }
+}
 
-        // https://curl.se/libcurl/c/CURLOPT_RANGE.html states that the range may be ignored by the server, and it would then
-        //  deliver the entire document. And, it says, that there is no way to detect that the range was ignored. We take precautions
-        //  that we only accept as many bytes as we have requested, and otherwise the "curl_easy_perform" should report an error.
-        CURLcode return_code = curl_easy_setopt(curl_handle_, CURLOPT_RANGE, ss.str().c_str());
-        ThrowIfCurlSetOptError(return_code, "CURLOPT_RANGE");
+/*virtual*/bool CurlHttpInputStream::TryGetDirectAccess(std::uint64_t offset, std::uint64_t size, std::shared_ptr<const void>& data)
+{
+    // direct access is not possible with this implementation
+    return false;
+}
 
+/*virtual*/void CurlHttpInputStream::ReadMany(libCZI::StreamReadRange* ranges, size_t count)
+{
+    if (count <= 1)
+    {
+        IStreamEx::ReadMany(ranges, count);
+        return;
+    }
+
+    // Note: HTTP allows for requesting multiple ranges with a single request (resulting in a "multipart/byteranges"-response),
+    //  but support for this is not universal (e.g. cloud object stores typically do not support it). So, we rather issue
+    //  the range requests in parallel (on handles from our pool) using the curl-multi-interface.
+    std::vector<size_t> ranges_to_read;
+    for (size_t i = 0; i < count; ++i)
+    {
+        ranges[i].bytes_read = 0;
+        if (ranges[i].size > 0)
+        {
+            ranges_to_read.push_back(i);
+        }
+    }
+
+    if (ranges_to_read.empty())
+    {
+        return;
+    }
+
+    CURLM* curl_multi_handle = curl_multi_init();
+    if (curl_multi_handle == nullptr)
+    {
+        throw std::runtime_error("curl_multi_init() failed");
+    }
+
+    // We take as many handles from the pool as are available (but at least one, for which we may have to wait) - we must not
+    //  wait for more than one handle, since this could deadlock with other threads doing the same. If there are more ranges
+    //  than handles, then a handle is reused for the next range once its transfer is finished.
+    struct Transfer
+    {
+        CURL* handle;
+        size_t range_index;
         WriteDataContext write_data_context;
-        write_data_context.data = pv;
-        write_data_context.size = size;
-        return_code = curl_easy_setopt(curl_handle_, CURLOPT_WRITEDATA, &write_data_context);
+        bool active;
+    };
+
+    // this object takes care of removing the easy-handles from the multi-handle, of returning them to the pool
+    //  and of cleaning up the multi-handle
+    struct MultiHandleGuard
+    {
+        CurlHttpInputStream* stream;
+        CURLM* multi_handle;
+        std::vector<Transfer> transfers;
+
+        ~MultiHandleGuard()
+        {
+            for (const Transfer& transfer : this->transfers)
+            {
+                if (transfer.active)
+                {
+                    curl_multi_remove_handle(this->multi_handle, transfer.handle);
+                }
+
+                this->stream->ReleaseHandle(transfer.handle);
+            }
+
+            curl_multi_cleanup(this->multi_handle);
+        }
+    } guard{ this, curl_multi_handle, {} };
+
+    guard.transfers.reserve(ranges_to_read.size());
+    guard.transfers.push_back(Transfer{ this->AcquireHandle(), 0, {}, false });
+    while (guard.transfers.size() < ranges_to_read.size())
+    {
+        CURL* handle = this->TryAcquireHandle();
+        if (handle == nullptr)
+        {
+            break;
+        }
+
+        guard.transfers.push_back(Transfer{ handle, 0, {}, false });
+    }
+
+    size_t next_range_to_read = 0;
+    const auto start_transfer = [&](Transfer& transfer)->void
+    {
+        const size_t range_index = ranges_to_read[next_range_to_read++];
+        transfer.range_index = range_index;
+        transfer.write_data_context = WriteDataContext();
+        transfer.write_data_context.data = ranges[range_index].data;
+        transfer.write_data_context.size = ranges[range_index].size;
+
+        stringstream ss;
+        ss << ranges[range_index].offset << "-" << ranges[range_index].offset + ranges[range_index].size - 1;
+        CURLcode return_code = curl_easy_setopt(transfer.handle, CURLOPT_RANGE, ss.str().c_str());
+        ThrowIfCurlSetOptError(return_code, "CURLOPT_RANGE");
+        return_code = curl_easy_setopt(transfer.handle, CURLOPT_WRITEDATA, &transfer.write_data_context);
         ThrowIfCurlSetOptError(return_code, "CURLOPT_WRITEDATA");
+        return_code = curl_easy_setopt(transfer.handle, CURLOPT_PRIVATE, &transfer);
+        ThrowIfCurlSetOptError(return_code, "CURLOPT_PRIVATE");
 
-        return_code = curl_easy_perform(this->curl_handle_);
-        if (return_code != CURLE_OK)
+        ThrowIfCurlMultiError(curl_multi_add_handle(curl_multi_handle, transfer.handle), "curl_multi_add_handle");
+        transfer.active = true;
+        this->OnRequestStarted();
+    };
+
+    for (Transfer& transfer : guard.transfers)
+    {
+        start_transfer(transfer);
+    }
+
+    for (;;)
+    {
+        int still_running = 0;
+        ThrowIfCurlMultiError(curl_multi_perform(curl_multi_handle, &still_running), "curl_multi_perform");
+        bool transfer_started = false;
+
+        // check for finished transfers, and start the next range on the handle which became free
+        for (;;)
         {
-            ss = stringstream{};
-            ss << "curl_easy_perform() failed with error code " << return_code << " (" << curl_easy_strerror(return_code) << ")";
-            throw runtime_error(ss.str());
+            int messages_in_queue;
+            const CURLMsg* message = curl_multi_info_read(curl_multi_handle, &messages_in_queue);
+            if (message == nullptr)
+            {
+                break;
+            }
+
+            if (message->msg != CURLMSG_DONE)
+            {
+                continue;
+            }
+
+            Transfer* transfer = nullptr;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, reinterpret_cast<char**>(&transfer));
+            const CURLcode result = message->data.result;
+            curl_multi_remove_handle(curl_multi_handle, transfer->handle);
+            transfer->active = false;
+            const StreamReadRange& range = ranges[transfer->range_index];
+            this->OnRequestFinished(transfer->handle, range.offset, range.size, transfer->write_data_context.count_data_received, result);
+            if (result != CURLE_OK)
+            {
+                stringstream ss;
+                ss << "curl_multi_perform() failed for a transfer with error code " << result << " (" << curl_easy_strerror(result) << ")";
+                throw runtime_error(ss.str());
+            }
+
+            ranges[transfer->range_index].bytes_read = transfer->write_data_context.count_data_received;
+            if (next_range_to_read < ranges_to_read.size())
+            {
+                start_transfer(*transfer);
+                transfer_started = true;
+            }
         }
 
-        if (ptrBytesRead != nullptr)
+        if (still_running == 0 && !transfer_started)
+        {
+            break;
+        }
+
+        // if a transfer was started, it needs to be driven by curl_multi_perform before there is something to wait for
+        if (!transfer_started)
         {
-            *ptrBytesRead = write_data_context.count_data_received;
+            ThrowIfCurlMultiError(curl_multi_poll(curl_multi_handle, nullptr, 0, 1000, nullptr), "curl_multi_poll");
         }
     }
 }
 
+/*virtual*/libCZI::IStreamStatistics::RequestStatistics CurlHttpInputStream::GetRequestStatistics()
+{
+    std::lock_guard<std::mutex> lck(this->statistics_mutex_);
+    return this->statistics_;
+}
+
+CURL* CurlHttpInputStream::AcquireHandle()
+{
+    std::unique_lock<std::mutex> lck(this->pool_mutex_);
+    this->pool_condition_.wait(lck, [this]()->bool { return !this->idle_handles_.empty() || this->number_of_handles_ < this->max_number_of_handles_; });
+    if (!this->idle_handles_.empty())
+    {
+        CURL* handle = this->idle_handles_.back();
+        this->idle_handles_.pop_back();
+        return handle;
+    }
+
+    return this->CreateHandleForPool();
+}
+
+CURL* CurlHttpInputStream::TryAcquireHandle()
+{
+    std::lock_guard<std::mutex> lck(this->pool_mutex_);
+    if (!this->idle_handles_.empty())
+    {
+        CURL* handle = this->idle_handles_.back();
+        this->idle_handles_.pop_back();
+        return handle;
+    }
+
+    if (this->number_of_handles_ < this->max_number_of_handles_)
+    {
+        return this->CreateHandleForPool();
+    }
+
+    return nullptr;
+}
+
+void CurlHttpInputStream::ReleaseHandle(CURL* handle)
+{
+    {
+        std::lock_guard<std::mutex> lck(this->pool_mutex_);
+        this->idle_handles_.push_back(handle);
+    }
+
+    this->pool_condition_.notify_one();
+}
+
+CURL* CurlHttpInputStream::CreateHandleForPool()
+{
+    // the cloned handle gets all the options (but not the connection) of the configured handle
+    CURL* handle = curl_easy_duphandle(this->curl_handle_);
+    if (handle == nullptr)
+    {
+        throw std::runtime_error("curl_easy_duphandle() failed");
+    }
+
+    // the shared connection cache must be able to hold a connection for each handle (otherwise connections would be closed
+    //  instead of being kept alive for reuse)
+    CURLcode return_code = curl_easy_setopt(handle, CURLOPT_SHARE, this->curl_share_handle_);
+    if (return_code == CURLE_OK)
+    {
+        return_code = curl_easy_setopt(handle, CURLOPT_MAXCONNECTS, static_cast<long>(this->max_number_of_handles_));
+    }
+
+    if (return_code != CURLE_OK)
+    {
+        curl_easy_cleanup(handle);
+        ThrowIfCurlSetOptError(return_code, "CURLOPT_SHARE/CURLOPT_MAXCONNECTS");
+    }
+
+    ++this->number_of_handles_;
+    return handle;
+}
+
+/*static*/void CurlHttpInputStream::LockSharedData(CURL* handle, curl_lock_data data, curl_lock_access access, void* user_data)
+{
+    static_cast<CurlHttpInputStream*>(user_data)->share_mutexes_[data].lock();
+}
+
+/*static*/void CurlHttpInputStream::UnlockSharedData(CURL* handle, curl_lock_data data, void* user_data)
+{
+    static_cast<CurlHttpInputStream*>(user_data)->share_mutexes_[data].unlock();
+}
+
+void CurlHttpInputStream::OnRequestStarted()
+{
+    std::lock_guard<std::mutex> lck(this->statistics_mutex_);
+    ++this->requests_in_flight_;
+    ++this->statistics_.requests;
+    this->statistics_.max_concurrent_requests = (std::max)(this->statistics_.max_concurrent_requests, this->requests_in_flight_);
+}
+
+void CurlHttpInputStream::OnRequestFinished(CURL* handle, std::uint64_t offset, std::uint64_t size, std::uint64_t bytes_received, CURLcode result)
+{
+    curl_off_t total_time_us = 0;
+    curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &total_time_us);
+    long number_of_new_connections = 0;
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &number_of_new_connections);
+
+    {
+        std::lock_guard<std::mutex> lck(this->statistics_mutex_);
+        --this->requests_in_flight_;
+        if (result != CURLE_OK)
+        {
+            ++this->statistics_.failed_requests;
+        }
+
+        this->statistics_.bytes_received += bytes_received;
+        this->statistics_.total_request_time_us += static_cast<std::uint64_t>(total_time_us);
+        this->statistics_.max_request_time_us = (std::max)(this->statistics_.max_request_time_us, static_cast<std::uint64_t>(total_time_us));
+        this->statistics_.connections_established += static_cast<std::uint64_t>(number_of_new_connections);
+    }
+
+    if (GetSite()->IsEnabled(LOGLEVEL_CHATTYINFORMATION))
+    {
+        stringstream ss;
+        ss << "CurlHttpInputStream: range " << offset << "-" << offset + size - 1 << " -> " << bytes_received << " bytes in " << total_time_us << " us"
+            << (number_of_new_connections > 0 ? " (new connection)" : "") << ", result=" << result;
+        GetSite()->Log(LOGLEVEL_CHATTYINFORMATION, ss);
+    }
+}
+
 CurlHttpInputStream::~CurlHttpInputStream()
 {
+    for (CURL* handle : this->idle_handles_)
+    {
+        curl_easy_cleanup(handle);
+    }
+
+    if (this->curl_share_handle_ != nullptr)
+    {
+        curl_share_cleanup(this->curl_share_handle_);
+    }
+
     if (this->curl_handle_ != nullptr)
     {
         curl_easy_cleanup(this->curl_handle_);
@@ -316,6 +658,26 @@ CurlHttpInputStream::~CurlHttpInputStream()
     return total_size;
 }
 
+/*static*/void CurlHttpInputStream::ThrowIfCurlShareError(CURLSHcode return_code, const char* curl_option_name)
+{
+    if (return_code != CURLSHE_OK)
+    {
+        stringstream ss;
+        ss << "curl_share_setopt(" << curl_option_name << ") failed with error code " << return_code << " (" << curl_share_strerror(return_code) << ")";
+        throw std::runtime_error(ss.str());
+    }
+}
+
+/*static*/void CurlHttpInputStream::ThrowIfCurlMultiError(CURLMcode return_code, const char* curl_function_name)
+{
+    if (return_code != CURLM_OK)
+    {
+        stringstream ss;
+        ss << curl_function_name << " failed with error code " << return_code << " (" << curl_multi_strerror(return_code) << ")";
+        throw std::runtime_error(ss.str());
+    }
+}
+
 void CurlHttpInputStream::ThrowIfCurlSetOptError(CURLcode return_code, const char* curl_option_name)
 {
     if (return_code != CURLE_OK)
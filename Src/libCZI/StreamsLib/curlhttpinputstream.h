@@ -7,25 +7,53 @@
 
 #if LIBCZI_CURL_BASED_STREAM_AVAILABLE
 
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <vector>
 #include <cstdint>
 #include <string>
 #include "../libCZI.h"
 #include <curl/curl.h>
 
-/// A simplistic implementation of a stream which uses the curl library to read from an http or https stream.
-/// It uses the libcurl-easy-interface and is operating in a blocking mode and serialized (i.e. only one request at a time).
-class CurlHttpInputStream : public libCZI::IStream
+/// An implementation of a stream which uses the curl library to read from an http or https stream.
+/// It uses the libcurl-easy-interface and is operating in a blocking mode. Requests are executed on a pool of curl-handles
+/// (clones of a handle holding the configuration), so concurrent reads are executed concurrently - up to the configured
+/// maximum number of connections, further requests wait for a handle to become available. Each handle keeps its connection
+/// alive, so that subsequent requests can reuse it.
+/// Batched reads (IStreamEx::ReadMany) are executed with the libcurl-multi-interface, where the range requests
+/// are issued in parallel (on handles taken from the pool).
+/// Statistics about the requests are available with the IStreamStatistics-interface.
+class CurlHttpInputStream : public libCZI::IStreamEx, public libCZI::IStreamStatistics
 {
 private:
-    CURL* curl_handle_{nullptr};        ///< The curl-handle.
+    /// The maximum number of connections (if not specified with the property 'kCurlHttp_MaxConnections').
+    static constexpr int kDefaultMaxNumberOfConnections = 8;
+
+    CURL* curl_handle_{nullptr};        ///< The curl-handle holding the configuration - it is not used for requests, but cloned for the pool.
     CURLU* curl_url_handle_{nullptr};   ///< The curl-url-handle.
-    std::mutex request_mutex_;          ///< Mutex to serialize the requests.
+    CURLSH* curl_share_handle_{nullptr};        ///< The share-handle, with which the handles of the pool share their connection cache, DNS cache and SSL sessions.
+    std::mutex share_mutexes_[CURL_LOCK_DATA_LAST];   ///< The mutexes used for locking the data shared with the share-handle.
+
+    std::mutex pool_mutex_;                     ///< Mutex protecting the pool of handles (and the curl-handle which is cloned).
+    std::condition_variable pool_condition_;    ///< Signalled when a handle is returned to the pool.
+    std::vector<CURL*> idle_handles_;           ///< The handles which are currently not in use.
+    int number_of_handles_{ 0 };                ///< The number of handles created (in use or idle).
+    int max_number_of_handles_{ kDefaultMaxNumberOfConnections };   ///< The maximum number of handles (i.e. of concurrent requests).
+
+    std::mutex statistics_mutex_;               ///< Mutex protecting the statistics.
+    RequestStatistics statistics_;              ///< The accumulated request statistics.
+    std::uint32_t requests_in_flight_{ 0 };     ///< The number of requests currently in flight.
 public:
     CurlHttpInputStream(const std::string& url, const std::map<int, libCZI::StreamsFactory::Property>& property_bag);
 
     void Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead) override;
 
+    bool TryGetDirectAccess(std::uint64_t offset, std::uint64_t size, std::shared_ptr<const void>& data) override;
+    void ReadMany(libCZI::StreamReadRange* ranges, size_t count) override;
+
+    RequestStatistics GetRequestStatistics() override;
+
     ~CurlHttpInputStream() override;
 
     static void OneTimeGlobalCurlInitialization();
@@ -57,7 +85,40 @@ private:
     ///             by returning CURL_WRITEFUNC_ERROR (added in 7.87.0), which makes CURLE_WRITE_ERROR get returned.
     static size_t WriteData(void* ptr, size_t size, size_t nmemb, void* user_data);
 
+    /// Gets a handle from the pool - if no handle is idle and the maximum number of handles is reached, then
+    /// this method waits until a handle is returned to the pool.
+    CURL* AcquireHandle();
+
+    /// Gets a handle from the pool if one is idle or if another one can be created, without waiting.
+    ///
+    /// \returns    The handle, or nullptr if no handle is available at this point.
+    CURL* TryAcquireHandle();
+
+    /// Returns a handle (acquired with AcquireHandle or TryAcquireHandle) to the pool.
+    void ReleaseHandle(CURL* handle);
+
+    /// Creates a new handle (by cloning the configured handle). The pool-mutex must be held when calling this method.
+    CURL* CreateHandleForPool();
+
+    /// Updates the statistics when a request is started.
+    void OnRequestStarted();
+
+    /// Updates the statistics when a request is finished (successfully or not), and logs information about the request.
+    ///
+    /// \param  handle          The curl-handle with which the request was executed.
+    /// \param  offset          The offset of the requested range.
+    /// \param  size            The size of the requested range.
+    /// \param  bytes_received  The number of bytes received.
+    /// \param  result          The result code of the request.
+    void OnRequestFinished(CURL* handle, std::uint64_t offset, std::uint64_t size, std::uint64_t bytes_received, CURLcode result);
+
+    /// The lock- and unlock-callbacks for the share-handle, c.f. https://curl.se/libcurl/c/CURLSHOPT_LOCKFUNC.html.
+    static void LockSharedData(CURL* handle, curl_lock_data data, curl_lock_access access, void* user_data);
+    static void UnlockSharedData(CURL* handle, curl_lock_data data, void* user_data);
+
     static void ThrowIfCurlSetOptError(CURLcode return_code, const char* curl_option_name);
+    static void ThrowIfCurlShareError(CURLSHcode return_code, const char* curl_option_name);
+    static void ThrowIfCurlMultiError(CURLMcode return_code, const char* curl_function_name);
 };
 
 #endif
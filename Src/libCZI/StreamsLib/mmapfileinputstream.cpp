@@ -0,0 +1,198 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "mmapfileinputstream.h"
+
+#if LIBCZI_MMAP_BASED_STREAM_AVAILABLE
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <iomanip>
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "../utilities.h"
+
+using namespace libCZI;
+
+#if defined(_WIN32)
+
+MmapFileInputStream::MmapFileInputStream(const std::string& filename)
+    : MmapFileInputStream(Utilities::convertUtf8ToWchar_t(filename.c_str()).c_str())
+{
+}
+
+MmapFileInputStream::MmapFileInputStream(const wchar_t* filename)
+{
+    const HANDLE file_handle = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        std::stringstream ss;
+        ss << "Error opening the file \"" << Utilities::convertWchar_tToUtf8(filename) << "\"";
+        throw std::runtime_error(ss.str());
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size))
+    {
+        const DWORD last_error = GetLastError();
+        CloseHandle(file_handle);
+        std::stringstream ss;
+        ss << "Error determining the size of the file (LastError=" << std::hex << std::setfill('0') << std::setw(8) << std::showbase << last_error << ")";
+        throw std::runtime_error(ss.str());
+    }
+
+    if (file_size.QuadPart == 0)
+    {
+        // a file of size zero cannot be mapped, we represent it with an empty mapping
+        CloseHandle(file_handle);
+        this->mapping_ = std::make_shared<Mapping>(nullptr, 0);
+        return;
+    }
+
+    if (static_cast<std::uint64_t>(file_size.QuadPart) > (std::numeric_limits<SIZE_T>::max)())
+    {
+        CloseHandle(file_handle);
+        throw std::runtime_error("The file is too large to be mapped into memory.");
+    }
+
+    const HANDLE mapping_handle = CreateFileMappingW(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    const DWORD last_error_create_mapping = GetLastError();
+    CloseHandle(file_handle);
+    if (mapping_handle == NULL)
+    {
+        std::stringstream ss;
+        ss << "Error creating the file mapping (LastError=" << std::hex << std::setfill('0') << std::setw(8) << std::showbase << last_error_create_mapping << ")";
+        throw std::runtime_error(ss.str());
+    }
+
+    // note: the view keeps a reference to the mapping object, so we can close the handle right away
+    const void* ptr = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    const DWORD last_error_map_view = GetLastError();
+    CloseHandle(mapping_handle);
+    if (ptr == nullptr)
+    {
+        std::stringstream ss;
+        ss << "Error mapping the file (LastError=" << std::hex << std::setfill('0') << std::setw(8) << std::showbase << last_error_map_view << ")";
+        throw std::runtime_error(ss.str());
+    }
+
+    this->mapping_ = std::make_shared<Mapping>(static_cast<const std::uint8_t*>(ptr), static_cast<std::uint64_t>(file_size.QuadPart));
+}
+
+MmapFileInputStream::Mapping::~Mapping()
+{
+    if (this->ptr_ != nullptr)
+    {
+        UnmapViewOfFile(this->ptr_);
+    }
+}
+
+#else
+
+MmapFileInputStream::MmapFileInputStream(const wchar_t* filename)
+    : MmapFileInputStream(Utilities::convertWchar_tToUtf8(filename))
+{
+}
+
+MmapFileInputStream::MmapFileInputStream(const std::string& filename)
+{
+    const int file_descriptor = open(filename.c_str(), O_RDONLY);
+    if (file_descriptor < 0)
+    {
+        auto err = errno;
+        std::stringstream ss;
+        ss << "Error opening the file \"" << filename << "\" -> errno=" << err << " (" << strerror(err) << ")";
+        throw std::runtime_error(ss.str());
+    }
+
+    struct stat file_status;
+    if (fstat(file_descriptor, &file_status) != 0)
+    {
+        auto err = errno;
+        close(file_descriptor);
+        std::stringstream ss;
+        ss << "Error determining the size of the file \"" << filename << "\" -> errno=" << err << " (" << strerror(err) << ")";
+        throw std::runtime_error(ss.str());
+    }
+
+    const std::uint64_t file_size = static_cast<std::uint64_t>(file_status.st_size);
+    if (file_size == 0)
+    {
+        // a file of size zero cannot be mapped, we represent it with an empty mapping
+        close(file_descriptor);
+        this->mapping_ = std::make_shared<Mapping>(nullptr, 0);
+        return;
+    }
+
+    if (file_size > (std::numeric_limits<size_t>::max)())
+    {
+        close(file_descriptor);
+        throw std::runtime_error("The file is too large to be mapped into memory.");
+    }
+
+    // note: the mapping remains valid after the file descriptor is closed
+    void* ptr = mmap(nullptr, static_cast<size_t>(file_size), PROT_READ, MAP_SHARED, file_descriptor, 0);
+    auto err = errno;
+    close(file_descriptor);
+    if (ptr == MAP_FAILED)
+    {
+        std::stringstream ss;
+        ss << "Error mapping the file \"" << filename << "\" -> errno=" << err << " (" << strerror(err) << ")";
+        throw std::runtime_error(ss.str());
+    }
+
+    this->mapping_ = std::make_shared<Mapping>(static_cast<const std::uint8_t*>(ptr), file_size);
+}
+
+MmapFileInputStream::Mapping::~Mapping()
+{
+    if (this->ptr_ != nullptr)
+    {
+        munmap(const_cast<std::uint8_t*>(this->ptr_), static_cast<size_t>(this->size_));
+    }
+}
+
+#endif
+
+/*virtual*/void MmapFileInputStream::Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead)
+{
+    const std::uint64_t file_size = this->mapping_->GetSize();
+    std::uint64_t bytes_to_copy = 0;
+    if (offset < file_size)
+    {
+        bytes_to_copy = (std::min)(size, file_size - offset);
+        memcpy(pv, this->mapping_->GetPointer() + offset, static_cast<size_t>(bytes_to_copy));
+    }
+
+    if (ptrBytesRead != nullptr)
+    {
+        *ptrBytesRead = bytes_to_copy;
+    }
+}
+
+/*virtual*/bool MmapFileInputStream::TryGetDirectAccess(std::uint64_t offset, std::uint64_t size, std::shared_ptr<const void>& data)
+{
+    const std::uint64_t file_size = this->mapping_->GetSize();
+    if (offset > file_size || size > file_size - offset || this->mapping_->GetPointer() == nullptr)
+    {
+        return false;
+    }
+
+    // we use the aliasing constructor here, so that the returned shared_ptr keeps the mapping alive
+    data = std::shared_ptr<const void>(this->mapping_, this->mapping_->GetPointer() + offset);
+    return true;
+}
+
+#endif // LIBCZI_MMAP_BASED_STREAM_AVAILABLE
@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+#include <libCZI_Config.h>
+
+#if LIBCZI_MMAP_BASED_STREAM_AVAILABLE
+#include <memory>
+#include <string>
+#include "../libCZI.h"
+
+/// Implementation of the IStream-interface for files based on memory-mapping the file (using mmap
+/// or the Win32-API respectively). The complete file is mapped into the address space when the
+/// object is constructed. Reading is done by copying from the mapped memory, so concurrent access
+/// does not require locking. In addition, the IStreamEx-interface is implemented, which gives
+/// direct access to the mapped memory - the mapping is kept alive as long as there are references
+/// to it, even if the stream object itself is destroyed.
+/// Note that the file must not be truncated while it is mapped (which would result in an access
+/// violation or SIGBUS when accessing the mapped memory).
+class MmapFileInputStream : public libCZI::IStreamEx
+{
+private:
+    /// This class owns the mapping of the file. Its lifetime is controlled by shared_ptrs, which
+    /// are given out by TryGetDirectAccess.
+    class Mapping
+    {
+    private:
+        const std::uint8_t* ptr_;
+        std::uint64_t size_;
+    public:
+        Mapping(const std::uint8_t* ptr, std::uint64_t size) : ptr_(ptr), size_(size) {}
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+        ~Mapping();
+
+        const std::uint8_t* GetPointer() const { return this->ptr_; }
+        std::uint64_t GetSize() const { return this->size_; }
+    };
+
+    std::shared_ptr<Mapping> mapping_;
+public:
+    MmapFileInputStream() = delete;
+    explicit MmapFileInputStream(const wchar_t* filename);
+    explicit MmapFileInputStream(const std::string& filename);
+    ~MmapFileInputStream() override = default;
+public: // interface libCZI::IStream
+    void Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead) override;
+public: // interface libCZI::IStreamEx
+    bool TryGetDirectAccess(std::uint64_t offset, std::uint64_t size, std::shared_ptr<const void>& data) override;
+};
+
+#endif
@@ -9,11 +9,20 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>   // required on BSD
+#if LIBCZI_HAVE_PREADV
+#include <sys/uio.h>
+#include <climits>
+#endif
+
+#include <algorithm>
+#include <vector>
 
 #include "../utilities.h"
 
 using namespace libCZI;
 
+/*static*/constexpr std::uint64_t PreadFileInputStream::kMaxGapForCoalescing;
+
 PreadFileInputStream::PreadFileInputStream(const std::string& filename)
 {
     this->fileDescriptor = open(filename.c_str(), O_RDONLY);
@@ -44,10 +53,7 @@ PreadFileInputStream::~PreadFileInputStream()
     ssize_t bytesRead = pread(this->fileDescriptor, pv, size, offset);
     if (bytesRead < 0)
     {
-        auto err = errno;
-        std::stringstream ss;
-        ss << "Error reading from file (errno=" << err << " -> " << strerror(err) << ")";
-        throw std::runtime_error(ss.str());
+        PreadFileInputStream::ThrowReadError(errno);
     }
 
     if (ptrBytesRead != nullptr)
@@ -56,4 +62,148 @@ PreadFileInputStream::~PreadFileInputStream()
     }
 }
 
+/*virtual*/bool PreadFileInputStream::TryGetDirectAccess(std::uint64_t offset, std::uint64_t size, std::shared_ptr<const void>& data)
+{
+    // direct access is not possible with this implementation
+    return false;
+}
+
+/*virtual*/void PreadFileInputStream::ReadMany(libCZI::StreamReadRange* ranges, size_t count)
+{
+#if LIBCZI_HAVE_PREADV
+    // we sort the ranges by their offset, and then read "runs" of ranges which are adjacent (or only separated by
+    //  a small gap) with one preadv-call
+    std::vector<StreamReadRange*> sorted_ranges;
+    sorted_ranges.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (ranges[i].size > 0)
+        {
+            sorted_ranges.push_back(ranges + i);
+        }
+        else
+        {
+            ranges[i].bytes_read = 0;
+        }
+    }
+
+    std::sort(
+        sorted_ranges.begin(),
+        sorted_ranges.end(),
+        [](const StreamReadRange* a, const StreamReadRange* b)->bool { return a->offset < b->offset; });
+
+    std::unique_ptr<std::uint8_t[]> gap_buffer;
+    for (size_t start_of_run = 0; start_of_run < sorted_ranges.size();)
+    {
+        size_t end_of_run = start_of_run + 1;
+        std::uint64_t end_of_data = sorted_ranges[start_of_run]->offset + sorted_ranges[start_of_run]->size;
+        while (end_of_run < sorted_ranges.size() &&
+            sorted_ranges[end_of_run]->offset >= end_of_data &&
+            sorted_ranges[end_of_run]->offset - end_of_data <= PreadFileInputStream::kMaxGapForCoalescing)
+        {
+            end_of_data = sorted_ranges[end_of_run]->offset + sorted_ranges[end_of_run]->size;
+            ++end_of_run;
+        }
+
+        this->ReadCoalescedRanges(sorted_ranges.data() + start_of_run, end_of_run - start_of_run, gap_buffer);
+        start_of_run = end_of_run;
+    }
+#else
+    IStreamEx::ReadMany(ranges, count);
+#endif
+}
+
+void PreadFileInputStream::ReadCoalescedRanges(libCZI::StreamReadRange* const* ranges, size_t count, std::unique_ptr<std::uint8_t[]>& gapBuffer)
+{
+#if LIBCZI_HAVE_PREADV
+#if defined(IOV_MAX)
+    const size_t max_number_of_io_vectors = IOV_MAX;
+#else
+    const size_t max_number_of_io_vectors = 1024;
+#endif
+
+    // construct the list of io-vectors - the data in the gaps between the ranges is read into a scratch buffer
+    //  (which is shared by all gaps, since its content is discarded anyway)
+    std::vector<iovec> io_vectors;
+    io_vectors.reserve(2 * count);
+    const std::uint64_t start_offset = ranges[0]->offset;
+    std::uint64_t position = start_offset;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (ranges[i]->offset > position)
+        {
+            if (!gapBuffer)
+            {
+                gapBuffer.reset(new std::uint8_t[PreadFileInputStream::kMaxGapForCoalescing]);
+            }
+
+            io_vectors.push_back(iovec{ gapBuffer.get(), static_cast<size_t>(ranges[i]->offset - position) });
+        }
+
+        io_vectors.push_back(iovec{ ranges[i]->data, static_cast<size_t>(ranges[i]->size) });
+        position = ranges[i]->offset + ranges[i]->size;
+    }
+
+    // preadv may read less than requested (and the number of io-vectors per call is limited), so we loop until
+    //  all data is read or the end of the file is reached
+    std::uint64_t total_bytes_read = 0;
+    size_t current_io_vector = 0;
+    while (current_io_vector < io_vectors.size())
+    {
+        const ssize_t bytes_read = preadv(
+            this->fileDescriptor,
+            io_vectors.data() + current_io_vector,
+            static_cast<int>((std::min)(io_vectors.size() - current_io_vector, max_number_of_io_vectors)),
+            static_cast<off_t>(start_offset + total_bytes_read));
+        if (bytes_read < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            PreadFileInputStream::ThrowReadError(errno);
+        }
+
+        if (bytes_read == 0)
+        {
+            break;
+        }
+
+        total_bytes_read += bytes_read;
+
+        // advance the io-vectors by the number of bytes read
+        size_t remaining = static_cast<size_t>(bytes_read);
+        while (remaining > 0 && current_io_vector < io_vectors.size())
+        {
+            iovec& io_vector = io_vectors[current_io_vector];
+            if (remaining >= io_vector.iov_len)
+            {
+                remaining -= io_vector.iov_len;
+                ++current_io_vector;
+            }
+            else
+            {
+                io_vector.iov_base = static_cast<std::uint8_t*>(io_vector.iov_base) + remaining;
+                io_vector.iov_len -= remaining;
+                remaining = 0;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const std::uint64_t offset_in_run = ranges[i]->offset - start_offset;
+        ranges[i]->bytes_read = total_bytes_read > offset_in_run ? (std::min)(ranges[i]->size, total_bytes_read - offset_in_run) : 0;
+    }
+#endif
+}
+
+/*static*/void PreadFileInputStream::ThrowReadError(int err)
+{
+    std::stringstream ss;
+    ss << "Error reading from file (errno=" << err << " -> " << strerror(err) << ")";
+    throw std::runtime_error(ss.str());
+}
+
 #endif // LIBCZI_USE_PREADPWRITEBASED_STREAMIMPL
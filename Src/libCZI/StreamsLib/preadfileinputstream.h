@@ -10,10 +10,15 @@
 
 /// Implementation of the IStream-interface for files based on the Unix-specific pread-API.
 /// It leverages the pread function passing in an offset, thus allowing for concurrent
-/// access without locking.
-class PreadFileInputStream : public libCZI::IStream
+/// access without locking. The IStreamEx-interface is implemented in order to provide
+/// batched reads - adjacent (or nearby) ranges are coalesced and read with a single preadv-call.
+class PreadFileInputStream : public libCZI::IStreamEx
 {
 private:
+    /// If the gap between two ranges of a batched read is at most this many bytes, then the ranges are read with one
+    /// operation (and the data in the gap is discarded).
+    static constexpr std::uint64_t kMaxGapForCoalescing = 64 * 1024;
+
     int fileDescriptor;
 public:
     PreadFileInputStream() = delete;
@@ -22,6 +27,12 @@ public:
     ~PreadFileInputStream() override;
 public: // interface libCZI::IStream
     void Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead) override;
+public: // interface libCZI::IStreamEx
+    bool TryGetDirectAccess(std::uint64_t offset, std::uint64_t size, std::shared_ptr<const void>& data) override;
+    void ReadMany(libCZI::StreamReadRange* ranges, size_t count) override;
+private:
+    void ReadCoalescedRanges(libCZI::StreamReadRange* const* ranges, size_t count, std::unique_ptr<std::uint8_t[]>& gapBuffer);
+    [[noreturn]] static void ThrowReadError(int err);
 };
 
 #endif
@@ -11,6 +11,8 @@
 #include "windowsfileinputstream.h"
 #include "simplefileinputstream.h"
 #include "preadfileinputstream.h"
+#include "mmapfileinputstream.h"
+#include "cachinginputstream.h"
 #include "../utilities.h"
 
 using namespace libCZI;
@@ -66,6 +68,19 @@ static const struct
             nullptr
         },
 #endif // LIBCZI_USE_PREADPWRITEBASED_STREAMIMPL
+#if LIBCZI_MMAP_BASED_STREAM_AVAILABLE
+        {
+            { "mmap_file_inputstream", "stream implementation based on memory-mapped files", nullptr, nullptr },
+            [](const StreamsFactory::CreateStreamInfo& stream_info, const std::string& file_name) -> std::shared_ptr<libCZI::IStream>
+            {
+                return std::make_shared<MmapFileInputStream>(file_name);
+            },
+            [](const StreamsFactory::CreateStreamInfo& stream_info, const std::wstring& file_name) -> std::shared_ptr<libCZI::IStream>
+            {
+                return std::make_shared<MmapFileInputStream>(file_name.c_str());
+            }
+        },
+#endif // LIBCZI_MMAP_BASED_STREAM_AVAILABLE
         {
             { "c_runtime_file_inputstream", "stream implementation based on C-runtime library", nullptr, nullptr },
             [](const StreamsFactory::CreateStreamInfo& stream_info, const std::string& file_name) -> std::shared_ptr<libCZI::IStream>
@@ -110,7 +125,12 @@ void libCZI::StreamsFactory::Initialize()
         {"CurlHttp_MaxRedirs", StreamsFactory::StreamProperties::kCurlHttp_MaxRedirs, StreamsFactory::Property::Type::Int32},
         {"CurlHttp_CaInfo", StreamsFactory::StreamProperties::kCurlHttp_CaInfo, StreamsFactory::Property::Type::String},
         {"CurlHttp_CaInfoBlob", StreamsFactory::StreamProperties::kCurlHttp_CaInfoBlob, StreamsFactory::Property::Type::String},
+        {"CurlHttp_MaxConnections", StreamsFactory::StreamProperties::kCurlHttp_MaxConnections, StreamsFactory::Property::Type::Int32},
 #endif
+        {"Caching_Enabled", StreamsFactory::StreamProperties::kCaching_Enabled, StreamsFactory::Property::Type::Boolean},
+        {"Caching_BlockSize", StreamsFactory::StreamProperties::kCaching_BlockSize, StreamsFactory::Property::Type::Int32},
+        {"Caching_MaxBlocks", StreamsFactory::StreamProperties::kCaching_MaxBlocks, StreamsFactory::Property::Type::Int32},
+        {"Caching_MaxReadAheadBlocks", StreamsFactory::StreamProperties::kCaching_MaxReadAheadBlocks, StreamsFactory::Property::Type::Int32},
         {nullptr, 0, StreamsFactory::Property::Type::Invalid},
     };
 
@@ -139,6 +159,26 @@ int libCZI::StreamsFactory::GetStreamClassesCount()
     return sizeof(stream_classes) / sizeof(stream_classes[0]);
 }
 
+/// If requested in the property bag (with the property "kCaching_Enabled"), wrap the specified stream into a caching decorator.
+///
+/// \param  stream          The stream (which may be null).
+/// \param  property_bag    The property bag.
+///
+/// \returns    Either the stream itself or the caching decorator wrapping it.
+static std::shared_ptr<libCZI::IStream> WrapWithCachingStreamIfRequested(const std::shared_ptr<libCZI::IStream>& stream, const std::map<int, StreamsFactory::Property>& property_bag)
+{
+    if (stream)
+    {
+        const auto property = property_bag.find(StreamsFactory::StreamProperties::kCaching_Enabled);
+        if (property != property_bag.end() && property->second.GetAsBoolOrThrow())
+        {
+            return StreamsFactory::CreateCachingStream(stream, property_bag);
+        }
+    }
+
+    return stream;
+}
+
 std::shared_ptr<libCZI::IStream> libCZI::StreamsFactory::CreateStream(const CreateStreamInfo& stream_info, const std::string& file_identifier)
 {
     for (int i = 0; i < StreamsFactory::GetStreamClassesCount(); ++i)
@@ -147,11 +187,11 @@ std::shared_ptr<libCZI::IStream> libCZI::StreamsFactory::CreateStream(const Crea
         {
             if (stream_classes[i].pfn_create_stream_utf8)
             {
-                return stream_classes[i].pfn_create_stream_utf8(stream_info, file_identifier);
+                return WrapWithCachingStreamIfRequested(stream_classes[i].pfn_create_stream_utf8(stream_info, file_identifier), stream_info.property_bag);
             }
             else if (stream_classes[i].pfn_create_stream_wide)
             {
-                return stream_classes[i].pfn_create_stream_wide(stream_info, Utilities::convertUtf8ToWchar_t(file_identifier.c_str()));
+                return WrapWithCachingStreamIfRequested(stream_classes[i].pfn_create_stream_wide(stream_info, Utilities::convertUtf8ToWchar_t(file_identifier.c_str())), stream_info.property_bag);
             }
 
             break;
@@ -169,11 +209,11 @@ std::shared_ptr<libCZI::IStream> libCZI::StreamsFactory::CreateStream(const Crea
         {
             if (stream_classes[i].pfn_create_stream_wide)
             {
-                return stream_classes[i].pfn_create_stream_wide(stream_info, file_identifier);
+                return WrapWithCachingStreamIfRequested(stream_classes[i].pfn_create_stream_wide(stream_info, file_identifier), stream_info.property_bag);
             }
             else if (stream_classes[i].pfn_create_stream_utf8)
             {
-                return stream_classes[i].pfn_create_stream_utf8(stream_info, Utilities::convertWchar_tToUtf8(file_identifier.c_str()));
+                return WrapWithCachingStreamIfRequested(stream_classes[i].pfn_create_stream_utf8(stream_info, Utilities::convertWchar_tToUtf8(file_identifier.c_str())), stream_info.property_bag);
             }
 
             break;
@@ -183,6 +223,13 @@ std::shared_ptr<libCZI::IStream> libCZI::StreamsFactory::CreateStream(const Crea
     return {};
 }
 
+std::shared_ptr<libCZI::IStream> libCZI::StreamsFactory::CreateCachingStream(const std::shared_ptr<libCZI::IStream>& stream, const std::map<int, Property>& property_bag)
+{
+    CachingInputStream::Options options;
+    options.SetFromPropertyBag(property_bag);
+    return std::make_shared<CachingInputStream>(stream, options);
+}
+
 template<typename t_charactertype>
 std::shared_ptr<libCZI::IStream> CreateDefaultStreamForFileGeneric(const t_charactertype* filename)
 {
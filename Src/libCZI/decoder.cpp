@@ -8,6 +8,7 @@
 #include "stdAllocator.h"
 #include "BitmapOperations.h"
 #include "Site.h"
+#include <algorithm>
 
 using namespace libCZI;
 using namespace std;
@@ -39,11 +40,154 @@ static libCZI::PixelType PixelTypeFromJxrPixelFormat(JxrDecode::PixelFormat pixe
 
 std::shared_ptr<libCZI::IBitmapData> CJxrLibDecoder::Decode(const void* ptrData, size_t size, libCZI::PixelType pixelType, uint32_t width, uint32_t height)
 {
+    return this->DecodeWithReducedResolution(ptrData, size, pixelType, width, height, 1);
+}
+
+std::shared_ptr<libCZI::IBitmapData> CJxrLibDecoder::DecodeWithReducedResolution(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, std::uint32_t downscaleFactor)
+{
+    return CJxrLibDecoder::DecodeInternal(ptrData, size, pixelType, width, height, downscaleFactor, nullptr, nullptr);
+}
+
+std::shared_ptr<libCZI::IBitmapData> CJxrLibDecoder::DecodeRegion(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, std::uint32_t downscaleFactor, const libCZI::IntRect& roi, libCZI::IntRect& decodedRegion)
+{
+    return CJxrLibDecoder::DecodeInternal(ptrData, size, pixelType, width, height, downscaleFactor, &roi, &decodedRegion);
+}
+
+bool CJxrLibDecoder::TryDecodeRegionInto(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, const libCZI::IntRect& roi, void* ptrDestination, std::uint32_t stride)
+{
+    if (!roi.IsNonEmpty() || roi.x < 0 || roi.y < 0 ||
+        static_cast<uint32_t>(roi.x) + static_cast<uint32_t>(roi.w) > width ||
+        static_cast<uint32_t>(roi.y) + static_cast<uint32_t>(roi.h) > height)
+    {
+        throw invalid_argument("The region must be contained in the bitmap.");
+    }
+
+    // the codec addresses the lines in units of the channel's data type (i.e. it divides the stride by the size of the channel), so
+    //  with a stride which is not a multiple of it, it would write to the wrong place
+    const uint32_t bytes_per_channel = (pixelType == PixelType::Gray16 || pixelType == PixelType::Bgr48) ? 2 : (pixelType == PixelType::Gray32Float ? 4 : 1);
+    if (stride % bytes_per_channel != 0)
+    {
+        return false;
+    }
+
+    // if the region is the whole bitmap, then there is no need to have the decoder deal with a region
+    const bool is_whole_bitmap = static_cast<uint32_t>(roi.w) == width && static_cast<uint32_t>(roi.h) == height;
+    const JxrDecode::Region region{ static_cast<uint32_t>(roi.x), static_cast<uint32_t>(roi.y), static_cast<uint32_t>(roi.w), static_cast<uint32_t>(roi.h) };
+
+    try
+    {
+        if (!is_whole_bitmap)
+        {
+            CJxrLibDecoder::ThrowIfPixelTypeOrSizeOfCodestreamMismatch(ptrData, size, pixelType, width, height);
+        }
+
+        JxrDecode::Decode(
+            ptrData,
+            size,
+            [&](JxrDecode::PixelFormat actual_pixel_format, std::uint32_t actual_width, std::uint32_t actual_height)
+            -> tuple<void*, uint32_t>
+            {
+                CJxrLibDecoder::ThrowIfPixelTypeOrSizeMismatch(PixelTypeFromJxrPixelFormat(actual_pixel_format), actual_width, actual_height, pixelType, region.width, region.height);
+                return make_tuple(ptrDestination, stride);
+            },
+            1,
+            is_whole_bitmap ? nullptr : &region);
+    }
+    catch (const std::exception& e)
+    {
+        GetSite()->Log(LOGLEVEL_ERROR, e.what());
+        throw;
+    }
+
+    // c.f. DecodeInternal - the decoder gives us "Rgb48", and we have to swap the channels in the destination
+    if (pixelType == PixelType::Bgr48)
+    {
+        CBitmapOperations::RGB48ToBGR48(region.width, region.height, static_cast<uint16_t*>(ptrDestination), stride);
+    }
+
+    return true;
+}
+
+/*static*/void CJxrLibDecoder::ThrowIfPixelTypeOrSizeMismatch(libCZI::PixelType pixelTypeFromCompressedData, std::uint32_t actualWidth, std::uint32_t actualHeight, libCZI::PixelType expectedPixelType, std::uint32_t expectedWidth, std::uint32_t expectedHeight)
+{
+    if (pixelTypeFromCompressedData == PixelType::Invalid)
+    {
+        throw std::logic_error("unsupported pixel type");
+    }
+
+    if (pixelTypeFromCompressedData != expectedPixelType)
+    {
+        ostringstream ss;
+        ss << "pixel type mismatch: expected \"" << Utils::PixelTypeToInformalString(expectedPixelType) << "\", but got \"" << Utils::PixelTypeToInformalString(pixelTypeFromCompressedData) << "\"";
+        throw std::logic_error(ss.str());
+    }
+
+    if (actualWidth != expectedWidth || actualHeight != expectedHeight)
+    {
+        ostringstream ss;
+        ss << "size mismatch: expected " << expectedWidth << "x" << expectedHeight << ", but got " << actualWidth << "x" << actualHeight;
+        throw std::logic_error(ss.str());
+    }
+}
+
+/*static*/void CJxrLibDecoder::ThrowIfPixelTypeOrSizeOfCodestreamMismatch(const void* ptrData, size_t size, libCZI::PixelType expectedPixelType, std::uint32_t expectedWidth, std::uint32_t expectedHeight)
+{
+    // if only a region (or a version with reduced resolution) is decoded, then the size reported by the decoder is the size of
+    //  this region, which does not allow to check the size of the bitmap - so we check the size given in the header of the codestream
+    JxrDecode::PixelFormat pixel_format;
+    uint32_t width, height;
+    if (!JxrDecode::TryGetPixelFormatAndSize(ptrData, size, pixel_format, width, height))
+    {
+        throw std::logic_error("the header of the JXR-codestream is incomplete");
+    }
+
+    CJxrLibDecoder::ThrowIfPixelTypeOrSizeMismatch(PixelTypeFromJxrPixelFormat(pixel_format), width, height, expectedPixelType, expectedWidth, expectedHeight);
+}
+
+/*static*/std::shared_ptr<libCZI::IBitmapData> CJxrLibDecoder::DecodeInternal(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, std::uint32_t downscaleFactor, const libCZI::IntRect* roi, libCZI::IntRect* decodedRegion)
+{
+    // the decoder reduces the downscale factor for small bitmaps, and the size we expect has to be calculated accordingly
+    downscaleFactor = JxrDecode::AdjustDownscaleFactor(width, height, downscaleFactor);
+    uint32_t expected_width = (width + downscaleFactor - 1) / downscaleFactor;
+    uint32_t expected_height = (height + downscaleFactor - 1) / downscaleFactor;
+
+    JxrDecode::Region region;
+    if (roi != nullptr)
+    {
+        // the region is given in pixels of the full-resolution image - we determine the pixels of the bitmap with reduced resolution
+        //  which cover it, and report back the region (of the full-resolution image) they cover
+        const IntRect clipped_roi = roi->Intersect(IntRect{ 0, 0, static_cast<int>(width), static_cast<int>(height) });
+        if (!clipped_roi.IsNonEmpty())
+        {
+            throw invalid_argument("The region does not intersect with the bitmap.");
+        }
+
+        const uint32_t x_start = static_cast<uint32_t>(clipped_roi.x) / downscaleFactor;
+        const uint32_t y_start = static_cast<uint32_t>(clipped_roi.y) / downscaleFactor;
+        const uint32_t x_end = (static_cast<uint32_t>(clipped_roi.x + clipped_roi.w) + downscaleFactor - 1) / downscaleFactor;
+        const uint32_t y_end = (static_cast<uint32_t>(clipped_roi.y + clipped_roi.h) + downscaleFactor - 1) / downscaleFactor;
+        region = JxrDecode::Region{ x_start, y_start, x_end - x_start, y_end - y_start };
+        expected_width = region.width;
+        expected_height = region.height;
+        *decodedRegion = IntRect
+        {
+            static_cast<int>(x_start * downscaleFactor),
+            static_cast<int>(y_start * downscaleFactor),
+            static_cast<int>((min)(x_end * downscaleFactor, width) - x_start * downscaleFactor),
+            static_cast<int>((min)(y_end * downscaleFactor, height) - y_start * downscaleFactor)
+        };
+    }
+
     std::shared_ptr<IBitmapData> bitmap;
     bool bitmap_is_locked = false;
 
     try
     {
+        if (roi != nullptr || downscaleFactor > 1)
+        {
+            CJxrLibDecoder::ThrowIfPixelTypeOrSizeOfCodestreamMismatch(ptrData, size, pixelType, width, height);
+        }
+
         JxrDecode::Decode(
             ptrData,
             size,
@@ -51,30 +195,14 @@ std::shared_ptr<libCZI::IBitmapData> CJxrLibDecoder::Decode(const void* ptrData,
             -> tuple<void*, uint32_t>
             {
                 const auto pixel_type_from_compressed_data = PixelTypeFromJxrPixelFormat(actual_pixel_format);
-                if (pixel_type_from_compressed_data == PixelType::Invalid)
-                {
-                    throw std::logic_error("unsupported pixel type");
-                }
-
-                if (pixel_type_from_compressed_data != pixelType)
-                {
-                    ostringstream ss;
-                    ss << "pixel type mismatch: expected \"" << Utils::PixelTypeToInformalString(pixelType) << "\", but got \"" << Utils::PixelTypeToInformalString(pixel_type_from_compressed_data) << "\"";
-                    throw std::logic_error(ss.str());
-                }
-
-                if (actual_width != width || actual_height != height)
-                {
-                    ostringstream ss;
-                    ss << "size mismatch: expected " << width << "x" << height << ", but got " << actual_width << "x" << actual_height;
-                    throw std::logic_error(ss.str());
-                }
-
+                CJxrLibDecoder::ThrowIfPixelTypeOrSizeMismatch(pixel_type_from_compressed_data, actual_width, actual_height, pixelType, expected_width, expected_height);
                 bitmap = GetSite()->CreateBitmap(pixel_type_from_compressed_data, actual_width, actual_height);
                 const auto lock_info = bitmap->Lock();
                 bitmap_is_locked = true;
                 return make_tuple(lock_info.ptrDataRoi, lock_info.stride);
-            });
+            },
+            downscaleFactor,
+            roi != nullptr ? &region : nullptr);
     }
     catch (const std::exception& e)
     {
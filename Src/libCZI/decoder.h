@@ -15,4 +15,11 @@ public:
     static std::shared_ptr<CJxrLibDecoder> Create();
 
     std::shared_ptr<libCZI::IBitmapData> Decode(const void* ptrData, size_t size, libCZI::PixelType, std::uint32_t width, std::uint32_t height) override;
+    std::shared_ptr<libCZI::IBitmapData> DecodeWithReducedResolution(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, std::uint32_t downscaleFactor) override;
+    std::shared_ptr<libCZI::IBitmapData> DecodeRegion(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, std::uint32_t downscaleFactor, const libCZI::IntRect& roi, libCZI::IntRect& decodedRegion) override;
+    bool TryDecodeRegionInto(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, const libCZI::IntRect& roi, void* ptrDestination, std::uint32_t stride) override;
+private:
+    static void ThrowIfPixelTypeOrSizeMismatch(libCZI::PixelType pixelTypeFromCompressedData, std::uint32_t actualWidth, std::uint32_t actualHeight, libCZI::PixelType expectedPixelType, std::uint32_t expectedWidth, std::uint32_t expectedHeight);
+    static void ThrowIfPixelTypeOrSizeOfCodestreamMismatch(const void* ptrData, size_t size, libCZI::PixelType expectedPixelType, std::uint32_t expectedWidth, std::uint32_t expectedHeight);
+    static std::shared_ptr<libCZI::IBitmapData> DecodeInternal(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, std::uint32_t downscaleFactor, const libCZI::IntRect* roi, libCZI::IntRect* decodedRegion);
 };
@@ -26,10 +26,13 @@ struct ZStd1HeaderParsingResult
 };
 
 static ZStd1HeaderParsingResult ParseZStd1Header(const uint8_t* ptrData, size_t size);
+static ZStd1HeaderParsingResult ParseZStd1HeaderAndThrowIfInvalid(const void* ptrData, size_t size, libCZI::PixelType pixelType);
+static bool TryDecodeAndProcessIntoDestination(const void* ptrData, size_t size, libCZI::PixelType pixelType, uint32_t width, uint32_t height, const libCZI::IntRect& roi, void* ptrDestination, uint32_t stride, bool doHiLoByteUnpacking);
 static shared_ptr<libCZI::IBitmapData> DecodeAndProcess(const void* pData, size_t size, libCZI::PixelType pixelType, uint32_t width, uint32_t height, bool doHiLoByteUnpacking);
 static shared_ptr<libCZI::IBitmapData> DecodeAndProcessNoHiLoByteUnpacking(const void* ptrData, size_t size, libCZI::PixelType pixelType, uint32_t width, uint32_t height);
 static shared_ptr<libCZI::IBitmapData> DecodeAndProcessWithHiLoByteUnpacking(const void* ptrData, size_t size, libCZI::PixelType pixelType, uint32_t width, uint32_t height);
-static void ZstdDecompressAndThrowIfError(const void* ptrData, size_t size, void* ptrDst, size_t dstSize);
+static size_t ZstdDecompressAndThrowIfError(const void* ptrData, size_t size, void* ptrDst, size_t dstSize);
+static void ThrowIfFrameContentSizeIsNotAsExpected(const void* ptrData, size_t size, uint64_t expectedSize);
 
 /*static*/std::shared_ptr<CZstd0Decoder> CZstd0Decoder::Create()
 {
@@ -41,6 +44,11 @@ static void ZstdDecompressAndThrowIfError(const void* ptrData, size_t size, void
     return DecodeAndProcessNoHiLoByteUnpacking(ptrData, size, pixelType, width, height);
 }
 
+/*virtual*/bool CZstd0Decoder::TryDecodeRegionInto(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, const libCZI::IntRect& roi, void* ptrDestination, std::uint32_t stride)
+{
+    return TryDecodeAndProcessIntoDestination(ptrData, size, pixelType, width, height, roi, ptrDestination, stride, false);
+}
+
 /*static*/std::shared_ptr<CZstd1Decoder> CZstd1Decoder::Create()
 {
     return make_shared<CZstd1Decoder>();
@@ -48,7 +56,34 @@ static void ZstdDecompressAndThrowIfError(const void* ptrData, size_t size, void
 
 /*virtual*/std::shared_ptr<libCZI::IBitmapData> CZstd1Decoder::Decode(const void* ptrData, size_t size, libCZI::PixelType pixelType, uint32_t width, std::uint32_t height)
 {
-    const ZStd1HeaderParsingResult zStd1Header = ParseZStd1Header(static_cast<const uint8_t*>(ptrData), size);
+    const ZStd1HeaderParsingResult zStd1Header = ParseZStd1HeaderAndThrowIfInvalid(ptrData, size, pixelType);
+    return DecodeAndProcess(
+        static_cast<const char*>(ptrData) + zStd1Header.headerSize,
+        size - zStd1Header.headerSize,
+        pixelType,
+        width,
+        height,
+        zStd1Header.hiLoByteUnpackPreprocessing);
+}
+
+/*virtual*/bool CZstd1Decoder::TryDecodeRegionInto(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, const libCZI::IntRect& roi, void* ptrDestination, std::uint32_t stride)
+{
+    const ZStd1HeaderParsingResult zStd1Header = ParseZStd1HeaderAndThrowIfInvalid(ptrData, size, pixelType);
+    return TryDecodeAndProcessIntoDestination(
+        static_cast<const char*>(ptrData) + zStd1Header.headerSize,
+        size - zStd1Header.headerSize,
+        pixelType,
+        width,
+        height,
+        roi,
+        ptrDestination,
+        stride,
+        zStd1Header.hiLoByteUnpackPreprocessing);
+}
+
+ZStd1HeaderParsingResult ParseZStd1HeaderAndThrowIfInvalid(const void* ptrData, size_t size, libCZI::PixelType pixelType)
+{
+    ZStd1HeaderParsingResult zStd1Header = ParseZStd1Header(static_cast<const uint8_t*>(ptrData), size);
     if (zStd1Header.headerSize == 0)
     {
         if (GetSite()->IsEnabled(LOGLEVEL_ERROR))
@@ -72,13 +107,7 @@ static void ZstdDecompressAndThrowIfError(const void* ptrData, size_t size, void
         throw runtime_error(ss.str());
     }
 
-    return DecodeAndProcess(
-        static_cast<const char*>(ptrData) + zStd1Header.headerSize,
-        size - zStd1Header.headerSize,
-        pixelType,
-        width,
-        height,
-        zStd1Header.hiLoByteUnpackPreprocessing);
+    return zStd1Header;
 }
 
 ZStd1HeaderParsingResult ParseZStd1Header(const uint8_t* ptrData, size_t size)
@@ -127,20 +156,7 @@ ZStd1HeaderParsingResult ParseZStd1Header(const uint8_t* ptrData, size_t size)
 
 shared_ptr<libCZI::IBitmapData> DecodeAndProcess(const void* ptrData, size_t size, libCZI::PixelType pixelType, uint32_t width, uint32_t height, bool doHiLoByteUnpacking)
 {
-    const unsigned long long uncompressedSize = ZSTD_getFrameContentSize(ptrData, size);
-    if (uncompressedSize == ZSTD_CONTENTSIZE_UNKNOWN)
-    {
-        throw std::runtime_error("The decompressed size cannot be determined.");
-    }
-    else if (uncompressedSize == ZSTD_CONTENTSIZE_ERROR)
-    {
-        throw std::runtime_error("The compressed data is not recognized.");
-    }
-
-    if (uncompressedSize != static_cast<uint64_t>(height) * width * Utils::GetBytesPerPixel(pixelType))
-    {
-        throw std::runtime_error("The compressed data is not valid.");
-    }
+    ThrowIfFrameContentSizeIsNotAsExpected(ptrData, size, static_cast<uint64_t>(height) * width * Utils::GetBytesPerPixel(pixelType));
 
     return doHiLoByteUnpacking ?
         DecodeAndProcessWithHiLoByteUnpacking(ptrData, size, pixelType, width, height) :
@@ -168,7 +184,78 @@ shared_ptr<libCZI::IBitmapData> DecodeAndProcessNoHiLoByteUnpacking(const void*
     return bitmap;
 }
 
-void ZstdDecompressAndThrowIfError(const void* ptrData, size_t size, void* ptrDst, size_t dstSize)
+bool TryDecodeAndProcessIntoDestination(const void* ptrData, size_t size, libCZI::PixelType pixelType, uint32_t width, uint32_t height, const libCZI::IntRect& roi, void* ptrDestination, uint32_t stride, bool doHiLoByteUnpacking)
+{
+    // zstd can only decompress the data as a whole, so we can only decode into the destination if the whole bitmap is requested
+    if (roi.x != 0 || roi.y != 0 || static_cast<uint32_t>(roi.w) != width || static_cast<uint32_t>(roi.h) != height)
+    {
+        return false;
+    }
+
+    const auto bytesPerPel = Utils::GetBytesPerPixel(pixelType);
+    const size_t uncompressedSize = static_cast<size_t>(height) * width * bytesPerPel;
+
+    // check the size given in the frame header before anything is written to the destination - ZSTD_decompress
+    //  would otherwise happily write a (too small) frame into it before we notice the mismatch
+    ThrowIfFrameContentSizeIsNotAsExpected(ptrData, size, uncompressedSize);
+
+    if (doHiLoByteUnpacking)
+    {
+        // the hi-lo-byte-packing operates on 16-bit words, so the length of a line must be even
+        if ((width * bytesPerPel) % 2 != 0)
+        {
+            throw std::runtime_error("The compressed data is not valid.");
+        }
+
+        // the unpacking needs all the decompressed data, but it can write its result with an arbitrary stride
+        unique_ptr<void, void(*)(void*)> tmpBuffer(malloc(uncompressedSize), free);
+        if (!tmpBuffer)
+        {
+            throw std::bad_alloc();
+        }
+
+        if (ZstdDecompressAndThrowIfError(ptrData, size, tmpBuffer.get(), uncompressedSize) != uncompressedSize)
+        {
+            throw std::runtime_error("The compressed data is not valid.");
+        }
+
+        LoHiBytePackUnpack::LoHiBytePackStrided(tmpBuffer.get(), uncompressedSize, width * bytesPerPel / 2, height, stride, ptrDestination);
+        return true;
+    }
+
+    // without unpacking, the data is decompressed as it is - so the lines in the destination must be contiguous
+    if (stride != width * bytesPerPel)
+    {
+        return false;
+    }
+
+    if (ZstdDecompressAndThrowIfError(ptrData, size, ptrDestination, uncompressedSize) != uncompressedSize)
+    {
+        throw std::runtime_error("The compressed data is not valid.");
+    }
+
+    return true;
+}
+
+void ThrowIfFrameContentSizeIsNotAsExpected(const void* ptrData, size_t size, uint64_t expectedSize)
+{
+    const unsigned long long uncompressedSize = ZSTD_getFrameContentSize(ptrData, size);
+    if (uncompressedSize == ZSTD_CONTENTSIZE_UNKNOWN)
+    {
+        throw std::runtime_error("The decompressed size cannot be determined.");
+    }
+    else if (uncompressedSize == ZSTD_CONTENTSIZE_ERROR)
+    {
+        throw std::runtime_error("The compressed data is not recognized.");
+    }
+
+    if (uncompressedSize != expectedSize)
+    {
+        throw std::runtime_error("The compressed data is not valid.");
+    }
+}
+
+size_t ZstdDecompressAndThrowIfError(const void* ptrData, size_t size, void* ptrDst, size_t dstSize)
 {
     const size_t decompressedSize = ZSTD_decompress(ptrDst, dstSize, ptrData, size);
     if (ZSTD_isError(decompressedSize))
@@ -182,4 +269,6 @@ void ZstdDecompressAndThrowIfError(const void* ptrData, size_t size, void* ptrDs
             throw std::runtime_error(errorText);
         }
     }
+
+    return decompressedSize;
 }
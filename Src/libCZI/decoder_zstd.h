@@ -13,6 +13,7 @@ class CZstd0Decoder : public libCZI::IDecoder
 public:
     static std::shared_ptr<CZstd0Decoder> Create();
     std::shared_ptr<libCZI::IBitmapData> Decode(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height) override;
+    bool TryDecodeRegionInto(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, const libCZI::IntRect& roi, void* ptrDestination, std::uint32_t stride) override;
 };
 
 class CZstd1Decoder : public libCZI::IDecoder
@@ -20,4 +21,5 @@ class CZstd1Decoder : public libCZI::IDecoder
 public:
     static std::shared_ptr<CZstd1Decoder> Create();
     std::shared_ptr<libCZI::IBitmapData> Decode(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height) override;
+    bool TryDecodeRegionInto(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, const libCZI::IntRect& roi, void* ptrDestination, std::uint32_t stride) override;
 };
@@ -0,0 +1,109 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "frequency_sketch.h"
+#include <algorithm>
+
+using namespace std;
+
+/*static*/constexpr std::uint32_t FrequencySketch::kMinTableSize;
+/*static*/constexpr std::uint32_t FrequencySketch::kMaxCounterValue;
+/*static*/constexpr std::uint32_t FrequencySketch::kSampleSizeFactor;
+
+FrequencySketch::FrequencySketch()
+{
+    this->EnsureCapacity(0);
+}
+
+void FrequencySketch::EnsureCapacity(std::uint32_t maximum_number_of_keys)
+{
+    // we use one 64-bit word (i.e. 16 counters) per key, rounded up to the next power of two
+    uint64_t table_size = FrequencySketch::kMinTableSize;
+    while (table_size < maximum_number_of_keys)
+    {
+        table_size *= 2;
+    }
+
+    if (table_size <= this->table_.size())
+    {
+        return;
+    }
+
+    if (this->table_.empty())
+    {
+        this->table_.assign(static_cast<size_t>(table_size), 0);
+    }
+    else
+    {
+        // When doubling the size of the table, the index of a counter gets one additional bit - so, if we copy the content of the
+        //  table into both halves, every key maps to counters with the same values as before, and the recorded frequencies are preserved.
+        while (this->table_.size() < table_size)
+        {
+            const size_t old_size = this->table_.size();
+            this->table_.resize(2 * old_size);
+            copy(this->table_.begin(), this->table_.begin() + old_size, this->table_.begin() + old_size);
+        }
+    }
+
+    this->table_mask_ = table_size - 1;
+    this->sample_size_ = FrequencySketch::kSampleSizeFactor * table_size;
+}
+
+void FrequencySketch::Increment(int key)
+{
+    const uint64_t hash = FrequencySketch::Hash(static_cast<uint32_t>(key));
+    bool counter_was_incremented = false;
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        // derive four (nearly independent) indices by double hashing, the lowest four bits select the counter within the word
+        const uint64_t hash_i = FrequencySketch::Hash(hash + i * ((hash >> 32) | 1));
+        uint64_t& word = this->table_[static_cast<size_t>((hash_i >> 4) & this->table_mask_)];
+        const unsigned int shift = static_cast<unsigned int>(hash_i & 15) * 4;
+        if (((word >> shift) & 0xf) < FrequencySketch::kMaxCounterValue)
+        {
+            word += static_cast<uint64_t>(1) << shift;
+            counter_was_incremented = true;
+        }
+    }
+
+    if (counter_was_incremented && ++this->number_of_increments_ >= this->sample_size_)
+    {
+        this->HalveAllCounters();
+    }
+}
+
+std::uint32_t FrequencySketch::GetFrequency(int key) const
+{
+    const uint64_t hash = FrequencySketch::Hash(static_cast<uint32_t>(key));
+    uint32_t frequency = FrequencySketch::kMaxCounterValue;
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        const uint64_t hash_i = FrequencySketch::Hash(hash + i * ((hash >> 32) | 1));
+        const uint64_t word = this->table_[static_cast<size_t>((hash_i >> 4) & this->table_mask_)];
+        const unsigned int shift = static_cast<unsigned int>(hash_i & 15) * 4;
+        frequency = min(frequency, static_cast<uint32_t>((word >> shift) & 0xf));
+    }
+
+    return frequency;
+}
+
+void FrequencySketch::HalveAllCounters()
+{
+    // shift every counter right by one bit (the mask clears the bit shifted in from the neighboring counter)
+    for (auto& word : this->table_)
+    {
+        word = (word >> 1) & 0x7777777777777777ull;
+    }
+
+    this->number_of_increments_ /= 2;
+}
+
+/*static*/std::uint64_t FrequencySketch::Hash(std::uint64_t value)
+{
+    // the finalizer of the SplitMix64 generator
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
@@ -0,0 +1,49 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// A count-min sketch with 4-bit counters, which estimates how often a key has been seen "recently". Every key is
+/// mapped to four counters (in a table of 64-bit words, each holding 16 counters), and the estimated frequency is the
+/// minimum of those counters. In order to let the sketch adapt to a changing access pattern, all counters are halved
+/// after a number of increments proportional to the size of the table ("aging").
+/// This class is not thread-safe.
+class FrequencySketch
+{
+private:
+    static constexpr std::uint32_t kMinTableSize = 16;
+    static constexpr std::uint32_t kMaxCounterValue = 15;
+    static constexpr std::uint32_t kSampleSizeFactor = 10;  ///< The counters are halved after (kSampleSizeFactor * table size) increments.
+
+    std::vector<std::uint64_t> table_;
+    std::uint64_t table_mask_{ 0 };
+    std::uint64_t sample_size_{ 0 };
+    std::uint64_t number_of_increments_{ 0 };
+public:
+    FrequencySketch();
+
+    /// Ensures that the sketch can hold (with reasonable accuracy) the specified number of keys. The table is enlarged
+    /// if necessary (where the frequencies recorded so far are preserved).
+    ///
+    /// \param  maximum_number_of_keys  The maximum number of keys.
+    void EnsureCapacity(std::uint32_t maximum_number_of_keys);
+
+    /// Increments the (estimated) frequency of the specified key.
+    ///
+    /// \param  key The key.
+    void Increment(int key);
+
+    /// Gets the estimated frequency of the specified key (which is a number between 0 and 15).
+    ///
+    /// \param  key The key.
+    ///
+    /// \returns    The estimated frequency.
+    std::uint32_t GetFrequency(int key) const;
+private:
+    void HalveAllCounters();
+    static std::uint64_t Hash(std::uint64_t value);
+};
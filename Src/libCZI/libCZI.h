@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <exception>
 #include <functional>
+#include <future>
 #include <memory>
 #include <map>
 #include <limits>
@@ -67,6 +69,7 @@ namespace libCZI
     class ISubBlockRepository;
     class IAttachment;
     class ISubBlockCache;
+    class ISubBlockAllocator;
 
     /// This structure contains information about the compiler settings and the version of the source
     /// which was used to create the library.
@@ -126,6 +129,38 @@ namespace libCZI
     /// \return The newly allocated bitmap containing the image from the sub-block.
     LIBCZI_API std::shared_ptr<IBitmapData>  CreateBitmapFromSubBlock(ISubBlock* subBlk);
 
+    /// Creates bitmap from sub block with reduced resolution, i.e. downscaled by the specified power of two. This is only faster than
+    /// creating the bitmap with full resolution (and then downscaling it) if the decoder supports decoding with reduced resolution (which
+    /// is the case for JPG-XR), otherwise the bitmap is created with full resolution. So, the size of the returned bitmap is either the
+    /// physical size of the sub-block, or the physical size divided by a power of two (rounded up) not larger than the downscale factor.
+    /// \param [in] subBlk          The sub-block.
+    /// \param      downscaleFactor The downscale factor, which must be one of 1, 2, 4, 8 or 16.
+    /// \return The newly allocated bitmap containing the image from the sub-block.
+    LIBCZI_API std::shared_ptr<IBitmapData>  CreateBitmapFromSubBlockWithReducedResolution(ISubBlock* subBlk, std::uint32_t downscaleFactor);
+
+    /// Creates bitmap from a region of the sub block (optionally with reduced resolution). This is only faster than creating the bitmap
+    /// of the whole sub-block if the decoder supports decoding a region (which is the case for JPG-XR), otherwise the bitmap of the whole
+    /// sub-block is created. The region which the returned bitmap covers is reported in `decodedRegion` (in pixels of the sub-block at
+    /// full resolution, i.e. relative to its physical size) - with reduced resolution, the bitmap is to be stretched onto this region.
+    /// \param [in]  subBlk          The sub-block.
+    /// \param       downscaleFactor The downscale factor, which must be one of 1, 2, 4, 8 or 16.
+    /// \param       roi             The region of the sub-block to be decoded (in pixels of the sub-block at full resolution). It must intersect with the sub-block.
+    /// \param [out] decodedRegion   The region of the sub-block (in pixels of the sub-block at full resolution) which the returned bitmap covers.
+    /// \return The newly allocated bitmap containing (at least) the specified region of the image from the sub-block.
+    LIBCZI_API std::shared_ptr<IBitmapData>  CreateBitmapFromSubBlockRegion(ISubBlock* subBlk, std::uint32_t downscaleFactor, const IntRect& roi, IntRect& decodedRegion);
+
+    /// Attempts to decode a region of the sub-block directly into the specified memory (with full resolution and with the pixel type
+    /// of the sub-block), without creating an intermediate bitmap - which is intended for decoding into a part of a larger bitmap. Only the
+    /// pixels of the region are written to. This is only possible if the decoder supports it (which is the case for JPG-XR, and for zstd
+    /// if the whole sub-block is requested and the destination is suitable); if false is returned, then the memory is not modified and the
+    /// caller is expected to create a bitmap instead (e.g. with `CreateBitmapFromSubBlockRegion`).
+    /// \param [in] subBlk          The sub-block.
+    /// \param      roi             The region of the sub-block to be decoded (in pixels of the sub-block). It must not be empty and it must be contained in the sub-block.
+    /// \param      ptrDestination  Pointer to the memory where the top-left pixel of the region is to be put.
+    /// \param      stride          The stride of the destination memory (in bytes).
+    /// \return True if the region was decoded into the destination memory; false if this is not possible for the sub-block.
+    LIBCZI_API bool TryDecodeSubBlockRegionInto(ISubBlock* subBlk, const IntRect& roi, void* ptrDestination, std::uint32_t stride);
+
     /// Creates metadata-object from a metadata segment.
     /// \param [in] metadataSegment The metadata segment object.
     /// \return The newly created metadata object.
@@ -174,9 +209,80 @@ namespace libCZI
     /// \return The newly created metadata-builder-object.
     LIBCZI_API std::shared_ptr<ICziMetadataBuilder> CreateMetadataBuilder();
 
+    /// Options controlling the creation of a sub-block cache object.
+    struct SubBlockCacheOptions
+    {
+        /// Values that represent the available implementations of the sub-block cache.
+        enum class Type
+        {
+            /// A simple implementation which protects all elements with a single lock. Evicting an element requires
+            /// a scan over all elements, so this implementation is only suitable for caches with a moderate number of elements.
+            Simple,
+
+            /// The elements are distributed over a number of shards (based on the sub-block index), each with its own lock and
+            /// its own LRU-list. Adding, retrieving and evicting an element is done in constant time, and concurrent
+            /// operations on different shards do not contend for a lock.
+            Sharded,
+        };
+
+        /// The implementation to be used.
+        Type type{ Type::Simple };
+
+        /// Values that represent the eviction policies (i.e. the strategies for choosing the elements to be removed when pruning the cache).
+        enum class EvictionPolicy
+        {
+            /// The least recently used elements are evicted.
+            Lru,
+
+            /// The W-TinyLFU policy (only available with Type::Sharded): new elements are put into a small "window" (LRU-ordered), and
+            /// only if an element leaving the window has been requested more often than the element which would be evicted in its
+            /// place (as estimated by a compact frequency sketch), it is admitted to the main part of the cache. The frequency is
+            /// weighted with the decode cost given with ISubBlockCacheOperation::AddWithDecodeCost. This policy keeps frequently
+            /// used elements in the cache in the presence of scans (e.g. when traversing a whole plane once).
+            WTinyLfu,
+        };
+
+        /// The number of shards (only used for Type::Sharded), which is rounded up to the next power of two. If 0, then a default is used.
+        std::uint32_t number_of_shards{ 0 };
+
+        /// The eviction policy to be used.
+        EvictionPolicy eviction_policy{ EvictionPolicy::Lru };
+
+        /// If true, then the cache gets a second tier which holds the undecoded sub-blocks (i.e. the compressed payload as read from
+        /// the file). The tier of decoded bitmaps (configured with the options above) saves the cost of decoding, whereas the compressed
+        /// tier saves the I/O - with compressed data, many more sub-blocks fit into the same amount of memory. Sub-blocks whose bitmap is
+        /// retrieved from the cache are kept in the compressed tier as well, so that they are still available there after the bitmap has been
+        /// evicted. The limits of the compressed tier are given with ISubBlockCacheControl::PruneOptions.
+        bool enable_compressed_tier{ false };
+    };
+
     /// Creates a sub block cache object.
+    /// \param  options (Optional) Options for controlling the operation. This argument may
+    ///                 be null, in which case default options are used.
     /// \returns    The newly created sub block cache.
-    LIBCZI_API std::shared_ptr<ISubBlockCache> CreateSubBlockCache();
+    LIBCZI_API std::shared_ptr<ISubBlockCache> CreateSubBlockCache(const SubBlockCacheOptions* options = nullptr);
+
+    /// Creates an allocator object (for use with the CZI-reader) which keeps memory blocks in a pool instead of
+    /// returning them to the heap. Requested sizes are rounded up to a size class, and a memory block which is
+    /// freed is put into a free-list for its size class (as long as the total size of the memory blocks held in the pool
+    /// does not exceed the specified limit). The object is thread-safe.
+    /// \param  max_pooled_memory_size  The maximum number of bytes which are held in the pool (i.e. memory blocks
+    ///                                 which are not in use).
+    /// \returns    The newly created allocator object.
+    LIBCZI_API std::shared_ptr<ISubBlockAllocator> CreatePooledSubBlockAllocator(std::uint64_t max_pooled_memory_size);
+
+    /// Creates a task executor which runs the tasks on a fixed number of worker threads. Every worker has its own queues
+    /// (one for each priority), and tasks submitted from a worker thread are put into the queue of this worker; an idle worker
+    /// steals tasks from the other workers. Tasks submitted from other threads are put into a queue shared by all workers.
+    /// Pending tasks with a higher priority are always started before tasks with a lower priority.
+    /// \param  number_of_threads   The number of worker threads. If less than 1, then the number of hardware threads is used.
+    /// \returns    The newly created task executor.
+    LIBCZI_API std::shared_ptr<ITaskExecutor> CreateWorkStealingTaskExecutor(int number_of_threads);
+
+    /// Gets the library's default task executor. This is a work-stealing executor (see `CreateWorkStealingTaskExecutor`)
+    /// with one worker thread for each hardware thread, which is created on first use and is never destroyed.
+    /// \returns    The default task executor.
+    LIBCZI_API std::shared_ptr<ITaskExecutor> GetDefaultTaskExecutor();
 
     /// Creates metadata builder object from the specified UTF8-encoded XML-string. If the XML is
     /// invalid or if the root-node "ImageDocument" is not present, then an exception is thrown.
@@ -209,6 +315,105 @@ namespace libCZI
         virtual ~IStream() = default;
     };
 
+    /// This structure describes one range of a batched read operation (c.f. IStreamEx::ReadMany).
+    struct StreamReadRange
+    {
+        std::uint64_t offset;       ///< The offset in the stream where to start reading.
+        void* data;                 ///< The destination buffer, which must be (at least) 'size' bytes large.
+        std::uint64_t size;         ///< The number of bytes to read.
+        std::uint64_t bytes_read;   ///< [out] The number of bytes which were actually read (which may be less than 'size' at the end of the stream).
+    };
+
+    /// Extension of the IStream-interface for streams which can give direct access to their content (e.g. streams
+    /// based on a memory-mapped file), and for streams which can read a set of ranges more efficiently than with
+    /// one Read-call per range. Whether a stream object implements this interface can be determined with a dynamic_cast.
+    class IStreamEx : public IStream
+    {
+    public:
+        /// Attempts to get direct access to the specified range of the stream. If successful, a pointer to the
+        /// content is returned, and the memory it points to is guaranteed to remain valid (and unchanged) for as
+        /// long as the returned shared_ptr (or a copy of it) exists - even if the stream object itself is destroyed.
+        /// The memory must not be modified. If direct access is not possible (e.g. because the range extends beyond
+        /// the end of the stream), false is returned and the caller should use the Read-method instead.
+        ///
+        /// \param          offset  The offset of the range.
+        /// \param          size    The size of the range in bytes.
+        /// \param [out]    data    If successful, a pointer to the content of the specified range is put here.
+        ///
+        /// \returns    True if it succeeds; false otherwise.
+        virtual bool TryGetDirectAccess(std::uint64_t offset, std::uint64_t size, std::shared_ptr<const void>& data) = 0;
+
+        /// Reads the specified ranges from the stream. The semantic is the same as calling Read for each of the ranges,
+        /// but an implementation may choose to reorder and coalesce the requests (e.g. reading adjacent ranges with a
+        /// single vectored I/O-operation, or issuing the requests for a remote resource in parallel). The ranges may
+        /// be given in any order, and the destination buffers must not overlap. If an error occurs, an exception is
+        /// thrown - in this case the content of the destination buffers is undefined.
+        /// The default implementation simply calls Read for each range.
+        ///
+        /// \param [in,out] ranges  The ranges to be read. On return, the field 'bytes_read' of each range is set.
+        /// \param          count   The number of elements in the 'ranges' array.
+        virtual void ReadMany(StreamReadRange* ranges, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                this->Read(ranges[i].offset, ranges[i].data, ranges[i].size, &ranges[i].bytes_read);
+            }
+        }
+
+        ~IStreamEx() override = default;
+    };
+
+    /// Interface for stream objects which keep statistics about the requests they issue to the underlying resource (e.g. streams
+    /// accessing a remote resource). Whether a stream object implements this interface can be determined with a dynamic_cast.
+    class IStreamStatistics
+    {
+    public:
+        /// Statistics about the requests issued by a stream object.
+        struct RequestStatistics
+        {
+            std::uint64_t requests{ 0 };                    ///< The number of requests which have been issued.
+            std::uint64_t failed_requests{ 0 };             ///< The number of requests which failed.
+            std::uint64_t bytes_received{ 0 };              ///< The total number of (payload) bytes received.
+            std::uint64_t total_request_time_us{ 0 };       ///< The accumulated duration of all requests in microseconds.
+            std::uint64_t max_request_time_us{ 0 };         ///< The duration of the longest request in microseconds.
+            std::uint64_t connections_established{ 0 };     ///< The number of connections which had to be established (i.e. which could not be reused).
+            std::uint32_t max_concurrent_requests{ 0 };     ///< The maximum number of requests which were in flight at the same time.
+        };
+
+        /// Gets the statistics accumulated since the stream object was created.
+        ///
+        /// \returns    The request statistics.
+        virtual RequestStatistics GetRequestStatistics() = 0;
+
+        virtual ~IStreamStatistics() = default;
+    };
+
+    /// Interface for stream objects which cache the content of an underlying stream (e.g. the caching stream decorator which
+    /// can be created with the streams factory). Whether a stream object implements this interface can be determined with
+    /// a dynamic_cast.
+    class IStreamCacheStatistics
+    {
+    public:
+        /// Statistics about the operation of a stream cache. Note that hits and misses are counted in units of cache blocks.
+        struct CacheStatistics
+        {
+            std::uint64_t block_hits{ 0 };                  ///< The number of cache blocks which could be served from the cache.
+            std::uint64_t block_misses{ 0 };                ///< The number of cache blocks which had to be read from the underlying stream.
+            std::uint64_t read_ahead_blocks{ 0 };           ///< The number of cache blocks which were read ahead (i.e. without being requested).
+            std::uint64_t evicted_blocks{ 0 };              ///< The number of cache blocks which were evicted from the cache.
+            std::uint64_t bypassed_reads{ 0 };              ///< The number of (large) reads which were passed on to the underlying stream without caching.
+            std::uint64_t underlying_reads{ 0 };            ///< The number of read operations issued to the underlying stream.
+            std::uint64_t bytes_read_from_underlying{ 0 };  ///< The total number of bytes read from the underlying stream.
+        };
+
+        /// Gets the statistics accumulated since the stream object was created.
+        ///
+        /// \returns    The cache statistics.
+        virtual CacheStatistics GetCacheStatistics() = 0;
+
+        virtual ~IStreamCacheStatistics() = default;
+    };
+
     /// Interface used for writing a data-stream. The abstraction used is:
     /// - It is possible to write to arbitrary positions.  
     /// - The end of the stream is defined by the highest position written to.  
@@ -296,6 +501,25 @@ namespace libCZI
         std::uint64_t filePosition; ///< The file position of the subblock.
     };
 
+    /// Interface for an allocator which is used by the CZI-reader for allocating the memory for the data-parts of a
+    /// sub-block (i.e. the bitmap-data, the attachment and the metadata). This allows to use e.g. a pool of memory
+    /// blocks instead of the global heap. Implementations of this interface must be thread-safe.
+    class ISubBlockAllocator
+    {
+    public:
+        /// Allocates a memory block of the specified size. If the allocation fails, an exception must be thrown
+        /// (e.g. std::bad_alloc).
+        /// \param  size    The size of the memory block in bytes (which is always greater than zero).
+        /// \returns    Pointer to the newly allocated memory block.
+        virtual void* Allocate(std::size_t size) = 0;
+
+        /// Frees the specified memory block, which was allocated by this object.
+        /// \param [in] ptr The memory block to free (which is never nullptr).
+        virtual void Free(void* ptr) = 0;
+
+        virtual ~ISubBlockAllocator() = default;
+    };
+
     /// Representation of a sub-block. A sub-block can contain three types of data: the bitmap-data,
     /// an attachment and metadata. The presence of an attachment is optional.
     class ISubBlock
@@ -603,9 +827,48 @@ namespace libCZI
         ///                 information about the sub-block.
         virtual void EnumerateSubBlocksEx(const std::function<bool(int index, const DirectorySubBlockInfo& info)>& funcEnum) = 0;
 
+        /// Reads the sub-blocks identified by the specified indices. The result is the same as calling "ReadSubBlock" for each
+        /// of the indices, but the I/O is done with as few operations as possible - if the stream implements IStreamEx, then
+        /// the sub-blocks are read with batched reads (c.f. IStreamEx::ReadMany), i.e. with a constant number of requests
+        /// instead of (at least) one request per sub-block.
+        /// \param indices  The indices of the sub-blocks (as reported by the Enumerate-methods).
+        /// \returns    A vector (with the same number of elements as 'indices') with the sub-block objects. An element is an
+        ///             empty shared_ptr if there is no sub-block present for the respective index.
+        virtual std::vector<std::shared_ptr<ISubBlock>> ReadSubBlocks(const std::vector<int>& indices) = 0;
+
         virtual ~ISubBlockRepositoryEx() = default;
     };
 
+    /// Extension of the subblock-repository which gives the caller control over the memory the data of a sub-block is read into.
+    /// Whether a repository object implements this interface can be determined with a dynamic_cast (the CZI-reader created
+    /// with "CreateCZIReader" does implement it).
+    class LIBCZI_API ISubBlockRepositoryMemoryControl
+    {
+    public:
+        /// Reads the sub-block identified by the specified index, where the memory for the data-parts of the sub-block
+        /// is allocated with the specified allocator (instead of the allocator which is configured for the repository).
+        /// The allocator is referenced by the sub-block object as long as the memory is in use. If there is no sub-block
+        /// present (for the specified index) then an empty shared_ptr is returned.
+        /// \param index        Index of the sub-block (as reported by the Enumerate-methods).
+        /// \param allocator    The allocator to use. If this is empty, then the allocator configured for the repository is used.
+        /// \return If successful, the sub-block object; otherwise an empty shared_ptr.
+        virtual std::shared_ptr<ISubBlock> ReadSubBlockUsingAllocator(int index, const std::shared_ptr<ISubBlockAllocator>& allocator) = 0;
+
+        /// Reads the data-part of the sub-block identified by the specified index directly into a buffer provided by
+        /// the caller. Only the header of the sub-block is read in addition, the metadata and the attachment are skipped.
+        /// The functor 'get_buffer' is called once the size of the data-part is known (and it is not called if the size
+        /// is zero). It must return a pointer to a buffer of at least this size which must remain valid until this method
+        /// returns, or nullptr - in which case the data is not read. The functor may throw an exception, which is propagated
+        /// to the caller.
+        /// Information about the sub-block (like pixel type and compression) can be retrieved with "ISubBlockRepository::TryGetSubBlockInfo".
+        /// \param index        Index of the sub-block (as reported by the Enumerate-methods).
+        /// \param get_buffer   The functor which is called with the size of the data-part in bytes, and which returns the buffer to read the data into.
+        /// \returns    True if it succeeds; false if there is no sub-block present for the specified index.
+        virtual bool TryReadSubBlockData(int index, const std::function<void* (std::uint64_t size)>& get_buffer) = 0;
+
+        virtual ~ISubBlockRepositoryMemoryControl() = default;
+    };
+
     /// Interface for the attachment repository. This interface is used to access the attachments in a CZI-file.
     class LIBCZI_API IAttachmentRepository
     {
@@ -671,13 +934,57 @@ namespace libCZI
             /// without problems.
             bool ignore_sizem_for_pyramid_subblocks{ false };   
 
+            /// The allocator which is used for allocating the memory for the data-parts of a sub-block when reading a sub-block.
+            /// If this is empty, then memory is allocated from the heap (with malloc/free).
+            std::shared_ptr<ISubBlockAllocator> sub_block_allocator;
+
+            /// An (optional) stream from which a persisted sub-block directory index is read - this is a "sidecar" to the CZI-document,
+            /// as it is written with "sub_block_directory_index_output". If the index is valid for the document (which is checked by
+            /// the file-GUID, the size of the document, the position of the sub-block directory and the sizes given in its segment
+            /// header, and the parsing options), then the sub-block directory is not read from the document at all. If the index is
+            /// not valid, then it is ignored. Note that an in-place modification of the sub-block directory (as done e.g. by CZIrepair)
+            /// is only detected if "sub_block_directory_index_validate_content" is set.
+            std::shared_ptr<IStream> sub_block_directory_index_input;
+
+            /// An (optional) stream to which a sub-block directory index is written. The index is written if the sub-block directory
+            /// was parsed from the document (i.e. if no valid index was given with "sub_block_directory_index_input").
+            std::shared_ptr<IOutputStream> sub_block_directory_index_output;
+
+            /// If true, then a hash of the raw content of the sub-block directory is stored in the index which is written (with
+            /// "sub_block_directory_index_output"), and an index which is read (with "sub_block_directory_index_input") is only used
+            /// if it contains this hash and if it matches the content of the sub-block directory. This detects an in-place modification
+            /// of the sub-block directory, but requires to read the complete sub-block directory (sequentially, which is still faster
+            /// than parsing it).
+            bool sub_block_directory_index_validate_content{ false };
+
+            /// The (optional) task executor on which the I/O of the asynchronous operations ("BeginReadSubBlock" etc.) is done. If
+            /// this is empty, then the task executor of the Site-object is used (for both I/O and decoding). Since a read occupies
+            /// its thread until it completes, an executor with a larger number of threads allows to keep more reads in flight - which
+            /// is useful for streams with a high latency (like a HTTP-stream), where otherwise the decoding threads would be waiting.
+            std::shared_ptr<ITaskExecutor> io_task_executor;
+
             /// Sets the the default.
             void SetDefault()
             {
                 this->lax_subblock_coordinate_checks = true;
+                this->sub_block_allocator.reset();
+                this->sub_block_directory_index_input.reset();
+                this->sub_block_directory_index_output.reset();
+                this->sub_block_directory_index_validate_content = false;
+                this->io_task_executor.reset();
             }
         };
 
+        /// The completion handler of an asynchronous read of a sub-block. If the operation failed, then "error" contains the
+        /// exception (and "sub_block" is empty). Otherwise, "sub_block" contains the sub-block, or it is empty if there is
+        /// no sub-block for the specified index.
+        typedef std::function<void(const std::shared_ptr<ISubBlock>& sub_block, std::exception_ptr error)> ReadSubBlockCompletion;
+
+        /// The completion handler of an asynchronous read of a sub-block (which includes the decoding of the bitmap). If the
+        /// operation failed, then "error" contains the exception. Otherwise, "sub_block" and "bitmap" contain the sub-block and
+        /// its bitmap, or they are empty if there is no sub-block for the specified index.
+        typedef std::function<void(const std::shared_ptr<ISubBlock>& sub_block, const std::shared_ptr<IBitmapData>& bitmap, std::exception_ptr error)> ReadSubBlockAndCreateBitmapCompletion;
+
         /// Opens the specified stream and reads the global information from the CZI-document. The stream
         /// passed in will have its refcount incremented, a reference is held until Close is called (or
         /// the instance is destroyed).
@@ -718,7 +1025,85 @@ namespace libCZI
         /// stream object are released). Concurrently executing operations continue to use the stream
         /// and keep it referenced until they are finished.
         virtual void Close() = 0;
+
+        /// Starts reading the sub-block identified by the specified index asynchronously. The read is executed on the I/O task
+        /// executor (see "OpenOptions::io_task_executor"), and the completion handler is called on the thread which executed it.
+        /// The completion handler is called exactly once (if this method returns without an exception), and it should not throw
+        /// an exception. The reader-object is kept alive until the operation has completed.
+        /// \remark
+        /// If the class is not operational (i. e. Open was not called or Open was not successful), then an exception of type std::logic_error is thrown.
+        ///
+        /// \param index        Index of the sub-block (as reported by the Enumerate-methods).
+        /// \param priority     The priority with which the operation is submitted to the task executor.
+        /// \param completion   The completion handler.
+        virtual void BeginReadSubBlock(int index, TaskPriority priority, const ReadSubBlockCompletion& completion) = 0;
+
+        /// Starts reading the sub-block identified by the specified index and decoding its bitmap asynchronously. The read is
+        /// executed on the I/O task executor (see "OpenOptions::io_task_executor"), and the decoding is then done as a separate
+        /// task on the task executor of the Site-object - so that I/O and decoding of different sub-blocks overlap. The completion
+        /// handler is called exactly once (if this method returns without an exception), and it should not throw an exception.
+        /// \remark
+        /// If the class is not operational (i. e. Open was not called or Open was not successful), then an exception of type std::logic_error is thrown.
+        ///
+        /// \param index        Index of the sub-block (as reported by the Enumerate-methods).
+        /// \param priority     The priority with which the operation is submitted to the task executors.
+        /// \param completion   The completion handler.
+        virtual void BeginReadSubBlockAndCreateBitmap(int index, TaskPriority priority, const ReadSubBlockAndCreateBitmapCompletion& completion) = 0;
     public:
+        /// Reads the sub-block identified by the specified index asynchronously (see "BeginReadSubBlock").
+        ///
+        /// \param index    Index of the sub-block (as reported by the Enumerate-methods).
+        /// \param priority The priority with which the operation is submitted to the task executor.
+        ///
+        /// \return A future for the sub-block (which is empty if there is no sub-block for the specified index).
+        std::future<std::shared_ptr<ISubBlock>> ReadSubBlockAsync(int index, TaskPriority priority = TaskPriority::Normal)
+        {
+            const auto promise = std::make_shared<std::promise<std::shared_ptr<ISubBlock>>>();
+            auto future = promise->get_future();
+            this->BeginReadSubBlock(
+                index,
+                priority,
+                [promise](const std::shared_ptr<ISubBlock>& sub_block, std::exception_ptr error)->void
+                {
+                    if (error)
+                    {
+                        promise->set_exception(error);
+                    }
+                    else
+                    {
+                        promise->set_value(sub_block);
+                    }
+                });
+            return future;
+        }
+
+        /// Reads the sub-block identified by the specified index and decodes its bitmap asynchronously (see "BeginReadSubBlockAndCreateBitmap").
+        ///
+        /// \param index    Index of the sub-block (as reported by the Enumerate-methods).
+        /// \param priority The priority with which the operation is submitted to the task executors.
+        ///
+        /// \return A future for the bitmap (which is empty if there is no sub-block for the specified index).
+        std::future<std::shared_ptr<IBitmapData>> ReadSubBlockAndCreateBitmapAsync(int index, TaskPriority priority = TaskPriority::Normal)
+        {
+            const auto promise = std::make_shared<std::promise<std::shared_ptr<IBitmapData>>>();
+            auto future = promise->get_future();
+            this->BeginReadSubBlockAndCreateBitmap(
+                index,
+                priority,
+                [promise](const std::shared_ptr<ISubBlock>&, const std::shared_ptr<IBitmapData>& bitmap, std::exception_ptr error)->void
+                {
+                    if (error)
+                    {
+                        promise->set_exception(error);
+                    }
+                    else
+                    {
+                        promise->set_value(bitmap);
+                    }
+                });
+            return future;
+        }
+
         /// Creates a single channel tile accessor.
         /// \return The new single channel tile accessor.
         std::shared_ptr<ISingleChannelTileAccessor>  CreateSingleChannelTileAccessor()
@@ -11,11 +11,13 @@
 #include <memory>
 #include "libCZI_Pixels.h"
 #include "libCZI_Metadata.h"
+#include "libCZI_Site.h"
 
 namespace libCZI
 {
     class IBitmapData;
     class IDimCoordinate;
+    class ISubBlock;
 
     /// Values that represent the accessor types.
     enum class AccessorType
@@ -31,12 +33,17 @@ namespace libCZI
     public:
         static constexpr std::uint8_t kMemoryUsage = 1;     ///< Bit-mask identifying the memory-usage field in the statistics struct.
         static constexpr std::uint8_t kElementsCount = 2;   ///< Bit-mask identifying the elements-count field in the statistics struct.
+        static constexpr std::uint8_t kHitCount = 4;        ///< Bit-mask identifying the hit-count field in the statistics struct.
+        static constexpr std::uint8_t kMissCount = 8;       ///< Bit-mask identifying the miss-count field in the statistics struct.
+        static constexpr std::uint8_t kCompressedTierMemoryUsage = 16;  ///< Bit-mask identifying the compressed-tier-memory-usage field in the statistics struct.
+        static constexpr std::uint8_t kCompressedTierElementsCount = 32; ///< Bit-mask identifying the compressed-tier-elements-count field in the statistics struct.
 
         /// This struct defines the statistics which can be queried from the cache. There is a bitfield which
         /// defines which elements are valid. If the bit is set, then the corresponding member is valid.
         struct Statistics
         {
-            /// A bit mask which indicates which members are valid. C.f. the constants kMemoryUsage and kElementsCount.
+            /// A bit mask which indicates which members are valid. C.f. the constants kMemoryUsage, kElementsCount, kHitCount, kMissCount,
+            /// kCompressedTierMemoryUsage and kCompressedTierElementsCount.
             std::uint8_t validityMask;
 
             /// The memory usage of all elements in the cache. This field is only valid if the bit kMemoryUsage is set in the validityMask.
@@ -44,6 +51,24 @@ namespace libCZI
 
             /// The number of elements in the cache. This field is only valid if the bit kElementsCount is set in the validityMask.
             std::uint32_t elementsCount;
+
+            /// The number of Get-operations which found the requested element in the cache (since the cache was created). This
+            /// field is only valid if the bit kHitCount is set in the validityMask.
+            std::uint64_t hitCount;
+
+            /// The number of Get-operations which did not find the requested element in the cache (since the cache was created). This
+            /// field is only valid if the bit kMissCount is set in the validityMask.
+            std::uint64_t missCount;
+
+            /// The memory usage of all sub-blocks in the compressed tier of the cache.
+            /// This field is only valid if the bit kCompressedTierMemoryUsage is set in the validityMask (which is only the case for
+            /// a cache with a compressed tier).
+            std::uint64_t compressedTierMemoryUsage;
+
+            /// The number of sub-blocks in the compressed tier of the cache.
+            /// This field is only valid if the bit kCompressedTierElementsCount is set in the validityMask (which is only the case for
+            /// a cache with a compressed tier).
+            std::uint32_t compressedTierElementsCount;
         };
 
         /// Gets momentarily valid statistics about the cache. The mask defines which statistic/s is/are to be retrieved.
@@ -72,7 +97,8 @@ namespace libCZI
         /// Options for controlling the prune operation. There are two metrics which can be used to control what
         /// remains in the cache and what is discarded: the maximum memory usage (for all elements in the cache) and 
         /// the maximum number of sub-blocks. If the cache exceeds one of those limits, then elements are evicted from the cache
-        /// until both conditions are met. Eviction is done in the order starting with elements which have been least recently accessed.
+        /// until both conditions are met. With the LRU eviction policy, eviction is done in the order starting with elements which have
+        /// been least recently accessed (c.f. SubBlockCacheOptions for other eviction policies).
         /// As "access" we define either the Add-operation or the Get-operation - so, when an element is retrieved from the
         /// cache, it is considered as "accessed".
         /// If only one condition is desired, then the other condition can be set to the maximum value of the respective type (which is the
@@ -86,6 +112,14 @@ namespace libCZI
             /// The maximum number of sub-blocks in the cache. If the cache exceeds this limit,
             /// then the least recently used sub-blocks are removed from the cache.
             std::uint32_t  maxSubBlockCount{ (std::numeric_limits<decltype(maxSubBlockCount)>::max)() };
+
+            /// The maximum memory usage (in bytes) for the compressed tier of the cache (if the cache has one). If the compressed tier
+            /// exceeds this limit, then the least recently used sub-blocks are removed from it.
+            std::uint64_t   maxMemoryUsageCompressedTier{ (std::numeric_limits<decltype(maxMemoryUsageCompressedTier)>::max)() };
+
+            /// The maximum number of sub-blocks in the compressed tier of the cache (if the cache has one). If the compressed tier
+            /// exceeds this limit, then the least recently used sub-blocks are removed from it.
+            std::uint32_t  maxSubBlockCountCompressedTier{ (std::numeric_limits<decltype(maxSubBlockCountCompressedTier)>::max)() };
         };
 
         /// Prunes the cache. This means that sub-blocks are removed from the cache until the cache satisfies the conditions given in the options.
@@ -117,6 +151,36 @@ namespace libCZI
         /// \param  pBitmap         The bitmap.
         virtual void Add(int subblock_index, std::shared_ptr<IBitmapData> pBitmap) = 0;
 
+        /// Adds the specified bitmap for the specified subblock_index to the cache, giving an estimate of how expensive it is to
+        /// re-create the bitmap (e.g. by decoding the sub-block). A cost-aware eviction policy will prefer to keep elements
+        /// which are expensive to re-create. The default implementation ignores the cost and calls Add.
+        /// \param  subblock_index      The subblock index to add.
+        /// \param  pBitmap             The bitmap.
+        /// \param  decode_cost_weight  The relative cost (per byte) of re-creating the bitmap, where 1 designates the cost of
+        ///                             copying uncompressed data.
+        virtual void AddWithDecodeCost(int subblock_index, std::shared_ptr<IBitmapData> pBitmap, std::uint32_t decode_cost_weight)
+        {
+            this->Add(subblock_index, std::move(pBitmap));
+        }
+
+        /// Gets the (undecoded) sub-block for the specified subblock-index from the compressed tier of the cache. If the cache has no compressed
+        /// tier or if the sub-block is not in it, then a nullptr is returned. The default implementation always returns a nullptr.
+        /// \param  subblock_index  The subblock index to get.
+        /// \returns    If the sub-block is in the compressed tier, then a std::shared_ptr&lt;libCZI::ISubBlock&gt; is returned. Otherwise a nullptr is returned.
+        virtual std::shared_ptr<ISubBlock> GetSubBlock(int subblock_index)
+        {
+            return nullptr;
+        }
+
+        /// Adds the specified (undecoded) sub-block for the specified subblock-index to the compressed tier of the cache. This is intended
+        /// for sub-blocks which have just been read - so that the next request for the sub-block needs no I/O, even if the decoded bitmap has been
+        /// evicted in the meantime. The default implementation does nothing.
+        /// \param  subblock_index  The subblock index to add.
+        /// \param  subBlock        The sub-block.
+        virtual void AddSubBlock(int subblock_index, std::shared_ptr<ISubBlock> subBlock)
+        {
+        }
+
         virtual ~ISubBlockCacheOperation() = default;
 
         ISubBlockCacheOperation() = default;
@@ -133,6 +197,8 @@ namespace libCZI
     ///   returned may be used instead of executing the subblock-read-and-decode operation.
     /// In order to control the memory usage of the cache, the cache object must be pruned (i.e. subblocks are removed from the cache). Currently this means,
     /// that the Prune-method must be called manually. The cache object does not do any pruning automatically.
+    /// A cache object may have a second tier which holds the undecoded sub-blocks (c.f. ISubBlockCacheOperation::GetSubBlock and
+    /// ISubBlockCacheOperation::AddSubBlock), which allows to keep a larger working set in memory (at the cost of decoding).
     /// The operations of Adding, Querying and Pruning the cache object are thread-safe.
     class ISubBlockCache : public ISubBlockCacheStatistics, public ISubBlockCacheControl, public ISubBlockCacheOperation
     {
@@ -207,6 +273,15 @@ namespace libCZI
             /// increased memory usage.
             bool onlyUseSubBlockCacheForCompressedData;
 
+            /// The maximum number of sub-blocks which are read and decoded concurrently (on the task executor provided by the
+            /// Site-object). If this is 1 (or less), then the sub-blocks are read and decoded one after the other on the calling thread.
+            /// The composition is always done on the calling thread and in the same order, so the result is identical for any value.
+            int maxNumberOfDecodeThreads;
+
+            /// The priority with which reading and decoding the sub-blocks is submitted to the task executor (if maxNumberOfDecodeThreads
+            /// is greater than 1).
+            libCZI::TaskPriority decodeTaskPriority;
+
             /// Clears this object to its blank state.
             void Clear()
             {
@@ -217,6 +292,8 @@ namespace libCZI
                 this->sceneFilter.reset();
                 this->subBlockCache.reset();
                 this->onlyUseSubBlockCacheForCompressedData = true;
+                this->maxNumberOfDecodeThreads = 1;
+                this->decodeTaskPriority = libCZI::TaskPriority::Normal;
             }
         };
 
@@ -317,6 +394,15 @@ namespace libCZI
             /// If true, then only bitmaps from sub-blocks with compressed data are added to the cache.
             bool onlyUseSubBlockCacheForCompressedData;
 
+            /// The maximum number of sub-blocks which are read and decoded concurrently (on the task executor provided by the
+            /// Site-object). If this is 1 (or less), then the sub-blocks are read and decoded one after the other on the calling thread.
+            /// The composition is always done on the calling thread and in the same order, so the result is identical for any value.
+            int maxNumberOfDecodeThreads;
+
+            /// The priority with which reading and decoding the sub-blocks is submitted to the task executor (if maxNumberOfDecodeThreads
+            /// is greater than 1).
+            libCZI::TaskPriority decodeTaskPriority;
+
             /// Clears this object to its blank state.
             void Clear()
             {
@@ -326,6 +412,8 @@ namespace libCZI
                 this->sceneFilter.reset();
                 this->subBlockCache.reset();
                 this->onlyUseSubBlockCacheForCompressedData = true;
+                this->maxNumberOfDecodeThreads = 1;
+                this->decodeTaskPriority = libCZI::TaskPriority::Normal;
             }
         };
 
@@ -413,6 +501,22 @@ namespace libCZI
             /// If true, then only bitmaps from sub-blocks with compressed data are added to the cache.
             bool onlyUseSubBlockCacheForCompressedData;
 
+            /// The maximum number of sub-blocks which are read and decoded concurrently (on the task executor provided by the
+            /// Site-object). If this is 1 (or less), then the sub-blocks are read and decoded one after the other on the calling thread.
+            /// The composition is always done on the calling thread and in the same order, so the result is identical for any value.
+            int maxNumberOfDecodeThreads;
+
+            /// The priority with which reading and decoding the sub-blocks is submitted to the task executor (if maxNumberOfDecodeThreads
+            /// is greater than 1).
+            libCZI::TaskPriority decodeTaskPriority;
+
+            /// If true, then sub-blocks which are to be downscaled by a factor of two or more (i.e. if no pyramid layer with a suitable
+            /// resolution exists) are decoded with reduced resolution, provided that the decoder supports this (which is the case for JPG-XR).
+            /// This is considerably faster than decoding at full resolution, but note that the result then differs slightly, since the bitmap
+            /// decoded with reduced resolution is low-pass filtered (whereas the bitmap decoded at full resolution is subsampled).
+            /// Bitmaps decoded with reduced resolution are not added to the sub-block cache.
+            bool useReducedResolutionDecode;
+
             /// Clears this object to its blank state.
             void Clear()
             {
@@ -423,6 +527,9 @@ namespace libCZI
                 this->useVisibilityCheckOptimization = false;
                 this->subBlockCache.reset();
                 this->onlyUseSubBlockCacheForCompressedData = true;
+                this->maxNumberOfDecodeThreads = 1;
+                this->decodeTaskPriority = libCZI::TaskPriority::Normal;
+                this->useReducedResolutionDecode = true;
             }
         };
 
@@ -8,6 +8,7 @@
 #include <mutex>
 #include "bitmapData.h"
 #include "decoder_wic.h"
+#include "Site.h"
 
 using namespace libCZI;
 using namespace std;
@@ -164,6 +165,17 @@ libCZI::ISite* GetSite()
     return g_site;
 }
 
+std::shared_ptr<libCZI::ITaskExecutor> GetTaskExecutor()
+{
+    auto executor = GetSite()->GetTaskExecutor();
+    if (!executor)
+    {
+        executor = libCZI::GetDefaultTaskExecutor();
+    }
+
+    return executor;
+}
+
 libCZI::ISite* libCZI::GetDefaultSiteObject(SiteObjectType type)
 {
     switch (type)
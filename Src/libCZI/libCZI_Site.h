@@ -5,6 +5,7 @@
 #pragma once
 
 #include <sstream>
+#include <functional>
 #include <memory>
 #include <string>
 #include "libCZI_Pixels.h"
@@ -47,6 +48,114 @@ namespace libCZI
         virtual std::shared_ptr<libCZI::IBitmapData> Decode(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height) = 0;
 
         virtual ~IDecoder() = default;
+
+        // Note: methods which were added later are declared after the destructor, so that the vtable-layout of the
+        //  methods declared before (including the destructor) is unchanged.
+
+        /// Passing in a block of raw data, decode the image with reduced resolution (i.e. downscaled by the specified power of two) and return
+        /// a bitmap object. This is intended for decoders which can decode a reduced resolution faster than the full resolution (like
+        /// the JPG-XR decoder). The size of the returned bitmap is the size of the full-resolution bitmap divided by the downscale factor
+        /// (rounded up) - but a decoder may choose to use a smaller downscale factor (e.g. if the bitmap is very small), and it may also
+        /// return the bitmap with full resolution. So, the caller must use the size of the returned bitmap.
+        /// The default implementation decodes the bitmap with full resolution.
+        ///
+        /// \param ptrData          Pointer to a a block of memory (which contains the encoded image).
+        /// \param size             The size of the memory block pointed by `ptrData`.
+        /// \param pixelType        The pixel type of the expected bitmap.
+        /// \param width            The width of the expected bitmap (at full resolution), used for validation purposes only.
+        /// \param height           The height of the expected bitmap (at full resolution), used for validation purposes only.
+        /// \param downscaleFactor  The downscale factor, which must be one of 1, 2, 4, 8 or 16.
+        ///
+        /// \return A bitmap object with the decoded data.
+        virtual std::shared_ptr<libCZI::IBitmapData> DecodeWithReducedResolution(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, std::uint32_t downscaleFactor)
+        {
+            return this->Decode(ptrData, size, pixelType, width, height);
+        }
+
+        /// Passing in a block of raw data, decode a region of the image (optionally with reduced resolution) and return a bitmap object. This
+        /// is intended for decoders which can decode a part of the image faster than the whole image (like the JPG-XR decoder). A decoder may
+        /// choose to decode a larger region than requested (up to the whole image), so the region which the returned bitmap covers is reported
+        /// in `decodedRegion` - it always contains the intersection of the requested region with the image. Both regions are given in pixels
+        /// of the image at full resolution - with reduced resolution, the bitmap is to be stretched onto the decoded region.
+        /// The default implementation decodes the whole image (with DecodeWithReducedResolution).
+        ///
+        /// \param          ptrData          Pointer to a a block of memory (which contains the encoded image).
+        /// \param          size             The size of the memory block pointed by `ptrData`.
+        /// \param          pixelType        The pixel type of the expected bitmap.
+        /// \param          width            The width of the expected bitmap (at full resolution), used for validation purposes only.
+        /// \param          height           The height of the expected bitmap (at full resolution), used for validation purposes only.
+        /// \param          downscaleFactor  The downscale factor, which must be one of 1, 2, 4, 8 or 16.
+        /// \param          roi              The region to be decoded (in pixels of the image at full resolution). It must intersect with the image.
+        /// \param [out]    decodedRegion    The region of the image (in pixels of the image at full resolution) which the returned bitmap covers.
+        ///
+        /// \return A bitmap object with the decoded data.
+        virtual std::shared_ptr<libCZI::IBitmapData> DecodeRegion(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, std::uint32_t downscaleFactor, const libCZI::IntRect& roi, libCZI::IntRect& decodedRegion)
+        {
+            decodedRegion = libCZI::IntRect{ 0, 0, static_cast<int>(width), static_cast<int>(height) };
+            return this->DecodeWithReducedResolution(ptrData, size, pixelType, width, height, downscaleFactor);
+        }
+
+        /// Passing in a block of raw data, attempt to decode a region of the image (at full resolution) directly into the specified memory - which is
+        /// intended for decoding into a part of a larger bitmap (e.g. the destination of a composition operation), without going through an
+        /// intermediate bitmap. The memory receives exactly the pixels of the region (with the pixel type of the image), and nothing outside
+        /// of it (i.e. outside of `roi.w` pixels in each of the `roi.h` lines) is written to.
+        /// If the decoder cannot decode into the specified memory (e.g. because the encoded format does not allow for it), then false is returned
+        /// and the memory is not modified - the caller is then expected to use one of the other methods. The default implementation always
+        /// returns false.
+        ///
+        /// \remark
+        /// In case of an error (of whatever kind) the method is expected to throw an exception. If the exception is thrown after the
+        /// decoding started, then the content of the memory is undefined.
+        ///
+        /// \param ptrData          Pointer to a a block of memory (which contains the encoded image).
+        /// \param size             The size of the memory block pointed by `ptrData`.
+        /// \param pixelType        The pixel type of the image.
+        /// \param width            The width of the image, used for validation purposes only.
+        /// \param height           The height of the image, used for validation purposes only.
+        /// \param roi              The region to be decoded (in pixels of the image). It must not be empty and it must be contained in the image.
+        /// \param ptrDestination   Pointer to the memory where the top-left pixel of the region is to be put.
+        /// \param stride           The stride of the destination memory (in bytes).
+        ///
+        /// \return True if the region was decoded into the destination memory; false if the decoder cannot decode into the memory.
+        virtual bool TryDecodeRegionInto(const void* ptrData, size_t size, libCZI::PixelType pixelType, std::uint32_t width, std::uint32_t height, const libCZI::IntRect& roi, void* ptrDestination, std::uint32_t stride)
+        {
+            return false;
+        }
+    };
+
+    /// Values that represent the priority of a task submitted to a task executor. Tasks with a higher priority are started
+    /// before any pending task with a lower priority (tasks which are already running are not interrupted, though).
+    enum class TaskPriority : std::uint8_t
+    {
+        Interactive = 0,    ///< The highest priority, intended for work a user is waiting for (e.g. the tiles of the current viewport).
+        Normal = 1,         ///< The default priority.
+        Background = 2      ///< The lowest priority, intended for work like prefetching or scanning a whole plane.
+    };
+
+    /// The interface of a task executor - this is the pool of threads the library uses for reading and decoding sub-blocks concurrently.
+    /// All accessors share the executor provided by the Site-object (see `ISite::GetTaskExecutor`), so that the concurrency of the
+    /// library as a whole is bounded (instead of each operation creating threads on its own).
+    class ITaskExecutor
+    {
+    public:
+        /// Submits a task for execution. The task is executed asynchronously, in the order of its priority. This method
+        /// must be thread-safe. The library does not rely on the task being started within any specific time, and it does
+        /// not block on a task which has not yet started, so executing tasks with a bounded (or a very small) number of
+        /// threads is fine.
+        ///
+        /// \remark
+        /// Tasks submitted by the library do not throw exceptions.
+        ///
+        /// \param priority The priority of the task.
+        /// \param task     The task to be executed.
+        virtual void Submit(TaskPriority priority, std::function<void()> task) = 0;
+
+        /// Gets the maximum number of tasks which are executed concurrently.
+        ///
+        /// \returns The maximum number of tasks executed concurrently.
+        virtual int GetMaxConcurrency() = 0;
+
+        virtual ~ITaskExecutor() = default;
     };
 
     const int LOGLEVEL_CATASTROPHICERROR = 0;   ///< Identifies a catastrophic error (i. e. the program cannot continue).
@@ -102,6 +211,16 @@ namespace libCZI
         /// \return The newly allocated bitmap.
         virtual std::shared_ptr<libCZI::IBitmapData> CreateBitmap(libCZI::PixelType pixeltype, std::uint32_t width, std::uint32_t height, std::uint32_t stride = 0, std::uint32_t extraRows = 0, std::uint32_t extraColumns = 0) = 0;
 
+        /// Gets the task executor which is used for reading and decoding sub-blocks concurrently. Overriding this method allows
+        /// to inject an executor (e.g. a thread-pool shared with the application). If an empty pointer is returned, then the
+        /// library's default executor (see `libCZI::GetDefaultTaskExecutor`) is used.
+        ///
+        /// \return The task executor (or an empty pointer in order to use the default executor).
+        virtual std::shared_ptr<ITaskExecutor> GetTaskExecutor()
+        {
+            return std::shared_ptr<ITaskExecutor>();
+        }
+
         /// Output the specified string at the specified logging level.
         /// \param level The level.
         /// \param str   The string.
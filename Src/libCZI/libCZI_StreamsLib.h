@@ -232,6 +232,16 @@ namespace libCZI
                 kCurlHttp_CaInfo = 110, ///< For CurlHttpInputStream, type string: gives the directory to check for CA certificate bundle , c.f. https://curl.se/libcurl/c/CURLOPT_CAINFO.html for more information.
 
                 kCurlHttp_CaInfoBlob = 111, ///< For CurlHttpInputStream, type string: give PEM encoded content holding one or more certificates to verify the HTTPS server with, c.f. https://curl.se/libcurl/c/CURLOPT_CAINFO_BLOB.html for more information.
+
+                kCurlHttp_MaxConnections = 112, ///< For CurlHttpInputStream, type int32: gives the maximum number of connections (i.e. of concurrent requests) the stream-object uses, the default is 8. Connections are kept alive and reused for subsequent requests.
+
+                kCaching_Enabled = 200, ///< For all stream classes, type bool: if true, the stream-object is wrapped into a caching decorator, which keeps recently read blocks in an LRU-cache and reads ahead when sequential access is detected. This is beneficial for streams where small reads are expensive (e.g. for a remote resource).
+
+                kCaching_BlockSize = 201, ///< For the caching decorator, type int32: gives the size of a cache block in bytes, the default is 64KB. Reads which are at least as large as a block bypass the cache.
+
+                kCaching_MaxBlocks = 202, ///< For the caching decorator, type int32: gives the maximum number of blocks held in the cache, the default is 256.
+
+                kCaching_MaxReadAheadBlocks = 203, ///< For the caching decorator, type int32: gives the maximum number of blocks which are read ahead on sequential access, the default is 8. A value of 0 disables read-ahead.
             };
         };
 
@@ -319,6 +329,18 @@ namespace libCZI
         /// \returns    The number of available stream classes.
         static int GetStreamClassesCount();
 
+        /// Wraps the specified stream into a caching decorator. The decorator keeps recently read blocks of the stream in an LRU-cache,
+        /// and it reads ahead when it detects sequential access. Small reads (smaller than the block size) are served from the cache,
+        /// larger reads are passed on to the underlying stream. The options are taken from the property bag (the keys kCaching_BlockSize,
+        /// kCaching_MaxBlocks and kCaching_MaxReadAheadBlocks are used, other keys are ignored). The returned object implements the
+        /// IStreamCacheStatistics-interface. Note that the content of the underlying stream is assumed to not change.
+        ///
+        /// \param  stream          The stream to be wrapped.
+        /// \param  property_bag    A property-bag with options for the caching decorator.
+        ///
+        /// \returns    The newly created caching stream.
+        static std::shared_ptr<libCZI::IStream> CreateCachingStream(const std::shared_ptr<libCZI::IStream>& stream, const std::map<int, Property>& property_bag);
+
         /// Creates an instance of the default streams-objects for reading from the file-system.
         ///
         /// \param  filename Filename of the file to open (in UTF-8 encoding).
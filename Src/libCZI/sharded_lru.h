@@ -0,0 +1,137 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// The machinery shared by the sharded caches (ShardedSubBlockCache and TwoTierSubBlockCache) for keeping elements in LRU-order
+/// across a number of shards. The elements are distributed over the shards based on a hash of their key (the sub-block index),
+/// and every shard has its own lock. Every element is given an "LRU value" (from a global counter) when it is marked as used,
+/// and every shard publishes the LRU value of its least recently used element in an atomic variable - so, the shard containing
+/// the overall least recently used element can be determined without taking any lock.
+/// How a shard keeps its elements in LRU-order is up to the cache - the shard data (given as template parameter) is extended
+/// with the lock and the published LRU value.
+template <typename TShardData>
+class ShardedLru
+{
+public:
+    /// The LRU value published by a shard which contains no elements.
+    static constexpr std::uint64_t kLruValueOfEmptyShard = UINT64_MAX;
+
+    struct Shard : TShardData
+    {
+        std::mutex mutex;
+        std::atomic_uint64_t lru_value_of_least_recently_used{ kLruValueOfEmptyShard };
+    };
+
+private:
+    std::unique_ptr<Shard[]> shards_;
+    std::uint32_t number_of_shards_;
+    std::atomic_uint64_t lru_counter_{ 0 };     ///< The "LRU counter" - when marking an element as "used", this counter is incremented and the new value is stored with the element.
+public:
+    /// Constructor.
+    /// \param  number_of_shards            The number of shards (rounded up to the next power of two). If 0, then the default is used.
+    /// \param  default_number_of_shards    The default number of shards.
+    /// \param  max_number_of_shards        The maximum number of shards.
+    ShardedLru(std::uint32_t number_of_shards, std::uint32_t default_number_of_shards, std::uint32_t max_number_of_shards)
+    {
+        if (number_of_shards == 0)
+        {
+            number_of_shards = default_number_of_shards;
+        }
+
+        // round up to the next power of two, so that the shard can be determined with a mask
+        this->number_of_shards_ = 1;
+        while (this->number_of_shards_ < number_of_shards && this->number_of_shards_ < max_number_of_shards)
+        {
+            this->number_of_shards_ *= 2;
+        }
+
+        this->shards_.reset(new Shard[this->number_of_shards_]);
+    }
+
+    std::uint32_t GetNumberOfShards() const { return this->number_of_shards_; }
+
+    Shard& GetShardByIndex(std::uint32_t shard_index) const { return this->shards_[shard_index]; }
+
+    /// Gets the shard which the element with the specified key belongs to.
+    /// \param  key The key.
+    /// \returns    The shard.
+    Shard& GetShard(int key) const
+    {
+        // the sub-block indices are usually consecutive, so we scramble them (with a multiplicative hash) before choosing the shard
+        const std::uint32_t hash = static_cast<std::uint32_t>(key) * 0x9e3779b1u;
+        return this->shards_[(hash >> 16) & (this->number_of_shards_ - 1)];
+    }
+
+    /// Gets a new LRU value (for an element which is marked as used).
+    /// \returns    The new LRU value.
+    std::uint64_t GetNextLruValue()
+    {
+        return this->lru_counter_.fetch_add(1);
+    }
+
+    /// Locks all shards (always in the same order) - this allows for getting a consistent snapshot of counters which are
+    /// only modified while holding the lock of a shard.
+    /// \param [out] locks  The locks (which are released when this vector is destroyed).
+    void LockAllShards(std::vector<std::unique_lock<std::mutex>>& locks) const
+    {
+        locks.reserve(locks.size() + this->number_of_shards_);
+        for (std::uint32_t i = 0; i < this->number_of_shards_; ++i)
+        {
+            locks.emplace_back(this->shards_[i].mutex);
+        }
+    }
+
+    /// Publishes the LRU value of the least recently used element of the specified shard. This must be called (while holding
+    /// the lock of the shard) whenever the least recently used element of the shard may have changed.
+    /// \param [in,out] shard                   The shard.
+    /// \param          least_recently_used     The least recently used element of the shard (which has a field "lru_value"), or null if the shard is empty.
+    template <typename TEntry>
+    static void PublishLruValueOfLeastRecentlyUsed(Shard& shard, const TEntry* least_recently_used)
+    {
+        shard.lru_value_of_least_recently_used.store(least_recently_used != nullptr ? least_recently_used->lru_value : kLruValueOfEmptyShard);
+    }
+
+    /// Determines the shard containing the overall least recently used element, and calls the specified functor with this shard
+    /// (while holding its lock). The functor is expected to evict the least recently used element of the shard (and to publish
+    /// the new LRU value).
+    /// \param  evict   The functor which evicts the least recently used element of the shard it is given.
+    /// \returns    False if all shards are empty (and the functor was not called); true otherwise.
+    template <typename TEvict>
+    bool EvictLeastRecentlyUsed(TEvict evict)
+    {
+        // determine the shard whose tail element has the smallest LRU value - this is a snapshot, and by the time we have
+        //  acquired the lock the shard may have changed; in this case we still evict its (then) least recently used element
+        std::uint32_t shard_with_oldest_element = 0;
+        std::uint64_t oldest_lru_value = kLruValueOfEmptyShard;
+        for (std::uint32_t i = 0; i < this->number_of_shards_; ++i)
+        {
+            const std::uint64_t lru_value = this->shards_[i].lru_value_of_least_recently_used.load();
+            if (lru_value < oldest_lru_value)
+            {
+                oldest_lru_value = lru_value;
+                shard_with_oldest_element = i;
+            }
+        }
+
+        if (oldest_lru_value == kLruValueOfEmptyShard)
+        {
+            return false;
+        }
+
+        Shard& shard = this->shards_[shard_with_oldest_element];
+        std::lock_guard<std::mutex> lck(shard.mutex);
+        evict(shard);
+        return true;
+    }
+};
+
+template <typename TShardData>
+constexpr std::uint64_t ShardedLru<TShardData>::kLruValueOfEmptyShard;
@@ -0,0 +1,456 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "sharded_subblock_cache.h"
+#include "subblock_cache.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace libCZI;
+using namespace std;
+
+/*static*/constexpr std::uint32_t ShardedSubBlockCache::kDefaultNumberOfShards;
+/*static*/constexpr std::uint32_t ShardedSubBlockCache::kMaxNumberOfShards;
+/*static*/constexpr std::uint32_t ShardedSubBlockCache::kWindowPercentage;
+/*static*/constexpr std::uint32_t ShardedSubBlockCache::kProtectedPercentage;
+
+ShardedSubBlockCache::ShardedSubBlockCache(std::uint32_t number_of_shards, libCZI::SubBlockCacheOptions::EvictionPolicy eviction_policy)
+    : shards_(number_of_shards, ShardedSubBlockCache::kDefaultNumberOfShards, ShardedSubBlockCache::kMaxNumberOfShards),
+    eviction_policy_(eviction_policy)
+{
+}
+
+ISubBlockCacheStatistics::Statistics ShardedSubBlockCache::GetStatistics(std::uint8_t mask) const
+{
+    Statistics result{};
+    result.validityMask = mask & (ISubBlockCacheStatistics::kMemoryUsage | ISubBlockCacheStatistics::kElementsCount | ISubBlockCacheStatistics::kHitCount | ISubBlockCacheStatistics::kMissCount);
+
+    // The counters are only modified while holding the lock of a shard, so if more than one field is requested, we lock all
+    // shards (always in the same order) in order to get a consistent snapshot.
+    vector<unique_lock<mutex>> locks;
+    if ((result.validityMask & (result.validityMask - 1)) != 0)
+    {
+        this->shards_.LockAllShards(locks);
+    }
+
+    if ((result.validityMask & ISubBlockCacheStatistics::kMemoryUsage) != 0)
+    {
+        result.memoryUsage = this->cache_size_in_bytes_.load();
+    }
+
+    if ((result.validityMask & ISubBlockCacheStatistics::kElementsCount) != 0)
+    {
+        result.elementsCount = this->cache_subblock_count_.load();
+    }
+
+    if ((result.validityMask & ISubBlockCacheStatistics::kHitCount) != 0)
+    {
+        result.hitCount = this->hit_count_.load();
+    }
+
+    if ((result.validityMask & ISubBlockCacheStatistics::kMissCount) != 0)
+    {
+        result.missCount = this->miss_count_.load();
+    }
+
+    return result;
+}
+
+std::shared_ptr<IBitmapData> ShardedSubBlockCache::Get(int subblock_index)
+{
+    Shard& shard = this->shards_.GetShard(subblock_index);
+    lock_guard<mutex> lck(shard.mutex);
+    if (this->eviction_policy_ == SubBlockCacheOptions::EvictionPolicy::WTinyLfu)
+    {
+        // with W-TinyLFU, the frequency of all requested elements is recorded - no matter whether they are in the cache or not
+        shard.frequency_sketch.Increment(subblock_index);
+    }
+
+    const auto element = shard.entries.find(subblock_index);
+    if (element != shard.entries.end())
+    {
+        CacheEntry* entry = &element->second;
+        ++this->hit_count_;
+        entry->lru_value = this->shards_.GetNextLruValue();
+        if (this->eviction_policy_ == SubBlockCacheOptions::EvictionPolicy::WTinyLfu)
+        {
+            ShardedSubBlockCache::OnAccessWTinyLfu(shard, entry);
+        }
+        else
+        {
+            ShardedSubBlockCache::Unlink(shard, entry);
+            ShardedSubBlockCache::LinkAsMostRecentlyUsed(shard, entry, kWindow);
+            ShardedSubBlockCache::PublishLruValueOfLeastRecentlyUsed(shard);
+        }
+
+        return entry->bitmap;
+    }
+
+    ++this->miss_count_;
+    return {};
+}
+
+void ShardedSubBlockCache::Add(int subblock_index, std::shared_ptr<IBitmapData> bitmap)
+{
+    this->AddWithDecodeCost(subblock_index, std::move(bitmap), 1);
+}
+
+void ShardedSubBlockCache::AddWithDecodeCost(int subblock_index, std::shared_ptr<libCZI::IBitmapData> bitmap, std::uint32_t decode_cost_weight)
+{
+    const auto size_in_bytes_of_added_bitmap = SubBlockCache::CalculateSizeInBytes(bitmap.get());
+
+    // the bitmap which is replaced (if any) is released after the lock is dropped
+    shared_ptr<IBitmapData> replaced_bitmap;
+
+    Shard& shard = this->shards_.GetShard(subblock_index);
+    lock_guard<mutex> lck(shard.mutex);
+    const auto result = shard.entries.emplace(subblock_index, CacheEntry());
+    CacheEntry* entry = &result.first->second;
+    Segment segment = kWindow;
+    if (result.second)
+    {
+        // New element inserted
+        entry->subblock_index = subblock_index;
+        this->cache_size_in_bytes_ += size_in_bytes_of_added_bitmap;
+        ++this->cache_subblock_count_;
+    }
+    else
+    {
+        // Element with the same key already existed - it stays in its segment
+        segment = entry->segment;
+        ShardedSubBlockCache::Unlink(shard, entry);
+        this->cache_size_in_bytes_ -= entry->size_in_bytes;
+        this->cache_size_in_bytes_ += size_in_bytes_of_added_bitmap;
+        replaced_bitmap = std::move(entry->bitmap);
+    }
+
+    entry->bitmap = std::move(bitmap);
+    entry->size_in_bytes = size_in_bytes_of_added_bitmap;
+    entry->decode_cost_weight = decode_cost_weight;
+    entry->lru_value = this->shards_.GetNextLruValue();
+    ShardedSubBlockCache::LinkAsMostRecentlyUsed(shard, entry, segment);
+    if (this->eviction_policy_ == SubBlockCacheOptions::EvictionPolicy::WTinyLfu)
+    {
+        shard.frequency_sketch.EnsureCapacity(static_cast<uint32_t>(shard.entries.size()));
+    }
+    else
+    {
+        ShardedSubBlockCache::PublishLruValueOfLeastRecentlyUsed(shard);
+    }
+}
+
+void ShardedSubBlockCache::Prune(const PruneOptions& options)
+{
+    if (options.maxMemoryUsage != numeric_limits<decltype(options.maxMemoryUsage)>::max() ||
+        options.maxSubBlockCount != numeric_limits<decltype(options.maxSubBlockCount)>::max())
+    {
+        if (this->eviction_policy_ == SubBlockCacheOptions::EvictionPolicy::WTinyLfu)
+        {
+            this->PruneWTinyLfu(options);
+            return;
+        }
+
+        while (this->cache_size_in_bytes_.load() > options.maxMemoryUsage || this->cache_subblock_count_.load() > options.maxSubBlockCount)
+        {
+            if (!this->EvictLeastRecentlyUsedElement())
+            {
+                break;
+            }
+        }
+    }
+}
+
+bool ShardedSubBlockCache::EvictLeastRecentlyUsedElement()
+{
+    // the evicted bitmap is released after the lock is dropped
+    vector<shared_ptr<IBitmapData>> evicted_bitmaps;
+    return this->shards_.EvictLeastRecentlyUsed(
+        [&](Shard& shard)->void
+        {
+            CacheEntry* entry = shard.segments[kWindow].least_recently_used;
+            if (entry != nullptr)
+            {
+                this->RemoveEntry(shard, entry, evicted_bitmaps);
+                ShardedSubBlockCache::PublishLruValueOfLeastRecentlyUsed(shard);
+            }
+        });
+}
+
+void ShardedSubBlockCache::PruneWTinyLfu(const PruneOptions& options)
+{
+    // determine the current size of every shard
+    const uint32_t number_of_shards = this->shards_.GetNumberOfShards();
+    vector<uint32_t> element_count_of_shard(number_of_shards);
+    vector<uint64_t> size_in_bytes_of_shard(number_of_shards);
+    uint64_t total_element_count = 0, total_size_in_bytes = 0;
+    for (uint32_t i = 0; i < number_of_shards; ++i)
+    {
+        Shard& shard = this->shards_.GetShardByIndex(i);
+        lock_guard<mutex> lck(shard.mutex);
+        element_count_of_shard[i] = ShardedSubBlockCache::GetElementCount(shard);
+        size_in_bytes_of_shard[i] = ShardedSubBlockCache::GetSizeInBytes(shard);
+        total_element_count += element_count_of_shard[i];
+        total_size_in_bytes += size_in_bytes_of_shard[i];
+    }
+
+    if (total_element_count <= options.maxSubBlockCount && total_size_in_bytes <= options.maxMemoryUsage)
+    {
+        return;
+    }
+
+    // every shard gets a share of the limits proportional to its current size - for the element count, the shares are
+    //  rounded with the "largest remainder method", so that they add up to the limit
+    vector<uint32_t> capacity_in_elements(number_of_shards, numeric_limits<uint32_t>::max());
+    vector<uint64_t> capacity_in_bytes(number_of_shards, numeric_limits<uint64_t>::max());
+    if (options.maxSubBlockCount != numeric_limits<decltype(options.maxSubBlockCount)>::max() && total_element_count > 0)
+    {
+        vector<pair<double, uint32_t>> remainders;
+        remainders.reserve(number_of_shards);
+        uint64_t sum_of_capacities = 0;
+        for (uint32_t i = 0; i < number_of_shards; ++i)
+        {
+            const double exact_share = static_cast<double>(element_count_of_shard[i]) * options.maxSubBlockCount / static_cast<double>(total_element_count);
+            capacity_in_elements[i] = static_cast<uint32_t>(floor(exact_share));
+            sum_of_capacities += capacity_in_elements[i];
+            remainders.emplace_back(exact_share - capacity_in_elements[i], i);
+        }
+
+        sort(remainders.begin(), remainders.end(), [](const pair<double, uint32_t>& a, const pair<double, uint32_t>& b) { return a.first > b.first; });
+        for (size_t i = 0; i < remainders.size() && sum_of_capacities < options.maxSubBlockCount; ++i, ++sum_of_capacities)
+        {
+            ++capacity_in_elements[remainders[i].second];
+        }
+    }
+
+    if (options.maxMemoryUsage != numeric_limits<decltype(options.maxMemoryUsage)>::max() && total_size_in_bytes > 0)
+    {
+        for (uint32_t i = 0; i < number_of_shards; ++i)
+        {
+            capacity_in_bytes[i] = static_cast<uint64_t>(static_cast<long double>(size_in_bytes_of_shard[i]) * options.maxMemoryUsage / total_size_in_bytes);
+        }
+    }
+
+    for (uint32_t i = 0; i < number_of_shards; ++i)
+    {
+        // the evicted bitmaps are released after the lock is dropped
+        vector<shared_ptr<IBitmapData>> evicted_bitmaps;
+        Shard& shard = this->shards_.GetShardByIndex(i);
+        lock_guard<mutex> lck(shard.mutex);
+        shard.capacity_in_elements = capacity_in_elements[i];
+        shard.capacity_in_bytes = capacity_in_bytes[i];
+        shard.frequency_sketch.EnsureCapacity(min(capacity_in_elements[i], static_cast<uint32_t>(shard.entries.size())));
+        this->DrainWindowWTinyLfu(shard, evicted_bitmaps);
+        while (ShardedSubBlockCache::GetElementCount(shard) > shard.capacity_in_elements ||
+            ShardedSubBlockCache::GetSizeInBytes(shard) > shard.capacity_in_bytes)
+        {
+            if (!this->EvictWTinyLfu(shard, evicted_bitmaps))
+            {
+                break;
+            }
+        }
+    }
+}
+
+void ShardedSubBlockCache::DrainWindowWTinyLfu(Shard& shard, std::vector<std::shared_ptr<libCZI::IBitmapData>>& evicted_bitmaps)
+{
+    // the elements exceeding the share of the window are moved to the main part of the cache - if the main part is full, then
+    //  the element leaving the window competes with the element which would be evicted from the main part, and the loser is evicted
+    while (ShardedSubBlockCache::IsSegmentOverCapacity(shard, kWindow, kWindowPercentage))
+    {
+        CacheEntry* candidate = shard.segments[kWindow].least_recently_used;
+        ShardedSubBlockCache::Unlink(shard, candidate);
+        if (!ShardedSubBlockCache::IsMainOverCapacity(shard, candidate->size_in_bytes))
+        {
+            ShardedSubBlockCache::LinkAsMostRecentlyUsed(shard, candidate, kProbation);
+            continue;
+        }
+
+        CacheEntry* victim = shard.segments[kProbation].least_recently_used;
+        if (victim == nullptr)
+        {
+            victim = shard.segments[kProtected].least_recently_used;
+        }
+
+        if (victim != nullptr && ShardedSubBlockCache::IsWinningAgainst(shard, candidate, victim))
+        {
+            ShardedSubBlockCache::LinkAsMostRecentlyUsed(shard, candidate, kProbation);
+            this->RemoveEntry(shard, victim, evicted_bitmaps);
+        }
+        else
+        {
+            ShardedSubBlockCache::LinkAsMostRecentlyUsed(shard, candidate, kWindow);
+            this->RemoveEntry(shard, candidate, evicted_bitmaps);
+        }
+    }
+}
+
+bool ShardedSubBlockCache::EvictWTinyLfu(Shard& shard, std::vector<std::shared_ptr<libCZI::IBitmapData>>& evicted_bitmaps)
+{
+    // we evict either the least recently used element of the window or the one of the main part of the cache, whichever
+    //  has the lower (cost-weighted) frequency
+    CacheEntry* candidate = shard.segments[kWindow].least_recently_used;
+    CacheEntry* victim = shard.segments[kProbation].least_recently_used;
+    if (victim == nullptr)
+    {
+        victim = shard.segments[kProtected].least_recently_used;
+    }
+
+    if (candidate != nullptr && victim != nullptr)
+    {
+        this->RemoveEntry(shard, ShardedSubBlockCache::IsWinningAgainst(shard, candidate, victim) ? victim : candidate, evicted_bitmaps);
+        return true;
+    }
+
+    if (victim == nullptr)
+    {
+        victim = candidate;
+    }
+
+    if (victim == nullptr)
+    {
+        return false;
+    }
+
+    this->RemoveEntry(shard, victim, evicted_bitmaps);
+    return true;
+}
+
+void ShardedSubBlockCache::RemoveEntry(Shard& shard, CacheEntry* entry, std::vector<std::shared_ptr<libCZI::IBitmapData>>& evicted_bitmaps)
+{
+    ShardedSubBlockCache::Unlink(shard, entry);
+    this->cache_size_in_bytes_ -= entry->size_in_bytes;
+    --this->cache_subblock_count_;
+    evicted_bitmaps.push_back(std::move(entry->bitmap));
+    shard.entries.erase(entry->subblock_index);
+}
+
+/*static*/void ShardedSubBlockCache::OnAccessWTinyLfu(Shard& shard, CacheEntry* entry)
+{
+    const Segment segment = entry->segment;
+    ShardedSubBlockCache::Unlink(shard, entry);
+    if (segment != kProbation)
+    {
+        ShardedSubBlockCache::LinkAsMostRecentlyUsed(shard, entry, segment);
+        return;
+    }
+
+    // an element of the probation segment which is accessed again is promoted to the protected segment, and the least
+    //  recently used elements of the protected segment are demoted if it exceeds its share
+    ShardedSubBlockCache::LinkAsMostRecentlyUsed(shard, entry, kProtected);
+    while (shard.segments[kProtected].count > 1 && ShardedSubBlockCache::IsSegmentOverCapacity(shard, kProtected, kProtectedPercentage))
+    {
+        CacheEntry* demoted_entry = shard.segments[kProtected].least_recently_used;
+        ShardedSubBlockCache::Unlink(shard, demoted_entry);
+        ShardedSubBlockCache::LinkAsMostRecentlyUsed(shard, demoted_entry, kProbation);
+    }
+}
+
+/*static*/bool ShardedSubBlockCache::IsSegmentOverCapacity(const Shard& shard, Segment segment, std::uint32_t percentage)
+{
+    const LruList& list = shard.segments[segment];
+    if (shard.capacity_in_elements != numeric_limits<uint32_t>::max() &&
+        list.count > max(static_cast<uint64_t>(1), static_cast<uint64_t>(shard.capacity_in_elements) * percentage / 100))
+    {
+        return true;
+    }
+
+    if (shard.capacity_in_bytes != numeric_limits<uint64_t>::max() &&
+        list.size_in_bytes > shard.capacity_in_bytes / 100 * percentage)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+/*static*/bool ShardedSubBlockCache::IsWinningAgainst(const Shard& shard, const CacheEntry* candidate, const CacheEntry* victim)
+{
+    // the value of an element (per byte of memory it occupies) is its frequency multiplied with the cost of re-creating it (per byte) - in
+    //  case of a tie, the victim stays in the cache
+    const uint64_t value_of_candidate = static_cast<uint64_t>(shard.frequency_sketch.GetFrequency(candidate->subblock_index)) * candidate->decode_cost_weight;
+    const uint64_t value_of_victim = static_cast<uint64_t>(shard.frequency_sketch.GetFrequency(victim->subblock_index)) * victim->decode_cost_weight;
+    return value_of_candidate > value_of_victim;
+}
+
+/*static*/bool ShardedSubBlockCache::IsMainOverCapacity(const Shard& shard, std::uint64_t size_in_bytes_to_be_added)
+{
+    // the main part of the cache (i.e. the probation and the protected segment) gets what is left over by the window
+    const uint64_t count = static_cast<uint64_t>(shard.segments[kProbation].count) + shard.segments[kProtected].count + 1;
+    if (shard.capacity_in_elements != numeric_limits<uint32_t>::max() &&
+        count > shard.capacity_in_elements - min(static_cast<uint64_t>(shard.capacity_in_elements), max(static_cast<uint64_t>(1), static_cast<uint64_t>(shard.capacity_in_elements) * kWindowPercentage / 100)))
+    {
+        return true;
+    }
+
+    const uint64_t size_in_bytes = shard.segments[kProbation].size_in_bytes + shard.segments[kProtected].size_in_bytes + size_in_bytes_to_be_added;
+    if (shard.capacity_in_bytes != numeric_limits<uint64_t>::max() &&
+        size_in_bytes > shard.capacity_in_bytes - shard.capacity_in_bytes / 100 * kWindowPercentage)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+/*static*/std::uint32_t ShardedSubBlockCache::GetElementCount(const Shard& shard)
+{
+    return shard.segments[kWindow].count + shard.segments[kProbation].count + shard.segments[kProtected].count;
+}
+
+/*static*/std::uint64_t ShardedSubBlockCache::GetSizeInBytes(const Shard& shard)
+{
+    return shard.segments[kWindow].size_in_bytes + shard.segments[kProbation].size_in_bytes + shard.segments[kProtected].size_in_bytes;
+}
+
+/*static*/void ShardedSubBlockCache::Unlink(Shard& shard, CacheEntry* entry)
+{
+    LruList& list = shard.segments[entry->segment];
+    if (entry->previous != nullptr)
+    {
+        entry->previous->next = entry->next;
+    }
+    else
+    {
+        list.most_recently_used = entry->next;
+    }
+
+    if (entry->next != nullptr)
+    {
+        entry->next->previous = entry->previous;
+    }
+    else
+    {
+        list.least_recently_used = entry->previous;
+    }
+
+    entry->previous = entry->next = nullptr;
+    list.size_in_bytes -= entry->size_in_bytes;
+    --list.count;
+}
+
+/*static*/void ShardedSubBlockCache::LinkAsMostRecentlyUsed(Shard& shard, CacheEntry* entry, Segment segment)
+{
+    LruList& list = shard.segments[segment];
+    entry->segment = segment;
+    entry->previous = nullptr;
+    entry->next = list.most_recently_used;
+    if (list.most_recently_used != nullptr)
+    {
+        list.most_recently_used->previous = entry;
+    }
+    else
+    {
+        list.least_recently_used = entry;
+    }
+
+    list.most_recently_used = entry;
+    list.size_in_bytes += entry->size_in_bytes;
+    ++list.count;
+}
+
+/*static*/void ShardedSubBlockCache::PublishLruValueOfLeastRecentlyUsed(Shard& shard)
+{
+    ShardedLru<ShardData>::PublishLruValueOfLeastRecentlyUsed(shard, shard.segments[kWindow].least_recently_used);
+}
@@ -0,0 +1,106 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "libCZI.h"
+#include "frequency_sketch.h"
+#include "sharded_lru.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/// A sub-block cache implementation where the elements are distributed over a number of shards (based on a hash of the
+/// sub-block index). Every shard has its own lock, a hash-map and intrusive doubly-linked lists which keep the elements
+/// in LRU-order, so that adding, retrieving and evicting an element is done in constant time.
+/// Two eviction policies are implemented:
+/// - LRU: Pruning evicts the least recently used element of all shards (c.f. ShardedLru).
+/// - W-TinyLFU: Every shard is divided into three segments - the "window", "probation" and "protected". New elements are put into the
+///   window. When pruning, the elements exceeding the share of the window are moved to the probation segment - if the main part (probation
+///   and protected) is full, then the element leaving the window competes with the least recently used element of the probation segment,
+///   and the one with the lower (cost-weighted) frequency is evicted. An element in the probation segment which is accessed again is promoted
+///   to the protected segment (and the least recently used element of the protected segment is demoted to the probation segment if the
+///   protected segment exceeds its share). The frequencies are estimated with a frequency sketch (one for each shard). When pruning,
+///   each shard is pruned to its share of the limits (proportional to its current size).
+class ShardedSubBlockCache : public libCZI::ISubBlockCache
+{
+private:
+    static constexpr std::uint32_t kDefaultNumberOfShards = 16;
+    static constexpr std::uint32_t kMaxNumberOfShards = 1024;
+    static constexpr std::uint32_t kWindowPercentage = 1;       ///< The share of the window segment (of the capacity of a shard) in percent.
+    static constexpr std::uint32_t kProtectedPercentage = 80;   ///< The share of the protected segment (of the capacity of a shard) in percent.
+
+    enum Segment : std::uint8_t
+    {
+        kWindow = 0,    ///< With the LRU policy, all elements are in this segment.
+        kProbation = 1,
+        kProtected = 2,
+        kNumberOfSegments = 3
+    };
+
+    struct CacheEntry
+    {
+        std::shared_ptr<libCZI::IBitmapData> bitmap;    ///< The cached bitmap.
+        std::uint64_t size_in_bytes;                    ///< The size of the bitmap in bytes (as accounted for in the cache).
+        std::uint64_t lru_value;                        ///< The "LRU value" - when marking a cache entry as "used", this value is set to the current value of the "LRU counter".
+        std::uint32_t decode_cost_weight;               ///< The relative cost (per byte) of re-creating the bitmap.
+        int subblock_index;                             ///< The key of the entry.
+        Segment segment;                                ///< The segment which the entry belongs to.
+        CacheEntry* previous;                           ///< The previous (more recently used) entry in the LRU-list of the segment.
+        CacheEntry* next;                               ///< The next (less recently used) entry in the LRU-list of the segment.
+    };
+
+    struct LruList
+    {
+        CacheEntry* most_recently_used{ nullptr };      ///< The head of the LRU-list.
+        CacheEntry* least_recently_used{ nullptr };     ///< The tail of the LRU-list.
+        std::uint64_t size_in_bytes{ 0 };               ///< The accumulated size of the elements in the list.
+        std::uint32_t count{ 0 };                       ///< The number of elements in the list.
+    };
+
+    struct ShardData
+    {
+        std::unordered_map<int, CacheEntry> entries;    ///< The entries (note that references to the elements of an unordered_map remain valid when rehashing).
+        LruList segments[kNumberOfSegments];
+
+        FrequencySketch frequency_sketch;                   ///< The frequency sketch (only used with the W-TinyLFU policy).
+        std::uint64_t capacity_in_bytes{ UINT64_MAX };      ///< The share of the memory limit of the last prune operation (only used with the W-TinyLFU policy).
+        std::uint32_t capacity_in_elements{ UINT32_MAX };   ///< The share of the element count limit of the last prune operation (only used with the W-TinyLFU policy).
+    };
+
+    typedef ShardedLru<ShardData>::Shard Shard;
+
+    ShardedLru<ShardData> shards_;
+    libCZI::SubBlockCacheOptions::EvictionPolicy eviction_policy_;
+    std::atomic_uint64_t cache_size_in_bytes_{ 0 };     ///< The current size of the cache in bytes (only modified while holding the lock of a shard).
+    std::atomic_uint32_t cache_subblock_count_{ 0 };    ///< The current number of sub-blocks in the cache (only modified while holding the lock of a shard).
+    std::atomic_uint64_t hit_count_{ 0 };               ///< The number of Get-operations which found the element in the cache (only modified while holding the lock of a shard).
+    std::atomic_uint64_t miss_count_{ 0 };              ///< The number of Get-operations which did not find the element in the cache (only modified while holding the lock of a shard).
+public:
+    ShardedSubBlockCache(std::uint32_t number_of_shards, libCZI::SubBlockCacheOptions::EvictionPolicy eviction_policy);
+    ~ShardedSubBlockCache() override = default;
+
+    std::shared_ptr<libCZI::IBitmapData> Get(int subblock_index) override;
+    void Add(int subblock_index, std::shared_ptr<libCZI::IBitmapData> bitmap) override;
+    void AddWithDecodeCost(int subblock_index, std::shared_ptr<libCZI::IBitmapData> bitmap, std::uint32_t decode_cost_weight) override;
+    void Prune(const PruneOptions& options) override;
+    Statistics GetStatistics(std::uint8_t mask) const override;
+private:
+    bool EvictLeastRecentlyUsedElement();
+    void PruneWTinyLfu(const PruneOptions& options);
+    void RemoveEntry(Shard& shard, CacheEntry* entry, std::vector<std::shared_ptr<libCZI::IBitmapData>>& evicted_bitmaps);
+    void DrainWindowWTinyLfu(Shard& shard, std::vector<std::shared_ptr<libCZI::IBitmapData>>& evicted_bitmaps);
+    bool EvictWTinyLfu(Shard& shard, std::vector<std::shared_ptr<libCZI::IBitmapData>>& evicted_bitmaps);
+    static void OnAccessWTinyLfu(Shard& shard, CacheEntry* entry);
+    static bool IsSegmentOverCapacity(const Shard& shard, Segment segment, std::uint32_t percentage);
+    static bool IsMainOverCapacity(const Shard& shard, std::uint64_t size_in_bytes_to_be_added);
+    static std::uint32_t GetElementCount(const Shard& shard);
+    static std::uint64_t GetSizeInBytes(const Shard& shard);
+    static bool IsWinningAgainst(const Shard& shard, const CacheEntry* candidate, const CacheEntry* victim);
+    static void Unlink(Shard& shard, CacheEntry* entry);
+    static void LinkAsMostRecentlyUsed(Shard& shard, CacheEntry* entry, Segment segment);
+    static void PublishLruValueOfLeastRecentlyUsed(Shard& shard);
+};
@@ -0,0 +1,128 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "subblock_allocator.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace libCZI;
+using namespace std;
+
+std::shared_ptr<ISubBlockAllocator> libCZI::CreatePooledSubBlockAllocator(std::uint64_t max_pooled_memory_size)
+{
+    return make_shared<PooledSubBlockAllocator>(max_pooled_memory_size);
+}
+
+PooledSubBlockAllocator::PooledSubBlockAllocator(std::uint64_t max_pooled_memory_size)
+    : max_pooled_memory_size_(max_pooled_memory_size)
+{
+}
+
+PooledSubBlockAllocator::~PooledSubBlockAllocator()
+{
+    for (auto& free_list : this->free_lists_)
+    {
+        for (void* block : free_list.blocks)
+        {
+            free(block);
+        }
+    }
+}
+
+/*virtual*/void* PooledSubBlockAllocator::Allocate(std::size_t size)
+{
+    if (size > kMaxPooledBlockSize)
+    {
+        return PooledSubBlockAllocator::AllocateFromHeap(size, kNotPooled);
+    }
+
+    const uint32_t size_class = PooledSubBlockAllocator::GetSizeClass(size);
+    FreeList& free_list = this->free_lists_[size_class];
+    void* block = nullptr;
+
+    {
+        lock_guard<mutex> lck(free_list.mutex);
+        if (!free_list.blocks.empty())
+        {
+            block = free_list.blocks.back();
+            free_list.blocks.pop_back();
+        }
+    }
+
+    if (block == nullptr)
+    {
+        return PooledSubBlockAllocator::AllocateFromHeap(PooledSubBlockAllocator::GetSizeOfSizeClass(size_class), size_class);
+    }
+
+    this->pooled_memory_size_ -= PooledSubBlockAllocator::GetSizeOfSizeClass(size_class);
+    return static_cast<uint8_t*>(block) + kHeaderSize;
+}
+
+/*virtual*/void PooledSubBlockAllocator::Free(void* ptr)
+{
+    void* block = static_cast<uint8_t*>(ptr) - kHeaderSize;
+    uint32_t size_class;
+    memcpy(&size_class, block, sizeof(size_class));
+    if (size_class != kNotPooled)
+    {
+        // we reserve the budget first, and only if this succeeds we put the block into the free-list
+        const size_t size_of_block = PooledSubBlockAllocator::GetSizeOfSizeClass(size_class);
+        if (this->pooled_memory_size_.fetch_add(size_of_block) + size_of_block <= this->max_pooled_memory_size_)
+        {
+            FreeList& free_list = this->free_lists_[size_class];
+            lock_guard<mutex> lck(free_list.mutex);
+            free_list.blocks.push_back(block);
+            return;
+        }
+
+        this->pooled_memory_size_ -= size_of_block;
+    }
+
+    free(block);
+}
+
+/*static*/std::uint32_t PooledSubBlockAllocator::GetSizeClass(std::size_t size)
+{
+    if (size <= kMinBlockSize)
+    {
+        return 0;
+    }
+
+    // determine p so that 2^p < size <= 2^(p+1), and then the sub-division of this interval
+    int p = 0;
+    for (size_t v = size - 1; v > 1; v >>= 1)
+    {
+        ++p;
+    }
+
+    const size_t base = static_cast<size_t>(1) << p;
+    const size_t step = base / kSizeClassesPerPowerOfTwo;
+    const size_t sub_class = (size - base + step - 1) / step;
+    return static_cast<uint32_t>((p - kLog2MinBlockSize) * kSizeClassesPerPowerOfTwo + sub_class);
+}
+
+/*static*/std::size_t PooledSubBlockAllocator::GetSizeOfSizeClass(std::uint32_t size_class)
+{
+    if (size_class == 0)
+    {
+        return kMinBlockSize;
+    }
+
+    const int p = kLog2MinBlockSize + static_cast<int>((size_class - 1) / kSizeClassesPerPowerOfTwo);
+    const size_t base = static_cast<size_t>(1) << p;
+    return base + ((size_class - 1) % kSizeClassesPerPowerOfTwo + 1) * (base / kSizeClassesPerPowerOfTwo);
+}
+
+/*static*/void* PooledSubBlockAllocator::AllocateFromHeap(std::size_t size, std::uint32_t size_class)
+{
+    void* block = malloc(size + kHeaderSize);
+    if (block == nullptr)
+    {
+        throw bad_alloc();
+    }
+
+    memcpy(block, &size_class, sizeof(size_class));
+    return static_cast<uint8_t*>(block) + kHeaderSize;
+}
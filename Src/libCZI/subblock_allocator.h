@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "libCZI.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/// An allocator which keeps freed memory blocks in free-lists (one for each size class) and hands them out again
+/// for subsequent allocations, so that in a steady state (e.g. when reading tiles of similar size over and over) the
+/// global heap is not involved. There are four size classes for each power of two (between kMinBlockSize and kMaxPooledBlockSize),
+/// so the overhead due to rounding up is at most 25%. Larger allocations are forwarded to the heap.
+/// Every memory block is preceded by a small header which records its size class.
+class PooledSubBlockAllocator : public libCZI::ISubBlockAllocator
+{
+private:
+    static constexpr std::size_t kMinBlockSize = 4096;
+    static constexpr int kLog2MinBlockSize = 12;
+    static constexpr int kLog2MaxPooledBlockSize = 28;
+    static constexpr std::size_t kMaxPooledBlockSize = static_cast<std::size_t>(1) << kLog2MaxPooledBlockSize;
+    static constexpr int kSizeClassesPerPowerOfTwo = 4;
+    static constexpr int kNumberOfSizeClasses = 1 + (kLog2MaxPooledBlockSize - kLog2MinBlockSize) * kSizeClassesPerPowerOfTwo;
+    static constexpr std::uint32_t kNotPooled = 0xffffffff;
+
+    /// The size of the header preceding each memory block - chosen so that the alignment of the memory returned by malloc is preserved.
+    static constexpr std::size_t kHeaderSize = alignof(std::max_align_t) > sizeof(std::uint32_t) ? alignof(std::max_align_t) : sizeof(std::uint32_t);
+
+    struct FreeList
+    {
+        std::mutex mutex;
+        std::vector<void*> blocks;  ///< The memory blocks in the free-list (pointing to the header).
+    };
+
+    std::uint64_t max_pooled_memory_size_;
+    std::atomic<std::uint64_t> pooled_memory_size_{ 0 };    ///< The total size of the memory blocks currently held in the free-lists.
+    std::array<FreeList, kNumberOfSizeClasses> free_lists_;
+public:
+    explicit PooledSubBlockAllocator(std::uint64_t max_pooled_memory_size);
+    ~PooledSubBlockAllocator() override;
+
+    PooledSubBlockAllocator(const PooledSubBlockAllocator&) = delete;
+    PooledSubBlockAllocator& operator=(const PooledSubBlockAllocator&) = delete;
+
+    void* Allocate(std::size_t size) override;
+    void Free(void* ptr) override;
+
+private:
+    static std::uint32_t GetSizeClass(std::size_t size);
+    static std::size_t GetSizeOfSizeClass(std::uint32_t size_class);
+    static void* AllocateFromHeap(std::size_t size, std::uint32_t size_class);
+};
@@ -3,36 +3,69 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include "subblock_cache.h"
+#include "sharded_subblock_cache.h"
+#include "two_tier_subblock_cache.h"
+#include <stdexcept>
 
 using namespace libCZI;
 using namespace std;
 
-std::shared_ptr<ISubBlockCache> libCZI::CreateSubBlockCache()
+std::shared_ptr<ISubBlockCache> libCZI::CreateSubBlockCache(const SubBlockCacheOptions* options)
 {
-    return make_shared<SubBlockCache>();
+    shared_ptr<ISubBlockCache> cache;
+    if (options != nullptr && options->type == SubBlockCacheOptions::Type::Sharded)
+    {
+        cache = make_shared<ShardedSubBlockCache>(options->number_of_shards, options->eviction_policy);
+    }
+    else
+    {
+        if (options != nullptr && options->eviction_policy != SubBlockCacheOptions::EvictionPolicy::Lru)
+        {
+            throw invalid_argument("The simple sub-block cache only supports the LRU eviction policy.");
+        }
+
+        cache = make_shared<SubBlockCache>();
+    }
+
+    if (options != nullptr && options->enable_compressed_tier)
+    {
+        // the cache object created above serves as the tier of decoded bitmaps
+        cache = make_shared<TwoTierSubBlockCache>(std::move(cache), options->number_of_shards);
+    }
+
+    return cache;
 }
 
 ISubBlockCacheStatistics::Statistics SubBlockCache::GetStatistics(std::uint8_t mask) const
 {
-    Statistics result{ 0 };
-    if (mask == ISubBlockCacheStatistics::kMemoryUsage)
+    Statistics result{};
+    result.validityMask = mask & (ISubBlockCacheStatistics::kMemoryUsage | ISubBlockCacheStatistics::kElementsCount | ISubBlockCacheStatistics::kHitCount | ISubBlockCacheStatistics::kMissCount);
+
+    // If more than one field is requested, we want to ensure that the values are consistent, therefore we need to lock reading them.
+    unique_lock<mutex> lck(this->mutex_, defer_lock);
+    if ((result.validityMask & (result.validityMask - 1)) != 0)
+    {
+        lck.lock();
+    }
+
+    if ((result.validityMask & ISubBlockCacheStatistics::kMemoryUsage) != 0)
     {
-        result.validityMask = ISubBlockCacheStatistics::kMemoryUsage;
         result.memoryUsage = this->cache_size_in_bytes_.load();
     }
-    else if (mask == ISubBlockCacheStatistics::kElementsCount)
+
+    if ((result.validityMask & ISubBlockCacheStatistics::kElementsCount) != 0)
     {
-        result.validityMask = ISubBlockCacheStatistics::kElementsCount;
         result.elementsCount = this->cache_subblock_count_.load();
     }
-    else if (mask == (ISubBlockCacheStatistics::kMemoryUsage | ISubBlockCacheStatistics::kElementsCount))
+
+    if ((result.validityMask & ISubBlockCacheStatistics::kHitCount) != 0)
     {
-        result.validityMask = ISubBlockCacheStatistics::kMemoryUsage | ISubBlockCacheStatistics::kElementsCount;
+        result.hitCount = this->hit_count_.load();
+    }
 
-        // We want to ensure that the memory usage and the element count are consistent, therefore we need to lock reading both values.
-        lock_guard<mutex> lck(this->mutex_);
-        result.memoryUsage = this->cache_size_in_bytes_.load();
-        result.elementsCount = this->cache_subblock_count_.load();
+    if ((result.validityMask & ISubBlockCacheStatistics::kMissCount) != 0)
+    {
+        result.missCount = this->miss_count_.load();
     }
 
     return result;
@@ -45,9 +78,11 @@ std::shared_ptr<IBitmapData> SubBlockCache::Get(int subblock_index)
     if (element != this->cache_.end())
     {
         element->second.lru_value = this->lru_counter_.fetch_add(1);
+        ++this->hit_count_;
         return element->second.bitmap;
     }
 
+    ++this->miss_count_;
     return {};
 }
 
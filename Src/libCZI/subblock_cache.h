@@ -25,6 +25,8 @@ private:
     std::atomic_uint64_t lru_counter_{ 0 }; ///< The "LRU counter" - when marking a cache entry as "used", this counter is incremented and the new value is stored in the cache entry.
     std::atomic_uint64_t cache_size_in_bytes_{ 0 }; ////< The current size of the cache in bytes.
     std::atomic_uint32_t cache_subblock_count_{ 0 }; ///< The current number of sub-blocks in the cache.
+    std::atomic_uint64_t hit_count_{ 0 };   ///< The number of Get-operations which found the element in the cache.
+    std::atomic_uint64_t miss_count_{ 0 };  ///< The number of Get-operations which did not find the element in the cache.
 public:
     SubBlockCache() = default;
     ~SubBlockCache() override = default;
@@ -33,8 +35,14 @@ public:
     void Add(int subblock_index, std::shared_ptr<libCZI::IBitmapData> bitmap) override;
     void Prune(const PruneOptions& options) override;
     Statistics GetStatistics(std::uint8_t mask) const override;
+
+    /// Calculates the size (in bytes) which is accounted for the specified bitmap in the cache.
+    ///
+    /// \param  bitmap  The bitmap.
+    ///
+    /// \returns    The size in bytes.
+    static std::uint64_t CalculateSizeInBytes(const libCZI::IBitmapData* bitmap);
 private:
     void PruneByMemoryUsageAndElementCount(std::uint64_t max_memory_usage, std::uint32_t max_element_count);
-    static std::uint64_t CalculateSizeInBytes(const libCZI::IBitmapData* bitmap);
     static bool CompareForLruValue(const std::pair<int, CacheEntry>& a, const std::pair<int, CacheEntry>& b);
 };
@@ -0,0 +1,207 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "task_executor.h"
+#include <cassert>
+#include <system_error>
+
+using namespace libCZI;
+using namespace std;
+
+std::shared_ptr<ITaskExecutor> libCZI::CreateWorkStealingTaskExecutor(int number_of_threads)
+{
+    return make_shared<WorkStealingTaskExecutor>(number_of_threads);
+}
+
+std::shared_ptr<ITaskExecutor> libCZI::GetDefaultTaskExecutor()
+{
+    // The default executor is intentionally never destroyed - its worker threads may still be waiting for tasks
+    //  when static objects are destroyed (and joining threads at this point is not allowed on all platforms).
+    static const auto* default_executor = new std::shared_ptr<ITaskExecutor>(make_shared<WorkStealingTaskExecutor>(0));
+    return *default_executor;
+}
+
+//----------------------------------------------------------------------------------------
+
+/*static*/constexpr int WorkStealingTaskExecutor::kNumberOfPriorities;
+/*static*/thread_local WorkStealingTaskExecutor::CurrentWorker WorkStealingTaskExecutor::current_worker_{ nullptr, 0 };
+
+WorkStealingTaskExecutor::WorkStealingTaskExecutor(int number_of_threads)
+    : state_(make_shared<SharedState>())
+{
+    if (number_of_threads < 1)
+    {
+        number_of_threads = (std::max)(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    }
+
+    for (int i = 0; i < number_of_threads; ++i)
+    {
+        this->state_->worker_queues.emplace_back(new TaskQueues());
+    }
+
+    this->workers_.reserve(number_of_threads);
+    for (int i = 0; i < number_of_threads; ++i)
+    {
+        try
+        {
+            this->workers_.emplace_back(&WorkStealingTaskExecutor::WorkerFunction, this->state_, static_cast<size_t>(i));
+        }
+        catch (const std::system_error&)
+        {
+            // if no more threads can be created, we go on with the ones we have
+            if (this->workers_.empty())
+            {
+                throw;
+            }
+
+            break;
+        }
+    }
+}
+
+WorkStealingTaskExecutor::~WorkStealingTaskExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->state_->idle_mutex);
+        this->state_->shutdown = true;
+    }
+
+    this->state_->idle_condition.notify_all();
+    for (auto& worker : this->workers_)
+    {
+        if (worker.get_id() == std::this_thread::get_id())
+        {
+            // the last reference to the executor was released by one of its own tasks - this worker cannot join itself, it
+            //  finishes on its own (it holds a reference to the shared state)
+            worker.detach();
+        }
+        else
+        {
+            worker.join();
+        }
+    }
+}
+
+void WorkStealingTaskExecutor::Submit(libCZI::TaskPriority priority, std::function<void()> task)
+{
+    SharedState& state = *this->state_;
+    const int priority_index = (std::min)(static_cast<int>(priority), kNumberOfPriorities - 1);
+    TaskQueues& task_queues = current_worker_.state == &state ? *state.worker_queues[current_worker_.index] : state.shared_queues;
+
+    // the task is counted before it is put into a queue - so the counter is never less than the number of tasks in the
+    //  queues, and since a worker decrements it only after having taken a task, it cannot wrap around
+    {
+        std::lock_guard<std::mutex> lock(state.idle_mutex);
+        ++state.number_of_pending_tasks;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(task_queues.mutex);
+        task_queues.queues[priority_index].emplace_back(std::move(task));
+    }
+
+    state.idle_condition.notify_one();
+}
+
+int WorkStealingTaskExecutor::GetMaxConcurrency()
+{
+    return static_cast<int>(this->workers_.size());
+}
+
+/*static*/void WorkStealingTaskExecutor::WorkerFunction(const std::shared_ptr<SharedState>& state, size_t index)
+{
+    current_worker_ = CurrentWorker{ state.get(), index };
+    for (;;)
+    {
+        std::function<void()> task;
+        if (TryTakeTask(*state, index, task))
+        {
+            {
+                std::lock_guard<std::mutex> lock(state->idle_mutex);
+                assert(state->number_of_pending_tasks > 0);
+                --state->number_of_pending_tasks;
+            }
+
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                // there is no one to report an exception to, and it must not terminate the worker
+            }
+
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(state->idle_mutex);
+        if (state->number_of_pending_tasks == 0)
+        {
+            if (state->shutdown)
+            {
+                return;
+            }
+
+            state->idle_condition.wait(lock, [&]()->bool {return state->number_of_pending_tasks > 0 || state->shutdown; });
+        }
+        else
+        {
+            // a task was counted but not yet put into its queue, or it was taken by another worker which did not yet
+            //  decrement the counter - in any case, this state is short-lived
+            lock.unlock();
+            std::this_thread::yield();
+        }
+    }
+}
+
+/*static*/bool WorkStealingTaskExecutor::TryTakeTask(SharedState& state, size_t index, std::function<void()>& task)
+{
+    const size_t number_of_workers = state.worker_queues.size();
+    for (int priority = 0; priority < kNumberOfPriorities; ++priority)
+    {
+        if (TryPopBack(*state.worker_queues[index], priority, task) ||
+            TryPopFront(state.shared_queues, priority, task))
+        {
+            return true;
+        }
+
+        for (size_t i = 1; i < number_of_workers; ++i)
+        {
+            if (TryPopFront(*state.worker_queues[(index + i) % number_of_workers], priority, task))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/*static*/bool WorkStealingTaskExecutor::TryPopBack(TaskQueues& task_queues, int priority, std::function<void()>& task)
+{
+    std::lock_guard<std::mutex> lock(task_queues.mutex);
+    auto& queue = task_queues.queues[priority];
+    if (queue.empty())
+    {
+        return false;
+    }
+
+    task = std::move(queue.back());
+    queue.pop_back();
+    return true;
+}
+
+/*static*/bool WorkStealingTaskExecutor::TryPopFront(TaskQueues& task_queues, int priority, std::function<void()>& task)
+{
+    std::lock_guard<std::mutex> lock(task_queues.mutex);
+    auto& queue = task_queues.queues[priority];
+    if (queue.empty())
+    {
+        return false;
+    }
+
+    task = std::move(queue.front());
+    queue.pop_front();
+    return true;
+}
@@ -0,0 +1,78 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "libCZI.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// A task executor with a fixed number of worker threads and work-stealing. Each worker owns a set of queues (one for each
+/// priority). Tasks submitted from a worker thread are put into the queues of this worker, and the worker takes them in LIFO order
+/// (which gives good locality for nested work). Tasks submitted from any other thread are put into a set of queues shared by all
+/// workers (in FIFO order). An idle worker looks for a task in the following order - for each priority (starting with the highest
+/// one): its own queue, the shared queue, the queues of the other workers (stealing the oldest task there). So a pending task with a
+/// higher priority is always started before a task with a lower priority.
+class WorkStealingTaskExecutor : public libCZI::ITaskExecutor
+{
+private:
+    static constexpr int kNumberOfPriorities = 3;
+
+    struct TaskQueues
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> queues[kNumberOfPriorities];
+    };
+
+    /// The state shared by the executor-object and the workers. The workers hold a reference to it, so that the executor-object
+    /// can be destroyed from within one of its own tasks (in which case this worker finishes after the object is gone).
+    struct SharedState
+    {
+        std::vector<std::unique_ptr<TaskQueues>> worker_queues;     ///< The queues owned by the workers (one entry for each worker).
+        TaskQueues shared_queues;                                   ///< The queues for tasks submitted from outside the executor.
+
+        std::mutex idle_mutex;
+        std::condition_variable idle_condition;
+        size_t number_of_pending_tasks{ 0 };    ///< The number of tasks in all queues (protected by idle_mutex).
+        bool shutdown{ false };                 ///< Whether the executor is being shut down (protected by idle_mutex).
+    };
+
+    std::shared_ptr<SharedState> state_;
+    std::vector<std::thread> workers_;
+
+    /// Information about the worker the current thread belongs to (if any).
+    struct CurrentWorker
+    {
+        const SharedState* state;
+        size_t index;
+    };
+
+    static thread_local CurrentWorker current_worker_;
+public:
+    /// Constructor - the worker threads are started immediately.
+    ///
+    /// \param  number_of_threads   The number of worker threads. If less than 1, then the number of hardware threads is used.
+    explicit WorkStealingTaskExecutor(int number_of_threads);
+
+    /// Destructor. Pending tasks are executed before the workers are stopped.
+    ~WorkStealingTaskExecutor() override;
+
+    WorkStealingTaskExecutor(const WorkStealingTaskExecutor&) = delete;
+    WorkStealingTaskExecutor& operator=(const WorkStealingTaskExecutor&) = delete;
+
+    void Submit(libCZI::TaskPriority priority, std::function<void()> task) override;
+    int GetMaxConcurrency() override;
+private:
+    static void WorkerFunction(const std::shared_ptr<SharedState>& state, size_t index);
+    static bool TryTakeTask(SharedState& state, size_t index, std::function<void()>& task);
+    static bool TryPopBack(TaskQueues& task_queues, int priority, std::function<void()>& task);
+    static bool TryPopFront(TaskQueues& task_queues, int priority, std::function<void()>& task);
+};
@@ -0,0 +1,197 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "two_tier_subblock_cache.h"
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+using namespace libCZI;
+using namespace std;
+
+/*static*/constexpr std::uint32_t TwoTierSubBlockCache::kDefaultNumberOfShards;
+/*static*/constexpr std::uint32_t TwoTierSubBlockCache::kMaxNumberOfShards;
+
+TwoTierSubBlockCache::TwoTierSubBlockCache(std::shared_ptr<libCZI::ISubBlockCache> decoded_tier, std::uint32_t number_of_shards)
+    : decoded_tier_(std::move(decoded_tier)),
+    shards_(number_of_shards, TwoTierSubBlockCache::kDefaultNumberOfShards, TwoTierSubBlockCache::kMaxNumberOfShards)
+{
+    if (!this->decoded_tier_)
+    {
+        throw invalid_argument("The cache object for the decoded tier must not be null.");
+    }
+}
+
+ISubBlockCacheStatistics::Statistics TwoTierSubBlockCache::GetStatistics(std::uint8_t mask) const
+{
+    constexpr uint8_t kCompressedTierFields = ISubBlockCacheStatistics::kCompressedTierMemoryUsage | ISubBlockCacheStatistics::kCompressedTierElementsCount;
+    const uint8_t requested_fields = mask & (ISubBlockCacheStatistics::kMemoryUsage | ISubBlockCacheStatistics::kElementsCount | ISubBlockCacheStatistics::kHitCount | ISubBlockCacheStatistics::kMissCount | kCompressedTierFields);
+
+    // If more than one field is requested, we lock all shards of the compressed tier (always in the same order) while querying
+    //  the decoded tier, so that the values of both tiers are a consistent snapshot.
+    vector<unique_lock<mutex>> locks;
+    if ((requested_fields & kCompressedTierFields) != 0 && (requested_fields & (requested_fields - 1)) != 0)
+    {
+        this->shards_.LockAllShards(locks);
+    }
+
+    Statistics result{};
+    if ((requested_fields & ~kCompressedTierFields) != 0)
+    {
+        result = this->decoded_tier_->GetStatistics(requested_fields & ~kCompressedTierFields);
+    }
+
+    result.validityMask |= requested_fields & kCompressedTierFields;
+    if ((requested_fields & ISubBlockCacheStatistics::kCompressedTierMemoryUsage) != 0)
+    {
+        result.compressedTierMemoryUsage = this->compressed_tier_size_in_bytes_.load();
+    }
+
+    if ((requested_fields & ISubBlockCacheStatistics::kCompressedTierElementsCount) != 0)
+    {
+        result.compressedTierElementsCount = this->compressed_tier_subblock_count_.load();
+    }
+
+    return result;
+}
+
+std::shared_ptr<IBitmapData> TwoTierSubBlockCache::Get(int subblock_index)
+{
+    auto bitmap = this->decoded_tier_->Get(subblock_index);
+    if (bitmap)
+    {
+        // the sub-block is marked as used in the compressed tier as well, so that it is still available there when
+        //  the bitmap is evicted from the decoded tier
+        this->GetAndMarkAsUsed(subblock_index);
+    }
+
+    return bitmap;
+}
+
+void TwoTierSubBlockCache::Add(int subblock_index, std::shared_ptr<IBitmapData> bitmap)
+{
+    this->decoded_tier_->Add(subblock_index, std::move(bitmap));
+}
+
+void TwoTierSubBlockCache::AddWithDecodeCost(int subblock_index, std::shared_ptr<libCZI::IBitmapData> bitmap, std::uint32_t decode_cost_weight)
+{
+    this->decoded_tier_->AddWithDecodeCost(subblock_index, std::move(bitmap), decode_cost_weight);
+}
+
+std::shared_ptr<libCZI::ISubBlock> TwoTierSubBlockCache::GetSubBlock(int subblock_index)
+{
+    return this->GetAndMarkAsUsed(subblock_index);
+}
+
+void TwoTierSubBlockCache::AddSubBlock(int subblock_index, std::shared_ptr<libCZI::ISubBlock> subBlock)
+{
+    if (!subBlock)
+    {
+        throw invalid_argument("The sub-block must not be null.");
+    }
+
+    const uint64_t size_in_bytes = TwoTierSubBlockCache::CalculateSizeInBytes(subBlock.get());
+
+    // the sub-block which is replaced (if any) is released after the lock is dropped
+    shared_ptr<ISubBlock> replaced_subblock;
+
+    Shard& shard = this->shards_.GetShard(subblock_index);
+    lock_guard<mutex> lck(shard.mutex);
+    const auto element = shard.entries.find(subblock_index);
+    if (element != shard.entries.end())
+    {
+        // Element with the same key already existed
+        CompressedEntry& entry = *element->second;
+        this->compressed_tier_size_in_bytes_ -= entry.size_in_bytes;
+        this->compressed_tier_size_in_bytes_ += size_in_bytes;
+        replaced_subblock = std::move(entry.subblock);
+        entry.subblock = std::move(subBlock);
+        entry.size_in_bytes = size_in_bytes;
+        entry.lru_value = this->shards_.GetNextLruValue();
+        shard.lru_list.splice(shard.lru_list.begin(), shard.lru_list, element->second);
+    }
+    else
+    {
+        // New element inserted
+        shard.lru_list.push_front(CompressedEntry{ std::move(subBlock), size_in_bytes, this->shards_.GetNextLruValue(), subblock_index });
+        shard.entries[subblock_index] = shard.lru_list.begin();
+        this->compressed_tier_size_in_bytes_ += size_in_bytes;
+        ++this->compressed_tier_subblock_count_;
+    }
+
+    TwoTierSubBlockCache::PublishLruValueOfLeastRecentlyUsed(shard);
+}
+
+void TwoTierSubBlockCache::Prune(const PruneOptions& options)
+{
+    this->decoded_tier_->Prune(options);
+
+    if (options.maxMemoryUsageCompressedTier != numeric_limits<decltype(options.maxMemoryUsageCompressedTier)>::max() ||
+        options.maxSubBlockCountCompressedTier != numeric_limits<decltype(options.maxSubBlockCountCompressedTier)>::max())
+    {
+        while (this->compressed_tier_size_in_bytes_.load() > options.maxMemoryUsageCompressedTier ||
+            this->compressed_tier_subblock_count_.load() > options.maxSubBlockCountCompressedTier)
+        {
+            if (!this->EvictLeastRecentlyUsedSubBlock())
+            {
+                break;
+            }
+        }
+    }
+}
+
+/*static*/std::uint64_t TwoTierSubBlockCache::CalculateSizeInBytes(const libCZI::ISubBlock* subblock)
+{
+    uint64_t size_in_bytes = 0;
+    for (const auto type : { ISubBlock::MemBlkType::Data, ISubBlock::MemBlkType::Metadata, ISubBlock::MemBlkType::Attachment })
+    {
+        const void* ptr;
+        size_t size;
+        subblock->DangerousGetRawData(type, ptr, size);
+        size_in_bytes += size;
+    }
+
+    return size_in_bytes;
+}
+
+std::shared_ptr<libCZI::ISubBlock> TwoTierSubBlockCache::GetAndMarkAsUsed(int subblock_index)
+{
+    Shard& shard = this->shards_.GetShard(subblock_index);
+    lock_guard<mutex> lck(shard.mutex);
+    const auto element = shard.entries.find(subblock_index);
+    if (element == shard.entries.end())
+    {
+        return {};
+    }
+
+    element->second->lru_value = this->shards_.GetNextLruValue();
+    shard.lru_list.splice(shard.lru_list.begin(), shard.lru_list, element->second);
+    TwoTierSubBlockCache::PublishLruValueOfLeastRecentlyUsed(shard);
+    return element->second->subblock;
+}
+
+bool TwoTierSubBlockCache::EvictLeastRecentlyUsedSubBlock()
+{
+    // the evicted sub-block is released after the lock is dropped
+    shared_ptr<ISubBlock> evicted_subblock;
+    return this->shards_.EvictLeastRecentlyUsed(
+        [&](Shard& shard)->void
+        {
+            if (!shard.lru_list.empty())
+            {
+                CompressedEntry& entry = shard.lru_list.back();
+                evicted_subblock = std::move(entry.subblock);
+                this->compressed_tier_size_in_bytes_ -= entry.size_in_bytes;
+                --this->compressed_tier_subblock_count_;
+                shard.entries.erase(entry.subblock_index);
+                shard.lru_list.pop_back();
+                TwoTierSubBlockCache::PublishLruValueOfLeastRecentlyUsed(shard);
+            }
+        });
+}
+
+/*static*/void TwoTierSubBlockCache::PublishLruValueOfLeastRecentlyUsed(Shard& shard)
+{
+    ShardedLru<ShardData>::PublishLruValueOfLeastRecentlyUsed(shard, !shard.lru_list.empty() ? &shard.lru_list.back() : nullptr);
+}
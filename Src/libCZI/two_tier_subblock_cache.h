@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "libCZI.h"
+#include "sharded_lru.h"
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+/// A sub-block cache with two tiers: the tier of decoded bitmaps, which is an arbitrary sub-block cache object (all operations on
+/// bitmaps are passed on to it), and the "compressed tier", which holds the sub-blocks as read from the file (i.e. with their compressed
+/// payload). The compressed tier is sharded (c.f. ShardedLru), and every shard keeps its elements in LRU-order.
+/// When a bitmap is retrieved from the decoded tier, the corresponding element of the compressed tier is marked as used as well - so,
+/// the compressed tier follows the overall access pattern, and a sub-block whose bitmap is evicted from the (usually much smaller) decoded
+/// tier is still found in the compressed tier ("demotion"). If a bitmap is not in the decoded tier, but the sub-block is in the compressed
+/// tier, then the caller decodes it (without I/O) and adds the bitmap to the decoded tier ("promotion").
+class TwoTierSubBlockCache : public libCZI::ISubBlockCache
+{
+private:
+    static constexpr std::uint32_t kDefaultNumberOfShards = 16;
+    static constexpr std::uint32_t kMaxNumberOfShards = 1024;
+
+    struct CompressedEntry
+    {
+        std::shared_ptr<libCZI::ISubBlock> subblock;    ///< The cached sub-block.
+        std::uint64_t size_in_bytes;                    ///< The size of the sub-block in bytes (as accounted for in the cache).
+        std::uint64_t lru_value;                        ///< The "LRU value" - when marking a cache entry as "used", this value is set to the current value of the "LRU counter".
+        int subblock_index;                             ///< The key of the entry.
+    };
+
+    struct ShardData
+    {
+        std::list<CompressedEntry> lru_list;            ///< The entries in LRU-order (the most recently used one first).
+        std::unordered_map<int, std::list<CompressedEntry>::iterator> entries;
+    };
+
+    typedef ShardedLru<ShardData>::Shard Shard;
+
+    std::shared_ptr<libCZI::ISubBlockCache> decoded_tier_;
+    ShardedLru<ShardData> shards_;                                  ///< The shards of the compressed tier.
+    std::atomic_uint64_t compressed_tier_size_in_bytes_{ 0 };       ///< The current size of the compressed tier in bytes (only modified while holding the lock of a shard).
+    std::atomic_uint32_t compressed_tier_subblock_count_{ 0 };      ///< The current number of sub-blocks in the compressed tier (only modified while holding the lock of a shard).
+public:
+    /// Constructor.
+    /// \param  decoded_tier        The cache object which is used as the tier of decoded bitmaps.
+    /// \param  number_of_shards    The number of shards of the compressed tier (rounded up to the next power of two). If 0, then a default is used.
+    TwoTierSubBlockCache(std::shared_ptr<libCZI::ISubBlockCache> decoded_tier, std::uint32_t number_of_shards);
+    ~TwoTierSubBlockCache() override = default;
+
+    std::shared_ptr<libCZI::IBitmapData> Get(int subblock_index) override;
+    void Add(int subblock_index, std::shared_ptr<libCZI::IBitmapData> bitmap) override;
+    void AddWithDecodeCost(int subblock_index, std::shared_ptr<libCZI::IBitmapData> bitmap, std::uint32_t decode_cost_weight) override;
+    std::shared_ptr<libCZI::ISubBlock> GetSubBlock(int subblock_index) override;
+    void AddSubBlock(int subblock_index, std::shared_ptr<libCZI::ISubBlock> subBlock) override;
+    void Prune(const PruneOptions& options) override;
+    Statistics GetStatistics(std::uint8_t mask) const override;
+
+    /// Calculates the size in bytes which is accounted for a sub-block in the compressed tier - which is the size of
+    /// its data, metadata and attachment.
+    /// \param  subblock    The sub-block.
+    /// \returns    The size in bytes.
+    static std::uint64_t CalculateSizeInBytes(const libCZI::ISubBlock* subblock);
+private:
+    std::shared_ptr<libCZI::ISubBlock> GetAndMarkAsUsed(int subblock_index);
+    bool EvictLeastRecentlyUsedSubBlock();
+    static void PublishLruValueOfLeastRecentlyUsed(Shard& shard);
+};
@@ -411,6 +411,414 @@ tString trimImpl(const tString& str, const tString& whitespace)
     }
 }
 
+/*static*/void RectangleSoaFilter::AndMaskWithIntersection_C(const libCZI::IntRect& roi, const std::int32_t* x, const std::int32_t* y, const std::int32_t* w, const std::int32_t* h, size_t count, std::uint8_t* mask)
+{
+    // the right/bottom edges are calculated with 32-bit wrap-around arithmetic (as it is done by the SIMD-versions)
+    const int32_t roi_right = static_cast<int32_t>(static_cast<uint32_t>(roi.x) + static_cast<uint32_t>(roi.w));
+    const int32_t roi_bottom = static_cast<int32_t>(static_cast<uint32_t>(roi.y) + static_cast<uint32_t>(roi.h));
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int32_t x1 = (std::max)(roi.x, x[i]);
+        const int32_t x2 = (std::min)(roi_right, static_cast<int32_t>(static_cast<uint32_t>(x[i]) + static_cast<uint32_t>(w[i])));
+        const int32_t y1 = (std::max)(roi.y, y[i]);
+        const int32_t y2 = (std::min)(roi_bottom, static_cast<int32_t>(static_cast<uint32_t>(y[i]) + static_cast<uint32_t>(h[i])));
+        mask[i] &= (x2 > x1 && y2 > y1) ? 0xff : 0;
+    }
+}
+
+namespace
+{
+    // The scalar versions of the row kernels of the multi-channel compositor - note that the floating-point operations (and their order)
+    //  must be exactly the same as with the per-pixel functors in "MultiChannelCompositor.cpp", since the results are required to be identical.
+
+    struct BlackWhitePointToByte
+    {
+        int blackPoint, whitePoint;
+        BlackWhitePointToByte(int blackPoint, int whitePoint) : blackPoint(blackPoint), whitePoint(whitePoint) {}
+        uint8_t operator()(int v) const
+        {
+            if (v <= this->blackPoint)
+            {
+                return 0;
+            }
+
+            if (v >= this->whitePoint)
+            {
+                return 0xff;
+            }
+
+            const float f = (v - this->blackPoint) / float(this->whitePoint - this->blackPoint);
+            return static_cast<uint8_t>(f * 255 + .5);
+        }
+    };
+
+    struct BlackWhitePointToIntensity
+    {
+        int blackPoint, whitePoint;
+        BlackWhitePointToIntensity(int blackPoint, int whitePoint) : blackPoint(blackPoint), whitePoint(whitePoint) {}
+        float operator()(int v) const
+        {
+            if (v <= this->blackPoint)
+            {
+                return 0;
+            }
+
+            if (v >= this->whitePoint)
+            {
+                return 1;
+            }
+
+            return (v - this->blackPoint) / float(this->whitePoint - this->blackPoint);
+        }
+    };
+
+    struct SampleToByte8
+    {
+        uint8_t operator()(uint8_t v) const { return v; }
+    };
+
+    struct SampleToByte16
+    {
+        uint8_t operator()(uint16_t v) const { return static_cast<uint8_t>(v >> 8); }
+    };
+
+    struct SampleToByteLut
+    {
+        const uint8_t* ptrLut;
+        explicit SampleToByteLut(const uint8_t* ptrLut) : ptrLut(ptrLut) {}
+        uint8_t operator()(int v) const { return this->ptrLut[v]; }
+    };
+
+    struct IntensityGray8
+    {
+        static const int bytesPerPel = 1;
+        float operator()(const uint8_t* p) const
+        {
+            float f = *p;
+            f /= 255;
+            return f;
+        }
+    };
+
+    struct IntensityGray16
+    {
+        static const int bytesPerPel = 2;
+        float operator()(const uint8_t* p) const
+        {
+            float f = *reinterpret_cast<const uint16_t*>(p);
+            f /= (256 * 256 - 1);
+            return f;
+        }
+    };
+
+    struct IntensityBgr24
+    {
+        static const int bytesPerPel = 3;
+        float operator()(const uint8_t* p) const
+        {
+            float f = static_cast<float>(static_cast<int>(p[0]) + p[1] + p[2]);
+            f /= (3 * 255);
+            return f;
+        }
+    };
+
+    struct IntensityBgr48
+    {
+        static const int bytesPerPel = 6;
+        float operator()(const uint8_t* p) const
+        {
+            const uint16_t* puv = reinterpret_cast<const uint16_t*>(p);
+            float f = static_cast<float>(static_cast<int>(puv[0]) + puv[1] + puv[2]);
+            f /= (3 * (256 * 256 - 1));
+            return f;
+        }
+    };
+
+    struct IntensityGray8Lut
+    {
+        static const int bytesPerPel = 1;
+        const uint8_t* ptrLut;
+        explicit IntensityGray8Lut(const uint8_t* ptrLut) : ptrLut(ptrLut) {}
+        float operator()(const uint8_t* p) const
+        {
+            float f = this->ptrLut[*p];
+            f /= 255;
+            return f;
+        }
+    };
+
+    struct IntensityGray16Lut
+    {
+        static const int bytesPerPel = 2;
+        const uint8_t* ptrLut;
+        explicit IntensityGray16Lut(const uint8_t* ptrLut) : ptrLut(ptrLut) {}
+        float operator()(const uint8_t* p) const
+        {
+            float f = this->ptrLut[*reinterpret_cast<const uint16_t*>(p)];
+            f /= (256 - 1);
+            return f;
+        }
+    };
+
+    struct IntensityBgr24Lut
+    {
+        static const int bytesPerPel = 3;
+        const uint8_t* ptrLut;
+        explicit IntensityBgr24Lut(const uint8_t* ptrLut) : ptrLut(ptrLut) {}
+        float operator()(const uint8_t* p) const
+        {
+            float f = static_cast<float>(static_cast<int>(this->ptrLut[p[0]]) + this->ptrLut[p[1]]) + this->ptrLut[p[2]];
+            f /= (3 * 255);
+            return f;
+        }
+    };
+
+    struct IntensityBgr48Lut
+    {
+        static const int bytesPerPel = 6;
+        const uint8_t* ptrLut;
+        explicit IntensityBgr48Lut(const uint8_t* ptrLut) : ptrLut(ptrLut) {}
+        float operator()(const uint8_t* p) const
+        {
+            const uint16_t* puv = reinterpret_cast<const uint16_t*>(p);
+            float f = static_cast<float>(static_cast<int>(this->ptrLut[puv[0]]) + this->ptrLut[puv[1]] + this->ptrLut[puv[2]]);
+            f /= (3 * (256 - 1));
+            return f;
+        }
+    };
+
+    struct IntensityGray8BlackWhitePoint : BlackWhitePointToIntensity
+    {
+        static const int bytesPerPel = 1;
+        IntensityGray8BlackWhitePoint(int blackPoint, int whitePoint) : BlackWhitePointToIntensity(blackPoint, whitePoint) {}
+        float operator()(const uint8_t* p) const
+        {
+            return BlackWhitePointToIntensity::operator()(*p);
+        }
+    };
+
+    struct IntensityGray16BlackWhitePoint : BlackWhitePointToIntensity
+    {
+        static const int bytesPerPel = 2;
+        IntensityGray16BlackWhitePoint(int blackPoint, int whitePoint) : BlackWhitePointToIntensity(blackPoint, whitePoint) {}
+        float operator()(const uint8_t* p) const
+        {
+            return BlackWhitePointToIntensity::operator()(*reinterpret_cast<const uint16_t*>(p));
+        }
+    };
+
+    struct IntensityBgr24BlackWhitePoint : BlackWhitePointToIntensity
+    {
+        static const int bytesPerPel = 3;
+        IntensityBgr24BlackWhitePoint(int blackPoint, int whitePoint) : BlackWhitePointToIntensity(blackPoint, whitePoint) {}
+        float operator()(const uint8_t* p) const
+        {
+            return BlackWhitePointToIntensity::operator()((static_cast<int>(p[0]) + p[1] + p[2] + 1) / 3);
+        }
+    };
+
+    struct IntensityBgr48BlackWhitePoint : BlackWhitePointToIntensity
+    {
+        static const int bytesPerPel = 6;
+        IntensityBgr48BlackWhitePoint(int blackPoint, int whitePoint) : BlackWhitePointToIntensity(blackPoint, whitePoint) {}
+        float operator()(const uint8_t* p) const
+        {
+            const uint16_t* pus = reinterpret_cast<const uint16_t*>(p);
+            return BlackWhitePointToIntensity::operator()((static_cast<int>(pus[0]) + pus[1] + pus[2] + 1) / 3);
+        }
+    };
+
+    /// Converts the samples of a row (i.e. all channels of all pixels) with the specified operation - for a gray pixel type, the
+    /// resulting byte is used for blue, green and red.
+    template <typename tSample, typename tToByte>
+    void ConvertSamplesToBgr24_C(const tToByte& toByte, bool isGray, const void* ptrSrc, uint32_t count, uint8_t* ptrDst)
+    {
+        const tSample* pSrc = static_cast<const tSample*>(ptrSrc);
+        if (isGray)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const uint8_t v = toByte(pSrc[i]);
+                ptrDst[0] = ptrDst[1] = ptrDst[2] = v;
+                ptrDst += 3;
+            }
+        }
+        else
+        {
+            for (uint32_t i = 0; i < count * 3; ++i)
+            {
+                ptrDst[i] = toByte(pSrc[i]);
+            }
+        }
+    }
+
+    template <typename tIntensity>
+    void ConvertTintedToBgr24_C(const tIntensity& intensity, const libCZI::Rgb8Color& tintingColor, const void* ptrSrc, uint32_t count, uint8_t* ptrDst)
+    {
+        const uint8_t* pSrc = static_cast<const uint8_t*>(ptrSrc);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float f = intensity(pSrc);
+            ptrDst[0] = static_cast<uint8_t>(f * tintingColor.b + .5f);
+            ptrDst[1] = static_cast<uint8_t>(f * tintingColor.g + .5f);
+            ptrDst[2] = static_cast<uint8_t>(f * tintingColor.r + .5f);
+            pSrc += tIntensity::bytesPerPel;
+            ptrDst += 3;
+        }
+    }
+
+    void ThrowUnsupportedPixelType(libCZI::PixelType pixelType)
+    {
+        stringstream ss;
+        ss << "The pixeltype '" << libCZI::Utils::PixelTypeToInformalString(pixelType) << "' is not supported.";
+        throw invalid_argument(ss.str());
+    }
+}
+
+/*static*/void MultiChannelCompositorRowKernels::ConvertToBgr24_C(const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    const libCZI::PixelType pixelType = parameters.pixelType;
+    if (!parameters.enableTinting)
+    {
+        const bool isGray = pixelType == libCZI::PixelType::Gray8 || pixelType == libCZI::PixelType::Gray16;
+        const bool is8Bit = pixelType == libCZI::PixelType::Gray8 || pixelType == libCZI::PixelType::Bgr24;
+        if (!isGray && !is8Bit && pixelType != libCZI::PixelType::Bgr48)
+        {
+            ThrowUnsupportedPixelType(pixelType);
+        }
+
+        if (parameters.ptrLookUpTable != nullptr)
+        {
+            if (is8Bit)
+            {
+                ConvertSamplesToBgr24_C<uint8_t>(SampleToByteLut(parameters.ptrLookUpTable), isGray, ptrSrc, count, ptrDst);
+            }
+            else
+            {
+                ConvertSamplesToBgr24_C<uint16_t>(SampleToByteLut(parameters.ptrLookUpTable), isGray, ptrSrc, count, ptrDst);
+            }
+        }
+        else if (parameters.enableBlackWhitePoint)
+        {
+            if (is8Bit)
+            {
+                ConvertSamplesToBgr24_C<uint8_t>(BlackWhitePointToByte(parameters.blackPoint, parameters.whitePoint), isGray, ptrSrc, count, ptrDst);
+            }
+            else
+            {
+                ConvertSamplesToBgr24_C<uint16_t>(BlackWhitePointToByte(parameters.blackPoint, parameters.whitePoint), isGray, ptrSrc, count, ptrDst);
+            }
+        }
+        else
+        {
+            if (is8Bit)
+            {
+                ConvertSamplesToBgr24_C<uint8_t>(SampleToByte8(), isGray, ptrSrc, count, ptrDst);
+            }
+            else
+            {
+                ConvertSamplesToBgr24_C<uint16_t>(SampleToByte16(), isGray, ptrSrc, count, ptrDst);
+            }
+        }
+
+        return;
+    }
+
+    const libCZI::Rgb8Color& tintingColor = parameters.tintingColor;
+    const uint8_t* ptrLut = parameters.ptrLookUpTable;
+    const int blackPoint = parameters.blackPoint;
+    const int whitePoint = parameters.whitePoint;
+    switch (pixelType)
+    {
+    case libCZI::PixelType::Gray8:
+        if (ptrLut != nullptr)
+        {
+            ConvertTintedToBgr24_C(IntensityGray8Lut(ptrLut), tintingColor, ptrSrc, count, ptrDst);
+        }
+        else if (parameters.enableBlackWhitePoint)
+        {
+            ConvertTintedToBgr24_C(IntensityGray8BlackWhitePoint(blackPoint, whitePoint), tintingColor, ptrSrc, count, ptrDst);
+        }
+        else
+        {
+            ConvertTintedToBgr24_C(IntensityGray8(), tintingColor, ptrSrc, count, ptrDst);
+        }
+
+        break;
+    case libCZI::PixelType::Gray16:
+        if (ptrLut != nullptr)
+        {
+            ConvertTintedToBgr24_C(IntensityGray16Lut(ptrLut), tintingColor, ptrSrc, count, ptrDst);
+        }
+        else if (parameters.enableBlackWhitePoint)
+        {
+            ConvertTintedToBgr24_C(IntensityGray16BlackWhitePoint(blackPoint, whitePoint), tintingColor, ptrSrc, count, ptrDst);
+        }
+        else
+        {
+            ConvertTintedToBgr24_C(IntensityGray16(), tintingColor, ptrSrc, count, ptrDst);
+        }
+
+        break;
+    case libCZI::PixelType::Bgr24:
+        if (ptrLut != nullptr)
+        {
+            ConvertTintedToBgr24_C(IntensityBgr24Lut(ptrLut), tintingColor, ptrSrc, count, ptrDst);
+        }
+        else if (parameters.enableBlackWhitePoint)
+        {
+            ConvertTintedToBgr24_C(IntensityBgr24BlackWhitePoint(blackPoint, whitePoint), tintingColor, ptrSrc, count, ptrDst);
+        }
+        else
+        {
+            ConvertTintedToBgr24_C(IntensityBgr24(), tintingColor, ptrSrc, count, ptrDst);
+        }
+
+        break;
+    case libCZI::PixelType::Bgr48:
+        if (ptrLut != nullptr)
+        {
+            ConvertTintedToBgr24_C(IntensityBgr48Lut(ptrLut), tintingColor, ptrSrc, count, ptrDst);
+        }
+        else if (parameters.enableBlackWhitePoint)
+        {
+            ConvertTintedToBgr24_C(IntensityBgr48BlackWhitePoint(blackPoint, whitePoint), tintingColor, ptrSrc, count, ptrDst);
+        }
+        else
+        {
+            ConvertTintedToBgr24_C(IntensityBgr48(), tintingColor, ptrSrc, count, ptrDst);
+        }
+
+        break;
+    default:
+        ThrowUnsupportedPixelType(pixelType);
+    }
+}
+
+/*static*/void MultiChannelCompositorRowKernels::AddSaturated_C(const std::uint8_t* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ptrDst[i] = static_cast<uint8_t>((std::min)(ptrDst[i] + ptrSrc[i], 0xff));
+    }
+}
+
+/*static*/void MultiChannelCompositorRowKernels::StoreWithWeight_C(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ptrDst[i] = static_cast<uint8_t>((std::min)(static_cast<int>(ptrSrc[i] * weight + .5f), 0xff));
+    }
+}
+
+/*static*/void MultiChannelCompositorRowKernels::AddWithWeightSaturated_C(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ptrDst[i] = static_cast<uint8_t>((std::min)(ptrDst[i] + static_cast<int>(ptrSrc[i] * weight + .5f), 0xff));
+    }
+}
+
 #if !LIBCZI_HAS_NEOININTRINSICS && !LIBCZI_HAS_AVXINTRINSICS
 /*static*/void LoHiBytePackUnpack::LoHiByteUnpackStrided(const void* ptrSrc, std::uint32_t wordCount, std::uint32_t stride, std::uint32_t lineCount, void* ptrDst)
 {
@@ -423,6 +831,31 @@ tString trimImpl(const tString& str, const tString& whitespace)
     LoHiBytePackUnpack::CheckLoHiBytePackArgumentsAndThrow(ptrSrc, sizeSrc, width, height, stride, dest);
     LoHiBytePackStrided_C(ptrSrc, sizeSrc, width, height, stride, dest);
 }
+
+/*static*/void RectangleSoaFilter::AndMaskWithIntersection(const libCZI::IntRect& roi, const std::int32_t* x, const std::int32_t* y, const std::int32_t* w, const std::int32_t* h, size_t count, std::uint8_t* mask)
+{
+    AndMaskWithIntersection_C(roi, x, y, w, h, count, mask);
+}
+
+/*static*/void MultiChannelCompositorRowKernels::ConvertToBgr24(const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    ConvertToBgr24_C(parameters, ptrSrc, count, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernels::AddSaturated(const std::uint8_t* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    AddSaturated_C(ptrSrc, count, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernels::StoreWithWeight(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst)
+{
+    StoreWithWeight_C(ptrSrc, count, weight, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernels::AddWithWeightSaturated(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst)
+{
+    AddWithWeightSaturated_C(ptrSrc, count, weight, ptrDst);
+}
 #endif
 
 void RectangleCoverageCalculator::AddRectangle(const libCZI::IntRect& rectangle)
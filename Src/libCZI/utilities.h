@@ -147,6 +147,81 @@ protected:
     static void CheckLoHiByteUnpackArgumentsAndThrow(std::uint32_t width, std::uint32_t stride, const void* source, void* dest);
 };
 
+/// Filter kernels operating on rectangles which are stored as "structure-of-arrays", i.e. in separate arrays for x, y, width and height.
+class RectangleSoaFilter
+{
+public:
+    /// For each of the rectangles, the corresponding element in 'mask' is set to zero if the rectangle does not intersect with
+    /// the ROI (with the same semantic as "Utilities::DoIntersect"), otherwise the element is left unchanged.
+    ///
+    /// \param          roi     The ROI.
+    /// \param          x       The x-coordinates of the rectangles.
+    /// \param          y       The y-coordinates of the rectangles.
+    /// \param          w       The widths of the rectangles.
+    /// \param          h       The heights of the rectangles.
+    /// \param          count   The number of rectangles.
+    /// \param [in,out] mask    The mask (with 'count' elements) to be modified.
+    static void AndMaskWithIntersection(const libCZI::IntRect& roi, const std::int32_t* x, const std::int32_t* y, const std::int32_t* w, const std::int32_t* h, size_t count, std::uint8_t* mask);
+protected:
+    static void AndMaskWithIntersection_C(const libCZI::IntRect& roi, const std::int32_t* x, const std::int32_t* y, const std::int32_t* w, const std::int32_t* h, size_t count, std::uint8_t* mask);
+};
+
+/// Row kernels for the multi-channel compositor with a destination of pixel type Bgr24. A row of a channel is converted into
+/// BGR24-pixels (with "ConvertToBgr24"), which are then stored or added to the row of the destination. The results are identical
+/// to the per-pixel operations of the compositor for the pixel types Gray8, Gray16, Bgr24 and Bgr48.
+class MultiChannelCompositorRowKernels
+{
+public:
+    /// The parameters which determine how the pixels of a channel are converted into BGR24-pixels.
+    struct ChannelParameters
+    {
+        libCZI::PixelType pixelType;            ///< The pixel type of the source, which must be one of Gray8, Gray16, Bgr24 or Bgr48.
+        bool enableTinting;                     ///< True if the pixels are tinted with 'tintingColor', false if they are rendered as gray (or as BGR).
+        libCZI::Rgb8Color tintingColor;         ///< The tinting color (only used if 'enableTinting' is true).
+        const std::uint8_t* ptrLookUpTable;     ///< If non-null, the look-up table (with 256 or 65536 elements, depending on the pixel type). In this case, the black- and white-point are not used.
+        bool enableBlackWhitePoint;             ///< True if the black- and white-point are to be applied (only used if there is no look-up table).
+        std::uint16_t blackPoint;               ///< The black-point in units of the pixel value.
+        std::uint16_t whitePoint;               ///< The white-point in units of the pixel value.
+    };
+
+    /// Converts the specified pixels into BGR24-pixels.
+    ///
+    /// \param          parameters  The parameters for the conversion.
+    /// \param          ptrSrc      The source pixels (of the pixel type given in 'parameters').
+    /// \param          count       The number of pixels.
+    /// \param [out]    ptrDst      The destination, where 3 * 'count' bytes are written.
+    static void ConvertToBgr24(const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst);
+
+    /// Adds the specified bytes to the destination, saturating at 255.
+    ///
+    /// \param          ptrSrc  The bytes to be added.
+    /// \param          count   The number of bytes.
+    /// \param [in,out] ptrDst  The destination.
+    static void AddSaturated(const std::uint8_t* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst);
+
+    /// Multiplies the specified bytes with a weight (rounding to the nearest integer and saturating at 255) and stores the result.
+    ///
+    /// \param          ptrSrc  The bytes to be multiplied with the weight.
+    /// \param          count   The number of bytes.
+    /// \param          weight  The weight (which must not be negative).
+    /// \param [out]    ptrDst  The destination.
+    static void StoreWithWeight(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst);
+
+    /// Multiplies the specified bytes with a weight (rounding to the nearest integer) and adds the result to the destination,
+    /// saturating at 255.
+    ///
+    /// \param          ptrSrc  The bytes to be multiplied with the weight.
+    /// \param          count   The number of bytes.
+    /// \param          weight  The weight (which must not be negative).
+    /// \param [in,out] ptrDst  The destination.
+    static void AddWithWeightSaturated(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst);
+protected:
+    static void ConvertToBgr24_C(const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst);
+    static void AddSaturated_C(const std::uint8_t* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst);
+    static void StoreWithWeight_C(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst);
+    static void AddWithWeightSaturated_C(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst);
+};
+
 template <typename t>
 struct Nullable
 {
@@ -4,6 +4,7 @@
 
 #include <stdexcept>
 #include <cstdint>
+#include <cstring>
 #include "inc_libCZI_Config.h"
 #include "utilities.h"
 
@@ -234,6 +235,699 @@ LoHiBytePackUnpackAvx::pfnLoHiBytePackStrided_t LoHiBytePackUnpackAvx::pfnLoHiBy
     (*LoHiBytePackUnpackAvx::pfnLoHiBytePackStrided)(ptrSrc, sizeSrc, width, height, stride, dest);
 }
 
+class RectangleSoaFilterAvx : public RectangleSoaFilter
+{
+public:
+    typedef void(*pfnAndMaskWithIntersection_t)(const libCZI::IntRect&, const std::int32_t*, const std::int32_t*, const std::int32_t*, const std::int32_t*, size_t, std::uint8_t*);
+
+    static pfnAndMaskWithIntersection_t pfnAndMaskWithIntersection;
+
+    static void AndMaskWithIntersection_Choose(const libCZI::IntRect& roi, const std::int32_t* x, const std::int32_t* y, const std::int32_t* w, const std::int32_t* h, size_t count, std::uint8_t* mask);
+    static void AndMaskWithIntersection_AVX(const libCZI::IntRect& roi, const std::int32_t* x, const std::int32_t* y, const std::int32_t* w, const std::int32_t* h, size_t count, std::uint8_t* mask);
+};
+
+RectangleSoaFilterAvx::pfnAndMaskWithIntersection_t RectangleSoaFilterAvx::pfnAndMaskWithIntersection = &RectangleSoaFilterAvx::AndMaskWithIntersection_Choose;
+
+/*static*/void RectangleSoaFilter::AndMaskWithIntersection(const libCZI::IntRect& roi, const std::int32_t* x, const std::int32_t* y, const std::int32_t* w, const std::int32_t* h, size_t count, std::uint8_t* mask)
+{
+    (*RectangleSoaFilterAvx::pfnAndMaskWithIntersection)(roi, x, y, w, h, count, mask);
+}
+
+/*static*/void RectangleSoaFilterAvx::AndMaskWithIntersection_AVX(const libCZI::IntRect& roi, const std::int32_t* x, const std::int32_t* y, const std::int32_t* w, const std::int32_t* h, size_t count, std::uint8_t* mask)
+{
+    const __m256i roi_left = _mm256_set1_epi32(roi.x);
+    const __m256i roi_top = _mm256_set1_epi32(roi.y);
+    const __m256i roi_right = _mm256_add_epi32(roi_left, _mm256_set1_epi32(roi.w));
+    const __m256i roi_bottom = _mm256_add_epi32(roi_top, _mm256_set1_epi32(roi.h));
+    const size_t countOver8 = count / 8;
+
+    for (size_t i = 0; i < countOver8; ++i)
+    {
+        const __m256i vx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x));
+        const __m256i vy = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y));
+        const __m256i x1 = _mm256_max_epi32(roi_left, vx);
+        const __m256i x2 = _mm256_min_epi32(roi_right, _mm256_add_epi32(vx, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w))));
+        const __m256i y1 = _mm256_max_epi32(roi_top, vy);
+        const __m256i y2 = _mm256_min_epi32(roi_bottom, _mm256_add_epi32(vy, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h))));
+        const __m256i intersects = _mm256_and_si256(_mm256_cmpgt_epi32(x2, x1), _mm256_cmpgt_epi32(y2, y1));
+        const int bits = _mm256_movemask_ps(_mm256_castsi256_ps(intersects));
+        if (bits != 0xff)
+        {
+            for (int n = 0; n < 8; ++n)
+            {
+                if ((bits & (1 << n)) == 0)
+                {
+                    mask[n] = 0;
+                }
+            }
+        }
+
+        x += 8;
+        y += 8;
+        w += 8;
+        h += 8;
+        mask += 8;
+    }
+
+    _mm256_zeroupper();
+    RectangleSoaFilter::AndMaskWithIntersection_C(roi, x, y, w, h, count % 8, mask);
+}
+
+/*static*/void RectangleSoaFilterAvx::AndMaskWithIntersection_Choose(const libCZI::IntRect& roi, const std::int32_t* x, const std::int32_t* y, const std::int32_t* w, const std::int32_t* h, size_t count, std::uint8_t* mask)
+{
+    if (CheckWhetherCpuSupportsAVX2())
+    {
+        RectangleSoaFilterAvx::pfnAndMaskWithIntersection = RectangleSoaFilterAvx::AndMaskWithIntersection_AVX;
+    }
+    else
+    {
+        RectangleSoaFilterAvx::pfnAndMaskWithIntersection = RectangleSoaFilterAvx::AndMaskWithIntersection_C;
+    }
+
+    (*RectangleSoaFilterAvx::pfnAndMaskWithIntersection)(roi, x, y, w, h, count, mask);
+}
+
+namespace
+{
+    // Helpers for the row kernels of the multi-channel compositor. Note that the floating-point operations (and their order) are
+    //  exactly the same as with the scalar versions, so that the results are identical.
+
+    /// Stores 16 gray values as 16 BGR24-pixels (i.e. every byte is written three times).
+    inline void StoreGrayAsBgr24Avx(__m128i gray, uint8_t* ptrDst)
+    {
+        const __m128i shuffle0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+        const __m128i shuffle1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+        const __m128i shuffle2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ptrDst), _mm_shuffle_epi8(gray, shuffle0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ptrDst + 16), _mm_shuffle_epi8(gray, shuffle1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ptrDst + 32), _mm_shuffle_epi8(gray, shuffle2));
+    }
+
+    /// Packs two vectors of 8 32-bit integers into 16 bytes (with unsigned saturation), retaining their order.
+    inline __m128i PackToBytesAvx(__m256i lo, __m256i hi)
+    {
+        const __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xd8);
+        return _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+    }
+
+    /// Multiplies the 8 intensities with the tinting color, and stores the result as 8 BGR24-pixels.
+    inline void StoreTintedAsBgr24Avx(__m256 f, __m256 tintingB, __m256 tintingG, __m256 tintingR, uint8_t* ptrDst)
+    {
+        const __m256 half = _mm256_set1_ps(.5f);
+        const __m256i b = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(f, tintingB), half));
+        const __m256i g = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(f, tintingG), half));
+        const __m256i r = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(f, tintingR), half));
+        const __m256i bgr0 = _mm256_or_si256(b, _mm256_or_si256(_mm256_slli_epi32(g, 8), _mm256_slli_epi32(r, 16)));
+
+        // remove the fourth byte of every pixel (which gives 12 bytes at the start of each lane), and then move the bytes of the
+        //  upper lane next to the ones of the lower lane
+        const __m256i shuffle = _mm256_setr_epi8(
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        const __m256i bgr = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(bgr0, shuffle), _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ptrDst), _mm256_castsi256_si128(bgr));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(ptrDst + 16), _mm256_extracti128_si256(bgr, 1));
+    }
+
+    inline __m256i LoadGray8AsInt32Avx(const uint8_t* p)
+    {
+        return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+    }
+
+    inline __m256i LoadGray16AsInt32Avx(const uint8_t* p)
+    {
+        return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+
+    /// Gets the sums of blue, green and red of 8 BGR24-pixels. Note that 28 bytes are read (i.e. 4 bytes more than the 8 pixels occupy).
+    inline __m256i LoadBgr24AsSumInt32Avx(const uint8_t* p)
+    {
+        const __m256i shuffleB = _mm256_setr_epi8(
+            0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1,
+            0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1);
+        const __m256i shuffleG = _mm256_setr_epi8(
+            1, -1, -1, -1, 4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1,
+            1, -1, -1, -1, 4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1);
+        const __m256i shuffleR = _mm256_setr_epi8(
+            2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1,
+            2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1);
+        const __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)),
+            1);
+        return _mm256_add_epi32(_mm256_add_epi32(_mm256_shuffle_epi8(v, shuffleB), _mm256_shuffle_epi8(v, shuffleG)), _mm256_shuffle_epi8(v, shuffleR));
+    }
+
+    /// Gets the sums of blue, green and red of 8 BGR48-pixels.
+    inline __m256i LoadBgr48AsSumInt32Avx(const uint8_t* p)
+    {
+        // a, b and c contain the 24 samples of the 8 pixels, the sample 3*k+j of pixel k is found in a (if <8), b (if <16) or c
+        const __m256i a = LoadGray16AsInt32Avx(p);
+        const __m256i b = LoadGray16AsInt32Avx(p + 16);
+        const __m256i c = LoadGray16AsInt32Avx(p + 32);
+        const __m256i first = _mm256_blend_epi32(
+            _mm256_blend_epi32(_mm256_permutevar8x32_epi32(a, _mm256_setr_epi32(0, 3, 6, 0, 0, 0, 0, 0)), _mm256_permutevar8x32_epi32(b, _mm256_setr_epi32(0, 0, 0, 1, 4, 7, 0, 0)), 0x38),
+            _mm256_permutevar8x32_epi32(c, _mm256_setr_epi32(0, 0, 0, 0, 0, 0, 2, 5)),
+            0xc0);
+        const __m256i second = _mm256_blend_epi32(
+            _mm256_blend_epi32(_mm256_permutevar8x32_epi32(a, _mm256_setr_epi32(1, 4, 7, 0, 0, 0, 0, 0)), _mm256_permutevar8x32_epi32(b, _mm256_setr_epi32(0, 0, 0, 2, 5, 0, 0, 0)), 0x18),
+            _mm256_permutevar8x32_epi32(c, _mm256_setr_epi32(0, 0, 0, 0, 0, 0, 3, 6)),
+            0xe0);
+        const __m256i third = _mm256_blend_epi32(
+            _mm256_blend_epi32(_mm256_permutevar8x32_epi32(a, _mm256_setr_epi32(2, 5, 0, 0, 0, 0, 0, 0)), _mm256_permutevar8x32_epi32(b, _mm256_setr_epi32(0, 0, 0, 3, 6, 0, 0, 0)), 0x1c),
+            _mm256_permutevar8x32_epi32(c, _mm256_setr_epi32(0, 0, 0, 0, 0, 1, 4, 7)),
+            0xe0);
+        return _mm256_add_epi32(_mm256_add_epi32(first, second), third);
+    }
+
+    /// Applies the black- and white-point to 8 values, giving the intensity (in the range 0 to 1).
+    inline __m256 BlackWhitePointToIntensityAvx(__m256i v, __m256i blackPoint, __m256i whitePoint, __m256 range)
+    {
+        const __m256 f = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(v, blackPoint)), range);
+        const __m256 fWhite = _mm256_blendv_ps(_mm256_set1_ps(1), f, _mm256_castsi256_ps(_mm256_cmpgt_epi32(whitePoint, v)));
+        return _mm256_and_ps(fWhite, _mm256_castsi256_ps(_mm256_cmpgt_epi32(v, blackPoint)));
+    }
+
+    /// Applies the black- and white-point to 8 values, giving bytes (in 32-bit integers).
+    inline __m256i BlackWhitePointToByteAvx(__m256i v, __m256i blackPoint, __m256i whitePoint, __m256 range)
+    {
+        const __m256 m = _mm256_mul_ps(_mm256_div_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(v, blackPoint)), range), _mm256_set1_ps(255));
+
+        // the scalar version adds 0.5 in double precision before truncating, which is the same as rounding half up (and
+        //  different from adding 0.5 in single precision) - so, we add one if the fractional part is >= 0.5
+        const __m256i t = _mm256_cvttps_epi32(m);
+        const __m256 fraction = _mm256_sub_ps(m, _mm256_cvtepi32_ps(t));
+        const __m256i rounded = _mm256_sub_epi32(t, _mm256_castps_si256(_mm256_cmp_ps(fraction, _mm256_set1_ps(.5f), _CMP_GE_OQ)));
+        const __m256i white = _mm256_blendv_epi8(_mm256_set1_epi32(0xff), rounded, _mm256_cmpgt_epi32(whitePoint, v));
+        return _mm256_and_si256(white, _mm256_cmpgt_epi32(v, blackPoint));
+    }
+
+    /// The "integer intensity" of a BGR-pixel as it is used with the black- and white-point, which is (b+g+r+1)/3.
+    inline __m256i SumToAverageAvx(__m256i sum)
+    {
+        // the division is exact for sums < 2^21 (and the sum of 3 16-bit values is smaller)
+        return _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(sum, _mm256_set1_epi32(1))), _mm256_set1_ps(3)));
+    }
+
+    // The "sample converters" give 16 bytes for 16 samples.
+    struct SampleConverter8Avx
+    {
+        static const int bytesPerSample = 1;
+        __m128i operator()(const uint8_t* p) const
+        {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        }
+    };
+
+    struct SampleConverter16Avx
+    {
+        static const int bytesPerSample = 2;
+        __m128i operator()(const uint8_t* p) const
+        {
+            const __m128i lo = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), 8);
+            const __m128i hi = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)), 8);
+            return _mm_packus_epi16(lo, hi);
+        }
+    };
+
+    template <typename tSample>
+    struct SampleConverterLutAvx
+    {
+        static const int bytesPerSample = sizeof(tSample);
+        const uint8_t* ptrLut;
+        explicit SampleConverterLutAvx(const uint8_t* ptrLut) : ptrLut(ptrLut) {}
+        __m128i operator()(const uint8_t* p) const
+        {
+            const tSample* pSample = reinterpret_cast<const tSample*>(p);
+            const uint8_t* lut = this->ptrLut;
+            return _mm_setr_epi8(
+                lut[pSample[0]], lut[pSample[1]], lut[pSample[2]], lut[pSample[3]], lut[pSample[4]], lut[pSample[5]], lut[pSample[6]], lut[pSample[7]],
+                lut[pSample[8]], lut[pSample[9]], lut[pSample[10]], lut[pSample[11]], lut[pSample[12]], lut[pSample[13]], lut[pSample[14]], lut[pSample[15]]);
+        }
+    };
+
+    template <int tBytesPerSample>
+    struct SampleConverterBlackWhitePointAvx
+    {
+        static const int bytesPerSample = tBytesPerSample;
+        __m256i blackPoint, whitePoint;
+        __m256 range;
+        SampleConverterBlackWhitePointAvx(int blackPoint, int whitePoint)
+            : blackPoint(_mm256_set1_epi32(blackPoint)), whitePoint(_mm256_set1_epi32(whitePoint)), range(_mm256_set1_ps(float(whitePoint - blackPoint)))
+        {}
+
+        __m128i operator()(const uint8_t* p) const
+        {
+            const __m256i lo = tBytesPerSample == 1 ? LoadGray8AsInt32Avx(p) : LoadGray16AsInt32Avx(p);
+            const __m256i hi = tBytesPerSample == 1 ? LoadGray8AsInt32Avx(p + 8) : LoadGray16AsInt32Avx(p + 16);
+            return PackToBytesAvx(
+                BlackWhitePointToByteAvx(lo, this->blackPoint, this->whitePoint, this->range),
+                BlackWhitePointToByteAvx(hi, this->blackPoint, this->whitePoint, this->range));
+        }
+    };
+
+    // The "intensity getters" give the intensities (in the range 0 to 1) of 8 pixels.
+    template <int tBytesPerPel>
+    struct IntensityPlainAvx
+    {
+        static const int bytesPerPel = tBytesPerPel;
+        static const uint32_t pixelsToSpare = tBytesPerPel == 3 ? 2 : 0;   // LoadBgr24AsSumInt32Avx reads 4 bytes more
+        __m256 divisor;
+        explicit IntensityPlainAvx(float divisor) : divisor(_mm256_set1_ps(divisor)) {}
+        __m256 operator()(const uint8_t* p) const
+        {
+            __m256i v;
+            switch (tBytesPerPel)
+            {
+            case 1:
+                v = LoadGray8AsInt32Avx(p);
+                break;
+            case 2:
+                v = LoadGray16AsInt32Avx(p);
+                break;
+            case 3:
+                v = LoadBgr24AsSumInt32Avx(p);
+                break;
+            default:
+                v = LoadBgr48AsSumInt32Avx(p);
+                break;
+            }
+
+            return _mm256_div_ps(_mm256_cvtepi32_ps(v), this->divisor);
+        }
+    };
+
+    template <int tBytesPerPel>
+    struct IntensityLutAvx
+    {
+        static const int bytesPerPel = tBytesPerPel;
+        static const uint32_t pixelsToSpare = 0;
+        const uint8_t* ptrLut;
+        __m256 divisor;
+        IntensityLutAvx(const uint8_t* ptrLut, float divisor) : ptrLut(ptrLut), divisor(_mm256_set1_ps(divisor)) {}
+        __m256 operator()(const uint8_t* p) const
+        {
+            int32_t v[8];
+            for (int i = 0; i < 8; ++i)
+            {
+                v[i] = this->GetLutSum(p + i * tBytesPerPel);
+            }
+
+            return _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(v))), this->divisor);
+        }
+
+        int32_t GetLutSum(const uint8_t* p) const
+        {
+            const uint16_t* pUs = reinterpret_cast<const uint16_t*>(p);
+            switch (tBytesPerPel)
+            {
+            case 1:
+                return this->ptrLut[*p];
+            case 2:
+                return this->ptrLut[*pUs];
+            case 3:
+                return static_cast<int32_t>(this->ptrLut[p[0]]) + this->ptrLut[p[1]] + this->ptrLut[p[2]];
+            default:
+                return static_cast<int32_t>(this->ptrLut[pUs[0]]) + this->ptrLut[pUs[1]] + this->ptrLut[pUs[2]];
+            }
+        }
+    };
+
+    template <int tBytesPerPel>
+    struct IntensityBlackWhitePointAvx
+    {
+        static const int bytesPerPel = tBytesPerPel;
+        static const uint32_t pixelsToSpare = tBytesPerPel == 3 ? 2 : 0;
+        __m256i blackPoint, whitePoint;
+        __m256 range;
+        IntensityBlackWhitePointAvx(int blackPoint, int whitePoint)
+            : blackPoint(_mm256_set1_epi32(blackPoint)), whitePoint(_mm256_set1_epi32(whitePoint)), range(_mm256_set1_ps(float(whitePoint - blackPoint)))
+        {}
+
+        __m256 operator()(const uint8_t* p) const
+        {
+            __m256i v;
+            switch (tBytesPerPel)
+            {
+            case 1:
+                v = LoadGray8AsInt32Avx(p);
+                break;
+            case 2:
+                v = LoadGray16AsInt32Avx(p);
+                break;
+            case 3:
+                v = SumToAverageAvx(LoadBgr24AsSumInt32Avx(p));
+                break;
+            default:
+                v = SumToAverageAvx(LoadBgr48AsSumInt32Avx(p));
+                break;
+            }
+
+            return BlackWhitePointToIntensityAvx(v, this->blackPoint, this->whitePoint, this->range);
+        }
+    };
+}
+
+class MultiChannelCompositorRowKernelsAvx : public MultiChannelCompositorRowKernels
+{
+public:
+    typedef void(*pfnConvertToBgr24_t)(const ChannelParameters&, const void*, std::uint32_t, std::uint8_t*);
+    typedef void(*pfnAddSaturated_t)(const std::uint8_t*, std::uint32_t, std::uint8_t*);
+    typedef void(*pfnWithWeight_t)(const std::uint8_t*, std::uint32_t, float, std::uint8_t*);
+
+    static pfnConvertToBgr24_t pfnConvertToBgr24;
+    static pfnAddSaturated_t pfnAddSaturated;
+    static pfnWithWeight_t pfnStoreWithWeight;
+    static pfnWithWeight_t pfnAddWithWeightSaturated;
+
+    static void ConvertToBgr24_Choose(const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst);
+    static void AddSaturated_Choose(const std::uint8_t* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst);
+    static void StoreWithWeight_Choose(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst);
+    static void AddWithWeightSaturated_Choose(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst);
+
+    static void ConvertToBgr24_AVX(const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst);
+    static void AddSaturated_AVX(const std::uint8_t* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst);
+    static void StoreWithWeight_AVX(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst);
+    static void AddWithWeightSaturated_AVX(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst);
+private:
+    template <typename tSampleConverter>
+    static void ConvertSamplesToBgr24_AVX(const tSampleConverter& converter, bool isGray, const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst);
+    template <typename tIntensity>
+    static void ConvertTintedToBgr24_AVX(const tIntensity& intensity, const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst);
+    static void MultiplyWithWeight_AVX(const std::uint8_t* ptrSrc, float weight, __m128i& lo, __m128i& hi);
+};
+
+MultiChannelCompositorRowKernelsAvx::pfnConvertToBgr24_t MultiChannelCompositorRowKernelsAvx::pfnConvertToBgr24 = &MultiChannelCompositorRowKernelsAvx::ConvertToBgr24_Choose;
+MultiChannelCompositorRowKernelsAvx::pfnAddSaturated_t MultiChannelCompositorRowKernelsAvx::pfnAddSaturated = &MultiChannelCompositorRowKernelsAvx::AddSaturated_Choose;
+MultiChannelCompositorRowKernelsAvx::pfnWithWeight_t MultiChannelCompositorRowKernelsAvx::pfnStoreWithWeight = &MultiChannelCompositorRowKernelsAvx::StoreWithWeight_Choose;
+MultiChannelCompositorRowKernelsAvx::pfnWithWeight_t MultiChannelCompositorRowKernelsAvx::pfnAddWithWeightSaturated = &MultiChannelCompositorRowKernelsAvx::AddWithWeightSaturated_Choose;
+
+/*static*/void MultiChannelCompositorRowKernels::ConvertToBgr24(const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    (*MultiChannelCompositorRowKernelsAvx::pfnConvertToBgr24)(parameters, ptrSrc, count, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernels::AddSaturated(const std::uint8_t* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    (*MultiChannelCompositorRowKernelsAvx::pfnAddSaturated)(ptrSrc, count, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernels::StoreWithWeight(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst)
+{
+    (*MultiChannelCompositorRowKernelsAvx::pfnStoreWithWeight)(ptrSrc, count, weight, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernels::AddWithWeightSaturated(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst)
+{
+    (*MultiChannelCompositorRowKernelsAvx::pfnAddWithWeightSaturated)(ptrSrc, count, weight, ptrDst);
+}
+
+template <typename tSampleConverter>
+/*static*/void MultiChannelCompositorRowKernelsAvx::ConvertSamplesToBgr24_AVX(const tSampleConverter& converter, bool isGray, const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    // we process 16 pixels per loop, which are 16 samples for a gray pixel type and 48 samples for a BGR pixel type
+    const uint8_t* pSrc = static_cast<const uint8_t*>(ptrSrc);
+    const uint32_t countOver16 = count / 16;
+    for (uint32_t i = 0; i < countOver16; ++i)
+    {
+        if (isGray)
+        {
+            StoreGrayAsBgr24Avx(converter(pSrc), ptrDst);
+            pSrc += 16 * tSampleConverter::bytesPerSample;
+        }
+        else
+        {
+            for (int n = 0; n < 3; ++n)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(ptrDst + n * 16), converter(pSrc));
+                pSrc += 16 * tSampleConverter::bytesPerSample;
+            }
+        }
+
+        ptrDst += 48;
+    }
+
+    _mm256_zeroupper();
+    MultiChannelCompositorRowKernels::ConvertToBgr24_C(parameters, pSrc, count % 16, ptrDst);
+}
+
+template <typename tIntensity>
+/*static*/void MultiChannelCompositorRowKernelsAvx::ConvertTintedToBgr24_AVX(const tIntensity& intensity, const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    const __m256 tintingB = _mm256_set1_ps(parameters.tintingColor.b);
+    const __m256 tintingG = _mm256_set1_ps(parameters.tintingColor.g);
+    const __m256 tintingR = _mm256_set1_ps(parameters.tintingColor.r);
+    const uint8_t* pSrc = static_cast<const uint8_t*>(ptrSrc);
+    uint32_t x = 0;
+    for (; x + 8 + tIntensity::pixelsToSpare <= count; x += 8)
+    {
+        StoreTintedAsBgr24Avx(intensity(pSrc), tintingB, tintingG, tintingR, ptrDst);
+        pSrc += 8 * tIntensity::bytesPerPel;
+        ptrDst += 24;
+    }
+
+    _mm256_zeroupper();
+    MultiChannelCompositorRowKernels::ConvertToBgr24_C(parameters, pSrc, count - x, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernelsAvx::ConvertToBgr24_AVX(const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    const libCZI::PixelType pixelType = parameters.pixelType;
+    const uint8_t* ptrLut = parameters.ptrLookUpTable;
+    const int blackPoint = parameters.blackPoint;
+    const int whitePoint = parameters.whitePoint;
+    if (!parameters.enableTinting)
+    {
+        const bool isGray = pixelType == libCZI::PixelType::Gray8 || pixelType == libCZI::PixelType::Gray16;
+        switch (pixelType)
+        {
+        case libCZI::PixelType::Gray8:
+        case libCZI::PixelType::Bgr24:
+            if (ptrLut != nullptr)
+            {
+                ConvertSamplesToBgr24_AVX(SampleConverterLutAvx<uint8_t>(ptrLut), isGray, parameters, ptrSrc, count, ptrDst);
+            }
+            else if (parameters.enableBlackWhitePoint)
+            {
+                ConvertSamplesToBgr24_AVX(SampleConverterBlackWhitePointAvx<1>(blackPoint, whitePoint), isGray, parameters, ptrSrc, count, ptrDst);
+            }
+            else
+            {
+                ConvertSamplesToBgr24_AVX(SampleConverter8Avx(), isGray, parameters, ptrSrc, count, ptrDst);
+            }
+
+            return;
+        case libCZI::PixelType::Gray16:
+        case libCZI::PixelType::Bgr48:
+            if (ptrLut != nullptr)
+            {
+                ConvertSamplesToBgr24_AVX(SampleConverterLutAvx<uint16_t>(ptrLut), isGray, parameters, ptrSrc, count, ptrDst);
+            }
+            else if (parameters.enableBlackWhitePoint)
+            {
+                ConvertSamplesToBgr24_AVX(SampleConverterBlackWhitePointAvx<2>(blackPoint, whitePoint), isGray, parameters, ptrSrc, count, ptrDst);
+            }
+            else
+            {
+                ConvertSamplesToBgr24_AVX(SampleConverter16Avx(), isGray, parameters, ptrSrc, count, ptrDst);
+            }
+
+            return;
+        default:
+            break;
+        }
+    }
+    else
+    {
+        switch (pixelType)
+        {
+        case libCZI::PixelType::Gray8:
+            if (ptrLut != nullptr)
+            {
+                ConvertTintedToBgr24_AVX(IntensityLutAvx<1>(ptrLut, 255), parameters, ptrSrc, count, ptrDst);
+            }
+            else if (parameters.enableBlackWhitePoint)
+            {
+                ConvertTintedToBgr24_AVX(IntensityBlackWhitePointAvx<1>(blackPoint, whitePoint), parameters, ptrSrc, count, ptrDst);
+            }
+            else
+            {
+                ConvertTintedToBgr24_AVX(IntensityPlainAvx<1>(255), parameters, ptrSrc, count, ptrDst);
+            }
+
+            return;
+        case libCZI::PixelType::Gray16:
+            if (ptrLut != nullptr)
+            {
+                ConvertTintedToBgr24_AVX(IntensityLutAvx<2>(ptrLut, 255), parameters, ptrSrc, count, ptrDst);
+            }
+            else if (parameters.enableBlackWhitePoint)
+            {
+                ConvertTintedToBgr24_AVX(IntensityBlackWhitePointAvx<2>(blackPoint, whitePoint), parameters, ptrSrc, count, ptrDst);
+            }
+            else
+            {
+                ConvertTintedToBgr24_AVX(IntensityPlainAvx<2>(256 * 256 - 1), parameters, ptrSrc, count, ptrDst);
+            }
+
+            return;
+        case libCZI::PixelType::Bgr24:
+            if (ptrLut != nullptr)
+            {
+                ConvertTintedToBgr24_AVX(IntensityLutAvx<3>(ptrLut, 3 * 255), parameters, ptrSrc, count, ptrDst);
+            }
+            else if (parameters.enableBlackWhitePoint)
+            {
+                ConvertTintedToBgr24_AVX(IntensityBlackWhitePointAvx<3>(blackPoint, whitePoint), parameters, ptrSrc, count, ptrDst);
+            }
+            else
+            {
+                ConvertTintedToBgr24_AVX(IntensityPlainAvx<3>(3 * 255), parameters, ptrSrc, count, ptrDst);
+            }
+
+            return;
+        case libCZI::PixelType::Bgr48:
+            if (ptrLut != nullptr)
+            {
+                ConvertTintedToBgr24_AVX(IntensityLutAvx<6>(ptrLut, 3 * 255), parameters, ptrSrc, count, ptrDst);
+            }
+            else if (parameters.enableBlackWhitePoint)
+            {
+                ConvertTintedToBgr24_AVX(IntensityBlackWhitePointAvx<6>(blackPoint, whitePoint), parameters, ptrSrc, count, ptrDst);
+            }
+            else
+            {
+                ConvertTintedToBgr24_AVX(IntensityPlainAvx<6>(3 * (256 * 256 - 1)), parameters, ptrSrc, count, ptrDst);
+            }
+
+            return;
+        default:
+            break;
+        }
+    }
+
+    // for an unsupported pixel type, the C-version will throw an exception
+    MultiChannelCompositorRowKernels::ConvertToBgr24_C(parameters, ptrSrc, count, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernelsAvx::AddSaturated_AVX(const std::uint8_t* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    const uint32_t countOver32 = count / 32;
+    for (uint32_t i = 0; i < countOver32; ++i)
+    {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptrSrc));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptrDst));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(ptrDst), _mm256_adds_epu8(a, b));
+        ptrSrc += 32;
+        ptrDst += 32;
+    }
+
+    _mm256_zeroupper();
+    MultiChannelCompositorRowKernels::AddSaturated_C(ptrSrc, count % 32, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernelsAvx::MultiplyWithWeight_AVX(const std::uint8_t* ptrSrc, float weight, __m128i& lo, __m128i& hi)
+{
+    // gives round(v * weight) for 16 bytes as 16-bit integers - with signed saturation, so that the values can be packed to
+    //  bytes with unsigned saturation subsequently
+    const __m256 w = _mm256_set1_ps(weight);
+    const __m256 half = _mm256_set1_ps(.5f);
+    const __m256i a = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(LoadGray8AsInt32Avx(ptrSrc)), w), half));
+    const __m256i b = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(LoadGray8AsInt32Avx(ptrSrc + 8)), w), half));
+    const __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xd8);
+    lo = _mm256_castsi256_si128(words);
+    hi = _mm256_extracti128_si256(words, 1);
+}
+
+/*static*/void MultiChannelCompositorRowKernelsAvx::StoreWithWeight_AVX(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst)
+{
+    const uint32_t countOver16 = count / 16;
+    for (uint32_t i = 0; i < countOver16; ++i)
+    {
+        __m128i lo, hi;
+        MultiplyWithWeight_AVX(ptrSrc, weight, lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ptrDst), _mm_packus_epi16(lo, hi));
+        ptrSrc += 16;
+        ptrDst += 16;
+    }
+
+    _mm256_zeroupper();
+    MultiChannelCompositorRowKernels::StoreWithWeight_C(ptrSrc, count % 16, weight, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernelsAvx::AddWithWeightSaturated_AVX(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst)
+{
+    const uint32_t countOver16 = count / 16;
+    for (uint32_t i = 0; i < countOver16; ++i)
+    {
+        __m128i lo, hi;
+        MultiplyWithWeight_AVX(ptrSrc, weight, lo, hi);
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptrDst));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ptrDst), _mm_adds_epu8(d, _mm_packus_epi16(lo, hi)));
+        ptrSrc += 16;
+        ptrDst += 16;
+    }
+
+    _mm256_zeroupper();
+    MultiChannelCompositorRowKernels::AddWithWeightSaturated_C(ptrSrc, count % 16, weight, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernelsAvx::ConvertToBgr24_Choose(const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    if (CheckWhetherCpuSupportsAVX2())
+    {
+        MultiChannelCompositorRowKernelsAvx::pfnConvertToBgr24 = MultiChannelCompositorRowKernelsAvx::ConvertToBgr24_AVX;
+    }
+    else
+    {
+        MultiChannelCompositorRowKernelsAvx::pfnConvertToBgr24 = MultiChannelCompositorRowKernelsAvx::ConvertToBgr24_C;
+    }
+
+    (*MultiChannelCompositorRowKernelsAvx::pfnConvertToBgr24)(parameters, ptrSrc, count, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernelsAvx::AddSaturated_Choose(const std::uint8_t* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    if (CheckWhetherCpuSupportsAVX2())
+    {
+        MultiChannelCompositorRowKernelsAvx::pfnAddSaturated = MultiChannelCompositorRowKernelsAvx::AddSaturated_AVX;
+    }
+    else
+    {
+        MultiChannelCompositorRowKernelsAvx::pfnAddSaturated = MultiChannelCompositorRowKernelsAvx::AddSaturated_C;
+    }
+
+    (*MultiChannelCompositorRowKernelsAvx::pfnAddSaturated)(ptrSrc, count, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernelsAvx::StoreWithWeight_Choose(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst)
+{
+    if (CheckWhetherCpuSupportsAVX2())
+    {
+        MultiChannelCompositorRowKernelsAvx::pfnStoreWithWeight = MultiChannelCompositorRowKernelsAvx::StoreWithWeight_AVX;
+    }
+    else
+    {
+        MultiChannelCompositorRowKernelsAvx::pfnStoreWithWeight = MultiChannelCompositorRowKernelsAvx::StoreWithWeight_C;
+    }
+
+    (*MultiChannelCompositorRowKernelsAvx::pfnStoreWithWeight)(ptrSrc, count, weight, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernelsAvx::AddWithWeightSaturated_Choose(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst)
+{
+    if (CheckWhetherCpuSupportsAVX2())
+    {
+        MultiChannelCompositorRowKernelsAvx::pfnAddWithWeightSaturated = MultiChannelCompositorRowKernelsAvx::AddWithWeightSaturated_AVX;
+    }
+    else
+    {
+        MultiChannelCompositorRowKernelsAvx::pfnAddWithWeightSaturated = MultiChannelCompositorRowKernelsAvx::AddWithWeightSaturated_C;
+    }
+
+    (*MultiChannelCompositorRowKernelsAvx::pfnAddWithWeightSaturated)(ptrSrc, count, weight, ptrDst);
+}
+
 #elif LIBCZI_HAS_NEOININTRINSICS
 
 #include <arm_neon.h>
@@ -302,4 +996,510 @@ LoHiBytePackUnpackAvx::pfnLoHiBytePackStrided_t LoHiBytePackUnpackAvx::pfnLoHiBy
         }
     }
 }
+
+/*static*/void RectangleSoaFilter::AndMaskWithIntersection(const libCZI::IntRect& roi, const std::int32_t* x, const std::int32_t* y, const std::int32_t* w, const std::int32_t* h, size_t count, std::uint8_t* mask)
+{
+    const int32x4_t roi_left = vdupq_n_s32(roi.x);
+    const int32x4_t roi_top = vdupq_n_s32(roi.y);
+    const int32x4_t roi_right = vaddq_s32(roi_left, vdupq_n_s32(roi.w));
+    const int32x4_t roi_bottom = vaddq_s32(roi_top, vdupq_n_s32(roi.h));
+    const size_t countOver4 = count / 4;
+
+    for (size_t i = 0; i < countOver4; ++i)
+    {
+        const int32x4_t vx = vld1q_s32(x);
+        const int32x4_t vy = vld1q_s32(y);
+        const int32x4_t x1 = vmaxq_s32(roi_left, vx);
+        const int32x4_t x2 = vminq_s32(roi_right, vaddq_s32(vx, vld1q_s32(w)));
+        const int32x4_t y1 = vmaxq_s32(roi_top, vy);
+        const int32x4_t y2 = vminq_s32(roi_bottom, vaddq_s32(vy, vld1q_s32(h)));
+        const uint32x4_t intersects = vandq_u32(vcgtq_s32(x2, x1), vcgtq_s32(y2, y1));
+
+        // narrow the lanes (which are either all-ones or all-zeros) to bytes, and then AND the four bytes with the mask
+        const uint16x4_t intersects16 = vmovn_u32(intersects);
+        const uint8x8_t intersects8 = vmovn_u16(vcombine_u16(intersects16, intersects16));
+        const uint32_t intersects_bytes = vget_lane_u32(vreinterpret_u32_u8(intersects8), 0);
+        uint32_t mask_bytes;
+        memcpy(&mask_bytes, mask, sizeof(mask_bytes));
+        mask_bytes &= intersects_bytes;
+        memcpy(mask, &mask_bytes, sizeof(mask_bytes));
+
+        x += 4;
+        y += 4;
+        w += 4;
+        h += 4;
+        mask += 4;
+    }
+
+    RectangleSoaFilter::AndMaskWithIntersection_C(roi, x, y, w, h, count % 4, mask);
+}
+
+namespace
+{
+    // Helpers for the row kernels of the multi-channel compositor. Note that the floating-point operations (and their order) are
+    //  exactly the same as with the scalar versions, so that the results are identical.
+
+    inline float32x4_t DivideNeon(float32x4_t a, float32x4_t b)
+    {
+#if defined(__aarch64__) || defined(_M_ARM64)
+        return vdivq_f32(a, b);
+#else
+        // there is no (correctly rounded) division with ARMv7-NEON, so we divide lane by lane
+        float va[4], vb[4];
+        vst1q_f32(va, a);
+        vst1q_f32(vb, b);
+        for (int i = 0; i < 4; ++i)
+        {
+            va[i] /= vb[i];
+        }
+
+        return vld1q_f32(va);
+#endif
+    }
+
+    inline uint8x8_t NarrowToBytesNeon(uint32x4_t lo, uint32x4_t hi)
+    {
+        return vmovn_u16(vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)));
+    }
+
+    inline uint8x8_t TintToBytesNeon(float32x4_t lo, float32x4_t hi, float32x4_t tinting)
+    {
+        const float32x4_t half = vdupq_n_f32(.5f);
+        return NarrowToBytesNeon(
+            vcvtq_u32_f32(vaddq_f32(vmulq_f32(lo, tinting), half)),
+            vcvtq_u32_f32(vaddq_f32(vmulq_f32(hi, tinting), half)));
+    }
+
+    inline void WidenBytesNeon(uint8x8_t v, uint32x4_t& lo, uint32x4_t& hi)
+    {
+        const uint16x8_t words = vmovl_u8(v);
+        lo = vmovl_u16(vget_low_u16(words));
+        hi = vmovl_u16(vget_high_u16(words));
+    }
+
+    inline void WidenWordsNeon(uint16x8_t v, uint32x4_t& lo, uint32x4_t& hi)
+    {
+        lo = vmovl_u16(vget_low_u16(v));
+        hi = vmovl_u16(vget_high_u16(v));
+    }
+
+    /// Gets the sums of blue, green and red of 8 BGR24- or BGR48-pixels.
+    inline void LoadBgrAsSumNeon(const uint8_t* p, int bytesPerPel, uint32x4_t& lo, uint32x4_t& hi)
+    {
+        if (bytesPerPel == 3)
+        {
+            const uint8x8x3_t bgr = vld3_u8(p);
+            WidenWordsNeon(vaddw_u8(vaddl_u8(bgr.val[0], bgr.val[1]), bgr.val[2]), lo, hi);
+        }
+        else
+        {
+            const uint16x8x3_t bgr = vld3q_u16(reinterpret_cast<const uint16_t*>(p));
+            lo = vaddw_u16(vaddl_u16(vget_low_u16(bgr.val[0]), vget_low_u16(bgr.val[1])), vget_low_u16(bgr.val[2]));
+            hi = vaddw_u16(vaddl_u16(vget_high_u16(bgr.val[0]), vget_high_u16(bgr.val[1])), vget_high_u16(bgr.val[2]));
+        }
+    }
+
+    /// Loads 8 pixels as integers - for a BGR pixel type, the sum of blue, green and red.
+    inline void LoadAsInt32Neon(const uint8_t* p, int bytesPerPel, uint32x4_t& lo, uint32x4_t& hi)
+    {
+        switch (bytesPerPel)
+        {
+        case 1:
+            WidenBytesNeon(vld1_u8(p), lo, hi);
+            break;
+        case 2:
+            WidenWordsNeon(vld1q_u16(reinterpret_cast<const uint16_t*>(p)), lo, hi);
+            break;
+        default:
+            LoadBgrAsSumNeon(p, bytesPerPel, lo, hi);
+            break;
+        }
+    }
+
+    /// The "integer intensity" of a BGR-pixel as it is used with the black- and white-point, which is (b+g+r+1)/3.
+    inline uint32x4_t SumToAverageNeon(uint32x4_t sum)
+    {
+        // the division is exact for sums < 2^21 (and the sum of 3 16-bit values is smaller)
+        return vcvtq_u32_f32(DivideNeon(vcvtq_f32_u32(vaddq_u32(sum, vdupq_n_u32(1))), vdupq_n_f32(3)));
+    }
+
+    inline float32x4_t BlackWhitePointToIntensityNeon(uint32x4_t v, uint32x4_t blackPoint, uint32x4_t whitePoint, float32x4_t range)
+    {
+        const float32x4_t f = DivideNeon(vcvtq_f32_s32(vreinterpretq_s32_u32(vsubq_u32(v, blackPoint))), range);
+        const float32x4_t fWhite = vbslq_f32(vcltq_u32(v, whitePoint), f, vdupq_n_f32(1));
+        return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(fWhite), vcgtq_u32(v, blackPoint)));
+    }
+
+    inline uint32x4_t BlackWhitePointToByteNeon(uint32x4_t v, uint32x4_t blackPoint, uint32x4_t whitePoint, float32x4_t range)
+    {
+        const float32x4_t m = vmulq_f32(DivideNeon(vcvtq_f32_s32(vreinterpretq_s32_u32(vsubq_u32(v, blackPoint))), range), vdupq_n_f32(255));
+
+        // the scalar version adds 0.5 in double precision before truncating, which is the same as rounding half up (and
+        //  different from adding 0.5 in single precision) - so, we add one if the fractional part is >= 0.5
+        const uint32x4_t t = vcvtq_u32_f32(m);
+        const float32x4_t fraction = vsubq_f32(m, vcvtq_f32_u32(t));
+        const uint32x4_t rounded = vsubq_u32(t, vcgeq_f32(fraction, vdupq_n_f32(.5f)));
+        const uint32x4_t white = vbslq_u32(vcltq_u32(v, whitePoint), rounded, vdupq_n_u32(0xff));
+        return vandq_u32(white, vcgtq_u32(v, blackPoint));
+    }
+
+    // The "sample converters" give 16 bytes for 16 samples.
+    struct SampleConverter8Neon
+    {
+        static const int bytesPerSample = 1;
+        uint8x16_t operator()(const uint8_t* p) const
+        {
+            return vld1q_u8(p);
+        }
+    };
+
+    struct SampleConverter16Neon
+    {
+        static const int bytesPerSample = 2;
+        uint8x16_t operator()(const uint8_t* p) const
+        {
+            const uint16_t* pUs = reinterpret_cast<const uint16_t*>(p);
+            return vcombine_u8(vshrn_n_u16(vld1q_u16(pUs), 8), vshrn_n_u16(vld1q_u16(pUs + 8), 8));
+        }
+    };
+
+    template <typename tSample>
+    struct SampleConverterLutNeon
+    {
+        static const int bytesPerSample = sizeof(tSample);
+        const uint8_t* ptrLut;
+        explicit SampleConverterLutNeon(const uint8_t* ptrLut) : ptrLut(ptrLut) {}
+        uint8x16_t operator()(const uint8_t* p) const
+        {
+            const tSample* pSample = reinterpret_cast<const tSample*>(p);
+            uint8_t v[16];
+            for (int i = 0; i < 16; ++i)
+            {
+                v[i] = this->ptrLut[pSample[i]];
+            }
+
+            return vld1q_u8(v);
+        }
+    };
+
+    template <int tBytesPerSample>
+    struct SampleConverterBlackWhitePointNeon
+    {
+        static const int bytesPerSample = tBytesPerSample;
+        uint32x4_t blackPoint, whitePoint;
+        float32x4_t range;
+        SampleConverterBlackWhitePointNeon(int blackPoint, int whitePoint)
+            : blackPoint(vdupq_n_u32(blackPoint)), whitePoint(vdupq_n_u32(whitePoint)), range(vdupq_n_f32(float(whitePoint - blackPoint)))
+        {}
+
+        uint8x16_t operator()(const uint8_t* p) const
+        {
+            uint32x4_t v0, v1, v2, v3;
+            LoadAsInt32Neon(p, tBytesPerSample, v0, v1);
+            LoadAsInt32Neon(p + 8 * tBytesPerSample, tBytesPerSample, v2, v3);
+            return vcombine_u8(
+                NarrowToBytesNeon(this->ToByte(v0), this->ToByte(v1)),
+                NarrowToBytesNeon(this->ToByte(v2), this->ToByte(v3)));
+        }
+
+        uint32x4_t ToByte(uint32x4_t v) const
+        {
+            return BlackWhitePointToByteNeon(v, this->blackPoint, this->whitePoint, this->range);
+        }
+    };
+
+    // The "intensity getters" give the intensities (in the range 0 to 1) of 8 pixels.
+    template <int tBytesPerPel>
+    struct IntensityPlainNeon
+    {
+        static const int bytesPerPel = tBytesPerPel;
+        float32x4_t divisor;
+        explicit IntensityPlainNeon(float divisor) : divisor(vdupq_n_f32(divisor)) {}
+        void operator()(const uint8_t* p, float32x4_t& lo, float32x4_t& hi) const
+        {
+            uint32x4_t vLo, vHi;
+            LoadAsInt32Neon(p, tBytesPerPel, vLo, vHi);
+            lo = DivideNeon(vcvtq_f32_u32(vLo), this->divisor);
+            hi = DivideNeon(vcvtq_f32_u32(vHi), this->divisor);
+        }
+    };
+
+    template <int tBytesPerPel>
+    struct IntensityLutNeon
+    {
+        static const int bytesPerPel = tBytesPerPel;
+        const uint8_t* ptrLut;
+        float32x4_t divisor;
+        IntensityLutNeon(const uint8_t* ptrLut, float divisor) : ptrLut(ptrLut), divisor(vdupq_n_f32(divisor)) {}
+        void operator()(const uint8_t* p, float32x4_t& lo, float32x4_t& hi) const
+        {
+            uint32_t v[8];
+            for (int i = 0; i < 8; ++i)
+            {
+                v[i] = this->GetLutSum(p + i * tBytesPerPel);
+            }
+
+            lo = DivideNeon(vcvtq_f32_u32(vld1q_u32(v)), this->divisor);
+            hi = DivideNeon(vcvtq_f32_u32(vld1q_u32(v + 4)), this->divisor);
+        }
+
+        uint32_t GetLutSum(const uint8_t* p) const
+        {
+            const uint16_t* pUs = reinterpret_cast<const uint16_t*>(p);
+            switch (tBytesPerPel)
+            {
+            case 1:
+                return this->ptrLut[*p];
+            case 2:
+                return this->ptrLut[*pUs];
+            case 3:
+                return static_cast<uint32_t>(this->ptrLut[p[0]]) + this->ptrLut[p[1]] + this->ptrLut[p[2]];
+            default:
+                return static_cast<uint32_t>(this->ptrLut[pUs[0]]) + this->ptrLut[pUs[1]] + this->ptrLut[pUs[2]];
+            }
+        }
+    };
+
+    template <int tBytesPerPel>
+    struct IntensityBlackWhitePointNeon
+    {
+        static const int bytesPerPel = tBytesPerPel;
+        uint32x4_t blackPoint, whitePoint;
+        float32x4_t range;
+        IntensityBlackWhitePointNeon(int blackPoint, int whitePoint)
+            : blackPoint(vdupq_n_u32(blackPoint)), whitePoint(vdupq_n_u32(whitePoint)), range(vdupq_n_f32(float(whitePoint - blackPoint)))
+        {}
+
+        void operator()(const uint8_t* p, float32x4_t& lo, float32x4_t& hi) const
+        {
+            uint32x4_t vLo, vHi;
+            LoadAsInt32Neon(p, tBytesPerPel, vLo, vHi);
+            if (tBytesPerPel > 2)
+            {
+                vLo = SumToAverageNeon(vLo);
+                vHi = SumToAverageNeon(vHi);
+            }
+
+            lo = BlackWhitePointToIntensityNeon(vLo, this->blackPoint, this->whitePoint, this->range);
+            hi = BlackWhitePointToIntensityNeon(vHi, this->blackPoint, this->whitePoint, this->range);
+        }
+    };
+
+    /// Converts the pixels in units of 16 pixels, and returns the number of pixels which have been converted.
+    template <typename tSampleConverter>
+    uint32_t ConvertSamplesToBgr24Neon(const tSampleConverter& converter, bool isGray, const void* ptrSrc, uint32_t count, uint8_t* ptrDst)
+    {
+        const uint8_t* pSrc = static_cast<const uint8_t*>(ptrSrc);
+        const uint32_t countOver16 = count / 16;
+        for (uint32_t i = 0; i < countOver16; ++i)
+        {
+            if (isGray)
+            {
+                const uint8x16_t gray = converter(pSrc);
+                uint8x16x3_t bgr;
+                bgr.val[0] = bgr.val[1] = bgr.val[2] = gray;
+                vst3q_u8(ptrDst, bgr);
+                pSrc += 16 * tSampleConverter::bytesPerSample;
+            }
+            else
+            {
+                for (int n = 0; n < 3; ++n)
+                {
+                    vst1q_u8(ptrDst + n * 16, converter(pSrc));
+                    pSrc += 16 * tSampleConverter::bytesPerSample;
+                }
+            }
+
+            ptrDst += 48;
+        }
+
+        return countOver16 * 16;
+    }
+
+    /// Converts the pixels in units of 8 pixels, and returns the number of pixels which have been converted.
+    template <typename tIntensity>
+    uint32_t ConvertTintedToBgr24Neon(const tIntensity& intensity, const libCZI::Rgb8Color& tintingColor, const void* ptrSrc, uint32_t count, uint8_t* ptrDst)
+    {
+        const float32x4_t tintingB = vdupq_n_f32(tintingColor.b);
+        const float32x4_t tintingG = vdupq_n_f32(tintingColor.g);
+        const float32x4_t tintingR = vdupq_n_f32(tintingColor.r);
+        const uint8_t* pSrc = static_cast<const uint8_t*>(ptrSrc);
+        const uint32_t countOver8 = count / 8;
+        for (uint32_t i = 0; i < countOver8; ++i)
+        {
+            float32x4_t lo, hi;
+            intensity(pSrc, lo, hi);
+            uint8x8x3_t bgr;
+            bgr.val[0] = TintToBytesNeon(lo, hi, tintingB);
+            bgr.val[1] = TintToBytesNeon(lo, hi, tintingG);
+            bgr.val[2] = TintToBytesNeon(lo, hi, tintingR);
+            vst3_u8(ptrDst, bgr);
+            pSrc += 8 * tIntensity::bytesPerPel;
+            ptrDst += 24;
+        }
+
+        return countOver8 * 8;
+    }
+
+    uint32_t ConvertToBgr24Neon(const MultiChannelCompositorRowKernels::ChannelParameters& parameters, const void* ptrSrc, uint32_t count, uint8_t* ptrDst)
+    {
+        const uint8_t* ptrLut = parameters.ptrLookUpTable;
+        const int blackPoint = parameters.blackPoint;
+        const int whitePoint = parameters.whitePoint;
+        if (!parameters.enableTinting)
+        {
+            const bool isGray = parameters.pixelType == libCZI::PixelType::Gray8 || parameters.pixelType == libCZI::PixelType::Gray16;
+            switch (parameters.pixelType)
+            {
+            case libCZI::PixelType::Gray8:
+            case libCZI::PixelType::Bgr24:
+                if (ptrLut != nullptr)
+                {
+                    return ConvertSamplesToBgr24Neon(SampleConverterLutNeon<uint8_t>(ptrLut), isGray, ptrSrc, count, ptrDst);
+                }
+                else if (parameters.enableBlackWhitePoint)
+                {
+                    return ConvertSamplesToBgr24Neon(SampleConverterBlackWhitePointNeon<1>(blackPoint, whitePoint), isGray, ptrSrc, count, ptrDst);
+                }
+
+                return ConvertSamplesToBgr24Neon(SampleConverter8Neon(), isGray, ptrSrc, count, ptrDst);
+            case libCZI::PixelType::Gray16:
+            case libCZI::PixelType::Bgr48:
+                if (ptrLut != nullptr)
+                {
+                    return ConvertSamplesToBgr24Neon(SampleConverterLutNeon<uint16_t>(ptrLut), isGray, ptrSrc, count, ptrDst);
+                }
+                else if (parameters.enableBlackWhitePoint)
+                {
+                    return ConvertSamplesToBgr24Neon(SampleConverterBlackWhitePointNeon<2>(blackPoint, whitePoint), isGray, ptrSrc, count, ptrDst);
+                }
+
+                return ConvertSamplesToBgr24Neon(SampleConverter16Neon(), isGray, ptrSrc, count, ptrDst);
+            default:
+                return 0;
+            }
+        }
+
+        const libCZI::Rgb8Color& tintingColor = parameters.tintingColor;
+        switch (parameters.pixelType)
+        {
+        case libCZI::PixelType::Gray8:
+            if (ptrLut != nullptr)
+            {
+                return ConvertTintedToBgr24Neon(IntensityLutNeon<1>(ptrLut, 255), tintingColor, ptrSrc, count, ptrDst);
+            }
+            else if (parameters.enableBlackWhitePoint)
+            {
+                return ConvertTintedToBgr24Neon(IntensityBlackWhitePointNeon<1>(blackPoint, whitePoint), tintingColor, ptrSrc, count, ptrDst);
+            }
+
+            return ConvertTintedToBgr24Neon(IntensityPlainNeon<1>(255), tintingColor, ptrSrc, count, ptrDst);
+        case libCZI::PixelType::Gray16:
+            if (ptrLut != nullptr)
+            {
+                return ConvertTintedToBgr24Neon(IntensityLutNeon<2>(ptrLut, 255), tintingColor, ptrSrc, count, ptrDst);
+            }
+            else if (parameters.enableBlackWhitePoint)
+            {
+                return ConvertTintedToBgr24Neon(IntensityBlackWhitePointNeon<2>(blackPoint, whitePoint), tintingColor, ptrSrc, count, ptrDst);
+            }
+
+            return ConvertTintedToBgr24Neon(IntensityPlainNeon<2>(256 * 256 - 1), tintingColor, ptrSrc, count, ptrDst);
+        case libCZI::PixelType::Bgr24:
+            if (ptrLut != nullptr)
+            {
+                return ConvertTintedToBgr24Neon(IntensityLutNeon<3>(ptrLut, 3 * 255), tintingColor, ptrSrc, count, ptrDst);
+            }
+            else if (parameters.enableBlackWhitePoint)
+            {
+                return ConvertTintedToBgr24Neon(IntensityBlackWhitePointNeon<3>(blackPoint, whitePoint), tintingColor, ptrSrc, count, ptrDst);
+            }
+
+            return ConvertTintedToBgr24Neon(IntensityPlainNeon<3>(3 * 255), tintingColor, ptrSrc, count, ptrDst);
+        case libCZI::PixelType::Bgr48:
+            if (ptrLut != nullptr)
+            {
+                return ConvertTintedToBgr24Neon(IntensityLutNeon<6>(ptrLut, 3 * 255), tintingColor, ptrSrc, count, ptrDst);
+            }
+            else if (parameters.enableBlackWhitePoint)
+            {
+                return ConvertTintedToBgr24Neon(IntensityBlackWhitePointNeon<6>(blackPoint, whitePoint), tintingColor, ptrSrc, count, ptrDst);
+            }
+
+            return ConvertTintedToBgr24Neon(IntensityPlainNeon<6>(3 * (256 * 256 - 1)), tintingColor, ptrSrc, count, ptrDst);
+        default:
+            return 0;
+        }
+    }
+
+    /// Gives round(v * weight) for 16 bytes, saturated to bytes.
+    inline uint8x16_t MultiplyWithWeightNeon(const uint8_t* ptrSrc, float32x4_t weight)
+    {
+        const float32x4_t half = vdupq_n_f32(.5f);
+        const uint8x16_t v = vld1q_u8(ptrSrc);
+        uint32x4_t w[4];
+        WidenBytesNeon(vget_low_u8(v), w[0], w[1]);
+        WidenBytesNeon(vget_high_u8(v), w[2], w[3]);
+        for (int i = 0; i < 4; ++i)
+        {
+            w[i] = vcvtq_u32_f32(vaddq_f32(vmulq_f32(vcvtq_f32_u32(w[i]), weight), half));
+        }
+
+        return vcombine_u8(
+            vqmovn_u16(vcombine_u16(vqmovn_u32(w[0]), vqmovn_u32(w[1]))),
+            vqmovn_u16(vcombine_u16(vqmovn_u32(w[2]), vqmovn_u32(w[3]))));
+    }
+}
+
+/*static*/void MultiChannelCompositorRowKernels::ConvertToBgr24(const ChannelParameters& parameters, const void* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    const uint32_t pixelsConverted = ConvertToBgr24Neon(parameters, ptrSrc, count, ptrDst);
+    const uint8_t bytesPerPel = pixelsConverted > 0 ? libCZI::Utils::GetBytesPerPixel(parameters.pixelType) : 0;
+    MultiChannelCompositorRowKernels::ConvertToBgr24_C(
+        parameters,
+        static_cast<const uint8_t*>(ptrSrc) + static_cast<size_t>(pixelsConverted) * bytesPerPel,
+        count - pixelsConverted,
+        ptrDst + static_cast<size_t>(pixelsConverted) * 3);
+}
+
+/*static*/void MultiChannelCompositorRowKernels::AddSaturated(const std::uint8_t* ptrSrc, std::uint32_t count, std::uint8_t* ptrDst)
+{
+    const uint32_t countOver16 = count / 16;
+    for (uint32_t i = 0; i < countOver16; ++i)
+    {
+        vst1q_u8(ptrDst, vqaddq_u8(vld1q_u8(ptrSrc), vld1q_u8(ptrDst)));
+        ptrSrc += 16;
+        ptrDst += 16;
+    }
+
+    MultiChannelCompositorRowKernels::AddSaturated_C(ptrSrc, count % 16, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernels::StoreWithWeight(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst)
+{
+    const float32x4_t w = vdupq_n_f32(weight);
+    const uint32_t countOver16 = count / 16;
+    for (uint32_t i = 0; i < countOver16; ++i)
+    {
+        vst1q_u8(ptrDst, MultiplyWithWeightNeon(ptrSrc, w));
+        ptrSrc += 16;
+        ptrDst += 16;
+    }
+
+    MultiChannelCompositorRowKernels::StoreWithWeight_C(ptrSrc, count % 16, weight, ptrDst);
+}
+
+/*static*/void MultiChannelCompositorRowKernels::AddWithWeightSaturated(const std::uint8_t* ptrSrc, std::uint32_t count, float weight, std::uint8_t* ptrDst)
+{
+    const float32x4_t w = vdupq_n_f32(weight);
+    const uint32_t countOver16 = count / 16;
+    for (uint32_t i = 0; i < countOver16; ++i)
+    {
+        vst1q_u8(ptrDst, vqaddq_u8(vld1q_u8(ptrDst), MultiplyWithWeightNeon(ptrSrc, w)));
+        ptrSrc += 16;
+        ptrDst += 16;
+    }
+
+    MultiChannelCompositorRowKernels::AddWithWeightSaturated_C(ptrSrc, count % 16, weight, ptrDst);
+}
 #endif
@@ -4,6 +4,8 @@
 
 #include "include_gtest.h"
 #include <array>
+#include <atomic>
+#include <cmath>
 #include <tuple>
 #include <memory>
 #include "inc_libCZI.h"
@@ -743,3 +745,646 @@ TEST(Accessor, CreateDocumentAndCheckSingleChannelScalingAccessorWithSubBlockCac
         EXPECT_EQ(pixel_x1_y1, 4);
     }
 }
+
+/// Creates a synthetic CZI document with a mosaic of 7x7 overlapping subblocks (of size 16x16 pixels, placed on a grid
+/// with a spacing of 12 pixels). Each subblock is filled with a distinct value, and the M-index is assigned in an order
+/// which differs from the order of the grid-position, so that the z-order is relevant for the result.
+///
+/// \returns    A blob containing a CZI document.
+static tuple<shared_ptr<void>, size_t> CreateCziWithManyOverlappingSubblocks()
+{
+    auto writer = CreateCZIWriter();
+    auto outStream = make_shared<CMemOutputStream>(0);
+
+    constexpr int kTilesPerRow = 7;
+    constexpr int kTileCount = kTilesPerRow * kTilesPerRow;
+    auto spWriterInfo = make_shared<CCziWriterInfo >(
+        GUID{ 0x1234567,0x89ab,0xcdef,{ 1,2,3,4,5,6,7,8 } },
+        CDimBounds{ { DimensionIndex::C, 0, 1 } },	// set a bounds for C
+        0, kTileCount - 1);	// set a bounds M : 0<=m<kTileCount
+    writer->Create(outStream, spWriterInfo);
+
+    for (int i = 0; i < kTileCount; ++i)
+    {
+        auto bitmap = CreateGray8BitmapAndFill(16, 16, static_cast<uint8_t>(i + 1));
+        AddSubBlockInfoStridedBitmap addSbBlkInfo;
+        addSbBlkInfo.Clear();
+        addSbBlkInfo.coordinate.Set(DimensionIndex::C, 0);
+        addSbBlkInfo.mIndexValid = true;
+        addSbBlkInfo.mIndex = (i * 17) % kTileCount;    // 17 and 49 are coprime, so this is a permutation
+        addSbBlkInfo.x = (i % kTilesPerRow) * 12;
+        addSbBlkInfo.y = (i / kTilesPerRow) * 12;
+        addSbBlkInfo.logicalWidth = bitmap->GetWidth();
+        addSbBlkInfo.logicalHeight = bitmap->GetHeight();
+        addSbBlkInfo.physicalWidth = bitmap->GetWidth();
+        addSbBlkInfo.physicalHeight = bitmap->GetHeight();
+        addSbBlkInfo.PixelType = bitmap->GetPixelType();
+        ScopedBitmapLockerSP lock_info_bitmap{ bitmap };
+        addSbBlkInfo.ptrBitmap = lock_info_bitmap.ptrDataRoi;
+        addSbBlkInfo.strideBitmap = lock_info_bitmap.stride;
+        writer->SyncAddSubBlock(addSbBlkInfo);
+    }
+
+    PrepareMetadataInfo prepare_metadata_info;
+    auto metaDataBuilder = writer->GetPreparedMetadata(prepare_metadata_info);
+    WriteMetadataInfo write_metadata_info;
+    write_metadata_info.Clear();
+    const auto& strMetadata = metaDataBuilder->GetXml();
+    write_metadata_info.szMetadata = strMetadata.c_str();
+    write_metadata_info.szMetadataSize = strMetadata.size() + 1;
+    writer->SyncWriteMetadata(write_metadata_info);
+    writer->Close();
+    writer.reset();
+
+    size_t czi_document_size = 0;
+    shared_ptr<void> czi_document_data = outStream->GetCopy(&czi_document_size);
+    return make_tuple(czi_document_data, czi_document_size);
+}
+
+static bool AreGray8BitmapsEqual(const shared_ptr<IBitmapData>& a, const shared_ptr<IBitmapData>& b)
+{
+    if (a->GetWidth() != b->GetWidth() || a->GetHeight() != b->GetHeight())
+    {
+        return false;
+    }
+
+    const ScopedBitmapLockerSP lock_a{ a };
+    const ScopedBitmapLockerSP lock_b{ b };
+    for (uint32_t y = 0; y < a->GetHeight(); ++y)
+    {
+        if (memcmp(static_cast<const uint8_t*>(lock_a.ptrDataRoi) + static_cast<size_t>(y) * lock_a.stride,
+                   static_cast<const uint8_t*>(lock_b.ptrDataRoi) + static_cast<size_t>(y) * lock_b.stride,
+                   a->GetWidth()) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+TEST(Accessor, CreateDocumentWithManyOverlappingSubblocksAndCompareConcurrentDecodingWithSequentialDecoding)
+{
+    // We create a document with many overlapping subblocks, and then compose a few ROIs with the single-channel tile accessor,
+    // once with sequential decoding and once with concurrent decoding (with and without visibility-check optimization, and
+    // with a subblock-cache). We expect the results to be identical.
+
+    // arrange
+    auto czi_document_as_blob = CreateCziWithManyOverlappingSubblocks();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto reader = CreateCZIReader();
+    reader->Open(memory_stream);
+    const auto accessor = reader->CreateSingleChannelTileAccessor();
+    const CDimCoordinate plane_coordinate{ {DimensionIndex::C, 0} };
+    const IntRect rois[] = { IntRect{ 0,0,88,88 }, IntRect{ 5,7,40,33 }, IntRect{ 30,10,1,60 } };
+
+    for (const bool use_visibility_check_optimization : { false, true })
+    {
+        for (const bool use_cache : { false, true })
+        {
+            for (const auto& roi : rois)
+            {
+                ISingleChannelTileAccessor::Options options;
+                options.Clear();
+                options.useVisibilityCheckOptimization = use_visibility_check_optimization;
+                options.backGroundColor = RgbFloatColor{ 0, 0, 0 };
+                if (use_cache)
+                {
+                    options.subBlockCache = CreateSubBlockCache();
+                    options.onlyUseSubBlockCacheForCompressedData = false;
+                }
+
+                // act
+                const auto composite_sequential = accessor->Get(PixelType::Gray8, roi, &plane_coordinate, &options);
+                options.maxNumberOfDecodeThreads = 4;
+                const auto composite_concurrent = accessor->Get(PixelType::Gray8, roi, &plane_coordinate, &options);
+
+                // assert
+                EXPECT_TRUE(AreGray8BitmapsEqual(composite_sequential, composite_concurrent));
+            }
+        }
+    }
+}
+
+TEST(Accessor, CreateDocumentWithManyOverlappingSubblocksAndCheckThatAccessorUsesBatchedReads)
+{
+    // We use a stream which implements batched reads, and check that the tile accessor reads all sub-blocks
+    // of a viewport with batched reads (and gives the same result as with a stream without batched reads).
+
+    class CBatchReadCountingStream : public libCZI::IStreamEx
+    {
+    private:
+        shared_ptr<CMemInputOutputStream> memory_stream_;
+    public:
+        atomic<int> read_calls{ 0 };
+        atomic<int> read_many_calls{ 0 };
+
+        explicit CBatchReadCountingStream(shared_ptr<CMemInputOutputStream> memory_stream) : memory_stream_(std::move(memory_stream)) {}
+
+        void Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead) override
+        {
+            ++this->read_calls;
+            this->memory_stream_->Read(offset, pv, size, ptrBytesRead);
+        }
+
+        bool TryGetDirectAccess(std::uint64_t offset, std::uint64_t size, std::shared_ptr<const void>& data) override
+        {
+            return false;
+        }
+
+        void ReadMany(StreamReadRange* ranges, size_t count) override
+        {
+            ++this->read_many_calls;
+            for (size_t i = 0; i < count; ++i)
+            {
+                this->memory_stream_->Read(ranges[i].offset, ranges[i].data, ranges[i].size, &ranges[i].bytes_read);
+            }
+        }
+    };
+
+    // arrange
+    auto czi_document_as_blob = CreateCziWithManyOverlappingSubblocks();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto batch_read_stream = make_shared<CBatchReadCountingStream>(memory_stream);
+    const auto reader = CreateCZIReader();
+    reader->Open(memory_stream);
+    const auto reader_batched = CreateCZIReader();
+    reader_batched->Open(batch_read_stream);
+    const auto accessor = reader->CreateSingleChannelTileAccessor();
+    const auto accessor_batched = reader_batched->CreateSingleChannelTileAccessor();
+    const CDimCoordinate plane_coordinate{ {DimensionIndex::C, 0} };
+
+    for (const int max_number_of_decode_threads : { 1, 4 })
+    {
+        ISingleChannelTileAccessor::Options options;
+        options.Clear();
+        options.backGroundColor = RgbFloatColor{ 0, 0, 0 };
+        options.maxNumberOfDecodeThreads = max_number_of_decode_threads;
+        batch_read_stream->read_calls = 0;
+        batch_read_stream->read_many_calls = 0;
+
+        // act
+        const auto composite = accessor->Get(PixelType::Gray8, IntRect{ 0,0,88,88 }, &plane_coordinate, &options);
+        const auto composite_batched = accessor_batched->Get(PixelType::Gray8, IntRect{ 0,0,88,88 }, &plane_coordinate, &options);
+
+        // assert - all 49 sub-blocks are read with one batch (i.e. one batched read for the headers and one for the segments)
+        EXPECT_TRUE(AreGray8BitmapsEqual(composite, composite_batched));
+        EXPECT_EQ(batch_read_stream->read_calls.load(), 0);
+        EXPECT_EQ(batch_read_stream->read_many_calls.load(), 2);
+    }
+}
+
+TEST(Accessor, CreateDocumentWithManyOverlappingSubblocksAndCheckThatCompressedTierOfCacheAvoidsReading)
+{
+    // We use a cache with a compressed tier, and check that after evicting all bitmaps from the cache, the viewport can be
+    // composed again without reading from the stream (with sequential and with concurrent decoding).
+
+    class CReadCountingStream : public libCZI::IStream
+    {
+    private:
+        shared_ptr<CMemInputOutputStream> memory_stream_;
+    public:
+        atomic<int> read_calls{ 0 };
+
+        explicit CReadCountingStream(shared_ptr<CMemInputOutputStream> memory_stream) : memory_stream_(std::move(memory_stream)) {}
+
+        void Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead) override
+        {
+            ++this->read_calls;
+            this->memory_stream_->Read(offset, pv, size, ptrBytesRead);
+        }
+    };
+
+    // arrange
+    auto czi_document_as_blob = CreateCziWithManyOverlappingSubblocks();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto counting_stream = make_shared<CReadCountingStream>(memory_stream);
+    const auto reader = CreateCZIReader();
+    reader->Open(counting_stream);
+    const auto accessor = reader->CreateSingleChannelTileAccessor();
+    const CDimCoordinate plane_coordinate{ {DimensionIndex::C, 0} };
+
+    for (const int max_number_of_decode_threads : { 1, 4 })
+    {
+        SubBlockCacheOptions cache_options;
+        cache_options.type = SubBlockCacheOptions::Type::Sharded;
+        cache_options.enable_compressed_tier = true;
+        const auto cache = CreateSubBlockCache(&cache_options);
+        ISingleChannelTileAccessor::Options options;
+        options.Clear();
+        options.backGroundColor = RgbFloatColor{ 0, 0, 0 };
+        options.maxNumberOfDecodeThreads = max_number_of_decode_threads;
+        options.subBlockCache = cache;
+        options.onlyUseSubBlockCacheForCompressedData = false;
+
+        const auto composite = accessor->Get(PixelType::Gray8, IntRect{ 0,0,88,88 }, &plane_coordinate, &options);
+        auto statistics = cache->GetStatistics(ISubBlockCacheStatistics::kElementsCount | ISubBlockCacheStatistics::kCompressedTierElementsCount);
+        EXPECT_EQ(statistics.elementsCount, 49u);
+        EXPECT_EQ(statistics.compressedTierElementsCount, 49u);
+
+        // act - evict all bitmaps, so that only the compressed tier is left
+        ISubBlockCache::PruneOptions prune_options;
+        prune_options.maxMemoryUsage = 0;
+        cache->Prune(prune_options);
+        counting_stream->read_calls = 0;
+        const auto composite_from_compressed_tier = accessor->Get(PixelType::Gray8, IntRect{ 0,0,88,88 }, &plane_coordinate, &options);
+
+        // assert - nothing was read, and the bitmaps are in the decoded tier again
+        EXPECT_TRUE(AreGray8BitmapsEqual(composite, composite_from_compressed_tier));
+        EXPECT_EQ(counting_stream->read_calls.load(), 0);
+        statistics = cache->GetStatistics(ISubBlockCacheStatistics::kElementsCount | ISubBlockCacheStatistics::kCompressedTierElementsCount);
+        EXPECT_EQ(statistics.elementsCount, 49u);
+        EXPECT_EQ(statistics.compressedTierElementsCount, 49u);
+    }
+}
+
+TEST(Accessor, CreateDocumentWithManyOverlappingSubblocksAndCompareConcurrentDecodingWithSequentialDecodingForScalingAndPyramidLayerAccessor)
+{
+    // Same as above, but for the scaling accessor (with different zoom factors) and the pyramid-layer accessor, and
+    // with different priorities.
+
+    // arrange
+    auto czi_document_as_blob = CreateCziWithManyOverlappingSubblocks();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto reader = CreateCZIReader();
+    reader->Open(memory_stream);
+    const auto scaling_accessor = reader->CreateSingleChannelScalingTileAccessor();
+    const auto pyramid_layer_accessor = reader->CreateSingleChannelPyramidLayerTileAccessor();
+    const CDimCoordinate plane_coordinate{ {DimensionIndex::C, 0} };
+    const IntRect rois[] = { IntRect{ 0,0,88,88 }, IntRect{ 5,7,40,33 } };
+
+    for (const auto priority : { TaskPriority::Interactive, TaskPriority::Background })
+    {
+        for (const auto& roi : rois)
+        {
+            for (const float zoom : { 1.f, 0.37f })
+            {
+                for (const bool use_visibility_check_optimization : { false, true })
+                {
+                    ISingleChannelScalingTileAccessor::Options options;
+                    options.Clear();
+                    options.useVisibilityCheckOptimization = use_visibility_check_optimization;
+                    options.backGroundColor = RgbFloatColor{ 0, 0, 0 };
+                    options.decodeTaskPriority = priority;
+
+                    // act
+                    const auto composite_sequential = scaling_accessor->Get(PixelType::Gray8, roi, &plane_coordinate, zoom, &options);
+                    options.maxNumberOfDecodeThreads = 3;
+                    const auto composite_concurrent = scaling_accessor->Get(PixelType::Gray8, roi, &plane_coordinate, zoom, &options);
+
+                    // assert
+                    EXPECT_TRUE(AreGray8BitmapsEqual(composite_sequential, composite_concurrent));
+                }
+            }
+
+            ISingleChannelPyramidLayerTileAccessor::Options options;
+            options.Clear();
+            options.backGroundColor = RgbFloatColor{ 0, 0, 0 };
+            options.decodeTaskPriority = priority;
+
+            // act
+            const auto composite_sequential = pyramid_layer_accessor->Get(PixelType::Gray8, roi, &plane_coordinate, ISingleChannelPyramidLayerTileAccessor::PyramidLayerInfo{ 2, 0 }, &options);
+            options.maxNumberOfDecodeThreads = 3;
+            const auto composite_concurrent = pyramid_layer_accessor->Get(PixelType::Gray8, roi, &plane_coordinate, ISingleChannelPyramidLayerTileAccessor::PyramidLayerInfo{ 2, 0 }, &options);
+
+            // assert
+            EXPECT_TRUE(AreGray8BitmapsEqual(composite_sequential, composite_concurrent));
+        }
+    }
+}
+
+/// Creates a synthetic CZI document with 2x2 JPG-XR-compressed subblocks (of size 256x256 pixels and pixel type Gray8) in a
+/// mosaic arrangement. The content is a smooth pattern which continues across the subblocks.
+///
+/// \returns    A blob containing a CZI document.
+static tuple<shared_ptr<void>, size_t> CreateCziWithFourJpgXrCompressedSubblocksInMosaicArrangement()
+{
+    auto writer = CreateCZIWriter();
+    auto outStream = make_shared<CMemOutputStream>(0);
+
+    constexpr uint32_t kTileSize = 256;
+    auto spWriterInfo = make_shared<CCziWriterInfo >(
+        GUID{ 0x1234567,0x89ab,0xcdef,{ 1,2,3,4,5,6,7,8 } },
+        CDimBounds{ { DimensionIndex::C, 0, 1 } },	// set a bounds for C
+        0, 3);	// set a bounds M : 0<=m<=3
+    writer->Create(outStream, spWriterInfo);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const int tile_x = (i % 2) * kTileSize;
+        const int tile_y = (i / 2) * kTileSize;
+        auto bitmap = CBitmapData<CHeapAllocator>::Create(PixelType::Gray8, kTileSize, kTileSize);
+        shared_ptr<IMemoryBlock> encoded_data;
+        {
+            const ScopedBitmapLockerSP lock_info_bitmap{ bitmap };
+            for (uint32_t y = 0; y < kTileSize; ++y)
+            {
+                for (uint32_t x = 0; x < kTileSize; ++x)
+                {
+                    static_cast<uint8_t*>(lock_info_bitmap.ptrDataRoi)[y * lock_info_bitmap.stride + x] =
+                        static_cast<uint8_t>(128 + 100 * sin((tile_x + x) / 120.0) * cos((tile_y + y) / 160.0));
+                }
+            }
+
+            encoded_data = JxrLibCompress::Compress(
+                bitmap->GetPixelType(),
+                bitmap->GetWidth(),
+                bitmap->GetHeight(),
+                lock_info_bitmap.stride,
+                lock_info_bitmap.ptrDataRoi,
+                nullptr);
+        }
+
+        AddSubBlockInfoMemPtr addSbBlkInfo;
+        addSbBlkInfo.Clear();
+        addSbBlkInfo.coordinate.Set(DimensionIndex::C, 0);
+        addSbBlkInfo.mIndexValid = true;
+        addSbBlkInfo.mIndex = i;
+        addSbBlkInfo.x = tile_x;
+        addSbBlkInfo.y = tile_y;
+        addSbBlkInfo.logicalWidth = bitmap->GetWidth();
+        addSbBlkInfo.logicalHeight = bitmap->GetHeight();
+        addSbBlkInfo.physicalWidth = bitmap->GetWidth();
+        addSbBlkInfo.physicalHeight = bitmap->GetHeight();
+        addSbBlkInfo.PixelType = bitmap->GetPixelType();
+        addSbBlkInfo.SetCompressionMode(CompressionMode::JpgXr);
+        addSbBlkInfo.ptrData = encoded_data->GetPtr();
+        addSbBlkInfo.dataSize = static_cast<uint32_t>(encoded_data->GetSizeOfData());
+        writer->SyncAddSubBlock(addSbBlkInfo);
+    }
+
+    PrepareMetadataInfo prepare_metadata_info;
+    auto metaDataBuilder = writer->GetPreparedMetadata(prepare_metadata_info);
+    WriteMetadataInfo write_metadata_info;
+    write_metadata_info.Clear();
+    const auto& strMetadata = metaDataBuilder->GetXml();
+    write_metadata_info.szMetadata = strMetadata.c_str();
+    write_metadata_info.szMetadataSize = strMetadata.size() + 1;
+    writer->SyncWriteMetadata(write_metadata_info);
+    writer->Close();
+    writer.reset();
+
+    size_t czi_document_size = 0;
+    shared_ptr<void> czi_document_data = outStream->GetCopy(&czi_document_size);
+    return make_tuple(czi_document_data, czi_document_size);
+}
+
+TEST(Accessor, CreateDocumentWithJpgXrCompressedSubblocksAndCompareReducedResolutionDecodeWithFullResolutionDecode)
+{
+    // arrange
+    auto czi_document_as_blob = CreateCziWithFourJpgXrCompressedSubblocksInMosaicArrangement();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto reader = CreateCZIReader();
+    reader->Open(memory_stream);
+    const auto accessor = reader->CreateSingleChannelScalingTileAccessor();
+    const CDimCoordinate plane_coordinate{ {DimensionIndex::C, 0} };
+
+    for (const float zoom : { 1.f, 0.5f, 0.25f, 0.125f, 0.05f })
+    {
+        const auto subblock_cache_full_resolution = CreateSubBlockCache();
+        const auto subblock_cache_reduced_resolution = CreateSubBlockCache();
+        ISingleChannelScalingTileAccessor::Options options;
+        options.Clear();
+        options.backGroundColor = RgbFloatColor{ 0, 0, 0 };
+        options.onlyUseSubBlockCacheForCompressedData = true;
+
+        // act
+        options.useReducedResolutionDecode = false;
+        options.subBlockCache = subblock_cache_full_resolution;
+        const auto composite_full_resolution = accessor->Get(PixelType::Gray8, IntRect{ 0, 0, 512, 512 }, &plane_coordinate, zoom, &options);
+        options.useReducedResolutionDecode = true;
+        options.subBlockCache = subblock_cache_reduced_resolution;
+        const auto composite_reduced_resolution = accessor->Get(PixelType::Gray8, IntRect{ 0, 0, 512, 512 }, &plane_coordinate, zoom, &options);
+
+        // assert
+        ASSERT_EQ(composite_full_resolution->GetWidth(), composite_reduced_resolution->GetWidth());
+        ASSERT_EQ(composite_full_resolution->GetHeight(), composite_reduced_resolution->GetHeight());
+        const auto max_difference_mean_difference = CalculateMaxDifferenceMeanDifference(composite_full_resolution, composite_reduced_resolution);
+        EXPECT_LT(get<1>(max_difference_mean_difference), 4) << "Reduced-resolution decode differs too much for zoom " << zoom << ".";
+
+        // only bitmaps with the full resolution are expected to be added to the cache
+        const auto full_resolution_statistics = subblock_cache_full_resolution->GetStatistics(ISubBlockCacheStatistics::kElementsCount);
+        const auto reduced_resolution_statistics = subblock_cache_reduced_resolution->GetStatistics(ISubBlockCacheStatistics::kElementsCount);
+        EXPECT_EQ(full_resolution_statistics.elementsCount, 4);
+        EXPECT_EQ(reduced_resolution_statistics.elementsCount, zoom > 0.5f ? 4 : 0);
+    }
+}
+
+TEST(Accessor, CreateDocumentWithJpgXrCompressedSubblocksAndCompareRegionDecodeWithDecodeOfWholeSubblocks)
+{
+    // Without a subblock-cache, only the visible region of a partially visible (JPG-XR-compressed) subblock is decoded, whereas with
+    //  a subblock-cache the whole subblock is decoded (and added to the cache). We expect the results to be identical.
+
+    // arrange
+    auto czi_document_as_blob = CreateCziWithFourJpgXrCompressedSubblocksInMosaicArrangement();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto reader = CreateCZIReader();
+    reader->Open(memory_stream);
+    const auto tile_accessor = reader->CreateSingleChannelTileAccessor();
+    const auto scaling_accessor = reader->CreateSingleChannelScalingTileAccessor();
+    const CDimCoordinate plane_coordinate{ {DimensionIndex::C, 0} };
+    const IntRect rois[] = { IntRect{ 200, 200, 100, 100 }, IntRect{ 3, 250, 500, 17 }, IntRect{ 0, 0, 512, 512 } };
+
+    for (const auto& roi : rois)
+    {
+        ISingleChannelTileAccessor::Options tile_accessor_options;
+        tile_accessor_options.Clear();
+        tile_accessor_options.backGroundColor = RgbFloatColor{ 0, 0, 0 };
+
+        // act
+        const auto composite_region_decode = tile_accessor->Get(PixelType::Gray8, roi, &plane_coordinate, &tile_accessor_options);
+        const auto subblock_cache = CreateSubBlockCache();
+        tile_accessor_options.subBlockCache = subblock_cache;
+        const auto composite_whole_decode = tile_accessor->Get(PixelType::Gray8, roi, &plane_coordinate, &tile_accessor_options);
+
+        // assert
+        EXPECT_TRUE(AreGray8BitmapsEqual(composite_region_decode, composite_whole_decode));
+        EXPECT_EQ(subblock_cache->GetStatistics(ISubBlockCacheStatistics::kElementsCount).elementsCount, 4);
+
+        for (const float zoom : { 1.f, 0.7f, 0.5f })
+        {
+            ISingleChannelScalingTileAccessor::Options scaling_accessor_options;
+            scaling_accessor_options.Clear();
+            scaling_accessor_options.backGroundColor = RgbFloatColor{ 0, 0, 0 };
+            scaling_accessor_options.useReducedResolutionDecode = false;
+
+            // act
+            const auto composite_scaled_region_decode = scaling_accessor->Get(PixelType::Gray8, roi, &plane_coordinate, zoom, &scaling_accessor_options);
+            scaling_accessor_options.subBlockCache = CreateSubBlockCache();
+            const auto composite_scaled_whole_decode = scaling_accessor->Get(PixelType::Gray8, roi, &plane_coordinate, zoom, &scaling_accessor_options);
+
+            // assert
+            EXPECT_TRUE(AreGray8BitmapsEqual(composite_scaled_region_decode, composite_scaled_whole_decode)) << "Mismatch for zoom " << zoom << ".";
+        }
+    }
+}
+
+static tuple<shared_ptr<void>, size_t> CreateCziWithCompressedSubblocksPartiallyOverlapping(CompressionMode compression_mode)
+{
+    auto writer = CreateCZIWriter();
+    auto outStream = make_shared<CMemOutputStream>(0);
+
+    constexpr uint32_t kTileSize = 64;
+    constexpr int kTileCount = 16;
+    auto spWriterInfo = make_shared<CCziWriterInfo >(
+        GUID{ 0x1234567,0x89ab,0xcdef,{ 1,2,3,4,5,6,7,8 } },
+        CDimBounds{ { DimensionIndex::C, 0, 1 } },	// set a bounds for C
+        0, kTileCount - 1);	// set a bounds M : 0<=m<kTileCount
+    writer->Create(outStream, spWriterInfo);
+
+    for (int i = 0; i < kTileCount; ++i)
+    {
+        // the tiles in the first two rows are adjacent to each other, the ones in the other rows overlap - and the rows overlap as well
+        const int column = i % 4;
+        const int row = i / 4;
+        auto bitmap = CBitmapData<CHeapAllocator>::Create(PixelType::Gray8, kTileSize, kTileSize);
+        shared_ptr<IMemoryBlock> encoded_data;
+        {
+            const ScopedBitmapLockerSP lock_info_bitmap{ bitmap };
+            for (uint32_t y = 0; y < kTileSize; ++y)
+            {
+                for (uint32_t x = 0; x < kTileSize; ++x)
+                {
+                    static_cast<uint8_t*>(lock_info_bitmap.ptrDataRoi)[y * lock_info_bitmap.stride + x] = static_cast<uint8_t>(i * 37 + x + 3 * y);
+                }
+            }
+
+            switch (compression_mode)
+            {
+            case CompressionMode::JpgXr:
+                encoded_data = JxrLibCompress::Compress(bitmap->GetPixelType(), bitmap->GetWidth(), bitmap->GetHeight(), lock_info_bitmap.stride, lock_info_bitmap.ptrDataRoi, nullptr);
+                break;
+            case CompressionMode::Zstd0:
+                encoded_data = ZstdCompress::CompressZStd0Alloc(bitmap->GetWidth(), bitmap->GetHeight(), lock_info_bitmap.stride, bitmap->GetPixelType(), lock_info_bitmap.ptrDataRoi, nullptr);
+                break;
+            case CompressionMode::Zstd1:
+                encoded_data = ZstdCompress::CompressZStd1Alloc(bitmap->GetWidth(), bitmap->GetHeight(), lock_info_bitmap.stride, bitmap->GetPixelType(), lock_info_bitmap.ptrDataRoi, nullptr);
+                break;
+            default:
+                throw invalid_argument("compression_mode");
+            }
+        }
+
+        AddSubBlockInfoMemPtr addSbBlkInfo;
+        addSbBlkInfo.Clear();
+        addSbBlkInfo.coordinate.Set(DimensionIndex::C, 0);
+        addSbBlkInfo.mIndexValid = true;
+        addSbBlkInfo.mIndex = (i * 5) % kTileCount;     // 5 and 16 are coprime, so this is a permutation
+        addSbBlkInfo.x = column * (row < 2 ? 64 : 48);
+        addSbBlkInfo.y = row * 56;
+        addSbBlkInfo.logicalWidth = bitmap->GetWidth();
+        addSbBlkInfo.logicalHeight = bitmap->GetHeight();
+        addSbBlkInfo.physicalWidth = bitmap->GetWidth();
+        addSbBlkInfo.physicalHeight = bitmap->GetHeight();
+        addSbBlkInfo.PixelType = bitmap->GetPixelType();
+        addSbBlkInfo.SetCompressionMode(compression_mode);
+        addSbBlkInfo.ptrData = encoded_data->GetPtr();
+        addSbBlkInfo.dataSize = static_cast<uint32_t>(encoded_data->GetSizeOfData());
+        writer->SyncAddSubBlock(addSbBlkInfo);
+    }
+
+    PrepareMetadataInfo prepare_metadata_info;
+    auto metaDataBuilder = writer->GetPreparedMetadata(prepare_metadata_info);
+    WriteMetadataInfo write_metadata_info;
+    write_metadata_info.Clear();
+    const auto& strMetadata = metaDataBuilder->GetXml();
+    write_metadata_info.szMetadata = strMetadata.c_str();
+    write_metadata_info.szMetadataSize = strMetadata.size() + 1;
+    writer->SyncWriteMetadata(write_metadata_info);
+    writer->Close();
+    writer.reset();
+
+    size_t czi_document_size = 0;
+    shared_ptr<void> czi_document_data = outStream->GetCopy(&czi_document_size);
+    return make_tuple(czi_document_data, czi_document_size);
+}
+
+TEST(Accessor, CreateDocumentWithCompressedSubblocksAndCompareDecodeIntoDestinationWithComposing)
+{
+    // Without a subblock-cache, the visible part of a subblock which does not overlap with other subblocks is decoded directly into
+    //  the destination bitmap, whereas with a subblock-cache all subblocks are decoded into a bitmap and composed. We expect the results
+    //  to be identical - for subblocks which are adjacent, overlapping and partially visible.
+    const IntRect rois[] = { IntRect{ 0, 0, 256, 232 }, IntRect{ 10, 0, 200, 40 }, IntRect{ 70, 5, 50, 100 }, IntRect{ 30, 130, 120, 90 }, IntRect{ 64, 56, 64, 56 } };
+    for (const auto compression_mode : { CompressionMode::JpgXr, CompressionMode::Zstd0, CompressionMode::Zstd1 })
+    {
+        // arrange
+        auto czi_document_as_blob = CreateCziWithCompressedSubblocksPartiallyOverlapping(compression_mode);
+        const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+        const auto reader = CreateCZIReader();
+        reader->Open(memory_stream);
+        const auto accessor = reader->CreateSingleChannelTileAccessor();
+        const CDimCoordinate plane_coordinate{ {DimensionIndex::C, 0} };
+
+        for (const bool use_visibility_check_optimization : { false, true })
+        {
+            for (const int max_number_of_decode_threads : { 1, 4 })
+            {
+                for (const auto& roi : rois)
+                {
+                    ISingleChannelTileAccessor::Options options;
+                    options.Clear();
+                    options.useVisibilityCheckOptimization = use_visibility_check_optimization;
+                    options.maxNumberOfDecodeThreads = max_number_of_decode_threads;
+                    options.backGroundColor = RgbFloatColor{ 0, 0, 0 };
+
+                    // act
+                    const auto composite_decoded_into_destination = accessor->Get(PixelType::Gray8, roi, &plane_coordinate, &options);
+                    options.subBlockCache = CreateSubBlockCache();
+                    const auto composite_composed = accessor->Get(PixelType::Gray8, roi, &plane_coordinate, &options);
+
+                    // assert
+                    EXPECT_TRUE(AreGray8BitmapsEqual(composite_decoded_into_destination, composite_composed))
+                        << "Mismatch for compression mode " << static_cast<int>(compression_mode) << " and ROI " << roi.x << "," << roi.y << "," << roi.w << "," << roi.h << ".";
+                }
+            }
+        }
+    }
+}
+
+TEST(Accessor, CreateDocumentWithCompressedSubblocksAndCheckThatDecodeIntoDestinationRespectsStride)
+{
+    // We compose into a destination bitmap whose stride is larger than its width - the bytes between the end of a line and the
+    //  beginning of the next line must not be modified.
+    constexpr uint32_t kExtraBytesPerLine = 13;
+    constexpr uint8_t kGuardValue = 0xab;
+    const IntRect rois[] = { IntRect{ 0, 0, 256, 232 }, IntRect{ 10, 0, 200, 40 }, IntRect{ 70, 5, 50, 100 } };
+    for (const auto compression_mode : { CompressionMode::JpgXr, CompressionMode::Zstd1 })
+    {
+        // arrange
+        auto czi_document_as_blob = CreateCziWithCompressedSubblocksPartiallyOverlapping(compression_mode);
+        const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+        const auto reader = CreateCZIReader();
+        reader->Open(memory_stream);
+        const auto accessor = reader->CreateSingleChannelTileAccessor();
+        const CDimCoordinate plane_coordinate{ {DimensionIndex::C, 0} };
+
+        for (const auto& roi : rois)
+        {
+            ISingleChannelTileAccessor::Options options;
+            options.Clear();
+            options.backGroundColor = RgbFloatColor{ 0, 0, 0 };
+            const auto destination = CBitmapData<CHeapAllocator>::Create(PixelType::Gray8, roi.w, roi.h, roi.w + kExtraBytesPerLine);
+            {
+                const ScopedBitmapLockerSP lock_info_destination{ destination };
+                memset(lock_info_destination.ptrDataRoi, kGuardValue, static_cast<size_t>(lock_info_destination.stride) * roi.h);
+            }
+
+            // act
+            accessor->Get(destination.get(), roi.x, roi.y, &plane_coordinate, &options);
+            options.subBlockCache = CreateSubBlockCache();
+            const auto composite_composed = accessor->Get(PixelType::Gray8, roi, &plane_coordinate, &options);
+
+            // assert
+            EXPECT_TRUE(AreGray8BitmapsEqual(destination, composite_composed));
+            const ScopedBitmapLockerSP lock_info_destination{ destination };
+            for (int y = 0; y < roi.h; ++y)
+            {
+                const uint8_t* extra_bytes = static_cast<const uint8_t*>(lock_info_destination.ptrDataRoi) + static_cast<size_t>(y) * lock_info_destination.stride + roi.w;
+                for (uint32_t x = 0; x < kExtraBytesPerLine; ++x)
+                {
+                    ASSERT_EQ(extra_bytes[x], kGuardValue) << "Byte beyond the end of line " << y << " was modified.";
+                }
+            }
+        }
+    }
+}
@@ -4,7 +4,9 @@
 
 #include "include_gtest.h"
 #include "MemInputOutputStream.h"
+#include "MemOutputStream.h"
 #include "../libCZI/CziParse.h"
+#include "../libCZI/CziStructs.h"
 
 using namespace libCZI;
 using namespace std;
@@ -97,6 +99,295 @@ TEST(CZIParse, ParseSubblockDirectoryWithSubblockWithoutXAndExpectException)
     EXPECT_THROW(CCZIParse::ReadSubBlockDirectory(memory_stream.get(), file_header_segment_data.GetSubBlockDirectoryPosition(), parse_options), LibCZICZIParseException);
 }
 
+TEST(CZIParse, ReadSubBlockDataLocationAndPrefixAndCompareToSubBlockData)
+{
+    // arrange - create a CZI with one sub-block, which contains metadata and data
+    const auto writer = CreateCZIWriter();
+    const auto out_stream = make_shared<CMemOutputStream>(0);
+    const auto writer_info = make_shared<CCziWriterInfo>(GUID{ 0,0,0,{ 0,0,0,0,0,0,0,0 } });
+    writer->Create(out_stream, writer_info);
+
+    static const char sub_block_metadata[] = "<METADATA><Tags><AcquisitionTime>2024-01-01T00:00:00</AcquisitionTime></Tags></METADATA>";
+    const size_t sub_block_data_size = 2000;
+    unique_ptr<uint8_t[]> sub_block_data(new uint8_t[sub_block_data_size]);
+    for (size_t i = 0; i < sub_block_data_size; ++i)
+    {
+        sub_block_data[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    AddSubBlockInfoMemPtr add_sub_block_info;
+    add_sub_block_info.Clear();
+    add_sub_block_info.coordinate = CDimCoordinate::Parse("C0");
+    add_sub_block_info.mIndexValid = true;
+    add_sub_block_info.mIndex = 0;
+    add_sub_block_info.logicalWidth = add_sub_block_info.physicalWidth = 10;
+    add_sub_block_info.logicalHeight = add_sub_block_info.physicalHeight = 200;
+    add_sub_block_info.PixelType = PixelType::Gray8;
+    add_sub_block_info.ptrData = sub_block_data.get();
+    add_sub_block_info.dataSize = static_cast<uint32_t>(sub_block_data_size);
+    add_sub_block_info.ptrSbBlkMetadata = sub_block_metadata;
+    add_sub_block_info.sbBlkMetadataSize = static_cast<uint32_t>(strlen(sub_block_metadata));
+    writer->SyncAddSubBlock(add_sub_block_info);
+    writer->Close();
+
+    size_t size_of_czi;
+    const auto czi_data = out_stream->GetCopy(&size_of_czi);
+    const auto memory_stream = make_shared<CMemInputOutputStream>(czi_data.get(), size_of_czi);
+    const auto file_header_segment_data = CCZIParse::ReadFileHeaderSegmentData(memory_stream.get());
+    CCZIParse::SubblockDirectoryParseOptions parse_options;
+    const auto sub_block_directory = CCZIParse::ReadSubBlockDirectory(memory_stream.get(), file_header_segment_data.GetSubBlockDirectoryPosition(), parse_options);
+    CCziSubBlockDirectoryBase::SubBlkEntry entry;
+    ASSERT_TRUE(sub_block_directory.TryGetSubBlock(0, entry));
+
+    // act
+    const auto location = CCZIParse::ReadSubBlockDataLocation(memory_stream.get(), entry.FilePosition);
+    uint8_t prefix[100];
+    const auto bytes_read = CCZIParse::ReadSubBlockDataPrefix(memory_stream.get(), location, prefix, sizeof(prefix));
+    unique_ptr<uint8_t[]> complete_data(new uint8_t[sub_block_data_size + 100]);
+    const auto bytes_read_complete = CCZIParse::ReadSubBlockDataPrefix(memory_stream.get(), location, complete_data.get(), sub_block_data_size + 100);
+
+    // assert
+    EXPECT_EQ(location.dataSize, sub_block_data_size);
+    EXPECT_EQ(location.compression, static_cast<int>(CompressionMode::UnCompressed));
+    EXPECT_EQ(bytes_read, sizeof(prefix));
+    EXPECT_EQ(memcmp(prefix, sub_block_data.get(), sizeof(prefix)), 0);
+    EXPECT_EQ(bytes_read_complete, sub_block_data_size);
+    EXPECT_EQ(memcmp(complete_data.get(), sub_block_data.get(), sub_block_data_size), 0);
+}
+
+TEST(CZIParse, BulkInplacePatchSubBlockDirectoryAndCompareToInplacePatchSubBlockDirectory)
+{
+    // arrange - create a CZI with some sub-blocks
+    const auto writer = CreateCZIWriter();
+    const auto out_stream = make_shared<CMemOutputStream>(0);
+    const auto writer_info = make_shared<CCziWriterInfo>(GUID{ 0,0,0,{ 0,0,0,0,0,0,0,0 } });
+    writer->Create(out_stream, writer_info);
+
+    const uint8_t pixels[4] = { 1, 2, 3, 4 };
+    for (int i = 0; i < 50; ++i)
+    {
+        AddSubBlockInfoMemPtr add_sub_block_info;
+        add_sub_block_info.Clear();
+        add_sub_block_info.coordinate = CDimCoordinate::Parse("C0");
+        add_sub_block_info.mIndexValid = true;
+        add_sub_block_info.mIndex = i;
+        add_sub_block_info.x = i * 2;
+        add_sub_block_info.logicalWidth = add_sub_block_info.physicalWidth = 2;
+        add_sub_block_info.logicalHeight = add_sub_block_info.physicalHeight = 2;
+        add_sub_block_info.PixelType = PixelType::Gray8;
+        add_sub_block_info.ptrData = pixels;
+        add_sub_block_info.dataSize = sizeof(pixels);
+        writer->SyncAddSubBlock(add_sub_block_info);
+    }
+
+    writer->Close();
+
+    size_t size_of_czi;
+    const auto czi_data = out_stream->GetCopy(&size_of_czi);
+    const auto memory_stream_1 = make_shared<CMemInputOutputStream>(czi_data.get(), size_of_czi);
+    const auto memory_stream_2 = make_shared<CMemInputOutputStream>(czi_data.get(), size_of_czi);
+    const auto sub_block_directory_position = CCZIParse::ReadFileHeaderSegmentData(memory_stream_1.get()).GetSubBlockDirectoryPosition();
+
+    // we patch the X-size of every third sub-block and the Y-size of every fifth sub-block, and record all calls
+    vector<tuple<int, char, int32_t>> calls_1, calls_2;
+    const auto create_patch_function = [](vector<tuple<int, char, int32_t>>& calls)->function<bool(int, char, int32_t, int32_t&)>
+        {
+            return [&calls](int sub_block_index, char dimension_identifier, int32_t size, int32_t& new_size)->bool
+                {
+                    calls.emplace_back(sub_block_index, dimension_identifier, size);
+                    if ((dimension_identifier == 'X' && sub_block_index % 3 == 0) ||
+                        (dimension_identifier == 'Y' && sub_block_index % 5 == 0))
+                    {
+                        new_size = 1000 + sub_block_index;
+                        return true;
+                    }
+
+                    return false;
+                };
+        };
+
+    // act
+    CCZIParse::InplacePatchSubBlockDirectory(memory_stream_1.get(), sub_block_directory_position, create_patch_function(calls_1));
+    CCZIParse::BulkInplacePatchSubBlockDirectory(memory_stream_2.get(), sub_block_directory_position, create_patch_function(calls_2));
+
+    // assert
+    EXPECT_EQ(calls_1, calls_2);
+    ASSERT_EQ(memory_stream_1->GetDataSize(), memory_stream_2->GetDataSize());
+    EXPECT_EQ(memcmp(memory_stream_1->GetDataC(), memory_stream_2->GetDataC(), memory_stream_1->GetDataSize()), 0);
+    EXPECT_NE(memcmp(czi_data.get(), memory_stream_2->GetDataC(), size_of_czi), 0);
+
+    CCZIParse::SubblockDirectoryParseOptions parse_options;
+    const auto sub_block_directory = CCZIParse::ReadSubBlockDirectory(memory_stream_2.get(), sub_block_directory_position, parse_options);
+    for (int i = 0; i < 50; ++i)
+    {
+        CCziSubBlockDirectoryBase::SubBlkEntry entry;
+        ASSERT_TRUE(sub_block_directory.TryGetSubBlock(i, entry));
+        EXPECT_EQ(entry.storedWidth, i % 3 == 0 ? 1000 + i : 2);
+        EXPECT_EQ(entry.storedHeight, i % 5 == 0 ? 1000 + i : 2);
+    }
+}
+
+TEST(CZIParse, BulkInplacePatchSubBlockDirectoryWithImplausibleUsedSizeAndExpectBadAlloc)
+{
+    // arrange - create a CZI with one sub-block, and then set the used size of the sub-block directory segment to a value
+    //  for which the buffer cannot be allocated
+    const auto writer = CreateCZIWriter();
+    const auto out_stream = make_shared<CMemOutputStream>(0);
+    const auto writer_info = make_shared<CCziWriterInfo>(GUID{ 0,0,0,{ 0,0,0,0,0,0,0,0 } });
+    writer->Create(out_stream, writer_info);
+
+    const uint8_t pixels[4] = { 1, 2, 3, 4 };
+    AddSubBlockInfoMemPtr add_sub_block_info;
+    add_sub_block_info.Clear();
+    add_sub_block_info.coordinate = CDimCoordinate::Parse("C0");
+    add_sub_block_info.logicalWidth = add_sub_block_info.physicalWidth = 2;
+    add_sub_block_info.logicalHeight = add_sub_block_info.physicalHeight = 2;
+    add_sub_block_info.PixelType = PixelType::Gray8;
+    add_sub_block_info.ptrData = pixels;
+    add_sub_block_info.dataSize = sizeof(pixels);
+    writer->SyncAddSubBlock(add_sub_block_info);
+    writer->Close();
+
+    size_t size_of_czi;
+    const auto czi_data = out_stream->GetCopy(&size_of_czi);
+    const auto memory_stream = make_shared<CMemInputOutputStream>(czi_data.get(), size_of_czi);
+    const auto sub_block_directory_position = CCZIParse::ReadFileHeaderSegmentData(memory_stream.get()).GetSubBlockDirectoryPosition();
+    const int64_t implausible_used_size = numeric_limits<int64_t>::max() / 2;
+    memory_stream->Write(sub_block_directory_position + offsetof(SegmentHeader, UsedSize), &implausible_used_size, sizeof(implausible_used_size), nullptr);
+
+    // act & assert
+    EXPECT_THROW(
+        CCZIParse::BulkInplacePatchSubBlockDirectory(memory_stream.get(), sub_block_directory_position, [](int, char, int32_t, int32_t&)->bool { return false; }),
+        std::bad_alloc);
+}
+
+TEST(CZIParse, ReadSubBlockDirectoryWithManyEntriesAndCompareToSequentialParsing)
+{
+    // arrange - create a CZI with enough sub-blocks so that the directory is parsed in multiple chunks
+    const int sub_block_count = 5 * CCZIParse::kSubBlockDirectoryEntriesPerChunk / 2;
+    const auto writer = CreateCZIWriter();
+    const auto out_stream = make_shared<CMemOutputStream>(0);
+    const auto writer_info = make_shared<CCziWriterInfo>(GUID{ 0,0,0,{ 0,0,0,0,0,0,0,0 } });
+    writer->Create(out_stream, writer_info);
+
+    const uint8_t pixels[4] = { 1, 2, 3, 4 };
+    for (int i = 0; i < sub_block_count; ++i)
+    {
+        AddSubBlockInfoMemPtr add_sub_block_info;
+        add_sub_block_info.Clear();
+        add_sub_block_info.coordinate = CDimCoordinate{ { DimensionIndex::C, i % 3 }, { DimensionIndex::Z, i % 7 }, { DimensionIndex::T, i / 100 } };
+        add_sub_block_info.mIndexValid = true;
+        add_sub_block_info.mIndex = i;
+        add_sub_block_info.x = (i % 100) * 2;
+        add_sub_block_info.y = -i;
+        add_sub_block_info.logicalWidth = add_sub_block_info.physicalWidth = 2;
+        add_sub_block_info.logicalHeight = add_sub_block_info.physicalHeight = 2;
+        add_sub_block_info.PixelType = PixelType::Gray8;
+        add_sub_block_info.ptrData = pixels;
+        add_sub_block_info.dataSize = sizeof(pixels);
+        writer->SyncAddSubBlock(add_sub_block_info);
+    }
+
+    writer->Close();
+
+    size_t size_of_czi;
+    const auto czi_data = out_stream->GetCopy(&size_of_czi);
+    const auto memory_stream = make_shared<CMemInputOutputStream>(czi_data.get(), size_of_czi);
+    const auto sub_block_directory_position = CCZIParse::ReadFileHeaderSegmentData(memory_stream.get()).GetSubBlockDirectoryPosition();
+    CCZIParse::SubblockDirectoryParseOptions parse_options;
+
+    // act
+    const auto sub_block_directory = CCZIParse::ReadSubBlockDirectory(memory_stream.get(), sub_block_directory_position, parse_options);
+    vector<CCziSubBlockDirectoryBase::SubBlkEntry> entries_parsed_sequentially;
+    CCZIParse::ReadSubBlockDirectory(
+        memory_stream.get(),
+        sub_block_directory_position,
+        [&](const CCziSubBlockDirectoryBase::SubBlkEntry& entry)->void {entries_parsed_sequentially.push_back(entry); },
+        parse_options,
+        nullptr);
+
+    // assert
+    ASSERT_EQ(sub_block_directory.GetSubBlockCount(), sub_block_count);
+    ASSERT_EQ(entries_parsed_sequentially.size(), static_cast<size_t>(sub_block_count));
+    for (int i = 0; i < sub_block_count; ++i)
+    {
+        CCziSubBlockDirectoryBase::SubBlkEntry entry;
+        ASSERT_TRUE(sub_block_directory.TryGetSubBlock(i, entry));
+        const auto& expected = entries_parsed_sequentially[i];
+        EXPECT_TRUE(Utils::Compare(&entry.coordinate, &expected.coordinate) == 0);
+        EXPECT_EQ(entry.mIndex, expected.mIndex);
+        EXPECT_EQ(entry.x, expected.x);
+        EXPECT_EQ(entry.y, expected.y);
+        EXPECT_EQ(entry.width, expected.width);
+        EXPECT_EQ(entry.height, expected.height);
+        EXPECT_EQ(entry.storedWidth, expected.storedWidth);
+        EXPECT_EQ(entry.storedHeight, expected.storedHeight);
+        EXPECT_EQ(entry.PixelType, expected.PixelType);
+        EXPECT_EQ(entry.FilePosition, expected.FilePosition);
+        EXPECT_EQ(entry.Compression, expected.Compression);
+        EXPECT_EQ(entry.pyramid_type_from_spare, expected.pyramid_type_from_spare);
+    }
+}
+
+TEST(CZIParse, ReadSubBlockDirectoryWithCorruptedEntryAndExpectException)
+{
+    // arrange - create a CZI with sub-blocks in multiple chunks, and then put an invalid dimension-count into the last entry
+    const int sub_block_count = 2 * CCZIParse::kSubBlockDirectoryEntriesPerChunk + 1;
+    const auto writer = CreateCZIWriter();
+    const auto out_stream = make_shared<CMemOutputStream>(0);
+    const auto writer_info = make_shared<CCziWriterInfo>(GUID{ 0,0,0,{ 0,0,0,0,0,0,0,0 } });
+    writer->Create(out_stream, writer_info);
+
+    const uint8_t pixels[4] = { 1, 2, 3, 4 };
+    for (int i = 0; i < sub_block_count; ++i)
+    {
+        AddSubBlockInfoMemPtr add_sub_block_info;
+        add_sub_block_info.Clear();
+        add_sub_block_info.coordinate = CDimCoordinate::Parse("C0");
+        add_sub_block_info.mIndexValid = true;
+        add_sub_block_info.mIndex = i;
+        add_sub_block_info.logicalWidth = add_sub_block_info.physicalWidth = 2;
+        add_sub_block_info.logicalHeight = add_sub_block_info.physicalHeight = 2;
+        add_sub_block_info.PixelType = PixelType::Gray8;
+        add_sub_block_info.ptrData = pixels;
+        add_sub_block_info.dataSize = sizeof(pixels);
+        writer->SyncAddSubBlock(add_sub_block_info);
+    }
+
+    writer->Close();
+
+    size_t size_of_czi;
+    const auto czi_data = out_stream->GetCopy(&size_of_czi);
+    const auto memory_stream = make_shared<CMemInputOutputStream>(czi_data.get(), size_of_czi);
+    const auto sub_block_directory_position = CCZIParse::ReadFileHeaderSegmentData(memory_stream.get()).GetSubBlockDirectoryPosition();
+
+    const uint8_t* data = static_cast<const uint8_t*>(czi_data.get());
+    size_t offset = static_cast<size_t>(sub_block_directory_position) + sizeof(SubBlockDirectorySegment);
+    for (int i = 0; i < sub_block_count - 1; ++i)
+    {
+        int32_t dimension_count;
+        memcpy(&dimension_count, data + offset + offsetof(SubBlockDirectoryEntryDV, DimensionCount), sizeof(dimension_count));
+        offset += offsetof(SubBlockDirectoryEntryDV, DimensionEntries) + dimension_count * sizeof(DimensionEntryDV);
+    }
+
+    const int32_t invalid_dimension_count = MAXDIMENSIONS + 1;
+    const auto corrupted_stream = make_shared<CMemInputOutputStream>(czi_data.get(), size_of_czi);
+    corrupted_stream->Write(offset + offsetof(SubBlockDirectoryEntryDV, DimensionCount), &invalid_dimension_count, sizeof(invalid_dimension_count), nullptr);
+    CCZIParse::SubblockDirectoryParseOptions parse_options;
+
+    // act & assert
+    EXPECT_NO_THROW(CCZIParse::ReadSubBlockDirectory(memory_stream.get(), sub_block_directory_position, parse_options));
+    EXPECT_THROW(CCZIParse::ReadSubBlockDirectory(corrupted_stream.get(), sub_block_directory_position, parse_options), LibCZICZIParseException);
+    EXPECT_THROW(
+        CCZIParse::ReadSubBlockDirectory(
+            corrupted_stream.get(),
+            sub_block_directory_position,
+            [](const CCziSubBlockDirectoryBase::SubBlkEntry&)->void {},
+            parse_options,
+            nullptr),
+        LibCZICZIParseException);
+}
+
 namespace
 {
     const uint8_t czi_with_subblock_of_size_t2[2304] = 
@@ -5,8 +5,11 @@
 #include "include_gtest.h"
 #include "testImage.h"
 #include "inc_libCZI.h"
+#include "../libCZI/utilities.h"
+#include <random>
 
 using namespace libCZI;
+using namespace std;
 
 struct SubBlockEntryData
 {
@@ -236,3 +239,144 @@ TEST(CziSubBlockDirectory, CziSubBlockDirectory1)
 
     //auto pyramidStatistics = subBlkDir.GetPyramidStatistics();
 }
+
+TEST(CziSubBlockDirectory, AddSubBlocksAndCheckThatTheyAreReturnedUnchanged)
+{
+    CCziSubBlockDirectory subBlkDir;
+    vector<CCziSubBlockDirectory::SubBlkEntry> entries;
+    static const char* const coordinates[] = { "C0S0", "C1S0", "C0S1", "C1Z3T4", "" };
+    for (int i = 0; i < 50; ++i)
+    {
+        CCziSubBlockDirectory::SubBlkEntry entry;
+        entry.Invalidate();
+        entry.coordinate = CDimCoordinate::Parse(coordinates[i % 5]);
+        entry.mIndex = i % 7 == 0 ? (numeric_limits<int>::min)() : i;
+        entry.x = i * 3 - 50;
+        entry.y = i * 5 - 20;
+        entry.width = 100 + i;
+        entry.height = 200 + i;
+        entry.storedWidth = i % 2 == 0 ? entry.width : entry.width / 2;
+        entry.storedHeight = i % 2 == 0 ? entry.height : entry.height / 2;
+        entry.PixelType = i % 3;
+        entry.FilePosition = 0x100000000ULL * i + 42;
+        entry.Compression = i % 4;
+        entry.pyramid_type_from_spare = static_cast<uint8_t>(i % 3);
+        entries.push_back(entry);
+        subBlkDir.AddSubBlock(entry);
+    }
+
+    subBlkDir.AddingFinished();
+
+    ASSERT_EQ(subBlkDir.GetSubBlockCount(), static_cast<int>(entries.size()));
+    for (int i = 0; i < subBlkDir.GetSubBlockCount(); ++i)
+    {
+        CCziSubBlockDirectory::SubBlkEntry entry;
+        ASSERT_TRUE(subBlkDir.TryGetSubBlock(i, entry));
+        EXPECT_EQ(Utils::Compare(&entry.coordinate, &entries[i].coordinate), 0);
+        EXPECT_EQ(entry.x, entries[i].x);
+        EXPECT_EQ(entry.y, entries[i].y);
+        EXPECT_EQ(entry.width, entries[i].width);
+        EXPECT_EQ(entry.height, entries[i].height);
+        EXPECT_EQ(entry.mIndex, entries[i].mIndex);
+        EXPECT_EQ(entry.storedWidth, entries[i].storedWidth);
+        EXPECT_EQ(entry.storedHeight, entries[i].storedHeight);
+        EXPECT_EQ(entry.PixelType, entries[i].PixelType);
+        EXPECT_EQ(entry.FilePosition, entries[i].FilePosition);
+        EXPECT_EQ(entry.Compression, entries[i].Compression);
+        EXPECT_EQ(entry.pyramid_type_from_spare, entries[i].pyramid_type_from_spare);
+    }
+
+    CCziSubBlockDirectory::SubBlkEntry entry;
+    EXPECT_FALSE(subBlkDir.TryGetSubBlock(-1, entry));
+    EXPECT_FALSE(subBlkDir.TryGetSubBlock(subBlkDir.GetSubBlockCount(), entry));
+
+    int count = 0;
+    subBlkDir.EnumSubBlocks(
+        [&](int index, const CCziSubBlockDirectory::SubBlkEntry& e)->bool
+        {
+            EXPECT_EQ(index, count);
+            EXPECT_EQ(e.FilePosition, entries[index].FilePosition);
+            ++count;
+            return true;
+        });
+    EXPECT_EQ(count, subBlkDir.GetSubBlockCount());
+}
+
+TEST(CziSubBlockDirectory, FilterSubBlocksAndCompareWithExhaustiveSearch)
+{
+    CCziSubBlockDirectory subBlkDir;
+    vector<CCziSubBlockDirectory::SubBlkEntry> entries;
+    mt19937 random_engine(1234);
+    uniform_int_distribution<int> distribution_position(-500, 500);
+    uniform_int_distribution<int> distribution_size(0, 200);
+    static const char* const coordinates[] = { "C0Z0", "C1Z0", "C0Z1", "C1Z1", "C2" };
+    for (int i = 0; i < 1001; ++i)
+    {
+        CCziSubBlockDirectory::SubBlkEntry entry;
+        entry.Invalidate();
+        entry.coordinate = CDimCoordinate::Parse(coordinates[i % 5]);
+        entry.x = distribution_position(random_engine);
+        entry.y = distribution_position(random_engine);
+        entry.width = distribution_size(random_engine);
+        entry.height = distribution_size(random_engine);
+        entry.storedWidth = i % 3 == 0 ? entry.width / 2 : entry.width;
+        entry.storedHeight = i % 3 == 0 ? entry.height / 2 : entry.height;
+        entry.PixelType = 0;
+        entry.FilePosition = i;
+        entry.Compression = 0;
+        entries.push_back(entry);
+        subBlkDir.AddSubBlock(entry);
+    }
+
+    subBlkDir.AddingFinished();
+
+    const CDimCoordinate plane_c1 = CDimCoordinate::Parse("C1");
+    const CDimCoordinate plane_c0z1 = CDimCoordinate::Parse("C0Z1");
+    const CDimCoordinate plane_t0 = CDimCoordinate::Parse("T0");
+    const CDimCoordinate* planes[] = { nullptr, &plane_c1, &plane_c0z1, &plane_t0 };
+    vector<IntRect> rois{ IntRect{ 0, 0, 0, 0 }, IntRect{ -2000, -2000, 4000, 4000 } };
+    for (int i = 0; i < 20; ++i)
+    {
+        rois.push_back(IntRect{ distribution_position(random_engine), distribution_position(random_engine), distribution_size(random_engine), distribution_size(random_engine) });
+    }
+
+    for (const auto plane : planes)
+    {
+        for (const bool only_layer0 : { false, true })
+        {
+            for (size_t r = 0; r <= rois.size(); ++r)
+            {
+                const IntRect* roi = r < rois.size() ? &rois[r] : nullptr;
+                vector<int> expected;
+                for (size_t n = 0; n < entries.size(); ++n)
+                {
+                    const auto& entry = entries[n];
+                    if ((!only_layer0 || entry.IsStoredSizeEqualLogicalSize()) &&
+                        (roi == nullptr || Utilities::DoIntersect(*roi, IntRect{ entry.x, entry.y, entry.width, entry.height })))
+                    {
+                        bool on_plane = true;
+                        if (plane != nullptr)
+                        {
+                            plane->EnumValidDimensions(
+                                [&](DimensionIndex dim, int value)->bool
+                                {
+                                    int v;
+                                    on_plane = entry.coordinate.TryGetPosition(dim, &v) && v == value;
+                                    return on_plane;
+                                });
+                        }
+
+                        if (on_plane)
+                        {
+                            expected.push_back(static_cast<int>(n));
+                        }
+                    }
+                }
+
+                vector<int> actual;
+                subBlkDir.FilterSubBlocks(plane, roi, only_layer0, actual);
+                EXPECT_EQ(actual, expected);
+            }
+        }
+    }
+}
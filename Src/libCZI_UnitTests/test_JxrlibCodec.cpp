@@ -3,14 +3,20 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include "include_gtest.h"
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
+#include <cmath>
 #include  <array>
+#include <chrono>
+#include <iostream>
 #include <memory>
+#include <vector>
 #include "inc_libCZI.h"
 #include "testImage.h"
 #include "utils.h"
 #include "../libCZI/decoder.h"
+#include "../JxrDecode/JxrDecode.h"
 
 using namespace libCZI;
 using namespace std;
@@ -496,3 +502,429 @@ TEST(JxrlibCodec, CallDecoderExpectingADifferentBitmapTypeAndExpectException)
             exception);
     }
 }
+
+TEST(JxrlibCodec, GetPixelFormatAndSizeFromPrefixOfCompressedData)
+{
+    size_t size_encoded_data;
+    int expected_width, expected_height;
+    const auto ptrEncodedData = CTestImage::GetJpgXrCompressedImage_Bgr24(&size_encoded_data, &expected_width, &expected_height);
+
+    // a few hundred bytes are expected to be sufficient to parse the header
+    JxrDecode::PixelFormat pixel_format;
+    uint32_t width, height;
+    const bool success = JxrDecode::TryGetPixelFormatAndSize(ptrEncodedData, min(size_encoded_data, static_cast<size_t>(512)), pixel_format, width, height);
+    ASSERT_TRUE(success);
+    EXPECT_EQ(pixel_format, JxrDecode::PixelFormat::kBgr24);
+    EXPECT_EQ(width, static_cast<uint32_t>(expected_width));
+    EXPECT_EQ(height, static_cast<uint32_t>(expected_height));
+
+    // and the result must be the same as when giving the complete data
+    const auto info = JxrDecode::GetPixelFormatAndSize(ptrEncodedData, size_encoded_data);
+    EXPECT_EQ(get<0>(info), pixel_format);
+    EXPECT_EQ(get<1>(info), width);
+    EXPECT_EQ(get<2>(info), height);
+}
+
+TEST(JxrlibCodec, GetPixelFormatAndSizeFromTooSmallPrefixAndExpectFailure)
+{
+    size_t size_encoded_data;
+    int expected_width, expected_height;
+    const auto ptrEncodedData = CTestImage::GetJpgXrCompressedImage_Gray8(&size_encoded_data, &expected_width, &expected_height);
+
+    JxrDecode::PixelFormat pixel_format;
+    uint32_t width, height;
+    for (size_t prefix_size = 1; prefix_size < 32; ++prefix_size)
+    {
+        EXPECT_FALSE(JxrDecode::TryGetPixelFormatAndSize(ptrEncodedData, prefix_size, pixel_format, width, height));
+    }
+}
+
+TEST(JxrlibCodec, DecodeWithReducedResolutionAndCompareWithDownscaledFullResolutionImage_Bgr24)
+{
+    const auto bitmap = CBitmapData<CHeapAllocator>::Create(PixelType::Bgr24, CTestImage::BGR24TESTIMAGE_WIDTH, CTestImage::BGR24TESTIMAGE_HEIGHT);
+    shared_ptr<libCZI::IMemoryBlock> encodedData;
+    {
+        // we use a smooth image here (gradients and a low-frequency pattern), where the low-pass filtered image is expected to
+        //  be close to the image downscaled with a box filter
+        const ScopedBitmapLockerSP lck{ bitmap };
+        for (uint32_t y = 0; y < bitmap->GetHeight(); ++y)
+        {
+            for (uint32_t x = 0; x < bitmap->GetWidth(); ++x)
+            {
+                uint8_t* pixel = static_cast<uint8_t*>(lck.ptrDataRoi) + y * lck.stride + x * 3;
+                pixel[0] = static_cast<uint8_t>(x * 255 / bitmap->GetWidth());
+                pixel[1] = static_cast<uint8_t>(y * 255 / bitmap->GetHeight());
+                pixel[2] = static_cast<uint8_t>(128 + 100 * sin(x / 40.0) * cos(y / 30.0));
+            }
+        }
+
+        encodedData = JxrLibCompress::Compress(
+            bitmap->GetPixelType(),
+            bitmap->GetWidth(),
+            bitmap->GetHeight(),
+            lck.stride,
+            lck.ptrDataRoi,
+            nullptr);
+    }
+
+    const auto codec = CJxrLibDecoder::Create();
+    for (const uint32_t downscale_factor : { 1u, 2u, 4u, 8u, 16u })
+    {
+        const uint32_t expected_width = (bitmap->GetWidth() + downscale_factor - 1) / downscale_factor;
+        const uint32_t expected_height = (bitmap->GetHeight() + downscale_factor - 1) / downscale_factor;
+        const auto bitmap_decoded = codec->DecodeWithReducedResolution(
+            encodedData->GetPtr(),
+            encodedData->GetSizeOfData(),
+            libCZI::PixelType::Bgr24,
+            bitmap->GetWidth(),
+            bitmap->GetHeight(),
+            downscale_factor);
+        ASSERT_EQ(bitmap_decoded->GetWidth(), expected_width);
+        ASSERT_EQ(bitmap_decoded->GetHeight(), expected_height);
+
+        // the decoded image is a low-pass filtered version of the original, so we compare it with the original
+        //  downscaled with a box filter and expect only small deviations
+        const ScopedBitmapLockerSP lck_original{ bitmap };
+        const ScopedBitmapLockerSP lck_decoded{ bitmap_decoded };
+        uint64_t sum_of_differences = 0;
+        for (uint32_t y = 0; y < expected_height; ++y)
+        {
+            for (uint32_t x = 0; x < expected_width; ++x)
+            {
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    uint32_t sum = 0, count = 0;
+                    for (uint32_t yy = y * downscale_factor; yy < min((y + 1) * downscale_factor, bitmap->GetHeight()); ++yy)
+                    {
+                        for (uint32_t xx = x * downscale_factor; xx < min((x + 1) * downscale_factor, bitmap->GetWidth()); ++xx)
+                        {
+                            sum += static_cast<const uint8_t*>(lck_original.ptrDataRoi)[yy * lck_original.stride + xx * 3 + c];
+                            ++count;
+                        }
+                    }
+
+                    const int value_decoded = static_cast<const uint8_t*>(lck_decoded.ptrDataRoi)[y * lck_decoded.stride + x * 3 + c];
+                    sum_of_differences += abs(value_decoded - static_cast<int>((sum + count / 2) / count));
+                }
+            }
+        }
+
+        const double mean_difference = static_cast<double>(sum_of_differences) / (3.0 * expected_width * expected_height);
+        EXPECT_LT(mean_difference, 4.0) << "Reduced-resolution decode differs too much for downscale factor " << downscale_factor << ".";
+    }
+}
+
+TEST(JxrlibCodec, AdjustDownscaleFactorForSmallImages)
+{
+    EXPECT_EQ(JxrDecode::AdjustDownscaleFactor(1024, 768, 16), 16u);
+    EXPECT_EQ(JxrDecode::AdjustDownscaleFactor(1024, 8, 16), 8u);
+    EXPECT_EQ(JxrDecode::AdjustDownscaleFactor(3, 1024, 8), 4u);
+    EXPECT_EQ(JxrDecode::AdjustDownscaleFactor(1, 1, 16), 1u);
+    EXPECT_EQ(JxrDecode::AdjustDownscaleFactor(100, 100, 1), 1u);
+}
+
+TEST(JxrlibCodec, DecodeRegionAndCompareWithRegionOfWholeBitmap_Gray8)
+{
+    const auto bitmap = CBitmapData<CHeapAllocator>::Create(PixelType::Gray8, 300, 200);
+    shared_ptr<libCZI::IMemoryBlock> encodedData;
+    {
+        const ScopedBitmapLockerSP lck{ bitmap };
+        for (uint32_t y = 0; y < bitmap->GetHeight(); ++y)
+        {
+            for (uint32_t x = 0; x < bitmap->GetWidth(); ++x)
+            {
+                static_cast<uint8_t*>(lck.ptrDataRoi)[y * lck.stride + x] = static_cast<uint8_t>(x * 7 + y * 13 + (x * y) % 17);
+            }
+        }
+
+        encodedData = JxrLibCompress::Compress(
+            bitmap->GetPixelType(),
+            bitmap->GetWidth(),
+            bitmap->GetHeight(),
+            lck.stride,
+            lck.ptrDataRoi,
+            nullptr);
+    }
+
+    const auto codec = CJxrLibDecoder::Create();
+    const IntRect rois[] = { IntRect{ 0, 0, 300, 200 }, IntRect{ 37, 21, 50, 70 }, IntRect{ 250, 150, 100, 100 }, IntRect{ 299, 0, 1, 1 }, IntRect{ -10, -10, 20, 20 } };
+    for (const uint32_t downscale_factor : { 1u, 2u, 4u })
+    {
+        const auto bitmap_whole = codec->DecodeWithReducedResolution(
+            encodedData->GetPtr(),
+            encodedData->GetSizeOfData(),
+            libCZI::PixelType::Gray8,
+            bitmap->GetWidth(),
+            bitmap->GetHeight(),
+            downscale_factor);
+        for (const auto& roi : rois)
+        {
+            IntRect decoded_region;
+            const auto bitmap_region = codec->DecodeRegion(
+                encodedData->GetPtr(),
+                encodedData->GetSizeOfData(),
+                libCZI::PixelType::Gray8,
+                bitmap->GetWidth(),
+                bitmap->GetHeight(),
+                downscale_factor,
+                roi,
+                decoded_region);
+
+            // the decoded region must contain the requested region (clipped to the bitmap), and it is aligned to the downscale factor
+            const IntRect clipped_roi = roi.Intersect(IntRect{ 0, 0, static_cast<int>(bitmap->GetWidth()), static_cast<int>(bitmap->GetHeight()) });
+            EXPECT_TRUE(decoded_region.Intersect(clipped_roi).w == clipped_roi.w && decoded_region.Intersect(clipped_roi).h == clipped_roi.h);
+            EXPECT_EQ(decoded_region.x % downscale_factor, 0u);
+            EXPECT_EQ(decoded_region.y % downscale_factor, 0u);
+            ASSERT_EQ(bitmap_region->GetWidth(), (static_cast<uint32_t>(decoded_region.w) + downscale_factor - 1) / downscale_factor);
+            ASSERT_EQ(bitmap_region->GetHeight(), (static_cast<uint32_t>(decoded_region.h) + downscale_factor - 1) / downscale_factor);
+
+            // and the content must be identical to the corresponding part of the whole bitmap
+            const ScopedBitmapLockerSP lck_whole{ bitmap_whole };
+            const ScopedBitmapLockerSP lck_region{ bitmap_region };
+            for (uint32_t y = 0; y < bitmap_region->GetHeight(); ++y)
+            {
+                const uint8_t* line_whole = static_cast<const uint8_t*>(lck_whole.ptrDataRoi) + (decoded_region.y / downscale_factor + y) * lck_whole.stride + decoded_region.x / downscale_factor;
+                const uint8_t* line_region = static_cast<const uint8_t*>(lck_region.ptrDataRoi) + y * lck_region.stride;
+                ASSERT_EQ(memcmp(line_whole, line_region, bitmap_region->GetWidth()), 0) << "Mismatch for downscale factor " << downscale_factor << " in line " << y << ".";
+            }
+        }
+    }
+}
+
+TEST(JxrlibCodec, TryDecodeRegionIntoAndCompareWithRegionOfWholeBitmap)
+{
+    // we decode regions into a buffer with a stride larger than the line (with a guard value in the remaining bytes), and check that
+    //  the content is identical to the corresponding part of the whole bitmap and that no byte outside the region was modified
+    constexpr uint32_t kExtraBytesPerLine = 12;
+    constexpr uint8_t kGuardValue = 0x5a;
+    const auto codec = CJxrLibDecoder::Create();
+    for (const auto pixel_type : { PixelType::Gray8, PixelType::Gray16, PixelType::Gray32Float, PixelType::Bgr24, PixelType::Bgr48 })
+    {
+        const auto bitmap = CBitmapData<CHeapAllocator>::Create(pixel_type, 300, 200);
+        const uint32_t bytes_per_pixel = Utils::GetBytesPerPixel(pixel_type);
+        shared_ptr<libCZI::IMemoryBlock> encodedData;
+        {
+            const ScopedBitmapLockerSP lck{ bitmap };
+            for (uint32_t y = 0; y < bitmap->GetHeight(); ++y)
+            {
+                for (uint32_t x = 0; x < bitmap->GetWidth() * bytes_per_pixel; ++x)
+                {
+                    static_cast<uint8_t*>(lck.ptrDataRoi)[y * lck.stride + x] = static_cast<uint8_t>(x * 7 + y * 13 + (x * y) % 17);
+                }
+            }
+
+            encodedData = JxrLibCompress::Compress(bitmap->GetPixelType(), bitmap->GetWidth(), bitmap->GetHeight(), lck.stride, lck.ptrDataRoi, nullptr);
+        }
+
+        const auto bitmap_whole = codec->Decode(encodedData->GetPtr(), encodedData->GetSizeOfData(), pixel_type, bitmap->GetWidth(), bitmap->GetHeight());
+        const ScopedBitmapLockerSP lck_whole{ bitmap_whole };
+        for (const auto& roi : { IntRect{ 0, 0, 300, 200 }, IntRect{ 37, 21, 50, 70 }, IntRect{ 250, 150, 50, 50 }, IntRect{ 299, 0, 1, 1 } })
+        {
+            const uint32_t line_size = roi.w * bytes_per_pixel;
+            const uint32_t stride = line_size + kExtraBytesPerLine;
+            vector<uint8_t> destination(static_cast<size_t>(stride) * roi.h, kGuardValue);
+
+            const bool success = codec->TryDecodeRegionInto(encodedData->GetPtr(), encodedData->GetSizeOfData(), pixel_type, bitmap->GetWidth(), bitmap->GetHeight(), roi, destination.data(), stride);
+
+            ASSERT_TRUE(success);
+            for (int y = 0; y < roi.h; ++y)
+            {
+                const uint8_t* line_whole = static_cast<const uint8_t*>(lck_whole.ptrDataRoi) + (roi.y + y) * lck_whole.stride + roi.x * bytes_per_pixel;
+                const uint8_t* line_destination = destination.data() + static_cast<size_t>(y) * stride;
+                ASSERT_EQ(memcmp(line_whole, line_destination, line_size), 0) << "Mismatch for pixel type " << Utils::PixelTypeToInformalString(pixel_type) << " in line " << y << ".";
+                ASSERT_TRUE(all_of(line_destination + line_size, line_destination + stride, [](uint8_t v) { return v == kGuardValue; }));
+            }
+        }
+
+        // with a stride which is not a multiple of the size of a channel, the codec cannot decode into the destination (and must not touch it)
+        if (pixel_type != PixelType::Gray8 && pixel_type != PixelType::Bgr24)
+        {
+            vector<uint8_t> destination(static_cast<size_t>(10 * bytes_per_pixel + 1) * 10, kGuardValue);
+            EXPECT_FALSE(codec->TryDecodeRegionInto(encodedData->GetPtr(), encodedData->GetSizeOfData(), pixel_type, bitmap->GetWidth(), bitmap->GetHeight(), IntRect{ 0, 0, 10, 10 }, destination.data(), 10 * bytes_per_pixel + 1));
+            EXPECT_TRUE(all_of(destination.cbegin(), destination.cend(), [](uint8_t v) { return v == kGuardValue; }));
+        }
+
+        // a region which is not contained in the bitmap is rejected
+        vector<uint8_t> destination(64 * 64 * bytes_per_pixel);
+        EXPECT_THROW(codec->TryDecodeRegionInto(encodedData->GetPtr(), encodedData->GetSizeOfData(), pixel_type, bitmap->GetWidth(), bitmap->GetHeight(), IntRect{ 280, 0, 32, 32 }, destination.data(), 64 * bytes_per_pixel), invalid_argument);
+    }
+}
+
+TEST(JxrlibCodec, DecodeRegionWithSizeDifferentFromCodestreamAndExpectException)
+{
+    // when decoding a region, the size reported by the decoder is the size of the region - so, the size of the bitmap must
+    //  be checked against the header of the codestream (the regions used here are within both sizes)
+    const auto bitmap = CBitmapData<CHeapAllocator>::Create(PixelType::Gray8, 300, 200);
+    shared_ptr<libCZI::IMemoryBlock> encodedData;
+    {
+        const ScopedBitmapLockerSP lck{ bitmap };
+        memset(lck.ptrDataRoi, 0x42, static_cast<size_t>(lck.stride) * bitmap->GetHeight());
+        encodedData = JxrLibCompress::Compress(bitmap->GetPixelType(), bitmap->GetWidth(), bitmap->GetHeight(), lck.stride, lck.ptrDataRoi, nullptr);
+    }
+
+    const auto codec = CJxrLibDecoder::Create();
+    IntRect decoded_region;
+    EXPECT_THROW(codec->DecodeRegion(encodedData->GetPtr(), encodedData->GetSizeOfData(), PixelType::Gray8, 400, 250, 1, IntRect{ 10, 10, 50, 50 }, decoded_region), logic_error);
+    EXPECT_THROW(codec->DecodeRegion(encodedData->GetPtr(), encodedData->GetSizeOfData(), PixelType::Gray16, 300, 200, 1, IntRect{ 10, 10, 50, 50 }, decoded_region), logic_error);
+    EXPECT_THROW(codec->DecodeWithReducedResolution(encodedData->GetPtr(), encodedData->GetSizeOfData(), PixelType::Gray8, 302, 200, 2), logic_error);
+
+    vector<uint8_t> destination(50 * 50);
+    EXPECT_THROW(codec->TryDecodeRegionInto(encodedData->GetPtr(), encodedData->GetSizeOfData(), PixelType::Gray8, 400, 250, IntRect{ 10, 10, 50, 50 }, destination.data(), 50), logic_error);
+    EXPECT_THROW(codec->TryDecodeRegionInto(encodedData->GetPtr(), encodedData->GetSizeOfData(), PixelType::Gray8, 300, 150, IntRect{ 10, 10, 50, 50 }, destination.data(), 50), logic_error);
+
+    // and with the correct size, decoding the region succeeds
+    EXPECT_TRUE(codec->TryDecodeRegionInto(encodedData->GetPtr(), encodedData->GetSizeOfData(), PixelType::Gray8, 300, 200, IntRect{ 10, 10, 50, 50 }, destination.data(), 50));
+}
+
+namespace
+{
+    /// Restores the default (i.e. enabled) state of the decoder context pool when going out of scope.
+    struct DecoderContextPoolEnabledGuard
+    {
+        explicit DecoderContextPoolEnabledGuard(bool enabled)
+        {
+            JxrDecode::SetDecoderContextPoolEnabled(enabled);
+        }
+
+        ~DecoderContextPoolEnabledGuard()
+        {
+            JxrDecode::SetDecoderContextPoolEnabled(true);
+        }
+    };
+}
+
+static JxrDecode::CompressedData CreateJxrCompressedBitmap(JxrDecode::PixelFormat pixel_format, uint32_t width, uint32_t height, float quality)
+{
+    const uint32_t bytes_per_pixel = pixel_format == JxrDecode::PixelFormat::kBgr24 ? 3 : (pixel_format == JxrDecode::PixelFormat::kGray16 ? 2 : 1);
+    const uint32_t stride = width * bytes_per_pixel;
+    vector<uint8_t> bitmap(static_cast<size_t>(stride) * height);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < stride; ++x)
+        {
+            bitmap[static_cast<size_t>(y) * stride + x] = static_cast<uint8_t>(128 + 100 * sin(x / 40.0) * cos(y / 30.0) + (x * y) % 7);
+        }
+    }
+
+    return JxrDecode::Encode(pixel_format, width, height, stride, bitmap.data(), quality);
+}
+
+static vector<uint8_t> DecodeJxrCompressedBitmap(const JxrDecode::CompressedData& compressed_data, uint32_t downscale_factor, const JxrDecode::Region* region)
+{
+    vector<uint8_t> result;
+    JxrDecode::Decode(
+        compressed_data.GetMemory(),
+        compressed_data.GetSize(),
+        [&](JxrDecode::PixelFormat pixel_format, uint32_t width, uint32_t height)
+        {
+            const uint32_t bytes_per_pixel = pixel_format == JxrDecode::PixelFormat::kBgr24 ? 3 : (pixel_format == JxrDecode::PixelFormat::kGray16 ? 2 : 1);
+            result.resize(static_cast<size_t>(width) * bytes_per_pixel * height);
+            return make_tuple(static_cast<void*>(result.data()), width * bytes_per_pixel);
+        },
+        downscale_factor,
+        region);
+    return result;
+}
+
+TEST(JxrlibCodec, DecodeWithDecoderContextPoolAndCompareWithDecodeWithoutPool)
+{
+    // we decode bitmaps of different sizes and pixel formats in an interleaved order (and with different downscale factors and regions),
+    //  so that the pooled decoder contexts are reused for bitmaps with characteristics which differ from the previous one
+    vector<JxrDecode::CompressedData> compressed_bitmaps;
+    compressed_bitmaps.emplace_back(CreateJxrCompressedBitmap(JxrDecode::PixelFormat::kGray8, 256, 256, 1));
+    compressed_bitmaps.emplace_back(CreateJxrCompressedBitmap(JxrDecode::PixelFormat::kBgr24, 300, 200, 0.8f));
+    compressed_bitmaps.emplace_back(CreateJxrCompressedBitmap(JxrDecode::PixelFormat::kGray16, 64, 64, 1));
+    compressed_bitmaps.emplace_back(CreateJxrCompressedBitmap(JxrDecode::PixelFormat::kGray8, 1030, 90, 0.8f));
+    const JxrDecode::Region region{ 10, 20, 40, 30 };
+
+    vector<vector<uint8_t>> expected_results;
+    {
+        DecoderContextPoolEnabledGuard guard(false);
+        for (const auto& compressed_bitmap : compressed_bitmaps)
+        {
+            expected_results.emplace_back(DecodeJxrCompressedBitmap(compressed_bitmap, 1, nullptr));
+            expected_results.emplace_back(DecodeJxrCompressedBitmap(compressed_bitmap, 2, nullptr));
+            expected_results.emplace_back(DecodeJxrCompressedBitmap(compressed_bitmap, 1, &region));
+        }
+    }
+
+    DecoderContextPoolEnabledGuard guard(true);
+    for (int repetition = 0; repetition < 2; ++repetition)
+    {
+        for (size_t i = 0; i < compressed_bitmaps.size(); ++i)
+        {
+            EXPECT_TRUE(DecodeJxrCompressedBitmap(compressed_bitmaps[i], 1, nullptr) == expected_results[i * 3]) << "Mismatch for bitmap #" << i << ".";
+            EXPECT_TRUE(DecodeJxrCompressedBitmap(compressed_bitmaps[i], 2, nullptr) == expected_results[i * 3 + 1]) << "Mismatch for bitmap #" << i << " (downscale factor 2).";
+            EXPECT_TRUE(DecodeJxrCompressedBitmap(compressed_bitmaps[i], 1, &region) == expected_results[i * 3 + 2]) << "Mismatch for bitmap #" << i << " (region).";
+        }
+    }
+}
+
+TEST(JxrlibCodec, DecodeWithDecoderContextPoolAfterDecodingInvalidData)
+{
+    const auto compressed_bitmap = CreateJxrCompressedBitmap(JxrDecode::PixelFormat::kGray8, 128, 128, 1);
+    const auto expected_result = DecodeJxrCompressedBitmap(compressed_bitmap, 1, nullptr);
+
+    // a failed operation must not affect the subsequent ones
+    vector<uint8_t> invalid_data(static_cast<const uint8_t*>(compressed_bitmap.GetMemory()), static_cast<const uint8_t*>(compressed_bitmap.GetMemory()) + 64);
+    invalid_data[0] ^= 0xff;
+    EXPECT_ANY_THROW(JxrDecode::Decode(invalid_data.data(), invalid_data.size(), [](JxrDecode::PixelFormat, uint32_t, uint32_t) { return make_tuple(static_cast<void*>(nullptr), 0u); }));
+    EXPECT_ANY_THROW(JxrDecode::Decode(compressed_bitmap.GetMemory(), compressed_bitmap.GetSize(), [](JxrDecode::PixelFormat, uint32_t, uint32_t) -> tuple<void*, uint32_t> { throw runtime_error("destination not available"); }));
+    EXPECT_TRUE(DecodeJxrCompressedBitmap(compressed_bitmap, 1, nullptr) == expected_result);
+}
+
+/// This is a benchmark (and not a test) - it reports the number of bitmaps ("tiles") decoded per second for small and large
+/// tiles, with and without reusing the decoder contexts. Run it with "--gtest_also_run_disabled_tests".
+TEST(JxrlibCodec, DISABLED_BenchmarkDecodeWithAndWithoutDecoderContextPool)
+{
+    struct TileCharacteristics
+    {
+        JxrDecode::PixelFormat pixel_format;
+        uint32_t size;
+        const char* name;
+    };
+
+    const TileCharacteristics tile_characteristics[] =
+    {
+        { JxrDecode::PixelFormat::kGray8, 64, "Gray8 64x64" },
+        { JxrDecode::PixelFormat::kGray8, 256, "Gray8 256x256" },
+        { JxrDecode::PixelFormat::kBgr24, 256, "Bgr24 256x256" },
+        { JxrDecode::PixelFormat::kGray16, 256, "Gray16 256x256" },
+        { JxrDecode::PixelFormat::kGray8, 2048, "Gray8 2048x2048" },
+        { JxrDecode::PixelFormat::kBgr24, 2048, "Bgr24 2048x2048" },
+    };
+
+    for (const auto& tile : tile_characteristics)
+    {
+        const auto compressed_bitmap = CreateJxrCompressedBitmap(tile.pixel_format, tile.size, tile.size, 0.9f);
+        vector<uint8_t> destination(static_cast<size_t>(tile.size) * tile.size * 3);
+        const int number_of_tiles = static_cast<int>((max)(static_cast<uint64_t>(4), (static_cast<uint64_t>(1) << 28) / (static_cast<uint64_t>(tile.size) * tile.size)) / 4);
+
+        // the runs with and without pool are interleaved, and the best run is reported (in order to reduce the influence of other activity on the machine)
+        double tiles_per_second[2] = { 0, 0 };
+        for (int run = 0; run < 3; ++run)
+        {
+            for (const bool use_pool : { false, true })
+            {
+                DecoderContextPoolEnabledGuard guard(use_pool);
+                const auto start = chrono::steady_clock::now();
+                for (int i = 0; i < number_of_tiles; ++i)
+                {
+                    JxrDecode::Decode(
+                        compressed_bitmap.GetMemory(),
+                        compressed_bitmap.GetSize(),
+                        [&](JxrDecode::PixelFormat pixel_format, uint32_t width, uint32_t height)
+                        {
+                            return make_tuple(static_cast<void*>(destination.data()), width * 3);
+                        });
+                }
+
+                const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+                tiles_per_second[use_pool ? 1 : 0] = (max)(tiles_per_second[use_pool ? 1 : 0], number_of_tiles / elapsed.count());
+            }
+        }
+
+        cout << tile.name << ": " << tiles_per_second[0] << " tiles/s without pool, " << tiles_per_second[1] << " tiles/s with pool ("
+            << (tiles_per_second[1] / tiles_per_second[0] - 1) * 100 << "%)" << endl;
+    }
+}
@@ -5,6 +5,9 @@
 #include "include_gtest.h"
 #include "inc_libCZI.h"
 #include "utils.h"
+#include <atomic>
+#include <thread>
+#include <vector>
 
 using namespace libCZI;
 using namespace std;
@@ -156,3 +159,334 @@ TEST(SubBlockCache, PruneCacheCase3)
     bitmap_from_cache = cache->Get(2);
     EXPECT_TRUE(bitmap_from_cache != nullptr);
 }
+
+TEST(SubBlockCache, ShardedCacheAddOverwriteAndGetStatistics)
+{
+    SubBlockCacheOptions options;
+    options.type = SubBlockCacheOptions::Type::Sharded;
+    options.number_of_shards = 4;
+    const auto cache = CreateSubBlockCache(&options);
+    const auto bm1 = CreateTestBitmap(PixelType::Bgr24, 163, 128);
+    cache->Add(0, bm1);
+    const auto bm2 = CreateTestBitmap(PixelType::Bgr24, 161, 114);
+    cache->Add(1, bm2);
+    const auto bm3 = CreateTestBitmap(PixelType::Gray8, 11, 14);
+    cache->Add(1, bm3);
+
+    EXPECT_TRUE(AreBitmapDataEqual(bm1, cache->Get(0)));
+    EXPECT_TRUE(AreBitmapDataEqual(bm3, cache->Get(1)));
+    EXPECT_TRUE(!cache->Get(2));
+
+    const auto statistics_both = cache->GetStatistics(ISubBlockCacheStatistics::kMemoryUsage | ISubBlockCacheStatistics::kElementsCount);
+    EXPECT_EQ(statistics_both.validityMask, ISubBlockCacheStatistics::kMemoryUsage | ISubBlockCacheStatistics::kElementsCount);
+    EXPECT_EQ(statistics_both.memoryUsage, 163 * 128 * 3 + 11 * 14);
+    EXPECT_EQ(statistics_both.elementsCount, 2);
+}
+
+TEST(SubBlockCache, ShardedCachePruneAndCheckThatLeastRecentlyUsedElementsAreRemoved)
+{
+    // We add 1000 elements (each one byte in size), then we access every third element (in descending order). When pruning the cache to
+    // 300 elements, exactly the 300 most recently accessed elements must remain - no matter to which shard they belong.
+    SubBlockCacheOptions options;
+    options.type = SubBlockCacheOptions::Type::Sharded;
+    const auto cache = CreateSubBlockCache(&options);
+    const auto bitmap = CreateTestBitmap(PixelType::Gray8, 1, 1);
+    for (int i = 0; i < 1000; ++i)
+    {
+        cache->Add(i, bitmap);
+    }
+
+    vector<int> accessed_elements;
+    for (int i = 999; i >= 0; i -= 3)
+    {
+        EXPECT_TRUE(cache->Get(i) != nullptr);
+        accessed_elements.push_back(i);
+    }
+
+    ISubBlockCache::PruneOptions prune_options;
+    prune_options.maxSubBlockCount = 300;
+    cache->Prune(prune_options);
+    auto statistics = cache->GetStatistics(ISubBlockCacheStatistics::kMemoryUsage | ISubBlockCacheStatistics::kElementsCount);
+    EXPECT_EQ(statistics.elementsCount, 300);
+    EXPECT_EQ(statistics.memoryUsage, 300);
+
+    for (size_t i = 0; i < accessed_elements.size(); ++i)
+    {
+        const bool expected_in_cache = i >= accessed_elements.size() - 300;
+        EXPECT_EQ(cache->Get(accessed_elements[i]) != nullptr, expected_in_cache) << "element " << accessed_elements[i];
+    }
+
+    prune_options.maxSubBlockCount = numeric_limits<uint32_t>::max();
+    prune_options.maxMemoryUsage = 0;
+    cache->Prune(prune_options);
+    statistics = cache->GetStatistics(ISubBlockCacheStatistics::kMemoryUsage | ISubBlockCacheStatistics::kElementsCount);
+    EXPECT_EQ(statistics.elementsCount, 0);
+    EXPECT_EQ(statistics.memoryUsage, 0);
+}
+
+TEST(SubBlockCache, ShardedCacheConcurrentAddGetAndPrune)
+{
+    for (const auto eviction_policy : { SubBlockCacheOptions::EvictionPolicy::Lru, SubBlockCacheOptions::EvictionPolicy::WTinyLfu })
+    {
+        SubBlockCacheOptions options;
+        options.type = SubBlockCacheOptions::Type::Sharded;
+        options.number_of_shards = 8;
+        options.eviction_policy = eviction_policy;
+        const auto cache = CreateSubBlockCache(&options);
+        const auto bitmap = CreateTestBitmap(PixelType::Gray8, 10, 10);
+
+        vector<thread> threads;
+        atomic<bool> all_results_valid{ true };
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back(
+                [&, t]()
+                {
+                    ISubBlockCache::PruneOptions prune_options;
+                    prune_options.maxSubBlockCount = 50;
+                    for (int i = 0; i < 5000; ++i)
+                    {
+                        const int subblock_index = (i * 7 + t * 13) % 200;
+                        cache->Add(subblock_index, bitmap);
+                        const auto bitmap_from_cache = cache->Get((subblock_index + 1) % 200);
+                        if (bitmap_from_cache && bitmap_from_cache != bitmap)
+                        {
+                            all_results_valid = false;
+                        }
+
+                        if (i % 10 == 0)
+                        {
+                            cache->Prune(prune_options);
+                        }
+                    }
+                });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        EXPECT_TRUE(all_results_valid.load());
+
+        ISubBlockCache::PruneOptions prune_options;
+        prune_options.maxSubBlockCount = 50;
+        cache->Prune(prune_options);
+        const auto statistics = cache->GetStatistics(ISubBlockCacheStatistics::kMemoryUsage | ISubBlockCacheStatistics::kElementsCount);
+        EXPECT_EQ(statistics.elementsCount, 50);
+        EXPECT_EQ(statistics.memoryUsage, 50 * 100);
+    }
+}
+
+TEST(SubBlockCache, GetHitAndMissCountAndCheckResult)
+{
+    for (const auto type : { SubBlockCacheOptions::Type::Simple, SubBlockCacheOptions::Type::Sharded })
+    {
+        SubBlockCacheOptions options;
+        options.type = type;
+        const auto cache = CreateSubBlockCache(&options);
+        const auto bitmap = CreateTestBitmap(PixelType::Gray8, 2, 2);
+        cache->Add(0, bitmap);
+        cache->Add(1, bitmap);
+        cache->Get(0);
+        cache->Get(1);
+        cache->Get(1);
+        cache->Get(2);
+
+        const auto statistics = cache->GetStatistics(ISubBlockCacheStatistics::kHitCount | ISubBlockCacheStatistics::kMissCount | ISubBlockCacheStatistics::kElementsCount);
+        EXPECT_EQ(statistics.validityMask, ISubBlockCacheStatistics::kHitCount | ISubBlockCacheStatistics::kMissCount | ISubBlockCacheStatistics::kElementsCount);
+        EXPECT_EQ(statistics.hitCount, 3u);
+        EXPECT_EQ(statistics.missCount, 1u);
+        EXPECT_EQ(statistics.elementsCount, 2u);
+    }
+}
+
+/// Simulates the typical use of the cache: the element is retrieved from the cache, and if it is not found, it is "decoded" and added to the
+/// cache, which is then pruned to the specified number of elements.
+static void AccessElementOfCache(ISubBlockCache* cache, int subblock_index, uint32_t decode_cost_weight, uint32_t max_number_of_elements)
+{
+    if (!cache->Get(subblock_index))
+    {
+        cache->AddWithDecodeCost(subblock_index, CreateTestBitmap(PixelType::Gray8, 1, 1), decode_cost_weight);
+        ISubBlockCache::PruneOptions prune_options;
+        prune_options.maxSubBlockCount = max_number_of_elements;
+        cache->Prune(prune_options);
+    }
+}
+
+TEST(SubBlockCache, WTinyLfuCacheKeepsFrequentlyUsedElementsDuringScan)
+{
+    // We repeatedly access a "hot set" of 50 elements, and then access 2000 other elements once (a "scan"), with the cache limited to 200
+    // elements. With the LRU policy, the scan evicts all elements of the hot set, whereas W-TinyLFU is expected to keep (most of) them.
+    const auto count_hot_elements_in_cache_after_scan =
+        [](SubBlockCacheOptions::EvictionPolicy eviction_policy) -> int
+        {
+            SubBlockCacheOptions options;
+            options.type = SubBlockCacheOptions::Type::Sharded;
+            options.eviction_policy = eviction_policy;
+            const auto cache = CreateSubBlockCache(&options);
+            for (int round = 0; round < 10; ++round)
+            {
+                for (int i = 0; i < 50; ++i)
+                {
+                    AccessElementOfCache(cache.get(), i, 1, 200);
+                }
+            }
+
+            for (int i = 1000; i < 3000; ++i)
+            {
+                AccessElementOfCache(cache.get(), i, 1, 200);
+            }
+
+            EXPECT_LE(cache->GetStatistics(ISubBlockCacheStatistics::kElementsCount).elementsCount, 200u);
+            int count = 0;
+            for (int i = 0; i < 50; ++i)
+            {
+                if (cache->Get(i))
+                {
+                    ++count;
+                }
+            }
+
+            return count;
+        };
+
+    EXPECT_EQ(count_hot_elements_in_cache_after_scan(SubBlockCacheOptions::EvictionPolicy::Lru), 0);
+    EXPECT_GE(count_hot_elements_in_cache_after_scan(SubBlockCacheOptions::EvictionPolicy::WTinyLfu), 45);
+}
+
+TEST(SubBlockCache, WTinyLfuCachePrefersElementsWhichAreExpensiveToDecode)
+{
+    // We fill the cache with 100 elements which are cheap to decode (and accessed twice), and then access 100 elements which
+    // are expensive to decode once. The expensive elements should replace the cheap ones, even though they were accessed less often.
+    SubBlockCacheOptions options;
+    options.type = SubBlockCacheOptions::Type::Sharded;
+    options.eviction_policy = SubBlockCacheOptions::EvictionPolicy::WTinyLfu;
+    const auto cache = CreateSubBlockCache(&options);
+    for (int round = 0; round < 2; ++round)
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            AccessElementOfCache(cache.get(), i, 1, 100);
+        }
+    }
+
+    for (int i = 1000; i < 1100; ++i)
+    {
+        AccessElementOfCache(cache.get(), i, 32, 100);
+    }
+
+    int number_of_expensive_elements_in_cache = 0;
+    for (int i = 1000; i < 1100; ++i)
+    {
+        if (cache->Get(i))
+        {
+            ++number_of_expensive_elements_in_cache;
+        }
+    }
+
+    EXPECT_GE(number_of_expensive_elements_in_cache, 90);
+}
+
+TEST(SubBlockCache, CreateSimpleCacheWithWTinyLfuPolicyAndExpectException)
+{
+    SubBlockCacheOptions options;
+    options.type = SubBlockCacheOptions::Type::Simple;
+    options.eviction_policy = SubBlockCacheOptions::EvictionPolicy::WTinyLfu;
+    EXPECT_THROW(CreateSubBlockCache(&options), invalid_argument);
+}
+
+/// Creates a sub-block object (which is only suitable for testing the compressed tier of the cache) with the specified size of the data.
+static shared_ptr<ISubBlock> CreateTestSubBlock(size_t size_of_data)
+{
+    class CTestSubBlock : public ISubBlock
+    {
+    private:
+        SubBlockInfo subblock_info_;
+        shared_ptr<uint8_t> data_;
+        size_t size_of_data_;
+    public:
+        explicit CTestSubBlock(size_t size_of_data) : subblock_info_(), data_(new uint8_t[size_of_data], default_delete<uint8_t[]>()), size_of_data_(size_of_data) {}
+        const SubBlockInfo& GetSubBlockInfo() const override { return this->subblock_info_; }
+        void DangerousGetRawData(MemBlkType type, const void*& ptr, size_t& size) const override
+        {
+            ptr = type == MemBlkType::Data ? this->data_.get() : nullptr;
+            size = type == MemBlkType::Data ? this->size_of_data_ : 0;
+        }
+
+        shared_ptr<const void> GetRawData(MemBlkType type, size_t* ptrSize) override
+        {
+            const void* ptr;
+            size_t size;
+            this->DangerousGetRawData(type, ptr, size);
+            if (ptrSize != nullptr)
+            {
+                *ptrSize = size;
+            }
+
+            return type == MemBlkType::Data ? this->data_ : nullptr;
+        }
+
+        shared_ptr<IBitmapData> CreateBitmap() override { return CreateTestBitmap(PixelType::Gray8, 1, 1); }
+        bool TryGetWidthAndHeightOfJpgxrCompressedBitmap(std::uint32_t& width, std::uint32_t& height) const override { return false; }
+    };
+
+    return make_shared<CTestSubBlock>(size_of_data);
+}
+
+TEST(SubBlockCache, TwoTierCacheAddSubBlocksAndPruneAndCheckThatLeastRecentlyUsedAreRemoved)
+{
+    for (const auto type : { SubBlockCacheOptions::Type::Simple, SubBlockCacheOptions::Type::Sharded })
+    {
+        SubBlockCacheOptions options;
+        options.type = type;
+        options.enable_compressed_tier = true;
+        const auto cache = CreateSubBlockCache(&options);
+        for (int i = 0; i < 10; ++i)
+        {
+            cache->AddSubBlock(i, CreateTestSubBlock(100));
+        }
+
+        cache->Add(0, CreateTestBitmap(PixelType::Gray8, 4, 4));
+        auto statistics = cache->GetStatistics(ISubBlockCacheStatistics::kCompressedTierMemoryUsage | ISubBlockCacheStatistics::kCompressedTierElementsCount | ISubBlockCacheStatistics::kElementsCount);
+        EXPECT_EQ(statistics.validityMask, ISubBlockCacheStatistics::kCompressedTierMemoryUsage | ISubBlockCacheStatistics::kCompressedTierElementsCount | ISubBlockCacheStatistics::kElementsCount);
+        EXPECT_EQ(statistics.compressedTierMemoryUsage, 1000u);
+        EXPECT_EQ(statistics.compressedTierElementsCount, 10u);
+        EXPECT_EQ(statistics.elementsCount, 1u);
+
+        // retrieving the bitmap of sub-block 0 marks it as used in the compressed tier as well
+        EXPECT_TRUE(cache->Get(0));
+        EXPECT_TRUE(cache->GetSubBlock(5));
+
+        ISubBlockCache::PruneOptions prune_options;
+        prune_options.maxSubBlockCountCompressedTier = 2;
+        cache->Prune(prune_options);
+
+        statistics = cache->GetStatistics(ISubBlockCacheStatistics::kCompressedTierMemoryUsage | ISubBlockCacheStatistics::kCompressedTierElementsCount | ISubBlockCacheStatistics::kElementsCount);
+        EXPECT_EQ(statistics.compressedTierMemoryUsage, 200u);
+        EXPECT_EQ(statistics.compressedTierElementsCount, 2u);
+        EXPECT_EQ(statistics.elementsCount, 1u);
+        EXPECT_TRUE(cache->GetSubBlock(0));
+        EXPECT_TRUE(cache->GetSubBlock(5));
+        for (int i : { 1, 2, 3, 4, 6, 7, 8, 9 })
+        {
+            EXPECT_FALSE(cache->GetSubBlock(i));
+        }
+
+        // pruning the decoded tier leaves the compressed tier unchanged
+        prune_options = ISubBlockCache::PruneOptions();
+        prune_options.maxMemoryUsage = 0;
+        cache->Prune(prune_options);
+        EXPECT_FALSE(cache->Get(0));
+        EXPECT_TRUE(cache->GetSubBlock(0));
+    }
+}
+
+TEST(SubBlockCache, CacheWithoutCompressedTierIgnoresSubBlocks)
+{
+    const auto cache = CreateSubBlockCache();
+    cache->AddSubBlock(0, CreateTestSubBlock(100));
+    EXPECT_FALSE(cache->GetSubBlock(0));
+    const auto statistics = cache->GetStatistics(ISubBlockCacheStatistics::kCompressedTierMemoryUsage | ISubBlockCacheStatistics::kMemoryUsage);
+    EXPECT_TRUE(statistics.validityMask == ISubBlockCacheStatistics::kMemoryUsage);
+}
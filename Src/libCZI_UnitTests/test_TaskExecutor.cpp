@@ -0,0 +1,161 @@
+// SPDX-FileCopyrightText: 2024 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "include_gtest.h"
+#include "inc_libCZI.h"
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace libCZI;
+using namespace std;
+
+TEST(TaskExecutor, SubmitManyTasksFromSeveralThreadsAndCheckThatAllAreExecuted)
+{
+    const auto executor = CreateWorkStealingTaskExecutor(4);
+    EXPECT_EQ(executor->GetMaxConcurrency(), 4);
+
+    constexpr int kTasksPerThread = 1000;
+    atomic<int> counter{ 0 };
+    promise<void> all_done;
+    vector<thread> threads;
+    for (int t = 0; t < 3; ++t)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                for (int i = 0; i < kTasksPerThread; ++i)
+                {
+                    executor->Submit(
+                        static_cast<TaskPriority>(i % 3),
+                        [&]()
+                        {
+                            if (++counter == 3 * kTasksPerThread)
+                            {
+                                all_done.set_value();
+                            }
+                        });
+                }
+            });
+    }
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    ASSERT_EQ(all_done.get_future().wait_for(chrono::seconds(60)), future_status::ready);
+    EXPECT_EQ(counter.load(), 3 * kTasksPerThread);
+}
+
+TEST(TaskExecutor, SubmitTasksFromWithinTasksAndCheckThatAllAreExecuted)
+{
+    // every task submits two more tasks (up to a certain depth), so that most tasks are submitted
+    // from worker threads (and have to be stolen by the other workers)
+    const auto executor = CreateWorkStealingTaskExecutor(4);
+    constexpr int kDepth = 10;
+    constexpr int kExpectedNumberOfTasks = (1 << (kDepth + 1)) - 1;
+    atomic<int> counter{ 0 };
+    promise<void> all_done;
+    function<void(int)> task = [&](int depth)
+        {
+            if (depth < kDepth)
+            {
+                executor->Submit(TaskPriority::Normal, [&, depth]() { task(depth + 1); });
+                executor->Submit(TaskPriority::Normal, [&, depth]() { task(depth + 1); });
+            }
+
+            if (++counter == kExpectedNumberOfTasks)
+            {
+                all_done.set_value();
+            }
+        };
+
+    executor->Submit(TaskPriority::Normal, [&]() { task(0); });
+
+    ASSERT_EQ(all_done.get_future().wait_for(chrono::seconds(60)), future_status::ready);
+    EXPECT_EQ(counter.load(), kExpectedNumberOfTasks);
+}
+
+TEST(TaskExecutor, SubmitTasksWithDifferentPrioritiesAndCheckOrderOfExecution)
+{
+    // we block the only worker with a task, then submit tasks with different priorities, and expect
+    // that the pending tasks are started in the order of their priority
+    const auto executor = CreateWorkStealingTaskExecutor(1);
+    mutex mutex_;
+    condition_variable condition;
+    bool release_worker = false;
+    executor->Submit(
+        TaskPriority::Normal,
+        [&]()
+        {
+            unique_lock<mutex> lock(mutex_);
+            condition.wait(lock, [&]() { return release_worker; });
+        });
+
+    vector<TaskPriority> order_of_execution;
+    promise<void> all_done;
+    constexpr int kTasksPerPriority = 5;
+    for (int i = 0; i < kTasksPerPriority; ++i)
+    {
+        for (const auto priority : { TaskPriority::Background, TaskPriority::Normal, TaskPriority::Interactive })
+        {
+            executor->Submit(
+                priority,
+                [&, priority]()
+                {
+                    lock_guard<mutex> lock(mutex_);
+                    order_of_execution.push_back(priority);
+                    if (order_of_execution.size() == 3 * kTasksPerPriority)
+                    {
+                        all_done.set_value();
+                    }
+                });
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(mutex_);
+        release_worker = true;
+    }
+
+    condition.notify_all();
+    ASSERT_EQ(all_done.get_future().wait_for(chrono::seconds(60)), future_status::ready);
+
+    lock_guard<mutex> lock(mutex_);
+    for (int i = 0; i < 3 * kTasksPerPriority; ++i)
+    {
+        EXPECT_EQ(order_of_execution[i], static_cast<TaskPriority>(i / kTasksPerPriority));
+    }
+}
+
+TEST(TaskExecutor, GetDefaultTaskExecutorAndCheckThatItIsAlwaysTheSameObject)
+{
+    const auto executor1 = GetDefaultTaskExecutor();
+    const auto executor2 = GetDefaultTaskExecutor();
+    ASSERT_TRUE(executor1);
+    EXPECT_EQ(executor1, executor2);
+    EXPECT_GE(executor1->GetMaxConcurrency(), 1);
+}
+
+TEST(TaskExecutor, ReleaseLastReferenceToExecutorInOwnTaskAndCheckThatThisIsHandled)
+{
+    auto executor = CreateWorkStealingTaskExecutor(2);
+    promise<void> task_done;
+    auto executor_reference = executor;
+    executor->Submit(
+        TaskPriority::Normal,
+        [&task_done, executor_reference]() mutable
+        {
+            // the executor is destroyed here (on one of its own worker threads)
+            executor_reference.reset();
+            task_done.set_value();
+        });
+
+    executor.reset();
+    ASSERT_EQ(task_done.get_future().wait_for(chrono::seconds(60)), future_status::ready);
+}
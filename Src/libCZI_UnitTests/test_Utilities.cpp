@@ -5,8 +5,11 @@
 #include "include_gtest.h"
 #include "inc_libCZI.h"
 #include "../libCZI/CziParse.h"
+#include "../libCZI/utilities.h"
+#include <random>
 
 using namespace libCZI;
+using namespace std;
 
 TEST(Utilities, CompareCoordinates1)
 {
@@ -310,3 +313,147 @@ TEST(Utilities, CallGetLibCZIBuildInformationAndCheckResultForPlausibility)
         build_information.repositoryBranch.empty() &&
         build_information.repositoryTag.empty());
 }
+
+TEST(Utilities, RectangleSoaFilterAndCompareWithDoIntersect)
+{
+    mt19937 random_engine(4711);
+    uniform_int_distribution<int> distribution_position(-100, 100);
+    uniform_int_distribution<int> distribution_size(-5, 60);
+    const size_t count = 1003;  // not a multiple of the vector width, so that the remainder-loop is exercised as well
+    vector<int32_t> x(count), y(count), w(count), h(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        x[i] = distribution_position(random_engine);
+        y[i] = distribution_position(random_engine);
+        w[i] = distribution_size(random_engine);
+        h[i] = distribution_size(random_engine);
+    }
+
+    for (int n = 0; n < 20; ++n)
+    {
+        const IntRect roi{ distribution_position(random_engine), distribution_position(random_engine), distribution_size(random_engine), distribution_size(random_engine) };
+        vector<uint8_t> mask(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            mask[i] = i % 5 == 0 ? 0 : 0xff;
+        }
+
+        RectangleSoaFilter::AndMaskWithIntersection(roi, x.data(), y.data(), w.data(), h.data(), count, mask.data());
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const bool expected = i % 5 != 0 && Utilities::DoIntersect(roi, IntRect{ x[i], y[i], w[i], h[i] });
+            EXPECT_EQ(mask[i] != 0, expected) << "mismatch at index " << i;
+        }
+    }
+}
+
+namespace
+{
+    /// This class gives access to the scalar versions of the row kernels (which are used as the reference).
+    class MultiChannelCompositorRowKernelsReference : public MultiChannelCompositorRowKernels
+    {
+    public:
+        using MultiChannelCompositorRowKernels::ConvertToBgr24_C;
+        using MultiChannelCompositorRowKernels::AddSaturated_C;
+        using MultiChannelCompositorRowKernels::StoreWithWeight_C;
+        using MultiChannelCompositorRowKernels::AddWithWeightSaturated_C;
+    };
+}
+
+TEST(Utilities, MultiChannelCompositorRowKernelsConvertToBgr24AndCompareWithScalarVersion)
+{
+    const PixelType pixel_types[] = { PixelType::Gray8, PixelType::Gray16, PixelType::Bgr24, PixelType::Bgr48 };
+    mt19937 random_engine(4711);
+    uniform_int_distribution<int> distribution_byte(0, 255);
+    uniform_int_distribution<int> distribution_count(0, 100);
+    uniform_int_distribution<int> distribution_mode(0, 3);
+    vector<uint8_t> look_up_table(256 * 256);
+    for (auto& element : look_up_table)
+    {
+        element = static_cast<uint8_t>(distribution_byte(random_engine));
+    }
+
+    for (int iteration = 0; iteration < 400; ++iteration)
+    {
+        MultiChannelCompositorRowKernels::ChannelParameters parameters;
+        parameters.pixelType = pixel_types[iteration % 4];
+        const bool is_16bit = parameters.pixelType == PixelType::Gray16 || parameters.pixelType == PixelType::Bgr48;
+        uniform_int_distribution<int> distribution_threshold(0, is_16bit ? 0xffff : 0xff);
+        parameters.enableTinting = (iteration / 4) % 2 == 1;
+        parameters.tintingColor = Rgb8Color{ static_cast<uint8_t>(distribution_byte(random_engine)), static_cast<uint8_t>(distribution_byte(random_engine)), static_cast<uint8_t>(distribution_byte(random_engine)) };
+        parameters.ptrLookUpTable = nullptr;
+        parameters.enableBlackWhitePoint = false;
+        parameters.blackPoint = parameters.whitePoint = 0;
+        switch (distribution_mode(random_engine))
+        {
+        case 0:
+            parameters.ptrLookUpTable = look_up_table.data();
+            break;
+        case 1:
+            // note that the white-point may be less than (or equal to) the black-point here
+            parameters.enableBlackWhitePoint = true;
+            parameters.blackPoint = static_cast<uint16_t>(distribution_threshold(random_engine));
+            parameters.whitePoint = static_cast<uint16_t>(distribution_threshold(random_engine));
+            break;
+        case 2:
+            // a small (even) distance between black-point and white-point gives values which are exactly in the middle
+            //  between two integers, so that the rounding is checked
+            parameters.enableBlackWhitePoint = true;
+            parameters.blackPoint = static_cast<uint16_t>(distribution_byte(random_engine) / 2);
+            parameters.whitePoint = static_cast<uint16_t>(parameters.blackPoint + 2 * (1 + distribution_byte(random_engine) % 4));
+            break;
+        default:
+            break;
+        }
+
+        const uint32_t count = distribution_count(random_engine);
+        vector<uint8_t> source(count * Utils::GetBytesPerPixel(parameters.pixelType));
+        for (auto& element : source)
+        {
+            element = static_cast<uint8_t>(distribution_byte(random_engine));
+        }
+
+        vector<uint8_t> result(count * 3, 0xaa);
+        vector<uint8_t> expected_result(count * 3, 0xaa);
+        MultiChannelCompositorRowKernels::ConvertToBgr24(parameters, source.data(), count, result.data());
+        MultiChannelCompositorRowKernelsReference::ConvertToBgr24_C(parameters, source.data(), count, expected_result.data());
+        ASSERT_TRUE(result == expected_result) << "mismatch in iteration " << iteration;
+    }
+}
+
+TEST(Utilities, MultiChannelCompositorRowKernelsAddAndStoreWithWeightAndCompareWithScalarVersion)
+{
+    mt19937 random_engine(4711);
+    uniform_int_distribution<int> distribution_byte(0, 255);
+    uniform_int_distribution<int> distribution_count(0, 200);
+    const float weights[] = { 0, 0.1f, 0.5f, 1, 1.7f, 3, 200 };
+    for (int iteration = 0; iteration < 100; ++iteration)
+    {
+        const uint32_t count = distribution_count(random_engine);
+        vector<uint8_t> source(count), destination(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            source[i] = static_cast<uint8_t>(distribution_byte(random_engine));
+            destination[i] = static_cast<uint8_t>(distribution_byte(random_engine));
+        }
+
+        vector<uint8_t> result = destination, expected_result = destination;
+        MultiChannelCompositorRowKernels::AddSaturated(source.data(), count, result.data());
+        MultiChannelCompositorRowKernelsReference::AddSaturated_C(source.data(), count, expected_result.data());
+        ASSERT_TRUE(result == expected_result) << "mismatch in iteration " << iteration;
+
+        for (const float weight : weights)
+        {
+            result = expected_result = destination;
+            MultiChannelCompositorRowKernels::StoreWithWeight(source.data(), count, weight, result.data());
+            MultiChannelCompositorRowKernelsReference::StoreWithWeight_C(source.data(), count, weight, expected_result.data());
+            ASSERT_TRUE(result == expected_result) << "mismatch in iteration " << iteration << " with weight " << weight;
+
+            result = expected_result = destination;
+            MultiChannelCompositorRowKernels::AddWithWeightSaturated(source.data(), count, weight, result.data());
+            MultiChannelCompositorRowKernelsReference::AddWithWeightSaturated_C(source.data(), count, weight, expected_result.data());
+            ASSERT_TRUE(result == expected_result) << "mismatch in iteration " << iteration << " with weight " << weight;
+        }
+    }
+}
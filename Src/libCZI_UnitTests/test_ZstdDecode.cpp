@@ -3,6 +3,8 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include "include_gtest.h"
+#include <algorithm>
+#include <vector>
 #include "inc_libCZI.h"
 #include "testImage.h"
 #include "../libCZI/decoder_zstd.h"
@@ -52,3 +54,62 @@ TEST(ZstdDecode, DecodeAndHiLoBytePacking)
     static const uint8_t expectedResult[16] = { 0x9b, 0xe3, 0x65, 0x99, 0x9a, 0xce, 0xcc, 0xb8, 0xa7, 0xc6, 0x2f, 0x0b, 0xa4, 0xd9, 0xce, 0x90 };
     EXPECT_TRUE(memcmp(hash, expectedResult, 16) == 0) << "Incorrect result";
 }
+
+TEST(ZstdDecode, TryDecodeRegionIntoAndCompareWithDecode)
+{
+    // zstd can only decode the whole bitmap into a destination - and without hi-lo-unpacking, only if the lines in the destination are contiguous
+    auto dec = CZstd1Decoder::Create();
+    size_t sizeEncoded; int expectedWidth, expectedHeight;
+    auto ptrEncodedData = CTestImage::GetZStd1CompressedImage(&sizeEncoded, &expectedWidth, &expectedHeight);
+    auto bmDecoded = dec->Decode(ptrEncodedData, sizeEncoded, PixelType::Gray8, expectedWidth, expectedHeight);
+    const ScopedBitmapLockerSP lckDecoded{ bmDecoded };
+
+    vector<uint8_t> destination(static_cast<size_t>(expectedWidth + 1) * expectedHeight, 0x5a);
+    EXPECT_FALSE(dec->TryDecodeRegionInto(ptrEncodedData, sizeEncoded, PixelType::Gray8, expectedWidth, expectedHeight, IntRect{ 1, 1, 10, 10 }, destination.data(), expectedWidth));
+    EXPECT_FALSE(dec->TryDecodeRegionInto(ptrEncodedData, sizeEncoded, PixelType::Gray8, expectedWidth, expectedHeight, IntRect{ 0, 0, expectedWidth, expectedHeight }, destination.data(), expectedWidth + 1));
+    EXPECT_TRUE(all_of(destination.cbegin(), destination.cend(), [](uint8_t v) { return v == 0x5a; })) << "The destination must not be modified if false is returned.";
+
+    ASSERT_TRUE(dec->TryDecodeRegionInto(ptrEncodedData, sizeEncoded, PixelType::Gray8, expectedWidth, expectedHeight, IntRect{ 0, 0, expectedWidth, expectedHeight }, destination.data(), expectedWidth));
+    for (int y = 0; y < expectedHeight; ++y)
+    {
+        ASSERT_EQ(memcmp(static_cast<const uint8_t*>(lckDecoded.ptrDataRoi) + static_cast<size_t>(y) * lckDecoded.stride, destination.data() + static_cast<size_t>(y) * expectedWidth, expectedWidth), 0);
+    }
+}
+
+TEST(ZstdDecode, TryDecodeRegionIntoWithHiLoBytePackingAndCompareWithDecode)
+{
+    // with hi-lo-unpacking, the destination may have an arbitrary stride
+    constexpr uint32_t kExtraBytesPerLine = 6;
+    auto dec = CZstd1Decoder::Create();
+    size_t sizeEncoded; int expectedWidth, expectedHeight;
+    auto ptrEncodedData = CTestImage::GetZStd1CompressedImageWithHiLoPacking(&sizeEncoded, &expectedWidth, &expectedHeight);
+    auto bmDecoded = dec->Decode(ptrEncodedData, sizeEncoded, PixelType::Gray16, expectedWidth, expectedHeight);
+    const ScopedBitmapLockerSP lckDecoded{ bmDecoded };
+
+    const uint32_t lineSize = expectedWidth * 2;
+    const uint32_t stride = lineSize + kExtraBytesPerLine;
+    vector<uint8_t> destination(static_cast<size_t>(stride) * expectedHeight, 0x5a);
+    ASSERT_TRUE(dec->TryDecodeRegionInto(ptrEncodedData, sizeEncoded, PixelType::Gray16, expectedWidth, expectedHeight, IntRect{ 0, 0, expectedWidth, expectedHeight }, destination.data(), stride));
+    for (int y = 0; y < expectedHeight; ++y)
+    {
+        const uint8_t* line = destination.data() + static_cast<size_t>(y) * stride;
+        ASSERT_EQ(memcmp(static_cast<const uint8_t*>(lckDecoded.ptrDataRoi) + static_cast<size_t>(y) * lckDecoded.stride, line, lineSize), 0);
+        ASSERT_TRUE(all_of(line + lineSize, line + stride, [](uint8_t v) { return v == 0x5a; }));
+    }
+}
+
+TEST(ZstdDecode, TryDecodeRegionIntoWithSizeDifferentFromFrameAndExpectExceptionAndUnmodifiedDestination)
+{
+    // the size of the frame must be checked before anything is written to the destination
+    auto dec = CZstd1Decoder::Create();
+    size_t sizeEncoded; int expectedWidth, expectedHeight;
+    auto ptrEncodedData = CTestImage::GetZStd1CompressedImage(&sizeEncoded, &expectedWidth, &expectedHeight);
+    vector<uint8_t> destination(static_cast<size_t>(expectedWidth) * (expectedHeight + 1), 0x5a);
+    EXPECT_THROW(dec->TryDecodeRegionInto(ptrEncodedData, sizeEncoded, PixelType::Gray8, expectedWidth, expectedHeight + 1, IntRect{ 0, 0, expectedWidth, expectedHeight + 1 }, destination.data(), expectedWidth), runtime_error);
+    EXPECT_TRUE(all_of(destination.cbegin(), destination.cend(), [](uint8_t v) { return v == 0x5a; })) << "The destination must not be modified if the data is not valid.";
+
+    ptrEncodedData = CTestImage::GetZStd1CompressedImageWithHiLoPacking(&sizeEncoded, &expectedWidth, &expectedHeight);
+    destination.assign(static_cast<size_t>(expectedWidth) * 2 * expectedHeight, 0x5a);
+    EXPECT_THROW(dec->TryDecodeRegionInto(ptrEncodedData, sizeEncoded, PixelType::Gray16, expectedWidth, expectedHeight / 2, IntRect{ 0, 0, expectedWidth, expectedHeight / 2 }, destination.data(), expectedWidth * 2), runtime_error);
+    EXPECT_TRUE(all_of(destination.cbegin(), destination.cend(), [](uint8_t v) { return v == 0x5a; })) << "The destination must not be modified if the data is not valid.";
+}
@@ -4,9 +4,254 @@
 
 #include "include_gtest.h"
 #include "inc_libCZI.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 using namespace libCZI;
 
+namespace
+{
+    /// A minimal HTTP-server (listening on the loopback-interface on an ephemeral port) which serves a blob of data, and which
+    /// supports range-requests (for a single range) and persistent connections. Every connection is served on a thread of its own.
+    /// This allows for testing the curl-based stream deterministically, without depending on the network.
+    class LocalHttpRangeServer
+    {
+    private:
+#if defined(_WIN32)
+        typedef SOCKET SocketHandle;
+        static constexpr SocketHandle kInvalidSocket = INVALID_SOCKET;
+#else
+        typedef int SocketHandle;
+        static constexpr SocketHandle kInvalidSocket = -1;
+#endif
+        std::vector<std::uint8_t> content_;
+        SocketHandle listen_socket_{ kInvalidSocket };
+        std::uint16_t port_{ 0 };
+        std::thread accept_thread_;
+        std::mutex mutex_;
+        bool stopping_{ false };
+        std::vector<SocketHandle> connection_sockets_;
+        std::vector<std::thread> connection_threads_;
+    public:
+        explicit LocalHttpRangeServer(std::vector<std::uint8_t> content) : content_(std::move(content))
+        {
+#if defined(_WIN32)
+            WSADATA wsa_data;
+            if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+            {
+                return;
+            }
+#endif
+            this->listen_socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (this->listen_socket_ == kInvalidSocket)
+            {
+                return;
+            }
+
+            sockaddr_in address;
+            memset(&address, 0, sizeof(address));
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            address.sin_port = 0;
+            socklen_t address_length = sizeof(address);
+            if (bind(this->listen_socket_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+                listen(this->listen_socket_, SOMAXCONN) != 0 ||
+                getsockname(this->listen_socket_, reinterpret_cast<sockaddr*>(&address), &address_length) != 0)
+            {
+                LocalHttpRangeServer::CloseSocket(this->listen_socket_);
+                this->listen_socket_ = kInvalidSocket;
+                return;
+            }
+
+            this->port_ = ntohs(address.sin_port);
+            this->accept_thread_ = std::thread([this]()->void {this->AcceptConnections(); });
+        }
+
+        ~LocalHttpRangeServer()
+        {
+            if (this->listen_socket_ != kInvalidSocket)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(this->mutex_);
+                    this->stopping_ = true;
+                    for (const auto connection_socket : this->connection_sockets_)
+                    {
+                        shutdown(connection_socket, LocalHttpRangeServer::kShutdownBoth);
+                    }
+                }
+
+                // this makes the blocking "accept" return
+                shutdown(this->listen_socket_, LocalHttpRangeServer::kShutdownBoth);
+                LocalHttpRangeServer::CloseSocket(this->listen_socket_);
+                this->accept_thread_.join();
+                for (auto& thread : this->connection_threads_)
+                {
+                    thread.join();
+                }
+
+                for (const auto connection_socket : this->connection_sockets_)
+                {
+                    LocalHttpRangeServer::CloseSocket(connection_socket);
+                }
+            }
+
+#if defined(_WIN32)
+            WSACleanup();
+#endif
+        }
+
+        LocalHttpRangeServer(const LocalHttpRangeServer&) = delete;
+        LocalHttpRangeServer& operator=(const LocalHttpRangeServer&) = delete;
+
+        bool IsRunning() const
+        {
+            return this->listen_socket_ != kInvalidSocket;
+        }
+
+        std::string GetUrl() const
+        {
+            std::ostringstream ss;
+            ss << "http://127.0.0.1:" << this->port_ << "/data.bin";
+            return ss.str();
+        }
+
+    private:
+#if defined(_WIN32)
+        static constexpr int kShutdownBoth = SD_BOTH;
+        static constexpr int kSendFlags = 0;
+        static void CloseSocket(SocketHandle socket_handle) { closesocket(socket_handle); }
+#else
+        static constexpr int kShutdownBoth = SHUT_RDWR;
+        static constexpr int kSendFlags = MSG_NOSIGNAL;
+        static void CloseSocket(SocketHandle socket_handle) { close(socket_handle); }
+#endif
+
+        void AcceptConnections()
+        {
+            for (;;)
+            {
+                const SocketHandle connection_socket = accept(this->listen_socket_, nullptr, nullptr);
+                std::lock_guard<std::mutex> lock(this->mutex_);
+                if (connection_socket == kInvalidSocket || this->stopping_)
+                {
+                    if (connection_socket != kInvalidSocket)
+                    {
+                        LocalHttpRangeServer::CloseSocket(connection_socket);
+                    }
+
+                    return;
+                }
+
+                this->connection_sockets_.push_back(connection_socket);
+                this->connection_threads_.emplace_back([this, connection_socket]()->void {this->ServeConnection(connection_socket); });
+            }
+        }
+
+        void ServeConnection(SocketHandle connection_socket)
+        {
+            std::string received;
+            char buffer[4096];
+            for (;;)
+            {
+                const auto end_of_header = received.find("\r\n\r\n");
+                if (end_of_header == std::string::npos)
+                {
+                    const auto bytes_received = recv(connection_socket, buffer, sizeof(buffer), 0);
+                    if (bytes_received <= 0)
+                    {
+                        break;
+                    }
+
+                    received.append(buffer, static_cast<size_t>(bytes_received));
+                    continue;
+                }
+
+                const std::string request = received.substr(0, end_of_header);
+                received.erase(0, end_of_header + 4);
+                if (!this->SendResponse(connection_socket, request))
+                {
+                    break;
+                }
+            }
+
+            // note that the socket is closed when the server is destroyed (and not here), so that the handle cannot be reused
+            //  while the destructor may still call "shutdown" on it
+            shutdown(connection_socket, LocalHttpRangeServer::kShutdownBoth);
+        }
+
+        bool SendResponse(SocketHandle connection_socket, const std::string& request)
+        {
+            // we expect a header-line of the form "Range: bytes=<first>-[<last>]" (and we do not check the request-line)
+            std::uint64_t first = 0;
+            std::uint64_t last = this->content_.empty() ? 0 : this->content_.size() - 1;
+            bool is_range_request = false;
+            const auto range_position = request.find("\r\nRange: bytes=");
+            if (range_position != std::string::npos)
+            {
+                unsigned long long range_first = 0, range_last = 0;
+                const int fields = sscanf(request.c_str() + range_position + strlen("\r\nRange: bytes="), "%llu-%llu", &range_first, &range_last);
+                if (fields >= 1 && range_first < this->content_.size())
+                {
+                    is_range_request = true;
+                    first = range_first;
+                    if (fields == 2 && range_last < last)
+                    {
+                        last = range_last;
+                    }
+                }
+            }
+
+            const std::uint64_t length = this->content_.empty() ? 0 : last - first + 1;
+            std::ostringstream header;
+            if (is_range_request)
+            {
+                header << "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes " << first << "-" << last << "/" << this->content_.size() << "\r\n";
+            }
+            else
+            {
+                header << "HTTP/1.1 200 OK\r\n";
+            }
+
+            header << "Accept-Ranges: bytes\r\nContent-Type: application/octet-stream\r\nContent-Length: " << length << "\r\n\r\n";
+            const std::string header_text = header.str();
+            return LocalHttpRangeServer::SendAll(connection_socket, header_text.data(), header_text.size()) &&
+                LocalHttpRangeServer::SendAll(connection_socket, reinterpret_cast<const char*>(this->content_.data()) + first, static_cast<size_t>(length));
+        }
+
+        static bool SendAll(SocketHandle connection_socket, const char* data, size_t size)
+        {
+            while (size > 0)
+            {
+                const auto bytes_sent = send(connection_socket, data, static_cast<int>(size), LocalHttpRangeServer::kSendFlags);
+                if (bytes_sent <= 0)
+                {
+                    return false;
+                }
+
+                data += bytes_sent;
+                size -= static_cast<size_t>(bytes_sent);
+            }
+
+            return true;
+        }
+    };
+}
+
 TEST(CurlHttpInputStream, SimpleReadFromHttps)
 {
     static constexpr char kUrl[] = "https://media.githubusercontent.com/media/ptahmose/libCZI_testdata/main/MD5/ff20e3a15d797509f7bf494ea21109d3";  // sparse_planes.czi.
@@ -122,3 +367,121 @@ TEST(CurlHttpInputStream, OpenAndReadCziFromUrl)
     static const uint8_t expectedResult[16] = { 0x9f, 0xb0, 0x52, 0x86, 0x58, 0xde, 0xe0, 0x95, 0xfd, 0x2c, 0x90, 0x93, 0x7c, 0x8a, 0x94, 0xde };
     EXPECT_TRUE(memcmp(hash, expectedResult, 16) == 0) << "Incorrect result";
 }
+
+TEST(CurlHttpInputStream, ReadConcurrentlyWithConnectionPoolAndCheckStatistics)
+{
+    // we serve some pseudo-random data from a local server, so that the outcome does not depend on the network
+    constexpr size_t kBlockSize = 1000;
+    constexpr size_t kNumberOfBlocks = 12;
+    std::vector<uint8_t> content(kBlockSize * kNumberOfBlocks + 123);
+    uint32_t seed = 0x12345678;
+    for (auto& value : content)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        value = static_cast<uint8_t>(seed >> 24);
+    }
+
+    const LocalHttpRangeServer server(content);
+    ASSERT_TRUE(server.IsRunning());
+
+    StreamsFactory::CreateStreamInfo create_info;
+    create_info.class_name = "curl_http_inputstream";
+    create_info.property_bag =
+    {
+        {StreamsFactory::StreamProperties::kCurlHttp_Timeout, StreamsFactory::Property(5)},
+        {StreamsFactory::StreamProperties::kCurlHttp_MaxConnections, StreamsFactory::Property(3)},
+        {StreamsFactory::StreamProperties::kCurlHttp_Proxy, StreamsFactory::Property("")},   // an empty string disables the use of a proxy (which may be configured with environment variables)
+    };
+
+    const auto stream = StreamsFactory::CreateStream(create_info, server.GetUrl());
+
+    if (!stream)
+    {
+        GTEST_SKIP() << "The stream-class 'curl_http_inputstream' is not available/configured, skipping this test therefore.";
+    }
+
+    // first, we read the reference data with a single request - if this fails, then the environment (e.g. a proxy configured
+    //  for curl) is not suitable for this test, whereas after this point any error is a failure
+    std::vector<uint8_t> reference(kBlockSize * kNumberOfBlocks);
+    uint64_t bytes_read = 0;
+    try
+    {
+        stream->Read(0, reference.data(), reference.size(), &bytes_read);
+    }
+    catch (const std::exception& e)
+    {
+        GTEST_SKIP() << "Exception: " << e.what() << "--> skipping this test as inconclusive, assuming that the local server cannot be reached";
+    }
+
+    ASSERT_EQ(bytes_read, reference.size());
+    ASSERT_EQ(memcmp(reference.data(), content.data(), reference.size()), 0);
+
+    // now, read the blocks from several threads concurrently (and then with a batched read), and compare
+    std::vector<uint8_t> data(reference.size());
+    std::atomic<bool> error_occurred{ false };
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back(
+            [&, t]()->void
+            {
+                for (size_t block = t; block < kNumberOfBlocks; block += 4)
+                {
+                    try
+                    {
+                        uint64_t bytes_read_block = 0;
+                        stream->Read(block * kBlockSize, data.data() + block * kBlockSize, kBlockSize, &bytes_read_block);
+                        if (bytes_read_block != kBlockSize)
+                        {
+                            error_occurred = true;
+                        }
+                    }
+                    catch (const std::exception&)
+                    {
+                        error_occurred = true;
+                    }
+                }
+            });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    ASSERT_FALSE(error_occurred);
+    EXPECT_EQ(memcmp(data.data(), reference.data(), reference.size()), 0);
+
+    const auto stream_ex = std::dynamic_pointer_cast<IStreamEx>(stream);
+    ASSERT_TRUE(stream_ex);
+    std::vector<uint8_t> data_batched(reference.size());
+    std::vector<StreamReadRange> ranges(kNumberOfBlocks);
+    for (size_t block = 0; block < kNumberOfBlocks; ++block)
+    {
+        // we give the ranges in reverse order
+        const size_t block_to_read = kNumberOfBlocks - 1 - block;
+        ranges[block].offset = block_to_read * kBlockSize;
+        ranges[block].data = data_batched.data() + block_to_read * kBlockSize;
+        ranges[block].size = kBlockSize;
+    }
+
+    ASSERT_NO_THROW(stream_ex->ReadMany(ranges.data(), ranges.size()));
+
+    for (const auto& range : ranges)
+    {
+        EXPECT_EQ(range.bytes_read, kBlockSize);
+    }
+
+    EXPECT_EQ(memcmp(data_batched.data(), reference.data(), reference.size()), 0);
+
+    const auto stream_statistics = std::dynamic_pointer_cast<IStreamStatistics>(stream);
+    ASSERT_TRUE(stream_statistics);
+    const auto statistics = stream_statistics->GetRequestStatistics();
+    EXPECT_EQ(statistics.requests, 1 + 2 * kNumberOfBlocks);
+    EXPECT_EQ(statistics.failed_requests, 0u);
+    EXPECT_EQ(statistics.bytes_received, 3 * reference.size());
+    EXPECT_GE(statistics.max_concurrent_requests, 1u);
+    EXPECT_LE(statistics.max_concurrent_requests, 3u);
+    EXPECT_GE(statistics.connections_established, 1u);
+    EXPECT_LE(statistics.connections_established, statistics.requests);
+}
@@ -3,9 +3,16 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include "include_gtest.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
 #include "inc_libCZI.h"
 
 using namespace libCZI;
+using namespace std;
 
 TEST(MultichannelComposite, Test1)
 {
@@ -120,3 +127,246 @@ TEST(MultichannelComposite, Test3)
         EXPECT_TRUE(r == sb && g == sb && b == sb) << "Incorrect result";
     }
 }
+
+static shared_ptr<IBitmapData> CreateBitmapWithRandomContent(PixelType pixel_type, uint32_t width, uint32_t height, mt19937& random_engine)
+{
+    auto bitmap = CBitmapData<CHeapAllocator>::Create(pixel_type, width, height);
+    ScopedBitmapLockerSP lck{ bitmap };
+    uniform_int_distribution<int> distribution(0, 255);
+    const uint32_t bytes_per_row = width * Utils::GetBytesPerPixel(pixel_type);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        uint8_t* ptr = static_cast<uint8_t*>(lck.ptrDataRoi) + static_cast<size_t>(y) * lck.stride;
+        for (uint32_t x = 0; x < bytes_per_row; ++x)
+        {
+            ptr[x] = static_cast<uint8_t>(distribution(random_engine));
+        }
+    }
+
+    return bitmap;
+}
+
+/// Composes the specified channels into a Bgr24-bitmap and into a Bgra32-bitmap, and checks that the B, G and R values are
+/// identical - the former uses the row kernels (which are vectorized if possible), whereas the latter uses the per-pixel
+/// operations, so this checks that the results of the row kernels are bit-exact.
+static void ComposeBgr24AndBgra32AndCheckThatResultIsIdentical(const vector<shared_ptr<IBitmapData>>& bitmaps, const vector<Compositors::ChannelInfo>& channel_infos)
+{
+    vector<IBitmapData*> sources;
+    for (const auto& bitmap : bitmaps)
+    {
+        sources.push_back(bitmap.get());
+    }
+
+    const auto bitmap_bgr24 = Compositors::ComposeMultiChannel_Bgr24(static_cast<int>(sources.size()), sources.data(), channel_infos.data());
+    const auto bitmap_bgra32 = Compositors::ComposeMultiChannel_Bgra32(0xff, static_cast<int>(sources.size()), sources.data(), channel_infos.data());
+
+    ScopedBitmapLockerSP lck_bgr24{ bitmap_bgr24 };
+    ScopedBitmapLockerSP lck_bgra32{ bitmap_bgra32 };
+    for (uint32_t y = 0; y < bitmap_bgr24->GetHeight(); ++y)
+    {
+        const uint8_t* ptr_bgr24 = static_cast<const uint8_t*>(lck_bgr24.ptrDataRoi) + static_cast<size_t>(y) * lck_bgr24.stride;
+        const uint8_t* ptr_bgra32 = static_cast<const uint8_t*>(lck_bgra32.ptrDataRoi) + static_cast<size_t>(y) * lck_bgra32.stride;
+        for (uint32_t x = 0; x < bitmap_bgr24->GetWidth(); ++x)
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                ASSERT_EQ(ptr_bgr24[x * 3 + i], ptr_bgra32[x * 4 + i]) << "mismatch at x=" << x << ", y=" << y << ", component " << i;
+            }
+        }
+    }
+}
+
+TEST(MultichannelComposite, CompareBgr24WithBgra32ForRandomChannelsAndCheckThatResultIsIdentical)
+{
+    const PixelType pixel_types[] = { PixelType::Gray8, PixelType::Gray16, PixelType::Bgr24, PixelType::Bgr48 };
+    mt19937 random_engine(4711);
+    uniform_int_distribution<int> distribution_width(1, 80);
+    uniform_int_distribution<int> distribution_height(1, 4);
+    uniform_int_distribution<int> distribution_index(0, 3);
+    uniform_int_distribution<int> distribution_byte(0, 255);
+    uniform_real_distribution<float> distribution_black_point(0, 0.6f);
+    uniform_real_distribution<float> distribution_white_point(0.4f, 1);
+    uniform_real_distribution<float> distribution_weight(0.1f, 2);
+
+    for (int iteration = 0; iteration < 200; ++iteration)
+    {
+        const uint32_t width = distribution_width(random_engine);
+        const uint32_t height = distribution_height(random_engine);
+        const int channel_count = 1 + iteration % 4;
+        const bool use_weights = (iteration / 4) % 2 == 1;
+        vector<shared_ptr<IBitmapData>> bitmaps;
+        vector<Compositors::ChannelInfo> channel_infos(channel_count);
+        vector<vector<uint8_t>> look_up_tables(channel_count);
+        for (int c = 0; c < channel_count; ++c)
+        {
+            const PixelType pixel_type = pixel_types[distribution_index(random_engine)];
+            bitmaps.push_back(CreateBitmapWithRandomContent(pixel_type, width, height, random_engine));
+
+            Compositors::ChannelInfo& channel_info = channel_infos[c];
+            channel_info.Clear();
+            channel_info.weight = use_weights ? distribution_weight(random_engine) : 1;
+            channel_info.enableTinting = distribution_index(random_engine) % 2 == 0;
+            channel_info.tinting.color = Rgb8Color{ static_cast<uint8_t>(distribution_byte(random_engine)), static_cast<uint8_t>(distribution_byte(random_engine)), static_cast<uint8_t>(distribution_byte(random_engine)) };
+            channel_info.blackPoint = 0;
+            channel_info.whitePoint = 1;
+            switch (distribution_index(random_engine))
+            {
+            case 0:
+                // use a look-up table (with random content)
+                look_up_tables[c].resize(pixel_type == PixelType::Gray8 || pixel_type == PixelType::Bgr24 ? 256 : 256 * 256);
+                for (auto& element : look_up_tables[c])
+                {
+                    element = static_cast<uint8_t>(distribution_byte(random_engine));
+                }
+
+                channel_info.lookUpTableElementCount = static_cast<int>(look_up_tables[c].size());
+                channel_info.ptrLookUpTable = look_up_tables[c].data();
+                break;
+            case 1:
+                channel_info.blackPoint = distribution_black_point(random_engine);
+                channel_info.whitePoint = distribution_white_point(random_engine);
+                break;
+            case 2:
+                // black-point and white-point are identical (or even reversed)
+                channel_info.blackPoint = distribution_black_point(random_engine);
+                channel_info.whitePoint = channel_info.blackPoint - (iteration % 3) * 0.1f;
+                break;
+            default:
+                break;
+            }
+        }
+
+        ComposeBgr24AndBgra32AndCheckThatResultIsIdentical(bitmaps, channel_infos);
+        if (HasFatalFailure())
+        {
+            return;
+        }
+    }
+}
+
+TEST(MultichannelComposite, CompareBgr24WithBgra32ForGray16ChannelsWithAllValuesAndCheckThatResultIsIdentical)
+{
+    // all 65536 values of a Gray16-bitmap, with tinting and black-/white-point - where the weights of the channels differ
+    auto bitmap = CBitmapData<CHeapAllocator>::Create(PixelType::Gray16, 256, 256);
+    {
+        ScopedBitmapLockerSP lck{ bitmap };
+        for (uint32_t y = 0; y < 256; ++y)
+        {
+            uint16_t* ptr = reinterpret_cast<uint16_t*>(static_cast<uint8_t*>(lck.ptrDataRoi) + static_cast<size_t>(y) * lck.stride);
+            for (uint32_t x = 0; x < 256; ++x)
+            {
+                ptr[x] = static_cast<uint16_t>(y * 256 + x);
+            }
+        }
+    }
+
+    vector<Compositors::ChannelInfo> channel_infos(3);
+    for (auto& channel_info : channel_infos)
+    {
+        channel_info.Clear();
+    }
+
+    channel_infos[0].weight = 1;
+    channel_infos[0].enableTinting = true;
+    channel_infos[0].tinting.color = Rgb8Color{ 255, 128, 3 };
+    channel_infos[0].blackPoint = 0;
+    channel_infos[0].whitePoint = 1;
+    channel_infos[1].weight = 0.5f;
+    channel_infos[1].enableTinting = true;
+    channel_infos[1].tinting.color = Rgb8Color{ 17, 255, 200 };
+    channel_infos[1].blackPoint = 0.1f;
+    channel_infos[1].whitePoint = 0.7f;
+    channel_infos[2].weight = 0.25f;
+    channel_infos[2].enableTinting = false;
+    channel_infos[2].blackPoint = 0.03f;
+    channel_infos[2].whitePoint = 0.97f;
+
+    ComposeBgr24AndBgra32AndCheckThatResultIsIdentical({ bitmap, bitmap, bitmap }, channel_infos);
+}
+
+/// This is a benchmark (and not a test) - it reports the throughput (in megapixels per second) of composing multi-channel images
+/// into a Bgr24-bitmap (which uses the row kernels) and into a Bgra32-bitmap (which uses the per-pixel operations). Run it with
+/// "--gtest_also_run_disabled_tests".
+TEST(MultichannelComposite, DISABLED_BenchmarkComposeMultiChannel)
+{
+    enum class Operation
+    {
+        Tinting,
+        TintingAndBlackWhitePoint,
+        TintingAndLut,
+        NoTinting,
+    };
+
+    struct Scenario
+    {
+        PixelType pixel_type;
+        int channel_count;
+        Operation operation;
+        const char* name;
+    };
+
+    const Scenario scenarios[] =
+    {
+        { PixelType::Gray16, 4, Operation::Tinting, "4 x Gray16, tinting" },
+        { PixelType::Gray16, 4, Operation::TintingAndBlackWhitePoint, "4 x Gray16, tinting and black-/white-point" },
+        { PixelType::Gray16, 4, Operation::TintingAndLut, "4 x Gray16, tinting and gamma-LUT" },
+        { PixelType::Gray16, 8, Operation::TintingAndBlackWhitePoint, "8 x Gray16, tinting and black-/white-point" },
+        { PixelType::Gray8, 4, Operation::TintingAndBlackWhitePoint, "4 x Gray8, tinting and black-/white-point" },
+        { PixelType::Bgr24, 1, Operation::NoTinting, "1 x Bgr24, no tinting" },
+        { PixelType::Bgr48, 1, Operation::TintingAndBlackWhitePoint, "1 x Bgr48, tinting and black-/white-point" },
+    };
+
+    const uint32_t size = 2048;
+    const int number_of_runs = 3;
+    mt19937 random_engine(4711);
+    const auto gamma_lut_8bit = Utils::Create8BitLookUpTableFromGamma(256, 0.1f, 0.9f, 0.45f);
+    const auto gamma_lut_16bit = Utils::Create8BitLookUpTableFromGamma(256 * 256, 0.1f, 0.9f, 0.45f);
+    for (const auto& scenario : scenarios)
+    {
+        const auto bitmap = CreateBitmapWithRandomContent(scenario.pixel_type, size, size, random_engine);
+        vector<IBitmapData*> sources(scenario.channel_count, bitmap.get());
+        vector<Compositors::ChannelInfo> channel_infos(scenario.channel_count);
+        for (int c = 0; c < scenario.channel_count; ++c)
+        {
+            Compositors::ChannelInfo& channel_info = channel_infos[c];
+            channel_info.Clear();
+            channel_info.weight = 1;
+            channel_info.enableTinting = scenario.operation != Operation::NoTinting;
+            channel_info.tinting.color = Rgb8Color{ static_cast<uint8_t>(50 * c), 255, static_cast<uint8_t>(255 - 30 * c) };
+            channel_info.blackPoint = scenario.operation == Operation::TintingAndBlackWhitePoint ? 0.05f : 0;
+            channel_info.whitePoint = scenario.operation == Operation::TintingAndBlackWhitePoint ? 0.8f : 1;
+            if (scenario.operation == Operation::TintingAndLut)
+            {
+                const auto& lut = scenario.pixel_type == PixelType::Gray8 || scenario.pixel_type == PixelType::Bgr24 ? gamma_lut_8bit : gamma_lut_16bit;
+                channel_info.lookUpTableElementCount = static_cast<int>(lut.size());
+                channel_info.ptrLookUpTable = lut.data();
+            }
+        }
+
+        const auto destination_bgr24 = CBitmapData<CHeapAllocator>::Create(PixelType::Bgr24, size, size);
+        const auto destination_bgra32 = CBitmapData<CHeapAllocator>::Create(PixelType::Bgra32, size, size);
+
+        // the runs are interleaved, and the best run is reported (in order to reduce the influence of other activity on the machine)
+        double megapixels_per_second[2] = { 0, 0 };
+        for (int run = 0; run < number_of_runs; ++run)
+        {
+            for (int i = 0; i < 2; ++i)
+            {
+                const auto start = chrono::steady_clock::now();
+                if (i == 0)
+                {
+                    Compositors::ComposeMultiChannel_Bgr24(destination_bgr24.get(), scenario.channel_count, sources.data(), channel_infos.data());
+                }
+                else
+                {
+                    Compositors::ComposeMultiChannel_Bgra32(destination_bgra32.get(), 0xff, scenario.channel_count, sources.data(), channel_infos.data());
+                }
+
+                const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+                megapixels_per_second[i] = (max)(megapixels_per_second[i], static_cast<double>(size) * size / 1e6 / elapsed.count());
+            }
+        }
+
+        cout << scenario.name << ": " << megapixels_per_second[0] << " MPixel/s (Bgr24, row kernels), " << megapixels_per_second[1] << " MPixel/s (Bgra32, per-pixel)" << endl;
+    }
+}
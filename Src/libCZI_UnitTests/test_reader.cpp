@@ -6,7 +6,15 @@
 #include "inc_libCZI.h"
 #include "MemInputOutputStream.h"
 #include "MemOutputStream.h"
+#include "../libCZI/CziParse.h"
+#include "../libCZI/CziStructs.h"
 #include <array>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <map>
+#include <mutex>
+#include <random>
 #include <thread>
 
 using namespace libCZI;
@@ -227,3 +235,863 @@ TEST(CziReader, Concurrency)
 
     EXPECT_FALSE(readsubblock_problem_occurred) << "Incorrect behavior";
 }
+
+namespace
+{
+    /// An allocator (using the heap) which counts the number of allocations and deallocations.
+    class CountingSubBlockAllocator : public ISubBlockAllocator
+    {
+    public:
+        std::atomic<int> allocation_count{ 0 };
+        std::atomic<int> free_count{ 0 };
+
+        void* Allocate(std::size_t size) override
+        {
+            ++this->allocation_count;
+            return malloc(size);
+        }
+
+        void Free(void* ptr) override
+        {
+            ++this->free_count;
+            free(ptr);
+        }
+    };
+}
+
+static void CompareSubBlockData(const shared_ptr<ISubBlock>& sub_block_a, const shared_ptr<ISubBlock>& sub_block_b)
+{
+    for (const auto type : { ISubBlock::MemBlkType::Data, ISubBlock::MemBlkType::Metadata, ISubBlock::MemBlkType::Attachment })
+    {
+        size_t size_a, size_b;
+        const auto data_a = sub_block_a->GetRawData(type, &size_a);
+        const auto data_b = sub_block_b->GetRawData(type, &size_b);
+        ASSERT_EQ(size_a, size_b);
+        if (size_a > 0)
+        {
+            EXPECT_EQ(memcmp(data_a.get(), data_b.get(), size_a), 0);
+        }
+    }
+}
+
+TEST(CziReader, ReadSubBlockWithAllocatorFromOpenOptions)
+{
+    // arrange
+    auto czi_document_as_blob = CreateTestCzi();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto reader = CreateCZIReader();
+    reader->Open(memory_stream);
+    const auto allocator = make_shared<CountingSubBlockAllocator>();
+    ICZIReader::OpenOptions open_options;
+    open_options.sub_block_allocator = allocator;
+    const auto reader_with_allocator = CreateCZIReader();
+    reader_with_allocator->Open(memory_stream, &open_options);
+
+    // act
+    int sub_block_count = 0;
+    reader->EnumerateSubBlocks(
+        [&](int index, const SubBlockInfo&)->bool
+        {
+            const auto sub_block = reader->ReadSubBlock(index);
+            const auto sub_block_with_allocator = reader_with_allocator->ReadSubBlock(index);
+            CompareSubBlockData(sub_block, sub_block_with_allocator);
+            ++sub_block_count;
+            return true;
+        });
+
+    // assert
+    ASSERT_GT(sub_block_count, 0);
+    EXPECT_GE(allocator->allocation_count.load(), sub_block_count);
+    EXPECT_EQ(allocator->allocation_count.load(), allocator->free_count.load());
+}
+
+TEST(CziReader, ReadSubBlockUsingAllocatorAndCheckThatAllocatorIsKeptAlive)
+{
+    // arrange
+    auto czi_document_as_blob = CreateTestCzi();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto reader = CreateCZIReader();
+    reader->Open(memory_stream);
+    auto allocator = make_shared<CountingSubBlockAllocator>();
+    weak_ptr<CountingSubBlockAllocator> weak_allocator = allocator;
+    const auto memory_control = dynamic_pointer_cast<ISubBlockRepositoryMemoryControl>(reader);
+    ASSERT_TRUE(memory_control);
+
+    // act
+    auto sub_block = memory_control->ReadSubBlockUsingAllocator(0, allocator);
+    const auto allocation_count = allocator->allocation_count.load();
+    allocator.reset();
+
+    // assert
+    ASSERT_TRUE(sub_block);
+    EXPECT_GE(allocation_count, 1);
+    CompareSubBlockData(sub_block, reader->ReadSubBlock(0));
+    EXPECT_FALSE(weak_allocator.expired()) << "the allocator is expected to be referenced by the sub-block";
+    sub_block.reset();
+    EXPECT_TRUE(weak_allocator.expired());
+    EXPECT_FALSE(memory_control->ReadSubBlockUsingAllocator(1000, nullptr));
+}
+
+TEST(CziReader, TryReadSubBlockDataAndCompareWithReadSubBlock)
+{
+    // arrange
+    auto czi_document_as_blob = CreateTestCzi();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto reader = CreateCZIReader();
+    reader->Open(memory_stream);
+    const auto memory_control = dynamic_pointer_cast<ISubBlockRepositoryMemoryControl>(reader);
+    ASSERT_TRUE(memory_control);
+
+    // act & assert
+    int sub_block_count = 0;
+    vector<uint8_t> buffer;
+    reader->EnumerateSubBlocks(
+        [&](int index, const SubBlockInfo&)->bool
+        {
+            const bool success = memory_control->TryReadSubBlockData(
+                index,
+                [&](uint64_t size)->void*
+                {
+                    buffer.resize(static_cast<size_t>(size));
+                    return buffer.data();
+                });
+            EXPECT_TRUE(success);
+
+            size_t size_of_data;
+            const auto data = reader->ReadSubBlock(index)->GetRawData(ISubBlock::MemBlkType::Data, &size_of_data);
+            EXPECT_EQ(buffer.size(), size_of_data);
+            EXPECT_EQ(memcmp(buffer.data(), data.get(), size_of_data), 0);
+            ++sub_block_count;
+            return true;
+        });
+
+    ASSERT_GT(sub_block_count, 0);
+    bool get_buffer_called = false;
+    EXPECT_FALSE(memory_control->TryReadSubBlockData(1000, [&](uint64_t)->void* { get_buffer_called = true; return nullptr; }));
+    EXPECT_FALSE(get_buffer_called);
+}
+
+TEST(CziReader, PooledSubBlockAllocatorReusesMemoryBlocks)
+{
+    const auto allocator = CreatePooledSubBlockAllocator(1024 * 1024);
+
+    void* ptr1 = allocator->Allocate(10000);
+    memset(ptr1, 0xaa, 10000);
+    allocator->Free(ptr1);
+
+    // a request with a slightly different size (but in the same size class) is expected to give the same memory block
+    void* ptr2 = allocator->Allocate(9999);
+    EXPECT_EQ(ptr1, ptr2);
+
+    // the block is in use, so we expect a different block now
+    void* ptr3 = allocator->Allocate(10000);
+    EXPECT_NE(ptr2, ptr3);
+    allocator->Free(ptr2);
+    allocator->Free(ptr3);
+
+    // a block larger than the limit is not retained in the pool, but still works
+    void* ptr4 = allocator->Allocate(2 * 1024 * 1024);
+    memset(ptr4, 0x55, 2 * 1024 * 1024);
+    allocator->Free(ptr4);
+
+    for (size_t size : { static_cast<size_t>(1), static_cast<size_t>(4096), static_cast<size_t>(4097), static_cast<size_t>(123456) })
+    {
+        void* ptr = allocator->Allocate(size);
+        memset(ptr, 0, size);
+        allocator->Free(ptr);
+    }
+}
+
+static tuple<shared_ptr<void>, size_t> CreateTestCziWithTilesOnMultiplePlanes()
+{
+    const auto writer = CreateCZIWriter();
+    const auto outStream = make_shared<CMemOutputStream>(0);
+    writer->Create(outStream, make_shared<CCziWriterInfo>(GUID{ 0,0,0,{ 0,0,0,0,0,0,0,0 } }));
+
+    uint8_t pixels[8 * 8] = {};
+    int m_index = 0;
+    for (int c = 0; c < 2; ++c)
+    {
+        for (int z = 0; z < 2; ++z)
+        {
+            // a grid of overlapping tiles on layer 0, and a grid of pyramid-tiles (with a minification of 2)
+            for (int layer = 0; layer < 2; ++layer)
+            {
+                const int size_logical = layer == 0 ? 8 : 16;
+                const int step = layer == 0 ? 6 : 12;
+                for (int y = 0; y < 40; ++y)
+                {
+                    for (int x = 0; x < 40; ++x)
+                    {
+                        AddSubBlockInfoMemPtr add_sub_block_info;
+                        add_sub_block_info.Clear();
+                        add_sub_block_info.coordinate.Set(DimensionIndex::C, c);
+                        add_sub_block_info.coordinate.Set(DimensionIndex::Z, z);
+                        add_sub_block_info.mIndexValid = true;
+                        add_sub_block_info.mIndex = m_index++;
+                        add_sub_block_info.x = x * step - 20;
+                        add_sub_block_info.y = y * step + 7;
+                        add_sub_block_info.logicalWidth = add_sub_block_info.logicalHeight = size_logical;
+                        add_sub_block_info.physicalWidth = add_sub_block_info.physicalHeight = 8;
+                        add_sub_block_info.PixelType = PixelType::Gray8;
+                        add_sub_block_info.ptrData = pixels;
+                        add_sub_block_info.dataSize = sizeof(pixels);
+                        writer->SyncAddSubBlock(add_sub_block_info);
+                    }
+                }
+            }
+        }
+    }
+
+    writer->Close();
+    return make_tuple(outStream->GetCopy(nullptr), outStream->GetDataSize());
+}
+
+/// Check whether the coordinate is on the specified plane, i.e. all dimensions given by the plane are present in the coordinate with the same value.
+static bool IsOnPlane(const IDimCoordinate* plane, const CDimCoordinate& coordinate)
+{
+    for (auto i = static_cast<underlying_type<DimensionIndex>::type>(DimensionIndex::MinDim); i <= static_cast<underlying_type<DimensionIndex>::type>(DimensionIndex::MaxDim); ++i)
+    {
+        int value_plane, value_coordinate;
+        if (plane->TryGetPosition(static_cast<DimensionIndex>(i), &value_plane))
+        {
+            if (!coordinate.TryGetPosition(static_cast<DimensionIndex>(i), &value_coordinate) || value_plane != value_coordinate)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+TEST(CziReader, EnumSubsetAndCompareWithExhaustiveSearch)
+{
+    // arrange
+    auto czi_document_as_blob = CreateTestCziWithTilesOnMultiplePlanes();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto reader = CreateCZIReader();
+    reader->Open(memory_stream);
+
+    vector<SubBlockInfo> all_sub_blocks;
+    reader->EnumerateSubBlocks(
+        [&](int index, const SubBlockInfo& info)->bool
+        {
+            EXPECT_EQ(index, static_cast<int>(all_sub_blocks.size()));
+            all_sub_blocks.push_back(info);
+            return true;
+        });
+
+    const CDimCoordinate plane_c1 = CDimCoordinate::Parse("C1");
+    const CDimCoordinate plane_c1z1 = CDimCoordinate::Parse("C1Z1");
+    const CDimCoordinate plane_c5 = CDimCoordinate::Parse("C5");
+    const CDimCoordinate plane_t0 = CDimCoordinate::Parse("T0");
+    const IDimCoordinate* planes[] = { nullptr, &plane_c1, &plane_c1z1, &plane_c5, &plane_t0 };
+
+    mt19937 random_engine(42);
+    uniform_int_distribution<int> distribution_position(-40, 500);
+    uniform_int_distribution<int> distribution_size(0, 120);
+    vector<IntRect> rois{ IntRect{ -1000, -1000, 3000, 3000 }, IntRect{ 0, 0, 0, 0 }, IntRect{ 10, 10, 1, 1 } };
+    for (int i = 0; i < 50; ++i)
+    {
+        rois.push_back(IntRect{ distribution_position(random_engine), distribution_position(random_engine), distribution_size(random_engine), distribution_size(random_engine) });
+    }
+
+    // act & assert
+    for (const auto plane : planes)
+    {
+        for (const bool only_layer0 : { false, true })
+        {
+            for (size_t r = 0; r <= rois.size(); ++r)
+            {
+                const IntRect* roi = r < rois.size() ? &rois[r] : nullptr;
+                vector<int> expected;
+                for (size_t n = 0; n < all_sub_blocks.size(); ++n)
+                {
+                    const auto& info = all_sub_blocks[n];
+                    const bool is_layer0 = info.physicalSize.w == static_cast<uint32_t>(info.logicalRect.w) && info.physicalSize.h == static_cast<uint32_t>(info.logicalRect.h);
+                    if (only_layer0 && !is_layer0)
+                    {
+                        continue;
+                    }
+
+                    if (plane != nullptr && !IsOnPlane(plane, info.coordinate))
+                    {
+                        continue;
+                    }
+
+                    if (roi != nullptr)
+                    {
+                        const bool intersect =
+                            max(roi->x, info.logicalRect.x) < min(roi->x + roi->w, info.logicalRect.x + info.logicalRect.w) &&
+                            max(roi->y, info.logicalRect.y) < min(roi->y + roi->h, info.logicalRect.y + info.logicalRect.h);
+                        if (!intersect)
+                        {
+                            continue;
+                        }
+                    }
+
+                    expected.push_back(static_cast<int>(n));
+                }
+
+                vector<int> actual;
+                reader->EnumSubset(plane, roi, only_layer0,
+                    [&](int index, const SubBlockInfo& info)->bool
+                    {
+                        EXPECT_TRUE(info.logicalRect.x == all_sub_blocks[index].logicalRect.x && info.logicalRect.w == all_sub_blocks[index].logicalRect.w);
+                        actual.push_back(index);
+                        return true;
+                    });
+
+                EXPECT_EQ(actual, expected);
+
+                // check that the enumeration can be stopped
+                int count = 0;
+                reader->EnumSubset(plane, roi, only_layer0, [&](int, const SubBlockInfo&)->bool { ++count; return false; });
+                EXPECT_EQ(count, expected.empty() ? 0 : 1);
+            }
+        }
+    }
+}
+
+TEST(CziReader, EnumSubsetWithRoiWithAndWithoutSpatialIndexAndCompare)
+{
+    // arrange
+    auto czi_document_as_blob = CreateTestCziWithTilesOnMultiplePlanes();
+    const CDimCoordinate plane_c1 = CDimCoordinate::Parse("C1");
+    mt19937 random_engine(43);
+    uniform_int_distribution<int> distribution_position(-40, 500);
+    uniform_int_distribution<int> distribution_size(0, 120);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        const IntRect roi{ distribution_position(random_engine), distribution_position(random_engine), distribution_size(random_engine), distribution_size(random_engine) };
+        const IDimCoordinate* plane = (i % 2) == 0 ? nullptr : &plane_c1;
+        const auto reader = CreateCZIReader();
+        reader->Open(make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob)));
+
+        // act - the first query with a ROI is answered with a linear scan, the second one with the spatial index
+        vector<int> result_of_linear_scan;
+        reader->EnumSubset(plane, &roi, false, [&](int index, const SubBlockInfo&)->bool { result_of_linear_scan.push_back(index); return true; });
+        vector<int> result_of_spatial_index;
+        reader->EnumSubset(plane, &roi, false, [&](int index, const SubBlockInfo&)->bool { result_of_spatial_index.push_back(index); return true; });
+
+        // assert
+        EXPECT_EQ(result_of_linear_scan, result_of_spatial_index);
+    }
+}
+
+TEST(CziReader, EnumSubsetThenCloseAndOpenOtherDocumentAndCheckResult)
+{
+    // arrange
+    auto czi_document_as_blob = CreateTestCziWithTilesOnMultiplePlanes();
+    const auto reader = CreateCZIReader();
+    reader->Open(make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob)));
+    const IntRect roi{ 0, 0, 10, 10 };
+    int count = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        // the spatial index is created with the second query
+        reader->EnumSubset(nullptr, &roi, false, [&](int, const SubBlockInfo&)->bool { ++count; return true; });
+    }
+
+    ASSERT_GT(count, 0);
+    reader->Close();
+
+    // act
+    auto other_czi_document_as_blob = CreateTestCzi();
+    reader->Open(make_shared<CMemInputOutputStream>(get<0>(other_czi_document_as_blob).get(), get<1>(other_czi_document_as_blob)));
+
+    // assert
+    vector<int> expected;
+    reader->EnumerateSubBlocks([&](int index, const SubBlockInfo&)->bool { expected.push_back(index); return true; });
+    vector<int> actual;
+    reader->EnumSubset(nullptr, &roi, false, [&](int index, const SubBlockInfo&)->bool { actual.push_back(index); return true; });
+    EXPECT_EQ(actual, expected);
+}
+
+static void ExpectEqualRects(const IntRect& a, const IntRect& b)
+{
+    EXPECT_TRUE(a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h);
+}
+
+/// Check that the two readers give the same sub-block directory, the same statistics and the same pyramid statistics.
+static void CompareSubBlockDirectoriesAndStatistics(ICZIReader* reader_a, ICZIReader* reader_b)
+{
+    vector<DirectorySubBlockInfo> sub_blocks_a, sub_blocks_b;
+    reader_a->EnumerateSubBlocksEx([&](int, const DirectorySubBlockInfo& info)->bool {sub_blocks_a.push_back(info); return true; });
+    reader_b->EnumerateSubBlocksEx([&](int, const DirectorySubBlockInfo& info)->bool {sub_blocks_b.push_back(info); return true; });
+    ASSERT_EQ(sub_blocks_a.size(), sub_blocks_b.size());
+    for (size_t i = 0; i < sub_blocks_a.size(); ++i)
+    {
+        const auto& a = sub_blocks_a[i];
+        const auto& b = sub_blocks_b[i];
+        EXPECT_EQ(Utils::Compare(&a.coordinate, &b.coordinate), 0);
+        ExpectEqualRects(a.logicalRect, b.logicalRect);
+        EXPECT_TRUE(a.physicalSize.w == b.physicalSize.w && a.physicalSize.h == b.physicalSize.h);
+        EXPECT_EQ(a.mIndex, b.mIndex);
+        EXPECT_EQ(a.pixelType, b.pixelType);
+        EXPECT_EQ(a.compressionModeRaw, b.compressionModeRaw);
+        EXPECT_EQ(a.pyramidType, b.pyramidType);
+        EXPECT_EQ(a.filePosition, b.filePosition);
+    }
+
+    const auto statistics_a = reader_a->GetStatistics();
+    const auto statistics_b = reader_b->GetStatistics();
+    EXPECT_EQ(statistics_a.subBlockCount, statistics_b.subBlockCount);
+    EXPECT_EQ(statistics_a.minMindex, statistics_b.minMindex);
+    EXPECT_EQ(statistics_a.maxMindex, statistics_b.maxMindex);
+    ExpectEqualRects(statistics_a.boundingBox, statistics_b.boundingBox);
+    ExpectEqualRects(statistics_a.boundingBoxLayer0Only, statistics_b.boundingBoxLayer0Only);
+    for (auto i = static_cast<underlying_type<DimensionIndex>::type>(DimensionIndex::MinDim); i <= static_cast<underlying_type<DimensionIndex>::type>(DimensionIndex::MaxDim); ++i)
+    {
+        int start_a = 0, size_a = 0, start_b = 0, size_b = 0;
+        EXPECT_EQ(statistics_a.dimBounds.TryGetInterval(static_cast<DimensionIndex>(i), &start_a, &size_a), statistics_b.dimBounds.TryGetInterval(static_cast<DimensionIndex>(i), &start_b, &size_b));
+        EXPECT_TRUE(start_a == start_b && size_a == size_b);
+    }
+
+    ASSERT_EQ(statistics_a.sceneBoundingBoxes.size(), statistics_b.sceneBoundingBoxes.size());
+    for (const auto& scene : statistics_a.sceneBoundingBoxes)
+    {
+        const auto it = statistics_b.sceneBoundingBoxes.find(scene.first);
+        ASSERT_TRUE(it != statistics_b.sceneBoundingBoxes.cend());
+        ExpectEqualRects(scene.second.boundingBox, it->second.boundingBox);
+        ExpectEqualRects(scene.second.boundingBoxLayer0, it->second.boundingBoxLayer0);
+    }
+
+    const auto pyramid_statistics_a = reader_a->GetPyramidStatistics();
+    const auto pyramid_statistics_b = reader_b->GetPyramidStatistics();
+    ASSERT_EQ(pyramid_statistics_a.scenePyramidStatistics.size(), pyramid_statistics_b.scenePyramidStatistics.size());
+    for (const auto& scene : pyramid_statistics_a.scenePyramidStatistics)
+    {
+        const auto it = pyramid_statistics_b.scenePyramidStatistics.find(scene.first);
+        ASSERT_TRUE(it != pyramid_statistics_b.scenePyramidStatistics.cend());
+        ASSERT_EQ(scene.second.size(), it->second.size());
+        for (size_t i = 0; i < scene.second.size(); ++i)
+        {
+            EXPECT_EQ(scene.second[i].layerInfo.minificationFactor, it->second[i].layerInfo.minificationFactor);
+            EXPECT_EQ(scene.second[i].layerInfo.pyramidLayerNo, it->second[i].layerInfo.pyramidLayerNo);
+            EXPECT_EQ(scene.second[i].count, it->second[i].count);
+        }
+    }
+}
+
+/// Create a copy of the CZI-document, where the size of the first dimension-entry of the first entry in the sub-block directory
+/// is modified in place (in the same way as CZIrepair patches the sub-block directory).
+static shared_ptr<CMemInputOutputStream> CreateCopyWithSubBlockDirectoryModifiedInPlace(const tuple<shared_ptr<void>, size_t>& czi_document_as_blob)
+{
+    auto stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto sub_block_directory_position = CCZIParse::ReadFileHeaderSegmentData(stream.get()).GetSubBlockDirectoryPosition();
+    const uint64_t position_of_size = sub_block_directory_position + sizeof(SubBlockDirectorySegment) + offsetof(SubBlockDirectoryEntryDV, DimensionEntries) + offsetof(DimensionEntryDV, Size);
+    int32_t size;
+    stream->Read(position_of_size, &size, sizeof(size), nullptr);
+    ++size;
+    stream->Write(position_of_size, &size, sizeof(size), nullptr);
+    return stream;
+}
+
+/// Opens the CZI-document with the specified index as input, and reports whether the index was used (which is the case if
+/// no index is written to "sub_block_directory_index_output").
+static bool OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(const shared_ptr<IStream>& stream, const shared_ptr<IStream>& index_stream, bool lax_subblock_coordinate_checks, shared_ptr<ICZIReader>* reader = nullptr, bool validate_content = false)
+{
+    ICZIReader::OpenOptions open_options;
+    open_options.lax_subblock_coordinate_checks = lax_subblock_coordinate_checks;
+    open_options.sub_block_directory_index_validate_content = validate_content;
+    open_options.sub_block_directory_index_input = index_stream;
+    const auto index_output_stream = make_shared<CMemOutputStream>(0);
+    open_options.sub_block_directory_index_output = index_output_stream;
+    const auto reader_using_index = CreateCZIReader();
+    reader_using_index->Open(stream, &open_options);
+    if (reader != nullptr)
+    {
+        *reader = reader_using_index;
+    }
+
+    return index_output_stream->GetDataSize() == 0;
+}
+
+TEST(CziReader, OpenWithSubBlockDirectoryIndexAndCompareWithParsedDirectory)
+{
+    // arrange
+    const auto czi_document_as_blob = CreateTestCziWithTilesOnMultiplePlanes();
+    const auto reader = CreateCZIReader();
+    reader->Open(make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob)));
+
+    const auto index_output_stream = make_shared<CMemOutputStream>(0);
+    ICZIReader::OpenOptions open_options_write_index;
+    open_options_write_index.sub_block_directory_index_output = index_output_stream;
+    const auto reader_writing_index = CreateCZIReader();
+    reader_writing_index->Open(make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob)), &open_options_write_index);
+    ASSERT_GT(index_output_stream->GetDataSize(), 0u);
+
+    // act
+    shared_ptr<ICZIReader> reader_using_index;
+    const bool index_was_used = OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(
+        make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob)),
+        make_shared<CMemInputOutputStream>(index_output_stream->GetDataC(), index_output_stream->GetDataSize()),
+        open_options_write_index.lax_subblock_coordinate_checks,
+        &reader_using_index);
+
+    // assert
+    ASSERT_TRUE(index_was_used);
+    CompareSubBlockDirectoriesAndStatistics(reader.get(), reader_writing_index.get());
+    CompareSubBlockDirectoriesAndStatistics(reader.get(), reader_using_index.get());
+    const auto sub_block = reader_using_index->ReadSubBlock(17);
+    ASSERT_TRUE(sub_block);
+    CompareSubBlockData(sub_block, reader->ReadSubBlock(17));
+
+    int count = 0;
+    const IntRect roi{ 0, 0, 20, 20 };
+    const CDimCoordinate plane = CDimCoordinate::Parse("C1Z0");
+    reader_using_index->EnumSubset(&plane, &roi, true, [&](int, const SubBlockInfo&)->bool {++count; return true; });
+    reader->EnumSubset(&plane, &roi, true, [&](int, const SubBlockInfo&)->bool {--count; return true; });
+    EXPECT_EQ(count, 0);
+}
+
+TEST(CziReader, OpenWithSubBlockDirectoryIndexWhichIsNotValidAndCheckThatItIsIgnored)
+{
+    // arrange - create an index (including the hash of the sub-block directory) for a document
+    const auto czi_document_as_blob = CreateTestCziWithTilesOnMultiplePlanes();
+    const auto index_output_stream = make_shared<CMemOutputStream>(0);
+    ICZIReader::OpenOptions open_options_write_index;
+    open_options_write_index.sub_block_directory_index_output = index_output_stream;
+    open_options_write_index.sub_block_directory_index_validate_content = true;
+    CreateCZIReader()->Open(make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob)), &open_options_write_index);
+    const auto index_stream = make_shared<CMemInputOutputStream>(index_output_stream->GetDataC(), index_output_stream->GetDataSize());
+    const bool lax_subblock_coordinate_checks = open_options_write_index.lax_subblock_coordinate_checks;
+    const auto document_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    ASSERT_TRUE(OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(document_stream, index_stream, lax_subblock_coordinate_checks));
+
+    // act & assert - the index is ignored for a different document...
+    const auto other_czi_document_as_blob = CreateTestCzi();
+    const auto reader = CreateCZIReader();
+    reader->Open(make_shared<CMemInputOutputStream>(get<0>(other_czi_document_as_blob).get(), get<1>(other_czi_document_as_blob)));
+    shared_ptr<ICZIReader> reader_with_index_of_other_document;
+    EXPECT_FALSE(OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(
+        make_shared<CMemInputOutputStream>(get<0>(other_czi_document_as_blob).get(), get<1>(other_czi_document_as_blob)),
+        index_stream,
+        lax_subblock_coordinate_checks,
+        &reader_with_index_of_other_document));
+    CompareSubBlockDirectoriesAndStatistics(reader.get(), reader_with_index_of_other_document.get());
+
+    // ...for different parse-options...
+    EXPECT_FALSE(OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(document_stream, index_stream, !lax_subblock_coordinate_checks));
+
+    // ...if data was appended to the document...
+    const auto document_data = static_cast<const uint8_t*>(get<0>(czi_document_as_blob).get());
+    vector<uint8_t> extended_document(document_data, document_data + get<1>(czi_document_as_blob));
+    extended_document.resize(extended_document.size() + 1000);
+    EXPECT_FALSE(OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(make_shared<CMemInputOutputStream>(extended_document.data(), extended_document.size()), index_stream, lax_subblock_coordinate_checks));
+
+    // ...if the sub-block directory of the document was modified in place (which is only detected with validating the content)...
+    const auto modified_stream = CreateCopyWithSubBlockDirectoryModifiedInPlace(czi_document_as_blob);
+    const auto reader_of_modified_document = CreateCZIReader();
+    reader_of_modified_document->Open(modified_stream);
+    EXPECT_TRUE(OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(modified_stream, index_stream, lax_subblock_coordinate_checks));
+    shared_ptr<ICZIReader> reader_with_index_of_unmodified_document;
+    EXPECT_FALSE(OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(modified_stream, index_stream, lax_subblock_coordinate_checks, &reader_with_index_of_unmodified_document, true));
+    CompareSubBlockDirectoriesAndStatistics(reader_of_modified_document.get(), reader_with_index_of_unmodified_document.get());
+    EXPECT_TRUE(OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(document_stream, index_stream, lax_subblock_coordinate_checks, nullptr, true));
+
+    // ...if validating the content is requested, but the index was written without the hash...
+    const auto index_without_hash_output_stream = make_shared<CMemOutputStream>(0);
+    ICZIReader::OpenOptions open_options_write_index_without_hash;
+    open_options_write_index_without_hash.sub_block_directory_index_output = index_without_hash_output_stream;
+    CreateCZIReader()->Open(document_stream, &open_options_write_index_without_hash);
+    const auto index_without_hash_stream = make_shared<CMemInputOutputStream>(index_without_hash_output_stream->GetDataC(), index_without_hash_output_stream->GetDataSize());
+    EXPECT_TRUE(OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(document_stream, index_without_hash_stream, lax_subblock_coordinate_checks));
+    EXPECT_FALSE(OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(document_stream, index_without_hash_stream, lax_subblock_coordinate_checks, nullptr, true));
+
+    // ...and if the index is corrupted
+    uint8_t byte;
+    index_stream->Read(index_stream->GetDataSize() - 1, &byte, 1, nullptr);
+    byte ^= 0xff;
+    index_stream->Write(index_stream->GetDataSize() - 1, &byte, 1, nullptr);
+    EXPECT_FALSE(OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(document_stream, index_stream, lax_subblock_coordinate_checks));
+}
+
+TEST(CziReader, OpenWithSubBlockDirectoryIndexWithImplausibleSizeAndCheckThatItIsIgnored)
+{
+    // arrange - create an index for a document, and then increase the sub-block count (and the total size accordingly) in its
+    // header, so that the header is consistent in itself - but the index is much smaller than the size given in the header
+    const auto czi_document_as_blob = CreateTestCziWithTilesOnMultiplePlanes();
+    const auto index_output_stream = make_shared<CMemOutputStream>(0);
+    ICZIReader::OpenOptions open_options_write_index;
+    open_options_write_index.sub_block_directory_index_output = index_output_stream;
+    CreateCZIReader()->Open(make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob)), &open_options_write_index);
+    const auto index_stream = make_shared<CMemInputOutputStream>(index_output_stream->GetDataC(), index_output_stream->GetDataSize());
+
+    constexpr uint64_t kOffsetOfSubBlockCount = 76;
+    constexpr uint64_t kOffsetOfTotalSize = 88;
+    constexpr uint32_t kAdditionalSubBlockCount = 0x80000000u;
+    uint32_t sub_block_count;
+    uint64_t total_size;
+    index_stream->Read(kOffsetOfSubBlockCount, &sub_block_count, sizeof(sub_block_count), nullptr);
+    index_stream->Read(kOffsetOfTotalSize, &total_size, sizeof(total_size), nullptr);
+    ASSERT_EQ(total_size, index_stream->GetDataSize());
+    sub_block_count += kAdditionalSubBlockCount;
+
+    // per sub-block, the index contains 9 arrays of 32-bit integers, the 64-bit file-positions, the 32-bit coordinate-indices and
+    // the 8-bit pyramid-types (and since the additional count is a multiple of 8, no additional padding is required)
+    total_size += static_cast<uint64_t>(kAdditionalSubBlockCount) * (9 * 4 + 8 + 4 + 1);
+    index_stream->Write(kOffsetOfSubBlockCount, &sub_block_count, sizeof(sub_block_count), nullptr);
+    index_stream->Write(kOffsetOfTotalSize, &total_size, sizeof(total_size), nullptr);
+
+    // act & assert
+    EXPECT_FALSE(OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(
+        make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob)),
+        index_stream,
+        open_options_write_index.lax_subblock_coordinate_checks));
+}
+
+TEST(CziReader, OpenWithSubBlockDirectoryIndexForSubBlockDirectoryWithSizeNotAMultipleOf8)
+{
+    // arrange - the test document has an odd number of sub-blocks, and the size of a directory entry is 32 bytes plus 20 bytes
+    // for each dimension-entry - so, the used size of the sub-block directory segment is not a multiple of 8 (which is checked
+    // here), and calculating the hash of its raw content (which is done when validating the content) requires padding
+    const auto czi_document_as_blob = CreateTestCzi();
+    const auto document_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto segment_sizes = CCZIParse::ReadSegmentHeaderAny(document_stream.get(), CCZIParse::ReadFileHeaderSegmentData(document_stream.get()).GetSubBlockDirectoryPosition());
+    ASSERT_EQ(segment_sizes.UsedSize % 8, 4);
+
+    const auto index_output_stream = make_shared<CMemOutputStream>(0);
+    ICZIReader::OpenOptions open_options_write_index;
+    open_options_write_index.sub_block_directory_index_output = index_output_stream;
+    open_options_write_index.sub_block_directory_index_validate_content = true;
+    const auto reader = CreateCZIReader();
+    reader->Open(document_stream, &open_options_write_index);
+    ASSERT_GT(index_output_stream->GetDataSize(), 0u);
+
+    // act
+    shared_ptr<ICZIReader> reader_using_index;
+    const bool index_was_used = OpenWithSubBlockDirectoryIndexAndCheckWhetherItWasUsed(
+        document_stream,
+        make_shared<CMemInputOutputStream>(index_output_stream->GetDataC(), index_output_stream->GetDataSize()),
+        open_options_write_index.lax_subblock_coordinate_checks,
+        &reader_using_index,
+        true);
+
+    // assert
+    ASSERT_TRUE(index_was_used);
+    CompareSubBlockDirectoriesAndStatistics(reader.get(), reader_using_index.get());
+}
+
+TEST(CziReader, ReadSubBlocksAsyncAndCompareWithReadSubBlock)
+{
+    // arrange
+    const auto czi_document_as_blob = CreateTestCziWithTilesOnMultiplePlanes();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto reader = CreateCZIReader();
+    ICZIReader::OpenOptions open_options;
+    open_options.SetDefault();
+    open_options.io_task_executor = CreateWorkStealingTaskExecutor(8);
+    reader->Open(memory_stream, &open_options);
+
+    // act - we start all reads (so that many of them are in flight), and only then wait for the results
+    vector<int> indices;
+    reader->EnumerateSubBlocks(
+        [&](int index, const SubBlockInfo&)->bool
+        {
+            indices.push_back(index);
+            return true;
+        });
+
+    vector<future<shared_ptr<ISubBlock>>> futures;
+    futures.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        futures.emplace_back(reader->ReadSubBlockAsync(indices[i], i % 2 == 0 ? TaskPriority::Interactive : TaskPriority::Background));
+    }
+
+    // assert
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        const auto sub_block_async = futures[i].get();
+        ASSERT_TRUE(sub_block_async);
+        const auto sub_block = reader->ReadSubBlock(indices[i]);
+        CompareSubBlockData(sub_block_async, sub_block);
+        EXPECT_EQ(sub_block_async->GetSubBlockInfo().mIndex, sub_block->GetSubBlockInfo().mIndex);
+    }
+
+    // for an index which does not exist, we expect an empty sub-block
+    EXPECT_FALSE(reader->ReadSubBlockAsync(numeric_limits<int>::max()).get());
+}
+
+TEST(CziReader, ReadSubBlocksAndCreateBitmapsAsyncWithCompletionHandlerAndCompareWithCreateBitmap)
+{
+    // arrange
+    const auto czi_document_as_blob = CreateTestCzi();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto reader = CreateCZIReader();
+    reader->Open(memory_stream);
+
+    vector<int> indices;
+    reader->EnumerateSubBlocks(
+        [&](int index, const SubBlockInfo&)->bool
+        {
+            indices.push_back(index);
+            return true;
+        });
+    ASSERT_FALSE(indices.empty());
+
+    // act
+    mutex results_mutex;
+    condition_variable results_condition;
+    map<int, shared_ptr<IBitmapData>> bitmaps;
+    int number_of_errors = 0;
+    for (const auto index : indices)
+    {
+        reader->BeginReadSubBlockAndCreateBitmap(
+            index,
+            TaskPriority::Normal,
+            [&, index](const shared_ptr<ISubBlock>& sub_block, const shared_ptr<IBitmapData>& bitmap, exception_ptr error)->void
+            {
+                lock_guard<mutex> lock(results_mutex);
+                if (error || !sub_block || !bitmap)
+                {
+                    ++number_of_errors;
+                }
+
+                bitmaps[index] = bitmap;
+                results_condition.notify_all();
+            });
+    }
+
+    {
+        unique_lock<mutex> lock(results_mutex);
+        ASSERT_TRUE(results_condition.wait_for(lock, chrono::seconds(60), [&]() { return bitmaps.size() == indices.size(); }));
+    }
+
+    // assert
+    EXPECT_EQ(number_of_errors, 0);
+    for (const auto index : indices)
+    {
+        const auto bitmap = reader->ReadSubBlock(index)->CreateBitmap();
+        const auto& bitmap_async = bitmaps[index];
+        ASSERT_TRUE(bitmap_async);
+        ASSERT_EQ(bitmap_async->GetWidth(), bitmap->GetWidth());
+        ASSERT_EQ(bitmap_async->GetHeight(), bitmap->GetHeight());
+        ASSERT_EQ(bitmap_async->GetPixelType(), bitmap->GetPixelType());
+        const ScopedBitmapLockerSP lock_async{ bitmap_async };
+        const ScopedBitmapLockerSP lock{ bitmap };
+        for (uint32_t y = 0; y < bitmap->GetHeight(); ++y)
+        {
+            EXPECT_EQ(
+                memcmp(
+                    static_cast<const uint8_t*>(lock_async.ptrDataRoi) + static_cast<size_t>(y) * lock_async.stride,
+                    static_cast<const uint8_t*>(lock.ptrDataRoi) + static_cast<size_t>(y) * lock.stride,
+                    bitmap->GetWidth()),
+                0);
+        }
+    }
+}
+
+TEST(CziReader, ReadSubBlockAsyncAfterCloseAndExpectError)
+{
+    // arrange
+    const auto czi_document_as_blob = CreateTestCzi();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto reader = CreateCZIReader();
+
+    // a reader which is not operational reports the error immediately
+    EXPECT_THROW(reader->ReadSubBlockAsync(0), logic_error);
+
+    reader->Open(memory_stream);
+    auto future_sub_block = reader->ReadSubBlockAndCreateBitmapAsync(0);
+    reader->Close();
+
+    // depending on the timing, the operation succeeded (if the read happened before the Close() call) or it
+    //  failed with a logic_error (if the read happened after the Close() call)
+    try
+    {
+        EXPECT_TRUE(future_sub_block.get());
+    }
+    catch (logic_error&)
+    {
+    }
+
+    EXPECT_THROW(reader->ReadSubBlockAsync(0), logic_error);
+}
+
+TEST(CziReader, ReadSubBlocksWithBatchedReadsAndCompareWithReadSubBlock)
+{
+    // a stream which implements batched reads (and counts the read-operations)
+    class CBatchReadCountingStream : public libCZI::IStreamEx
+    {
+    private:
+        shared_ptr<CMemInputOutputStream> memory_stream_;
+    public:
+        atomic<int> read_calls{ 0 };
+        atomic<int> read_many_calls{ 0 };
+
+        explicit CBatchReadCountingStream(shared_ptr<CMemInputOutputStream> memory_stream) : memory_stream_(std::move(memory_stream)) {}
+
+        void Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead) override
+        {
+            ++this->read_calls;
+            this->memory_stream_->Read(offset, pv, size, ptrBytesRead);
+        }
+
+        bool TryGetDirectAccess(std::uint64_t offset, std::uint64_t size, std::shared_ptr<const void>& data) override
+        {
+            return false;
+        }
+
+        void ReadMany(StreamReadRange* ranges, size_t count) override
+        {
+            ++this->read_many_calls;
+            for (size_t i = 0; i < count; ++i)
+            {
+                this->memory_stream_->Read(ranges[i].offset, ranges[i].data, ranges[i].size, &ranges[i].bytes_read);
+            }
+        }
+    };
+
+    // arrange
+    const auto czi_document_as_blob = CreateTestCzi();
+    const auto memory_stream = make_shared<CMemInputOutputStream>(get<0>(czi_document_as_blob).get(), get<1>(czi_document_as_blob));
+    const auto batch_read_stream = make_shared<CBatchReadCountingStream>(memory_stream);
+    const auto reader = CreateCZIReader();
+    reader->Open(batch_read_stream);
+    vector<int> indices;
+    reader->EnumerateSubBlocks(
+        [&](int index, const SubBlockInfo&)->bool
+        {
+            indices.push_back(index);
+            return true;
+        });
+    ASSERT_GT(indices.size(), 1u);
+
+    // we request the sub-blocks in reverse order, one of them twice, and an invalid index
+    vector<int> indices_to_read(indices.rbegin(), indices.rend());
+    indices_to_read.push_back(indices[0]);
+    indices_to_read.push_back(-1);
+    batch_read_stream->read_calls = 0;
+    batch_read_stream->read_many_calls = 0;
+
+    // act
+    const auto sub_blocks = reader->ReadSubBlocks(indices_to_read);
+
+    // assert
+    EXPECT_EQ(batch_read_stream->read_calls.load(), 0);
+    EXPECT_EQ(batch_read_stream->read_many_calls.load(), 2);
+    ASSERT_EQ(sub_blocks.size(), indices_to_read.size());
+    EXPECT_FALSE(sub_blocks.back());
+    for (size_t i = 0; i < indices_to_read.size() - 1; ++i)
+    {
+        ASSERT_TRUE(sub_blocks[i]);
+        const auto sub_block = reader->ReadSubBlock(indices_to_read[i]);
+        EXPECT_EQ(sub_blocks[i]->GetSubBlockInfo().mIndex, sub_block->GetSubBlockInfo().mIndex);
+        for (const auto type : { ISubBlock::MemBlkType::Data, ISubBlock::MemBlkType::Metadata, ISubBlock::MemBlkType::Attachment })
+        {
+            size_t size_batched, size;
+            const auto data_batched = sub_blocks[i]->GetRawData(type, &size_batched);
+            const auto data = sub_block->GetRawData(type, &size);
+            ASSERT_EQ(size_batched, size);
+            if (size > 0)
+            {
+                EXPECT_EQ(memcmp(data_batched.get(), data.get(), size), 0);
+            }
+        }
+    }
+}
@@ -4,8 +4,17 @@
 
 #include "include_gtest.h"
 #include "inc_libCZI.h"
+#include "MemOutputStream.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
 
 using namespace libCZI;
+using namespace std;
 
 TEST(StreamsLib, Enumeration)
 {
@@ -114,3 +123,370 @@ TEST(StreamsLib, TestGetStreamPropertyBagPropertyInfo)
     // check that the list of properties is terminated with an empty entry
     ASSERT_TRUE(property_infos[property_infos_count].property_name == nullptr);
 }
+
+TEST(StreamsLib, MmapFileInputStreamReadSubBlocksAndCompareWithInMemoryDocument)
+{
+    StreamsFactory::CreateStreamInfo create_info;
+    create_info.class_name = "mmap_file_inputstream";
+    bool mmap_stream_available = false;
+    StreamsFactory::StreamClassInfo info;
+    for (int i = 0; StreamsFactory::GetStreamInfoForClass(i, info); ++i)
+    {
+        if (info.class_name == create_info.class_name)
+        {
+            mmap_stream_available = true;
+            break;
+        }
+    }
+
+    if (!mmap_stream_available)
+    {
+        GTEST_SKIP() << "The stream-class \"mmap_file_inputstream\" is not available.";
+    }
+
+    // arrange - create a CZI with some sub-blocks (with metadata and attachment) and write it to a file
+    const auto writer = CreateCZIWriter();
+    const auto out_stream = make_shared<CMemOutputStream>(0);
+    writer->Create(out_stream, make_shared<CCziWriterInfo>(GUID{ 0x1234,0,0,{ 0,0,0,0,0,0,0,0 } }));
+    uint8_t pixels[16 * 16];
+    static const char sub_block_metadata[] = "<METADATA/>";
+    static const uint8_t sub_block_attachment[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    for (int i = 0; i < 10; ++i)
+    {
+        for (size_t n = 0; n < sizeof(pixels); ++n)
+        {
+            pixels[n] = static_cast<uint8_t>(n + i);
+        }
+
+        AddSubBlockInfoMemPtr add_sub_block_info;
+        add_sub_block_info.Clear();
+        add_sub_block_info.coordinate = CDimCoordinate::Parse("C0");
+        add_sub_block_info.mIndexValid = true;
+        add_sub_block_info.mIndex = i;
+        add_sub_block_info.x = i * 16;
+        add_sub_block_info.logicalWidth = add_sub_block_info.physicalWidth = 16;
+        add_sub_block_info.logicalHeight = add_sub_block_info.physicalHeight = 16;
+        add_sub_block_info.PixelType = PixelType::Gray8;
+        add_sub_block_info.ptrData = pixels;
+        add_sub_block_info.dataSize = sizeof(pixels);
+        add_sub_block_info.ptrSbBlkMetadata = sub_block_metadata;
+        add_sub_block_info.sbBlkMetadataSize = sizeof(sub_block_metadata);
+        add_sub_block_info.ptrSbBlkAttachment = sub_block_attachment;
+        add_sub_block_info.sbBlkAttachmentSize = sizeof(sub_block_attachment);
+        writer->SyncAddSubBlock(add_sub_block_info);
+    }
+
+    writer->Close();
+    size_t size_of_czi;
+    const auto czi_data = out_stream->GetCopy(&size_of_czi);
+
+    const char* const filename = "libczi_unittest_mmap_file_inputstream.czi";
+    {
+        const auto file_output_stream = CreateOutputStreamForFile(L"libczi_unittest_mmap_file_inputstream.czi", true);
+        file_output_stream->Write(0, czi_data.get(), size_of_czi, nullptr);
+    }
+
+    // act
+    auto stream = StreamsFactory::CreateStream(create_info, filename);
+    ASSERT_TRUE(stream);
+    const auto stream_ex = dynamic_pointer_cast<IStreamEx>(stream);
+    ASSERT_TRUE(stream_ex);
+
+    shared_ptr<const void> direct_access;
+    ASSERT_TRUE(stream_ex->TryGetDirectAccess(0, size_of_czi, direct_access));
+    EXPECT_EQ(memcmp(direct_access.get(), czi_data.get(), size_of_czi), 0);
+    EXPECT_FALSE(stream_ex->TryGetDirectAccess(1, size_of_czi, direct_access));
+
+    // reading beyond the end of the file is expected to give a short read
+    uint8_t buffer[16];
+    uint64_t bytes_read;
+    stream->Read(size_of_czi - 4, buffer, sizeof(buffer), &bytes_read);
+    EXPECT_EQ(bytes_read, 4u);
+    stream->Read(size_of_czi + 100, buffer, sizeof(buffer), &bytes_read);
+    EXPECT_EQ(bytes_read, 0u);
+
+    auto reader = CreateCZIReader();
+    reader->Open(stream);
+    vector<shared_ptr<ISubBlock>> sub_blocks;
+    reader->EnumerateSubBlocks(
+        [&](int index, const SubBlockInfo&)->bool
+        {
+            sub_blocks.push_back(reader->ReadSubBlock(index));
+            return true;
+        });
+
+    // now, release all references to the reader and the stream - the sub-blocks must remain valid nevertheless
+    reader->Close();
+    reader.reset();
+    stream.reset();
+    direct_access.reset();
+
+    // assert
+    ASSERT_EQ(sub_blocks.size(), 10u);
+    for (size_t i = 0; i < sub_blocks.size(); ++i)
+    {
+        for (size_t n = 0; n < sizeof(pixels); ++n)
+        {
+            pixels[n] = static_cast<uint8_t>(n + i);
+        }
+
+        size_t size;
+        const auto data = sub_blocks[i]->GetRawData(ISubBlock::MemBlkType::Data, &size);
+        ASSERT_EQ(size, sizeof(pixels));
+        EXPECT_EQ(memcmp(data.get(), pixels, sizeof(pixels)), 0);
+        const auto metadata = sub_blocks[i]->GetRawData(ISubBlock::MemBlkType::Metadata, &size);
+        ASSERT_EQ(size, sizeof(sub_block_metadata));
+        EXPECT_EQ(memcmp(metadata.get(), sub_block_metadata, sizeof(sub_block_metadata)), 0);
+        const auto attachment = sub_blocks[i]->GetRawData(ISubBlock::MemBlkType::Attachment, &size);
+        ASSERT_EQ(size, sizeof(sub_block_attachment));
+        EXPECT_EQ(memcmp(attachment.get(), sub_block_attachment, sizeof(sub_block_attachment)), 0);
+    }
+
+    sub_blocks.clear();
+    remove(filename);
+}
+
+TEST(StreamsLib, PreadFileInputStreamReadManyAndCompareWithRead)
+{
+    StreamsFactory::CreateStreamInfo create_info;
+    create_info.class_name = "pread_file_inputstream";
+    bool pread_stream_available = false;
+    StreamsFactory::StreamClassInfo info;
+    for (int i = 0; StreamsFactory::GetStreamInfoForClass(i, info); ++i)
+    {
+        if (info.class_name == create_info.class_name)
+        {
+            pread_stream_available = true;
+            break;
+        }
+    }
+
+    if (!pread_stream_available)
+    {
+        GTEST_SKIP() << "The stream-class \"pread_file_inputstream\" is not available.";
+    }
+
+    // arrange - write a file with 300000 bytes of a (pseudo-random) pattern
+    const size_t file_size = 300000;
+    unique_ptr<uint8_t[]> file_content(new uint8_t[file_size]);
+    uint32_t value = 12345;
+    for (size_t i = 0; i < file_size; ++i)
+    {
+        value = value * 1103515245 + 12345;
+        file_content[i] = static_cast<uint8_t>(value >> 16);
+    }
+
+    const char* const filename = "libczi_unittest_pread_file_inputstream_readmany.bin";
+    {
+        const auto file_output_stream = CreateOutputStreamForFile(L"libczi_unittest_pread_file_inputstream_readmany.bin", true);
+        file_output_stream->Write(0, file_content.get(), file_size, nullptr);
+    }
+
+    const auto stream = StreamsFactory::CreateStream(create_info, filename);
+    ASSERT_TRUE(stream);
+    const auto stream_ex = dynamic_pointer_cast<IStreamEx>(stream);
+    ASSERT_TRUE(stream_ex);
+
+    // the ranges are unordered, adjacent, separated by small and large gaps, overlapping, empty and (partially) beyond the end of the file
+    const struct { uint64_t offset; uint64_t size; } range_specs[] =
+    {
+        { 1000, 500 }, { 0, 100 }, { 100, 200 }, { 310, 50 }, { 1200, 1000 }, { 150000, 3000 },
+        { 5000, 0 }, { 299990, 100 }, { 400000, 10 }, { 2190, 20 }, { 90000, 60000 },
+    };
+
+    const size_t count = sizeof(range_specs) / sizeof(range_specs[0]);
+    vector<vector<uint8_t>> buffers(count);
+    vector<StreamReadRange> ranges(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        buffers[i].resize(static_cast<size_t>(range_specs[i].size) + 1);
+        ranges[i].offset = range_specs[i].offset;
+        ranges[i].data = buffers[i].data();
+        ranges[i].size = range_specs[i].size;
+        ranges[i].bytes_read = 0xffffffff;
+    }
+
+    // act
+    stream_ex->ReadMany(ranges.data(), ranges.size());
+
+    // assert
+    for (size_t i = 0; i < count; ++i)
+    {
+        vector<uint8_t> expected(static_cast<size_t>(range_specs[i].size) + 1);
+        uint64_t bytes_read;
+        stream->Read(range_specs[i].offset, expected.data(), range_specs[i].size, &bytes_read);
+        EXPECT_EQ(ranges[i].bytes_read, bytes_read) << "range #" << i;
+        EXPECT_EQ(memcmp(buffers[i].data(), expected.data(), static_cast<size_t>(bytes_read)), 0) << "range #" << i;
+        if (range_specs[i].offset < file_size)
+        {
+            EXPECT_EQ(memcmp(buffers[i].data(), file_content.get() + range_specs[i].offset, static_cast<size_t>(bytes_read)), 0) << "range #" << i;
+        }
+    }
+
+    remove(filename);
+}
+
+TEST(StreamsLib, CachingStreamReadSmallPiecesAndCompareWithUnderlyingStream)
+{
+    // a stream serving a (pseudo-random) pattern from memory, which counts the read-operations
+    class CountingMemoryStream : public IStream
+    {
+    private:
+        vector<uint8_t> data_;
+    public:
+        atomic<int> read_count{ 0 };
+
+        explicit CountingMemoryStream(vector<uint8_t> data) : data_(std::move(data))
+        {
+        }
+
+        void Read(std::uint64_t offset, void* pv, std::uint64_t size, std::uint64_t* ptrBytesRead) override
+        {
+            ++this->read_count;
+            const uint64_t bytes_to_copy = offset < this->data_.size() ? min(size, this->data_.size() - offset) : 0;
+            if (bytes_to_copy > 0)
+            {
+                memcpy(pv, this->data_.data() + offset, static_cast<size_t>(bytes_to_copy));
+            }
+
+            if (ptrBytesRead != nullptr)
+            {
+                *ptrBytesRead = bytes_to_copy;
+            }
+        }
+    };
+
+    const size_t data_size = 100000;
+    vector<uint8_t> data(data_size);
+    uint32_t value = 4711;
+    for (size_t i = 0; i < data_size; ++i)
+    {
+        value = value * 1103515245 + 12345;
+        data[i] = static_cast<uint8_t>(value >> 16);
+    }
+
+    const auto underlying_stream = make_shared<CountingMemoryStream>(data);
+    map<int, StreamsFactory::Property> property_bag;
+    property_bag[StreamsFactory::StreamProperties::kCaching_BlockSize] = StreamsFactory::Property(1024);
+    property_bag[StreamsFactory::StreamProperties::kCaching_MaxBlocks] = StreamsFactory::Property(16);
+    property_bag[StreamsFactory::StreamProperties::kCaching_MaxReadAheadBlocks] = StreamsFactory::Property(4);
+    const auto stream = StreamsFactory::CreateCachingStream(underlying_stream, property_bag);
+    const auto cache_statistics = dynamic_pointer_cast<IStreamCacheStatistics>(stream);
+    ASSERT_TRUE(cache_statistics);
+
+    const auto check_read =
+        [&](uint64_t offset, uint64_t size)
+        {
+            vector<uint8_t> buffer(static_cast<size_t>(size));
+            uint64_t bytes_read = 0xffffffff;
+            stream->Read(offset, buffer.data(), size, &bytes_read);
+            const uint64_t expected_bytes_read = offset < data_size ? min(size, data_size - offset) : 0;
+            ASSERT_EQ(bytes_read, expected_bytes_read) << "offset=" << offset << " size=" << size;
+            ASSERT_EQ(memcmp(buffer.data(), data.data() + offset, static_cast<size_t>(bytes_read)), 0) << "offset=" << offset << " size=" << size;
+        };
+
+    // act & assert - read sequentially in small pieces (crossing block boundaries)
+    for (uint64_t offset = 0; offset < 50000; offset += 30)
+    {
+        check_read(offset, 30);
+    }
+
+    auto statistics = cache_statistics->GetCacheStatistics();
+    EXPECT_GT(statistics.read_ahead_blocks, 0u);
+    EXPECT_GT(statistics.block_hits, 0u);
+    EXPECT_EQ(statistics.underlying_reads, static_cast<uint64_t>(underlying_stream->read_count.load()));
+    EXPECT_LT(underlying_stream->read_count.load(), 50000 / 1024 + 1);
+
+    // read at (pseudo-random) positions, at the end of the stream, beyond the end and with a size larger than a block
+    for (int i = 0; i < 2000; ++i)
+    {
+        value = value * 1103515245 + 12345;
+        check_read(value % (data_size + 100), 1 + (value >> 8) % 1500);
+    }
+
+    check_read(data_size - 10, 20);
+    check_read(data_size, 10);
+    check_read(data_size + 5000, 10);
+    check_read(0, 0);
+
+    statistics = cache_statistics->GetCacheStatistics();
+    EXPECT_GT(statistics.evicted_blocks, 0u);
+    EXPECT_GT(statistics.bypassed_reads, 0u);
+    EXPECT_EQ(statistics.underlying_reads, static_cast<uint64_t>(underlying_stream->read_count.load()));
+
+    // read concurrently from multiple threads
+    vector<thread> threads;
+    atomic<bool> all_reads_correct{ true };
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back(
+            [&, t]()
+            {
+                uint32_t thread_value = t;
+                for (int i = 0; i < 2000; ++i)
+                {
+                    thread_value = thread_value * 1103515245 + 12345;
+                    const uint64_t offset = thread_value % data_size;
+                    const uint64_t size = 1 + (thread_value >> 8) % 100;
+                    uint8_t buffer[100];
+                    uint64_t bytes_read;
+                    stream->Read(offset, buffer, size, &bytes_read);
+                    if (bytes_read != min(size, data_size - offset) || memcmp(buffer, data.data() + offset, static_cast<size_t>(bytes_read)) != 0)
+                    {
+                        all_reads_correct = false;
+                    }
+                }
+            });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_TRUE(all_reads_correct.load());
+}
+
+TEST(StreamsLib, CreateStreamWithCachingEnabledAndCheckThatCachingDecoratorIsUsed)
+{
+    const size_t file_size = 10000;
+    vector<uint8_t> file_content(file_size);
+    for (size_t i = 0; i < file_size; ++i)
+    {
+        file_content[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    const char* const filename = "libczi_unittest_caching_stream.bin";
+    {
+        const auto file_output_stream = CreateOutputStreamForFile(L"libczi_unittest_caching_stream.bin", true);
+        file_output_stream->Write(0, file_content.data(), file_size, nullptr);
+    }
+
+    StreamsFactory::CreateStreamInfo create_info;
+    create_info.class_name = "c_runtime_file_inputstream";
+    create_info.property_bag[StreamsFactory::StreamProperties::kCaching_Enabled] = StreamsFactory::Property(true);
+    create_info.property_bag[StreamsFactory::StreamProperties::kCaching_BlockSize] = StreamsFactory::Property(4096);
+    const auto stream = StreamsFactory::CreateStream(create_info, filename);
+    ASSERT_TRUE(stream);
+    const auto cache_statistics = dynamic_pointer_cast<IStreamCacheStatistics>(stream);
+    ASSERT_TRUE(cache_statistics);
+
+    for (uint64_t offset = 0; offset < file_size; offset += 2)
+    {
+        uint8_t buffer[2];
+        uint64_t bytes_read;
+        stream->Read(offset, buffer, 2, &bytes_read);
+        ASSERT_EQ(bytes_read, 2u);
+        ASSERT_EQ(memcmp(buffer, file_content.data() + offset, 2), 0);
+    }
+
+    const auto statistics = cache_statistics->GetCacheStatistics();
+    EXPECT_EQ(statistics.block_misses + statistics.read_ahead_blocks, 3u);
+    EXPECT_LE(statistics.underlying_reads, 3u);
+
+    create_info.property_bag[StreamsFactory::StreamProperties::kCaching_Enabled] = StreamsFactory::Property(false);
+    const auto uncached_stream = StreamsFactory::CreateStream(create_info, filename);
+    EXPECT_FALSE(dynamic_pointer_cast<IStreamCacheStatistics>(uncached_stream));
+
+    remove(filename);
+}